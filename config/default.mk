@@ -11,11 +11,21 @@ ENABLE_LIST ?= 1
 MODERN_INPUT_ONLY ?= 1
 GESTALT_MACHINE_TYPE ?= 0
 BEZEL_STYLE ?= rounded
+WM_COMPOSITOR ?= 0
+QD_DOUBLE_BUFFER ?= 0
+QD_PRESENT_SWEEP ?= 0
+HFS_BLOCK_CACHE_KB ?= 256
 
 # Test/smoke test flags (disabled by default)
 CTRL_SMOKE_TEST ?= 0
 LIST_SMOKE_TEST ?= 0
 ALERT_SMOKE_TEST ?= 0
+M68K_BENCHMARK ?= 0
+PPC_BENCHMARK ?= 0
+MEMORY_BENCHMARK ?= 0
+MEMORY_PROFILE ?= 0
+QUICKDRAW_BENCHMARK ?= 0
+FONT_BENCHMARK ?= 0
 
 # Optimization and debug settings
 OPT_LEVEL ?= 1
@@ -1,8 +1,9 @@
 /*
  * ATA_Driver.h - ATA/IDE disk driver interface
  *
- * Provides PIO mode access to ATA/IDE hard disks for bare-metal System 7.1.
- * Supports LBA28 addressing mode for drives up to 128GB.
+ * Provides access to ATA/IDE hard disks for bare-metal System 7.1: PCI
+ * bus-master DMA where the IDE controller supports it, PIO otherwise.
+ * LBA48 commands are used for transfers LBA28 cannot express.
  */
 
 #ifndef ATA_DRIVER_H
@@ -52,7 +53,13 @@
 
 /* ATA Commands */
 #define ATA_CMD_READ_SECTORS    0x20    /* Read sectors with retry */
+#define ATA_CMD_READ_SECTORS_EXT 0x24   /* Read sectors (LBA48) */
+#define ATA_CMD_READ_DMA_EXT    0x25    /* Read DMA (LBA48) */
 #define ATA_CMD_WRITE_SECTORS   0x30    /* Write sectors with retry */
+#define ATA_CMD_WRITE_SECTORS_EXT 0x34  /* Write sectors (LBA48) */
+#define ATA_CMD_WRITE_DMA_EXT   0x35    /* Write DMA (LBA48) */
+#define ATA_CMD_READ_DMA        0xC8    /* Read DMA with retry */
+#define ATA_CMD_WRITE_DMA       0xCA    /* Write DMA with retry */
 #define ATA_CMD_IDENTIFY        0xEC    /* Identify device */
 #define ATA_CMD_IDENTIFY_PACKET 0xA1    /* Identify packet device */
 #define ATA_CMD_PACKET          0xA0    /* Packet command (ATAPI) */
@@ -68,6 +75,32 @@
 #define ATA_CTRL_SRST           0x04    /* Software reset */
 #define ATA_CTRL_HOB            0x80    /* High order byte (48-bit LBA) */
 
+/* Bus-master IDE registers (SFF-8038i), from the controller's BAR4.
+ * The secondary channel's are ATA_BM_SECONDARY further on. */
+#define ATA_BM_REG_COMMAND      0x00    /* Start/stop, direction */
+#define ATA_BM_REG_STATUS       0x02
+#define ATA_BM_REG_PRDT         0x04    /* Physical address of the PRD table */
+#define ATA_BM_SECONDARY        0x08
+
+#define ATA_BM_CMD_START        0x01    /* Start bus-master operation */
+#define ATA_BM_CMD_READ         0x08    /* Device to memory */
+
+#define ATA_BM_STATUS_ACTIVE    0x01    /* Transfer in progress */
+#define ATA_BM_STATUS_ERR       0x02    /* DMA error (write 1 to clear) */
+#define ATA_BM_STATUS_IRQ       0x04    /* Device interrupted (write 1 to clear) */
+#define ATA_BM_STATUS_DRV0_DMA  0x20    /* Master set up for DMA */
+#define ATA_BM_STATUS_DRV1_DMA  0x40    /* Slave set up for DMA */
+
+/* Physical Region Descriptor: one piece of a DMA buffer, which may not
+ * cross a 64KB boundary. A byte count of 0 means 64KB. */
+typedef struct {
+    uint32_t base;          /* Physical address, even */
+    uint16_t bytes;
+    uint16_t flags;         /* ATA_PRD_EOT on the last entry */
+} ATAPRDEntry;
+
+#define ATA_PRD_EOT             0x8000
+
 /* ATA Device Types */
 typedef enum {
     ATA_DEVICE_NONE = 0,
@@ -91,6 +124,7 @@ typedef struct {
     char firmware[9];       /* Firmware revision (8 chars + null) */
     bool lba48_supported;   /* LBA48 addressing supported */
     bool dma_supported;     /* DMA transfers supported */
+    bool dma_enabled;       /* Transfers go by bus-master DMA */
 } ATADevice;
 
 /* Maximum devices (primary master/slave + secondary master/slave) */
@@ -108,6 +142,13 @@ ATADevice* ATA_GetDevice(int index);
 /* Sector I/O Operations */
 OSErr ATA_ReadSectors(ATADevice* device, uint32_t lba, uint8_t count, void* buffer);
 OSErr ATA_WriteSectors(ATADevice* device, uint32_t lba, uint8_t count, const void* buffer);
+
+/* Any number of sectors from any LBA the drive has, in as few commands as
+ * the transfer mode allows - DMA when the device has it enabled and the
+ * buffer is even-aligned, PIO otherwise. Writes stay in the drive's cache
+ * until ATA_FlushCache. */
+OSErr ATA_ReadSectors48(ATADevice* device, uint64_t lba, uint32_t count, void* buffer);
+OSErr ATA_WriteSectors48(ATADevice* device, uint64_t lba, uint32_t count, const void* buffer);
 OSErr ATA_FlushCache(ATADevice* device);
 
 /* Low-level ATA Operations */
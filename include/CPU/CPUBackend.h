@@ -90,6 +90,12 @@ typedef struct RelocTable {
 typedef UInt16 TrapNumber;
 typedef OSErr (*CPUTrapHandler)(void* context, CPUAddr* pc, CPUAddr* registers);
 
+/*
+ * Page-in callback for MapPaged: copy len bytes, from offset bytes into the
+ * mapped image, to dst. Bytes it leaves alone stay zero.
+ */
+typedef OSErr (*CPUPageInProc)(void* refCon, UInt32 offset, void* dst, UInt32 len);
+
 /*
  * ICPUBackend - CPU Backend Interface
  *
@@ -252,6 +258,48 @@ typedef struct ICPUBackend {
      */
     OSErr (*ReadMemory)(CPUAddressSpace as, CPUAddr addr,
                        void* data, Size len);
+
+    /*
+     * MapPaged - Reserve address space whose pages are filled on first touch
+     *
+     * Nothing is copied up front. Each page is filled by pageIn the first
+     * time anything reads, writes or runs it, so mapping a large image costs
+     * only the pages that are used. refCon has to outlive the address space.
+     *
+     * Optional: NULL in a backend that cannot do it, and the caller copies
+     * the image in with AllocateMemory and WriteMemory instead.
+     *
+     * @param as            Address space
+     * @param len           Length of the image
+     * @param pageIn        Fills a page, or part of one, from the image
+     * @param refCon        Passed to pageIn
+     * @param outBase       Output base address; page-aligned
+     * @return              OSErr
+     */
+    OSErr (*MapPaged)(CPUAddressSpace as, Size len, CPUPageInProc pageIn,
+                     void* refCon, CPUAddr* outBase);
+
+    /*
+     * CallRoutine - Run a routine to its return, then carry on as before
+     *
+     * For the loader's own calls into loaded code, such as a fragment's
+     * init routine. The routine gets its own stack frame below whatever was
+     * running, and every register is put back afterwards, so a call made
+     * from inside a trap handler leaves the trapping code undisturbed.
+     *
+     * Optional: NULL in a backend that cannot do it.
+     *
+     * @param as            Address space
+     * @param routine       The routine, in the form the ISA calls through
+     *                      (a transition vector on PowerPC)
+     * @param args          Arguments, in the first argument registers
+     * @param argCount      How many; at most 8
+     * @param outResult     Output return value; may be NULL
+     * @return              OSErr (segmentLoaderErr if it faulted or
+     *                      never returned)
+     */
+    OSErr (*CallRoutine)(CPUAddressSpace as, CPUAddr routine,
+                        const UInt32* args, UInt16 argCount, UInt32* outResult);
 } ICPUBackend;
 
 /*
@@ -1,4 +1,4 @@
-/* CPU/CPULogging.h - Logging macros for CPU/M68K subsystem */
+/* CPU/CPULogging.h - Logging macros for the CPU backends */
 #ifndef CPU_LOGGING_H
 #define CPU_LOGGING_H
 
@@ -10,5 +10,8 @@
 #define M68K_LOG_WARN(fmt, ...)  serial_logf(kLogModuleCPU, kLogLevelWarn,  "[M68K] " fmt, ##__VA_ARGS__)
 #define M68K_LOG_ERROR(fmt, ...) serial_logf(kLogModuleCPU, kLogLevelError, "[M68K] " fmt, ##__VA_ARGS__)
 
+#define PPC_LOG_DEBUG(fmt, ...)  serial_logf(kLogModuleCPU, kLogLevelDebug, "[PPC] " fmt, ##__VA_ARGS__)
+#define PPC_LOG_INFO(fmt, ...)   serial_logf(kLogModuleCPU, kLogLevelInfo,  "[PPC] " fmt, ##__VA_ARGS__)
+
 #endif /* CPU_LOGGING_H */
 
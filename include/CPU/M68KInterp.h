@@ -6,7 +6,8 @@
  * byte ordering to ensure cross-platform compatibility.
  *
  * Platform Independence:
- * - All multi-byte values use explicit big-endian construction (not host byte order)
+ * - All multi-byte values are big-endian in guest memory; host byte order is
+ *   converted explicitly wherever a value is loaded or stored
  * - Memory access is abstracted through paged system (architecture-agnostic)
  * - Alignment checks follow 68K rules (2-byte alignment), not host requirements
  * - Register file is generic (no host CPU registers used)
@@ -36,8 +37,31 @@ typedef struct M68KRegs {
     UInt16 sr;                /* Status register */
     UInt32 usp;               /* User stack pointer */
     UInt32 ssp;               /* Supervisor stack pointer */
+
+    /* Condition codes not yet folded into sr.
+     *
+     * Most instructions set the flags and the next one overwrites them
+     * unread, so the common arithmetic and logical ones only note what they
+     * did - which kind of operation, its size, operands and result - and the
+     * flags are worked out from that when something reads them. ccOp is
+     * kM68KFlagsKnown when sr is already right. Inside the interpreter sr is
+     * read through M68K_FlagsSync; outside it, after M68K_Execute returns,
+     * it is always exact. */
+    UInt8  ccOp;
+    UInt8  ccSize;
+    UInt32 ccSrc;
+    UInt32 ccDst;
+    UInt32 ccRes;
 } M68KRegs;
 
+enum {
+    kM68KFlagsKnown = 0,      /* sr holds the flags */
+    kM68KFlagsLogic,          /* N,Z from ccRes; V=C=0; X untouched */
+    kM68KFlagsAdd,            /* ccDst + ccSrc; X=C */
+    kM68KFlagsSub,            /* ccDst - ccSrc; X=C */
+    kM68KFlagsCmp             /* ccDst - ccSrc; X untouched */
+};
+
 /*
  * 68K Exception Vectors
  */
@@ -94,10 +118,53 @@ static inline int M68K_TrapSlot(UInt16 trapWord)
     return trapWord & 0x00FF;
 }
 
+/*
+ * Predecoded instruction cache.
+ *
+ * Each entry holds an opcode word already fetched and already matched to its
+ * handler, so an instruction run a second time skips both the two paged byte
+ * reads of the fetch and the walk down the decoder. It is direct-mapped on the
+ * PC; 2048 entries cover 4KB of straight-line code before two instructions
+ * compete for a slot.
+ *
+ * Only the opcode word is kept. Extension words are still fetched by the
+ * handler as it runs, so a store can only make an entry stale by landing on
+ * the opcode word itself - which is the single entry it indexes to.
+ */
+#define M68K_ICACHE_ENTRIES  2048
+#define kM68KICacheEmpty     0xFFFFFFFFUL   /* odd, so never a PC we cache */
+
+/*
+ * Software TLB.
+ *
+ * A direct-mapped set of guest page to host page translations, so that a
+ * word or long access inside one page is a single host load rather than a
+ * page table walk per byte. Only pages that exist are entered - lazy
+ * allocation still happens in M68K_GetPage on the slow path - so an entry
+ * can go stale only when the page table itself is rewritten, and whoever
+ * does that calls M68K_FlushTLB.
+ */
+#define M68K_TLB_ENTRIES  64
+#define kM68KTLBEmpty     0xFFFFFFFFUL   /* no page has this number */
+
+typedef struct M68KTLBEntry {
+    UInt32 page;              /* guest page number, or kM68KTLBEmpty */
+    UInt8* host;              /* start of the host page backing it */
+} M68KTLBEntry;
+
+typedef struct M68KAddressSpace M68KAddressSpace;
+typedef void (*M68KOpHandler)(M68KAddressSpace* as, UInt16 opcode);
+
+typedef struct M68KICacheEntry {
+    UInt32        pc;         /* address of the opcode word, or kM68KICacheEmpty */
+    M68KOpHandler handler;    /* what the decoder chose for it */
+    UInt16        opcode;
+} M68KICacheEntry;
+
 /*
  * M68K Address Space Implementation
  */
-typedef struct M68KAddressSpace {
+struct M68KAddressSpace {
     void* pageTable[M68K_NUM_PAGES];  /* Sparse page table (NULL = not allocated) */
     UInt32 baseAddr;          /* Base address (typically 0) */
 
@@ -130,7 +197,49 @@ typedef struct M68KAddressSpace {
      * had failed or at which instruction. */
     const char* faultReason;
     UInt32      faultPC;
-} M68KAddressSpace;
+
+    M68KICacheEntry icache[M68K_ICACHE_ENTRIES];
+    M68KTLBEntry    tlb[M68K_TLB_ENTRIES];
+
+    /* Translated blocks, for an address space run by the threaded backend
+     * (M68KThreaded.c); both NULL under the plain interpreter. codeLines has
+     * one bit per M68K_CODE_LINE bytes of guest memory, set wherever some
+     * block was translated from, so a store can tell in one test whether it
+     * might be overwriting translated code. */
+    UInt8*                 codeLines;
+    struct M68KBlockCache* blocks;
+};
+
+#define M68K_CODE_LINE_SHIFT  8                 /* 256-byte lines */
+#define M68K_CODE_LINE_BYTES  (M68K_MAX_ADDR >> (M68K_CODE_LINE_SHIFT + 3))
+
+/* Fold any pending condition codes into regs.sr. M68KOpcodes.c. */
+void M68K_FlagsSync(M68KAddressSpace* as);
+
+/* Drop translated blocks overlapping [addr, addr+len). M68KThreaded.c. */
+void M68K_InvalidateBlocks(M68KAddressSpace* as, UInt32 addr, UInt32 len);
+
+static inline Boolean M68K_IsCodeLine(const M68KAddressSpace* as, UInt32 addr)
+{
+    UInt32 line = (addr & (M68K_MAX_ADDR - 1)) >> M68K_CODE_LINE_SHIFT;
+    return as->codeLines && (as->codeLines[line >> 3] & (1 << (line & 7)));
+}
+
+/*
+ * A store to guest memory has to forget any cached decode of the word it
+ * lands on, or the old instruction would keep running in place of the new
+ * one. Every write path calls this; it is one compare when nothing is cached.
+ */
+static inline void M68K_InvalidateCodeWord(M68KAddressSpace* as, UInt32 addr)
+{
+    M68KICacheEntry* e = &as->icache[(addr >> 1) & (M68K_ICACHE_ENTRIES - 1)];
+    if (e->pc == (addr & ~1UL)) {
+        e->pc = kM68KICacheEmpty;
+    }
+    if (M68K_IsCodeLine(as, addr)) {
+        M68K_InvalidateBlocks(as, addr & ~1UL, 2);
+    }
+}
 
 /*
  * M68K Code Handle Implementation
@@ -147,17 +256,57 @@ typedef struct M68KCodeHandle {
  */
 OSErr M68KBackend_Initialize(void);
 
+/* Forget cached decodes for [addr, addr+len). For anything that changes guest
+ * memory without going through M68K_Write8 - a page remapped under the
+ * address space, or a block copied in by the host. */
+void M68K_InvalidateCode(M68KAddressSpace* as, UInt32 addr, UInt32 len);
+
+/* Forget every cached page translation. Anything that stores into pageTable
+ * other than M68K_GetPage's own lazy allocation must call this. */
+void M68K_FlushTLB(M68KAddressSpace* as);
+
 /*
  * M68K Interpreter Core (exposed for testing)
  */
 OSErr M68K_Execute(M68KAddressSpace* as, UInt32 startPC, UInt32 maxInstructions);
 OSErr M68K_Step(M68KAddressSpace* as);
 
+/* The handler the dispatch table holds for an opcode word. */
+M68KOpHandler M68K_HandlerFor(UInt16 opcode);
+
+/* Either engine's M68K_Execute. */
+typedef OSErr (*M68KExecuteFn)(M68KAddressSpace* as, UInt32 startPC,
+                               UInt32 maxInstructions);
+
+/* The body of EnterAt - stack check, return sentinel, fault report - with the
+ * engine that runs the code passed in, so both backends report alike. */
+OSErr M68K_RunProgram(M68KAddressSpace* as, CPUAddr entry, CPUEnterFlags flags,
+                      M68KExecuteFn execute);
+
+/*
+ * Threaded backend ("m68k_threaded", M68KThreaded.c).
+ *
+ * The same address space and handlers as the interpreter, run a block at a
+ * time: straight-line guest code is translated once into a list of handler
+ * calls with the opcode already decoded and branch targets already worked
+ * out, and blocks ending in a direct branch are chained to their successors.
+ * Registered after "m68k_interp" and chosen by name.
+ */
+OSErr M68KThreadedBackend_Initialize(void);
+OSErr M68KThreaded_Execute(M68KAddressSpace* as, UInt32 startPC,
+                           UInt32 maxInstructions);
+
 /* Run five instructions of known result. Silent unless one comes out wrong.
  * Nothing else in the system executes 68K code, so this is what would notice
- * the interpreter breaking. */
+ * the interpreter breaking. Runs everything again through "m68k_threaded"
+ * when that is registered. */
 void M68K_SelfTest(void);
 
+/* Guest MIPS through the old per-instruction decoder, through the dispatch
+ * table and decode cache, and through the threaded backend's blocks, reported
+ * on the serial console. M68K_BENCHMARK=1. */
+void M68K_Benchmark(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -181,6 +181,10 @@ typedef struct M68KAddressSpace M68KAddressSpace;
  */
 extern void M68K_Fault(M68KAddressSpace* as, const char* reason);
 extern Boolean M68K_TestCondition(UInt16 sr, M68KCondition cc);
+/* The condition against the current flags, pending ones included. What a
+ * branch should call - it answers the usual compare-and-branch tests straight
+ * from the pending operands without building sr. */
+extern Boolean M68K_Condition(M68KAddressSpace* as, M68KCondition cc);
 
 /* Data movement operations */
 extern void M68K_Op_MOVE(M68KAddressSpace* as, UInt16 opcode);
@@ -108,10 +108,47 @@ typedef struct PPCRegs {
 #define PPC_MAX_ADDR       0x1000000   /* 16MB virtual address space (for now) */
 #define PPC_NUM_PAGES      4096        /* 16MB / 4KB */
 
+typedef struct PPCAddressSpace PPCAddressSpace;
+typedef void (*PPCOpHandler)(PPCAddressSpace* as, UInt32 insn);
+
+/*
+ * Predecoded instructions.
+ *
+ * Each guest page that code has run from gets an array with one entry per
+ * instruction word: the word as fetched and the handler the dispatch tables
+ * chose for it. An instruction run a second time costs one load for the
+ * entry instead of four paged byte reads and two table lookups. Entries are
+ * filled on first execution; NULL marks one not yet decoded, or forgotten
+ * because something stored over its word.
+ *
+ * The handlers still take the raw word and pull their own register and
+ * immediate fields out of it - a shift and a mask each, which is not worth
+ * a second signature for some four hundred handlers.
+ */
+#define PPC_PAGE_INSNS  (PPC_PAGE_SIZE / 4)
+
+typedef struct PPCDecoded {
+    PPCOpHandler handler;     /* what the tables chose, or NULL */
+    UInt32       insn;
+} PPCDecoded;
+
+/*
+ * Ranges mapped with MapPaged. A page inside one is filled from its image
+ * when first touched rather than when mapped.
+ */
+#define PPC_MAX_PAGERS  16
+
+typedef struct PPCPager {
+    UInt32 base;              /* page-aligned */
+    UInt32 size;
+    CPUPageInProc pageIn;
+    void* refCon;
+} PPCPager;
+
 /*
  * PowerPC Address Space Implementation
  */
-typedef struct PPCAddressSpace {
+struct PPCAddressSpace {
     void* pageTable[PPC_NUM_PAGES];  /* Sparse page table (NULL = not allocated) */
     UInt32 baseAddr;          /* Base address (typically 0) */
 
@@ -130,7 +167,32 @@ typedef struct PPCAddressSpace {
     /* Execution state */
     Boolean halted;           /* CPU halted due to fault or completion */
     UInt16 lastException;     /* Last exception code */
-} PPCAddressSpace;
+
+    /* Decoded instructions per page, allocated when code first runs there */
+    PPCDecoded* decoded[PPC_NUM_PAGES];
+
+    /* Demand-paged ranges */
+    PPCPager pagers[PPC_MAX_PAGERS];
+    int numPagers;
+
+    /* CallRoutine: where a called routine returns to, and the stack it runs
+     * on when nothing else has set one up; allocated on first use */
+    UInt32 callReturn;
+    UInt32 callStack;
+};
+
+/*
+ * A store to guest memory has to forget any decode of the word it lands on,
+ * or the old instruction would keep running in place of the new one. Every
+ * write path calls this; it is one test when the page holds no code.
+ */
+static inline void PPC_InvalidateCodeWord(PPCAddressSpace* as, UInt32 addr)
+{
+    PPCDecoded* d = as->decoded[(addr >> PPC_PAGE_SHIFT) & (PPC_NUM_PAGES - 1)];
+    if (d) {
+        d[(addr & (PPC_PAGE_SIZE - 1)) >> 2].handler = NULL;
+    }
+}
 
 /*
  * PowerPC Code Handle Implementation
@@ -147,12 +209,35 @@ typedef struct PPCCodeHandle {
  */
 OSErr PPCBackend_Initialize(void);
 
+/* Host page holding addr. A missing page inside a MapPaged range is filled
+ * now; any other is allocated, zeroed, if allocate is set, else NULL. */
+void* PPC_GetPage(PPCAddressSpace* as, UInt32 addr, Boolean allocate);
+
+/* Forget decoded instructions in [addr, addr+len). For anything that changes
+ * guest memory without going through PPC_Write8/16/32. */
+void PPC_InvalidateCode(PPCAddressSpace* as, UInt32 addr, UInt32 len);
+
 /*
  * PowerPC Interpreter Core (exposed for testing)
+ *
+ * PPC_Execute runs from the predecoded pages; PPC_Step fetches and looks up
+ * one instruction from scratch.
  */
 OSErr PPC_Execute(PPCAddressSpace* as, UInt32 startPC, UInt32 maxInstructions);
 OSErr PPC_Step(PPCAddressSpace* as);
 
+/* The handler the dispatch tables hold for an instruction word. */
+PPCOpHandler PPC_HandlerFor(UInt32 insn);
+
+/* Run a few programs through the decoded-instruction path and the plain one,
+ * and rewrite code that has already run. Silent unless something disagrees. */
+void PPC_SelfTest(void);
+
+/* Guest MIPS for integer, load/store and floating-point loops, through the
+ * old per-instruction decode, the handler tables, and the predecoded pages,
+ * reported on the serial console. PPC_BENCHMARK=1. */
+void PPC_Benchmark(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -63,6 +63,10 @@ extern "C" {
 /* Absolute address bit (AA) */
 #define PPC_AA(insn)    (((insn) >> 1) & 0x0001)
 
+/* SPR/TBR number of mfspr, mtspr and mftb. The two five-bit halves are
+ * stored swapped: the low half is in bits 11-15, the high half in 16-20. */
+#define PPC_SPR(insn)   ((((insn) >> 16) & 0x1F) | (((insn) >> 6) & 0x3E0))
+
 /*
  * Special Purpose Register (SPR) Numbers
  * Used by MFSPR/MTSPR instructions
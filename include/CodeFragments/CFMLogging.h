@@ -0,0 +1,43 @@
+/*
+ * CFMLogging.h - Code Fragment Manager Logging
+ *
+ * Logging for the Code Fragment Manager, under the Segment Loader module,
+ * which it sits beside.
+ */
+
+#ifndef CFM_LOGGING_H
+#define CFM_LOGGING_H
+
+#include "System71StdLib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Code Fragment Manager Logging Macros
+ *
+ * Usage:
+ *   CFM_LOG_ERROR("Cannot load %s: %d", name, err);
+ *   CFM_LOG_DEBUG("section %u at 0x%08X", i, base);
+ */
+#define CFM_LOG_ERROR(fmt, ...) \
+    serial_logf(kLogModuleSegmentLoader, kLogLevelError, "[CFM] " fmt, ##__VA_ARGS__)
+
+#define CFM_LOG_WARN(fmt, ...) \
+    serial_logf(kLogModuleSegmentLoader, kLogLevelWarn, "[CFM] " fmt, ##__VA_ARGS__)
+
+#define CFM_LOG_INFO(fmt, ...) \
+    serial_logf(kLogModuleSegmentLoader, kLogLevelInfo, "[CFM] " fmt, ##__VA_ARGS__)
+
+#define CFM_LOG_DEBUG(fmt, ...) \
+    serial_logf(kLogModuleSegmentLoader, kLogLevelDebug, "[CFM] " fmt, ##__VA_ARGS__)
+
+#define CFM_LOG_TRACE(fmt, ...) \
+    serial_logf(kLogModuleSegmentLoader, kLogLevelTrace, "[CFM] " fmt, ##__VA_ARGS__)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CFM_LOGGING_H */
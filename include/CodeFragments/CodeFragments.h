@@ -0,0 +1,315 @@
+/*
+ * CodeFragments.h - Code Fragment Manager
+ *
+ * Loads PEF containers - PowerPC applications, shared libraries and drop-in
+ * additions - into a CPU address space and connects their imports to other
+ * fragments' exports. It is to PowerPC code what the Segment Loader is to
+ * 68K CODE resources, and sits beside it.
+ *
+ * Design:
+ * - Works through ICPUBackend like the Segment Loader; only the bind glue it
+ *   writes is PowerPC code
+ * - A container is read where it lies: mapped in host memory, or streamed
+ *   through a read callback. It is never copied whole
+ * - Code sections are demand-paged from the container when the backend can
+ *   (MapPaged), so launch cost follows the code that runs, not the size of
+ *   the fragment. Data sections are unpacked and relocated at load
+ * - Imported routines are bound lazily: each import's TVector is a stub
+ *   whose code traps into the CFM, which finds the export, loading its
+ *   library if need be, and turns the stub into a copy of the real TVector.
+ *   Later calls never trap. Data imports and weak imports are bound at load,
+ *   since the program can look at those without calling anything
+ * - Clean error handling with OSErr, using the CFM's own codes
+ *
+ * - A fragment's init routine runs once it is loaded and bound, and its
+ *   term routine when the connection is closed, both through the backend's
+ *   CallRoutine
+ *
+ * Not done yet: there is no version checking between importer and library.
+ */
+
+#ifndef CODE_FRAGMENTS_H
+#define CODE_FRAGMENTS_H
+
+#include "SystemTypes.h"
+#include "CPU/CPUBackend.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Code Fragment Manager Error Codes
+ */
+enum {
+    cfragNoSymbolErr         = -2802,  /* export not found */
+    cfragNoSectionErr        = -2803,  /* section index out of range */
+    cfragNoLibraryErr        = -2804,  /* imported library not registered */
+    cfragDupRegistrationErr  = -2805,  /* library name already registered */
+    cfragFragmentFormatErr   = -2806,  /* not a PEF container we can load */
+    cfragUnresolvedErr       = -2807,  /* strong import with no export */
+    cfragNoPrivateMemErr     = -2809,  /* out of CFM bookkeeping */
+    cfragFragmentCorruptErr  = -2820,  /* container inconsistent with itself */
+    cfragInitFunctionErr     = -2821,  /* init routine failed */
+    cfragArchitectureErr     = -2823   /* container is not PowerPC */
+};
+
+/* Address a weak import gets when nothing exports it */
+#define kUnresolvedCFragSymbolAddress  0
+
+/*
+ * Limits
+ */
+#define kCFMMaxFragments    32      /* loaded fragments per context */
+#define kCFMMaxLibraries    32      /* registered libraries per context */
+#define kCFMMaxNameLength   63
+
+/*
+ * The trap the bind glue raises: sc with this in r0. Any number _LoadSeg and
+ * the Toolbox glue do not use.
+ */
+#define kCFMBindTrap        0x00CF
+
+/*
+ * A container, wherever it lies.
+ *
+ * Either mapped - the whole container in host memory, for a library in ROM
+ * or a data fork already read - or streamed through read, for one still in
+ * a file. A mapped container is read in place; a streamed one is read a
+ * section at a time, and code sections only a page at a time as they run.
+ * Either way it has to stay valid as long as the fragment is loaded.
+ */
+typedef OSErr (*CFragReadProc)(void* refCon, UInt32 offset, void* buffer, UInt32 length);
+
+typedef struct CFragContainer {
+    const UInt8* mapped;      /* whole container in host memory, or NULL */
+    UInt32 length;            /* its length in bytes */
+    CFragReadProc read;       /* how to read it when not mapped */
+    void* refCon;             /* passed to read */
+} CFragContainer;
+
+/*
+ * A section of a loaded fragment
+ */
+typedef struct CFragSection {
+    CPUAddr base;             /* where it was instantiated, or 0 */
+    UInt32 totalSize;         /* instantiated size, zero fill included */
+    UInt32 unpackedSize;      /* initialized part */
+    UInt32 containerLength;   /* bytes in the container */
+    UInt32 containerOffset;   /* where, from the start of the container */
+    UInt8 kind;               /* kPEFCodeSection etc. */
+    UInt8 alignment;          /* log2 */
+    Boolean paged;            /* left in the container until touched */
+    struct CFragFragment* frag;  /* owner, for the page-in callback */
+} CFragSection;
+
+/*
+ * A loaded fragment (a connection, in the CFM's own terms: one per address
+ * space, shared by everything in it that imports from the fragment)
+ */
+typedef struct CFragFragment {
+    struct CFragContext* ctx;     /* where it is loaded */
+    char name[kCFMMaxNameLength + 1];
+    UInt16 index;                 /* in ctx->fragments */
+    CFragContainer container;
+
+    UInt16 sectionCount;
+    CFragSection* sections;
+
+    const UInt8* loader;          /* loader section: imports, exports */
+    UInt32 loaderLength;
+    UInt8* loaderBlock;           /* our copy of it, when streamed */
+
+    UInt32 importCount;
+    CPUAddr* imports;             /* what each import resolved to, or its stub */
+    CPUAddr glue;                 /* bind glue, followed by the stub TVectors */
+    UInt32 lazyImports;           /* stubs made */
+    UInt32 lazyBound;             /* stubs bound since */
+
+    CPUAddr mainAddr;             /* main symbol (TVector of main), or 0 */
+    CPUAddr initAddr;             /* init routine's TVector, or 0 */
+    CPUAddr termAddr;             /* term routine's TVector, or 0 */
+    Boolean closed;               /* CFM_CloseConnection has run term */
+} CFragFragment;
+
+/*
+ * A library known by name, loaded the first time something binds to it
+ */
+typedef struct CFragLibrary {
+    char name[kCFMMaxNameLength + 1];
+    CFragContainer container;
+    CFragFragment* frag;          /* once loaded */
+    Boolean loading;              /* being loaded; breaks import cycles */
+} CFragLibrary;
+
+/*
+ * Code Fragment Manager Context (per address space)
+ */
+typedef struct CFragContext {
+    const ICPUBackend* backend;
+    CPUAddressSpace as;
+
+    CFragFragment* fragments[kCFMMaxFragments];
+    UInt16 numFragments;
+
+    CFragLibrary libraries[kCFMMaxLibraries];
+    UInt16 numLibraries;
+
+    Boolean trapInstalled;        /* kCFMBindTrap is ours in this space */
+} CFragContext;
+
+/*
+ * A 'cfrg' resource member - where one fragment of a file is
+ */
+enum {
+    kImportLibraryCFrag     = 0,
+    kApplicationCFrag       = 1,
+    kDropInAdditionCFrag    = 2
+};
+
+enum {
+    kMemoryCFragLocator     = 0,
+    kDataForkCFragLocator   = 1,
+    kResourceCFragLocator   = 2
+};
+
+typedef struct CFragMember {
+    OSType architecture;      /* 'pwpc' */
+    UInt8 usage;              /* kApplicationCFrag etc. */
+    UInt8 where;              /* kDataForkCFragLocator etc. */
+    UInt32 offset;            /* into the fork */
+    UInt32 length;            /* 0: to the end of the fork */
+    UInt32 stackSize;         /* applications: 0 for the default */
+    char name[kCFMMaxNameLength + 1];
+} CFragMember;
+
+/*
+ * Code Fragment Manager Public API
+ */
+
+/*
+ * CFM_CreateContext - Start loading fragments into an address space
+ *
+ * @param backend           CPU backend the address space belongs to
+ * @param as                The address space
+ * @param outCtx            Output context
+ * @return                  OSErr
+ */
+OSErr CFM_CreateContext(const ICPUBackend* backend, CPUAddressSpace as,
+                        CFragContext** outCtx);
+
+/*
+ * CFM_DisposeContext - Free the CFM's own bookkeeping
+ *
+ * The address space is the caller's and is not touched; dispose of it
+ * afterwards, since demand-paged sections still point into this context.
+ */
+void CFM_DisposeContext(CFragContext* ctx);
+
+/*
+ * CFM_RegisterLibrary - Make a library available by name
+ *
+ * Nothing is read until some fragment first binds to the library.
+ *
+ * @param ctx               Context
+ * @param name              Library name, as importers spell it
+ * @param container         Where the library's container is
+ * @return                  OSErr
+ */
+OSErr CFM_RegisterLibrary(CFragContext* ctx, const char* name,
+                          const CFragContainer* container);
+
+/*
+ * CFM_LoadFragment - Load a fragment and prepare its imports
+ *
+ * Every library the fragment imports from has to be registered (or marked
+ * weak). Data and weak imports are bound now; imported routines on first
+ * call. Then the init routine runs, and if it fails so does the load
+ * (cfragInitFunctionErr).
+ *
+ * @param ctx               Context
+ * @param name              Name to give the fragment
+ * @param container         Where its container is
+ * @param outFrag           Output fragment
+ * @return                  OSErr
+ */
+OSErr CFM_LoadFragment(CFragContext* ctx, const char* name,
+                       const CFragContainer* container, CFragFragment** outFrag);
+
+/*
+ * CFM_CloseConnection - Run a fragment's term routine and let it go
+ *
+ * A library closed this way is loaded afresh by the next import from it.
+ * The fragment's record stays with the context until CFM_DisposeContext,
+ * since its paged code and its bind stubs still refer to it, and so does
+ * its memory in the address space; close only what nothing still calls.
+ *
+ * @param frag              Fragment from CFM_LoadFragment
+ * @return                  OSErr (paramErr if already closed)
+ */
+OSErr CFM_CloseConnection(CFragFragment* frag);
+
+/*
+ * CFM_FindSymbol - Address of an export
+ *
+ * @param frag              Fragment exporting it
+ * @param name              Symbol name
+ * @param outAddr           Output address in the CPU address space
+ * @param outClass          Output symbol class (kPEFTVectorSymbol etc.);
+ *                          may be NULL
+ * @return                  OSErr (cfragNoSymbolErr if not exported)
+ */
+OSErr CFM_FindSymbol(CFragFragment* frag, const char* name,
+                     CPUAddr* outAddr, UInt8* outClass);
+
+/*
+ * CFM_FindCFragMember - Find the fragment for an architecture in a 'cfrg'
+ *
+ * @param cfrgData          The 'cfrg' 0 resource
+ * @param size              Its size
+ * @param architecture      'pwpc'
+ * @param out               Output member
+ * @return                  OSErr (cfragNoLibraryErr if there is none)
+ */
+OSErr CFM_FindCFragMember(const void* cfrgData, Size size, OSType architecture,
+                          CFragMember* out);
+
+/*
+ * Container-level routines (PEFLoader.c), exposed for testing
+ */
+
+/* PEF's hash word for a name: length in the top half, hash in the bottom */
+UInt32 PEF_HashWord(const UInt8* name, UInt32 length);
+
+/* Expand pattern-initialized data into dst, which has room for dstLen bytes */
+OSErr PEF_UnpackData(const UInt8* src, UInt32 srcLen, UInt8* dst, UInt32 dstLen);
+
+/*
+ * Run a section's relocation instructions over its instantiated contents.
+ * sectionBases gives every section's address (0 for those not instantiated),
+ * imports every import's.
+ */
+OSErr PEF_Relocate(UInt8* section, UInt32 sectionSize,
+                   const UInt8* instr, UInt32 instrCount,
+                   const CPUAddr* sectionBases, UInt32 sectionCount,
+                   const CPUAddr* imports, UInt32 importCount);
+
+/*
+ * Look an export up in a loader section. outSection is a section index or
+ * kPEFAbsoluteExport/kPEFReexportedImport; outClass may be NULL.
+ */
+OSErr PEF_FindExport(const UInt8* loader, UInt32 loaderLength, const char* name,
+                     UInt32* outValue, SInt16* outSection, UInt8* outClass);
+
+/*
+ * CFM_SelfTest - load a synthetic application and library and run them
+ *
+ * Silent unless something fails.
+ */
+void CFM_SelfTest(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CODE_FRAGMENTS_H */
@@ -0,0 +1,250 @@
+/*
+ * PEFBinaryFormat.h - Preferred Executable Format container layout
+ *
+ * PEF is the container format of PowerPC code fragments: applications (in
+ * the data fork, found through the 'cfrg' resource), shared libraries and
+ * drop-in additions. Everything in it is big-endian. Offsets are given as
+ * byte offsets into each structure, the way CodeParser.h gives CODE
+ * resources, and are read with BE_Read16/BE_Read32 - a container is never
+ * cast to a struct.
+ *
+ * A container is a header, a table of section headers, and the sections'
+ * contents. One section, the loader section, says what the fragment imports
+ * and exports, where its main/init/term routines are, and how each data
+ * section is relocated.
+ */
+
+#ifndef PEF_BINARY_FORMAT_H
+#define PEF_BINARY_FORMAT_H
+
+#include "SystemTypes.h"
+
+/*
+ * Container header (40 bytes)
+ *
+ *   +0   4   tag1            'Joy!'
+ *   +4   4   tag2            'peff'
+ *   +8   4   architecture    'pwpc' (or 'm68k', which we do not load)
+ *   +12  4   formatVersion   1
+ *   +16  4   dateTimeStamp
+ *   +20  4   oldDefVersion
+ *   +24  4   oldImpVersion
+ *   +28  4   currentVersion
+ *   +32  2   sectionCount
+ *   +34  2   instSectionCount
+ *   +36  4   reservedA
+ */
+#define kPEFTag1                    'Joy!'
+#define kPEFTag2                    'peff'
+#define kPEFPowerPCArch             'pwpc'
+#define kPEFVersion                 1
+
+#define PEF_HDR_TAG1                0
+#define PEF_HDR_TAG2                4
+#define PEF_HDR_ARCH                8
+#define PEF_HDR_FORMAT_VERSION      12
+#define PEF_HDR_SECTION_COUNT       32
+#define PEF_HDR_INST_SECTION_COUNT  34
+#define PEF_CONTAINER_HEADER_SIZE   40
+
+/*
+ * Section header (28 bytes), sectionCount of them after the container header
+ *
+ *   +0   4   nameOffset      into the section name table, or -1
+ *   +4   4   defaultAddress  preferred address; we relocate regardless
+ *   +8   4   totalSize       size once instantiated, zero fill included
+ *   +12  4   unpackedSize    size of the initialized part
+ *   +16  4   containerLength bytes in the container
+ *   +20  4   containerOffset from the start of the container
+ *   +24  1   sectionKind
+ *   +25  1   shareKind
+ *   +26  1   alignment       log2 of the section's alignment
+ *   +27  1   reservedA
+ */
+#define PEF_SEC_TOTAL_SIZE          8
+#define PEF_SEC_UNPACKED_SIZE       12
+#define PEF_SEC_CONTAINER_LENGTH    16
+#define PEF_SEC_CONTAINER_OFFSET    20
+#define PEF_SEC_KIND                24
+#define PEF_SEC_SHARE_KIND          25
+#define PEF_SEC_ALIGNMENT           26
+#define PEF_SECTION_HEADER_SIZE     28
+
+enum {
+    kPEFCodeSection          = 0,   /* read-only code */
+    kPEFUnpackedDataSection  = 1,   /* data, stored as is */
+    kPEFPatternDataSection   = 2,   /* data, pattern-initialized (packed) */
+    kPEFConstantSection      = 3,   /* read-only data */
+    kPEFLoaderSection        = 4,   /* imports, exports, relocations */
+    kPEFDebugSection         = 5,   /* not instantiated */
+    kPEFExecDataSection      = 6,   /* code and data at once */
+    kPEFExceptionSection     = 7,   /* not instantiated */
+    kPEFTracebackSection     = 8    /* not instantiated */
+};
+
+/*
+ * Loader section header (56 bytes), at the start of the loader section
+ *
+ *   +0   4   mainSection     section of the main symbol, or -1
+ *   +4   4   mainOffset
+ *   +8   4   initSection     section of the init routine's TVector, or -1
+ *   +12  4   initOffset
+ *   +16  4   termSection
+ *   +20  4   termOffset
+ *   +24  4   importedLibraryCount
+ *   +28  4   totalImportedSymbolCount
+ *   +32  4   relocSectionCount
+ *   +36  4   relocInstrOffset      from the start of the loader section
+ *   +40  4   loaderStringsOffset   likewise
+ *   +44  4   exportHashOffset      likewise
+ *   +48  4   exportHashTablePower  the hash table has 2^power slots
+ *   +52  4   exportedSymbolCount
+ *
+ * Then, in order: the imported library table, the imported symbol table and
+ * the relocation headers. The relocation instructions, the string table and
+ * the export hash table are where the offsets above say.
+ */
+#define PEF_LDR_MAIN_SECTION        0
+#define PEF_LDR_MAIN_OFFSET         4
+#define PEF_LDR_INIT_SECTION        8
+#define PEF_LDR_INIT_OFFSET         12
+#define PEF_LDR_TERM_SECTION        16
+#define PEF_LDR_TERM_OFFSET         20
+#define PEF_LDR_LIBRARY_COUNT       24
+#define PEF_LDR_IMPORT_COUNT        28
+#define PEF_LDR_RELOC_SECTION_COUNT 32
+#define PEF_LDR_RELOC_INSTR_OFFSET  36
+#define PEF_LDR_STRINGS_OFFSET      40
+#define PEF_LDR_HASH_OFFSET         44
+#define PEF_LDR_HASH_POWER          48
+#define PEF_LDR_EXPORT_COUNT        52
+#define PEF_LOADER_HEADER_SIZE      56
+
+/*
+ * Imported library (24 bytes)
+ *
+ *   +0   4   nameOffset          into the loader strings, NUL-terminated
+ *   +4   4   oldImpVersion
+ *   +8   4   currentVersion
+ *   +12  4   importedSymbolCount
+ *   +16  4   firstImportedSymbol index into the imported symbol table
+ *   +20  1   options
+ *   +21  3   reserved
+ */
+#define PEF_LIB_NAME_OFFSET         0
+#define PEF_LIB_SYMBOL_COUNT        12
+#define PEF_LIB_FIRST_SYMBOL        16
+#define PEF_LIB_OPTIONS             20
+#define PEF_IMPORTED_LIBRARY_SIZE   24
+
+#define kPEFWeakImportLibMask       0x40    /* whole library may be absent */
+#define kPEFInitLibBeforeMask       0x80
+
+/*
+ * Imported symbol (4 bytes): class in the top byte, the name's offset into
+ * the loader strings in the other three. The name is NUL-terminated.
+ */
+#define PEF_IMPORTED_SYMBOL_SIZE    4
+#define kPEFWeakImportSymMask       0x80    /* in the class byte */
+
+/*
+ * Symbol classes, in the low four bits of an imported or exported symbol's
+ * class byte.
+ */
+enum {
+    kPEFCodeSymbol       = 0x00,    /* address of code */
+    kPEFDataSymbol       = 0x01,    /* address of data */
+    kPEFTVectorSymbol    = 0x02,    /* address of a transition vector */
+    kPEFTOCSymbol        = 0x03,
+    kPEFGlueSymbol       = 0x04,
+    kPEFUndefinedSymbol  = 0x0F
+};
+
+#define PEF_SYMBOL_CLASS(word)      (((word) >> 24) & 0x0F)
+#define PEF_SYMBOL_FLAGS(word)      (((word) >> 24) & 0xF0)
+#define PEF_SYMBOL_NAME(word)       ((word) & 0x00FFFFFF)
+
+/*
+ * Relocation header (12 bytes), one per relocated section
+ *
+ *   +0   2   sectionIndex
+ *   +2   2   reservedA
+ *   +4   4   relocCount        in 16-bit units
+ *   +8   4   firstRelocOffset  from relocInstrOffset
+ */
+#define PEF_RELOC_SECTION_INDEX     0
+#define PEF_RELOC_COUNT             4
+#define PEF_RELOC_FIRST_OFFSET      8
+#define PEF_RELOC_HEADER_SIZE       12
+
+/*
+ * Relocation opcodes: the top seven bits of an instruction, after masking
+ * off operand bits where the opcode is shorter than that.
+ */
+enum {
+    kPEFRelocBySectDWithSkip  = 0x00,   /* 00xxxxx */
+    kPEFRelocBySectC          = 0x20,   /* 0100000, the RelocRun group */
+    kPEFRelocBySectD          = 0x21,
+    kPEFRelocTVector12        = 0x22,
+    kPEFRelocTVector8         = 0x23,
+    kPEFRelocVTable8          = 0x24,
+    kPEFRelocImportRun        = 0x25,
+    kPEFRelocSmByImport       = 0x30,   /* 0110000, the RelocSmIndex group */
+    kPEFRelocSmSetSectC       = 0x31,
+    kPEFRelocSmSetSectD       = 0x32,
+    kPEFRelocSmBySection      = 0x33,
+    kPEFRelocIncrPosition     = 0x40,   /* 1000xxx */
+    kPEFRelocSmRepeat         = 0x48,   /* 1001xxx */
+    kPEFRelocSetPosition      = 0x50,   /* 101000x */
+    kPEFRelocLgByImport       = 0x52,   /* 101001x */
+    kPEFRelocLgRepeat         = 0x58,   /* 101100x */
+    kPEFRelocLgSetOrBySection = 0x5A    /* 101101x */
+};
+
+enum {
+    kPEFRelocLgBySectionSubopcode  = 0,
+    kPEFRelocLgSetSectCSubopcode   = 1,
+    kPEFRelocLgSetSectDSubopcode   = 2
+};
+
+/*
+ * Pattern-initialized data opcodes: top three bits of each opcode byte. The
+ * low five are a count; zero means the count follows as an argument.
+ * Arguments are big-endian, seven bits to a byte, the top bit set on every
+ * byte but the last.
+ */
+enum {
+    kPEFPkDataZero         = 0,     /* count zero bytes */
+    kPEFPkDataBlock        = 1,     /* count raw bytes */
+    kPEFPkDataRepeat       = 2,     /* a count-byte block, repeatCount+1 times */
+    kPEFPkDataRepeatBlock  = 3,     /* common, then (custom, common) x N */
+    kPEFPkDataRepeatZero   = 4      /* zeros, then (custom, zeros) x N */
+};
+
+/*
+ * Export hash table: 2^exportHashTablePower 4-byte slots, each a chain
+ * count (top 14 bits) and the index of the chain's first export (low 18).
+ * Then one 4-byte key per export - name length in the top half, 16-bit hash
+ * in the bottom - and then the exports themselves, 10 bytes each:
+ *
+ *   +0   4   class and name offset, as for imports; the name is not
+ *            NUL-terminated, its length is in the key
+ *   +4   4   symbolValue       offset into the section
+ *   +8   2   sectionIndex      or one of the special values below
+ */
+#define PEF_HASH_SLOT_SIZE          4
+#define PEF_EXPORT_KEY_SIZE         4
+#define PEF_EXPORTED_SYMBOL_SIZE    10
+#define PEF_EXPORT_VALUE            4
+#define PEF_EXPORT_SECTION          8
+
+#define PEF_HASH_CHAIN_COUNT(slot)  ((slot) >> 18)
+#define PEF_HASH_FIRST_INDEX(slot)  ((slot) & 0x3FFFF)
+#define PEF_HASH_LENGTH(key)        ((key) >> 16)
+
+enum {
+    kPEFAbsoluteExport    = -2,     /* symbolValue is the address */
+    kPEFReexportedImport  = -3      /* symbolValue is an import's index */
+};
+
+#endif /* PEF_BINARY_FORMAT_H */
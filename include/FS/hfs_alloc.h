@@ -0,0 +1,21 @@
+/* HFS Volume Bitmap Allocation */
+#pragma once
+#include "hfs_types.h"
+#include "hfs_volume.h"
+#include <stdbool.h>
+
+/* No preferred starting block: search from the roving allocation pointer */
+#define kHFSAllocAnywhere 0xFFFF
+
+/*
+ * Allocate a run of up to count free allocation blocks. If goal is free
+ * the run starts there, so a fork or B-tree file that asks for the block
+ * after its last extent grows that extent instead of starting another;
+ * otherwise it is the first run of count blocks after drAllocPtr, or the
+ * longest run there is. *run can be shorter than count - ask again for the
+ * rest. False when the volume is full or read-only.
+ */
+bool HFS_AllocBlocks(HFS_Volume* vol, uint16_t goal, uint16_t count, HFS_Extent* run);
+
+/* Return count blocks starting at start to the free pool */
+bool HFS_FreeBlocks(HFS_Volume* vol, uint16_t start, uint16_t count);
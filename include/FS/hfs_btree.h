@@ -23,7 +23,10 @@ typedef struct {
     uint32_t     firstLeaf;     /* First leaf node */
     uint32_t     lastLeaf;      /* Last leaf node */
     uint32_t     totalNodes;    /* Total number of nodes */
+    uint32_t     freeNodes;     /* Nodes not in use */
+    uint32_t     leafRecords;   /* Records in the leaves */
     uint16_t     treeDepth;     /* Tree depth */
+    bool         writeReady;    /* header and map checked for writing */
 
     /* Node buffer for operations */
     void*        nodeBuffer;    /* Buffer for reading nodes */
@@ -53,6 +56,33 @@ typedef bool (*HFS_BT_IteratorFunc)(void* key, uint16_t keyLen,
 
 bool HFS_BT_IterateLeaves(HFS_BTree* bt, HFS_BT_IteratorFunc func, void* context);
 
+/* Split a leaf record into key and data (the key is at record) */
+bool HFS_BT_SplitRecord(const HFS_BTree* bt, void* record, uint16_t recordLen,
+                        void** data, uint16_t* dataLen);
+
+/* Descend to the leaf holding key. Leaves the leaf in nodeBuffer (nodeSize
+ * bytes); *recordIndex is the matching record if *exact, else the first
+ * record with a greater key (numRecords: it is in the next leaf). */
+bool HFS_BT_Seek(HFS_BTree* bt, const void* key, void* nodeBuffer,
+                 uint32_t* leafNode, uint16_t* recordIndex, bool* exact);
+
+/*
+ * Writing. Each call leaves the tree consistent on the volume's block
+ * device - nodes, header and map - and the volume's B-tree file extents in
+ * vol, for HFS_VolumeFlush to put in the MDB. Keys are the on-disk key
+ * with its length byte; records go in with their data word-aligned.
+ */
+
+/* Add a leaf record; false if the key is already there or there is no room */
+bool HFS_BT_InsertRecord(HFS_BTree* bt, const void* key, const void* data, uint16_t dataLen);
+
+/* Remove the leaf record filed under key */
+bool HFS_BT_DeleteRecord(HFS_BTree* bt, const void* key);
+
+/* Replace the leaf record filed under key, key included - so a catalog
+ * name can change case in place; false if there is none */
+bool HFS_BT_ReplaceRecord(HFS_BTree* bt, const void* key, const void* data, uint16_t dataLen);
+
 /* Key comparison functions */
 int HFS_CompareCatalogKeys(const void* key1, const void* key2);
 int HFS_CompareExtentsKeys(const void* key1, const void* key2);
\ No newline at end of file
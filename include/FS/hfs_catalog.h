@@ -27,6 +27,33 @@ bool HFS_CatalogLookup(HFS_Catalog* cat, DirID parentID, const char* name,
 /* Get entry by CNID */
 bool HFS_CatalogGetByID(HFS_Catalog* cat, FileID cnid, CatEntry* entry);
 
+/* Copy the raw file or folder record for cnid (up to size bytes) found
+ * through its thread record; false if it has none */
+bool HFS_CatalogGetRecord(HFS_Catalog* cat, FileID cnid, void* record, uint16_t size);
+
+/*
+ * Changing the catalog. Each keeps the thread record, the parent folder's
+ * valence and the MDB's file and folder counts in step with the change;
+ * HFS_VolumeFlush writes the counts. A file's forks are HFS_FileWriteData's
+ * and HFS_FileDelete's business, not these.
+ */
+
+/* Add a file or folder record, entry->id already assigned, under
+ * entry->parent and entry->name; false if the name is taken */
+bool HFS_CatalogCreate(HFS_Catalog* cat, const CatEntry* entry);
+
+/* Remove a file or an empty folder */
+bool HFS_CatalogDelete(HFS_Catalog* cat, FileID cnid);
+
+/* Refile cnid under newParent, renamed to newName unless that is NULL */
+bool HFS_CatalogMove(HFS_Catalog* cat, FileID cnid, DirID newParent, const char* newName);
+
+/* Type, creator, Finder flags and dates from entry, for entry->id */
+bool HFS_CatalogSetInfo(HFS_Catalog* cat, const CatEntry* entry);
+
+/* Replace cnid's file or folder record with record (same record type) */
+bool HFS_CatalogPutRecord(HFS_Catalog* cat, FileID cnid, const void* record, uint16_t size);
+
 /* Convert MacRoman to ASCII */
 void HFS_MacRomanToASCII(char* dst, const uint8_t* src, uint8_t len, size_t maxDst);
 
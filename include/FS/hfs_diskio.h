@@ -49,4 +49,39 @@ bool HFS_BD_ReadSector(HFS_BlockDev* bd, uint32_t sector, void* buffer);
 bool HFS_BD_WriteSector(HFS_BlockDev* bd, uint32_t sector, const void* buffer);
 
 /* Flush any cached writes */
-bool HFS_BD_Flush(HFS_BlockDev* bd);
\ No newline at end of file
+bool HFS_BD_Flush(HFS_BlockDev* bd);
+/* Whole-sector device transfers, uncached (ATA and SDHCI devices only).
+ * Used by the block cache; everything else goes through HFS_BD_Read/Write. */
+bool HFS_BD_ReadSectors(const HFS_BlockDev* bd, uint64_t sector, uint32_t count, void* buffer);
+bool HFS_BD_WriteSectors(const HFS_BlockDev* bd, uint64_t sector, uint32_t count, const void* buffer);
+
+/*
+ * Block buffer cache (hfs_blockcache.c)
+ *
+ * ATA and SDHCI transfers are served from a write-back cache of 4 KB
+ * blocks keyed by (device, block), HFS_BLOCK_CACHE_KB in all. Memory and
+ * file devices are not cached. HFS_BD_Read/HFS_BD_Write/HFS_BD_Flush/
+ * HFS_BD_Close call these; nothing else should need to.
+ */
+typedef struct {
+    uint32_t hits;          /* block lookups found in the cache */
+    uint32_t misses;        /* lookups that took a slot */
+    uint32_t evictions;     /* blocks dropped to make room */
+    uint32_t writebacks;    /* dirty blocks written to the device */
+    uint32_t bypassed;      /* blocks moved directly by long aligned transfers */
+    uint32_t blocks;        /* blocks holding data */
+    uint32_t dirty;         /* of which not yet on the device */
+    uint32_t capacity;      /* cache slots (0 until the first disk access) */
+    uint32_t blockSize;
+} HFS_BlockCacheStats;
+
+bool HFS_BC_Read(const HFS_BlockDev* bd, uint64_t offset, void* buffer, uint32_t length);
+bool HFS_BC_Write(const HFS_BlockDev* bd, uint64_t offset, const void* buffer, uint32_t length);
+
+/* Write back the device's dirty blocks, in block order */
+bool HFS_BC_Flush(const HFS_BlockDev* bd);
+
+/* Drop the device's blocks, dirty or not (flush first) */
+void HFS_BC_Invalidate(const HFS_BlockDev* bd);
+
+void HFS_BD_GetCacheStats(HFS_BlockCacheStats* stats);
@@ -35,4 +35,12 @@ bool HFS_FileSeek(HFSFile* file, uint32_t position);
 uint32_t HFS_FileGetSize(HFSFile* file);
 
 /* Get current position */
-uint32_t HFS_FileTell(HFSFile* file);
\ No newline at end of file
+uint32_t HFS_FileTell(HFSFile* file);
+
+/* Replace a fork's contents with size bytes of data. The old blocks are
+ * freed once the catalog points at the new ones. */
+bool HFS_FileWriteData(HFS_Catalog* cat, FileID id, bool resourceFork,
+                       const void* data, uint32_t size);
+
+/* Remove a file from the catalog and free both its forks */
+bool HFS_FileDelete(HFS_Catalog* cat, FileID id);
@@ -33,6 +33,10 @@ typedef struct {
     uint32_t    nextCNID;     /* Next available CNID */
     bool        mounted;      /* Is volume mounted */
     VRefNum     vRefNum;      /* Volume reference number */
+
+    /* Write state */
+    bool        mdbDirty;     /* mdb counts changed since the last HFS_VolumeFlush */
+    bool        freeCounted;  /* drFreeBks checked against the bitmap */
 } HFS_Volume;
 
 /* Mount an HFS volume from a disk image */
@@ -41,6 +45,16 @@ bool HFS_VolumeMount(HFS_Volume* vol, const char* imagePath, VRefNum vRefNum);
 /* Mount an HFS volume from memory */
 bool HFS_VolumeMountMemory(HFS_Volume* vol, void* buffer, uint64_t size, VRefNum vRefNum);
 
+/* Fill vol->mdb and the cached volume parameters from the MDB sector */
+void HFS_VolumeParseMDB(HFS_Volume* vol, const uint8_t* mdbSector);
+
+/* Write the changing MDB fields - counts, free blocks, next CNID and the
+ * B-tree files' extents - back to sector 2 */
+bool HFS_VolumeWriteMDB(HFS_Volume* vol);
+
+/* Write the MDB if it changed, then flush the device's cached blocks */
+bool HFS_VolumeFlush(HFS_Volume* vol);
+
 /* Unmount an HFS volume */
 void HFS_VolumeUnmount(HFS_Volume* vol);
 
@@ -61,6 +61,13 @@ bool VFS_SeekFile(VFSFile* file, uint32_t position);
 uint32_t VFS_GetFileSize(VFSFile* file);
 uint32_t VFS_GetFilePosition(VFSFile* file);
 
+/* Write the overlay's changes to a volume's catalog and blocks. True when
+ * nothing is left in the overlay. */
+bool VFS_Sync(VRefNum vref);
+
+/* Call from the idle loop: syncs every mounted volume every two seconds */
+void VFS_Idle(void);
+
 /* Write operations (overlay-based, in-memory mutations) */
 bool VFS_CreateFolder(VRefNum vref, DirID parent, const char* name, DirID* newID);
 bool VFS_CreateFile(VRefNum vref, DirID parent, const char* name,
@@ -0,0 +1,44 @@
+/* VFS catalog name and CNID cache */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "FS/hfs_types.h"
+
+/*
+ * Remembers what the HFS catalog answered, by (volume, parent, name) and by
+ * (volume, CNID), so repeated path resolution and VFS_GetByID calls do not
+ * descend the catalog B-tree again. It holds catalog records only: the
+ * overlay is consulted before it, exactly as before. Entries are dropped
+ * per directory by VFS_DirectoryChanged, per item by overlay mutations and
+ * by the sync's catalog writes (the item and the folders whose valence it
+ * changed), and per volume on mount and unmount.
+ */
+
+typedef struct {
+    uint32_t nameHits;
+    uint32_t nameMisses;
+    uint32_t idHits;
+    uint32_t idMisses;
+    uint32_t inserts;
+    uint32_t evictions;     /* dropped for room */
+    uint32_t invalidations; /* dropped because something changed */
+    uint32_t entries;
+    uint32_t capacity;
+} VFSNameCacheStats;
+
+bool VFS_NameCacheLookup(VRefNum vref, DirID parent, const char* name, CatEntry* entry);
+bool VFS_NameCacheGetByID(VRefNum vref, FileID id, CatEntry* entry);
+
+/* Remember a catalog entry. name is what it was looked up by, and the name
+ * it will be found under; NULL files it by CNID only. */
+void VFS_NameCacheInsert(VRefNum vref, const char* name, const CatEntry* entry);
+
+/* Forget everything filed under parent, one item, or a whole volume */
+void VFS_NameCacheForgetDir(VRefNum vref, DirID parent);
+void VFS_NameCacheForgetID(VRefNum vref, FileID id);
+void VFS_NameCacheForgetVolume(VRefNum vref);
+
+void VFS_GetNameCacheStats(VFSNameCacheStats* stats);
+
+/* Boot-time check of the cache against what it was told; silent unless it fails */
+void VFS_NameCacheSelfTest(void);
@@ -10,6 +10,7 @@
 
 #include "SystemTypes.h"
 #include "FontTypes.h"
+#include "TrueTypeRaster.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -76,6 +77,33 @@ void FM_OptimizeCacheMemory(void);
 void FM_DumpCacheInfo(void);
 void FM_ValidateCache(void);
 
+/* Outline glyph cache (OutlineGlyphCache.c)
+ *
+ * TrueType coverage bitmaps, rasterized once per (font, size, glyph) and
+ * kept in the system heap under an LRU byte budget. The bitmap returned
+ * stays valid until the next FM_GetOutlineGlyph call that misses, or a
+ * flush of its font. */
+typedef struct OutlineCacheStats {
+    UInt32  hits;
+    UInt32  misses;
+    UInt32  evictions;
+    UInt32  uncached;       /* glyphs that failed to rasterize or fit */
+    UInt32  glyphs;         /* bitmaps held now */
+    UInt32  bytes;          /* bitmap bytes held now */
+    UInt32  budget;
+} OutlineCacheStats;
+
+const FMGlyphBitmap* FM_GetOutlineGlyph(const FMOutlineFont* font, short size, UInt16 glyph);
+void FM_FlushOutlineGlyphs(const FMOutlineFont* font);     /* NULL: every font */
+void FM_GetOutlineCacheStats(OutlineCacheStats* stats);
+
+/* Coverage of a synthetic square against known values; run from
+ * InitFonts, silent unless it fails */
+void FM_OutlineSelfTest(void);
+
+/* Rasterizer and cache throughput on the serial console. FONT_BENCHMARK=1. */
+void FontManager_OutlineBenchmark(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -55,7 +55,8 @@ enum {
 /* Font Error Codes */
 enum {
     fontNotFoundErr = -4960,
-    fontCacheFullErr = -4961
+    fontCacheFullErr = -4961,
+    fontCorruptErr = -4962         /* malformed 'sfnt' table or glyph */
 };
 
 /* Font Manager State - Global state for the Font Manager */
@@ -0,0 +1,66 @@
+/*
+ * TrueTypeRaster.h - TrueType outline rasterizer
+ *
+ * Reads glyph outlines straight out of an in-memory 'sfnt' and renders
+ * them as 8-bit coverage (anti-aliased) bitmaps. Coverage bitmaps are
+ * normally obtained through the outline glyph cache in FontCache.h,
+ * which rasterizes each (font, size, glyph) once.
+ */
+
+#ifndef TRUETYPE_RASTER_H
+#define TRUETYPE_RASTER_H
+
+#include "SystemTypes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* An opened 'sfnt'. The font data is borrowed, not copied: it has to stay
+ * put (locked, or a Ptr) until FM_CloseOutlineFont. Offsets are from the
+ * start of the data; a zero offset means the table is absent. */
+typedef struct FMOutlineFont {
+    const UInt8*  data;
+    UInt32        length;
+    UInt32        glyf, glyfLength;
+    UInt32        loca, locaLength;
+    UInt32        hmtx, hmtxLength;
+    UInt32        cmap4, cmap4Length;   /* Unicode format 4 subtable */
+    UInt16        unitsPerEm;
+    UInt16        numGlyphs;
+    UInt16        numHMetrics;
+    SInt16        locaLong;             /* head.indexToLocFormat */
+    SInt16        ascender;             /* hhea, font units */
+    SInt16        descender;
+} FMOutlineFont;
+
+/* A rasterized glyph: one coverage byte per pixel, 0 (clear) to 255
+ * (solid), top row first. Blank glyphs (space) have no pixels but still
+ * carry their advance. */
+typedef struct FMGlyphBitmap {
+    SInt16  width;
+    SInt16  height;
+    SInt16  left;            /* pen position to the bitmap's left edge */
+    SInt16  top;             /* baseline to the bitmap's top row, up positive */
+    SInt16  advance;         /* pen advance, pixels */
+    UInt8   coverage[1];
+} FMGlyphBitmap;
+
+/* Largest pixels-per-em the rasterizer accepts */
+#define kFMOutlineMaxSize   255
+
+OSErr   FM_OpenOutlineFont(const void* sfnt, UInt32 length, FMOutlineFont* font);
+void    FM_CloseOutlineFont(FMOutlineFont* font);
+UInt16  FM_OutlineGlyphIndex(const FMOutlineFont* font, UInt16 unicode);
+UInt16  FM_OutlineCharGlyph(const FMOutlineFont* font, UInt8 ch);    /* Mac Roman */
+
+/* Rasterize glyph at size pixels per em into a new NewPtr block, which
+ * the caller disposes. Uncached: use FM_GetOutlineGlyph. */
+OSErr   FM_RasterizeOutlineGlyph(const FMOutlineFont* font, UInt16 glyph, short size,
+                                 FMGlyphBitmap** bitmap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRUETYPE_RASTER_H */
@@ -19,7 +19,8 @@ enum {
     BF_HANDLE    = 1<<2,       /* Relocatable (Handle) data block */
     BF_LOCKED    = 1<<3,       /* Handle data pinned */
     BF_PURGEABLE = 1<<4,       /* Handle can be discarded */
-    BF_RESOURCE  = 1<<5        /* Resource handle */
+    BF_RESOURCE  = 1<<5,       /* Resource handle */
+    BF_SLAB      = 1<<6        /* A slab, or a small block carved from one */
 };
 
 /* Block header - precedes every allocation */
@@ -44,6 +45,28 @@ typedef struct FreeNode {
 /* Size class configuration for segregated freelists */
 #define NUM_SIZE_CLASSES 8
 
+/* Slab caches for small blocks, one per size class (see MemoryManager.c) */
+#define NUM_SLAB_CLASSES 6
+
+struct Slab;
+typedef struct SlabCache {
+    struct Slab* partial;       /* slabs with at least one free object */
+    struct Slab* spare;         /* one wholly free slab kept back, or NULL */
+    u32          slabs;         /* slabs this class holds, spare included */
+} SlabCache;
+
+/* Per-zone counters, kept all the time; MemoryManager_Snapshot reports them */
+typedef struct HeapStats {
+    u32 allocs[NUM_SIZE_CLASSES];   /* NewPtr/NewHandle, by block size class */
+    u32 frees[NUM_SIZE_CLASSES];    /* DisposePtr/DisposeHandle/EmptyHandle */
+    u32 allocFailures;              /* Requests that came back NULL */
+    u32 compactions;                /* CompactMem calls that had to do anything */
+    u32 compactBytesMoved;          /* ...and the bytes they moved */
+    u32 idleBytesMoved;             /* Bytes moved by MemoryManager_IdleCompact */
+    u32 purges;                     /* Handles purged */
+    u32 purgedBytes;
+} HeapStats;
+
 /* Extended zone info for our implementation */
 typedef struct ZoneInfo {
     u8*         base;           /* Start of zone memory */
@@ -54,6 +77,9 @@ typedef struct ZoneInfo {
      * [4] 513-1KB, [5] 1KB-2KB, [6] 2KB-4KB, [7] 4KB+ */
     FreeNode*   freelists[NUM_SIZE_CLASSES];
 
+    /* Slab caches: [0] up to 32B with header, then 48, 64, 96, 128, 192 */
+    SlabCache   slabs[NUM_SLAB_CLASSES];
+
     u32         bytesUsed;      /* Bytes allocated */
     u32         bytesFree;      /* Bytes available */
 
@@ -66,6 +92,13 @@ typedef struct ZoneInfo {
     UInt32      m68kBase;       /* Base address in M68K space */
     UInt32      m68kLimit;      /* End (exclusive) in M68K space */
 
+    /* Idle compaction (MemoryManager_IdleCompact) */
+    u32         compactCursor;  /* Offset from base where the next slice starts */
+    bool        compactPending; /* CompactMem has had to run; tidy up when idle */
+    bool        compactMovedThisPass;
+
+    HeapStats   stats;
+
     /* Zone info */
     char        name[32];       /* Zone name */
     bool        growable;       /* Can zone grow? */
@@ -111,6 +144,7 @@ u32     FreeMem(void);
 u32     HeapUsed(void);
 u32     MaxMem(void);
 u32     CompactMem(u32 cbNeeded);
+u32     MemoryManager_IdleCompact(u32 maxBytes);  /* One bounded slice; bytes moved */
 void    PurgeMem(u32 cbNeeded);
 
 /* Memory utility functions */
@@ -148,4 +182,29 @@ void    CheckHeap(ZoneInfo* zone);
 void    DumpHeap(ZoneInfo* zone);
 void    MemoryManager_CheckSuspectBlock(const char* tag);
 
+/*
+ * Heap telemetry snapshot: every zone's HeapStats plus its largest free block
+ * and fragmentation, and - built with MEMORY_PROFILE=1 - allocations counted
+ * by the address they were called from. Packed little-endian; the layout is
+ * in MemoryManager.c and scripts/heapsnap.py decodes it. Returns the size the
+ * snapshot needs and writes it only if cap is at least that.
+ */
+#define MM_PROFILE_SITES      256
+#define MM_SNAPSHOT_HEADER    16
+#define MM_SNAPSHOT_ZONE      (28 + 8 * NUM_SIZE_CLASSES + 24)
+#define MM_SNAPSHOT_SITE      16
+#define MM_SNAPSHOT_MAX       (MM_SNAPSHOT_HEADER + 2 * MM_SNAPSHOT_ZONE + \
+                               (MM_PROFILE_SITES + 1) * MM_SNAPSHOT_SITE)
+
+u32     MemoryManager_Snapshot(u8* buf, u32 cap);
+void    MemoryManager_DumpSnapshot(void);   /* As hex lines on the serial console */
+
+/* Slab, compaction and telemetry self-test, run by InitMemoryManager.
+ * Silent unless it fails. */
+void    MemoryManager_SelfTest(void);
+
+/* NewPtr/NewHandle latency percentiles, slabs off and on, on the serial
+ * console. MEMORY_BENCHMARK=1. */
+void    MemoryManager_Benchmark(void);
+
 #endif /* MEMORY_MANAGER_H */
@@ -28,6 +28,44 @@ Boolean ClipLineToRegion(Point* p1, Point* p2, RgnHandle rgn);
 Boolean ClipRectToRegion(Rect *rect, RgnHandle clipRgn, Rect *clippedRect);
 RgnHandle IntersectRegionWithRect(RgnHandle rgn, const Rect* rect);
 
+/*
+ * Region span iteration: the area common to up to three regions (NULL for
+ * any not wanted) within a rectangle, a band at a time - a run of rows that
+ * all have the same sorted, disjoint x-intervals. Drawing clipped this way
+ * costs a band and a few spans instead of a PtInRgn per pixel.
+ *
+ *     RgnSpanIter it;
+ *     RgnSpanBegin(&it, &r, port->visRgn, port->clipRgn, maskRgn, false);
+ *     while (RgnSpanNext(&it))
+ *         rows it.top..it.bottom-1, x in it.spans[i].left..right-1
+ *
+ * bottomUp visits the bands from the bottom, for copies within one bitmap.
+ * The regions must not change while the iteration runs. A band with more
+ * than kRgnSpanMax spans has the last ones joined, covering the gaps.
+ */
+#define kRgnSpanMax 256
+
+typedef struct RgnSpan {
+    SInt16 left, right;
+} RgnSpan;
+
+typedef struct RgnSpanIter {
+    RgnHandle   rgns[3];
+    SInt16      rgnCount;
+    Rect        bounds;
+    SInt16      y;              /* Next row down, or the row above the next going up */
+    Boolean     bottomUp;
+    SInt16      top, bottom;    /* The current band */
+    SInt16      count;
+    RgnSpan     spans[kRgnSpanMax];
+    RgnSpan     rowSpans[kRgnSpanMax];
+    RgnSpan     scratch[kRgnSpanMax];
+} RgnSpanIter;
+
+void RgnSpanBegin(RgnSpanIter* it, const Rect* bounds, RgnHandle a, RgnHandle b,
+                  RgnHandle c, Boolean bottomUp);
+Boolean RgnSpanNext(RgnSpanIter* it);
+
 /* Coordinates */
 Point CalculateArcPoint(const Rect *bounds, SInt16 angle);
 Rect CalculateArcBounds(const Rect *bounds, SInt16 startAngle, SInt16 arcAngle);
@@ -52,4 +90,16 @@ void LocalToGlobalWindow(WindowPtr window, Point *pt);
 /* Invert tracking */
 void QD_GetLastInvertRect(short* left, short* right);
 
+/* CopyBits span kernels against the per-pixel path; run by InitGraf, silent
+ * unless it fails */
+void QuickDraw_BlitSelfTest(void);
+
+/* Banded region set operations against bitmaps; run by InitGraf, silent
+ * unless it fails */
+void QuickDraw_RegionSelfTest(void);
+
+/* CopyBits per-pixel path against the span kernels, on the serial console.
+ * QUICKDRAW_BENCHMARK=1. */
+void QuickDraw_BlitBenchmark(void);
+
 #endif /* QUICKDRAW_INTERNAL_H */
@@ -17,6 +17,7 @@ extern "C" {
 
 /* Forward declarations */
 struct FontStrike;
+struct FMGlyphBitmap;
 
 /* Platform-specific pixel format definitions */
 
@@ -43,6 +44,37 @@ void QDPlatform_UnlockFramebuffer(PlatformFramebuffer* fb);
 void QDPlatform_UpdateScreen(SInt32 left, SInt32 top, SInt32 right, SInt32 bottom);
 void QDPlatform_FlushScreen(void);
 
+/* Frame presentation (ScreenPresent.c)
+ *
+ * Drawing marks the screen pixels it changes; once per frame the marked
+ * rectangles are presented. With QD_DOUBLE_BUFFER=1 QuickDraw draws into a
+ * back buffer (the "framebuffer" global points at it) and presenting copies
+ * the marked rectangles to the scanout buffer the display reads. */
+typedef struct QDPresentStats {
+    UInt32  frames;          /* frames presented */
+    UInt32  coalesced;       /* present requests folded into a later frame */
+    UInt32  sweeps;          /* whole-screen safety presents (kPresentSweepUs) */
+    UInt32  rects;           /* dirty rectangles presented, all frames */
+    UInt32  kbCopied;        /* kilobytes copied to the scanout buffer */
+    UInt32  lastFrameUs;     /* time between the last two frames */
+    UInt32  minFrameUs;
+    UInt32  maxFrameUs;
+    UInt32  avgFrameUs;      /* running average, 1/16 weight per frame */
+    UInt32  lastPresentUs;   /* time the last present took */
+    UInt32  maxPresentUs;
+    UInt32  waitUs;          /* total time spent waiting for a frame slot */
+    Boolean doubleBuffered;
+} QDPresentStats;
+
+void    QDPresent_Init(void);
+void    QDPresent_MarkDirty(SInt32 left, SInt32 top, SInt32 right, SInt32 bottom);
+void    QDPresent_MarkPixels(const void* firstPixel, SInt32 width, SInt32 height);
+void    QDPresent_MarkAll(void);
+Boolean QDPresent_Frame(Boolean wait);
+Boolean QDPresent_IsDoubleBuffered(void);
+void    QDPresent_GetStats(QDPresentStats* stats);
+void    QDPresent_DumpStats(void);
+
 /* Pixel operations */
 void QDPlatform_SetPixel(SInt32 x, SInt32 y, UInt32 color);
 UInt32 QDPlatform_GetPixel(SInt32 x, SInt32 y);
@@ -78,6 +110,52 @@ void QDPlatform_FillPoly(GrafPtr port, PolyHandle poly, const Pattern* pat,
 SInt16 QDPlatform_DrawGlyph(struct FontStrike *strike, UInt8 ch, SInt16 x, SInt16 y,
                             GrafPtr port, UInt32 color);
 
+/* Glyph runs: DrawString and DrawText work out the destination once per
+ * string, draw every character into it from the glyph cache, and mark the
+ * screen once at the end. QDPlatform_DrawGlyph is a run of one. */
+typedef struct QDGlyphRun {
+    UInt8*  base;            /* render buffer, NULL if there is none */
+    SInt32  rowBytes;
+    SInt32  width;           /* render buffer size, for clipping */
+    SInt32  height;
+    SInt16  offsetX;         /* port local -> render buffer coordinates */
+    SInt16  offsetY;
+    UInt32  color;
+    SInt32  markLeft, markTop, markRight, markBottom;   /* pixels touched */
+} QDGlyphRun;
+
+void    QDPlatform_BeginGlyphRun(QDGlyphRun* run, GrafPtr port, UInt32 color);
+SInt16  QDPlatform_DrawGlyphRun(QDGlyphRun* run, struct FontStrike* strike, UInt8 ch,
+                                SInt16 x, SInt16 y);
+SInt16  QDPlatform_DrawCoverageRun(QDGlyphRun* run, const struct FMGlyphBitmap* glyph,
+                                   SInt16 x, SInt16 y);
+void    QDPlatform_EndGlyphRun(QDGlyphRun* run);
+
+/* Glyph mask cache (GlyphCache.c)
+ *
+ * Each glyph of a strike, once drawn, is kept as a run-length mask: per
+ * row a run count, then (start column, length) byte pairs. Masks live in
+ * the system heap under an LRU byte budget. */
+typedef struct QDGlyphMask {
+    SInt16  width;           /* columns the glyph image covers */
+    SInt16  height;          /* rows (the strike's fRectHeight) */
+    UInt16  bytes;           /* size of runs[] */
+    UInt8   runs[1];
+} QDGlyphMask;
+
+typedef struct QDGlyphCacheStats {
+    UInt32  hits;
+    UInt32  misses;
+    UInt32  evictions;
+    UInt32  uncached;        /* glyphs too large to mask, or no memory */
+    UInt32  glyphs;          /* masks held now */
+    UInt32  bytes;           /* mask bytes held now */
+    UInt32  budget;
+} QDGlyphCacheStats;
+
+const QDGlyphMask* QDGlyphCache_Lookup(struct FontStrike* strike, UInt8 ch);
+void    QDGlyphCache_GetStats(QDGlyphCacheStats* stats);
+
 /* Glyph bitmap rendering */
 void QDPlatform_DrawGlyphBitmap(GrafPtr port, Point pen,
                                 const uint8_t *bitmap,
@@ -673,6 +673,49 @@ void SetDeskCPat(PixPatHandle deskPixPat);
  */
 void WM_InvalidateDisplay_Public(void);
 
+/*
+ * WM_DamageScreenRect / WM_DamageScreenRgn - Record exposed screen pixels
+ *
+ * Adds a rectangle or region, in global coordinates, to the screen damage
+ * region. The next update pass repaints the desktop, icons, window chrome
+ * and menu bar only where they intersect the damage.
+ */
+void WM_DamageScreenRect(const Rect* r);
+void WM_DamageScreenRgn(RgnHandle rgn);
+
+/*
+ * WM_DamageWindowRgn - Record damage on behalf of a window
+ *
+ * Like WM_DamageScreenRgn, but leaves out whatever the windows in front of
+ * theWindow cover - those pixels did not change.
+ */
+void WM_DamageWindowRgn(WindowPtr theWindow, RgnHandle rgn);
+
+/*
+ * WM_RepaintDamage - Repaint the screen damage now
+ *
+ * Runs the update pass immediately instead of waiting for WM_Update. Used
+ * where the Window Manager has just exposed pixels and must not leave them
+ * stale across a modal loop (hiding, showing and dragging windows).
+ */
+void WM_RepaintDamage(void);
+
+/*
+ * WM_SetCompositing / WM_IsCompositing - Per-window backing stores
+ *
+ * When built with WM_COMPOSITOR=1 each window keeps a retained copy of its
+ * frame and content, and uncovered window pixels are copied back from it
+ * instead of being repainted through update events. On by default in such
+ * builds; turning it off frees every store. Always off otherwise.
+ */
+void WM_SetCompositing(Boolean enable);
+Boolean WM_IsCompositing(void);
+
+/*
+ * WM_CompositorStoreBytes - Memory held by the backing stores, in bytes
+ */
+UInt32 WM_CompositorStoreBytes(void);
+
 /* ============================================================================
  * Window Manager Internal Functions (for platform implementations)
  * ============================================================================ */
@@ -431,6 +431,34 @@ WindowManagerState* GetWindowManagerState(void);
 
 /* Platform-specific data structure */
 
+/* ============================================================================
+ * Off-screen compositor (WindowCompositor.c)
+ * ============================================================================ */
+
+/* True when uncovered window pixels may come from backing stores */
+Boolean WM_CompositorActive(void);
+
+/* Copy what each window shows on screen inside area (global) into its store.
+ * Call before anything changes window geometry or stacking. */
+void WM_CompositorCapture(RgnHandle area);
+
+/* Restore the part of piece (global) the window's store holds; leftover
+ * receives the part that still has to be painted. */
+void WM_CompositorBlit(WindowPtr window, RgnHandle piece, RgnHandle leftover);
+
+/* EndUpdate: the update region was just drawn into the offscreen buffer */
+void WM_CompositorContentDrawn(WindowPtr window);
+
+/* The frame is about to be redrawn differently (highlight, title) */
+void WM_CompositorInvalidateChrome(WindowPtr window);
+
+/* The window is going away */
+void WM_CompositorForget(WindowPtr window);
+
+/* Something was just drawn on screen through port (ScreenPresent.c). A
+ * window port doing so is drawing outside an update. */
+void WM_CompositorNoteScreenDraw(GrafPtr port);
+
 /* ============================================================================
  * Global State Extensions
  * ============================================================================ */
@@ -0,0 +1,174 @@
+#!/usr/bin/env python3
+"""
+heapsnap.py - decode Memory Manager heap snapshots.
+
+The kernel packs every zone's counters - allocations and frees by size class,
+what compaction and purging cost, the largest free block and how fragmented
+the free space is - into a snapshot (MemoryManager_Snapshot). Built with
+MEMORY_PROFILE=1 it also carries allocations counted by call site, which is
+how to find the Toolbox manager churning a heap.
+
+A snapshot gets out two ways:
+
+  serial   the 'y' serial command (DEBUG_SERIAL_MENU_COMMANDS) prints it as
+           hex between "[HEAPSNAP] begin" and "[HEAPSNAP] end"; give this
+           script the log. The last snapshot in it is decoded, or all of
+           them with --all.
+  Gestalt  'hprf' returns a pointer to one; dump the bytes (e.g. from the
+           QEMU monitor or gdb) and give the file with --raw.
+
+Call sites are return addresses. With --elf they are named from the
+kernel's symbol table.
+
+Usage:
+    python3 scripts/heapsnap.py serial.log --elf kernel.elf
+    python3 scripts/heapsnap.py --raw hprf.bin
+"""
+
+import argparse
+import bisect
+import struct
+import subprocess
+import sys
+
+MAGIC = b'HPRF'
+HEADER = struct.Struct('<4sHBBHHI')
+SITE = struct.Struct('<QII')
+ZONE_TAIL = ('alloc_failures', 'compactions', 'compact_bytes_moved',
+             'idle_bytes_moved', 'purges', 'purged_bytes')
+CLASS_NAMES = ['0-64', '65-128', '129-256', '257-512',
+               '513-1K', '1K-2K', '2K-4K', '4K+']
+
+
+def decode(blob):
+    magic, version, nzones, nclasses, nsites, _, length = HEADER.unpack_from(blob)
+    if magic != MAGIC:
+        raise ValueError('not a heap snapshot (magic %r)' % magic)
+    if version != 1:
+        raise ValueError('snapshot version %d, this decoder knows 1' % version)
+    if len(blob) < length:
+        raise ValueError('snapshot truncated: %d of %d bytes' % (len(blob), length))
+
+    zone = struct.Struct('<4s6I%dI%dI6I' % (nclasses, nclasses))
+    off = HEADER.size
+    zones = []
+    for _ in range(nzones):
+        f = zone.unpack_from(blob, off)
+        off += zone.size
+        z = {
+            'name': f[0].rstrip(b'\0').decode('ascii', 'replace') or '?',
+            'size': f[1], 'used': f[2], 'free': f[3],
+            'largest_free': f[4], 'frag_permille': f[5], 'slabs': f[6],
+            'allocs': list(f[7:7 + nclasses]),
+            'frees': list(f[7 + nclasses:7 + 2 * nclasses]),
+        }
+        z.update(zip(ZONE_TAIL, f[7 + 2 * nclasses:]))
+        zones.append(z)
+
+    sites = []
+    for _ in range(nsites):
+        sites.append(SITE.unpack_from(blob, off))
+        off += SITE.size
+    return zones, sites
+
+
+def snapshots_in_log(text):
+    """Every complete snapshot in a serial log, oldest first."""
+    found, cur = [], None
+    for line in text.splitlines():
+        i = line.find('[HEAPSNAP] ')
+        if i < 0:
+            continue
+        word = line[i + 11:].strip()
+        if word == 'begin':
+            cur = []
+        elif word == 'end':
+            if cur is not None:
+                found.append(bytes.fromhex(''.join(cur)))
+            cur = None
+        elif cur is not None:
+            cur.append(word)
+    return found
+
+
+class Symbols:
+    def __init__(self, elf):
+        out = subprocess.run(['nm', '-n', '--defined-only', elf],
+                             capture_output=True, text=True).stdout
+        self.addrs, self.names = [], []
+        for line in out.splitlines():
+            p = line.split()
+            if len(p) == 3 and p[1] in 'tTwW':
+                self.addrs.append(int(p[0], 16))
+                self.names.append(p[2])
+
+    def name(self, addr):
+        i = bisect.bisect_right(self.addrs, addr) - 1
+        if i < 0:
+            return '?'
+        return '%s+0x%x' % (self.names[i], addr - self.addrs[i])
+
+
+def report(zones, sites, syms, top):
+    for z in zones:
+        print('Zone %s: %u KB, %u used, %u free, largest free %u, '
+              'fragmentation %.1f%%, %u slabs'
+              % (z['name'], z['size'] // 1024, z['used'], z['free'],
+                 z['largest_free'], z['frag_permille'] / 10.0, z['slabs']))
+        print('  %-10s %10s %10s %10s' % ('class', 'allocs', 'frees', 'live'))
+        for i, (a, f) in enumerate(zip(z['allocs'], z['frees'])):
+            if a or f:
+                name = CLASS_NAMES[i] if i < len(CLASS_NAMES) else str(i)
+                print('  %-10s %10u %10u %10d' % (name, a, f, a - f))
+        print('  alloc failures %u; compactions %u moving %u bytes; '
+              'idle compaction moved %u bytes; %u purges, %u bytes'
+              % tuple(z[k] for k in ZONE_TAIL))
+        print()
+
+    if not sites:
+        print('No call sites (build with MEMORY_PROFILE=1 to count them)')
+        return
+    sites = sorted(sites, key=lambda s: s[1], reverse=True)
+    total = sum(s[1] for s in sites) or 1
+    print('Allocation sites, by count (%d):' % len(sites))
+    print('  %10s %6s %12s  %s' % ('allocs', '%', 'bytes', 'site'))
+    for pc, allocs, nbytes in sites[:top]:
+        where = '(table full)' if pc == 0 else (
+            syms.name(pc) if syms else '0x%x' % pc)
+        print('  %10u %5.1f%% %12u  %s'
+              % (allocs, 100.0 * allocs / total, nbytes, where))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split('\n')[1])
+    ap.add_argument('log', nargs='?', help='serial log ("-" for stdin)')
+    ap.add_argument('--raw', help='snapshot bytes, as dumped from memory')
+    ap.add_argument('--elf', help='kernel.elf, to name call sites')
+    ap.add_argument('--all', action='store_true', help='every snapshot in the log')
+    ap.add_argument('--top', type=int, default=25, help='call sites to list')
+    args = ap.parse_args()
+
+    if args.raw:
+        with open(args.raw, 'rb') as f:
+            blobs = [f.read()]
+    elif args.log:
+        text = sys.stdin.read() if args.log == '-' else \
+            open(args.log, errors='replace').read()
+        blobs = snapshots_in_log(text)
+        if not blobs:
+            sys.exit('no [HEAPSNAP] snapshot in %s' % args.log)
+        if not args.all:
+            blobs = blobs[-1:]
+    else:
+        ap.error('give a serial log or --raw')
+
+    syms = Symbols(args.elf) if args.elf else None
+    for n, blob in enumerate(blobs):
+        if n:
+            print('-' * 60)
+        zones, sites = decode(blob)
+        report(zones, sites, syms, args.top)
+
+
+if __name__ == '__main__':
+    main()
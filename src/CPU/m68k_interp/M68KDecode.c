@@ -10,10 +10,12 @@
  * and big-endian (PowerPC, SPARC, etc) host architectures.
  *
  * Key Design Decisions:
- * - Fetch16/Fetch32: Reconstructed from individual bytes in big-endian order
- *   Example: (b0 << 8) | b1  --  NOT *(uint16_t*)&b0
- * - Read16/Read32/Write16/Write32: Always use explicit byte extraction/insertion
- * - No host byte order assumptions anywhere in the code
+ * - Read16/Read32/Write16/Write32: one host load or store through the
+ *   software TLB, then an explicit swap on little-endian hosts. Never a
+ *   cast of a host pointer - the load goes through __builtin_memcpy, which
+ *   is safe on hosts that do not allow unaligned access
+ * - Accesses that miss the TLB or straddle a page fall back to the paged
+ *   byte path, which is also where pages are allocated on first write
  * - Alignment checks enforce 68K requirements (2-byte words), not host CPU needs
  *
  * This design enables the 68K interpreter to run on:
@@ -67,6 +69,82 @@ static void M68K_LogOnce(Boolean* flag, const char* message)
     }
 }
 
+/* Forward declaration from M68KBackend.c */
+extern void* M68K_GetPage(M68KAddressSpace* as, UInt32 addr, Boolean allocate);
+
+/*
+ * Big-endian loads and stores at a host pointer.
+ *
+ * __builtin_memcpy rather than memcpy: the kernel builds with -fno-builtin,
+ * and a call to the library memcpy for two bytes would cost more than the
+ * page walk this replaces.
+ */
+static inline UInt16 M68K_LoadBE16(const UInt8* p)
+{
+    UInt16 v;
+    __builtin_memcpy(&v, p, 2);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    v = __builtin_bswap16(v);
+#endif
+    return v;
+}
+
+static inline UInt32 M68K_LoadBE32(const UInt8* p)
+{
+    UInt32 v;
+    __builtin_memcpy(&v, p, 4);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    return v;
+}
+
+static inline void M68K_StoreBE16(UInt8* p, UInt16 v)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    v = __builtin_bswap16(v);
+#endif
+    __builtin_memcpy(p, &v, 2);
+}
+
+static inline void M68K_StoreBE32(UInt8* p, UInt32 v)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    __builtin_memcpy(p, &v, 4);
+}
+
+/*
+ * M68K_Translate - host address of a guest byte, through the TLB
+ *
+ * A hit is one compare. A miss walks the page table - allocating the page if
+ * this is a write - and enters the result, unless there is no page, in which
+ * case the caller faults exactly as it did before there was a TLB.
+ */
+static inline UInt8* M68K_Translate(M68KAddressSpace* as, UInt32 addr, Boolean allocate)
+{
+    UInt32 pageNum = addr >> M68K_PAGE_SHIFT;
+    M68KTLBEntry* e = &as->tlb[pageNum & (M68K_TLB_ENTRIES - 1)];
+    UInt8* page;
+
+    if (e->page == pageNum) {
+        return e->host + (addr & (M68K_PAGE_SIZE - 1));
+    }
+
+    page = (UInt8*)M68K_GetPage(as, addr, allocate);
+    if (!page) {
+        return NULL;
+    }
+    e->page = pageNum;
+    e->host = page;
+    return page + (addr & (M68K_PAGE_SIZE - 1));
+}
+
+/* Whether a `bytes`-long access at addr stays inside one page. */
+#define M68K_IN_ONE_PAGE(addr, bytes) \
+    (((addr) & (M68K_PAGE_SIZE - 1)) <= M68K_PAGE_SIZE - (bytes))
+
 /*
  * Fetch16 - Fetch next 16-bit word from PC (big-endian)
  */
@@ -74,15 +152,22 @@ UInt16 M68K_Fetch16(M68KAddressSpace* as)
 {
     UInt16 value;
     UInt8 b0, b1;
+    UInt8* p;
 
     if (as->regs.pc + 1 >= M68K_MAX_ADDR) {
         M68K_Fault(as, "PC out of bounds in Fetch16");
         return 0;
     }
 
-    b0 = M68K_Read8(as, as->regs.pc);
-    b1 = M68K_Read8(as, as->regs.pc + 1);
-    value = (b0 << 8) | b1;
+    /* An even PC cannot straddle a page; an odd one is read a byte at a time
+     * as it always was, rather than turned into an address error here. */
+    if (!(as->regs.pc & 1) && (p = M68K_Translate(as, as->regs.pc, false)) != NULL) {
+        value = M68K_LoadBE16(p);
+    } else {
+        b0 = M68K_Read8(as, as->regs.pc);
+        b1 = M68K_Read8(as, as->regs.pc + 1);
+        value = (b0 << 8) | b1;
+    }
 
     as->regs.pc += 2;
     return value;
@@ -98,25 +183,18 @@ UInt32 M68K_Fetch32(M68KAddressSpace* as)
     return (hi << 16) | lo;
 }
 
-/* Forward declaration from M68KBackend.c */
-extern void* M68K_GetPage(M68KAddressSpace* as, UInt32 addr, Boolean allocate);
-
 /*
  * Read8 - Read byte from address space (paged)
  */
 UInt8 M68K_Read8(M68KAddressSpace* as, UInt32 addr)
 {
-    void* page;
-    UInt32 offset;
+    UInt8* p = M68K_Translate(as, addr, false);  /* Don't allocate on read */
 
-    page = M68K_GetPage(as, addr, false);  /* Don't allocate on read */
-    if (!page) {
+    if (!p) {
         M68K_Fault(as, "Read8 unmapped page");
         return 0;
     }
-
-    offset = addr & (M68K_PAGE_SIZE - 1);
-    return ((UInt8*)page)[offset];
+    return *p;
 }
 
 /*
@@ -124,7 +202,7 @@ UInt8 M68K_Read8(M68KAddressSpace* as, UInt32 addr)
  */
 UInt16 M68K_Read16(M68KAddressSpace* as, UInt32 addr)
 {
-    UInt8 b0, b1;
+    UInt8* p;
 
     /* Check word alignment */
     if (addr & 1) {
@@ -133,9 +211,13 @@ UInt16 M68K_Read16(M68KAddressSpace* as, UInt32 addr)
         return 0;
     }
 
-    b0 = M68K_Read8(as, addr);
-    b1 = M68K_Read8(as, addr + 1);
-    return (b0 << 8) | b1;
+    /* An even word never straddles a page. */
+    p = M68K_Translate(as, addr, false);
+    if (!p) {
+        M68K_Fault(as, "Read16 unmapped page");
+        return 0;
+    }
+    return M68K_LoadBE16(p);
 }
 
 /*
@@ -144,6 +226,7 @@ UInt16 M68K_Read16(M68KAddressSpace* as, UInt32 addr)
 UInt32 M68K_Read32(M68KAddressSpace* as, UInt32 addr)
 {
     UInt32 hi, lo;
+    UInt8* p;
 
     /* Check word alignment */
     if (addr & 1) {
@@ -152,6 +235,11 @@ UInt32 M68K_Read32(M68KAddressSpace* as, UInt32 addr)
         return 0;
     }
 
+    if (M68K_IN_ONE_PAGE(addr, 4) && (p = M68K_Translate(as, addr, false)) != NULL) {
+        return M68K_LoadBE32(p);
+    }
+
+    /* Straddles a page, or the page is missing and Read16 will say so. */
     hi = M68K_Read16(as, addr);
     lo = M68K_Read16(as, addr + 2);
     return (hi << 16) | lo;
@@ -162,17 +250,17 @@ UInt32 M68K_Read32(M68KAddressSpace* as, UInt32 addr)
  */
 void M68K_Write8(M68KAddressSpace* as, UInt32 addr, UInt8 value)
 {
-    void* page;
-    UInt32 offset;
+    UInt8* p = M68K_Translate(as, addr, true);  /* Allocate on write (lazy) */
 
-    page = M68K_GetPage(as, addr, true);  /* Allocate on write (lazy) */
-    if (!page) {
+    if (!p) {
         M68K_Fault(as, "Write8 page allocation failed");
         return;
     }
+    *p = value;
 
-    offset = addr & (M68K_PAGE_SIZE - 1);
-    ((UInt8*)page)[offset] = value;
+    /* Relocations, jump table patches and the program's own stores all come
+     * through here, so this is where a cached decode of the old word dies. */
+    M68K_InvalidateCodeWord(as, addr);
 }
 
 /*
@@ -180,6 +268,8 @@ void M68K_Write8(M68KAddressSpace* as, UInt32 addr, UInt8 value)
  */
 void M68K_Write16(M68KAddressSpace* as, UInt32 addr, UInt16 value)
 {
+    UInt8* p;
+
     /* Check word alignment */
     if (addr & 1) {
         M68K_LOG_ERROR("ADDRESS ERROR: Write16 PC=0x%08X EA=0x%08X (odd address)\\n", as->regs.pc, addr);
@@ -187,8 +277,13 @@ void M68K_Write16(M68KAddressSpace* as, UInt32 addr, UInt16 value)
         return;
     }
 
-    M68K_Write8(as, addr, (value >> 8) & 0xFF);
-    M68K_Write8(as, addr + 1, value & 0xFF);
+    p = M68K_Translate(as, addr, true);
+    if (!p) {
+        M68K_Fault(as, "Write16 page allocation failed");
+        return;
+    }
+    M68K_StoreBE16(p, value);
+    M68K_InvalidateCodeWord(as, addr);
 }
 
 /*
@@ -196,6 +291,8 @@ void M68K_Write16(M68KAddressSpace* as, UInt32 addr, UInt16 value)
  */
 void M68K_Write32(M68KAddressSpace* as, UInt32 addr, UInt32 value)
 {
+    UInt8* p;
+
     /* Check word alignment */
     if (addr & 1) {
         M68K_LOG_ERROR("ADDRESS ERROR: Write32 PC=0x%08X EA=0x%08X (odd address)\\n", as->regs.pc, addr);
@@ -203,6 +300,13 @@ void M68K_Write32(M68KAddressSpace* as, UInt32 addr, UInt32 value)
         return;
     }
 
+    if (M68K_IN_ONE_PAGE(addr, 4) && (p = M68K_Translate(as, addr, true)) != NULL) {
+        M68K_StoreBE32(p, value);
+        M68K_InvalidateCodeWord(as, addr);
+        M68K_InvalidateCodeWord(as, addr + 2);
+        return;
+    }
+
     M68K_Write16(as, addr, value >> 16);
     M68K_Write16(as, addr + 2, value & 0xFFFF);
 }
@@ -41,6 +41,9 @@ static void M68K_RaiseException(M68KAddressSpace* as, UInt16 vector, const char*
     as->faultReason = reason;
     as->faultPC = as->regs.pc;
 
+    /* An exception stacks sr, so it has to be the real one. */
+    M68K_FlagsSync(as);
+
     /* Map vector number to name */
     switch (vector) {
         case M68K_VEC_BUS_ERROR:      vecName = "BUS ERROR"; break;
@@ -101,21 +104,120 @@ void M68K_Fault(M68KAddressSpace* as, const char* reason)
     }
 }
 
+/*
+ * Lazy condition codes
+ *
+ * MOVE, MOVEQ, the logical operations, ADD, SUB, CMP and their immediate and
+ * quick forms record what they did through M68K_FlagsLazy rather than
+ * building the flags. Everything else still sets flags one at a time through
+ * the helpers below, and those fold in anything pending first - so an
+ * instruction that changes only some flags, or reads X, sees exactly what it
+ * would have seen had every flag been set at once.
+ */
+void M68K_FlagsSync(M68KAddressSpace* as)
+{
+    M68KRegs* r = &as->regs;
+    UInt32 mask, sign, src, dst, res;
+    UInt16 ccr;
+    Boolean c = false;
+
+    if (r->ccOp == kM68KFlagsKnown) {
+        return;
+    }
+
+    mask = SIZE_MASK(r->ccSize);
+    sign = SIZE_SIGN_BIT(r->ccSize);
+    src = r->ccSrc & mask;
+    dst = r->ccDst & mask;
+    res = r->ccRes & mask;
+
+    ccr = r->sr & CCR_X;
+    if (res == 0) {
+        ccr |= CCR_Z;
+    }
+    if (res & sign) {
+        ccr |= CCR_N;
+    }
+
+    switch (r->ccOp) {
+        case kM68KFlagsAdd:
+            c = res < dst;
+            if ((src ^ res) & (dst ^ res) & sign) {
+                ccr |= CCR_V;
+            }
+            break;
+        case kM68KFlagsSub:
+        case kM68KFlagsCmp:
+            c = src > dst;
+            if ((src ^ dst) & (dst ^ res) & sign) {
+                ccr |= CCR_V;
+            }
+            break;
+        default:
+            break;
+    }
+
+    if (c) {
+        ccr |= CCR_C;
+    }
+    if (r->ccOp == kM68KFlagsAdd || r->ccOp == kM68KFlagsSub) {
+        ccr = (ccr & ~CCR_X) | (c ? CCR_X : 0);
+    }
+
+    r->sr = (r->sr & ~(CCR_X | CCR_N | CCR_Z | CCR_V | CCR_C)) | ccr;
+    r->ccOp = kM68KFlagsKnown;
+}
+
+/*
+ * Note what an instruction did to the flags. An operation that leaves X alone
+ * replacing one that set it has to settle X first, since the record that
+ * would have produced it is about to go.
+ */
+static void M68K_FlagsLazy(M68KAddressSpace* as, UInt8 op, M68KSize size,
+                           UInt32 src, UInt32 dst, UInt32 res)
+{
+    M68KRegs* r = &as->regs;
+
+    if ((op == kM68KFlagsLogic || op == kM68KFlagsCmp) &&
+        (r->ccOp == kM68KFlagsAdd || r->ccOp == kM68KFlagsSub)) {
+        UInt32 mask = SIZE_MASK(r->ccSize);
+        Boolean x = (r->ccOp == kM68KFlagsAdd) ?
+                    (r->ccRes & mask) < (r->ccDst & mask) :
+                    (r->ccSrc & mask) > (r->ccDst & mask);
+        r->sr = x ? (r->sr | CCR_X) : (r->sr & ~CCR_X);
+    }
+
+    r->ccOp = op;
+    r->ccSize = (UInt8)size;
+    r->ccSrc = src;
+    r->ccDst = dst;
+    r->ccRes = res & SIZE_MASK(size);
+}
+
 /*
  * CCR Flag Helpers
  */
 static inline void M68K_SetFlag(M68KAddressSpace* as, UInt16 flag)
 {
+    if (as->regs.ccOp != kM68KFlagsKnown) {
+        M68K_FlagsSync(as);
+    }
     as->regs.sr |= flag;
 }
 
 static inline void M68K_ClearFlag(M68KAddressSpace* as, UInt16 flag)
 {
+    if (as->regs.ccOp != kM68KFlagsKnown) {
+        M68K_FlagsSync(as);
+    }
     as->regs.sr &= ~flag;
 }
 
 static inline Boolean M68K_TestFlag(M68KAddressSpace* as, UInt16 flag)
 {
+    if (as->regs.ccOp != kM68KFlagsKnown) {
+        M68K_FlagsSync(as);
+    }
     return (as->regs.sr & flag) != 0;
 }
 
@@ -167,6 +269,60 @@ Boolean M68K_TestCondition(UInt16 sr, M68KCondition cc)
     }
 }
 
+/*
+ * M68K_Condition - test a condition against the live flags
+ *
+ * After a compare, subtract or logical operation the common conditions are a
+ * comparison of the recorded operands, which is cheaper than building the
+ * flags and decoding them again. Anything else settles the flags and tests
+ * sr.
+ */
+Boolean M68K_Condition(M68KAddressSpace* as, M68KCondition cc)
+{
+    M68KRegs* r = &as->regs;
+
+    if (r->ccOp == kM68KFlagsSub || r->ccOp == kM68KFlagsCmp) {
+        UInt32 mask = SIZE_MASK(r->ccSize);
+        UInt32 dst = r->ccDst & mask;
+        UInt32 src = r->ccSrc & mask;
+        UInt32 shift = 32 - 8 * SIZE_BYTES(r->ccSize);
+        SInt32 sdst = (SInt32)(dst << shift) >> shift;
+        SInt32 ssrc = (SInt32)(src << shift) >> shift;
+
+        switch (cc) {
+            case CC_EQ: return dst == src;
+            case CC_NE: return dst != src;
+            case CC_HI: return dst > src;
+            case CC_LS: return dst <= src;
+            case CC_CC: return dst >= src;
+            case CC_CS: return dst < src;
+            case CC_GE: return sdst >= ssrc;
+            case CC_LT: return sdst < ssrc;
+            case CC_GT: return sdst > ssrc;
+            case CC_LE: return sdst <= ssrc;
+            default:    break;
+        }
+    } else if (r->ccOp == kM68KFlagsLogic) {
+        Boolean z = (r->ccRes == 0);
+        Boolean n = (r->ccRes & SIZE_SIGN_BIT(r->ccSize)) != 0;
+
+        switch (cc) {
+            case CC_EQ: return z;
+            case CC_NE: return !z;
+            case CC_MI: return n;
+            case CC_PL: return !n;
+            case CC_GE: return !n;
+            case CC_LT: return n;
+            case CC_GT: return !z && !n;
+            case CC_LE: return z || n;
+            default:    break;
+        }
+    }
+
+    M68K_FlagsSync(as);
+    return M68K_TestCondition(r->sr, cc);
+}
+
 /*
  * Stack Push/Pop Helpers
  */
@@ -225,8 +381,7 @@ void M68K_Op_MOVE(M68KAddressSpace* as, UInt16 opcode)
     M68K_EA_Write(as, dst_mode, dst_reg, size, value);
 
     /* Set flags */
-    M68K_SetNZ(as, value, size);
-    M68K_ClearFlag(as, CCR_V | CCR_C);
+    M68K_FlagsLazy(as, kM68KFlagsLogic, size, 0, 0, value);
 }
 
 /*
@@ -305,8 +460,7 @@ void M68K_Op_CLR(M68KAddressSpace* as, UInt16 opcode)
     M68K_EA_Write(as, mode, reg, size, 0);
 
     /* Set flags: Z=1, N=V=C=0 */
-    M68K_SetFlag(as, CCR_Z);
-    M68K_ClearFlag(as, CCR_N | CCR_V | CCR_C);
+    M68K_FlagsLazy(as, kM68KFlagsLogic, size, 0, 0, 0);
 }
 
 /*
@@ -329,8 +483,7 @@ void M68K_Op_NOT(M68KAddressSpace* as, UInt16 opcode)
     M68K_EA_Write(as, mode, reg, size, value);
 
     /* Set flags */
-    M68K_SetNZ(as, value, size);
-    M68K_ClearFlag(as, CCR_V | CCR_C);
+    M68K_FlagsLazy(as, kM68KFlagsLogic, size, 0, 0, value);
 }
 
 /*
@@ -360,29 +513,10 @@ void M68K_Op_ADD(M68KAddressSpace* as, UInt16 opcode)
         M68K_EA_Write(as, ea_mode, ea_reg, size, result);
     }
 
-    /* Set flags */
-    M68K_SetNZ(as, result, size);
-
-    /* Set C and X if carry occurred */
-    if ((dst + src) > mask) {
-        M68K_SetFlag(as, CCR_C | CCR_X);
-    } else {
-        M68K_ClearFlag(as, CCR_C | CCR_X);
-    }
-
-    /* Set V if signed overflow occurred (src and dst same sign, result different) */
-    {
-        UInt32 sign_bit = SIZE_SIGN_BIT(size);
-        Boolean src_neg = (src & sign_bit) != 0;
-        Boolean dst_neg = (dst & sign_bit) != 0;
-        Boolean res_neg = (result & sign_bit) != 0;
-
-        if (src_neg == dst_neg && res_neg != dst_neg) {
-            M68K_SetFlag(as, CCR_V);
-        } else {
-            M68K_ClearFlag(as, CCR_V);
-        }
-    }
+    /* Set flags. C is a carry out of the operand size, which for a long
+     * add cannot be seen as a sum greater than the mask - so long adds
+     * never carried. The result wrapping below the destination can. */
+    M68K_FlagsLazy(as, kM68KFlagsAdd, size, src, dst, result);
 }
 
 /*
@@ -413,28 +547,7 @@ void M68K_Op_SUB(M68KAddressSpace* as, UInt16 opcode)
     }
 
     /* Set flags */
-    M68K_SetNZ(as, result, size);
-
-    /* Set C and X if borrow occurred */
-    if (src > dst) {
-        M68K_SetFlag(as, CCR_C | CCR_X);
-    } else {
-        M68K_ClearFlag(as, CCR_C | CCR_X);
-    }
-
-    /* Set V if signed overflow occurred (src and dst different sign, result different from dst) */
-    {
-        UInt32 sign_bit = SIZE_SIGN_BIT(size);
-        Boolean src_neg = (src & sign_bit) != 0;
-        Boolean dst_neg = (dst & sign_bit) != 0;
-        Boolean res_neg = (result & sign_bit) != 0;
-
-        if (src_neg != dst_neg && res_neg != dst_neg) {
-            M68K_SetFlag(as, CCR_V);
-        } else {
-            M68K_ClearFlag(as, CCR_V);
-        }
-    }
+    M68K_FlagsLazy(as, kM68KFlagsSub, size, src, dst, result);
 }
 
 /*
@@ -454,18 +567,10 @@ void M68K_Op_CMP(M68KAddressSpace* as, UInt16 opcode)
     src = M68K_EA_Read(as, ea_mode, ea_reg, size);
     result = (dst - src) & mask;
 
-    /* Set flags (don't write result) */
-    M68K_SetNZ(as, result, size);
-
-    /* Set C if borrow occurred */
-    if (src > dst) {
-        M68K_SetFlag(as, CCR_C);
-    } else {
-        M68K_ClearFlag(as, CCR_C);
-    }
-
-    /* Clear V for MVP */
-    M68K_ClearFlag(as, CCR_V);
+    /* Set flags (don't write result). V is the same signed overflow as
+     * SUB's; it used to be left clear, which made BGE and BLT after a
+     * compare that overflowed go the wrong way. */
+    M68K_FlagsLazy(as, kM68KFlagsCmp, size, src, dst, result);
 }
 
 /*
@@ -558,15 +663,20 @@ void M68K_Op_JMP(M68KAddressSpace* as, UInt16 opcode)
 void M68K_Op_BRA(M68KAddressSpace* as, UInt16 opcode)
 {
     SInt32 disp;
+    UInt32 base;
     UInt32 target;
 
     disp = (SInt8)(opcode & 0xFF);
+    base = as->regs.pc;
     if (disp == 0) {
         /* 16-bit displacement */
         disp = SIGN_EXTEND_WORD(M68K_Fetch16(as));
     }
 
-    target = as->regs.pc + disp;
+    /* The displacement counts from the word after the opcode whichever form
+     * it takes. Adding it to the PC after the fetch put every word branch
+     * two bytes past its target. */
+    target = base + disp;
     serial_printf("[M68K] BRA 0x%08X -> 0x%08X (disp=%d)\n", as->regs.pc - 2, target, disp);
     as->regs.pc = target;
 
@@ -579,15 +689,17 @@ void M68K_Op_BRA(M68KAddressSpace* as, UInt16 opcode)
 void M68K_Op_BSR(M68KAddressSpace* as, UInt16 opcode)
 {
     SInt32 disp;
+    UInt32 base;
     UInt32 target;
 
     disp = (SInt8)(opcode & 0xFF);
+    base = as->regs.pc;
     if (disp == 0) {
         /* 16-bit displacement */
         disp = SIGN_EXTEND_WORD(M68K_Fetch16(as));
     }
 
-    target = as->regs.pc + disp;
+    target = base + disp;       /* see BRA */
 
     /* Push return address */
     M68K_Push32(as, as->regs.pc);
@@ -606,16 +718,18 @@ void M68K_Op_Bcc(M68KAddressSpace* as, UInt16 opcode)
 {
     M68KCondition cc = (opcode >> 8) & 0xF;
     SInt32 disp;
+    UInt32 base;
     UInt32 target;
 
     disp = (SInt8)(opcode & 0xFF);
+    base = as->regs.pc;
     if (disp == 0) {
         /* 16-bit displacement */
         disp = SIGN_EXTEND_WORD(M68K_Fetch16(as));
     }
 
-    if (M68K_TestCondition(as->regs.sr, cc)) {
-        target = as->regs.pc + disp;
+    if (M68K_Condition(as, cc)) {
+        target = base + disp;   /* see BRA */
         serial_printf("[M68K] Bcc (cc=%d) taken: 0x%08X -> 0x%08X\n", cc, as->regs.pc - 2, target);
         as->regs.pc = target;
     } else {
@@ -692,7 +806,7 @@ void M68K_Op_Scc(M68KAddressSpace* as, UInt16 opcode)
     UInt8 value;
 
     /* Test condition */
-    if (M68K_TestCondition(as->regs.sr, cc)) {
+    if (M68K_Condition(as, cc)) {
         value = 0xFF;
         serial_printf("[M68K] Scc (cc=%d) true -> set 0xFF\n", cc);
     } else {
@@ -723,7 +837,7 @@ void M68K_Op_DBcc(M68KAddressSpace* as, UInt16 opcode)
     disp = (SInt16)M68K_Fetch16(as);
 
     /* Test condition */
-    if (!M68K_TestCondition(as->regs.sr, cc)) {
+    if (!M68K_Condition(as, cc)) {
         /* Condition false - decrement and test */
         SInt16 counter = (SInt16)(as->regs.d[reg] & 0xFFFF);
         counter--;
@@ -758,6 +872,9 @@ void M68K_Op_TRAP(M68KAddressSpace* as, UInt16 opcode)
 
     serial_printf("[M68K] TRAP $A%03X at PC=0x%08X\n", trap_num, saved_pc - 2);
 
+    /* A trap is a call out of the program; what it finds in sr is exact. */
+    M68K_FlagsSync(as);
+
     /* Look up trap handler, through the same slot mapping that installed it */
     int slot = M68K_TrapSlot(opcode);
     if (slot >= 0 && as->trapHandlers[slot]) {
@@ -795,13 +912,7 @@ void M68K_Op_MOVEQ(M68KAddressSpace* as, UInt16 opcode)
     as->regs.d[dn] = value;
 
     /* Set flags based on result */
-    M68K_ClearFlag(as, CCR_N | CCR_Z | CCR_V | CCR_C);
-    if (value == 0) {
-        M68K_SetFlag(as, CCR_Z);
-    }
-    if (value < 0) {
-        M68K_SetFlag(as, CCR_N);
-    }
+    M68K_FlagsLazy(as, kM68KFlagsLogic, SIZE_LONG, 0, 0, (UInt32)value);
 }
 
 /*
@@ -816,7 +927,6 @@ void M68K_Op_TST(M68KAddressSpace* as, UInt16 opcode)
     UInt8 reg = opcode & 7;
     M68KSize size;
     UInt32 value;
-    SInt32 signed_value;
 
     /* Decode size */
     if (size_bits == 0) {
@@ -833,23 +943,8 @@ void M68K_Op_TST(M68KAddressSpace* as, UInt16 opcode)
     /* Read operand */
     value = M68K_EA_Read(as, mode, reg, size);
 
-    /* Sign-extend for flag calculation */
-    if (size == SIZE_BYTE) {
-        signed_value = SIGN_EXTEND_BYTE(value);
-    } else if (size == SIZE_WORD) {
-        signed_value = SIGN_EXTEND_WORD(value);
-    } else {
-        signed_value = value;
-    }
-
     /* Set flags */
-    M68K_ClearFlag(as, CCR_N | CCR_Z | CCR_V | CCR_C);
-    if (signed_value == 0) {
-        M68K_SetFlag(as, CCR_Z);
-    }
-    if (signed_value < 0) {
-        M68K_SetFlag(as, CCR_N);
-    }
+    M68K_FlagsLazy(as, kM68KFlagsLogic, size, 0, 0, value);
 }
 
 /*
@@ -877,13 +972,8 @@ void M68K_Op_EXT(M68KAddressSpace* as, UInt16 opcode)
     }
 
     /* Set flags */
-    M68K_ClearFlag(as, CCR_N | CCR_Z | CCR_V | CCR_C);
-    if (value == 0) {
-        M68K_SetFlag(as, CCR_Z);
-    }
-    if (value < 0) {
-        M68K_SetFlag(as, CCR_N);
-    }
+    M68K_FlagsLazy(as, kM68KFlagsLogic, (opmode == 2) ? SIZE_WORD : SIZE_LONG,
+                   0, 0, (UInt32)value);
 }
 
 /*
@@ -902,13 +992,7 @@ void M68K_Op_SWAP(M68KAddressSpace* as, UInt16 opcode)
     as->regs.d[dn] = swapped;
 
     /* Set flags based on result */
-    M68K_ClearFlag(as, CCR_N | CCR_Z | CCR_V | CCR_C);
-    if (swapped == 0) {
-        M68K_SetFlag(as, CCR_Z);
-    }
-    if (swapped & 0x80000000) {
-        M68K_SetFlag(as, CCR_N);
-    }
+    M68K_FlagsLazy(as, kM68KFlagsLogic, SIZE_LONG, 0, 0, swapped);
 }
 
 /*
@@ -939,28 +1023,7 @@ void M68K_Op_ADDQ(M68KAddressSpace* as, UInt16 opcode)
 
     /* Set flags (unless An direct) */
     if (mode != MODE_An) {
-        M68K_SetNZ(as, result, size);
-
-        /* Set C and X if carry occurred */
-        if ((operand + immediate) > mask) {
-            M68K_SetFlag(as, CCR_C | CCR_X);
-        } else {
-            M68K_ClearFlag(as, CCR_C | CCR_X);
-        }
-
-        /* Set V if overflow */
-        {
-            UInt32 sign_bit = SIZE_SIGN_BIT(size);
-            Boolean op_neg = (operand & sign_bit) != 0;
-            Boolean res_neg = (result & sign_bit) != 0;
-            Boolean imm_neg = false; /* Immediate is always positive */
-
-            if (op_neg == imm_neg && res_neg != op_neg) {
-                M68K_SetFlag(as, CCR_V);
-            } else {
-                M68K_ClearFlag(as, CCR_V);
-            }
-        }
+        M68K_FlagsLazy(as, kM68KFlagsAdd, size, immediate, operand, result);
     }
 }
 
@@ -992,28 +1055,7 @@ void M68K_Op_SUBQ(M68KAddressSpace* as, UInt16 opcode)
 
     /* Set flags (unless An direct) */
     if (mode != MODE_An) {
-        M68K_SetNZ(as, result, size);
-
-        /* Set C and X if borrow occurred */
-        if (immediate > operand) {
-            M68K_SetFlag(as, CCR_C | CCR_X);
-        } else {
-            M68K_ClearFlag(as, CCR_C | CCR_X);
-        }
-
-        /* Set V if overflow */
-        {
-            UInt32 sign_bit = SIZE_SIGN_BIT(size);
-            Boolean op_neg = (operand & sign_bit) != 0;
-            Boolean res_neg = (result & sign_bit) != 0;
-            Boolean imm_neg = false; /* Immediate is always positive */
-
-            if (op_neg != imm_neg && res_neg != op_neg) {
-                M68K_SetFlag(as, CCR_V);
-            } else {
-                M68K_ClearFlag(as, CCR_V);
-            }
-        }
+        M68K_FlagsLazy(as, kM68KFlagsSub, size, immediate, operand, result);
     }
 }
 
@@ -1047,8 +1089,7 @@ void M68K_Op_AND(M68KAddressSpace* as, UInt16 opcode)
     }
 
     /* Set flags */
-    M68K_SetNZ(as, result, size);
-    M68K_ClearFlag(as, CCR_V | CCR_C);
+    M68K_FlagsLazy(as, kM68KFlagsLogic, size, 0, 0, result);
 }
 
 /*
@@ -1081,8 +1122,7 @@ void M68K_Op_OR(M68KAddressSpace* as, UInt16 opcode)
     }
 
     /* Set flags */
-    M68K_SetNZ(as, result, size);
-    M68K_ClearFlag(as, CCR_V | CCR_C);
+    M68K_FlagsLazy(as, kM68KFlagsLogic, size, 0, 0, result);
 }
 
 /*
@@ -1106,8 +1146,7 @@ void M68K_Op_EOR(M68KAddressSpace* as, UInt16 opcode)
     M68K_EA_Write(as, ea_mode, ea_reg, size, result);
 
     /* Set flags */
-    M68K_SetNZ(as, result, size);
-    M68K_ClearFlag(as, CCR_V | CCR_C);
+    M68K_FlagsLazy(as, kM68KFlagsLogic, size, 0, 0, result);
 }
 
 /*
@@ -1204,27 +1243,7 @@ void M68K_Op_CMPA(M68KAddressSpace* as, UInt16 opcode)
     result = dst - src;
 
     /* Set flags */
-    M68K_SetNZ(as, result, SIZE_LONG);
-
-    /* Set C if borrow occurred */
-    if (src > dst) {
-        M68K_SetFlag(as, CCR_C);
-    } else {
-        M68K_ClearFlag(as, CCR_C);
-    }
-
-    /* Set V if overflow */
-    {
-        Boolean src_neg = (src & 0x80000000) != 0;
-        Boolean dst_neg = (dst & 0x80000000) != 0;
-        Boolean res_neg = (result & 0x80000000) != 0;
-
-        if (src_neg != dst_neg && res_neg != dst_neg) {
-            M68K_SetFlag(as, CCR_V);
-        } else {
-            M68K_ClearFlag(as, CCR_V);
-        }
-    }
+    M68K_FlagsLazy(as, kM68KFlagsCmp, SIZE_LONG, src, dst, result);
 }
 
 /*
@@ -2044,22 +2063,8 @@ void M68K_Op_NEG(M68KAddressSpace* as, UInt16 opcode)
     /* Write result */
     M68K_EA_Write(as, mode, reg, size, result);
 
-    /* Set flags */
-    M68K_SetNZ(as, result, size);
-
-    /* C and X set if result is non-zero */
-    if (result != 0) {
-        M68K_SetFlag(as, CCR_C | CCR_X);
-    } else {
-        M68K_ClearFlag(as, CCR_C | CCR_X);
-    }
-
-    /* V set if overflow occurred (value was 0x80... for the size) */
-    if (value == SIZE_SIGN_BIT(size)) {
-        M68K_SetFlag(as, CCR_V);
-    } else {
-        M68K_ClearFlag(as, CCR_V);
-    }
+    /* Set flags: 0 - value */
+    M68K_FlagsLazy(as, kM68KFlagsSub, size, value, 0, result);
 }
 
 /*
@@ -2460,27 +2465,7 @@ void M68K_Op_CMPI(M68KAddressSpace* as, UInt16 opcode)
     result = (operand - immediate) & mask;
 
     /* Set flags */
-    M68K_SetNZ(as, result, size);
-
-    if (immediate > operand) {
-        M68K_SetFlag(as, CCR_C);
-    } else {
-        M68K_ClearFlag(as, CCR_C);
-    }
-
-    /* V flag */
-    {
-        UInt32 sign_bit = SIZE_SIGN_BIT(size);
-        Boolean src_neg = (immediate & sign_bit) != 0;
-        Boolean dst_neg = (operand & sign_bit) != 0;
-        Boolean res_neg = (result & sign_bit) != 0;
-
-        if (src_neg != dst_neg && res_neg != dst_neg) {
-            M68K_SetFlag(as, CCR_V);
-        } else {
-            M68K_ClearFlag(as, CCR_V);
-        }
-    }
+    M68K_FlagsLazy(as, kM68KFlagsCmp, size, immediate, operand, result);
 }
 
 /*
@@ -2494,7 +2479,6 @@ void M68K_Op_ADDI(M68KAddressSpace* as, UInt16 opcode)
     UInt8 reg = opcode & 7;
     UInt32 immediate, dest, result;
     UInt32 mask = SIZE_MASK(size);
-    UInt32 sign_bit = SIZE_SIGN_BIT(size);
 
     /* Fetch immediate value */
     if (size == SIZE_BYTE) {
@@ -2515,24 +2499,7 @@ void M68K_Op_ADDI(M68KAddressSpace* as, UInt16 opcode)
     M68K_EA_Write(as, mode, reg, size, result);
 
     /* Set flags */
-    M68K_SetNZ(as, result, size);
-
-    /* Carry flag */
-    if (result < dest || result < immediate) {
-        M68K_SetFlag(as, CCR_C | CCR_X);
-    } else {
-        M68K_ClearFlag(as, CCR_C | CCR_X);
-    }
-
-    /* Overflow flag */
-    Boolean dest_neg = (dest & sign_bit) != 0;
-    Boolean imm_neg = (immediate & sign_bit) != 0;
-    Boolean res_neg = (result & sign_bit) != 0;
-    if ((dest_neg == imm_neg) && (dest_neg != res_neg)) {
-        M68K_SetFlag(as, CCR_V);
-    } else {
-        M68K_ClearFlag(as, CCR_V);
-    }
+    M68K_FlagsLazy(as, kM68KFlagsAdd, size, immediate, dest, result);
 }
 
 /*
@@ -2546,7 +2513,6 @@ void M68K_Op_SUBI(M68KAddressSpace* as, UInt16 opcode)
     UInt8 reg = opcode & 7;
     UInt32 immediate, dest, result;
     UInt32 mask = SIZE_MASK(size);
-    UInt32 sign_bit = SIZE_SIGN_BIT(size);
 
     /* Fetch immediate value */
     if (size == SIZE_BYTE) {
@@ -2567,24 +2533,7 @@ void M68K_Op_SUBI(M68KAddressSpace* as, UInt16 opcode)
     M68K_EA_Write(as, mode, reg, size, result);
 
     /* Set flags */
-    M68K_SetNZ(as, result, size);
-
-    /* Carry flag */
-    if (immediate > dest) {
-        M68K_SetFlag(as, CCR_C | CCR_X);
-    } else {
-        M68K_ClearFlag(as, CCR_C | CCR_X);
-    }
-
-    /* Overflow flag */
-    Boolean dest_neg = (dest & sign_bit) != 0;
-    Boolean imm_neg = (immediate & sign_bit) != 0;
-    Boolean res_neg = (result & sign_bit) != 0;
-    if ((dest_neg != imm_neg) && (dest_neg != res_neg)) {
-        M68K_SetFlag(as, CCR_V);
-    } else {
-        M68K_ClearFlag(as, CCR_V);
-    }
+    M68K_FlagsLazy(as, kM68KFlagsSub, size, immediate, dest, result);
 }
 
 /*
@@ -2618,8 +2567,7 @@ void M68K_Op_ANDI(M68KAddressSpace* as, UInt16 opcode)
     M68K_EA_Write(as, mode, reg, size, result);
 
     /* Set flags */
-    M68K_SetNZ(as, result, size);
-    M68K_ClearFlag(as, CCR_V | CCR_C);
+    M68K_FlagsLazy(as, kM68KFlagsLogic, size, 0, 0, result);
 }
 
 /*
@@ -2653,8 +2601,7 @@ void M68K_Op_ORI(M68KAddressSpace* as, UInt16 opcode)
     M68K_EA_Write(as, mode, reg, size, result);
 
     /* Set flags */
-    M68K_SetNZ(as, result, size);
-    M68K_ClearFlag(as, CCR_V | CCR_C);
+    M68K_FlagsLazy(as, kM68KFlagsLogic, size, 0, 0, result);
 }
 
 /*
@@ -2688,8 +2635,7 @@ void M68K_Op_EORI(M68KAddressSpace* as, UInt16 opcode)
     M68K_EA_Write(as, mode, reg, size, result);
 
     /* Set flags */
-    M68K_SetNZ(as, result, size);
-    M68K_ClearFlag(as, CCR_V | CCR_C);
+    M68K_FlagsLazy(as, kM68KFlagsLogic, size, 0, 0, result);
 }
 
 /*
@@ -2915,7 +2861,6 @@ void M68K_Op_CMPM(M68KAddressSpace* as, UInt16 opcode)
     UInt8 size = (opcode >> 6) & 3;
     UInt32 src, dst, result;
     UInt32 mask = SIZE_MASK(size);
-    UInt32 sign_bit = SIZE_SIGN_BIT(size);
     UInt8 byte_count = SIZE_BYTES(size);
 
     /* Read from (Ax)+ */
@@ -2942,24 +2887,7 @@ void M68K_Op_CMPM(M68KAddressSpace* as, UInt16 opcode)
     result = (dst - src) & mask;
 
     /* Set flags */
-    M68K_SetNZ(as, result, size);
-
-    /* Carry flag */
-    if (src > dst) {
-        M68K_SetFlag(as, CCR_C);
-    } else {
-        M68K_ClearFlag(as, CCR_C);
-    }
-
-    /* Overflow flag */
-    Boolean dst_neg = (dst & sign_bit) != 0;
-    Boolean src_neg = (src & sign_bit) != 0;
-    Boolean res_neg = (result & sign_bit) != 0;
-    if ((dst_neg != src_neg) && (dst_neg != res_neg)) {
-        M68K_SetFlag(as, CCR_V);
-    } else {
-        M68K_ClearFlag(as, CCR_V);
-    }
+    M68K_FlagsLazy(as, kM68KFlagsCmp, size, src, dst, result);
 }
 
 /*
@@ -3021,6 +2949,7 @@ void M68K_Op_RTR(M68KAddressSpace* as, UInt16 opcode)
 
     /* Pop CCR from stack */
     ccr = M68K_Pop16(as);
+    M68K_FlagsSync(as);
     as->regs.sr = (as->regs.sr & 0xFF00) | (ccr & 0x001F);
 
     /* Pop return address from stack */
@@ -3042,6 +2971,7 @@ void M68K_Op_ANDI_CCR(M68KAddressSpace* as, UInt16 opcode)
     immediate = M68K_Fetch16(as) & 0xFF;
 
     /* AND with CCR (lower byte of SR) */
+    M68K_FlagsSync(as);
     as->regs.sr = (as->regs.sr & 0xFF00) | ((as->regs.sr & 0x00FF) & immediate);
 }
 
@@ -3065,6 +2995,7 @@ void M68K_Op_ANDI_SR(M68KAddressSpace* as, UInt16 opcode)
     immediate = M68K_Fetch16(as);
 
     /* AND with entire SR */
+    M68K_FlagsSync(as);
     as->regs.sr &= immediate;
 }
 
@@ -3082,6 +3013,7 @@ void M68K_Op_ORI_CCR(M68KAddressSpace* as, UInt16 opcode)
     immediate = M68K_Fetch16(as) & 0xFF;
 
     /* OR with CCR (lower byte of SR) */
+    M68K_FlagsSync(as);
     as->regs.sr = (as->regs.sr & 0xFF00) | ((as->regs.sr & 0x00FF) | immediate);
 }
 
@@ -3105,6 +3037,7 @@ void M68K_Op_ORI_SR(M68KAddressSpace* as, UInt16 opcode)
     immediate = M68K_Fetch16(as);
 
     /* OR with entire SR */
+    M68K_FlagsSync(as);
     as->regs.sr |= immediate;
 }
 
@@ -3122,6 +3055,7 @@ void M68K_Op_EORI_CCR(M68KAddressSpace* as, UInt16 opcode)
     immediate = M68K_Fetch16(as) & 0xFF;
 
     /* EOR with CCR (lower byte of SR) */
+    M68K_FlagsSync(as);
     as->regs.sr = (as->regs.sr & 0xFF00) | ((as->regs.sr & 0x00FF) ^ immediate);
 }
 
@@ -3145,6 +3079,7 @@ void M68K_Op_EORI_SR(M68KAddressSpace* as, UInt16 opcode)
     immediate = M68K_Fetch16(as);
 
     /* EOR with entire SR */
+    M68K_FlagsSync(as);
     as->regs.sr ^= immediate;
 }
 
@@ -3162,6 +3097,7 @@ void M68K_Op_MOVE_CCR(M68KAddressSpace* as, UInt16 opcode)
     value = M68K_EA_Read(as, mode, reg, SIZE_WORD);
 
     /* Move to CCR (lower byte of SR) */
+    M68K_FlagsSync(as);
     as->regs.sr = (as->regs.sr & 0xFF00) | (value & 0x001F);
 }
 
@@ -3185,6 +3121,7 @@ void M68K_Op_MOVE_SR(M68KAddressSpace* as, UInt16 opcode)
     value = M68K_EA_Read(as, mode, reg, SIZE_WORD);
 
     /* Move to SR */
+    M68K_FlagsSync(as);
     as->regs.sr = value;
 }
 
@@ -3198,6 +3135,7 @@ void M68K_Op_MOVE_FROM_SR(M68KAddressSpace* as, UInt16 opcode)
     UInt8 reg = opcode & 7;
 
     /* Write SR to destination */
+    M68K_FlagsSync(as);
     M68K_EA_Write(as, mode, reg, SIZE_WORD, as->regs.sr);
 }
 
@@ -3252,6 +3190,7 @@ void M68K_Op_MOVE_FROM_CCR(M68KAddressSpace* as, UInt16 opcode)
 
     /* Read only CCR (lower byte of SR), with upper byte zeroed.
      * This is the key difference from MOVE from SR which reads the full SR. */
+    M68K_FlagsSync(as);
     ccr_value = as->regs.sr & 0x001F;
 
     /* Write to destination */
@@ -0,0 +1,456 @@
+/*
+ * M68KThreaded.c - 68K Threaded-Code CPU Backend
+ *
+ * A second way to run the interpreter's address spaces: a block at a time
+ * instead of an instruction at a time. No host code is generated - a block is
+ * a list of calls into the same handlers M68K_Step uses - so this runs
+ * wherever the interpreter does and agrees with it instruction for
+ * instruction.
+ *
+ * HOW A BLOCK IS MADE:
+ * The first time execution reaches a PC with no block, the instructions from
+ * there are run one at a time and recorded as they go: the opcode word, the
+ * handler the dispatch table gave it, and - for the branches - the target and
+ * fall-through addresses, worked out from the displacement once. A block ends
+ * at the first instruction that can go anywhere but the next one (branch,
+ * jump, return, A-line trap), or after M68K_TB_BLOCK_OPS instructions.
+ * Recording while running means nothing needs to know how long an
+ * instruction is; the handlers still fetch their own extension words.
+ *
+ * WHAT IS SAVED:
+ * Replaying a block skips the opcode fetch, the cache probe and the dispatch
+ * load per instruction, and the loop checks the instruction budget and the
+ * return sentinel once per block rather than once per instruction. The
+ * branches run from their resolved operands without fetching a displacement
+ * or writing a trace line. A block ending in a direct branch or running off
+ * its end remembers the blocks it went to, so a loop goes from block to
+ * block without a lookup.
+ *
+ * KEEPING BLOCKS HONEST:
+ * Every guest store already passes through M68K_InvalidateCodeWord for the
+ * decode cache. The address space carries a bitmap of 256-byte lines blocks
+ * were translated from; a store landing on a marked line drops every block
+ * overlapping it. A block that writes over itself, or over the one being
+ * recorded, stops at that instruction and the next one is looked up afresh.
+ */
+
+#include "CPU/M68KInterp.h"
+#include "CPU/M68KOpcodes.h"
+#include "CPU/CPUBackend.h"
+#include "MemoryMgr/MemoryManager.h"
+#include "System71StdLib.h"
+#include "CPU/CPULogging.h"
+#include <string.h>
+
+extern UInt16 M68K_Fetch16(M68KAddressSpace* as);
+extern UInt16 M68K_Read16(M68KAddressSpace* as, UInt32 addr);
+extern void M68K_Write32(M68KAddressSpace* as, UInt32 addr, UInt32 value);
+
+#define M68K_TB_BLOCKS      512     /* direct-mapped on the start PC */
+#define M68K_TB_OPS         4096    /* shared by all blocks; full means flush */
+#define M68K_TB_BLOCK_OPS   32      /* longest block */
+#define M68K_TB_MAX_INSN    10      /* longest 68000 instruction, in bytes */
+#define kM68KBlockEmpty     0xFFFFFFFFUL
+
+typedef struct M68KTOp M68KTOp;
+typedef void (*M68KTOpRun)(M68KAddressSpace* as, const M68KTOp* op);
+
+/* One recorded instruction. */
+struct M68KTOp {
+    M68KTOpRun    run;        /* resolved form, or NULL to call handler */
+    M68KOpHandler handler;
+    UInt32        pc;         /* address of the opcode word */
+    UInt32        target;     /* branch destination, when run is set */
+    UInt32        next;       /* address after the instruction, when run is set */
+    UInt16        opcode;
+};
+
+typedef struct M68KBlock {
+    UInt32  start;            /* PC of the first instruction, or kM68KBlockEmpty */
+    UInt32  end;              /* past the last byte it was translated from */
+    UInt16  firstOp;
+    UInt16  numOps;
+    Boolean chains;           /* leaves through a known address */
+    UInt8   nextLink;
+    UInt32  linkPC[2];        /* where it has gone, and the blocks there */
+    struct M68KBlock* link[2];
+} M68KBlock;
+
+struct M68KBlockCache {
+    M68KBlock blocks[M68K_TB_BLOCKS];
+    M68KTOp   ops[M68K_TB_OPS];
+    UInt32    nextOp;
+    UInt32    generation;     /* changes whenever a block might have gone */
+    UInt8     lines[M68K_CODE_LINE_BYTES];
+};
+
+static OSErr M68KThreaded_EnterAt(CPUAddressSpace as, CPUAddr entry,
+                                  CPUEnterFlags flags);
+static OSErr M68KThreaded_DestroyAddressSpace(CPUAddressSpace as);
+
+/*
+ * Everything but running code - memory, traps, stacks, the jump table - is
+ * the interpreter's, so an address space from either backend is the same
+ * M68KAddressSpace and code that looks inside one works with both.
+ */
+static ICPUBackend gM68KThreadedBackend;
+
+OSErr M68KThreadedBackend_Initialize(void)
+{
+    gM68KThreadedBackend = gM68KInterpreterBackend;
+    gM68KThreadedBackend.EnterAt = M68KThreaded_EnterAt;
+    gM68KThreadedBackend.DestroyAddressSpace = M68KThreaded_DestroyAddressSpace;
+    return CPUBackend_Register("m68k_threaded", &gM68KThreadedBackend);
+}
+
+static OSErr M68KThreaded_EnterAt(CPUAddressSpace as, CPUAddr entry,
+                                  CPUEnterFlags flags)
+{
+    return M68K_RunProgram((M68KAddressSpace*)as, entry, flags,
+                           M68KThreaded_Execute);
+}
+
+static OSErr M68KThreaded_DestroyAddressSpace(CPUAddressSpace as)
+{
+    M68KAddressSpace* mas = (M68KAddressSpace*)as;
+
+    if (mas && mas->blocks) {
+        DisposePtr((Ptr)mas->blocks);
+        mas->blocks = NULL;
+        mas->codeLines = NULL;
+    }
+    return gM68KInterpreterBackend.DestroyAddressSpace(as);
+}
+
+/*
+ * Block cache management
+ */
+
+static void M68KThreaded_Flush(struct M68KBlockCache* c)
+{
+    for (int i = 0; i < M68K_TB_BLOCKS; i++) {
+        c->blocks[i].start = kM68KBlockEmpty;
+    }
+    memset(c->lines, 0, sizeof(c->lines));
+    c->nextOp = 0;
+    c->generation++;
+}
+
+/* Made on first use, so an address space that is never run this way does not
+ * pay for one. */
+static struct M68KBlockCache* M68KThreaded_Cache(M68KAddressSpace* as)
+{
+    struct M68KBlockCache* c = as->blocks;
+
+    if (!c) {
+        c = (struct M68KBlockCache*)NewPtr(sizeof(struct M68KBlockCache));
+        if (!c) {
+            return NULL;
+        }
+        c->generation = 0;
+        M68KThreaded_Flush(c);
+        as->blocks = c;
+        as->codeLines = c->lines;
+    }
+    return c;
+}
+
+static void M68KThreaded_MarkLines(struct M68KBlockCache* c, UInt32 addr, UInt32 len)
+{
+    UInt32 line = (addr & (M68K_MAX_ADDR - 1)) >> M68K_CODE_LINE_SHIFT;
+    UInt32 last = ((addr + len - 1) & (M68K_MAX_ADDR - 1)) >> M68K_CODE_LINE_SHIFT;
+
+    for (;;) {
+        c->lines[line >> 3] |= (UInt8)(1 << (line & 7));
+        if (line == last) {
+            break;
+        }
+        line = (line + 1) & ((M68K_CODE_LINE_BYTES * 8) - 1);
+    }
+}
+
+/*
+ * M68K_InvalidateBlocks - drop blocks translated from [addr, addr+len)
+ *
+ * Reached from a store to a marked line, or from M68K_InvalidateCode. The
+ * line bits are left set: they only decide whether to look, and a false
+ * positive costs one scan.
+ */
+void M68K_InvalidateBlocks(M68KAddressSpace* as, UInt32 addr, UInt32 len)
+{
+    struct M68KBlockCache* c = as->blocks;
+    UInt32 end = addr + len;
+
+    if (!c || len == 0) {
+        return;
+    }
+
+    for (int i = 0; i < M68K_TB_BLOCKS; i++) {
+        M68KBlock* b = &c->blocks[i];
+        if (b->start != kM68KBlockEmpty && b->start < end && addr < b->end) {
+            b->start = kM68KBlockEmpty;
+        }
+    }
+    c->generation++;
+}
+
+/*
+ * Resolved branches
+ *
+ * The same effect as M68K_Op_BRA, BSR, Bcc and DBcc, with the displacement
+ * already added in.
+ */
+
+static void M68KThreaded_BRA(M68KAddressSpace* as, const M68KTOp* op)
+{
+    as->regs.pc = op->target;
+}
+
+static void M68KThreaded_BSR(M68KAddressSpace* as, const M68KTOp* op)
+{
+    as->regs.a[7] -= 4;
+    M68K_Write32(as, as->regs.a[7], op->next);
+    as->regs.pc = op->target;
+}
+
+static void M68KThreaded_Bcc(M68KAddressSpace* as, const M68KTOp* op)
+{
+    M68KCondition cc = (M68KCondition)((op->opcode >> 8) & 0xF);
+
+    as->regs.pc = M68K_Condition(as, cc) ? op->target : op->next;
+}
+
+static void M68KThreaded_DBcc(M68KAddressSpace* as, const M68KTOp* op)
+{
+    M68KCondition cc = (M68KCondition)((op->opcode >> 8) & 0xF);
+    UInt8 reg = op->opcode & 7;
+    SInt16 counter;
+
+    if (M68K_Condition(as, cc)) {
+        as->regs.pc = op->next;
+        return;
+    }
+
+    counter = (SInt16)(as->regs.d[reg] & 0xFFFF);
+    counter--;
+    as->regs.d[reg] = (as->regs.d[reg] & 0xFFFF0000) | (counter & 0xFFFF);
+    as->regs.pc = (counter != -1) ? op->target : op->next;
+}
+
+/* Fill in an op for the instruction at pc, resolving it if it is a branch.
+ * Reading a word displacement can fault, exactly where the handler's own
+ * fetch would have. */
+static void M68KThreaded_Bind(M68KAddressSpace* as, M68KTOp* op,
+                              UInt32 pc, UInt16 opcode)
+{
+    M68KOpHandler h = M68K_HandlerFor(opcode);
+    SInt32 disp;
+
+    op->run = NULL;
+    op->handler = h;
+    op->pc = pc;
+    op->opcode = opcode;
+
+    if (h == M68K_Op_BRA || h == M68K_Op_BSR || h == M68K_Op_Bcc) {
+        disp = (SInt8)(opcode & 0xFF);
+        op->next = pc + 2;
+        if (disp == 0) {
+            disp = SIGN_EXTEND_WORD(M68K_Read16(as, pc + 2));
+            op->next = pc + 4;
+        }
+        op->target = pc + 2 + disp;
+        op->run = (h == M68K_Op_BRA) ? M68KThreaded_BRA :
+                  (h == M68K_Op_BSR) ? M68KThreaded_BSR : M68KThreaded_Bcc;
+    } else if (h == M68K_Op_DBcc) {
+        disp = SIGN_EXTEND_WORD(M68K_Read16(as, pc + 2));
+        op->next = pc + 4;
+        op->target = pc + 2 + disp;
+        op->run = M68KThreaded_DBcc;
+    }
+}
+
+/* Anything that can leave other than to the next instruction ends a block. An
+ * instruction that faults halts the CPU, which stops the block anyway. */
+static Boolean M68KThreaded_EndsBlock(M68KOpHandler h)
+{
+    return h == M68K_Op_BRA  || h == M68K_Op_BSR  || h == M68K_Op_Bcc  ||
+           h == M68K_Op_DBcc || h == M68K_Op_JMP  || h == M68K_Op_JSR  ||
+           h == M68K_Op_RTS  || h == M68K_Op_RTR  || h == M68K_Op_RTE  ||
+           h == M68K_Op_TRAP || h == M68K_Op_STOP;
+}
+
+static void M68KThreaded_RunOp(M68KAddressSpace* as, const M68KTOp* op)
+{
+    as->regs.pc = op->pc + 2;
+    if (op->run) {
+        op->run(as, op);
+    } else {
+        op->handler(as, op->opcode);
+    }
+}
+
+/*
+ * Run from the current PC, recording as it goes, and enter what was run as a
+ * block. Returns how many instructions ran. No block is entered if one of
+ * them faulted, or if a store landed on code while recording - the recording
+ * may not be what is in memory any more.
+ */
+static UInt32 M68KThreaded_Translate(M68KAddressSpace* as, struct M68KBlockCache* c,
+                                     UInt32 budget, M68KBlock** out)
+{
+    UInt32 start = as->regs.pc;
+    UInt32 end = start;
+    UInt32 gen;
+    M68KTOp* ops;
+    M68KBlock* b;
+    UInt32 n = 0;
+    Boolean chains = true;
+
+    *out = NULL;
+
+    if (c->nextOp + M68K_TB_BLOCK_OPS > M68K_TB_OPS) {
+        M68KThreaded_Flush(c);
+    }
+    ops = &c->ops[c->nextOp];
+    gen = c->generation;
+
+    while (n < M68K_TB_BLOCK_OPS && n < budget) {
+        UInt32 pc = as->regs.pc;
+        M68KTOp* op = &ops[n];
+        UInt16 opcode;
+
+        /* Marked before it runs, so a store over it is noticed. */
+        M68KThreaded_MarkLines(c, pc, M68K_TB_MAX_INSN);
+
+        opcode = M68K_Fetch16(as);
+        n++;
+        if (as->halted) {
+            return n;
+        }
+        M68KThreaded_Bind(as, op, pc, opcode);
+        if (as->halted) {
+            return n;
+        }
+        M68KThreaded_RunOp(as, op);
+        if (as->halted || c->generation != gen) {
+            return n;
+        }
+
+        if (M68KThreaded_EndsBlock(op->handler)) {
+            chains = (op->run != NULL);
+            end = pc + M68K_TB_MAX_INSN;
+            break;
+        }
+        end = as->regs.pc;
+    }
+
+    b = &c->blocks[(start >> 1) & (M68K_TB_BLOCKS - 1)];
+    b->start = start;
+    b->end = end;
+    b->firstOp = (UInt16)c->nextOp;
+    b->numOps = (UInt16)n;
+    b->chains = chains;
+    b->nextLink = 0;
+    b->linkPC[0] = b->linkPC[1] = kM68KBlockEmpty;
+    b->link[0] = b->link[1] = NULL;
+    c->nextOp += n;
+
+    *out = b;
+    return n;
+}
+
+/*
+ * M68KThreaded_Execute - M68K_Execute, a block at a time
+ *
+ * Stops in the same places: after maxInstructions, on a fault, or on
+ * reaching the return sentinel. A block is cut short to stay inside the
+ * budget.
+ */
+OSErr M68KThreaded_Execute(M68KAddressSpace* as, UInt32 startPC, UInt32 maxInstructions)
+{
+    struct M68KBlockCache* c;
+    M68KBlock* prev = NULL;
+    UInt32 count = 0;
+
+    if (!as) {
+        return paramErr;
+    }
+
+    c = M68KThreaded_Cache(as);
+    if (!c) {
+        return M68K_Execute(as, startPC, maxInstructions);
+    }
+
+    as->regs.pc = startPC;
+    as->halted = false;
+
+    while (count < maxInstructions && !as->halted) {
+        UInt32 pc = as->regs.pc;
+        M68KBlock* b = NULL;
+        const M68KTOp* op;
+        UInt32 gen, n, i;
+        Boolean completed = true;
+
+        if (pc == kM68KReturnSentinel) {
+            as->halted = true;      /* the program returned to its caller */
+            break;
+        }
+
+        if (prev) {
+            if (prev->linkPC[0] == pc && prev->link[0] && prev->link[0]->start == pc) {
+                b = prev->link[0];
+            } else if (prev->linkPC[1] == pc && prev->link[1] && prev->link[1]->start == pc) {
+                b = prev->link[1];
+            }
+        }
+
+        if (!b) {
+            b = &c->blocks[(pc >> 1) & (M68K_TB_BLOCKS - 1)];
+            if (b->start != pc) {
+                /* An odd PC faults on its first access; not worth a block. */
+                if (pc & 1) {
+                    M68K_Step(as);
+                    count++;
+                    prev = NULL;
+                    continue;
+                }
+                count += M68KThreaded_Translate(as, c, maxInstructions - count, &b);
+                prev = (b && b->chains) ? b : NULL;
+                continue;
+            }
+            if (prev) {
+                i = prev->nextLink++ & 1;
+                prev->linkPC[i] = pc;
+                prev->link[i] = b;
+            }
+        }
+
+        op = &c->ops[b->firstOp];
+        n = b->numOps;
+        if (n > maxInstructions - count) {
+            n = maxInstructions - count;
+            completed = false;
+        }
+        gen = c->generation;
+
+        for (i = 0; i < n; i++, op++) {
+            as->regs.pc = op->pc + 2;
+            if (op->run) {
+                op->run(as, op);
+            } else {
+                op->handler(as, op->opcode);
+            }
+            if (as->halted || c->generation != gen) {
+                i++;
+                completed = false;
+                break;
+            }
+        }
+        count += i;
+
+        prev = (completed && b->chains) ? b : NULL;
+    }
+
+    M68K_FlagsSync(as);
+    return noErr;
+}
@@ -19,10 +19,12 @@
 #include "CPU/PPCInterp.h"
 #include "CPU/PPCOpcodes.h"
 #include "CPU/CPUBackend.h"
+#include "CPU/CPULogging.h"
 #include "CPU/LowMemGlobals.h"
 #include "SegmentLoader/SegmentLoader.h"
 #include "MemoryMgr/MemoryManager.h"
 #include "System71StdLib.h"
+#include "TimeManager/TimeBase.h"
 #include <string.h>
 
 /* Forward declarations of ICPUBackend methods */
@@ -50,6 +52,10 @@ static OSErr PPC_WriteMemory(CPUAddressSpace as, CPUAddr addr,
                              const void* data, Size len);
 static OSErr PPC_ReadMemory(CPUAddressSpace as, CPUAddr addr,
                             void* data, Size len);
+static OSErr PPC_MapPaged(CPUAddressSpace as, Size len, CPUPageInProc pageIn,
+                          void* refCon, CPUAddr* outBase);
+static OSErr PPC_CallRoutine(CPUAddressSpace as, CPUAddr routine,
+                             const UInt32* args, UInt16 argCount, UInt32* outResult);
 
 /*
  * Global PowerPC Backend Instance
@@ -68,14 +74,19 @@ const ICPUBackend gPPCInterpreterBackend = {
     .Relocate = PPC_Relocate,
     .AllocateMemory = PPC_AllocateMemory,
     .WriteMemory = PPC_WriteMemory,
-    .ReadMemory = PPC_ReadMemory
+    .ReadMemory = PPC_ReadMemory,
+    .MapPaged = PPC_MapPaged,
+    .CallRoutine = PPC_CallRoutine
 };
 
 /*
  * PowerPC Backend Initialization
  */
+static void PPC_BuildDispatchTables(void);
+
 OSErr PPCBackend_Initialize(void)
 {
+    PPC_BuildDispatchTables();
     return CPUBackend_Register("ppc_interp", &gPPCInterpreterBackend);
 }
 
@@ -88,8 +99,12 @@ static OSErr PPC_CreateAddressSpace(void* processHandle, CPUAddressSpace* out)
 
     (void)processHandle; /* Unused for now */
 
-    serial_printf("[PPC] CreateAddressSpace: allocating PPCAddressSpace struct size=%u\n",
-                  (unsigned)sizeof(PPCAddressSpace));
+    /* Nothing registers this backend at boot yet, so whoever makes the first
+     * address space is the first who can need the tables. */
+    PPC_BuildDispatchTables();
+
+    PPC_LOG_INFO("CreateAddressSpace: allocating PPCAddressSpace struct size=%u\n",
+                 (unsigned)sizeof(PPCAddressSpace));
     as = (PPCAddressSpace*)NewPtr(sizeof(PPCAddressSpace));
     if (!as) {
         serial_printf("[PPC] FAIL: struct allocation memFullErr, MemError=%d\n", MemError());
@@ -102,7 +117,7 @@ static OSErr PPC_CreateAddressSpace(void* processHandle, CPUAddressSpace* out)
     /* Initialize page table (all NULL = not allocated) */
     memset(as->pageTable, 0, sizeof(as->pageTable));
 
-    serial_printf("[PPC] CreateAddressSpace: sparse 16MB virtual space ready\n");
+    PPC_LOG_INFO("CreateAddressSpace: sparse 16MB virtual space ready\n");
 
     /* Initialize registers */
     memset(&as->regs, 0, sizeof(PPCRegs));
@@ -137,15 +152,16 @@ static OSErr PPC_DestroyAddressSpace(CPUAddressSpace as)
             }
             pas->pageTable[i] = NULL;
         }
+        if (pas->decoded[i]) {
+            DisposePtr((Ptr)pas->decoded[i]);
+            pas->decoded[i] = NULL;
+        }
     }
 
     DisposePtr((Ptr)pas);
     return noErr;
 }
 
-/* Forward declaration */
-void* PPC_GetPage(PPCAddressSpace* as, UInt32 addr, Boolean allocate);
-
 /*
  * PPC_MemCopy - Copy data to paged memory (lazy page allocation)
  */
@@ -153,6 +169,9 @@ static OSErr PPC_MemCopy(PPCAddressSpace* as, UInt32 addr, const void* src, Size
 {
     const UInt8* srcBytes = (const UInt8*)src;
 
+    /* Stores straight into the pages, behind PPC_Write8's back */
+    PPC_InvalidateCode(as, addr, (UInt32)len);
+
     for (Size i = 0; i < len; i++) {
         void* page = PPC_GetPage(as, addr + i, true);
         if (!page) {
@@ -164,6 +183,46 @@ static OSErr PPC_MemCopy(PPCAddressSpace* as, UInt32 addr, const void* src, Size
     return noErr;
 }
 
+/*
+ * PPC_PageIn - fill a missing page that lies in a MapPaged range
+ *
+ * MapPaged ranges are page-aligned, so the page is the range's alone and
+ * nothing else can have made it exist first. NULL if addr is in no range, or
+ * the image could not be read - the access then faults like any other to a
+ * missing page.
+ */
+static void* PPC_PageIn(PPCAddressSpace* as, UInt32 addr)
+{
+    UInt32 pageStart = addr & ~(UInt32)(PPC_PAGE_SIZE - 1);
+
+    for (int i = 0; i < as->numPagers; i++) {
+        PPCPager* pg = &as->pagers[i];
+        UInt32 len;
+        void* page;
+
+        if (addr < pg->base || addr - pg->base >= pg->size) {
+            continue;
+        }
+        page = NewPtr(PPC_PAGE_SIZE);
+        if (!page) {
+            return NULL;
+        }
+        memset(page, 0, PPC_PAGE_SIZE);
+        len = pg->size - (pageStart - pg->base);
+        if (len > PPC_PAGE_SIZE) {
+            len = PPC_PAGE_SIZE;
+        }
+        if (pg->pageIn(pg->refCon, pageStart - pg->base, page, len) != noErr) {
+            DisposePtr((Ptr)page);
+            return NULL;
+        }
+        as->pageTable[addr >> PPC_PAGE_SHIFT] = page;
+        PPC_LOG_DEBUG("Paged in page %u for addr 0x%08X\n", addr >> PPC_PAGE_SHIFT, addr);
+        return page;
+    }
+    return NULL;
+}
+
 /*
  * PPC_GetPage - Get page for address, allocating if needed (lazy allocation)
  * Returns NULL if address out of range or allocation fails
@@ -181,13 +240,18 @@ void* PPC_GetPage(PPCAddressSpace* as, UInt32 addr, Boolean allocate)
     pageNum = addr >> PPC_PAGE_SHIFT;
     page = as->pageTable[pageNum];
 
+    /* Demand-paged: filled from its image, whether or not allocate is set */
+    if (!page && as->numPagers) {
+        page = PPC_PageIn(as, addr);
+    }
+
     /* If page not allocated and allocation requested, allocate now */
     if (!page && allocate) {
         page = NewPtr(PPC_PAGE_SIZE);
         if (page) {
             memset(page, 0, PPC_PAGE_SIZE);
             as->pageTable[pageNum] = page;
-            serial_printf("[PPC] Allocated page %u for addr 0x%08X\n", pageNum, addr);
+            PPC_LOG_DEBUG("Allocated page %u for addr 0x%08X\n", pageNum, addr);
         } else {
             serial_printf("[PPC] FAIL: page %u allocation failed, MemError=%d\n",
                          pageNum, MemError());
@@ -393,19 +457,23 @@ static OSErr PPC_MakeLazyJTStub(CPUAddressSpace as, CPUAddr slotAddr,
     }
 
     /*
-     * Create lazy stub that triggers _LoadSeg via system call:
+     * Create lazy stub that triggers _LoadSeg via system call, which takes
+     * its trap number in r0:
      *
      *   +0: 0x38600000 | segID    ; li r3, segID
-     *   +4: 0x44000002             ; sc (system call)
-     *   +8: 0x4E800020             ; blr (return)
+     *   +4: 0x380000F0             ; li r0, _LoadSeg & 0xFF
+     *   +8: 0x44000002             ; sc (system call)
+     *  +12: 0x4E800020             ; blr (return)
      */
     UInt32 li_insn = 0x38600000 | (segID & 0xFFFF);
+    UInt32 trap_insn = 0x380000F0;
     UInt32 sc_insn = 0x44000002;
     UInt32 blr_insn = 0x4E800020;
 
     PPC_Write32(pas, slotAddr + 0, li_insn);
-    PPC_Write32(pas, slotAddr + 4, sc_insn);
-    PPC_Write32(pas, slotAddr + 8, blr_insn);
+    PPC_Write32(pas, slotAddr + 4, trap_insn);
+    PPC_Write32(pas, slotAddr + 8, sc_insn);
+    PPC_Write32(pas, slotAddr + 12, blr_insn);
 
     (void)routineOffset; /* PowerPC segments are entered at their base */
 
@@ -424,7 +492,7 @@ static OSErr PPC_EnterAt(CPUAddressSpace as, CPUAddr entry, CPUEnterFlags flags)
         return paramErr;
     }
 
-    serial_printf("[PPC] EnterAt: entry=0x%08X flags=0x%04X\n", entry, flags);
+    PPC_LOG_DEBUG("EnterAt: entry=0x%08X flags=0x%04X\n", entry, flags);
 
     /* Clear halted flag */
     pas->halted = false;
@@ -433,7 +501,7 @@ static OSErr PPC_EnterAt(CPUAddressSpace as, CPUAddr entry, CPUEnterFlags flags)
     PPC_Execute(pas, entry, max_instructions);
 
     if (pas->halted) {
-        serial_printf("[PPC] Execution halted at PC=0x%08X\n", pas->regs.pc);
+        PPC_LOG_INFO("Execution halted at PC=0x%08X\n", pas->regs.pc);
     } else {
         serial_printf("[PPC] Execution completed after %u instructions\n", max_instructions);
     }
@@ -595,42 +663,84 @@ static OSErr PPC_Relocate(CPUAddressSpace as, CPUCodeHandle code,
     return noErr;
 }
 
+/*
+ * PPC_FindFree - first 16-byte boundary at or above from past everything
+ * mapped or allocated so far (a bump allocator: nothing is ever given back)
+ */
+static UInt32 PPC_FindFree(PPCAddressSpace* pas, UInt32 from)
+{
+    for (int i = 0; i < pas->numCodeSegs; i++) {
+        UInt32 end = pas->codeSegBases[i] + pas->codeSegSizes[i];
+        if (end > from) {
+            from = end;
+        }
+    }
+    return (from + 15) & ~15;
+}
+
+/*
+ * PPC_TrackRegion - enter an allocation in the segment table, which is what
+ * PPC_FindFree steps over
+ */
+static OSErr PPC_TrackRegion(PPCAddressSpace* pas, UInt32 addr, Size size)
+{
+    if (pas->numCodeSegs >= 256) {
+        return memFullErr;
+    }
+    pas->codeSegments[pas->numCodeSegs] = NULL;
+    pas->codeSegBases[pas->numCodeSegs] = addr;
+    pas->codeSegSizes[pas->numCodeSegs] = size;
+    pas->numCodeSegs++;
+    return noErr;
+}
+
 /*
  * AllocateMemory - Allocate memory in CPU address space
+ *
+ * This used to zero the range with PPC_Write8, which faults on a page that
+ * does not exist yet - so on every byte of a fresh allocation - and it kept
+ * no record, so the next call returned the same range. The pages are now
+ * made here and the range is tracked like a mapped segment.
  */
 static OSErr PPC_AllocateMemory(CPUAddressSpace as, Size size,
                                 CPUMapFlags flags, CPUAddr* outAddr)
 {
     PPCAddressSpace* pas = (PPCAddressSpace*)as;
-    UInt32 addr;
-    extern void PPC_Write8(PPCAddressSpace* as, UInt32 addr, UInt8 value);
+    UInt32 addr, at, end;
 
     if (!pas || !outAddr) {
         return paramErr;
     }
 
     /* Find free space (simple bump allocator) */
-    addr = 0x10000; /* Start at 64K */
-    for (int i = 0; i < pas->numCodeSegs; i++) {
-        UInt32 end = pas->codeSegBases[i] + pas->codeSegSizes[i];
-        if (end > addr) {
-            addr = end;
-        }
-    }
-
-    /* Align to 16-byte boundary */
-    addr = (addr + 15) & ~15;
+    addr = PPC_FindFree(pas, 0x10000); /* Start at 64K */
 
     /* Check bounds */
-    if (addr + size > PPC_MAX_ADDR) {
+    if (size > PPC_MAX_ADDR || addr + size > PPC_MAX_ADDR) {
         return memFullErr;
     }
 
-    /* Zero memory */
-    for (Size i = 0; i < size; i++) {
-        PPC_Write8(pas, addr + i, 0);
+    /* Zero memory. A new page arrives zeroed; one already there is shared
+     * with whatever was allocated before, and only this range is cleared. */
+    end = addr + size;
+    for (at = addr; at < end; at = (at | (PPC_PAGE_SIZE - 1)) + 1) {
+        UInt8* page = (UInt8*)PPC_GetPage(pas, at, true);
+        UInt32 off = at & (PPC_PAGE_SIZE - 1);
+        UInt32 n = PPC_PAGE_SIZE - off;
+
+        if (!page) {
+            return memFullErr;
+        }
+        if (n > end - at) {
+            n = end - at;
+        }
+        memset(page + off, 0, n);
     }
+    PPC_InvalidateCode(pas, addr, size);
 
+    if (PPC_TrackRegion(pas, addr, size) != noErr) {
+        return memFullErr;
+    }
     *outAddr = addr;
 
     (void)flags; /* Unused for now */
@@ -674,1575 +784,1518 @@ static OSErr PPC_ReadMemory(CPUAddressSpace as, CPUAddr addr,
 }
 
 /*
- * Opcode Handler Forward Declarations (from PPCOpcodes.c)
+ * MapPaged - Reserve a range filled page by page on first touch
+ *
+ * The range starts and ends on page boundaries, so every page in it belongs
+ * to it alone and is still missing when first touched; PPC_GetPage fills it
+ * then. The allocator steps over the whole reservation from now on.
  */
-extern UInt32 PPC_Fetch32(PPCAddressSpace* as);
+static OSErr PPC_MapPaged(CPUAddressSpace as, Size len, CPUPageInProc pageIn,
+                          void* refCon, CPUAddr* outBase)
+{
+    PPCAddressSpace* pas = (PPCAddressSpace*)as;
+    UInt32 addr, span;
+    PPCPager* pg;
+
+    if (!pas || !pageIn || !outBase || len == 0 || len > PPC_MAX_ADDR) {
+        return paramErr;
+    }
+    if (pas->numPagers >= PPC_MAX_PAGERS) {
+        return memFullErr;
+    }
+
+    addr = PPC_FindFree(pas, 0x10000);
+    addr = (addr + PPC_PAGE_SIZE - 1) & ~(UInt32)(PPC_PAGE_SIZE - 1);
+    span = ((UInt32)len + PPC_PAGE_SIZE - 1) & ~(UInt32)(PPC_PAGE_SIZE - 1);
+    if (addr + span > PPC_MAX_ADDR) {
+        return memFullErr;
+    }
+    if (PPC_TrackRegion(pas, addr, span) != noErr) {
+        return memFullErr;
+    }
+
+    pg = &pas->pagers[pas->numPagers++];
+    pg->base = addr;
+    pg->size = (UInt32)len;
+    pg->pageIn = pageIn;
+    pg->refCon = refCon;
+
+    *outBase = addr;
+    return noErr;
+}
 
 /*
- * PPC_Step - Fetch and execute one instruction
+ * CallRoutine - Run a routine through its TVector until it returns
+ *
+ * The routine is entered with r2 its TOC, the arguments in r3 up, and lr
+ * pointing at a word of our own; it has returned when pc arrives there.
+ * Stepping one instruction at a time is what lets us stop exactly on that
+ * return. A routine called from inside a trap handler gets a frame below
+ * the trapping code's red zone; otherwise it runs on a stack of its own.
  */
-OSErr PPC_Step(PPCAddressSpace* as)
-{
-    UInt32 insn;
-    UInt8 primary;
-    UInt16 extended;
+#define kPPCCallStackSize   0x4000
+#define kPPCCallRedZone     224         /* below r1 that a leaf may use */
+#define kPPCCallLimit       1000000     /* instructions before we give up */
 
-    if (!as) {
+static OSErr PPC_CallRoutine(CPUAddressSpace as, CPUAddr routine,
+                             const UInt32* args, UInt16 argCount, UInt32* outResult)
+{
+    PPCAddressSpace* pas = (PPCAddressSpace*)as;
+    PPCRegs saved;
+    Boolean wasHalted;
+    UInt8 tv[8];
+    UInt32 sp, n;
+    Boolean returned;
+    OSErr err;
+
+    if (!pas || argCount > 8 || (argCount && !args)) {
         return paramErr;
     }
+    err = PPC_ReadMemory(as, routine, tv, sizeof(tv));
+    if (err != noErr) {
+        return err;
+    }
 
-    if (as->halted) {
-        return noErr;
+    if (!pas->callReturn) {
+        static const UInt8 spin[4] = { 0x48, 0x00, 0x00, 0x00 };  /* b . */
+        err = PPC_AllocateMemory(as, sizeof(spin), kCPUMapExecutable, &pas->callReturn);
+        if (err == noErr) {
+            err = PPC_WriteMemory(as, pas->callReturn, spin, sizeof(spin));
+        }
+        if (err != noErr) {
+            pas->callReturn = 0;
+            return err;
+        }
     }
 
-    /* Fetch instruction (32-bit) */
-    insn = PPC_Fetch32(as);
+    sp = pas->regs.gpr[1];
+    if (sp) {
+        sp -= kPPCCallRedZone;
+    } else {
+        if (!pas->callStack) {
+            err = PPC_AllocateMemory(as, kPPCCallStackSize, 0, &pas->callStack);
+            if (err != noErr) {
+                pas->callStack = 0;
+                return err;
+            }
+        }
+        sp = pas->callStack + kPPCCallStackSize;
+    }
+    sp = (sp - 64) & ~(UInt32)15;     /* linkage area for the callee */
+
+    saved = pas->regs;
+    wasHalted = pas->halted;
+
+    pas->regs.gpr[1] = sp;
+    pas->regs.gpr[2] = ((UInt32)tv[4] << 24) | ((UInt32)tv[5] << 16) |
+                       ((UInt32)tv[6] << 8) | tv[7];
+    for (UInt16 i = 0; i < argCount; i++) {
+        pas->regs.gpr[3 + i] = args[i];
+    }
+    pas->regs.lr = pas->callReturn;
+    pas->regs.pc = ((UInt32)tv[0] << 24) | ((UInt32)tv[1] << 16) |
+                   ((UInt32)tv[2] << 8) | tv[3];
+    pas->halted = false;
+
+    for (n = 0; n < kPPCCallLimit && !pas->halted && pas->regs.pc != pas->callReturn; n++) {
+        PPC_Step(pas);
+    }
+    returned = !pas->halted && pas->regs.pc == pas->callReturn;
+    if (returned && outResult) {
+        *outResult = pas->regs.gpr[3];
+    }
+    if (!returned) {
+        serial_printf("[PPC] CallRoutine: routine at TVector 0x%08X %s at PC=0x%08X\n",
+                      routine, pas->halted ? "faulted" : "did not return", pas->regs.pc);
+    }
+
+    pas->regs = saved;
+    pas->halted = wasHalted;
+    return returned ? noErr : segmentLoaderErr;
+}
+
+/*
+ * Opcode Handler Forward Declarations (from PPCOpcodes.c)
+ */
+extern UInt32 PPC_Fetch32(PPCAddressSpace* as);
+
+/*
+ * Handlers for encodings with no instruction behind them, reporting what the
+ * default cases of the old dispatch switch reported.
+ */
+static void PPC_Op_Illegal(PPCAddressSpace* as, UInt32 insn)
+{
+    serial_printf("[PPC] ILLEGAL opcode 0x%08X (primary=0x%02X) at PC=0x%08X\n",
+                  insn, PPC_PRIMARY_OPCODE(insn), as->regs.pc - 4);
+    PPC_Fault(as, "Illegal opcode");
+}
+
+static void PPC_Op_UnimplementedAltiVec(PPCAddressSpace* as, UInt32 insn)
+{
+    (void)insn;
+    PPC_Fault(as, "Unimplemented AltiVec opcode");
+}
+
+static void PPC_Op_Unimplemented19(PPCAddressSpace* as, UInt32 insn)
+{
+    (void)insn;
+    PPC_Fault(as, "Unimplemented opcode 19 extended");
+}
+
+static void PPC_Op_Unimplemented31(PPCAddressSpace* as, UInt32 insn)
+{
+    (void)insn;
+    PPC_Fault(as, "Unimplemented opcode 31 extended");
+}
+
+static void PPC_Op_Unimplemented59(PPCAddressSpace* as, UInt32 insn)
+{
+    (void)insn;
+    PPC_Fault(as, "Unimplemented opcode 59 extended");
+}
+
+static void PPC_Op_Unimplemented63(PPCAddressSpace* as, UInt32 insn)
+{
+    (void)insn;
+    PPC_Fault(as, "Unimplemented opcode 63 extended");
+}
+
+/* The OE bit of an XO-form instruction (bit 10 of the word) as it lands in
+ * the ten-bit extended opcode. The cases below used to test it in the word,
+ * but only after matching an extended opcode that had it clear, so addo,
+ * subfo, nego, mullwo and divwo all went to the default case and faulted. */
+#define PPC_XOP_OE  0x200
+
+/* The A-form floating-point instructions - fmul, fmadd and the rest - keep
+ * their opcode in five bits and put frC where an X-form opcode continues, so
+ * fmul f1,f2,f3 has extended opcode (3 << 5) | 25. They used to match only
+ * with frC (or, for fmul, every operand) zero. No X-form opcode in groups 59
+ * and 63 has bit 4 set; every A-form one does, and is named by its low five. */
+#define PPC_FP_EXTENDED_OPCODE(insn) \
+    ((PPC_EXTENDED_OPCODE(insn) & 0x10) ? (PPC_EXTENDED_OPCODE(insn) & 0x1F) \
+                                        : PPC_EXTENDED_OPCODE(insn))
+
+/*
+ * PPC_DecodeInsn - which handler an instruction word belongs to
+ *
+ * This is the switch PPC_Step used to run on every instruction. It depends
+ * only on the primary opcode and, for the five groups, the extended opcode,
+ * so it now runs once for each of those when the tables are built.
+ */
+static PPCOpHandler PPC_DecodeInsn(UInt32 insn)
+{
+    UInt8 primary;
+    UInt16 extended;
 
     /* Extract primary opcode (bits 0-5) */
     primary = PPC_PRIMARY_OPCODE(insn);
 
-    /* Decode and dispatch */
     switch (primary) {
         case PPC_OP_TWI:         /* 3 */
-            PPC_Op_TWI(as, insn);
-            break;
+            return PPC_Op_TWI;
 
         case PPC_OP_EXT4:        /* 4 - AltiVec/VMX vector operations */
             extended = (insn & 0x7FF);  /* 11-bit extended opcode for AltiVec */
             switch (extended) {
                 case PPC_VXO_VADDUBM:
-                    PPC_Op_VADDUBM(as, insn);
-                    break;
+                    return PPC_Op_VADDUBM;
 
                 case PPC_VXO_VADDUHM:
-                    PPC_Op_VADDUHM(as, insn);
-                    break;
+                    return PPC_Op_VADDUHM;
 
                 case PPC_VXO_VADDUWM:
-                    PPC_Op_VADDUWM(as, insn);
-                    break;
+                    return PPC_Op_VADDUWM;
 
                 case PPC_VXO_VSUBUBM:
-                    PPC_Op_VSUBUBM(as, insn);
-                    break;
+                    return PPC_Op_VSUBUBM;
 
                 case PPC_VXO_VSUBUHM:
-                    PPC_Op_VSUBUHM(as, insn);
-                    break;
+                    return PPC_Op_VSUBUHM;
 
                 case PPC_VXO_VSUBUWM:
-                    PPC_Op_VSUBUWM(as, insn);
-                    break;
+                    return PPC_Op_VSUBUWM;
 
                 case PPC_VXO_VAND:
-                    PPC_Op_VAND(as, insn);
-                    break;
+                    return PPC_Op_VAND;
 
                 case PPC_VXO_VANDC:
-                    PPC_Op_VANDC(as, insn);
-                    break;
+                    return PPC_Op_VANDC;
 
                 case PPC_VXO_VOR:
-                    PPC_Op_VOR(as, insn);
-                    break;
+                    return PPC_Op_VOR;
 
                 case PPC_VXO_VXOR:
-                    PPC_Op_VXOR(as, insn);
-                    break;
+                    return PPC_Op_VXOR;
 
                 case PPC_VXO_VNOR:
-                    PPC_Op_VNOR(as, insn);
-                    break;
+                    return PPC_Op_VNOR;
 
                 case PPC_VXO_VORC:
-                    PPC_Op_VORC(as, insn);
-                    break;
+                    return PPC_Op_VORC;
 
                 case PPC_VXO_VSPLTISB:
-                    PPC_Op_VSPLTISB(as, insn);
-                    break;
+                    return PPC_Op_VSPLTISB;
 
                 case PPC_VXO_VSPLTISH:
-                    PPC_Op_VSPLTISH(as, insn);
-                    break;
+                    return PPC_Op_VSPLTISH;
 
                 case PPC_VXO_VSPLTISW:
-                    PPC_Op_VSPLTISW(as, insn);
-                    break;
+                    return PPC_Op_VSPLTISW;
 
                 /* Saturating arithmetic */
                 case PPC_VXO_VADDSBS:
-                    PPC_Op_VADDSBS(as, insn);
-                    break;
+                    return PPC_Op_VADDSBS;
 
                 case PPC_VXO_VADDUBS:
-                    PPC_Op_VADDUBS(as, insn);
-                    break;
+                    return PPC_Op_VADDUBS;
 
                 case PPC_VXO_VADDSHS:
-                    PPC_Op_VADDSHS(as, insn);
-                    break;
+                    return PPC_Op_VADDSHS;
 
                 case PPC_VXO_VADDUHS:
-                    PPC_Op_VADDUHS(as, insn);
-                    break;
+                    return PPC_Op_VADDUHS;
 
                 case PPC_VXO_VSUBSBS:
-                    PPC_Op_VSUBSBS(as, insn);
-                    break;
+                    return PPC_Op_VSUBSBS;
 
                 case PPC_VXO_VSUBUBS:
-                    PPC_Op_VSUBUBS(as, insn);
-                    break;
+                    return PPC_Op_VSUBUBS;
 
                 case PPC_VXO_VSUBSHS:
-                    PPC_Op_VSUBSHS(as, insn);
-                    break;
+                    return PPC_Op_VSUBSHS;
 
                 case PPC_VXO_VSUBUHS:
-                    PPC_Op_VSUBUHS(as, insn);
-                    break;
+                    return PPC_Op_VSUBUHS;
 
                 /* Shift */
                 case PPC_VXO_VSLB:
-                    PPC_Op_VSLB(as, insn);
-                    break;
+                    return PPC_Op_VSLB;
 
                 case PPC_VXO_VSRB:
-                    PPC_Op_VSRB(as, insn);
-                    break;
+                    return PPC_Op_VSRB;
 
                 case PPC_VXO_VSRAB:
-                    PPC_Op_VSRAB(as, insn);
-                    break;
+                    return PPC_Op_VSRAB;
 
                 case PPC_VXO_VSLH:
-                    PPC_Op_VSLH(as, insn);
-                    break;
+                    return PPC_Op_VSLH;
 
                 case PPC_VXO_VSRH:
-                    PPC_Op_VSRH(as, insn);
-                    break;
+                    return PPC_Op_VSRH;
 
                 case PPC_VXO_VSRAW:
-                    PPC_Op_VSRAW(as, insn);
-                    break;
+                    return PPC_Op_VSRAW;
 
                 /* Pack/Unpack */
                 case PPC_VXO_VPKUHUM:
-                    PPC_Op_VPKUHUM(as, insn);
-                    break;
+                    return PPC_Op_VPKUHUM;
 
                 case PPC_VXO_VPKUWUM:
-                    PPC_Op_VPKUWUM(as, insn);
-                    break;
+                    return PPC_Op_VPKUWUM;
 
                 case PPC_VXO_VPKPX:
-                    PPC_Op_VPKPX(as, insn);
-                    break;
+                    return PPC_Op_VPKPX;
 
                 case PPC_VXO_VUPKHSB:
-                    PPC_Op_VUPKHSB(as, insn);
-                    break;
+                    return PPC_Op_VUPKHSB;
 
                 case PPC_VXO_VUPKLSB:
-                    PPC_Op_VUPKLSB(as, insn);
-                    break;
+                    return PPC_Op_VUPKLSB;
 
                 case PPC_VXO_VUPKHSH:
-                    PPC_Op_VUPKHSH(as, insn);
-                    break;
+                    return PPC_Op_VUPKHSH;
 
                 case PPC_VXO_VUPKLSH:
-                    PPC_Op_VUPKLSH(as, insn);
-                    break;
+                    return PPC_Op_VUPKLSH;
 
                 case PPC_VXO_VUPKHPX:
-                    PPC_Op_VUPKHPX(as, insn);
-                    break;
+                    return PPC_Op_VUPKHPX;
 
                 case PPC_VXO_VUPKLPX:
-                    PPC_Op_VUPKLPX(as, insn);
-                    break;
+                    return PPC_Op_VUPKLPX;
 
                 /* Merge */
                 case PPC_VXO_VMRGHB:
-                    PPC_Op_VMRGHB(as, insn);
-                    break;
+                    return PPC_Op_VMRGHB;
 
                 case PPC_VXO_VMRGLB:
-                    PPC_Op_VMRGLB(as, insn);
-                    break;
+                    return PPC_Op_VMRGLB;
 
                 /* Permute/Select */
                 case PPC_VXO_VPERM:
-                    PPC_Op_VPERM(as, insn);
-                    break;
+                    return PPC_Op_VPERM;
 
                 case PPC_VXO_VSEL:
-                    PPC_Op_VSEL(as, insn);
-                    break;
+                    return PPC_Op_VSEL;
 
                 /* Compare */
                 case PPC_VXO_VCMPEQUB:
-                    PPC_Op_VCMPEQUB(as, insn);
-                    break;
+                    return PPC_Op_VCMPEQUB;
 
                 case PPC_VXO_VCMPGTUB:
-                    PPC_Op_VCMPGTUB(as, insn);
-                    break;
+                    return PPC_Op_VCMPGTUB;
 
                 case PPC_VXO_VCMPGTSB:
-                    PPC_Op_VCMPGTSB(as, insn);
-                    break;
+                    return PPC_Op_VCMPGTSB;
 
                 case PPC_VXO_VCMPEQUH:
-                    PPC_Op_VCMPEQUH(as, insn);
-                    break;
+                    return PPC_Op_VCMPEQUH;
 
                 case PPC_VXO_VCMPEQUW:
-                    PPC_Op_VCMPEQUW(as, insn);
-                    break;
+                    return PPC_Op_VCMPEQUW;
 
                 /* Splat */
                 case PPC_VXO_VSPLTB:
-                    PPC_Op_VSPLTB(as, insn);
-                    break;
+                    return PPC_Op_VSPLTB;
 
                 case PPC_VXO_VSPLTH:
-                    PPC_Op_VSPLTH(as, insn);
-                    break;
+                    return PPC_Op_VSPLTH;
 
                 case PPC_VXO_VSPLTW:
-                    PPC_Op_VSPLTW(as, insn);
-                    break;
+                    return PPC_Op_VSPLTW;
 
                 /* Multiply */
                 case PPC_VXO_VMULESB:
-                    PPC_Op_VMULESB(as, insn);
-                    break;
+                    return PPC_Op_VMULESB;
 
                 case PPC_VXO_VMULOSB:
-                    PPC_Op_VMULOSB(as, insn);
-                    break;
+                    return PPC_Op_VMULOSB;
 
                 case PPC_VXO_VMULEUB:
-                    PPC_Op_VMULEUB(as, insn);
-                    break;
+                    return PPC_Op_VMULEUB;
 
                 case PPC_VXO_VMULOUB:
-                    PPC_Op_VMULOUB(as, insn);
-                    break;
+                    return PPC_Op_VMULOUB;
 
                 case PPC_VXO_VMULESH:
-                    PPC_Op_VMULESH(as, insn);
-                    break;
+                    return PPC_Op_VMULESH;
 
                 case PPC_VXO_VMULOSH:
-                    PPC_Op_VMULOSH(as, insn);
-                    break;
+                    return PPC_Op_VMULOSH;
 
                 case PPC_VXO_VMULEUH:
-                    PPC_Op_VMULEUH(as, insn);
-                    break;
+                    return PPC_Op_VMULEUH;
 
                 case PPC_VXO_VMULOUH:
-                    PPC_Op_VMULOUH(as, insn);
-                    break;
+                    return PPC_Op_VMULOUH;
 
                 /* Min/Max/Average */
                 case PPC_VXO_VMAXSB:
-                    PPC_Op_VMAXSB(as, insn);
-                    break;
+                    return PPC_Op_VMAXSB;
 
                 case PPC_VXO_VMAXUB:
-                    PPC_Op_VMAXUB(as, insn);
-                    break;
+                    return PPC_Op_VMAXUB;
 
                 case PPC_VXO_VMINSB:
-                    PPC_Op_VMINSB(as, insn);
-                    break;
+                    return PPC_Op_VMINSB;
 
                 case PPC_VXO_VMINUB:
-                    PPC_Op_VMINUB(as, insn);
-                    break;
+                    return PPC_Op_VMINUB;
 
                 case PPC_VXO_VMAXSH:
-                    PPC_Op_VMAXSH(as, insn);
-                    break;
+                    return PPC_Op_VMAXSH;
 
                 case PPC_VXO_VMINSH:
-                    PPC_Op_VMINSH(as, insn);
-                    break;
+                    return PPC_Op_VMINSH;
 
                 case PPC_VXO_VAVGSB:
-                    PPC_Op_VAVGSB(as, insn);
-                    break;
+                    return PPC_Op_VAVGSB;
 
                 case PPC_VXO_VAVGUB:
-                    PPC_Op_VAVGUB(as, insn);
-                    break;
+                    return PPC_Op_VAVGUB;
 
                 /* Rotate */
                 case PPC_VXO_VRLB:
-                    PPC_Op_VRLB(as, insn);
-                    break;
+                    return PPC_Op_VRLB;
 
                 case PPC_VXO_VRLH:
-                    PPC_Op_VRLH(as, insn);
-                    break;
+                    return PPC_Op_VRLH;
 
                 case PPC_VXO_VRLW:
-                    PPC_Op_VRLW(as, insn);
-                    break;
+                    return PPC_Op_VRLW;
 
                 /* Word Shift */
                 case PPC_VXO_VSLW:
-                    PPC_Op_VSLW(as, insn);
-                    break;
+                    return PPC_Op_VSLW;
 
                 case PPC_VXO_VSRW:
-                    PPC_Op_VSRW(as, insn);
-                    break;
+                    return PPC_Op_VSRW;
 
                 case PPC_VXO_VSLO:
-                    PPC_Op_VSLO(as, insn);
-                    break;
+                    return PPC_Op_VSLO;
 
                 case PPC_VXO_VSRO:
-                    PPC_Op_VSRO(as, insn);
-                    break;
+                    return PPC_Op_VSRO;
 
                 /* Merge Halfword/Word */
                 case PPC_VXO_VMRGHH:
-                    PPC_Op_VMRGHH(as, insn);
-                    break;
+                    return PPC_Op_VMRGHH;
 
                 case PPC_VXO_VMRGLH:
-                    PPC_Op_VMRGLH(as, insn);
-                    break;
+                    return PPC_Op_VMRGLH;
 
                 case PPC_VXO_VMRGHW:
-                    PPC_Op_VMRGHW(as, insn);
-                    break;
+                    return PPC_Op_VMRGHW;
 
                 case PPC_VXO_VMRGLW:
-                    PPC_Op_VMRGLW(as, insn);
-                    break;
+                    return PPC_Op_VMRGLW;
 
                 /* Additional Compare */
                 case PPC_VXO_VCMPGTUH:
-                    PPC_Op_VCMPGTUH(as, insn);
-                    break;
+                    return PPC_Op_VCMPGTUH;
 
                 case PPC_VXO_VCMPGTSH:
-                    PPC_Op_VCMPGTSH(as, insn);
-                    break;
+                    return PPC_Op_VCMPGTSH;
 
                 case PPC_VXO_VCMPGTUW:
-                    PPC_Op_VCMPGTUW(as, insn);
-                    break;
+                    return PPC_Op_VCMPGTUW;
 
                 case PPC_VXO_VCMPGTSW:
-                    PPC_Op_VCMPGTSW(as, insn);
-                    break;
+                    return PPC_Op_VCMPGTSW;
 
                 /* Additional Pack */
                 case PPC_VXO_VPKUHUS:
-                    PPC_Op_VPKUHUS(as, insn);
-                    break;
+                    return PPC_Op_VPKUHUS;
 
                 case PPC_VXO_VPKUWUS:
-                    PPC_Op_VPKUWUS(as, insn);
-                    break;
+                    return PPC_Op_VPKUWUS;
 
                 /* Sum */
                 case PPC_VXO_VSUM4UBS:
-                    PPC_Op_VSUM4UBS(as, insn);
-                    break;
+                    return PPC_Op_VSUM4UBS;
 
                 case PPC_VXO_VSUM4SBS:
-                    PPC_Op_VSUM4SBS(as, insn);
-                    break;
+                    return PPC_Op_VSUM4SBS;
 
                 case PPC_VXO_VSUM4SHS:
-                    PPC_Op_VSUM4SHS(as, insn);
-                    break;
+                    return PPC_Op_VSUM4SHS;
 
                 case PPC_VXO_VSUM2SWS:
-                    PPC_Op_VSUM2SWS(as, insn);
-                    break;
+                    return PPC_Op_VSUM2SWS;
 
                 case PPC_VXO_VSUMSWS:
-                    PPC_Op_VSUMSWS(as, insn);
-                    break;
+                    return PPC_Op_VSUMSWS;
 
                 /* Additional Saturating Arithmetic */
                 case PPC_VXO_VADDSWS:
-                    PPC_Op_VADDSWS(as, insn);
-                    break;
+                    return PPC_Op_VADDSWS;
 
                 case PPC_VXO_VSUBSWS:
-                    PPC_Op_VSUBSWS(as, insn);
-                    break;
+                    return PPC_Op_VSUBSWS;
 
                 case PPC_VXO_VADDUWS:
-                    PPC_Op_VADDUWS(as, insn);
-                    break;
+                    return PPC_Op_VADDUWS;
 
                 case PPC_VXO_VSUBUWS:
-                    PPC_Op_VSUBUWS(as, insn);
-                    break;
+                    return PPC_Op_VSUBUWS;
 
                 case PPC_VXO_VADDCUW:
-                    PPC_Op_VADDCUW(as, insn);
-                    break;
+                    return PPC_Op_VADDCUW;
 
                 case PPC_VXO_VSUBCUW:
-                    PPC_Op_VSUBCUW(as, insn);
-                    break;
+                    return PPC_Op_VSUBCUW;
 
                 /* Additional Average */
                 case PPC_VXO_VAVGSH:
-                    PPC_Op_VAVGSH(as, insn);
-                    break;
+                    return PPC_Op_VAVGSH;
 
                 case PPC_VXO_VAVGUH:
-                    PPC_Op_VAVGUH(as, insn);
-                    break;
+                    return PPC_Op_VAVGUH;
 
                 case PPC_VXO_VAVGSW:
-                    PPC_Op_VAVGSW(as, insn);
-                    break;
+                    return PPC_Op_VAVGSW;
 
                 case PPC_VXO_VAVGUW:
-                    PPC_Op_VAVGUW(as, insn);
-                    break;
+                    return PPC_Op_VAVGUW;
 
                 /* Additional Min/Max */
                 case PPC_VXO_VMAXUH:
-                    PPC_Op_VMAXUH(as, insn);
-                    break;
+                    return PPC_Op_VMAXUH;
 
                 case PPC_VXO_VMINUH:
-                    PPC_Op_VMINUH(as, insn);
-                    break;
+                    return PPC_Op_VMINUH;
 
                 case PPC_VXO_VMAXUW:
-                    PPC_Op_VMAXUW(as, insn);
-                    break;
+                    return PPC_Op_VMAXUW;
 
                 case PPC_VXO_VMINUW:
-                    PPC_Op_VMINUW(as, insn);
-                    break;
+                    return PPC_Op_VMINUW;
 
                 case PPC_VXO_VMAXSW:
-                    PPC_Op_VMAXSW(as, insn);
-                    break;
+                    return PPC_Op_VMAXSW;
 
                 case PPC_VXO_VMINSW:
-                    PPC_Op_VMINSW(as, insn);
-                    break;
+                    return PPC_Op_VMINSW;
 
                 /* Multiply-Add */
                 case PPC_VXO_VMLADDUHM:
-                    PPC_Op_VMLADDUHM(as, insn);
-                    break;
+                    return PPC_Op_VMLADDUHM;
 
                 /* Additional Pack with Saturation */
                 case PPC_VXO_VPKSWSS:
-                    PPC_Op_VPKSWSS(as, insn);
-                    break;
+                    return PPC_Op_VPKSWSS;
 
                 case PPC_VXO_VPKSWUS:
-                    PPC_Op_VPKSWUS(as, insn);
-                    break;
+                    return PPC_Op_VPKSWUS;
 
                 case PPC_VXO_VPKSHSS:
-                    PPC_Op_VPKSHSS(as, insn);
-                    break;
+                    return PPC_Op_VPKSHSS;
 
                 case PPC_VXO_VPKSHUS:
-                    PPC_Op_VPKSHUS(as, insn);
-                    break;
+                    return PPC_Op_VPKSHUS;
 
                 /* Floating-Point Arithmetic */
                 case PPC_VXO_VADDFP:
-                    PPC_Op_VADDFP(as, insn);
-                    break;
+                    return PPC_Op_VADDFP;
 
                 case PPC_VXO_VSUBFP:
-                    PPC_Op_VSUBFP(as, insn);
-                    break;
+                    return PPC_Op_VSUBFP;
 
                 case PPC_VXO_VMADDFP:
-                    PPC_Op_VMADDFP(as, insn);
-                    break;
+                    return PPC_Op_VMADDFP;
 
                 case PPC_VXO_VNMSUBFP:
-                    PPC_Op_VNMSUBFP(as, insn);
-                    break;
+                    return PPC_Op_VNMSUBFP;
 
                 case PPC_VXO_VMAXFP:
-                    PPC_Op_VMAXFP(as, insn);
-                    break;
+                    return PPC_Op_VMAXFP;
 
                 case PPC_VXO_VMINFP:
-                    PPC_Op_VMINFP(as, insn);
-                    break;
+                    return PPC_Op_VMINFP;
 
                 /* Floating-Point Conversions */
                 case PPC_VXO_VCFUX:
-                    PPC_Op_VCFUX(as, insn);
-                    break;
+                    return PPC_Op_VCFUX;
 
                 case PPC_VXO_VCFSX:
-                    PPC_Op_VCFSX(as, insn);
-                    break;
+                    return PPC_Op_VCFSX;
 
                 case PPC_VXO_VCTUXS:
-                    PPC_Op_VCTUXS(as, insn);
-                    break;
+                    return PPC_Op_VCTUXS;
 
                 case PPC_VXO_VCTSXS:
-                    PPC_Op_VCTSXS(as, insn);
-                    break;
+                    return PPC_Op_VCTSXS;
 
                 /* Floating-Point Rounding */
                 case PPC_VXO_VRFIN:
-                    PPC_Op_VRFIN(as, insn);
-                    break;
+                    return PPC_Op_VRFIN;
 
                 case PPC_VXO_VRFIZ:
-                    PPC_Op_VRFIZ(as, insn);
-                    break;
+                    return PPC_Op_VRFIZ;
 
                 case PPC_VXO_VRFIP:
-                    PPC_Op_VRFIP(as, insn);
-                    break;
+                    return PPC_Op_VRFIP;
 
                 case PPC_VXO_VRFIM:
-                    PPC_Op_VRFIM(as, insn);
-                    break;
+                    return PPC_Op_VRFIM;
 
                 /* Vector Shift Algebraic Halfword */
                 case PPC_VXO_VSRAH:
-                    PPC_Op_VSRAH(as, insn);
-                    break;
+                    return PPC_Op_VSRAH;
 
                 /* Vector Shift Left Double by Octet Immediate */
                 case PPC_VXO_VSLDOI:
-                    PPC_Op_VSLDOI(as, insn);
-                    break;
+                    return PPC_Op_VSLDOI;
 
                 /* Vector Multiply-Add Halfword */
                 case PPC_VXO_VMHADDSHS:
-                    PPC_Op_VMHADDSHS(as, insn);
-                    break;
+                    return PPC_Op_VMHADDSHS;
 
                 case PPC_VXO_VMHRADDSHS:
-                    PPC_Op_VMHRADDSHS(as, insn);
-                    break;
+                    return PPC_Op_VMHRADDSHS;
 
                 case PPC_VXO_VMSUMUBM:
-                    PPC_Op_VMSUMUBM(as, insn);
-                    break;
+                    return PPC_Op_VMSUMUBM;
 
                 case PPC_VXO_VMSUMUHM:
-                    PPC_Op_VMSUMUHM(as, insn);
-                    break;
+                    return PPC_Op_VMSUMUHM;
 
                 /* Floating-Point Compare */
                 case PPC_VXO_VCMPEQFP:
-                    PPC_Op_VCMPEQFP(as, insn);
-                    break;
+                    return PPC_Op_VCMPEQFP;
 
                 case PPC_VXO_VCMPGEFP:
-                    PPC_Op_VCMPGEFP(as, insn);
-                    break;
+                    return PPC_Op_VCMPGEFP;
 
                 case PPC_VXO_VCMPGTFP:
-                    PPC_Op_VCMPGTFP(as, insn);
-                    break;
+                    return PPC_Op_VCMPGTFP;
 
                 case PPC_VXO_VCMPBFP:
-                    PPC_Op_VCMPBFP(as, insn);
-                    break;
+                    return PPC_Op_VCMPBFP;
 
                 /* Floating-Point Estimate */
                 case PPC_VXO_VREFP:
-                    PPC_Op_VREFP(as, insn);
-                    break;
+                    return PPC_Op_VREFP;
 
                 case PPC_VXO_VRSQRTEFP:
-                    PPC_Op_VRSQRTEFP(as, insn);
-                    break;
+                    return PPC_Op_VRSQRTEFP;
 
                 case PPC_VXO_VEXPTEFP:
-                    PPC_Op_VEXPTEFP(as, insn);
-                    break;
+                    return PPC_Op_VEXPTEFP;
 
                 case PPC_VXO_VLOGEFP:
-                    PPC_Op_VLOGEFP(as, insn);
-                    break;
+                    return PPC_Op_VLOGEFP;
 
                 /* Additional Multiply-Sum */
                 case PPC_VXO_VMSUMMBM:
-                    PPC_Op_VMSUMMBM(as, insn);
-                    break;
+                    return PPC_Op_VMSUMMBM;
 
                 case PPC_VXO_VMSUMSHM:
-                    PPC_Op_VMSUMSHM(as, insn);
-                    break;
+                    return PPC_Op_VMSUMSHM;
 
                 case PPC_VXO_VMSUMUHS:
-                    PPC_Op_VMSUMUHS(as, insn);
-                    break;
+                    return PPC_Op_VMSUMUHS;
 
                 case PPC_VXO_VMSUMSHS:
-                    PPC_Op_VMSUMSHS(as, insn);
-                    break;
+                    return PPC_Op_VMSUMSHS;
 
                 /* Vector Status Register */
                 case PPC_XOP_MFVSCR:
-                    PPC_Op_MFVSCR(as, insn);
-                    break;
+                    return PPC_Op_MFVSCR;
 
                 case PPC_XOP_MTVSCR:
-                    PPC_Op_MTVSCR(as, insn);
-                    break;
+                    return PPC_Op_MTVSCR;
 
                 default:
-                    PPC_Fault(as, "Unimplemented AltiVec opcode");
-                    break;
+                    return PPC_Op_UnimplementedAltiVec;
             }
-            break;
 
         case PPC_OP_MULLI:       /* 7 */
-            PPC_Op_MULLI(as, insn);
-            break;
+            return PPC_Op_MULLI;
 
         case PPC_OP_SUBFIC:      /* 8 */
-            PPC_Op_SUBFIC(as, insn);
-            break;
+            return PPC_Op_SUBFIC;
 
         case PPC_OP_DOZI:        /* 9 - PowerPC 601 difference or zero immediate */
-            PPC_Op_DOZI(as, insn);
-            break;
+            return PPC_Op_DOZI;
 
         case PPC_OP_CMPLI:       /* 10 */
-            PPC_Op_CMPLI(as, insn);
-            break;
+            return PPC_Op_CMPLI;
 
         case PPC_OP_CMPI:        /* 11 */
-            PPC_Op_CMPI(as, insn);
-            break;
+            return PPC_Op_CMPI;
 
         case PPC_OP_ADDIC:       /* 12 */
-            PPC_Op_ADDIC(as, insn);
-            break;
+            return PPC_Op_ADDIC;
 
         case PPC_OP_ADDIC_RC:    /* 13 */
-            PPC_Op_ADDIC_RC(as, insn);
-            break;
+            return PPC_Op_ADDIC_RC;
 
         case PPC_OP_ADDI:        /* 14 */
-            PPC_Op_ADDI(as, insn);
-            break;
+            return PPC_Op_ADDI;
 
         case PPC_OP_ADDIS:       /* 15 */
-            PPC_Op_ADDIS(as, insn);
-            break;
+            return PPC_Op_ADDIS;
 
         case PPC_OP_BC:          /* 16 */
-            PPC_Op_BC(as, insn);
-            break;
+            return PPC_Op_BC;
 
         case PPC_OP_SC:          /* 17 */
-            PPC_Op_SC(as, insn);
-            break;
+            return PPC_Op_SC;
 
         case PPC_OP_B:           /* 18 */
-            PPC_Op_B(as, insn);
-            break;
+            return PPC_Op_B;
 
         case PPC_OP_EXT19:       /* 19 - Extended opcodes (branches to LR/CTR, CR ops) */
             extended = PPC_EXTENDED_OPCODE(insn);
             switch (extended) {
                 case PPC_XOP19_MCRF:
-                    PPC_Op_MCRF(as, insn);
-                    break;
+                    return PPC_Op_MCRF;
 
                 case PPC_XOP19_BCLR:
-                    PPC_Op_BCLR(as, insn);
-                    break;
+                    return PPC_Op_BCLR;
 
                 case PPC_XOP19_BCCTR:
-                    PPC_Op_BCCTR(as, insn);
-                    break;
+                    return PPC_Op_BCCTR;
 
                 case PPC_XOP19_CRAND:
-                    PPC_Op_CRAND(as, insn);
-                    break;
+                    return PPC_Op_CRAND;
 
                 case PPC_XOP19_CROR:
-                    PPC_Op_CROR(as, insn);
-                    break;
+                    return PPC_Op_CROR;
 
                 case PPC_XOP19_CRXOR:
-                    PPC_Op_CRXOR(as, insn);
-                    break;
+                    return PPC_Op_CRXOR;
 
                 case PPC_XOP19_ISYNC:
-                    PPC_Op_ISYNC(as, insn);
-                    break;
+                    return PPC_Op_ISYNC;
 
                 case PPC_XOP19_SYNC:
-                    PPC_Op_SYNC(as, insn);
-                    break;
+                    return PPC_Op_SYNC;
 
                 case PPC_XOP19_RFI:
-                    PPC_Op_RFI(as, insn);
-                    break;
+                    return PPC_Op_RFI;
 
                 default:
                     /* Check for other CR ops */
-                    if (extended == 225) PPC_Op_CRNAND(as, insn);
-                    else if (extended == 33) PPC_Op_CRNOR(as, insn);
-                    else if (extended == 289) PPC_Op_CREQV(as, insn);
-                    else if (extended == 129) PPC_Op_CRANDC(as, insn);
-                    else if (extended == 417) PPC_Op_CRORC(as, insn);
-                    else PPC_Fault(as, "Unimplemented opcode 19 extended");
-                    break;
+                    if (extended == 225) return PPC_Op_CRNAND;
+                    if (extended == 33) return PPC_Op_CRNOR;
+                    if (extended == 289) return PPC_Op_CREQV;
+                    if (extended == 129) return PPC_Op_CRANDC;
+                    if (extended == 417) return PPC_Op_CRORC;
+                    return PPC_Op_Unimplemented19;
             }
-            break;
 
         case PPC_OP_RLWIMI:      /* 20 */
-            PPC_Op_RLWIMI(as, insn);
-            break;
+            return PPC_Op_RLWIMI;
 
         case PPC_OP_RLWINM:      /* 21 */
-            PPC_Op_RLWINM(as, insn);
-            break;
+            return PPC_Op_RLWINM;
 
         case PPC_OP_RLMI:        /* 22 - PowerPC 601 rotate left then mask insert */
-            PPC_Op_RLMI(as, insn);
-            break;
+            return PPC_Op_RLMI;
 
         case PPC_OP_RLWNM:       /* 23 */
-            PPC_Op_RLWNM(as, insn);
-            break;
+            return PPC_Op_RLWNM;
 
         case PPC_OP_ORI:         /* 24 */
-            PPC_Op_ORI(as, insn);
-            break;
+            return PPC_Op_ORI;
 
         case PPC_OP_ORIS:        /* 25 */
-            PPC_Op_ORIS(as, insn);
-            break;
+            return PPC_Op_ORIS;
 
         case PPC_OP_XORI:        /* 26 */
-            PPC_Op_XORI(as, insn);
-            break;
+            return PPC_Op_XORI;
 
         case PPC_OP_XORIS:       /* 27 */
-            PPC_Op_XORIS(as, insn);
-            break;
+            return PPC_Op_XORIS;
 
         case PPC_OP_ANDI_RC:     /* 28 */
-            PPC_Op_ANDI_RC(as, insn);
-            break;
+            return PPC_Op_ANDI_RC;
 
         case PPC_OP_ANDIS_RC:    /* 29 */
-            PPC_Op_ANDIS_RC(as, insn);
-            break;
+            return PPC_Op_ANDIS_RC;
 
         case PPC_OP_EXT31:       /* 31 - Extended opcodes (arithmetic, logical, load/store) */
             extended = PPC_EXTENDED_OPCODE(insn);
             switch (extended) {
                 case PPC_XOP_CMP:
-                    PPC_Op_CMP(as, insn);
-                    break;
+                    return PPC_Op_CMP;
 
                 case PPC_XOP_CMPL:
-                    PPC_Op_CMPL(as, insn);
-                    break;
+                    return PPC_Op_CMPL;
 
                 case PPC_XOP_TW:
-                    PPC_Op_TW(as, insn);
-                    break;
+                    return PPC_Op_TW;
 
                 /* Arithmetic */
                 case 8:    /* SUBFC */
-                    PPC_Op_SUBFC(as, insn);
-                    break;
+                    return PPC_Op_SUBFC;
 
                 case 10:   /* ADDC */
-                    PPC_Op_ADDC(as, insn);
-                    break;
+                    return PPC_Op_ADDC;
 
                 case PPC_XOP_MULHWU:
-                    PPC_Op_MULHWU(as, insn);
-                    break;
+                    return PPC_Op_MULHWU;
 
                 case PPC_XOP_MFCR:
-                    PPC_Op_MFCR(as, insn);
-                    break;
+                    return PPC_Op_MFCR;
 
                 case PPC_XOP_LWARX:
-                    PPC_Op_LWARX(as, insn);
-                    break;
+                    return PPC_Op_LWARX;
 
                 case PPC_XOP_CNTLZW:
-                    PPC_Op_CNTLZW(as, insn);
-                    break;
+                    return PPC_Op_CNTLZW;
 
                 case PPC_XOP_SUBF:
-                    if (insn & 0x00000400) {
-                        PPC_Op_SUBFO(as, insn);
-                    } else {
-                        PPC_Op_SUBF(as, insn);
-                    }
-                    break;
+                case PPC_XOP_SUBF | PPC_XOP_OE:
+                    return (insn & 0x00000400) ? PPC_Op_SUBFO : PPC_Op_SUBF;
 
                 case PPC_XOP_DCBST:
-                    PPC_Op_DCBST(as, insn);
-                    break;
+                    return PPC_Op_DCBST;
 
                 case PPC_XOP_MULHW:
-                    PPC_Op_MULHW(as, insn);
-                    break;
+                    return PPC_Op_MULHW;
 
                 case PPC_XOP_DCBF:
-                    PPC_Op_DCBF(as, insn);
-                    break;
+                    return PPC_Op_DCBF;
 
                 case 104:  /* NEG */
-                    if (insn & 0x00000400) {
-                        PPC_Op_NEGO(as, insn);
-                    } else {
-                        PPC_Op_NEG(as, insn);
-                    }
-                    break;
+                case 104 | PPC_XOP_OE:
+                    return (insn & 0x00000400) ? PPC_Op_NEGO : PPC_Op_NEG;
 
                 case PPC_XOP_SUBFE:
-                    PPC_Op_SUBFE(as, insn);
-                    break;
+                    return PPC_Op_SUBFE;
 
                 case PPC_XOP_ADDE:
-                    PPC_Op_ADDE(as, insn);
-                    break;
+                    return PPC_Op_ADDE;
 
                 case PPC_XOP_MTCRF:
-                    PPC_Op_MTCRF(as, insn);
-                    break;
+                    return PPC_Op_MTCRF;
 
                 case PPC_XOP_STWCX:
-                    PPC_Op_STWCX(as, insn);
-                    break;
+                    return PPC_Op_STWCX;
 
                 case PPC_XOP_SUBFZE:
-                    PPC_Op_SUBFZE(as, insn);
-                    break;
+                    return PPC_Op_SUBFZE;
 
                 case PPC_XOP_ADDZE:
-                    PPC_Op_ADDZE(as, insn);
-                    break;
+                    return PPC_Op_ADDZE;
 
                 case PPC_XOP_SUBFME:
-                    PPC_Op_SUBFME(as, insn);
-                    break;
+                    return PPC_Op_SUBFME;
 
                 case PPC_XOP_ADDME:
-                    PPC_Op_ADDME(as, insn);
-                    break;
+                    return PPC_Op_ADDME;
 
                 case PPC_XOP_ADD:
-                    if (insn & 0x00000400) {
-                        PPC_Op_ADDO(as, insn);
-                    } else {
-                        PPC_Op_ADD(as, insn);
-                    }
-                    break;
+                case PPC_XOP_ADD | PPC_XOP_OE:
+                    return (insn & 0x00000400) ? PPC_Op_ADDO : PPC_Op_ADD;
 
                 case PPC_XOP_MULLW:
-                    if (insn & 0x00000400) {
-                        PPC_Op_MULLWO(as, insn);
-                    } else {
-                        PPC_Op_MULLW(as, insn);
-                    }
-                    break;
+                case PPC_XOP_MULLW | PPC_XOP_OE:
+                    return (insn & 0x00000400) ? PPC_Op_MULLWO : PPC_Op_MULLW;
 
                 case PPC_XOP_MFSPR:
-                    PPC_Op_MFSPR(as, insn);
-                    break;
+                    return PPC_Op_MFSPR;
 
                 case PPC_XOP_DIVWU:
-                    PPC_Op_DIVWU(as, insn);
-                    break;
+                    return PPC_Op_DIVWU;
 
                 case PPC_XOP_MTSPR:
-                    PPC_Op_MTSPR(as, insn);
-                    break;
+                    return PPC_Op_MTSPR;
 
                 case PPC_XOP_DIVW:
-                    if (insn & 0x00000400) {
-                        PPC_Op_DIVWO(as, insn);
-                    } else {
-                        PPC_Op_DIVW(as, insn);
-                    }
-                    break;
+                case PPC_XOP_DIVW | PPC_XOP_OE:
+                    return (insn & 0x00000400) ? PPC_Op_DIVWO : PPC_Op_DIVW;
 
                 case PPC_XOP_LSWX:
-                    PPC_Op_LSWX(as, insn);
-                    break;
+                    return PPC_Op_LSWX;
 
                 case PPC_XOP_LSWI:
-                    PPC_Op_LSWI(as, insn);
-                    break;
+                    return PPC_Op_LSWI;
 
                 case PPC_XOP_STSWX:
-                    PPC_Op_STSWX(as, insn);
-                    break;
+                    return PPC_Op_STSWX;
 
                 case PPC_XOP_STSWI:
-                    PPC_Op_STSWI(as, insn);
-                    break;
+                    return PPC_Op_STSWI;
 
                 /* Logical */
                 case PPC_XOP_AND:
-                    PPC_Op_AND(as, insn);
-                    break;
+                    return PPC_Op_AND;
 
                 case PPC_XOP_ANDC:
-                    PPC_Op_ANDC(as, insn);
-                    break;
+                    return PPC_Op_ANDC;
 
                 case PPC_XOP_OR:
-                    PPC_Op_OR(as, insn);
-                    break;
+                    return PPC_Op_OR;
 
                 case PPC_XOP_ORC:
-                    PPC_Op_ORC(as, insn);
-                    break;
+                    return PPC_Op_ORC;
 
                 case PPC_XOP_XOR:
-                    PPC_Op_XOR(as, insn);
-                    break;
+                    return PPC_Op_XOR;
 
                 case PPC_XOP_NAND:
-                    PPC_Op_NAND(as, insn);
-                    break;
+                    return PPC_Op_NAND;
 
                 case PPC_XOP_NOR:
-                    PPC_Op_NOR(as, insn);
-                    break;
+                    return PPC_Op_NOR;
 
                 case PPC_XOP_EQV:
-                    PPC_Op_EQV(as, insn);
-                    break;
+                    return PPC_Op_EQV;
 
                 /* Shifts */
                 case PPC_XOP_SLW:
-                    PPC_Op_SLW(as, insn);
-                    break;
+                    return PPC_Op_SLW;
 
                 case PPC_XOP_SRW:
-                    PPC_Op_SRW(as, insn);
-                    break;
+                    return PPC_Op_SRW;
 
                 case PPC_XOP_SRAW:
-                    PPC_Op_SRAW(as, insn);
-                    break;
+                    return PPC_Op_SRAW;
 
                 case PPC_XOP_SRAWI:
-                    PPC_Op_SRAWI(as, insn);
-                    break;
+                    return PPC_Op_SRAWI;
 
                 /* Sign extension */
                 case PPC_XOP_EXTSH:
-                    PPC_Op_EXTSH(as, insn);
-                    break;
+                    return PPC_Op_EXTSH;
 
                 case PPC_XOP_EXTSB:
-                    PPC_Op_EXTSB(as, insn);
-                    break;
+                    return PPC_Op_EXTSB;
 
                 /* Cache management */
                 case PPC_XOP_ICBI:
-                    PPC_Op_ICBI(as, insn);
-                    break;
+                    return PPC_Op_ICBI;
 
                 case PPC_XOP_DCBZ:
-                    PPC_Op_DCBZ(as, insn);
-                    break;
+                    return PPC_Op_DCBZ;
 
                 /* Indexed loads/stores */
                 case PPC_XOP_LWZX:
-                    PPC_Op_LWZX(as, insn);
-                    break;
+                    return PPC_Op_LWZX;
 
                 case PPC_XOP_LWZUX:
-                    PPC_Op_LWZUX(as, insn);
-                    break;
+                    return PPC_Op_LWZUX;
 
                 case PPC_XOP_LBZX:
-                    PPC_Op_LBZX(as, insn);
-                    break;
+                    return PPC_Op_LBZX;
 
                 case PPC_XOP_LBZUX:
-                    PPC_Op_LBZUX(as, insn);
-                    break;
+                    return PPC_Op_LBZUX;
 
                 case PPC_XOP_LHZX:
-                    PPC_Op_LHZX(as, insn);
-                    break;
+                    return PPC_Op_LHZX;
 
                 case PPC_XOP_LHZUX:
-                    PPC_Op_LHZUX(as, insn);
-                    break;
+                    return PPC_Op_LHZUX;
 
                 case PPC_XOP_LHAX:
-                    PPC_Op_LHAX(as, insn);
-                    break;
+                    return PPC_Op_LHAX;
 
                 case PPC_XOP_LHAUX:
-                    PPC_Op_LHAUX(as, insn);
-                    break;
+                    return PPC_Op_LHAUX;
 
                 case PPC_XOP_STWX:
-                    PPC_Op_STWX(as, insn);
-                    break;
+                    return PPC_Op_STWX;
 
                 case PPC_XOP_STWUX:
-                    PPC_Op_STWUX(as, insn);
-                    break;
+                    return PPC_Op_STWUX;
 
                 case PPC_XOP_STBX:
-                    PPC_Op_STBX(as, insn);
-                    break;
+                    return PPC_Op_STBX;
 
                 case PPC_XOP_STBUX:
-                    PPC_Op_STBUX(as, insn);
-                    break;
+                    return PPC_Op_STBUX;
 
                 case PPC_XOP_STHX:
-                    PPC_Op_STHX(as, insn);
-                    break;
+                    return PPC_Op_STHX;
 
                 case PPC_XOP_STHUX:
-                    PPC_Op_STHUX(as, insn);
-                    break;
+                    return PPC_Op_STHUX;
 
                 /* Byte-reversed load/store */
                 case PPC_XOP_LWBRX:
-                    PPC_Op_LWBRX(as, insn);
-                    break;
+                    return PPC_Op_LWBRX;
 
                 case PPC_XOP_LHBRX:
-                    PPC_Op_LHBRX(as, insn);
-                    break;
+                    return PPC_Op_LHBRX;
 
                 case PPC_XOP_STWBRX:
-                    PPC_Op_STWBRX(as, insn);
-                    break;
+                    return PPC_Op_STWBRX;
 
                 case PPC_XOP_STHBRX:
-                    PPC_Op_STHBRX(as, insn);
-                    break;
+                    return PPC_Op_STHBRX;
 
                 /* Floating-point indexed load/store */
                 case PPC_XOP_LFSX:
-                    PPC_Op_LFSX(as, insn);
-                    break;
+                    return PPC_Op_LFSX;
 
                 case PPC_XOP_LFSUX:
-                    PPC_Op_LFSUX(as, insn);
-                    break;
+                    return PPC_Op_LFSUX;
 
                 case PPC_XOP_LFDX:
-                    PPC_Op_LFDX(as, insn);
-                    break;
+                    return PPC_Op_LFDX;
 
                 case PPC_XOP_LFDUX:
-                    PPC_Op_LFDUX(as, insn);
-                    break;
+                    return PPC_Op_LFDUX;
 
                 case PPC_XOP_STFSX:
-                    PPC_Op_STFSX(as, insn);
-                    break;
+                    return PPC_Op_STFSX;
 
                 case PPC_XOP_STFSUX:
-                    PPC_Op_STFSUX(as, insn);
-                    break;
+                    return PPC_Op_STFSUX;
 
                 case PPC_XOP_STFDX:
-                    PPC_Op_STFDX(as, insn);
-                    break;
+                    return PPC_Op_STFDX;
 
                 case PPC_XOP_STFDUX:
-                    PPC_Op_STFDUX(as, insn);
-                    break;
+                    return PPC_Op_STFDUX;
 
                 case PPC_XOP_STFIWX:
-                    PPC_Op_STFIWX(as, insn);
-                    break;
+                    return PPC_Op_STFIWX;
 
                 /* Memory ordering */
                 case PPC_XOP_EIEIO:
-                    PPC_Op_EIEIO(as, insn);
-                    break;
+                    return PPC_Op_EIEIO;
 
                 /* System instructions */
                 case PPC_XOP_MFMSR:
-                    PPC_Op_MFMSR(as, insn);
-                    break;
+                    return PPC_Op_MFMSR;
 
                 case PPC_XOP_MTMSR:
-                    PPC_Op_MTMSR(as, insn);
-                    break;
+                    return PPC_Op_MTMSR;
 
                 /* Segment register operations */
                 case PPC_XOP_MFSR:
-                    PPC_Op_MFSR(as, insn);
-                    break;
+                    return PPC_Op_MFSR;
 
                 case PPC_XOP_MTSR:
-                    PPC_Op_MTSR(as, insn);
-                    break;
+                    return PPC_Op_MTSR;
 
                 case PPC_XOP_MFSRIN:
-                    PPC_Op_MFSRIN(as, insn);
-                    break;
+                    return PPC_Op_MFSRIN;
 
                 case PPC_XOP_MTSRIN:
-                    PPC_Op_MTSRIN(as, insn);
-                    break;
+                    return PPC_Op_MTSRIN;
 
                 /* TLB management */
                 case PPC_XOP_TLBIE:
-                    PPC_Op_TLBIE(as, insn);
-                    break;
+                    return PPC_Op_TLBIE;
 
                 case PPC_XOP_TLBSYNC:
-                    PPC_Op_TLBSYNC(as, insn);
-                    break;
+                    return PPC_Op_TLBSYNC;
 
                 case PPC_XOP_TLBIA:
-                    PPC_Op_TLBIA(as, insn);
-                    break;
+                    return PPC_Op_TLBIA;
 
                 /* Additional cache control */
                 case PPC_XOP_DCBI:
-                    PPC_Op_DCBI(as, insn);
-                    break;
+                    return PPC_Op_DCBI;
 
                 case PPC_XOP_DCBT:
-                    PPC_Op_DCBT(as, insn);
-                    break;
+                    return PPC_Op_DCBT;
 
                 case PPC_XOP_DCBTST:
-                    PPC_Op_DCBTST(as, insn);
-                    break;
+                    return PPC_Op_DCBTST;
 
                 case PPC_XOP_DCBA:
-                    PPC_Op_DCBA(as, insn);
-                    break;
+                    return PPC_Op_DCBA;
 
                 /* External control */
                 case PPC_XOP_ECIWX:
-                    PPC_Op_ECIWX(as, insn);
-                    break;
+                    return PPC_Op_ECIWX;
 
                 case PPC_XOP_ECOWX:
-                    PPC_Op_ECOWX(as, insn);
-                    break;
+                    return PPC_Op_ECOWX;
 
                 /* Time base access */
                 case PPC_XOP_MFTB:
-                    PPC_Op_MFTB(as, insn);
-                    break;
+                    return PPC_Op_MFTB;
 
                 /* PowerPC 601 compatibility instructions */
                 case PPC_XOP_DOZ:
-                    PPC_Op_DOZ(as, insn);
-                    break;
+                    return PPC_Op_DOZ;
 
                 case PPC_XOP_MUL:
-                    PPC_Op_MUL(as, insn);
-                    break;
+                    return PPC_Op_MUL;
 
                 case PPC_XOP_DIV:
-                    PPC_Op_DIV(as, insn);
-                    break;
+                    return PPC_Op_DIV;
 
                 case PPC_XOP_DIVS:
-                    PPC_Op_DIVS(as, insn);
-                    break;
+                    return PPC_Op_DIVS;
 
                 case PPC_XOP_ABS:
-                    PPC_Op_ABS(as, insn);
-                    break;
+                    return PPC_Op_ABS;
 
                 case PPC_XOP_NABS:
-                    PPC_Op_NABS(as, insn);
-                    break;
+                    return PPC_Op_NABS;
 
                 case PPC_XOP_CLCS:
-                    PPC_Op_CLCS(as, insn);
-                    break;
+                    return PPC_Op_CLCS;
 
                 /* AltiVec vector load/store */
                 case PPC_OP_LVX:
-                    PPC_Op_LVX(as, insn);
-                    break;
+                    return PPC_Op_LVX;
 
                 case PPC_OP_STVX:
-                    PPC_Op_STVX(as, insn);
-                    break;
+                    return PPC_Op_STVX;
 
                 case PPC_OP_LVEBX:
-                    PPC_Op_LVEBX(as, insn);
-                    break;
+                    return PPC_Op_LVEBX;
 
                 case PPC_OP_LVEHX:
-                    PPC_Op_LVEHX(as, insn);
-                    break;
+                    return PPC_Op_LVEHX;
 
                 case PPC_OP_STVEBX:
-                    PPC_Op_STVEBX(as, insn);
-                    break;
+                    return PPC_Op_STVEBX;
 
                 case PPC_OP_STVEHX:
-                    PPC_Op_STVEHX(as, insn);
-                    break;
+                    return PPC_Op_STVEHX;
 
                 /* Additional vector load/store */
                 case PPC_OP_LVSL:
-                    PPC_Op_LVSL(as, insn);
-                    break;
+                    return PPC_Op_LVSL;
 
                 case PPC_OP_LVSR:
-                    PPC_Op_LVSR(as, insn);
-                    break;
+                    return PPC_Op_LVSR;
 
                 case PPC_OP_LVEWX:
-                    PPC_Op_LVEWX(as, insn);
-                    break;
+                    return PPC_Op_LVEWX;
 
                 case PPC_OP_STVEWX:
-                    PPC_Op_STVEWX(as, insn);
-                    break;
+                    return PPC_Op_STVEWX;
 
                 case PPC_OP_LVXL:
-                    PPC_Op_LVXL(as, insn);
-                    break;
+                    return PPC_Op_LVXL;
 
                 case PPC_OP_STVXL:
-                    PPC_Op_STVXL(as, insn);
-                    break;
+                    return PPC_Op_STVXL;
 
                 /* Data Stream Touch (cache hints - NOPs) */
                 case PPC_XOP_DST:
-                    PPC_Op_DST(as, insn);
-                    break;
+                    return PPC_Op_DST;
 
                 case PPC_XOP_DSTT:
-                    PPC_Op_DSTT(as, insn);
-                    break;
+                    return PPC_Op_DSTT;
 
                 case PPC_XOP_DSTST:
-                    PPC_Op_DSTST(as, insn);
-                    break;
+                    return PPC_Op_DSTST;
 
                 case PPC_XOP_DSTSTT:
-                    PPC_Op_DSTSTT(as, insn);
-                    break;
+                    return PPC_Op_DSTSTT;
 
                 case PPC_XOP_DSS:
-                    PPC_Op_DSS(as, insn);
-                    break;
+                    return PPC_Op_DSS;
 
                 case PPC_XOP_DSSALL:
-                    PPC_Op_DSSALL(as, insn);
-                    break;
+                    return PPC_Op_DSSALL;
 
                 default:
-                    PPC_Fault(as, "Unimplemented opcode 31 extended");
-                    break;
+                    return PPC_Op_Unimplemented31;
             }
-            break;
 
         case PPC_OP_LWZ:         /* 32 */
-            PPC_Op_LWZ(as, insn);
-            break;
+            return PPC_Op_LWZ;
 
         case PPC_OP_LWZU:        /* 33 */
-            PPC_Op_LWZU(as, insn);
-            break;
+            return PPC_Op_LWZU;
 
         case PPC_OP_LBZ:         /* 34 */
-            PPC_Op_LBZ(as, insn);
-            break;
+            return PPC_Op_LBZ;
 
         case PPC_OP_LBZU:        /* 35 */
-            PPC_Op_LBZU(as, insn);
-            break;
+            return PPC_Op_LBZU;
 
         case PPC_OP_STW:         /* 36 */
-            PPC_Op_STW(as, insn);
-            break;
+            return PPC_Op_STW;
 
         case PPC_OP_STWU:        /* 37 */
-            PPC_Op_STWU(as, insn);
-            break;
+            return PPC_Op_STWU;
 
         case PPC_OP_STB:         /* 38 */
-            PPC_Op_STB(as, insn);
-            break;
+            return PPC_Op_STB;
 
         case PPC_OP_STBU:        /* 39 */
-            PPC_Op_STBU(as, insn);
-            break;
+            return PPC_Op_STBU;
 
         case PPC_OP_LHZ:         /* 40 */
-            PPC_Op_LHZ(as, insn);
-            break;
+            return PPC_Op_LHZ;
 
         case PPC_OP_LHZU:        /* 41 */
-            PPC_Op_LHZU(as, insn);
-            break;
+            return PPC_Op_LHZU;
 
         case PPC_OP_LHA:         /* 42 */
-            PPC_Op_LHA(as, insn);
-            break;
+            return PPC_Op_LHA;
 
         case PPC_OP_LHAU:        /* 43 */
-            PPC_Op_LHAU(as, insn);
-            break;
+            return PPC_Op_LHAU;
 
         case PPC_OP_STH:         /* 44 */
-            PPC_Op_STH(as, insn);
-            break;
+            return PPC_Op_STH;
 
         case PPC_OP_STHU:        /* 45 */
-            PPC_Op_STHU(as, insn);
-            break;
+            return PPC_Op_STHU;
 
         case PPC_OP_LMW:         /* 46 */
-            PPC_Op_LMW(as, insn);
-            break;
+            return PPC_Op_LMW;
 
         case PPC_OP_STMW:        /* 47 */
-            PPC_Op_STMW(as, insn);
-            break;
+            return PPC_Op_STMW;
 
         case PPC_OP_LFS:         /* 48 */
-            PPC_Op_LFS(as, insn);
-            break;
+            return PPC_Op_LFS;
 
         case PPC_OP_LFSU:        /* 49 */
-            PPC_Op_LFSU(as, insn);
-            break;
+            return PPC_Op_LFSU;
 
         case PPC_OP_LFD:         /* 50 */
-            PPC_Op_LFD(as, insn);
-            break;
+            return PPC_Op_LFD;
 
         case PPC_OP_LFDU:        /* 51 */
-            PPC_Op_LFDU(as, insn);
-            break;
+            return PPC_Op_LFDU;
 
         case PPC_OP_STFS:        /* 52 */
-            PPC_Op_STFS(as, insn);
-            break;
+            return PPC_Op_STFS;
 
         case PPC_OP_STFSU:       /* 53 */
-            PPC_Op_STFSU(as, insn);
-            break;
+            return PPC_Op_STFSU;
 
         case PPC_OP_STFD:        /* 54 */
-            PPC_Op_STFD(as, insn);
-            break;
+            return PPC_Op_STFD;
 
         case PPC_OP_STFDU:       /* 55 */
-            PPC_Op_STFDU(as, insn);
-            break;
+            return PPC_Op_STFDU;
 
         case PPC_OP_EXT59:       /* 59 - Single-precision FP arithmetic */
-            extended = PPC_EXTENDED_OPCODE(insn);
+            extended = PPC_FP_EXTENDED_OPCODE(insn);
             switch (extended) {
                 case PPC_XOP59_FADDS:
-                    PPC_Op_FADDS(as, insn);
-                    break;
+                    return PPC_Op_FADDS;
 
                 case PPC_XOP59_FSUBS:
-                    PPC_Op_FSUBS(as, insn);
-                    break;
+                    return PPC_Op_FSUBS;
 
                 case PPC_XOP59_FMULS:
-                    PPC_Op_FMULS(as, insn);
-                    break;
+                    return PPC_Op_FMULS;
 
                 case PPC_XOP59_FDIVS:
-                    PPC_Op_FDIVS(as, insn);
-                    break;
+                    return PPC_Op_FDIVS;
 
                 case PPC_XOP59_FSQRTS:
-                    PPC_Op_FSQRTS(as, insn);
-                    break;
+                    return PPC_Op_FSQRTS;
 
                 case PPC_XOP59_FRES:
-                    PPC_Op_FRES(as, insn);
-                    break;
+                    return PPC_Op_FRES;
 
                 case PPC_XOP59_FMADDS:
-                    PPC_Op_FMADDS(as, insn);
-                    break;
+                    return PPC_Op_FMADDS;
 
                 case PPC_XOP59_FMSUBS:
-                    PPC_Op_FMSUBS(as, insn);
-                    break;
+                    return PPC_Op_FMSUBS;
 
                 case PPC_XOP59_FNMADDS:
-                    PPC_Op_FNMADDS(as, insn);
-                    break;
+                    return PPC_Op_FNMADDS;
 
                 case PPC_XOP59_FNMSUBS:
-                    PPC_Op_FNMSUBS(as, insn);
-                    break;
+                    return PPC_Op_FNMSUBS;
 
                 default:
-                    PPC_Fault(as, "Unimplemented opcode 59 extended");
-                    break;
+                    return PPC_Op_Unimplemented59;
             }
-            break;
 
         case PPC_OP_EXT63:       /* 63 - Double-precision FP arithmetic */
-            extended = PPC_EXTENDED_OPCODE(insn);
+            extended = PPC_FP_EXTENDED_OPCODE(insn);
             switch (extended) {
                 case PPC_XOP63_FCMPU:
-                    PPC_Op_FCMPU(as, insn);
-                    break;
+                    return PPC_Op_FCMPU;
 
                 case PPC_XOP63_FRSP:
-                    PPC_Op_FRSP(as, insn);
-                    break;
+                    return PPC_Op_FRSP;
 
                 case PPC_XOP63_FCTIW:
-                    PPC_Op_FCTIW(as, insn);
-                    break;
+                    return PPC_Op_FCTIW;
 
                 case PPC_XOP63_FCTIWZ:
-                    PPC_Op_FCTIWZ(as, insn);
-                    break;
+                    return PPC_Op_FCTIWZ;
 
                 case PPC_XOP63_FDIV:
-                    PPC_Op_FDIV(as, insn);
-                    break;
+                    return PPC_Op_FDIV;
 
                 case PPC_XOP63_FSUB:
-                    PPC_Op_FSUB(as, insn);
-                    break;
+                    return PPC_Op_FSUB;
 
                 case PPC_XOP63_FADD:
-                    PPC_Op_FADD(as, insn);
-                    break;
+                    return PPC_Op_FADD;
 
                 case PPC_XOP63_FSQRT:
-                    PPC_Op_FSQRT(as, insn);
-                    break;
+                    return PPC_Op_FSQRT;
 
                 case PPC_XOP63_FSEL:
-                    PPC_Op_FSEL(as, insn);
-                    break;
+                    return PPC_Op_FSEL;
 
                 case PPC_XOP63_FMUL:
-                    PPC_Op_FMUL(as, insn);
-                    break;
+                    return PPC_Op_FMUL;
 
                 case PPC_XOP63_FRSQRTE:
-                    PPC_Op_FRSQRTE(as, insn);
-                    break;
+                    return PPC_Op_FRSQRTE;
 
                 case PPC_XOP63_FMSUB:
-                    PPC_Op_FMSUB(as, insn);
-                    break;
+                    return PPC_Op_FMSUB;
 
                 case PPC_XOP63_FMADD:
-                    PPC_Op_FMADD(as, insn);
-                    break;
+                    return PPC_Op_FMADD;
 
                 case PPC_XOP63_FNMSUB:
-                    PPC_Op_FNMSUB(as, insn);
-                    break;
+                    return PPC_Op_FNMSUB;
 
                 case PPC_XOP63_FNMADD:
-                    PPC_Op_FNMADD(as, insn);
-                    break;
+                    return PPC_Op_FNMADD;
 
                 case PPC_XOP63_FCMPO:
-                    PPC_Op_FCMPO(as, insn);
-                    break;
+                    return PPC_Op_FCMPO;
 
                 case PPC_XOP63_FNEG:
-                    PPC_Op_FNEG(as, insn);
-                    break;
+                    return PPC_Op_FNEG;
 
                 case PPC_XOP63_MTFSB1:
-                    PPC_Op_MTFSB1(as, insn);
-                    break;
+                    return PPC_Op_MTFSB1;
 
                 case PPC_XOP63_MTFSB0:
-                    PPC_Op_MTFSB0(as, insn);
-                    break;
+                    return PPC_Op_MTFSB0;
 
                 case PPC_XOP63_FMR:
-                    PPC_Op_FMR(as, insn);
-                    break;
+                    return PPC_Op_FMR;
 
                 case PPC_XOP63_MTFSFI:
-                    PPC_Op_MTFSFI(as, insn);
-                    break;
+                    return PPC_Op_MTFSFI;
 
                 case PPC_XOP63_FNABS:
-                    PPC_Op_FNABS(as, insn);
-                    break;
+                    return PPC_Op_FNABS;
 
                 case PPC_XOP63_FABS:
-                    PPC_Op_FABS(as, insn);
-                    break;
+                    return PPC_Op_FABS;
 
                 case PPC_XOP63_MFFS:
-                    PPC_Op_MFFS(as, insn);
-                    break;
+                    return PPC_Op_MFFS;
 
                 case PPC_XOP63_MCRFS:
-                    PPC_Op_MCRFS(as, insn);
-                    break;
+                    return PPC_Op_MCRFS;
 
                 case PPC_XOP63_MTFSF:
-                    PPC_Op_MTFSF(as, insn);
-                    break;
+                    return PPC_Op_MTFSF;
 
                 default:
-                    PPC_Fault(as, "Unimplemented opcode 63 extended");
-                    break;
+                    return PPC_Op_Unimplemented63;
             }
-            break;
 
         default:
-            serial_printf("[PPC] ILLEGAL opcode 0x%08X (primary=0x%02X) at PC=0x%08X\n",
-                         insn, primary, as->regs.pc - 4);
-            PPC_Fault(as, "Illegal opcode");
-            break;
+            return PPC_Op_Illegal;
     }
 
+}
+
+/*
+ * Two-level dispatch tables.
+ *
+ * The primary opcode indexes gPPCPrimary. Where it names an instruction the
+ * slot holds its handler; for the five groups - 4, 19, 31, 59, 63 - it holds
+ * the group's own table and how to cut the extended opcode out of the word.
+ * Every slot of every table holds a handler, the fault ones included, so a
+ * lookup never tests for a hole.
+ */
+typedef struct PPCDispatch {
+    PPCOpHandler        handler;   /* the instruction, when not a group */
+    const PPCOpHandler* extended;  /* the group's table, when a group */
+    UInt8               shift;     /* extended = (insn >> shift) & mask */
+    UInt16              mask;
+} PPCDispatch;
+
+static PPCOpHandler gPPCExt4[2048];     /* AltiVec: eleven bits, from bit 21 */
+static PPCOpHandler gPPCExt19[1024];
+static PPCOpHandler gPPCExt31[1024];
+static PPCOpHandler gPPCExt59[1024];
+static PPCOpHandler gPPCExt63[1024];
+static PPCDispatch gPPCPrimary[64];
+static Boolean gPPCDispatchReady = false;
+
+static void PPC_BuildDispatchTables(void)
+{
+    static const struct {
+        UInt8         primary;
+        UInt8         shift;
+        UInt16        mask;
+        PPCOpHandler* table;
+    } kGroups[] = {
+        { PPC_OP_EXT4,  0, 0x7FF, gPPCExt4  },
+        { PPC_OP_EXT19, 1, 0x3FF, gPPCExt19 },
+        { PPC_OP_EXT31, 1, 0x3FF, gPPCExt31 },
+        { PPC_OP_EXT59, 1, 0x3FF, gPPCExt59 },
+        { PPC_OP_EXT63, 1, 0x3FF, gPPCExt63 },
+    };
+
+    if (gPPCDispatchReady) {
+        return;
+    }
+
+    for (UInt32 p = 0; p < 64; p++) {
+        gPPCPrimary[p].handler = PPC_DecodeInsn(p << 26);
+        gPPCPrimary[p].extended = NULL;
+    }
+
+    for (unsigned g = 0; g < sizeof(kGroups) / sizeof(kGroups[0]); g++) {
+        PPCDispatch* d = &gPPCPrimary[kGroups[g].primary];
+
+        for (UInt32 x = 0; x <= kGroups[g].mask; x++) {
+            kGroups[g].table[x] = PPC_DecodeInsn(((UInt32)kGroups[g].primary << 26) |
+                                                 (x << kGroups[g].shift));
+        }
+        d->handler = NULL;
+        d->extended = kGroups[g].table;
+        d->shift = kGroups[g].shift;
+        d->mask = kGroups[g].mask;
+    }
+
+    gPPCDispatchReady = true;
+}
+
+PPCOpHandler PPC_HandlerFor(UInt32 insn)
+{
+    const PPCDispatch* d = &gPPCPrimary[PPC_PRIMARY_OPCODE(insn)];
+
+    if (d->extended) {
+        return d->extended[(insn >> d->shift) & d->mask];
+    }
+    return d->handler;
+}
+
+/*
+ * PPC_Step - Fetch and execute one instruction
+ */
+OSErr PPC_Step(PPCAddressSpace* as)
+{
+    UInt32 insn;
+
+    if (!as) {
+        return paramErr;
+    }
+
+    if (as->halted) {
+        return noErr;
+    }
+
+    /* Fetch instruction (32-bit) */
+    insn = PPC_Fetch32(as);
+    if (as->halted) {
+        return noErr;
+    }
+
+    PPC_HandlerFor(insn)(as, insn);
     return noErr;
 }
 
+/*
+ * The decoded-instruction array for the page holding pc, allocated the first
+ * time code runs there. NULL if the page does not exist, or the array could
+ * not be had - either way PPC_Step takes the instruction instead.
+ */
+static PPCDecoded* PPC_DecodedPage(PPCAddressSpace* as, UInt32 pc)
+{
+    UInt32 pageNum = pc >> PPC_PAGE_SHIFT;
+    PPCDecoded* d = as->decoded[pageNum];
+
+    if (!d && as->pageTable[pageNum]) {
+        d = (PPCDecoded*)NewPtr(PPC_PAGE_INSNS * sizeof(PPCDecoded));
+        if (d) {
+            memset(d, 0, PPC_PAGE_INSNS * sizeof(PPCDecoded));
+            as->decoded[pageNum] = d;
+        }
+    }
+    return d;
+}
+
+void PPC_InvalidateCode(PPCAddressSpace* as, UInt32 addr, UInt32 len)
+{
+    UInt32 end = addr + len;
+
+    if (!as) {
+        return;
+    }
+    if (end > PPC_MAX_ADDR || end < addr) {
+        end = PPC_MAX_ADDR;
+    }
+
+    addr &= ~3UL;
+    while (addr < end) {
+        if (!as->decoded[addr >> PPC_PAGE_SHIFT]) {
+            /* Nothing decoded anywhere on this page */
+            addr = (addr | (PPC_PAGE_SIZE - 1)) + 1;
+            continue;
+        }
+        PPC_InvalidateCodeWord(as, addr);
+        addr += 4;
+    }
+}
+
 /*
  * PPC_Execute - Execute up to maxInstructions
+ *
+ * From the predecoded pages wherever it can: an instruction already seen is
+ * one load and an indirect call. A misaligned PC, or one outside the pages
+ * that exist, goes through PPC_Step, which faults on it as it always has.
  */
 OSErr PPC_Execute(PPCAddressSpace* as, UInt32 startPC, UInt32 maxInstructions)
 {
@@ -2256,9 +2309,363 @@ OSErr PPC_Execute(PPCAddressSpace* as, UInt32 startPC, UInt32 maxInstructions)
     as->halted = false;
 
     while (count < maxInstructions && !as->halted) {
-        PPC_Step(as);
+        UInt32 pc = as->regs.pc;
+        PPCDecoded* d = NULL;
+        UInt32 insn;
+
+        if (!(pc & 3) && pc < PPC_MAX_ADDR) {
+            d = PPC_DecodedPage(as, pc);
+        }
+        if (!d) {
+            PPC_Step(as);
+            count++;
+            continue;
+        }
+
+        d += (pc & (PPC_PAGE_SIZE - 1)) >> 2;
+        if (!d->handler) {
+            const UInt8* b = (const UInt8*)as->pageTable[pc >> PPC_PAGE_SHIFT] +
+                             (pc & (PPC_PAGE_SIZE - 1));
+            d->insn = ((UInt32)b[0] << 24) | ((UInt32)b[1] << 16) |
+                      ((UInt32)b[2] << 8) | b[3];
+            d->handler = PPC_HandlerFor(d->insn);
+        }
+
+        /* Taken before the call: the instruction may store over itself */
+        insn = d->insn;
+        as->regs.pc = pc + 4;
+        d->handler(as, insn);
         count++;
     }
 
     return noErr;
 }
+
+/*
+ * Test and benchmark programs. Big-endian instruction words, written into an
+ * address space with WriteMemory.
+ */
+
+/* Integer: add, immediate add, xor, rotate-and-mask, subtract, compare. */
+static const UInt32 kPPCBenchInt[] = {
+    0x38600000,   /* li r3,0 */
+    0x38800001,   /* li r4,1 */
+    0x38C01000,   /* li r6,0x1000 */
+    0x7CC903A6,   /* mtctr r6 */
+    0x7C632214,   /* loop: add r3,r3,r4 */
+    0x38840003,   /* addi r4,r4,3 */
+    0x7C871A78,   /* xor r7,r4,r3 */
+    0x54E81838,   /* rlwinm r8,r7,3,0,28 */
+    0x7C681850,   /* subf r3,r8,r3 */
+    0x7C032000,   /* cmpw r3,r4 */
+    0x4200FFE8,   /* bdnz loop */
+};
+#define kPPCBenchIntSteps    (4 + 0x1000 * 7)
+
+/* Load/store: word, halfword and byte, displacement and indexed. */
+static const UInt32 kPPCBenchMem[] = {
+    0x3D200002,   /* lis r9,2 */
+    0x39400010,   /* li r10,16 */
+    0x38800001,   /* li r4,1 */
+    0x38C01000,   /* li r6,0x1000 */
+    0x7CC903A6,   /* mtctr r6 */
+    0x90890000,   /* loop: stw r4,0(r9) */
+    0x80A90000,   /* lwz r5,0(r9) */
+    0x38A50001,   /* addi r5,r5,1 */
+    0xB0A90004,   /* sth r5,4(r9) */
+    0xA0E90004,   /* lhz r7,4(r9) */
+    0x98E90008,   /* stb r7,8(r9) */
+    0x89090008,   /* lbz r8,8(r9) */
+    0x7C844214,   /* add r4,r4,r8 */
+    0x7C89512E,   /* stwx r4,r9,r10 */
+    0x7D69502E,   /* lwzx r11,r9,r10 */
+    0x4200FFD8,   /* bdnz loop */
+};
+#define kPPCBenchMemSteps    (5 + 0x1000 * 11)
+
+/* Floating point: multiply, add, multiply-add, subtract, divide, and a
+ * double through memory. f1 comes back to itself each time round, and f7
+ * ends as 1.5 * 2.0, read back as an integer into r12. */
+static const UInt32 kPPCBenchFPU[] = {
+    0x3D200002,   /* lis r9,2 */
+    0x38C01000,   /* li r6,0x1000 */
+    0x7CC903A6,   /* mtctr r6 */
+    0xC8290000,   /* lfd f1,0(r9) */
+    0xC8490008,   /* loop: lfd f2,8(r9) */
+    0xFC6100B2,   /* fmul f3,f1,f2 */
+    0xFC83082A,   /* fadd f4,f3,f1 */
+    0xFCA120BA,   /* fmadd f5,f1,f2,f4 */
+    0xFCC52028,   /* fsub f6,f5,f4 */
+    0xFC261024,   /* fdiv f1,f6,f2 */
+    0xD8C90010,   /* stfd f6,16(r9) */
+    0xC8E90010,   /* lfd f7,16(r9) */
+    0x4200FFE0,   /* bdnz loop */
+    0xFD00381E,   /* fctiwz f8,f7 */
+    0xD9090018,   /* stfd f8,24(r9) */
+    0x8189001C,   /* lwz r12,28(r9) */
+};
+#define kPPCBenchFPUSteps    (4 + 0x1000 * 9 + 3)
+
+/* The operands the floating-point loop loads: 1.5 and 2.0, big-endian. */
+static const UInt8 kPPCBenchFPUData[16] = {
+    0x3F, 0xF8, 0, 0, 0, 0, 0, 0,
+    0x40, 0x00, 0, 0, 0, 0, 0, 0,
+};
+
+#define kPPCBenchCode  0x10000
+#define kPPCBenchData  0x20000
+
+static const struct {
+    const char*   name;
+    const UInt32* code;
+    UInt32        words;
+    UInt32        steps;
+    UInt8         reg;        /* a GPR whose final value is known */
+    UInt32        expect;
+} kPPCBenchMixes[] = {
+    { "integer",        kPPCBenchInt, sizeof(kPPCBenchInt) / 4, kPPCBenchIntSteps,  3, 0xD5B97800 },
+    { "load/store",     kPPCBenchMem, sizeof(kPPCBenchMem) / 4, kPPCBenchMemSteps,  4, 0x000000FF },
+    { "floating point", kPPCBenchFPU, sizeof(kPPCBenchFPU) / 4, kPPCBenchFPUSteps, 12, 3 },
+};
+
+static OSErr PPC_WriteProgram(PPCAddressSpace* as, UInt32 addr,
+                              const UInt32* code, UInt32 words)
+{
+    for (UInt32 i = 0; i < words; i++) {
+        UInt8 b[4] = {
+            (UInt8)(code[i] >> 24), (UInt8)(code[i] >> 16),
+            (UInt8)(code[i] >> 8), (UInt8)code[i]
+        };
+        OSErr err = PPC_WriteMemory((CPUAddressSpace)as, addr + i * 4, b, 4);
+        if (err != noErr) {
+            return err;
+        }
+    }
+    return noErr;
+}
+
+/* A fresh address space with one of the mixes and its data in place. */
+static PPCAddressSpace* PPC_BenchSpace(unsigned mix)
+{
+    CPUAddressSpace cas = NULL;
+    UInt8 data[64];
+
+    if (PPC_CreateAddressSpace(NULL, &cas) != noErr || !cas) {
+        return NULL;
+    }
+    memset(data, 0, sizeof(data));
+    memcpy(data, kPPCBenchFPUData, sizeof(kPPCBenchFPUData));
+    if (PPC_WriteMemory(cas, kPPCBenchData, data, sizeof(data)) != noErr ||
+        PPC_WriteProgram((PPCAddressSpace*)cas, kPPCBenchCode, kPPCBenchMixes[mix].code,
+                         kPPCBenchMixes[mix].words) != noErr) {
+        PPC_DestroyAddressSpace(cas);
+        return NULL;
+    }
+    return (PPCAddressSpace*)cas;
+}
+
+/* The dispatch PPC_Step did before the tables: every instruction fetched
+ * from paged memory and decoded from scratch by the switch. */
+static void PPC_StepUncached(PPCAddressSpace* as)
+{
+    UInt32 insn = PPC_Fetch32(as);
+    if (!as->halted) {
+        PPC_DecodeInsn(insn)(as, insn);
+    }
+}
+
+typedef enum { kPPCBenchDecoder, kPPCBenchTables, kPPCBenchPredecoded } PPCBenchMode;
+
+static void PPC_BenchRunOnce(PPCAddressSpace* as, UInt32 steps, PPCBenchMode mode)
+{
+    memset(as->regs.gpr, 0, sizeof(as->regs.gpr));
+    memset(as->regs.fpr, 0, sizeof(as->regs.fpr));
+    if (mode == kPPCBenchPredecoded) {
+        PPC_Execute(as, kPPCBenchCode, steps);
+        return;
+    }
+    as->regs.pc = kPPCBenchCode;
+    as->halted = false;
+    for (UInt32 i = 0; i < steps && !as->halted; i++) {
+        if (mode == kPPCBenchTables) {
+            PPC_Step(as);
+        } else {
+            PPC_StepUncached(as);
+        }
+    }
+}
+
+/*
+ * PPC_SelfTest - the decoded-instruction path against the old one
+ *
+ * Each benchmark mix is run through the switch, where one register has to
+ * come out as worked out by hand, and then through the predecoded pages,
+ * which have to leave every register the same. A short program checks loads
+ * and stores across a page boundary and the multiple and string instructions.
+ * Then a program that has already run - and so is decoded - is rewritten,
+ * once by the host and once by a guest store, and has to run as rewritten.
+ */
+void PPC_SelfTest(void)
+{
+    /* li r3,1; li r4,2; add r5,r3,r4 */
+    static const UInt32 kAdd[] = { 0x38600001, 0x38800002, 0x7CA32214 };
+    /* subf r5,r3,r4 - what the host writes over the add */
+    static const UInt32 kSubf[] = { 0x7CA32050 };
+    /* lis r9,1; lis r10,0x7CA3; ori r10,r10,0x2214; stw r10,8(r9) - the
+     * guest putting the add back */
+    static const UInt32 kPatch[] = { 0x3D200001, 0x3D407CA3, 0x614A2214, 0x91490008 };
+    PPCAddressSpace* as;
+
+    PPC_BuildDispatchTables();
+
+    for (unsigned m = 0; m < sizeof(kPPCBenchMixes) / sizeof(kPPCBenchMixes[0]); m++) {
+        UInt32 gpr[32];
+        double fpr[32];
+
+        as = PPC_BenchSpace(m);
+        if (!as) {
+            continue;
+        }
+        PPC_BenchRunOnce(as, kPPCBenchMixes[m].steps, kPPCBenchDecoder);
+        if (as->halted || as->regs.gpr[kPPCBenchMixes[m].reg] != kPPCBenchMixes[m].expect) {
+            serial_printf("[PPC] selftest %s FAILED: r%u=%08X, expected %08X\n",
+                          kPPCBenchMixes[m].name, kPPCBenchMixes[m].reg,
+                          as->regs.gpr[kPPCBenchMixes[m].reg], kPPCBenchMixes[m].expect);
+        }
+        memcpy(gpr, as->regs.gpr, sizeof(gpr));
+        memcpy(fpr, as->regs.fpr, sizeof(fpr));
+        PPC_BenchRunOnce(as, kPPCBenchMixes[m].steps, kPPCBenchPredecoded);
+        if (as->halted || memcmp(gpr, as->regs.gpr, sizeof(gpr)) != 0 ||
+            memcmp(fpr, as->regs.fpr, sizeof(fpr)) != 0) {
+            serial_printf("[PPC] selftest %s FAILED: predecoded run disagrees (r3=%08X, was %08X)\n",
+                          kPPCBenchMixes[m].name, as->regs.gpr[3], gpr[3]);
+        }
+        PPC_DestroyAddressSpace((CPUAddressSpace)as);
+    }
+
+    as = PPC_BenchSpace(0);
+    if (!as) {
+        return;
+    }
+    {
+        /* Loads and stores inside a page are one host access; these
+         * straddle two, and the halves must land in the right pages in the
+         * right order. Then the multiple and string instructions, which
+         * copy a whole page-resident range at once. */
+        static const UInt32 kMemProg[] = {
+            0x3D200002,   /* lis r9,2 */
+            0x61290FFE,   /* ori r9,r9,0x0FFE */
+            0x3C60CAFE,   /* lis r3,0xCAFE */
+            0x6063BABE,   /* ori r3,r3,0xBABE */
+            0x90690000,   /* stw r3,0(r9) */
+            0x80890000,   /* lwz r4,0(r9) */
+            0xA0A90002,   /* lhz r5,2(r9) */
+            0x3D400002,   /* lis r10,2 */
+            0x3B800001,   /* li r28,1 */
+            0x3BA00002,   /* li r29,2 */
+            0x3BC00003,   /* li r30,3 */
+            0x3BE00004,   /* li r31,4 */
+            0xBF8A0010,   /* stmw r28,16(r10) */
+            0x3B800000,   /* li r28,0 */
+            0x3BE00000,   /* li r31,0 */
+            0xBB8A0010,   /* lmw r28,16(r10) */
+            0x396A0010,   /* addi r11,r10,16 */
+            0x7D8B44AA,   /* lswi r12,r11,8 */
+            0x390A0020,   /* addi r8,r10,32 */
+            0x7FA835AA,   /* stswi r29,r8,6 */
+            0x80EA0020,   /* lwz r7,32(r10) */
+        };
+        static const struct { UInt8 reg; UInt32 value; } kMemWant[] = {
+            { 4, 0xCAFEBABE }, { 5, 0xBABE }, { 28, 1 }, { 31, 4 },
+            { 12, 1 }, { 13, 2 }, { 7, 2 },
+        };
+        UInt8 zero[32];
+
+        memset(zero, 0, sizeof(zero));
+        PPC_WriteMemory((CPUAddressSpace)as, kPPCBenchData + PPC_PAGE_SIZE - 16, zero, sizeof(zero));
+        PPC_WriteProgram(as, kPPCBenchCode, kMemProg, sizeof(kMemProg) / 4);
+        PPC_Execute(as, kPPCBenchCode, sizeof(kMemProg) / 4);
+        for (unsigned i = 0; i < sizeof(kMemWant) / sizeof(kMemWant[0]); i++) {
+            if (as->halted || as->regs.gpr[kMemWant[i].reg] != kMemWant[i].value) {
+                serial_printf("[PPC] selftest memory FAILED: r%u=%08X, expected %08X\n",
+                              kMemWant[i].reg, as->regs.gpr[kMemWant[i].reg],
+                              kMemWant[i].value);
+            }
+        }
+    }
+
+    PPC_WriteProgram(as, kPPCBenchCode, kAdd, 3);
+    PPC_WriteProgram(as, kPPCBenchCode + 0x100, kPatch, 4);
+    PPC_Execute(as, kPPCBenchCode, 3);
+    if (as->regs.gpr[5] != 3) {
+        serial_printf("[PPC] selftest code write FAILED: r5=%u before, expected 3\n",
+                      as->regs.gpr[5]);
+    }
+    PPC_WriteProgram(as, kPPCBenchCode + 8, kSubf, 1);
+    PPC_Execute(as, kPPCBenchCode, 3);
+    if (as->regs.gpr[5] != 1) {
+        serial_printf("[PPC] selftest code write FAILED: r5=%u after WriteMemory, expected 1\n",
+                      as->regs.gpr[5]);
+    }
+    PPC_Execute(as, kPPCBenchCode + 0x100, 4);
+    PPC_Execute(as, kPPCBenchCode, 3);
+    if (as->regs.gpr[5] != 3) {
+        serial_printf("[PPC] selftest code write FAILED: r5=%u after guest store, expected 3\n",
+                      as->regs.gpr[5]);
+    }
+    PPC_DestroyAddressSpace((CPUAddressSpace)as);
+}
+
+/*
+ * PPC_Benchmark - guest instructions per second, old dispatch against new
+ *
+ * Runs each mix the way PPC_Step used to work - fetch, then the switch -
+ * then through the handler tables, then from the predecoded pages, and
+ * reports each rate. Built in with PPC_BENCHMARK=1; nothing calls it in an
+ * ordinary boot.
+ */
+#define kPPCBenchRepeats  8
+
+static void PPC_BenchReport(const char* mix, const char* how, UInt32 instructions, UInt32 us)
+{
+    char b[128];
+    UInt32 whole, frac;
+
+    if (us == 0) {
+        us = 1;
+    }
+    whole = instructions / us;
+    frac = ((instructions % us) * 100) / us;
+    snprintf(b, sizeof(b), "[PPC] bench %s, %s: %u instructions in %u us, %u.%02u MIPS\n",
+             mix, how, (unsigned)instructions, (unsigned)us, (unsigned)whole, (unsigned)frac);
+    serial_puts(b);
+}
+
+void PPC_Benchmark(void)
+{
+    static const char* kHow[] = {
+        "decoder per instruction", "handler tables", "predecoded pages"
+    };
+
+    PPC_SelfTest();
+
+    for (unsigned m = 0; m < sizeof(kPPCBenchMixes) / sizeof(kPPCBenchMixes[0]); m++) {
+        PPCAddressSpace* as = PPC_BenchSpace(m);
+
+        if (!as) {
+            continue;
+        }
+        for (unsigned mode = kPPCBenchDecoder; mode <= kPPCBenchPredecoded; mode++) {
+            UnsignedWide t0, t1;
+
+            Microseconds(&t0);
+            for (UInt32 r = 0; r < kPPCBenchRepeats; r++) {
+                PPC_BenchRunOnce(as, kPPCBenchMixes[m].steps, (PPCBenchMode)mode);
+            }
+            Microseconds(&t1);
+            PPC_BenchReport(kPPCBenchMixes[m].name, kHow[mode],
+                            kPPCBenchMixes[m].steps * kPPCBenchRepeats, t1.lo - t0.lo);
+        }
+        PPC_DestroyAddressSpace((CPUAddressSpace)as);
+    }
+}
@@ -101,28 +101,133 @@ static inline float log2f(float x) {
  * Helper Functions
  */
 
+/*
+ * Big-endian loads and stores at a host pointer.
+ *
+ * One host access and, on a little-endian host, one swap. __builtin_memcpy
+ * rather than a cast, so an unaligned guest address is safe on hosts that
+ * trap unaligned loads, and rather than memcpy, which -fno-builtin would make
+ * a real call.
+ */
+static inline UInt16 PPC_LoadBE16(const UInt8* p)
+{
+    UInt16 v;
+    __builtin_memcpy(&v, p, 2);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    v = __builtin_bswap16(v);
+#endif
+    return v;
+}
+
+static inline UInt32 PPC_LoadBE32(const UInt8* p)
+{
+    UInt32 v;
+    __builtin_memcpy(&v, p, 4);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    return v;
+}
+
+static inline void PPC_StoreBE16(UInt8* p, UInt16 v)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    v = __builtin_bswap16(v);
+#endif
+    __builtin_memcpy(p, &v, 2);
+}
+
+static inline void PPC_StoreBE32(UInt8* p, UInt32 v)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    __builtin_memcpy(p, &v, 4);
+}
+
+/*
+ * PPC_Translate - host address of a guest byte, or NULL if its page is missing
+ *
+ * The page table is already a flat array of host page pointers covering the
+ * whole guest space, so a lookup is one indexed load. A TLB in front of it
+ * (as the 68K side has, for its lazily allocated pages) was tried and bought
+ * nothing: a hit costs the same load plus a tag compare.
+ *
+ * A missing page may be one of a MapPaged range not touched yet, which
+ * PPC_GetPage fills; anything else stays missing and the caller faults.
+ */
+static inline UInt8* PPC_Translate(PPCAddressSpace* as, UInt32 addr)
+{
+    UInt32 pageNum = addr >> PPC_PAGE_SHIFT;
+    UInt8* page;
+
+    if (pageNum >= PPC_NUM_PAGES) {
+        return NULL;
+    }
+    page = (UInt8*)as->pageTable[pageNum];
+    if (!page && (page = (UInt8*)PPC_GetPage(as, addr, false)) == NULL) {
+        return NULL;
+    }
+    return page + (addr & (PPC_PAGE_SIZE - 1));
+}
+
+/* Whether a `bytes`-long access at addr stays inside one page. */
+#define PPC_IN_ONE_PAGE(addr, bytes) \
+    (((addr) & (PPC_PAGE_SIZE - 1)) <= PPC_PAGE_SIZE - (bytes))
+
+/* Host address of [addr, addr+len) when it lies in one mapped page, for the
+ * multiple and string instructions to copy in one go; otherwise NULL, and
+ * they go a word or a byte at a time. */
+static UInt8* PPC_TranslateRange(PPCAddressSpace* as, UInt32 addr, UInt32 len)
+{
+    if (len == 0 || len > PPC_PAGE_SIZE || !PPC_IN_ONE_PAGE(addr, len)) {
+        return NULL;
+    }
+    return PPC_Translate(as, addr);
+}
+
+/*
+ * The slow halves of Read32/16 and Write32/16: an access that straddles a
+ * page, which used to run off the end of the first one, or one whose page is
+ * missing, which Read8/Write8 report. Kept out of line so the in-page path
+ * stays a leaf with nothing to save.
+ */
+static UInt32 PPC_ReadBytes(PPCAddressSpace* as, UInt32 addr, int bytes)
+{
+    UInt32 value = 0;
+
+    for (int i = 0; i < bytes && !as->halted; i++) {
+        value = (value << 8) | PPC_Read8(as, addr + i);
+    }
+    return as->halted ? 0 : value;
+}
+
+static void PPC_WriteBytes(PPCAddressSpace* as, UInt32 addr, UInt32 value, int bytes)
+{
+    for (int i = 0; i < bytes && !as->halted; i++) {
+        PPC_Write8(as, addr + i, (UInt8)(value >> (8 * (bytes - 1 - i))));
+    }
+}
+
 /* Fetch 32-bit instruction at PC and advance */
 UInt32 PPC_Fetch32(PPCAddressSpace* as)
 {
     UInt32 insn;
-    UInt8* page;
-    UInt32 pageNum, offset;
+    UInt8* p;
 
-    /* Get page */
-    pageNum = as->regs.pc >> PPC_PAGE_SHIFT;
-    if (pageNum >= PPC_NUM_PAGES || !as->pageTable[pageNum]) {
+    p = PPC_Translate(as, as->regs.pc);
+    if (!p) {
         PPC_Fault(as, "Instruction fetch from unmapped memory");
         return 0;
     }
 
-    page = (UInt8*)as->pageTable[pageNum];
-    offset = as->regs.pc & (PPC_PAGE_SIZE - 1);
-
-    /* Read big-endian 32-bit instruction */
-    insn = (page[offset] << 24) |
-           (page[offset + 1] << 16) |
-           (page[offset + 2] << 8) |
-           page[offset + 3];
+    /* Read big-endian 32-bit instruction. A misaligned PC near the end of a
+     * page used to read past it; its last bytes now come from the next. */
+    if (PPC_IN_ONE_PAGE(as->regs.pc, 4)) {
+        insn = PPC_LoadBE32(p);
+    } else {
+        insn = PPC_Read32(as, as->regs.pc);
+    }
 
     as->regs.pc += 4;
     return insn;
@@ -131,98 +236,74 @@ UInt32 PPC_Fetch32(PPCAddressSpace* as)
 /* Read memory (big-endian) */
 UInt32 PPC_Read32(PPCAddressSpace* as, UInt32 addr)
 {
-    UInt32 pageNum = addr >> PPC_PAGE_SHIFT;
-    UInt32 offset = addr & (PPC_PAGE_SIZE - 1);
-    UInt8* page;
+    UInt8* p;
 
-    if (pageNum >= PPC_NUM_PAGES || !as->pageTable[pageNum]) {
-        PPC_Fault(as, "Read from unmapped memory");
-        return 0;
+    if (PPC_IN_ONE_PAGE(addr, 4) && (p = PPC_Translate(as, addr)) != NULL) {
+        return PPC_LoadBE32(p);
     }
-
-    page = (UInt8*)as->pageTable[pageNum];
-    return (page[offset] << 24) | (page[offset + 1] << 16) |
-           (page[offset + 2] << 8) | page[offset + 3];
+    return PPC_ReadBytes(as, addr, 4);
 }
 
 UInt16 PPC_Read16(PPCAddressSpace* as, UInt32 addr)
 {
-    UInt32 pageNum = addr >> PPC_PAGE_SHIFT;
-    UInt32 offset = addr & (PPC_PAGE_SIZE - 1);
-    UInt8* page;
+    UInt8* p;
 
-    if (pageNum >= PPC_NUM_PAGES || !as->pageTable[pageNum]) {
-        PPC_Fault(as, "Read from unmapped memory");
-        return 0;
+    if (PPC_IN_ONE_PAGE(addr, 2) && (p = PPC_Translate(as, addr)) != NULL) {
+        return PPC_LoadBE16(p);
     }
-
-    page = (UInt8*)as->pageTable[pageNum];
-    return (page[offset] << 8) | page[offset + 1];
+    return (UInt16)PPC_ReadBytes(as, addr, 2);
 }
 
 UInt8 PPC_Read8(PPCAddressSpace* as, UInt32 addr)
 {
-    UInt32 pageNum = addr >> PPC_PAGE_SHIFT;
-    UInt32 offset = addr & (PPC_PAGE_SIZE - 1);
-    UInt8* page;
+    UInt8* p = PPC_Translate(as, addr);
 
-    if (pageNum >= PPC_NUM_PAGES || !as->pageTable[pageNum]) {
+    if (!p) {
         PPC_Fault(as, "Read from unmapped memory");
         return 0;
     }
-
-    page = (UInt8*)as->pageTable[pageNum];
-    return page[offset];
+    return *p;
 }
 
 /* Write memory (big-endian) */
 void PPC_Write32(PPCAddressSpace* as, UInt32 addr, UInt32 value)
 {
-    UInt32 pageNum = addr >> PPC_PAGE_SHIFT;
-    UInt32 offset = addr & (PPC_PAGE_SIZE - 1);
-    UInt8* page;
+    UInt8* p;
 
-    if (pageNum >= PPC_NUM_PAGES || !as->pageTable[pageNum]) {
-        PPC_Fault(as, "Write to unmapped memory");
+    if (!PPC_IN_ONE_PAGE(addr, 4) || (p = PPC_Translate(as, addr)) == NULL) {
+        PPC_WriteBytes(as, addr, value, 4);
         return;
     }
+    PPC_StoreBE32(p, value);
 
-    page = (UInt8*)as->pageTable[pageNum];
-    page[offset] = (value >> 24) & 0xFF;
-    page[offset + 1] = (value >> 16) & 0xFF;
-    page[offset + 2] = (value >> 8) & 0xFF;
-    page[offset + 3] = value & 0xFF;
+    /* Unaligned, it can land on two instruction words. */
+    PPC_InvalidateCodeWord(as, addr);
+    PPC_InvalidateCodeWord(as, addr + 3);
 }
 
 void PPC_Write16(PPCAddressSpace* as, UInt32 addr, UInt16 value)
 {
-    UInt32 pageNum = addr >> PPC_PAGE_SHIFT;
-    UInt32 offset = addr & (PPC_PAGE_SIZE - 1);
-    UInt8* page;
+    UInt8* p;
 
-    if (pageNum >= PPC_NUM_PAGES || !as->pageTable[pageNum]) {
-        PPC_Fault(as, "Write to unmapped memory");
+    if (!PPC_IN_ONE_PAGE(addr, 2) || (p = PPC_Translate(as, addr)) == NULL) {
+        PPC_WriteBytes(as, addr, value, 2);
         return;
     }
-
-    page = (UInt8*)as->pageTable[pageNum];
-    page[offset] = (value >> 8) & 0xFF;
-    page[offset + 1] = value & 0xFF;
+    PPC_StoreBE16(p, value);
+    PPC_InvalidateCodeWord(as, addr);
+    PPC_InvalidateCodeWord(as, addr + 1);
 }
 
 void PPC_Write8(PPCAddressSpace* as, UInt32 addr, UInt8 value)
 {
-    UInt32 pageNum = addr >> PPC_PAGE_SHIFT;
-    UInt32 offset = addr & (PPC_PAGE_SIZE - 1);
-    UInt8* page;
+    UInt8* p = PPC_Translate(as, addr);
 
-    if (pageNum >= PPC_NUM_PAGES || !as->pageTable[pageNum]) {
+    if (!p) {
         PPC_Fault(as, "Write to unmapped memory");
         return;
     }
-
-    page = (UInt8*)as->pageTable[pageNum];
-    page[offset] = value;
+    *p = value;
+    PPC_InvalidateCodeWord(as, addr);
 }
 
 /* Set CR0 based on signed result */
@@ -1288,18 +1369,20 @@ void PPC_Op_SRAWI(PPCAddressSpace* as, UInt32 insn)
  * ============================================================================
  */
 
-/* Helper: Create mask from MB to ME */
+/* Helper: Create mask from MB to ME (bit 0 is the most significant).
+ * Built from two shifts of at most 31; the old form shifted by 32 - mb, so
+ * every mask starting at bit 0 - slwi, clrrwi and most rlwinm - was empty. */
 static UInt32 PPC_MakeMask(UInt8 mb, UInt8 me)
 {
-    UInt32 mask;
+    UInt32 fromMB = 0xFFFFFFFFU >> mb;          /* bits MB..31 */
+    UInt32 toME = 0xFFFFFFFFU << (31 - me);     /* bits 0..ME */
+
     if (mb <= me) {
         /* Normal case: MB...ME */
-        mask = ((1U << (32 - mb)) - 1) & ~((1U << (31 - me)) - 1);
-    } else {
-        /* Wrapped case: ME...MB */
-        mask = ~(((1U << (32 - me - 1)) - 1) & ~((1U << (31 - mb + 1)) - 1));
+        return fromMB & toME;
     }
-    return mask;
+    /* Wrapped case: ME...MB */
+    return fromMB | toME;
 }
 
 /*
@@ -1649,6 +1732,7 @@ void PPC_Op_LMW(PPCAddressSpace* as, UInt32 insn)
     SInt16 d = PPC_SIMM(insn);
     UInt32 ea;
     UInt8 r;
+    UInt8* p;
 
     if (ra == 0) {
         ea = d;
@@ -1656,6 +1740,15 @@ void PPC_Op_LMW(PPCAddressSpace* as, UInt32 insn)
         ea = as->regs.gpr[ra] + d;
     }
 
+    /* Within one page: one translation, then a load per register */
+    p = PPC_TranslateRange(as, ea, (32 - rd) * 4);
+    if (p) {
+        for (r = rd; r <= 31; r++, p += 4) {
+            as->regs.gpr[r] = PPC_LoadBE32(p);
+        }
+        return;
+    }
+
     for (r = rd; r <= 31; r++) {
         as->regs.gpr[r] = PPC_Read32(as, ea);
         ea += 4;
@@ -1673,6 +1766,7 @@ void PPC_Op_STMW(PPCAddressSpace* as, UInt32 insn)
     SInt16 d = PPC_SIMM(insn);
     UInt32 ea;
     UInt8 r;
+    UInt8* p;
 
     if (ra == 0) {
         ea = d;
@@ -1680,6 +1774,15 @@ void PPC_Op_STMW(PPCAddressSpace* as, UInt32 insn)
         ea = as->regs.gpr[ra] + d;
     }
 
+    p = PPC_TranslateRange(as, ea, (32 - rs) * 4);
+    if (p) {
+        for (r = rs; r <= 31; r++, p += 4) {
+            PPC_StoreBE32(p, as->regs.gpr[r]);
+        }
+        PPC_InvalidateCode(as, ea, (32 - rs) * 4);
+        return;
+    }
+
     for (r = rs; r <= 31; r++) {
         PPC_Write32(as, ea, as->regs.gpr[r]);
         ea += 4;
@@ -1872,9 +1975,20 @@ void PPC_Op_CRORC(PPCAddressSpace* as, UInt32 insn)
  */
 void PPC_Op_SC(PPCAddressSpace* as, UInt32 insn)
 {
+    CPUTrapHandler handler = as->trapHandlers[as->regs.gpr[0] & 0xFF];
+
     (void)insn;
-    /* For now, treat as trap/halt */
-    PPC_Fault(as, "System call (sc) instruction - trap handler needed");
+
+    /* The trap number is in r0, as the system call number is on every
+     * PowerPC OS that has one. A handler sees pc already past the sc and
+     * may move it; the registers are the GPRs. */
+    if (!handler) {
+        PPC_Fault(as, "System call (sc) instruction - trap handler needed");
+        return;
+    }
+    if (handler(as->trapContexts[as->regs.gpr[0] & 0xFF], &as->regs.pc, as->regs.gpr) != noErr) {
+        PPC_Fault(as, "System call (sc) trap handler failed");
+    }
 }
 
 /*
@@ -2236,7 +2350,7 @@ void PPC_Op_MTCRF(PPCAddressSpace* as, UInt32 insn)
 void PPC_Op_MFSPR(PPCAddressSpace* as, UInt32 insn)
 {
     UInt8 rd = PPC_RD(insn);
-    UInt16 spr = ((insn >> 11) & 0x1F) | (((insn >> 16) & 0x1F) << 5);
+    UInt16 spr = PPC_SPR(insn);
 
     switch (spr) {
         /* User SPRs */
@@ -2364,7 +2478,7 @@ void PPC_Op_MFSPR(PPCAddressSpace* as, UInt32 insn)
 void PPC_Op_MTSPR(PPCAddressSpace* as, UInt32 insn)
 {
     UInt8 rs = PPC_RS(insn);
-    UInt16 spr = ((insn >> 11) & 0x1F) | (((insn >> 16) & 0x1F) << 5);
+    UInt16 spr = PPC_SPR(insn);
     UInt32 value = as->regs.gpr[rs];
 
     switch (spr) {
@@ -2892,6 +3006,7 @@ void PPC_Op_LSWI(PPCAddressSpace* as, UInt32 insn)
     UInt8 reg;
     UInt32 value;
     int shift;
+    const UInt8* src;
 
     if (nb == 0) {
         count = 32;
@@ -2904,8 +3019,10 @@ void PPC_Op_LSWI(PPCAddressSpace* as, UInt32 insn)
     value = 0;
     shift = 24;
 
+    /* One translation for the whole string when it sits in one page */
+    src = PPC_TranslateRange(as, ea, count);
     for (UInt32 i = 0; i < count; i++) {
-        value |= ((UInt32)PPC_Read8(as, ea + i)) << shift;
+        value |= ((UInt32)(src ? src[i] : PPC_Read8(as, ea + i))) << shift;
         shift -= 8;
 
         if (shift < 0 || i == count - 1) {
@@ -2931,6 +3048,7 @@ void PPC_Op_LSWX(PPCAddressSpace* as, UInt32 insn)
     UInt8 reg;
     UInt32 value;
     int shift;
+    const UInt8* src;
 
     count = as->regs.xer & 0x7F;
 
@@ -2943,8 +3061,9 @@ void PPC_Op_LSWX(PPCAddressSpace* as, UInt32 insn)
     value = 0;
     shift = 24;
 
+    src = PPC_TranslateRange(as, ea, count);
     for (UInt32 i = 0; i < count; i++) {
-        value |= ((UInt32)PPC_Read8(as, ea + i)) << shift;
+        value |= ((UInt32)(src ? src[i] : PPC_Read8(as, ea + i))) << shift;
         shift -= 8;
 
         if (shift < 0 || i == count - 1) {
@@ -2970,6 +3089,7 @@ void PPC_Op_STSWI(PPCAddressSpace* as, UInt32 insn)
     UInt8 reg;
     UInt32 value;
     int shift;
+    UInt8* dst;
 
     if (nb == 0) {
         count = 32;
@@ -2982,8 +3102,14 @@ void PPC_Op_STSWI(PPCAddressSpace* as, UInt32 insn)
     value = as->regs.gpr[reg];
     shift = 24;
 
+    /* One translation for the whole string when it sits in one page */
+    dst = PPC_TranslateRange(as, ea, count);
     for (UInt32 i = 0; i < count; i++) {
-        PPC_Write8(as, ea + i, (UInt8)((value >> shift) & 0xFF));
+        if (dst) {
+            dst[i] = (UInt8)((value >> shift) & 0xFF);
+        } else {
+            PPC_Write8(as, ea + i, (UInt8)((value >> shift) & 0xFF));
+        }
         shift -= 8;
 
         if (shift < 0) {
@@ -2992,6 +3118,9 @@ void PPC_Op_STSWI(PPCAddressSpace* as, UInt32 insn)
             shift = 24;
         }
     }
+    if (dst) {
+        PPC_InvalidateCode(as, ea, count);
+    }
 }
 
 /*
@@ -3008,6 +3137,7 @@ void PPC_Op_STSWX(PPCAddressSpace* as, UInt32 insn)
     UInt8 reg;
     UInt32 value;
     int shift;
+    UInt8* dst;
 
     count = as->regs.xer & 0x7F;
 
@@ -3020,8 +3150,13 @@ void PPC_Op_STSWX(PPCAddressSpace* as, UInt32 insn)
     value = as->regs.gpr[reg];
     shift = 24;
 
+    dst = PPC_TranslateRange(as, ea, count);
     for (UInt32 i = 0; i < count; i++) {
-        PPC_Write8(as, ea + i, (UInt8)((value >> shift) & 0xFF));
+        if (dst) {
+            dst[i] = (UInt8)((value >> shift) & 0xFF);
+        } else {
+            PPC_Write8(as, ea + i, (UInt8)((value >> shift) & 0xFF));
+        }
         shift -= 8;
 
         if (shift < 0) {
@@ -3030,6 +3165,9 @@ void PPC_Op_STSWX(PPCAddressSpace* as, UInt32 insn)
             shift = 24;
         }
     }
+    if (dst) {
+        PPC_InvalidateCode(as, ea, count);
+    }
 }
 
 /*
@@ -4554,7 +4692,7 @@ void PPC_Op_DCBA(PPCAddressSpace* as, UInt32 insn)
 void PPC_Op_MFTB(PPCAddressSpace* as, UInt32 insn)
 {
     UInt8 rd = PPC_RD(insn);
-    UInt16 tbr = ((insn >> 11) & 0x1F) | (((insn >> 16) & 0x1F) << 5);
+    UInt16 tbr = PPC_SPR(insn);
 
     switch (tbr) {
         case 268: /* TBL */
@@ -0,0 +1,1003 @@
+/*
+ * CodeFragments.c - Code Fragment Manager
+ *
+ * Loads PEF fragments into a CPU address space and binds their imports.
+ * The container format itself is PEFLoader.c's; this file decides where
+ * sections go, when they are read, and when each import is bound.
+ *
+ * Launch cost is kept to what the program uses:
+ * - Code and constant sections that need no relocation are mapped paged
+ *   from the container: a page is read the first time it is touched
+ * - Imported routines get stub TVectors that bind on first call, so a
+ *   library nothing has called yet is not even read
+ * Only the data sections, which relocation has to rewrite anyway, and the
+ * loader section are read at load.
+ */
+
+#include "CodeFragments/CodeFragments.h"
+#include "CodeFragments/PEFBinaryFormat.h"
+#include "CodeFragments/CFMLogging.h"
+#include "SegmentLoader/CodeParser.h"
+#include "MemoryMgr/MemoryManager.h"
+#include "System71StdLib.h"
+#include <string.h>
+
+/* Forward declarations */
+static OSErr CFM_LoadLibrary(CFragContext* ctx, CFragLibrary* lib, CFragFragment** outFrag);
+static OSErr CFM_BindTrap(void* context, CPUAddr* pc, CPUAddr* registers);
+
+/*
+ * The bind glue, one copy per fragment with lazy imports, in front of that
+ * fragment's stub TVectors. A stub's code pointer is the glue and its TOC
+ * pointer a cookie naming the import; the cross-fragment call sequence has
+ * already loaded the TOC pointer into r2 by the time the glue runs:
+ *
+ *   li   r0, kCFMBindTrap
+ *   sc
+ */
+#define kCFMGlueSize        8
+#define kCFMStubSize        8       /* a TVector: code, TOC */
+
+#define CFM_COOKIE(fragIndex, importIndex)  (((UInt32)(fragIndex) << 24) | (importIndex))
+#define CFM_COOKIE_FRAG(cookie)             ((cookie) >> 24)
+#define CFM_COOKIE_IMPORT(cookie)           ((cookie) & 0x00FFFFFF)
+
+/*
+ * Container access
+ */
+
+static OSErr CFM_ReadContainer(const CFragContainer* c, UInt32 offset,
+                               void* buffer, UInt32 length)
+{
+    if (offset > c->length || length > c->length - offset) {
+        return cfragFragmentCorruptErr;
+    }
+    if (c->mapped) {
+        memcpy(buffer, c->mapped + offset, length);
+        return noErr;
+    }
+    if (!c->read) {
+        return paramErr;
+    }
+    return c->read(c->refCon, offset, buffer, length);
+}
+
+/*
+ * CFM_PageInSection - fill part of a paged section from its container
+ *
+ * Past the initialized part, the page is left as it arrived: zero.
+ */
+static OSErr CFM_PageInSection(void* refCon, UInt32 offset, void* dst, UInt32 len)
+{
+    CFragSection* sec = (CFragSection*)refCon;
+    UInt32 init = sec->unpackedSize < sec->containerLength ?
+                  sec->unpackedSize : sec->containerLength;
+
+    if (offset >= init) {
+        return noErr;
+    }
+    if (len > init - offset) {
+        len = init - offset;
+    }
+    CFM_LOG_TRACE("page in %s +0x%X (%u bytes)\n", sec->frag->name, offset, len);
+    return CFM_ReadContainer(&sec->frag->container, sec->containerOffset + offset, dst, len);
+}
+
+/*
+ * Loader section access
+ */
+
+/* NUL-terminated string at offset into the loader strings, or NULL */
+static const char* CFM_LoaderString(const CFragFragment* frag, UInt32 offset)
+{
+    UInt32 at = BE_Read32(frag->loader + PEF_LDR_STRINGS_OFFSET) + offset;
+
+    if (at < offset || at >= frag->loaderLength) {
+        return NULL;
+    }
+    if (!memchr(frag->loader + at, 0, frag->loaderLength - at)) {
+        return NULL;
+    }
+    return (const char*)frag->loader + at;
+}
+
+/* Imported symbol table */
+static const UInt8* CFM_ImportTable(const CFragFragment* frag)
+{
+    UInt32 libCount = BE_Read32(frag->loader + PEF_LDR_LIBRARY_COUNT);
+    return frag->loader + PEF_LOADER_HEADER_SIZE + libCount * PEF_IMPORTED_LIBRARY_SIZE;
+}
+
+/*
+ * CFM_ImportInfo - name, class and library of an import
+ *
+ * Imports are numbered across the whole fragment; which library one comes
+ * from is found by looking for the library whose range covers it.
+ */
+static OSErr CFM_ImportInfo(const CFragFragment* frag, UInt32 index,
+                            const char** outLib, const char** outSym,
+                            UInt8* outClass, Boolean* outWeak)
+{
+    UInt32 libCount = BE_Read32(frag->loader + PEF_LDR_LIBRARY_COUNT);
+    UInt32 word = BE_Read32(CFM_ImportTable(frag) + index * PEF_IMPORTED_SYMBOL_SIZE);
+
+    for (UInt32 i = 0; i < libCount; i++) {
+        const UInt8* lib = frag->loader + PEF_LOADER_HEADER_SIZE + i * PEF_IMPORTED_LIBRARY_SIZE;
+        UInt32 first = BE_Read32(lib + PEF_LIB_FIRST_SYMBOL);
+        UInt32 count = BE_Read32(lib + PEF_LIB_SYMBOL_COUNT);
+
+        if (index < first || index - first >= count) {
+            continue;
+        }
+        *outLib = CFM_LoaderString(frag, BE_Read32(lib + PEF_LIB_NAME_OFFSET));
+        *outSym = CFM_LoaderString(frag, PEF_SYMBOL_NAME(word));
+        *outClass = PEF_SYMBOL_CLASS(word);
+        *outWeak = (lib[PEF_LIB_OPTIONS] & kPEFWeakImportLibMask) ||
+                   (PEF_SYMBOL_FLAGS(word) & kPEFWeakImportSymMask);
+        if (!*outLib || !*outSym) {
+            return cfragFragmentCorruptErr;
+        }
+        return noErr;
+    }
+
+    return cfragFragmentCorruptErr;
+}
+
+/* Section's relocation header, or NULL if it has none */
+static const UInt8* CFM_RelocHeader(const CFragFragment* frag, UInt32 section)
+{
+    UInt32 count = BE_Read32(frag->loader + PEF_LDR_RELOC_SECTION_COUNT);
+    const UInt8* hdr = CFM_ImportTable(frag) + frag->importCount * PEF_IMPORTED_SYMBOL_SIZE;
+
+    for (UInt32 i = 0; i < count; i++, hdr += PEF_RELOC_HEADER_SIZE) {
+        if (BE_Read16(hdr + PEF_RELOC_SECTION_INDEX) == section) {
+            return hdr;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * CFM_CheckLoader - check the loader section's tables lie inside it
+ *
+ * Everything after this reads the tables without further checks.
+ */
+static OSErr CFM_CheckLoader(CFragFragment* frag)
+{
+    const UInt8* ld = frag->loader;
+    UInt32 len = frag->loaderLength;
+    UInt32 libCount, importCount, relocCount, instrOff, end;
+
+    if (len < PEF_LOADER_HEADER_SIZE) {
+        return cfragFragmentCorruptErr;
+    }
+    libCount = BE_Read32(ld + PEF_LDR_LIBRARY_COUNT);
+    importCount = BE_Read32(ld + PEF_LDR_IMPORT_COUNT);
+    relocCount = BE_Read32(ld + PEF_LDR_RELOC_SECTION_COUNT);
+    instrOff = BE_Read32(ld + PEF_LDR_RELOC_INSTR_OFFSET);
+
+    if (libCount > len / PEF_IMPORTED_LIBRARY_SIZE ||
+        importCount > len / PEF_IMPORTED_SYMBOL_SIZE ||
+        relocCount > len / PEF_RELOC_HEADER_SIZE ||
+        importCount > CFM_COOKIE_IMPORT(~0UL)) {
+        return cfragFragmentCorruptErr;
+    }
+    end = PEF_LOADER_HEADER_SIZE + libCount * PEF_IMPORTED_LIBRARY_SIZE +
+          importCount * PEF_IMPORTED_SYMBOL_SIZE + relocCount * PEF_RELOC_HEADER_SIZE;
+    if (end > len || instrOff > len ||
+        BE_Read32(ld + PEF_LDR_STRINGS_OFFSET) > len) {
+        return cfragFragmentCorruptErr;
+    }
+
+    for (UInt32 i = 0; i < libCount; i++) {
+        const UInt8* lib = ld + PEF_LOADER_HEADER_SIZE + i * PEF_IMPORTED_LIBRARY_SIZE;
+        UInt32 first = BE_Read32(lib + PEF_LIB_FIRST_SYMBOL);
+        UInt32 count = BE_Read32(lib + PEF_LIB_SYMBOL_COUNT);
+
+        if (first > importCount || count > importCount - first) {
+            return cfragFragmentCorruptErr;
+        }
+    }
+
+    frag->importCount = importCount;
+    return noErr;
+}
+
+/*
+ * Libraries and symbols
+ */
+
+static CFragLibrary* CFM_FindLibrary(CFragContext* ctx, const char* name)
+{
+    for (UInt16 i = 0; i < ctx->numLibraries; i++) {
+        if (strcmp(ctx->libraries[i].name, name) == 0) {
+            return &ctx->libraries[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * CFM_ResolveImport - address of what an import names
+ *
+ * Loads the library if nothing has yet. A weak import that cannot be
+ * resolved is kUnresolvedCFragSymbolAddress; a strong one is an error.
+ */
+static OSErr CFM_ResolveImport(CFragFragment* frag, UInt32 index, CPUAddr* outAddr)
+{
+    const char* libName;
+    const char* symName;
+    UInt8 symClass;
+    Boolean weak;
+    CFragLibrary* lib;
+    CFragFragment* exporter;
+    OSErr err;
+
+    err = CFM_ImportInfo(frag, index, &libName, &symName, &symClass, &weak);
+    if (err != noErr) {
+        return err;
+    }
+
+    lib = CFM_FindLibrary(frag->ctx, libName);
+    if (!lib) {
+        if (weak) {
+            *outAddr = kUnresolvedCFragSymbolAddress;
+            return noErr;
+        }
+        CFM_LOG_ERROR("%s imports from %s, which is not registered\n", frag->name, libName);
+        return cfragNoLibraryErr;
+    }
+
+    err = CFM_LoadLibrary(frag->ctx, lib, &exporter);
+    if (err == noErr) {
+        err = CFM_FindSymbol(exporter, symName, outAddr, NULL);
+    }
+    if (err != noErr) {
+        if (weak) {
+            *outAddr = kUnresolvedCFragSymbolAddress;
+            return noErr;
+        }
+        CFM_LOG_ERROR("%s: cannot resolve %s in %s (%d)\n", frag->name, symName, libName, err);
+        return (err == cfragNoSymbolErr) ? cfragUnresolvedErr : err;
+    }
+
+    (void)symClass;
+    return noErr;
+}
+
+/*
+ * CFM_FindSymbol - Address of an export
+ */
+OSErr CFM_FindSymbol(CFragFragment* frag, const char* name,
+                     CPUAddr* outAddr, UInt8* outClass)
+{
+    UInt32 value;
+    SInt16 section;
+    OSErr err;
+
+    if (!frag || !name || !outAddr) {
+        return paramErr;
+    }
+
+    err = PEF_FindExport(frag->loader, frag->loaderLength, name, &value, &section, outClass);
+    if (err != noErr) {
+        return err;
+    }
+
+    if (section == kPEFAbsoluteExport) {
+        *outAddr = value;
+    } else if (section == kPEFReexportedImport) {
+        if (value >= frag->importCount) {
+            return cfragFragmentCorruptErr;
+        }
+        *outAddr = frag->imports[value];
+    } else if (section >= 0 && section < frag->sectionCount && frag->sections[section].base) {
+        *outAddr = frag->sections[section].base + value;
+    } else {
+        return cfragNoSectionErr;
+    }
+
+    return noErr;
+}
+
+/*
+ * CFM_BindTrap - bind a stub on its first call
+ *
+ * Arrives from the glue with the stub's cookie in r2. The stub becomes a
+ * copy of the export's TVector, and the call carries on into the export
+ * with its TOC, exactly as if the stub had been bound all along; the link
+ * register still returns to the caller. Later calls go straight through.
+ */
+static OSErr CFM_BindTrap(void* context, CPUAddr* pc, CPUAddr* registers)
+{
+    CFragContext* ctx = (CFragContext*)context;
+    UInt32 cookie = registers[2];
+    UInt32 fragIndex = CFM_COOKIE_FRAG(cookie);
+    UInt32 index = CFM_COOKIE_IMPORT(cookie);
+    CFragFragment* frag;
+    UInt8 tvector[kCFMStubSize];
+    CPUAddr target;
+    OSErr err;
+
+    if (fragIndex >= ctx->numFragments || !(frag = ctx->fragments[fragIndex]) ||
+        index >= frag->importCount) {
+        CFM_LOG_ERROR("bind trap with bad cookie 0x%08X\n", cookie);
+        return cfragFragmentCorruptErr;
+    }
+
+    err = CFM_ResolveImport(frag, index, &target);
+    if (err == noErr && target == kUnresolvedCFragSymbolAddress) {
+        err = cfragUnresolvedErr;
+    }
+    if (err == noErr) {
+        err = ctx->backend->ReadMemory(ctx->as, target, tvector, kCFMStubSize);
+    }
+    if (err == noErr) {
+        err = ctx->backend->WriteMemory(ctx->as, frag->imports[index], tvector, kCFMStubSize);
+    }
+    if (err != noErr) {
+        CFM_LOG_ERROR("%s: cannot bind import %u (%d)\n", frag->name, index, err);
+        return err;
+    }
+
+    frag->lazyBound++;
+    registers[2] = BE_Read32(tvector + 4);
+    *pc = BE_Read32(tvector);
+    CFM_LOG_DEBUG("%s: bound import %u to 0x%08X\n", frag->name, index, target);
+    return noErr;
+}
+
+/*
+ * Loading
+ */
+
+/*
+ * CFM_BindImports - give every import an address
+ *
+ * A strong routine import from a registered library gets a stub, and
+ * nothing is looked at until it is called. The rest are resolved now:
+ * data, whose address the program may load and use without a call, and
+ * weak imports, whose address the program compares against zero first.
+ */
+static OSErr CFM_BindImports(CFragFragment* frag)
+{
+    CFragContext* ctx = frag->ctx;
+    UInt32 lazy = 0;
+    UInt32 stub;
+    UInt8* block;
+    OSErr err;
+
+    if (frag->importCount == 0) {
+        return noErr;
+    }
+    frag->imports = (CPUAddr*)NewPtr(frag->importCount * sizeof(CPUAddr));
+    if (!frag->imports) {
+        return memFullErr;
+    }
+
+    for (UInt32 i = 0; i < frag->importCount; i++) {
+        const char* libName;
+        const char* symName;
+        UInt8 symClass;
+        Boolean weak;
+
+        err = CFM_ImportInfo(frag, i, &libName, &symName, &symClass, &weak);
+        if (err != noErr) {
+            return err;
+        }
+        /* 0 until resolved; 1, which no TVector can be at, marks a stub */
+        frag->imports[i] = 0;
+        if (symClass == kPEFTVectorSymbol && !weak && CFM_FindLibrary(ctx, libName)) {
+            frag->imports[i] = 1;
+            lazy++;
+        }
+    }
+
+    if (lazy > 0) {
+        UInt32 size = kCFMGlueSize + lazy * kCFMStubSize;
+
+        err = ctx->backend->AllocateMemory(ctx->as, size, kCPUMapExecutable, &frag->glue);
+        if (err != noErr) {
+            return err;
+        }
+        block = (UInt8*)NewPtr(size);
+        if (!block) {
+            return memFullErr;
+        }
+        BE_Write32(block, 0x38000000 | kCFMBindTrap);  /* li r0,kCFMBindTrap */
+        BE_Write32(block + 4, 0x44000002);              /* sc */
+
+        stub = kCFMGlueSize;
+        for (UInt32 i = 0; i < frag->importCount; i++) {
+            if (frag->imports[i] != 1) {
+                continue;
+            }
+            BE_Write32(block + stub, frag->glue);
+            BE_Write32(block + stub + 4, CFM_COOKIE(frag->index, i));
+            frag->imports[i] = frag->glue + stub;
+            stub += kCFMStubSize;
+        }
+        err = ctx->backend->WriteMemory(ctx->as, frag->glue, block, size);
+        DisposePtr((Ptr)block);
+        if (err != noErr) {
+            return err;
+        }
+        frag->lazyImports = lazy;
+
+        if (!ctx->trapInstalled) {
+            err = ctx->backend->InstallTrap(ctx->as, kCFMBindTrap, CFM_BindTrap, ctx);
+            if (err != noErr) {
+                return err;
+            }
+            ctx->trapInstalled = true;
+        }
+    }
+
+    for (UInt32 i = 0; i < frag->importCount; i++) {
+        if (frag->imports[i] == 0) {
+            err = CFM_ResolveImport(frag, i, &frag->imports[i]);
+            if (err != noErr) {
+                return err;
+            }
+        }
+    }
+
+    return noErr;
+}
+
+/*
+ * CFM_PlaceSections - give every instantiated section an address
+ *
+ * Only addresses: relocation needs all of them before any section's
+ * contents can be finished.
+ */
+static OSErr CFM_PlaceSections(CFragFragment* frag)
+{
+    CFragContext* ctx = frag->ctx;
+    OSErr err;
+
+    for (UInt16 i = 0; i < frag->sectionCount; i++) {
+        CFragSection* sec = &frag->sections[i];
+        UInt32 align = 1UL << sec->alignment;
+        CPUAddr base;
+
+        switch (sec->kind) {
+            case kPEFCodeSection:
+            case kPEFConstantSection:
+            case kPEFUnpackedDataSection:
+            case kPEFPatternDataSection:
+            case kPEFExecDataSection:
+                break;
+            default:
+                continue;
+        }
+        if (sec->totalSize == 0) {
+            continue;
+        }
+
+        if ((sec->kind == kPEFCodeSection || sec->kind == kPEFConstantSection) &&
+            ctx->backend->MapPaged && !CFM_RelocHeader(frag, i) &&
+            sec->alignment <= 12) {
+            sec->paged = true;
+            err = ctx->backend->MapPaged(ctx->as, sec->totalSize, CFM_PageInSection,
+                                         sec, &sec->base);
+            if (err != noErr) {
+                return err;
+            }
+            continue;
+        }
+
+        /* AllocateMemory gives 16-byte alignment; ask for slack beyond that */
+        err = ctx->backend->AllocateMemory(ctx->as,
+                                           sec->totalSize + (align > 16 ? align - 16 : 0),
+                                           sec->kind == kPEFCodeSection ?
+                                           kCPUMapExecutable : 0, &base);
+        if (err != noErr) {
+            return err;
+        }
+        sec->base = (base + align - 1) & ~(align - 1);
+    }
+
+    return noErr;
+}
+
+/*
+ * CFM_FillSection - read, unpack and relocate a section that is not paged
+ */
+static OSErr CFM_FillSection(CFragFragment* frag, UInt16 index, const CPUAddr* bases)
+{
+    CFragContext* ctx = frag->ctx;
+    CFragSection* sec = &frag->sections[index];
+    const UInt8* reloc;
+    UInt8* image;
+    UInt8* packed = NULL;
+    OSErr err;
+
+    image = (UInt8*)NewPtr(sec->totalSize);
+    if (!image) {
+        return memFullErr;
+    }
+    memset(image, 0, sec->totalSize);
+
+    if (sec->kind == kPEFPatternDataSection) {
+        const UInt8* src;
+
+        if (sec->unpackedSize > sec->totalSize) {
+            err = cfragFragmentCorruptErr;
+            goto done;
+        }
+        if (frag->container.mapped) {
+            if (sec->containerOffset > frag->container.length ||
+                sec->containerLength > frag->container.length - sec->containerOffset) {
+                err = cfragFragmentCorruptErr;
+                goto done;
+            }
+            src = frag->container.mapped + sec->containerOffset;
+        } else {
+            packed = (UInt8*)NewPtr(sec->containerLength);
+            if (!packed) {
+                err = memFullErr;
+                goto done;
+            }
+            err = CFM_ReadContainer(&frag->container, sec->containerOffset,
+                                    packed, sec->containerLength);
+            if (err != noErr) {
+                goto done;
+            }
+            src = packed;
+        }
+        err = PEF_UnpackData(src, sec->containerLength, image, sec->unpackedSize);
+    } else {
+        UInt32 init = sec->unpackedSize < sec->containerLength ?
+                      sec->unpackedSize : sec->containerLength;
+        if (init > sec->totalSize) {
+            init = sec->totalSize;
+        }
+        err = CFM_ReadContainer(&frag->container, sec->containerOffset, image, init);
+    }
+    if (err != noErr) {
+        goto done;
+    }
+
+    reloc = CFM_RelocHeader(frag, index);
+    if (reloc) {
+        UInt32 instrOff = BE_Read32(frag->loader + PEF_LDR_RELOC_INSTR_OFFSET) +
+                          BE_Read32(reloc + PEF_RELOC_FIRST_OFFSET);
+        UInt32 count = BE_Read32(reloc + PEF_RELOC_COUNT);
+
+        if (instrOff > frag->loaderLength || count > (frag->loaderLength - instrOff) / 2) {
+            err = cfragFragmentCorruptErr;
+            goto done;
+        }
+        err = PEF_Relocate(image, sec->totalSize, frag->loader + instrOff, count,
+                           bases, frag->sectionCount, frag->imports, frag->importCount);
+        if (err != noErr) {
+            goto done;
+        }
+    }
+
+    err = ctx->backend->WriteMemory(ctx->as, sec->base, image, sec->totalSize);
+
+done:
+    if (packed) {
+        DisposePtr((Ptr)packed);
+    }
+    DisposePtr((Ptr)image);
+    return err;
+}
+
+/* Address a loader-header (section, offset) pair names, or 0 for none */
+static CPUAddr CFM_LoaderAddress(const CFragFragment* frag, UInt32 sectionField, UInt32 offsetField)
+{
+    SInt32 section = (SInt32)BE_Read32(frag->loader + sectionField);
+
+    if (section < 0 || section >= frag->sectionCount || !frag->sections[section].base) {
+        return 0;
+    }
+    return frag->sections[section].base + BE_Read32(frag->loader + offsetField);
+}
+
+static void CFM_FreeFragment(CFragFragment* frag)
+{
+    if (frag->loaderBlock) {
+        DisposePtr((Ptr)frag->loaderBlock);
+    }
+    if (frag->sections) {
+        DisposePtr((Ptr)frag->sections);
+    }
+    if (frag->imports) {
+        DisposePtr((Ptr)frag->imports);
+    }
+    DisposePtr((Ptr)frag);
+}
+
+/*
+ * CFM_RunInit - run a fragment's init routine, if it has one
+ *
+ * The routine gets a System 7 init block: connection, where and length
+ * filled in, and the name as libName. Host addresses and file specs would
+ * mean nothing to it and stay 0. Anything but noErr back fails the load.
+ *
+ *   +8   4   connectionID      +16  4   address / fileSpec
+ *   +12  4   where             +20  8   length, or offset and length
+ *   +36  4   libName           +44      the name (Pascal string)
+ */
+#define kCFMInitBlockSize   44
+
+static OSErr CFM_RunInit(CFragFragment* frag)
+{
+    CFragContext* ctx = frag->ctx;
+    UInt8 block[kCFMInitBlockSize + 1 + kCFMMaxNameLength];
+    UInt32 nameLen = strlen(frag->name);
+    UInt32 result = 0;
+    CPUAddr at;
+    OSErr err;
+
+    if (!frag->initAddr) {
+        return noErr;
+    }
+    if (!ctx->backend->CallRoutine) {
+        CFM_LOG_ERROR("%s has an init routine and the backend cannot call it\n", frag->name);
+        return cfragInitFunctionErr;
+    }
+
+    memset(block, 0, sizeof(block));
+    BE_Write32(block + 8, frag->index);
+    if (frag->container.mapped) {
+        BE_Write32(block + 12, kMemoryCFragLocator);
+        BE_Write32(block + 20, frag->container.length);
+    } else {
+        BE_Write32(block + 12, kDataForkCFragLocator);
+        BE_Write32(block + 24, frag->container.length);
+    }
+    block[kCFMInitBlockSize] = (UInt8)nameLen;
+    memcpy(block + kCFMInitBlockSize + 1, frag->name, nameLen);
+
+    err = ctx->backend->AllocateMemory(ctx->as, kCFMInitBlockSize + 1 + nameLen, 0, &at);
+    if (err == noErr) {
+        BE_Write32(block + 36, at + kCFMInitBlockSize);
+        err = ctx->backend->WriteMemory(ctx->as, at, block, kCFMInitBlockSize + 1 + nameLen);
+    }
+    if (err == noErr) {
+        err = ctx->backend->CallRoutine(ctx->as, frag->initAddr, &at, 1, &result);
+    }
+    if (err != noErr || (SInt16)result != noErr) {
+        CFM_LOG_ERROR("%s: init routine failed (%d, returned %d)\n",
+                      frag->name, err, (SInt16)result);
+        return cfragInitFunctionErr;
+    }
+    return noErr;
+}
+
+/*
+ * CFM_LoadFragment - Load a fragment and prepare its imports
+ */
+OSErr CFM_LoadFragment(CFragContext* ctx, const char* name,
+                       const CFragContainer* container, CFragFragment** outFrag)
+{
+    UInt8 header[PEF_CONTAINER_HEADER_SIZE];
+    UInt8* sectionHeaders = NULL;
+    CPUAddr* bases = NULL;
+    CFragFragment* frag;
+    CFragSection* loaderSec = NULL;
+    OSErr err;
+
+    if (!ctx || !name || !container || !outFrag) {
+        return paramErr;
+    }
+    if (ctx->numFragments >= kCFMMaxFragments) {
+        return cfragNoPrivateMemErr;
+    }
+
+    err = CFM_ReadContainer(container, 0, header, sizeof(header));
+    if (err != noErr) {
+        return (err == cfragFragmentCorruptErr) ? cfragFragmentFormatErr : err;
+    }
+    if (BE_Read32(header + PEF_HDR_TAG1) != kPEFTag1 ||
+        BE_Read32(header + PEF_HDR_TAG2) != kPEFTag2 ||
+        BE_Read32(header + PEF_HDR_FORMAT_VERSION) != kPEFVersion) {
+        return cfragFragmentFormatErr;
+    }
+    if (BE_Read32(header + PEF_HDR_ARCH) != kPEFPowerPCArch) {
+        return cfragArchitectureErr;
+    }
+
+    frag = (CFragFragment*)NewPtr(sizeof(CFragFragment));
+    if (!frag) {
+        return memFullErr;
+    }
+    memset(frag, 0, sizeof(CFragFragment));
+    frag->ctx = ctx;
+    strncpy(frag->name, name, kCFMMaxNameLength);
+    frag->index = ctx->numFragments;
+    frag->container = *container;
+    frag->sectionCount = BE_Read16(header + PEF_HDR_SECTION_COUNT);
+
+    /* Section headers */
+    frag->sections = (CFragSection*)NewPtr(frag->sectionCount * sizeof(CFragSection) + 1);
+    sectionHeaders = (UInt8*)NewPtr(frag->sectionCount * PEF_SECTION_HEADER_SIZE + 1);
+    bases = (CPUAddr*)NewPtr(frag->sectionCount * sizeof(CPUAddr) + 1);
+    if (!frag->sections || !sectionHeaders || !bases) {
+        err = memFullErr;
+        goto fail;
+    }
+    err = CFM_ReadContainer(container, PEF_CONTAINER_HEADER_SIZE, sectionHeaders,
+                            frag->sectionCount * PEF_SECTION_HEADER_SIZE);
+    if (err != noErr) {
+        goto fail;
+    }
+    for (UInt16 i = 0; i < frag->sectionCount; i++) {
+        const UInt8* sh = sectionHeaders + i * PEF_SECTION_HEADER_SIZE;
+        CFragSection* sec = &frag->sections[i];
+
+        memset(sec, 0, sizeof(*sec));
+        sec->totalSize = BE_Read32(sh + PEF_SEC_TOTAL_SIZE);
+        sec->unpackedSize = BE_Read32(sh + PEF_SEC_UNPACKED_SIZE);
+        sec->containerLength = BE_Read32(sh + PEF_SEC_CONTAINER_LENGTH);
+        sec->containerOffset = BE_Read32(sh + PEF_SEC_CONTAINER_OFFSET);
+        sec->kind = sh[PEF_SEC_KIND];
+        sec->alignment = sh[PEF_SEC_ALIGNMENT];
+        sec->frag = frag;
+
+        if (sec->containerOffset > container->length ||
+            sec->containerLength > container->length - sec->containerOffset ||
+            sec->alignment > 31) {
+            err = cfragFragmentCorruptErr;
+            goto fail;
+        }
+        if (sec->kind == kPEFLoaderSection && !loaderSec) {
+            loaderSec = sec;
+        }
+    }
+    if (!loaderSec) {
+        err = cfragFragmentFormatErr;
+        goto fail;
+    }
+
+    /* Loader section: in place if mapped, read into a block if streamed */
+    frag->loaderLength = loaderSec->containerLength;
+    if (container->mapped) {
+        frag->loader = container->mapped + loaderSec->containerOffset;
+    } else {
+        UInt8* block = (UInt8*)NewPtr(frag->loaderLength + 1);
+        if (!block) {
+            err = memFullErr;
+            goto fail;
+        }
+        frag->loader = block;
+        frag->loaderBlock = block;
+        err = CFM_ReadContainer(container, loaderSec->containerOffset, block, frag->loaderLength);
+        if (err != noErr) {
+            goto fail;
+        }
+    }
+    err = CFM_CheckLoader(frag);
+    if (err != noErr) {
+        goto fail;
+    }
+
+    /* The context owns the fragment from here: a library loaded while
+     * binding may refer back to it through a re-export */
+    ctx->fragments[ctx->numFragments++] = frag;
+
+    err = CFM_PlaceSections(frag);
+    if (err == noErr) {
+        err = CFM_BindImports(frag);
+    }
+    for (UInt16 i = 0; err == noErr && i < frag->sectionCount; i++) {
+        bases[i] = frag->sections[i].base;
+    }
+    for (UInt16 i = 0; err == noErr && i < frag->sectionCount; i++) {
+        if (frag->sections[i].base && !frag->sections[i].paged) {
+            err = CFM_FillSection(frag, i, bases);
+        }
+    }
+    if (err == noErr) {
+        frag->mainAddr = CFM_LoaderAddress(frag, PEF_LDR_MAIN_SECTION, PEF_LDR_MAIN_OFFSET);
+        frag->initAddr = CFM_LoaderAddress(frag, PEF_LDR_INIT_SECTION, PEF_LDR_INIT_OFFSET);
+        frag->termAddr = CFM_LoaderAddress(frag, PEF_LDR_TERM_SECTION, PEF_LDR_TERM_OFFSET);
+        err = CFM_RunInit(frag);
+    }
+    if (err != noErr) {
+        /* Libraries loaded while binding stay loaded and keep their
+         * indices, so a hole is left if this is no longer the last */
+        if (frag->index == ctx->numFragments - 1) {
+            ctx->numFragments--;
+        } else {
+            ctx->fragments[frag->index] = NULL;
+        }
+        goto fail;
+    }
+
+    CFM_LOG_INFO("Loaded %s: %u sections, %u imports (%u lazy), main 0x%08X\n",
+                 frag->name, frag->sectionCount, frag->importCount,
+                 frag->lazyImports, frag->mainAddr);
+
+    DisposePtr((Ptr)sectionHeaders);
+    DisposePtr((Ptr)bases);
+    *outFrag = frag;
+    return noErr;
+
+fail:
+    CFM_LOG_ERROR("Cannot load %s: %d\n", name, err);
+    if (sectionHeaders) {
+        DisposePtr((Ptr)sectionHeaders);
+    }
+    if (bases) {
+        DisposePtr((Ptr)bases);
+    }
+    CFM_FreeFragment(frag);
+    return err;
+}
+
+/*
+ * CFM_LoadLibrary - a registered library's fragment, loading it if need be
+ */
+static OSErr CFM_LoadLibrary(CFragContext* ctx, CFragLibrary* lib, CFragFragment** outFrag)
+{
+    OSErr err;
+
+    if (lib->frag) {
+        *outFrag = lib->frag;
+        return noErr;
+    }
+    if (lib->loading) {
+        /* A data or weak import cycle; routine imports never get here */
+        CFM_LOG_ERROR("Import cycle through %s\n", lib->name);
+        return cfragUnresolvedErr;
+    }
+
+    lib->loading = true;
+    err = CFM_LoadFragment(ctx, lib->name, &lib->container, &lib->frag);
+    lib->loading = false;
+    if (err == noErr) {
+        *outFrag = lib->frag;
+    }
+    return err;
+}
+
+/*
+ * Contexts
+ */
+
+OSErr CFM_CreateContext(const ICPUBackend* backend, CPUAddressSpace as,
+                        CFragContext** outCtx)
+{
+    CFragContext* ctx;
+
+    if (!backend || !as || !outCtx) {
+        return paramErr;
+    }
+
+    ctx = (CFragContext*)NewPtr(sizeof(CFragContext));
+    if (!ctx) {
+        return memFullErr;
+    }
+    memset(ctx, 0, sizeof(CFragContext));
+    ctx->backend = backend;
+    ctx->as = as;
+
+    *outCtx = ctx;
+    return noErr;
+}
+
+void CFM_DisposeContext(CFragContext* ctx)
+{
+    if (!ctx) {
+        return;
+    }
+    for (UInt16 i = 0; i < ctx->numFragments; i++) {
+        if (ctx->fragments[i]) {
+            CFM_FreeFragment(ctx->fragments[i]);
+        }
+    }
+    DisposePtr((Ptr)ctx);
+}
+
+OSErr CFM_CloseConnection(CFragFragment* frag)
+{
+    CFragContext* ctx;
+
+    if (!frag || frag->closed) {
+        return paramErr;
+    }
+    ctx = frag->ctx;
+
+    if (frag->termAddr) {
+        if (!ctx->backend->CallRoutine) {
+            CFM_LOG_WARN("%s: cannot call its term routine\n", frag->name);
+        } else if (ctx->backend->CallRoutine(ctx->as, frag->termAddr, NULL, 0, NULL) != noErr) {
+            CFM_LOG_WARN("%s: term routine failed\n", frag->name);
+        }
+    }
+
+    /* The next import from the library loads it afresh */
+    for (UInt16 i = 0; i < ctx->numLibraries; i++) {
+        if (ctx->libraries[i].frag == frag) {
+            ctx->libraries[i].frag = NULL;
+        }
+    }
+    frag->closed = true;
+    return noErr;
+}
+
+OSErr CFM_RegisterLibrary(CFragContext* ctx, const char* name,
+                          const CFragContainer* container)
+{
+    CFragLibrary* lib;
+
+    if (!ctx || !name || !container || strlen(name) > kCFMMaxNameLength) {
+        return paramErr;
+    }
+    if (CFM_FindLibrary(ctx, name)) {
+        return cfragDupRegistrationErr;
+    }
+    if (ctx->numLibraries >= kCFMMaxLibraries) {
+        return cfragNoPrivateMemErr;
+    }
+
+    lib = &ctx->libraries[ctx->numLibraries++];
+    memset(lib, 0, sizeof(*lib));
+    strncpy(lib->name, name, kCFMMaxNameLength);
+    lib->container = *container;
+    return noErr;
+}
+
+/*
+ * CFM_FindCFragMember - Find the fragment for an architecture in a 'cfrg'
+ *
+ * The resource is a 32-byte header, member count in its last two bytes,
+ * then variable-length members, each giving its own size:
+ *
+ *   +0   4   architecture      +24  4   offset
+ *   +16  4   stack size        +28  4   length
+ *   +22  1   usage             +40  2   member size
+ *   +23  1   where             +42      name (Pascal string)
+ */
+OSErr CFM_FindCFragMember(const void* cfrgData, Size size, OSType architecture,
+                          CFragMember* out)
+{
+    const UInt8* p = (const UInt8*)cfrgData;
+    UInt32 at = 32;
+    UInt16 count;
+
+    if (!cfrgData || !out) {
+        return paramErr;
+    }
+    if (size < 32) {
+        return cfragFragmentCorruptErr;
+    }
+    count = BE_Read16(p + 30);
+
+    for (UInt16 i = 0; i < count; i++) {
+        UInt16 memberSize;
+        UInt8 nameLen;
+
+        if (at + 43 > (UInt32)size) {
+            return cfragFragmentCorruptErr;
+        }
+        memberSize = BE_Read16(p + at + 40);
+        nameLen = p[at + 42];
+        if (memberSize < 43 || at + memberSize > (UInt32)size || 43u + nameLen > memberSize) {
+            return cfragFragmentCorruptErr;
+        }
+
+        if (BE_Read32(p + at) == architecture) {
+            memset(out, 0, sizeof(*out));
+            out->architecture = architecture;
+            out->usage = p[at + 22];
+            out->where = p[at + 23];
+            out->offset = BE_Read32(p + at + 24);
+            out->length = BE_Read32(p + at + 28);
+            out->stackSize = BE_Read32(p + at + 16);
+            if (nameLen > kCFMMaxNameLength) {
+                nameLen = kCFMMaxNameLength;
+            }
+            memcpy(out->name, p + at + 43, nameLen);
+            return noErr;
+        }
+        at += memberSize;
+    }
+
+    return cfragNoLibraryErr;
+}
@@ -0,0 +1,465 @@
+/*
+ * CodeFragmentsTest.c - Code Fragment Manager self-test
+ *
+ * Builds two small PEF containers in memory - an application and a library
+ * it imports from - loads them on the PowerPC interpreter and runs the
+ * application's main. Between them they go through pattern-initialized
+ * data, the common relocations, eager data and weak imports, a lazily
+ * bound routine import called twice, and a demand-paged code section read
+ * through a stream. A third fragment has init and term routines, run by
+ * the load and by CFM_CloseConnection.
+ *
+ * Silent unless something fails.
+ */
+
+#include "CodeFragments/CodeFragments.h"
+#include "CodeFragments/PEFBinaryFormat.h"
+#include "SegmentLoader/CodeParser.h"
+#include "CPU/PPCInterp.h"
+#include "System71StdLib.h"
+#include <string.h>
+
+#define kTestK          0x1234      /* the library's constant */
+#define kTestStart      5           /* main's starting value */
+
+typedef struct CFMTestSection {
+    const UInt8* data;
+    UInt32 length;
+    UInt32 totalSize;
+    UInt32 unpackedSize;
+    UInt8 kind;
+} CFMTestSection;
+
+/*
+ * TestLib: AddK(x) returns x + K, K being Konst, exported from its data
+ */
+static const UInt32 kLibCode[] = {
+    0x80820000,   /* lwz r4,0(r2)    K is at the TOC */
+    0x7C632214,   /* add r3,r3,r4 */
+    0x4E800020,   /* blr */
+};
+
+/*
+ * The library's data, pattern-initialized. Unpacks to:
+ *   +0   AddK's TVector, {0, 8} before relocation
+ *   +8   K
+ *   +12  eight 0xAB                      (Repeat)
+ *   +20  00 00 C1 00 00 C2 00 00         (RepeatZero)
+ * and four bytes of zero fill after that.
+ */
+static const UInt8 kLibPackedData[] = {
+    0x07, 0x21, 0x08, 0x02, 0x22, 0x12, 0x34,
+    0x41, 0x07, 0xAB,
+    0x82, 0x01, 0x02, 0xC1, 0xC2
+};
+#define kLibDataUnpacked    28
+#define kLibDataTotal       32
+
+/*
+ * TestApp: main returns kTestStart + 3K - AddK twice, then Konst read
+ * through its data import - and leaves in r6 the weak import Missing,
+ * whose library is not registered.
+ */
+static const UInt32 kAppCode[] = {
+    0x7FE802A6,   /* mflr r31 */
+    0x38600005,   /* li r3,5 */
+    0x9421FFC0,   /* stwu r1,-64(r1) */
+    0x4800002D,   /* bl addk_glue */
+    0x80410014,   /* lwz r2,20(r1) */
+    0x48000025,   /* bl addk_glue */
+    0x80410014,   /* lwz r2,20(r1) */
+    0x80A20004,   /* lwz r5,4(r2)    &Konst */
+    0x80A50000,   /* lwz r5,0(r5) */
+    0x7C632A14,   /* add r3,r3,r5 */
+    0x80C20008,   /* lwz r6,8(r2)    Missing */
+    0x38210040,   /* addi r1,r1,64 */
+    0x7FE803A6,   /* mtlr r31 */
+    0x4E800020,   /* blr */
+    0x81820000,   /* addk_glue: lwz r12,0(r2) */
+    0x90410014,   /* stw r2,20(r1) */
+    0x800C0000,   /* lwz r0,0(r12) */
+    0x804C0004,   /* lwz r2,4(r12) */
+    0x7C0903A6,   /* mtctr r0 */
+    0x4E800420,   /* bctr */
+};
+
+/*
+ * The application's data, stored as is and relocated by
+ *   ImportRun x3         +0 AddK, +4 Konst, +8 Missing (the TOC)
+ *   TVector8             +12 main's TVector
+ *   BySectDWithSkip 0,1  +20 a pointer to +16
+ */
+#define kAppDataSize        24
+#define kAppMainOffset      12
+static const UInt16 kAppRelocs[] = { 0x4A02, 0x4600, 0x0001 };
+
+/*
+ * TestInit: an init routine that keeps the libName its init block gives it
+ * and returns noErr, and a term routine that counts its calls
+ */
+static const UInt32 kInitCode[] = {
+    0x80830024,   /* init: lwz r4,36(r3)    libName */
+    0x90820000,   /* stw r4,0(r2) */
+    0x38600000,   /* li r3,0 */
+    0x4E800020,   /* blr */
+    0x80820004,   /* term: lwz r4,4(r2) */
+    0x38840001,   /* addi r4,r4,1 */
+    0x90820004,   /* stw r4,4(r2) */
+    0x4E800020,   /* blr */
+};
+#define kInitTermCode       16
+
+/*
+ * Its data, with the data itself as the TOC:
+ *   +0   libName, once init has run
+ *   +4   term calls
+ *   +8   init's TVector, then term's, relocated by IncrPosition 8, TVector8 x2
+ */
+#define kInitDataSize       24
+static const UInt16 kInitRelocs[] = { 0x8007, 0x4601 };
+
+static UInt8 gLibContainer[512];
+static UInt8 gAppContainer[512];
+static UInt8 gInitContainer[512];
+static UInt32 gLibReads;
+
+static OSErr CFMTest_Read(void* refCon, UInt32 offset, void* buffer, UInt32 length)
+{
+    memcpy(buffer, (const UInt8*)refCon + offset, length);
+    gLibReads++;
+    return noErr;
+}
+
+/* Lay out a container: header, section headers, contents */
+static UInt32 CFMTest_Build(UInt8* out, const CFMTestSection* secs, UInt16 count)
+{
+    UInt32 at = PEF_CONTAINER_HEADER_SIZE + count * PEF_SECTION_HEADER_SIZE;
+
+    memset(out, 0, at);
+    BE_Write32(out + PEF_HDR_TAG1, kPEFTag1);
+    BE_Write32(out + PEF_HDR_TAG2, kPEFTag2);
+    BE_Write32(out + PEF_HDR_ARCH, kPEFPowerPCArch);
+    BE_Write32(out + PEF_HDR_FORMAT_VERSION, kPEFVersion);
+    BE_Write16(out + PEF_HDR_SECTION_COUNT, count);
+    BE_Write16(out + PEF_HDR_INST_SECTION_COUNT, count - 1);
+
+    for (UInt16 i = 0; i < count; i++) {
+        UInt8* sh = out + PEF_CONTAINER_HEADER_SIZE + i * PEF_SECTION_HEADER_SIZE;
+
+        BE_Write32(sh, 0xFFFFFFFF);
+        BE_Write32(sh + PEF_SEC_TOTAL_SIZE, secs[i].totalSize);
+        BE_Write32(sh + PEF_SEC_UNPACKED_SIZE, secs[i].unpackedSize);
+        BE_Write32(sh + PEF_SEC_CONTAINER_LENGTH, secs[i].length);
+        BE_Write32(sh + PEF_SEC_CONTAINER_OFFSET, at);
+        sh[PEF_SEC_KIND] = secs[i].kind;
+        sh[PEF_SEC_ALIGNMENT] = 4;
+        memcpy(out + at, secs[i].data, secs[i].length);
+        at += (secs[i].length + 3) & ~3UL;
+    }
+    return at;
+}
+
+static void CFMTest_Words(UInt8* out, const UInt32* words, UInt32 count)
+{
+    for (UInt32 i = 0; i < count; i++) {
+        BE_Write32(out + i * 4, words[i]);
+    }
+}
+
+/* Loader header fields every test loader sets the same way */
+static void CFMTest_LoaderHeader(UInt8* ld, UInt32 mainOffset, UInt32 libs, UInt32 imports,
+                                 UInt32 instr, UInt32 strings, UInt32 hash, UInt32 exports)
+{
+    memset(ld, 0, PEF_LOADER_HEADER_SIZE);
+    BE_Write32(ld + PEF_LDR_MAIN_SECTION, mainOffset ? 1 : 0xFFFFFFFF);
+    BE_Write32(ld + PEF_LDR_MAIN_OFFSET, mainOffset);
+    BE_Write32(ld + PEF_LDR_INIT_SECTION, 0xFFFFFFFF);
+    BE_Write32(ld + PEF_LDR_TERM_SECTION, 0xFFFFFFFF);
+    BE_Write32(ld + PEF_LDR_LIBRARY_COUNT, libs);
+    BE_Write32(ld + PEF_LDR_IMPORT_COUNT, imports);
+    BE_Write32(ld + PEF_LDR_RELOC_SECTION_COUNT, 1);
+    BE_Write32(ld + PEF_LDR_RELOC_INSTR_OFFSET, instr);
+    BE_Write32(ld + PEF_LDR_STRINGS_OFFSET, strings);
+    BE_Write32(ld + PEF_LDR_HASH_OFFSET, hash);
+    BE_Write32(ld + PEF_LDR_HASH_POWER, 0);
+    BE_Write32(ld + PEF_LDR_EXPORT_COUNT, exports);
+}
+
+static UInt32 CFMTest_BuildLib(void)
+{
+    UInt8 code[sizeof(kLibCode)];
+    UInt8 ld[116];
+    CFMTestSection secs[3];
+
+    CFMTest_Words(code, kLibCode, sizeof(kLibCode) / 4);
+
+    /* No imports; one relocation (TVector8) for the data; two exports in
+     * the one hash slot */
+    CFMTest_LoaderHeader(ld, 0, 0, 0, 68, 72, 84, 2);
+    BE_Write16(ld + 56 + PEF_RELOC_SECTION_INDEX, 1);
+    BE_Write16(ld + 56 + 2, 0);
+    BE_Write32(ld + 56 + PEF_RELOC_COUNT, 1);
+    BE_Write32(ld + 56 + PEF_RELOC_FIRST_OFFSET, 0);
+    BE_Write32(ld + 68, 0x46000000);
+    memcpy(ld + 72, "AddKKonst\0\0\0", 12);
+    BE_Write32(ld + 84, (2UL << 18) | 0);
+    BE_Write32(ld + 88, PEF_HashWord((const UInt8*)"AddK", 4));
+    BE_Write32(ld + 92, PEF_HashWord((const UInt8*)"Konst", 5));
+    BE_Write32(ld + 96, ((UInt32)kPEFTVectorSymbol << 24) | 0);
+    BE_Write32(ld + 100, 0);
+    BE_Write16(ld + 104, 1);
+    BE_Write32(ld + 106, ((UInt32)kPEFDataSymbol << 24) | 4);
+    BE_Write32(ld + 110, 8);
+    BE_Write16(ld + 114, 1);
+
+    secs[0] = (CFMTestSection){ code, sizeof(code), sizeof(code), sizeof(code), kPEFCodeSection };
+    secs[1] = (CFMTestSection){ kLibPackedData, sizeof(kLibPackedData),
+                                kLibDataTotal, kLibDataUnpacked, kPEFPatternDataSection };
+    secs[2] = (CFMTestSection){ ld, sizeof(ld), 0, 0, kPEFLoaderSection };
+    return CFMTest_Build(gLibContainer, secs, 3);
+}
+
+static UInt32 CFMTest_BuildApp(void)
+{
+    UInt8 code[sizeof(kAppCode)];
+    UInt8 data[kAppDataSize];
+    UInt8 ld[180];
+    CFMTestSection secs[3];
+
+    CFMTest_Words(code, kAppCode, sizeof(kAppCode) / 4);
+    memset(data, 0, sizeof(data));
+    BE_Write32(data + 20, 0x10);
+
+    /* TestLib (AddK, Konst), then NoSuchLib (Missing), weak */
+    CFMTest_LoaderHeader(ld, kAppMainOffset, 2, 3, 128, 136, 176, 0);
+    BE_Write32(ld + 56 + PEF_LIB_NAME_OFFSET, 0);
+    BE_Write32(ld + 56 + 4, 0);
+    BE_Write32(ld + 56 + 8, 0);
+    BE_Write32(ld + 56 + PEF_LIB_SYMBOL_COUNT, 2);
+    BE_Write32(ld + 56 + PEF_LIB_FIRST_SYMBOL, 0);
+    BE_Write32(ld + 56 + PEF_LIB_OPTIONS, 0);
+    BE_Write32(ld + 80 + PEF_LIB_NAME_OFFSET, 19);
+    BE_Write32(ld + 80 + 4, 0);
+    BE_Write32(ld + 80 + 8, 0);
+    BE_Write32(ld + 80 + PEF_LIB_SYMBOL_COUNT, 1);
+    BE_Write32(ld + 80 + PEF_LIB_FIRST_SYMBOL, 2);
+    BE_Write32(ld + 80 + PEF_LIB_OPTIONS, (UInt32)kPEFWeakImportLibMask << 24);
+    BE_Write32(ld + 104, ((UInt32)kPEFTVectorSymbol << 24) | 8);
+    BE_Write32(ld + 108, ((UInt32)kPEFDataSymbol << 24) | 13);
+    BE_Write32(ld + 112, ((UInt32)kPEFTVectorSymbol << 24) | 29);
+    BE_Write16(ld + 116 + PEF_RELOC_SECTION_INDEX, 1);
+    BE_Write16(ld + 116 + 2, 0);
+    BE_Write32(ld + 116 + PEF_RELOC_COUNT, 3);
+    BE_Write32(ld + 116 + PEF_RELOC_FIRST_OFFSET, 0);
+    for (UInt32 i = 0; i < 4; i++) {
+        BE_Write16(ld + 128 + i * 2, i < 3 ? kAppRelocs[i] : 0);
+    }
+    memcpy(ld + 136, "TestLib\0AddK\0Konst\0NoSuchLib\0Missing\0\0\0\0", 40);
+    BE_Write32(ld + 176, 0);
+
+    secs[0] = (CFMTestSection){ code, sizeof(code), sizeof(code), sizeof(code), kPEFCodeSection };
+    secs[1] = (CFMTestSection){ data, sizeof(data), sizeof(data), sizeof(data),
+                                kPEFUnpackedDataSection };
+    secs[2] = (CFMTestSection){ ld, sizeof(ld), 0, 0, kPEFLoaderSection };
+    return CFMTest_Build(gAppContainer, secs, 3);
+}
+
+static UInt32 CFMTest_BuildInit(void)
+{
+    UInt8 code[sizeof(kInitCode)];
+    UInt8 data[kInitDataSize];
+    UInt8 ld[76];
+    CFMTestSection secs[3];
+
+    CFMTest_Words(code, kInitCode, sizeof(kInitCode) / 4);
+    memset(data, 0, sizeof(data));
+    BE_Write32(data + 16, kInitTermCode);
+
+    /* No imports or exports; init and term are the TVectors in the data */
+    CFMTest_LoaderHeader(ld, 0, 0, 0, 68, 72, 72, 0);
+    BE_Write32(ld + PEF_LDR_INIT_SECTION, 1);
+    BE_Write32(ld + PEF_LDR_INIT_OFFSET, 8);
+    BE_Write32(ld + PEF_LDR_TERM_SECTION, 1);
+    BE_Write32(ld + PEF_LDR_TERM_OFFSET, 16);
+    BE_Write16(ld + 56 + PEF_RELOC_SECTION_INDEX, 1);
+    BE_Write16(ld + 56 + 2, 0);
+    BE_Write32(ld + 56 + PEF_RELOC_COUNT, 2);
+    BE_Write32(ld + 56 + PEF_RELOC_FIRST_OFFSET, 0);
+    BE_Write16(ld + 68, kInitRelocs[0]);
+    BE_Write16(ld + 70, kInitRelocs[1]);
+    BE_Write32(ld + 72, 0);
+
+    secs[0] = (CFMTestSection){ code, sizeof(code), sizeof(code), sizeof(code), kPEFCodeSection };
+    secs[1] = (CFMTestSection){ data, sizeof(data), sizeof(data), sizeof(data),
+                                kPEFUnpackedDataSection };
+    secs[2] = (CFMTestSection){ ld, sizeof(ld), 0, 0, kPEFLoaderSection };
+    return CFMTest_Build(gInitContainer, secs, 3);
+}
+
+/* The relocation opcodes the containers above do not use, on a host buffer */
+static Boolean CFMTest_Relocate(void)
+{
+    static const UInt16 instr[] = {
+        0xA000, 0x0000,     /* SetPosition 0 */
+        0x4000,             /* BySectC */
+        0x9001,             /* SmRepeat: the one before, twice more */
+        0x8003,             /* IncrPosition 4 */
+        0x6601,             /* SmBySection 1 */
+        0xB480, 0x0000,     /* LgSetSectD 0 */
+        0x4200              /* BySectD */
+    };
+    static const CPUAddr bases[2] = { 0x10000, 0x20000 };
+    static const UInt32 want[6] = { 0x10000, 0x10000, 0x10000, 0, 0x20000, 0x10000 };
+    UInt8 instrBytes[sizeof(instr)];
+    UInt8 words[24];
+
+    for (UInt32 i = 0; i < sizeof(instr) / 2; i++) {
+        BE_Write16(instrBytes + i * 2, instr[i]);
+    }
+    memset(words, 0, sizeof(words));
+    if (PEF_Relocate(words, sizeof(words), instrBytes, sizeof(instr) / 2,
+                     bases, 2, NULL, 0) != noErr) {
+        return false;
+    }
+    for (UInt32 i = 0; i < 6; i++) {
+        if (BE_Read32(words + i * 4) != want[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void CFM_SelfTest(void)
+{
+    const ICPUBackend* backend = CPUBackend_Get("ppc_interp");
+    CPUAddressSpace as;
+    PPCAddressSpace* pas;
+    CFragContext* ctx = NULL;
+    CFragContainer lib, app, init;
+    CFragFragment* appFrag;
+    CFragFragment* libFrag;
+    CFragFragment* initFrag;
+    CPUAddr stack, sentinel, libCode, libData;
+    UInt8 buf[kLibDataTotal];
+    UInt32 want, readsAtLoad;
+    OSErr err;
+
+    if (!CFMTest_Relocate()) {
+        serial_printf("[CFM] selftest relocation FAILED\n");
+    }
+    if (!backend || backend->CreateAddressSpace(NULL, &as) != noErr) {
+        serial_printf("[CFM] selftest FAILED: no PowerPC address space\n");
+        return;
+    }
+    pas = (PPCAddressSpace*)as;
+
+    lib = (CFragContainer){ NULL, CFMTest_BuildLib(), CFMTest_Read, gLibContainer };
+    app = (CFragContainer){ gAppContainer, CFMTest_BuildApp(), NULL, NULL };
+
+    if ((err = CFM_CreateContext(backend, as, &ctx)) != noErr ||
+        (err = CFM_RegisterLibrary(ctx, "TestLib", &lib)) != noErr ||
+        (err = CFM_LoadFragment(ctx, "TestApp", &app, &appFrag)) != noErr) {
+        serial_printf("[CFM] selftest FAILED: load returned %d\n", err);
+        goto done;
+    }
+
+    /* Konst is a data import, so the library is loaded - but its code,
+     * which nothing has run, has not been read */
+    libFrag = ctx->libraries[0].frag;
+    if (!libFrag || appFrag->lazyImports != 1 || appFrag->imports[2] != 0) {
+        serial_printf("[CFM] selftest FAILED: imports not bound as expected\n");
+        goto done;
+    }
+    readsAtLoad = gLibReads;
+    libCode = libFrag->sections[0].base;
+    libData = libFrag->sections[1].base;
+    if (!libFrag->sections[0].paged || pas->pageTable[libCode >> PPC_PAGE_SHIFT]) {
+        serial_printf("[CFM] selftest FAILED: library code read at load\n");
+    }
+
+    /* Library data: unpacked, relocated, zero-filled */
+    backend->ReadMemory(as, libData, buf, kLibDataTotal);
+    if (BE_Read32(buf) != libCode || BE_Read32(buf + 4) != libData + 8 ||
+        BE_Read32(buf + 8) != kTestK || buf[12] != 0xAB || buf[19] != 0xAB ||
+        BE_Read32(buf + 20) != 0x0000C100 || BE_Read32(buf + 24) != 0x00C20000 ||
+        BE_Read32(buf + 28) != 0) {
+        serial_printf("[CFM] selftest FAILED: library data %08X %08X %08X\n",
+                      BE_Read32(buf), BE_Read32(buf + 4), BE_Read32(buf + 8));
+    }
+
+    /* Application data: the TOC, main's TVector, the pointer */
+    backend->ReadMemory(as, appFrag->sections[1].base, buf, kAppDataSize);
+    if (BE_Read32(buf) != appFrag->imports[0] || BE_Read32(buf + 4) != libData + 8 ||
+        BE_Read32(buf + 8) != 0 || BE_Read32(buf + 12) != appFrag->sections[0].base ||
+        BE_Read32(buf + 16) != appFrag->sections[1].base ||
+        BE_Read32(buf + 20) != appFrag->sections[1].base + 0x10 ||
+        appFrag->mainAddr != appFrag->sections[1].base + kAppMainOffset) {
+        serial_printf("[CFM] selftest FAILED: application data not relocated\n");
+    }
+
+    /* Run main, returning to a branch-to-self */
+    if (backend->AllocateMemory(as, 4096, 0, &stack) != noErr ||
+        backend->AllocateMemory(as, 4, kCPUMapExecutable, &sentinel) != noErr) {
+        serial_printf("[CFM] selftest FAILED: no stack\n");
+        goto done;
+    }
+    BE_Write32(buf, 0x48000000);    /* b . */
+    backend->WriteMemory(as, sentinel, buf, 4);
+    backend->ReadMemory(as, appFrag->mainAddr, buf, 8);
+    pas->regs.gpr[1] = stack + 4096 - 64;
+    pas->regs.gpr[2] = BE_Read32(buf + 4);
+    pas->regs.lr = sentinel;
+    PPC_Execute(pas, BE_Read32(buf), 200);
+
+    want = kTestStart + 3 * kTestK;
+    if (pas->halted || pas->regs.pc != sentinel || pas->regs.gpr[3] != want ||
+        pas->regs.gpr[6] != 0) {
+        serial_printf("[CFM] selftest FAILED: main left pc=%08X r3=%08X r6=%08X, expected r3=%08X\n",
+                      pas->regs.pc, pas->regs.gpr[3], pas->regs.gpr[6], want);
+    }
+
+    /* Bound once, on the first call; the stub is now AddK's TVector */
+    backend->ReadMemory(as, appFrag->imports[0], buf, 8);
+    if (appFrag->lazyBound != 1 || BE_Read32(buf) != libCode ||
+        BE_Read32(buf + 4) != libData + 8) {
+        serial_printf("[CFM] selftest FAILED: stub bound %u times to %08X %08X\n",
+                      appFrag->lazyBound, BE_Read32(buf), BE_Read32(buf + 4));
+    }
+    if (!pas->pageTable[libCode >> PPC_PAGE_SHIFT] || gLibReads != readsAtLoad + 1) {
+        serial_printf("[CFM] selftest FAILED: library code not paged in with one read (%u)\n",
+                      gLibReads - readsAtLoad);
+    }
+
+    /* An init routine runs at load, with main's registers put back after */
+    init = (CFragContainer){ gInitContainer, CFMTest_BuildInit(), NULL, NULL };
+    err = CFM_LoadFragment(ctx, "TestInit", &init, &initFrag);
+    if (err != noErr) {
+        serial_printf("[CFM] selftest FAILED: TestInit load returned %d\n", err);
+        goto done;
+    }
+    backend->ReadMemory(as, initFrag->sections[1].base, buf, 8);
+    want = BE_Read32(buf);
+    backend->ReadMemory(as, want, buf + 8, 9);
+    if (!want || buf[8] != 8 || memcmp(buf + 9, "TestInit", 8) != 0 ||
+        BE_Read32(buf + 4) != 0) {
+        serial_printf("[CFM] selftest FAILED: init routine did not run as expected\n");
+    }
+    if (pas->regs.pc != sentinel || pas->regs.gpr[3] != kTestStart + 3 * kTestK ||
+        pas->regs.gpr[1] != stack + 4096 - 64 || pas->halted) {
+        serial_printf("[CFM] selftest FAILED: init routine disturbed the registers\n");
+    }
+
+    /* Closing runs term, once */
+    if (CFM_CloseConnection(initFrag) != noErr ||
+        CFM_CloseConnection(initFrag) != paramErr) {
+        serial_printf("[CFM] selftest FAILED: CloseConnection\n");
+    }
+    backend->ReadMemory(as, initFrag->sections[1].base + 4, buf, 4);
+    if (BE_Read32(buf) != 1) {
+        serial_printf("[CFM] selftest FAILED: term routine ran %u times\n", BE_Read32(buf));
+    }
+
+done:
+    CFM_DisposeContext(ctx);
+    backend->DestroyAddressSpace(as);
+}
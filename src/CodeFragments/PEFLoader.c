@@ -0,0 +1,452 @@
+/*
+ * PEFLoader.c - PEF container routines for the Code Fragment Manager
+ *
+ * The parts of loading a fragment that know the container format and
+ * nothing else: the export hash, pattern-initialized data, the relocation
+ * instruction set and export lookup. They work on host buffers; putting the
+ * results into an address space is CodeFragments.c's business.
+ *
+ * Everything read from a container is bounds-checked against the container.
+ * A damaged one fails to load with cfragFragmentCorruptErr rather than
+ * reading or writing past a buffer.
+ */
+
+#include "CodeFragments/CodeFragments.h"
+#include "CodeFragments/PEFBinaryFormat.h"
+#include "SegmentLoader/CodeParser.h"
+#include "System71StdLib.h"
+#include <string.h>
+
+/*
+ * PEF_HashWord - the name hash the export hash table is keyed on
+ *
+ * The rotate works on a signed value, so the right shift brings the sign
+ * bit down; linkers computed it that way and a lookup has to agree.
+ */
+UInt32 PEF_HashWord(const UInt8* name, UInt32 length)
+{
+    SInt32 hash = 0;
+    UInt32 n = 0;
+
+    while (n < length && name[n] != 0) {
+        hash = (SInt32)(((UInt32)hash << 1) - (UInt32)(hash >> 16)) ^ name[n];
+        n++;
+    }
+    return (n << 16) | (UInt16)((hash ^ (hash >> 16)) & 0xFFFF);
+}
+
+/*
+ * Pattern-initialized data
+ */
+
+/* Next argument: seven bits a byte, big-endian, top bit set on all but the last */
+static Boolean PEF_ReadArgument(const UInt8** p, const UInt8* end, UInt32* out)
+{
+    UInt32 value = 0;
+    UInt8 b;
+
+    do {
+        if (*p >= end || (value >> 25) != 0) {
+            return false;
+        }
+        b = *(*p)++;
+        value = (value << 7) | (b & 0x7F);
+    } while (b & 0x80);
+
+    *out = value;
+    return true;
+}
+
+/*
+ * PEF_UnpackData - expand a pattern-initialized data section
+ *
+ * dst is expected to be zeroed by the caller; what the pattern does not
+ * reach - the rest of unpackedSize, and the zero fill up to totalSize -
+ * stays zero.
+ */
+OSErr PEF_UnpackData(const UInt8* src, UInt32 srcLen, UInt8* dst, UInt32 dstLen)
+{
+    const UInt8* p = src;
+    const UInt8* end = src + srcLen;
+    UInt32 out = 0;
+
+    while (p < end) {
+        UInt8 op = *p >> 5;
+        UInt32 count = *p++ & 0x1F;
+        UInt32 customSize, repeatCount;
+
+        if (count == 0 && !PEF_ReadArgument(&p, end, &count)) {
+            return cfragFragmentCorruptErr;
+        }
+
+        switch (op) {
+            case kPEFPkDataZero:
+                if (count > dstLen - out) {
+                    return cfragFragmentCorruptErr;
+                }
+                memset(dst + out, 0, count);
+                out += count;
+                break;
+
+            case kPEFPkDataBlock:
+                if (count > dstLen - out || count > (UInt32)(end - p)) {
+                    return cfragFragmentCorruptErr;
+                }
+                memcpy(dst + out, p, count);
+                out += count;
+                p += count;
+                break;
+
+            case kPEFPkDataRepeat:
+                if (!PEF_ReadArgument(&p, end, &repeatCount) ||
+                    count > (UInt32)(end - p)) {
+                    return cfragFragmentCorruptErr;
+                }
+                for (UInt32 i = 0; i <= repeatCount; i++) {
+                    if (count > dstLen - out) {
+                        return cfragFragmentCorruptErr;
+                    }
+                    memcpy(dst + out, p, count);
+                    out += count;
+                }
+                p += count;
+                break;
+
+            case kPEFPkDataRepeatBlock:
+            case kPEFPkDataRepeatZero: {
+                /* count is the common part, customSize each custom part.
+                 * The common part is in the container once, before the
+                 * custom parts, for RepeatBlock; RepeatZero's is zeros. */
+                const UInt8* common;
+                const UInt8* custom;
+
+                if (!PEF_ReadArgument(&p, end, &customSize) ||
+                    !PEF_ReadArgument(&p, end, &repeatCount)) {
+                    return cfragFragmentCorruptErr;
+                }
+                common = p;
+                if (op == kPEFPkDataRepeatBlock) {
+                    if (count > (UInt32)(end - p)) {
+                        return cfragFragmentCorruptErr;
+                    }
+                    p += count;
+                }
+                custom = p;
+                if (customSize != 0 && repeatCount > (UInt32)(end - p) / customSize) {
+                    return cfragFragmentCorruptErr;
+                }
+                p += customSize * repeatCount;
+
+                for (UInt32 i = 0; i <= repeatCount; i++) {
+                    if (count > dstLen - out) {
+                        return cfragFragmentCorruptErr;
+                    }
+                    if (op == kPEFPkDataRepeatBlock) {
+                        memcpy(dst + out, common, count);
+                    } else {
+                        memset(dst + out, 0, count);
+                    }
+                    out += count;
+                    if (i == repeatCount) {
+                        break;
+                    }
+                    if (customSize > dstLen - out) {
+                        return cfragFragmentCorruptErr;
+                    }
+                    memcpy(dst + out, custom, customSize);
+                    custom += customSize;
+                    out += customSize;
+                }
+                break;
+            }
+
+            default:
+                return cfragFragmentCorruptErr;
+        }
+    }
+
+    return noErr;
+}
+
+/*
+ * Relocation
+ */
+
+/* Add value to the big-endian word at *pos and step past it */
+static Boolean PEF_AddWord(UInt8* section, UInt32 size, UInt32* pos, UInt32 value)
+{
+    if (*pos > size || size - *pos < 4) {
+        return false;
+    }
+    BE_Write32(section + *pos, BE_Read32(section + *pos) + value);
+    *pos += 4;
+    return true;
+}
+
+/*
+ * PEF_Relocate - run one section's relocation instructions
+ *
+ * The state the instructions work on: the position of the next word, an
+ * import index that by-import instructions advance, and two section
+ * addresses, sectC and sectD - initially sections 0 and 1, conventionally
+ * the code and the data - that most instructions add.
+ *
+ * Repeats go back over the preceding instructions, counted in 16-bit units,
+ * and do not nest.
+ */
+OSErr PEF_Relocate(UInt8* section, UInt32 sectionSize,
+                   const UInt8* instr, UInt32 instrCount,
+                   const CPUAddr* sectionBases, UInt32 sectionCount,
+                   const CPUAddr* imports, UInt32 importCount)
+{
+    UInt32 pos = 0;
+    CPUAddr sectC = sectionCount > 0 ? sectionBases[0] : 0;
+    CPUAddr sectD = sectionCount > 1 ? sectionBases[1] : 0;
+    UInt32 importIndex = 0;
+    UInt32 i = 0;
+    Boolean repeating = false;
+    UInt32 repeatLeft = 0;
+
+#define ADD(v)      do { if (!PEF_AddWord(section, sectionSize, &pos, (v))) goto corrupt; } while (0)
+
+    while (i < instrCount) {
+        UInt32 at = i;
+        UInt16 w = BE_Read16(instr + 2 * i++);
+        UInt8 op = w >> 9;
+        UInt32 second = 0;
+        UInt32 n, index, blocks, reps;
+
+        /* The long forms take a second 16-bit unit */
+        if ((op & 0x70) == 0x50) {
+            if (i >= instrCount) {
+                goto corrupt;
+            }
+            second = BE_Read16(instr + 2 * i++);
+        }
+
+        if ((w >> 14) == 0) {
+            /* RelocBySectDWithSkip: skip some words, then add sectD to some */
+            pos += ((w >> 6) & 0xFF) * 4;
+            for (n = w & 0x3F; n > 0; n--) {
+                ADD(sectD);
+            }
+            continue;
+        }
+
+        if ((op & 0x70) == 0x20) {
+            /* The run group: the same thing runLength times */
+            UInt32 run = (w & 0x1FF) + 1;
+
+            for (n = 0; n < run; n++) {
+                switch (op) {
+                    case kPEFRelocBySectC:
+                        ADD(sectC);
+                        break;
+                    case kPEFRelocBySectD:
+                        ADD(sectD);
+                        break;
+                    case kPEFRelocTVector12:
+                        ADD(sectC);
+                        ADD(sectD);
+                        pos += 4;
+                        break;
+                    case kPEFRelocTVector8:
+                        ADD(sectC);
+                        ADD(sectD);
+                        break;
+                    case kPEFRelocVTable8:
+                        ADD(sectD);
+                        pos += 4;
+                        break;
+                    case kPEFRelocImportRun:
+                        if (importIndex >= importCount) {
+                            goto corrupt;
+                        }
+                        ADD(imports[importIndex++]);
+                        break;
+                    default:
+                        goto corrupt;
+                }
+            }
+            continue;
+        }
+
+        if ((op & 0x70) == 0x30 || op == kPEFRelocLgByImport ||
+            op == kPEFRelocLgSetOrBySection) {
+            /* The indexed group, short and long */
+            UInt8 what = op;
+
+            if ((op & 0x70) == 0x30) {
+                index = w & 0x1FF;
+            } else if (op == kPEFRelocLgByImport) {
+                index = ((UInt32)(w & 0x3FF) << 16) | second;
+            } else {
+                index = ((UInt32)(w & 0x3F) << 16) | second;
+                switch ((w >> 6) & 0x0F) {
+                    case kPEFRelocLgBySectionSubopcode:
+                        what = kPEFRelocSmBySection;
+                        break;
+                    case kPEFRelocLgSetSectCSubopcode:
+                        what = kPEFRelocSmSetSectC;
+                        break;
+                    case kPEFRelocLgSetSectDSubopcode:
+                        what = kPEFRelocSmSetSectD;
+                        break;
+                    default:
+                        goto corrupt;
+                }
+            }
+
+            switch (what) {
+                case kPEFRelocSmByImport:
+                case kPEFRelocLgByImport:
+                    if (index >= importCount) {
+                        goto corrupt;
+                    }
+                    ADD(imports[index]);
+                    importIndex = index + 1;
+                    break;
+                case kPEFRelocSmSetSectC:
+                    if (index >= sectionCount) {
+                        goto corrupt;
+                    }
+                    sectC = sectionBases[index];
+                    break;
+                case kPEFRelocSmSetSectD:
+                    if (index >= sectionCount) {
+                        goto corrupt;
+                    }
+                    sectD = sectionBases[index];
+                    break;
+                case kPEFRelocSmBySection:
+                    if (index >= sectionCount) {
+                        goto corrupt;
+                    }
+                    ADD(sectionBases[index]);
+                    break;
+                default:
+                    goto corrupt;
+            }
+            continue;
+        }
+
+        switch (op & 0x78) {
+            case kPEFRelocIncrPosition:
+                pos += (w & 0x0FFF) + 1;
+                continue;
+
+            case kPEFRelocSmRepeat:
+                blocks = ((w >> 8) & 0x0F) + 1;
+                reps = (w & 0xFF) + 1;
+                goto repeat;
+
+            default:
+                break;
+        }
+
+        switch (op & 0x7E) {
+            case kPEFRelocSetPosition:
+                pos = ((UInt32)(w & 0x3FF) << 16) | second;
+                continue;
+
+            case kPEFRelocLgRepeat:
+                blocks = ((w >> 6) & 0x0F) + 1;
+                reps = ((UInt32)(w & 0x3F) << 16) | second;
+                goto repeat;
+
+            default:
+                goto corrupt;
+        }
+
+    repeat:
+        /* The block runs once before the repeat is reached, then reps more
+         * times; the first arrival starts the count. */
+        if (!repeating) {
+            repeating = true;
+            repeatLeft = reps;
+        }
+        if (repeatLeft == 0) {
+            repeating = false;
+            continue;
+        }
+        if (blocks > at) {
+            goto corrupt;
+        }
+        repeatLeft--;
+        i = at - blocks;
+    }
+
+#undef ADD
+
+    return noErr;
+
+corrupt:
+    return cfragFragmentCorruptErr;
+}
+
+/*
+ * PEF_FindExport - look a name up in a loader section's export hash table
+ *
+ * One hash, one slot, and a walk down that slot's chain comparing full hash
+ * words before names - so a miss rarely touches a name at all.
+ */
+OSErr PEF_FindExport(const UInt8* loader, UInt32 loaderLength, const char* name,
+                     UInt32* outValue, SInt16* outSection, UInt8* outClass)
+{
+    UInt32 hashOff, power, count, strings, slots, keysOff, symsOff;
+    UInt32 length = (UInt32)strlen(name);
+    UInt32 word, slot, first, chain;
+
+    if (loaderLength < PEF_LOADER_HEADER_SIZE) {
+        return cfragFragmentCorruptErr;
+    }
+    hashOff = BE_Read32(loader + PEF_LDR_HASH_OFFSET);
+    power = BE_Read32(loader + PEF_LDR_HASH_POWER);
+    count = BE_Read32(loader + PEF_LDR_EXPORT_COUNT);
+    strings = BE_Read32(loader + PEF_LDR_STRINGS_OFFSET);
+
+    if (count == 0) {
+        return cfragNoSymbolErr;
+    }
+    if (power > 18 || count > 0x3FFFF) {
+        return cfragFragmentCorruptErr;
+    }
+    slots = 1UL << power;
+    keysOff = hashOff + slots * PEF_HASH_SLOT_SIZE;
+    symsOff = keysOff + count * PEF_EXPORT_KEY_SIZE;
+    if (hashOff > loaderLength || symsOff > loaderLength ||
+        count * PEF_EXPORTED_SYMBOL_SIZE > loaderLength - symsOff) {
+        return cfragFragmentCorruptErr;
+    }
+
+    word = PEF_HashWord((const UInt8*)name, length);
+    slot = BE_Read32(loader + hashOff + ((word ^ (word >> power)) & (slots - 1)) * PEF_HASH_SLOT_SIZE);
+    first = PEF_HASH_FIRST_INDEX(slot);
+    chain = PEF_HASH_CHAIN_COUNT(slot);
+
+    for (UInt32 k = first; k < first + chain && k < count; k++) {
+        const UInt8* sym;
+        UInt32 nameOff;
+
+        if (BE_Read32(loader + keysOff + k * PEF_EXPORT_KEY_SIZE) != word) {
+            continue;
+        }
+        sym = loader + symsOff + k * PEF_EXPORTED_SYMBOL_SIZE;
+        nameOff = strings + PEF_SYMBOL_NAME(BE_Read32(sym));
+        if (nameOff > loaderLength || length > loaderLength - nameOff) {
+            return cfragFragmentCorruptErr;
+        }
+        if (memcmp(loader + nameOff, name, length) != 0) {
+            continue;
+        }
+
+        *outValue = BE_Read32(sym + PEF_EXPORT_VALUE);
+        *outSection = (SInt16)BE_Read16(sym + PEF_EXPORT_SECTION);
+        if (outClass) {
+            *outClass = PEF_SYMBOL_CLASS(BE_Read32(sym));
+        }
+        return noErr;
+    }
+
+    return cfragNoSymbolErr;
+}
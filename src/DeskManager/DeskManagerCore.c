@@ -316,6 +316,10 @@ void SystemTask(void)
     extern void MenuBar_UpdateClock(void);
     MenuBar_UpdateClock();
 
+    /* Write file system changes back to disk (every couple of seconds) */
+    extern void VFS_Idle(void);
+    VFS_Idle();
+
     /* Call idle routine for all open DAs */
     DeskAccessory *da = g_deskMgr.firstDA;
     while (da) {
@@ -0,0 +1,212 @@
+/*
+ * hfs_alloc.c - HFS volume bitmap allocation
+ *
+ * The volume bitmap has one bit per allocation block, most significant bit
+ * first, set when the block is in use. It starts vbmStart blocks into the
+ * volume, counted in allocation blocks - the same way
+ * HFS_AllocBlockToByteOffset counts drAlBlSt, and the way
+ * HFS_CreateBlankVolume and HFS_FormatVolume lay it out.
+ *
+ * The bitmap is read and written a sector at a time through HFS_BD_Read and
+ * HFS_BD_Write. On a disk that puts it in the block cache with the B-tree
+ * nodes, so allocating a block costs no I/O until the volume is flushed.
+ *
+ * drFreeBks is counted from the bitmap once per mount before the first
+ * allocation. HFS_CreateBlankVolume and HFS_FormatVolume write a count
+ * that leaves out three of the blocks they mark in use, and the count
+ * decides when the volume is full.
+ *
+ * Copyright (c) 2025 - System 7.1 Portable Project
+ */
+
+#include "../../include/FS/hfs_alloc.h"
+#include <string.h>
+#include "FS/FSLogging.h"
+
+#define kVBMChunkBytes  512
+#define kVBMChunkBits   (kVBMChunkBytes * 8)
+
+/* One sector of the bitmap at a time */
+typedef struct {
+    HFS_Volume* vol;
+    int32_t     chunk;      /* which sector of the bitmap is in bits; -1: none */
+    bool        dirty;
+    uint8_t     bits[kVBMChunkBytes];
+} VBMCursor;
+
+static void vbm_open(VBMCursor* cur, HFS_Volume* vol) {
+    cur->vol = vol;
+    cur->chunk = -1;
+    cur->dirty = false;
+}
+
+static uint64_t vbm_chunk_offset(const HFS_Volume* vol, uint32_t chunk) {
+    return (uint64_t)vol->vbmStart * vol->alBlkSize + (uint64_t)chunk * kVBMChunkBytes;
+}
+
+/* Write back the sector in hand if it changed */
+static bool vbm_release(VBMCursor* cur) {
+    if (cur->chunk >= 0 && cur->dirty) {
+        if (!HFS_BD_Write(&cur->vol->bd, vbm_chunk_offset(cur->vol, (uint32_t)cur->chunk),
+                          cur->bits, kVBMChunkBytes)) {
+            return false;
+        }
+    }
+    cur->dirty = false;
+    return true;
+}
+
+static bool vbm_load(VBMCursor* cur, uint32_t block) {
+    int32_t chunk = (int32_t)(block / kVBMChunkBits);
+
+    if (chunk == cur->chunk) return true;
+    if (!vbm_release(cur)) return false;
+    if (!HFS_BD_Read(&cur->vol->bd, vbm_chunk_offset(cur->vol, (uint32_t)chunk),
+                     cur->bits, kVBMChunkBytes)) {
+        cur->chunk = -1;
+        return false;
+    }
+    cur->chunk = chunk;
+    return true;
+}
+
+static bool vbm_test(VBMCursor* cur, uint32_t block, bool* used) {
+    if (!vbm_load(cur, block)) return false;
+
+    uint32_t bit = block % kVBMChunkBits;
+    *used = (cur->bits[bit >> 3] & (0x80 >> (bit & 7))) != 0;
+    return true;
+}
+
+static bool vbm_mark(VBMCursor* cur, uint32_t start, uint32_t count, bool used) {
+    for (uint32_t block = start; block < start + count; block++) {
+        if (!vbm_load(cur, block)) return false;
+
+        uint32_t bit = block % kVBMChunkBits;
+        uint8_t mask = (uint8_t)(0x80 >> (bit & 7));
+        if (used) {
+            cur->bits[bit >> 3] |= mask;
+        } else {
+            cur->bits[bit >> 3] &= (uint8_t)~mask;
+        }
+        cur->dirty = true;
+    }
+    return true;
+}
+
+/* Length of the free run starting at block, up to limit blocks */
+static bool vbm_free_run(VBMCursor* cur, uint32_t block, uint32_t limit,
+                         uint32_t total, uint32_t* length) {
+    uint32_t n = 0;
+
+    while (n < limit && block + n < total) {
+        bool used;
+        if (!vbm_test(cur, block + n, &used)) return false;
+        if (used) break;
+        n++;
+    }
+    *length = n;
+    return true;
+}
+
+static bool count_free_blocks(HFS_Volume* vol) {
+    VBMCursor cur;
+    uint32_t freeBlocks = 0;
+
+    vbm_open(&cur, vol);
+    for (uint32_t block = 0; block < vol->numAlBlks; block++) {
+        bool used;
+        if (!vbm_test(&cur, block, &used)) return false;
+        if (!used) freeBlocks++;
+    }
+
+    if (freeBlocks != vol->mdb.drFreeBks) {
+        FS_LOG_DEBUG("HFS: drFreeBks was %u, the bitmap says %u\n",
+                     vol->mdb.drFreeBks, freeBlocks);
+        vol->mdb.drFreeBks = (uint16_t)freeBlocks;
+        vol->mdbDirty = true;
+    }
+    vol->freeCounted = true;
+    return true;
+}
+
+bool HFS_AllocBlocks(HFS_Volume* vol, uint16_t goal, uint16_t count, HFS_Extent* run) {
+    if (!vol || !vol->mounted || !run || count == 0) return false;
+    if (vol->bd.readonly || vol->numAlBlks == 0) return false;
+    if (!vol->freeCounted && !count_free_blocks(vol)) return false;
+    if (vol->mdb.drFreeBks == 0) return false;
+
+    VBMCursor cur;
+    uint32_t total = vol->numAlBlks;
+    uint32_t start = 0;
+    uint32_t length = 0;
+
+    vbm_open(&cur, vol);
+
+    /* Grow in place */
+    if (goal < total && !vbm_free_run(&cur, goal, count, total, &length)) {
+        return false;
+    }
+    if (length > 0) {
+        start = goal;
+    } else {
+        /* First fit from the roving pointer, once round the volume,
+         * remembering the longest run in case none is long enough */
+        uint32_t block = (vol->mdb.drAllocPtr < total) ? vol->mdb.drAllocPtr : 0;
+        uint32_t scanned = 0;
+
+        while (scanned < total) {
+            uint32_t bit = block % kVBMChunkBits;
+            uint32_t n;
+
+            if (!vbm_load(&cur, block)) return false;
+            if ((bit & 7) == 0 && block + 8 <= total && cur.bits[bit >> 3] == 0xFF) {
+                n = 8;      /* a whole byte in use */
+            } else {
+                if (!vbm_free_run(&cur, block, count, total, &n)) return false;
+                if (n > length) {
+                    start = block;
+                    length = n;
+                    if (n >= count) break;
+                }
+                if (n == 0) n = 1;
+            }
+            block += n;
+            scanned += n;
+            if (block >= total) block = 0;
+        }
+    }
+
+    if (length == 0) {
+        return false;       /* drFreeBks disagreed with the bitmap */
+    }
+
+    if (!vbm_mark(&cur, start, length, true) || !vbm_release(&cur)) {
+        return false;
+    }
+
+    vol->mdb.drFreeBks = (vol->mdb.drFreeBks > length) ? (uint16_t)(vol->mdb.drFreeBks - length) : 0;
+    vol->mdb.drAllocPtr = (uint16_t)((start + length < total) ? start + length : 0);
+    vol->mdbDirty = true;
+
+    run->startBlock = (uint16_t)start;
+    run->blockCount = (uint16_t)length;
+    return true;
+}
+
+bool HFS_FreeBlocks(HFS_Volume* vol, uint16_t start, uint16_t count) {
+    if (!vol || !vol->mounted || vol->bd.readonly) return false;
+    if (count == 0) return true;
+    if ((uint32_t)start + count > vol->numAlBlks) return false;
+
+    VBMCursor cur;
+    vbm_open(&cur, vol);
+    if (!vbm_mark(&cur, start, count, false) || !vbm_release(&cur)) {
+        return false;
+    }
+
+    uint32_t freeBlocks = (uint32_t)vol->mdb.drFreeBks + count;
+    vol->mdb.drFreeBks = (uint16_t)((freeBlocks < vol->numAlBlks) ? freeBlocks : vol->numAlBlks);
+    vol->mdbDirty = true;
+    return true;
+}
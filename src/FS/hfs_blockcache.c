@@ -0,0 +1,409 @@
+/*
+ * hfs_blockcache.c - Block buffer cache under HFS_BD_Read/HFS_BD_Write
+ *
+ * Every HFS_BD_Read on an ATA or SDHCI device used to allocate a
+ * sector-aligned staging buffer, read into it, copy the bytes out and free
+ * it, and nothing was kept: the catalog header node, the root directory's
+ * leaf node and the first blocks of every file opened were fetched from
+ * the disk again on each access. Opening a Finder folder was dominated by
+ * those repeated reads.
+ *
+ * Disk transfers now go through a cache of 4 KB blocks keyed by (device
+ * type, device index, block number), so every path that ends in an
+ * HFS_BlockDev - PIO ATA, and SD, virtio-blk or USB mass storage behind
+ * hal_storage - shares it. Replacement is LRU, the size is set at build
+ * time with HFS_BLOCK_CACHE_KB, and writes are write-back: a block is
+ * marked dirty and reaches the disk on HFS_BD_Flush, on HFS_BD_Close
+ * (unmount), or when it is evicted. Flushes go out in ascending block
+ * order so the disk sees one sweep.
+ *
+ * Long aligned transfers - kBCStreamBlocks whole blocks or more, which is
+ * a file being copied rather than metadata being walked - go straight
+ * between the device and the caller's buffer and would only push the
+ * catalog out of the cache. Dirty cached copies of those blocks are laid
+ * over what a direct read returns, and a direct write refreshes them.
+ *
+ * The block memory is one NewPtr arena taken on the first disk access;
+ * if the heap will not give the full size the cache settles for less.
+ *
+ * Copyright (c) 2025 - System 7.1 Portable Project
+ */
+
+#include "../../include/FS/hfs_diskio.h"
+#include "../../include/MemoryMgr/MemoryManager.h"
+#include <string.h>
+#include "FS/FSLogging.h"
+
+#ifndef HFS_BLOCK_CACHE_KB
+#define HFS_BLOCK_CACHE_KB  256
+#endif
+
+#define kBCBlockShift    12
+#define kBCBlockBytes    (1u << kBCBlockShift)
+#define kBCSlots         ((HFS_BLOCK_CACHE_KB * 1024u) / kBCBlockBytes)
+#define kBCBuckets       128            /* power of two */
+#define kBCStreamBlocks  8              /* whole-block runs this long skip the cache */
+#define kBCNone          (-1)
+
+#if kBCSlots < 1 || kBCSlots > 8192
+#error "HFS_BLOCK_CACHE_KB must be between 4 and 32768"
+#endif
+
+typedef struct BCEntry {
+    uint64_t  block;        /* device byte offset >> kBCBlockShift */
+    uint8_t*  data;         /* kBCBlockBytes of the arena */
+    int       device;       /* bd->device_index */
+    uint16_t  bytes;        /* valid bytes; short only at the end of the device */
+    uint8_t   type;         /* bd->type */
+    uint8_t   sectorShift;  /* log2(bd->sectorSize) */
+    bool      used;
+    bool      dirty;
+    int16_t   hashNext;
+    int16_t   lruPrev;      /* towards most recently used */
+    int16_t   lruNext;
+} BCEntry;
+
+static BCEntry  gBCEntries[kBCSlots];
+static int16_t  gBCBuckets[kBCBuckets];
+static int16_t  gBCLruHead = kBCNone;      /* most recently used */
+static int16_t  gBCLruTail = kBCNone;
+static int16_t  gBCFreeHead = kBCNone;     /* chained through lruNext */
+static int16_t  gBCFlushOrder[kBCSlots];
+static uint8_t* gBCArena;
+static HFS_BlockCacheStats gBCStats;
+
+static bool BCInit(void) {
+    uint32_t slots = kBCSlots;
+
+    if (gBCArena) return true;
+
+    while (slots > 0 && !(gBCArena = (uint8_t*)(void*)NewPtr(slots * kBCBlockBytes))) {
+        slots /= 2;
+    }
+    if (!gBCArena) {
+        FS_LOG_DEBUG("HFS: block cache: no memory for even one block\n");
+        return false;
+    }
+
+    for (int b = 0; b < kBCBuckets; b++) {
+        gBCBuckets[b] = kBCNone;
+    }
+    for (uint32_t i = 0; i < slots; i++) {
+        gBCEntries[i].used = false;
+        gBCEntries[i].data = gBCArena + i * kBCBlockBytes;
+        gBCEntries[i].lruNext = (i + 1 < slots) ? (int16_t)(i + 1) : kBCNone;
+    }
+    gBCFreeHead = 0;
+    gBCLruHead = kBCNone;
+    gBCLruTail = kBCNone;
+    memset(&gBCStats, 0, sizeof(gBCStats));
+    gBCStats.capacity = slots;
+    gBCStats.blockSize = kBCBlockBytes;
+
+    FS_LOG_DEBUG("HFS: block cache: %u blocks of %u bytes\n",
+                 (unsigned)slots, (unsigned)kBCBlockBytes);
+    return true;
+}
+
+/* log2 of the sector size, or 0 if the device's sectors cannot tile a
+ * cache block (not a power of two, or larger than one) */
+static uint8_t BCSectorShift(const HFS_BlockDev* bd) {
+    uint8_t shift = 0;
+    while (shift < kBCBlockShift && (1u << shift) < bd->sectorSize) {
+        shift++;
+    }
+    return ((1u << shift) == bd->sectorSize) ? shift : 0;
+}
+
+static uint32_t BCHash(uint8_t type, int device, uint64_t block) {
+    /* Consecutive blocks land in consecutive buckets */
+    return ((uint32_t)block ^ ((uint32_t)device << 5) ^ ((uint32_t)type << 9)) & (kBCBuckets - 1);
+}
+
+static int16_t BCFind(const HFS_BlockDev* bd, uint64_t block) {
+    for (int16_t i = gBCBuckets[BCHash((uint8_t)bd->type, bd->device_index, block)];
+         i != kBCNone; i = gBCEntries[i].hashNext) {
+        BCEntry* e = &gBCEntries[i];
+        if (e->block == block && e->device == bd->device_index && e->type == (uint8_t)bd->type) {
+            return i;
+        }
+    }
+    return kBCNone;
+}
+
+static void BCLruUnlink(int16_t i) {
+    BCEntry* e = &gBCEntries[i];
+    if (e->lruPrev != kBCNone) gBCEntries[e->lruPrev].lruNext = e->lruNext;
+    else gBCLruHead = e->lruNext;
+    if (e->lruNext != kBCNone) gBCEntries[e->lruNext].lruPrev = e->lruPrev;
+    else gBCLruTail = e->lruPrev;
+}
+
+static void BCLruPushFront(int16_t i) {
+    BCEntry* e = &gBCEntries[i];
+    e->lruPrev = kBCNone;
+    e->lruNext = gBCLruHead;
+    if (gBCLruHead != kBCNone) gBCEntries[gBCLruHead].lruPrev = i;
+    gBCLruHead = i;
+    if (gBCLruTail == kBCNone) gBCLruTail = i;
+}
+
+/* Drop entry i, dirty or not: out of its bucket and the LRU list */
+static void BCRemove(int16_t i) {
+    BCEntry* e = &gBCEntries[i];
+    int16_t* link = &gBCBuckets[BCHash(e->type, e->device, e->block)];
+
+    while (*link != kBCNone && *link != i) {
+        link = &gBCEntries[*link].hashNext;
+    }
+    if (*link == i) *link = e->hashNext;
+
+    BCLruUnlink(i);
+    if (e->dirty) gBCStats.dirty--;
+    gBCStats.blocks--;
+    e->used = false;
+    e->dirty = false;
+    e->lruNext = gBCFreeHead;
+    gBCFreeHead = i;
+}
+
+static bool BCWriteBack(int16_t i) {
+    BCEntry* e = &gBCEntries[i];
+    HFS_BlockDev dev;
+
+    /* The entry may belong to another device than the caller's */
+    memset(&dev, 0, sizeof(dev));
+    dev.type = (HFS_BD_Type)e->type;
+    dev.device_index = e->device;
+    dev.sectorSize = 1u << e->sectorShift;
+
+    if (!HFS_BD_WriteSectors(&dev, e->block << (kBCBlockShift - e->sectorShift),
+                             (uint32_t)e->bytes >> e->sectorShift, e->data)) {
+        return false;
+    }
+    e->dirty = false;
+    gBCStats.dirty--;
+    gBCStats.writebacks++;
+    return true;
+}
+
+/*
+ * The slot holding block of bd, most recently used now. On a miss a slot
+ * is taken (the least recently used one, written back first if dirty) and
+ * filled from the device, unless fill is false because the caller is about
+ * to overwrite every byte of it. kBCNone on an I/O error.
+ */
+static int16_t BCGet(const HFS_BlockDev* bd, uint8_t sectorShift, uint64_t block, bool fill) {
+    int16_t i = BCFind(bd, block);
+    if (i != kBCNone) {
+        if (gBCLruHead != i) {
+            BCLruUnlink(i);
+            BCLruPushFront(i);
+        }
+        gBCStats.hits++;
+        return i;
+    }
+    gBCStats.misses++;
+
+    if (gBCFreeHead == kBCNone) {
+        i = gBCLruTail;
+        if (gBCEntries[i].dirty && !BCWriteBack(i)) {
+            return kBCNone;
+        }
+        BCRemove(i);
+        gBCStats.evictions++;
+    }
+
+    i = gBCFreeHead;
+    BCEntry* e = &gBCEntries[i];
+    uint64_t start = block << kBCBlockShift;
+    uint64_t left = bd->size - start;
+
+    e->block = block;
+    e->device = bd->device_index;
+    e->type = (uint8_t)bd->type;
+    e->sectorShift = sectorShift;
+    e->bytes = (uint16_t)(left < kBCBlockBytes ? left : kBCBlockBytes);
+    e->dirty = false;
+
+    if (fill && !HFS_BD_ReadSectors(bd, start >> sectorShift,
+                                    (uint32_t)e->bytes >> sectorShift, e->data)) {
+        return kBCNone;     /* slot stays on the free list */
+    }
+
+    gBCFreeHead = e->lruNext;
+    e->used = true;
+    uint32_t b = BCHash(e->type, e->device, block);
+    e->hashNext = gBCBuckets[b];
+    gBCBuckets[b] = i;
+    BCLruPushFront(i);
+    gBCStats.blocks++;
+    return i;
+}
+
+/* Common entry checks; the sector shift for the transfer, 0 if refused */
+static uint8_t BCBegin(const HFS_BlockDev* bd) {
+    uint8_t shift = BCSectorShift(bd);
+    if (shift == 0) {
+        FS_LOG_DEBUG("HFS: block cache: unsupported sector size %u on device %d\n",
+                     (unsigned)bd->sectorSize, bd->device_index);
+        return 0;
+    }
+    return BCInit() ? shift : 0;
+}
+
+bool HFS_BC_Read(const HFS_BlockDev* bd, uint64_t offset, void* buffer, uint32_t length) {
+    uint8_t* dst = (uint8_t*)buffer;
+    uint8_t shift;
+
+    if (!bd || !buffer || offset + length > bd->size) return false;
+    if ((shift = BCBegin(bd)) == 0) return false;
+
+    while (length > 0) {
+        uint64_t block = offset >> kBCBlockShift;
+        uint32_t inBlock = (uint32_t)offset & (kBCBlockBytes - 1);
+
+        if (inBlock == 0 && length >= kBCStreamBlocks * kBCBlockBytes) {
+            uint32_t run = length & ~(kBCBlockBytes - 1);
+            uint32_t count = run >> kBCBlockShift;
+
+            if (!HFS_BD_ReadSectors(bd, offset >> shift, run >> shift, dst)) {
+                return false;
+            }
+            /* The device is behind wherever a cached copy is dirty */
+            for (uint32_t k = 0; k < count && gBCStats.dirty > 0; k++) {
+                int16_t i = BCFind(bd, block + k);
+                if (i != kBCNone && gBCEntries[i].dirty) {
+                    memcpy(dst + (k << kBCBlockShift), gBCEntries[i].data, kBCBlockBytes);
+                }
+            }
+            gBCStats.bypassed += count;
+            dst += run;
+            offset += run;
+            length -= run;
+            continue;
+        }
+
+        int16_t i = BCGet(bd, shift, block, true);
+        if (i == kBCNone) return false;
+
+        uint32_t chunk = kBCBlockBytes - inBlock;
+        if (chunk > length) chunk = length;
+        memcpy(dst, gBCEntries[i].data + inBlock, chunk);
+        dst += chunk;
+        offset += chunk;
+        length -= chunk;
+    }
+    return true;
+}
+
+bool HFS_BC_Write(const HFS_BlockDev* bd, uint64_t offset, const void* buffer, uint32_t length) {
+    const uint8_t* src = (const uint8_t*)buffer;
+    uint8_t shift;
+
+    if (!bd || !buffer || offset + length > bd->size) return false;
+    if ((shift = BCBegin(bd)) == 0) return false;
+
+    while (length > 0) {
+        uint64_t block = offset >> kBCBlockShift;
+        uint32_t inBlock = (uint32_t)offset & (kBCBlockBytes - 1);
+
+        if (inBlock == 0 && length >= kBCStreamBlocks * kBCBlockBytes) {
+            uint32_t run = length & ~(kBCBlockBytes - 1);
+            uint32_t count = run >> kBCBlockShift;
+
+            if (!HFS_BD_WriteSectors(bd, offset >> shift, run >> shift, src)) {
+                return false;
+            }
+            /* Cached copies now match the device */
+            for (uint32_t k = 0; k < count && gBCStats.blocks > 0; k++) {
+                int16_t i = BCFind(bd, block + k);
+                if (i != kBCNone) {
+                    memcpy(gBCEntries[i].data, src + (k << kBCBlockShift), kBCBlockBytes);
+                    if (gBCEntries[i].dirty) {
+                        gBCEntries[i].dirty = false;
+                        gBCStats.dirty--;
+                    }
+                }
+            }
+            gBCStats.bypassed += count;
+            src += run;
+            offset += run;
+            length -= run;
+            continue;
+        }
+
+        uint32_t chunk = kBCBlockBytes - inBlock;
+        if (chunk > length) chunk = length;
+
+        /* A write covering the whole block need not read it first */
+        uint64_t left = bd->size - (block << kBCBlockShift);
+        bool whole = (inBlock == 0 && (uint64_t)chunk >= (left < kBCBlockBytes ? left : kBCBlockBytes));
+
+        int16_t i = BCGet(bd, shift, block, !whole);
+        if (i == kBCNone) return false;
+
+        BCEntry* e = &gBCEntries[i];
+        memcpy(e->data + inBlock, src, chunk);
+        if (!e->dirty) {
+            e->dirty = true;
+            gBCStats.dirty++;
+        }
+        src += chunk;
+        offset += chunk;
+        length -= chunk;
+    }
+    return true;
+}
+
+bool HFS_BC_Flush(const HFS_BlockDev* bd) {
+    int n = 0;
+    bool ok = true;
+
+    if (!bd || !gBCArena || gBCStats.dirty == 0) return true;
+
+    for (int16_t i = gBCLruHead; i != kBCNone; i = gBCEntries[i].lruNext) {
+        BCEntry* e = &gBCEntries[i];
+        if (e->dirty && e->device == bd->device_index && e->type == (uint8_t)bd->type) {
+            gBCFlushOrder[n++] = i;
+        }
+    }
+
+    /* Ascending block order: one sweep across the disk */
+    for (int j = 1; j < n; j++) {
+        int16_t i = gBCFlushOrder[j];
+        int k = j;
+        while (k > 0 && gBCEntries[gBCFlushOrder[k - 1]].block > gBCEntries[i].block) {
+            gBCFlushOrder[k] = gBCFlushOrder[k - 1];
+            k--;
+        }
+        gBCFlushOrder[k] = i;
+    }
+
+    for (int j = 0; j < n; j++) {
+        if (!BCWriteBack(gBCFlushOrder[j])) {
+            ok = false;     /* keep going; the block stays dirty */
+        }
+    }
+    return ok;
+}
+
+void HFS_BC_Invalidate(const HFS_BlockDev* bd) {
+    if (!bd || !gBCArena) return;
+
+    for (int16_t i = gBCLruHead; i != kBCNone; ) {
+        int16_t next = gBCEntries[i].lruNext;
+        if (gBCEntries[i].device == bd->device_index && gBCEntries[i].type == (uint8_t)bd->type) {
+            BCRemove(i);
+        }
+        i = next;
+    }
+}
+
+void HFS_BD_GetCacheStats(HFS_BlockCacheStats* stats) {
+    if (!stats) return;
+    memcpy(stats, &gBCStats, sizeof(*stats));
+    if (!gBCArena) {
+        stats->blockSize = kBCBlockBytes;
+    }
+}
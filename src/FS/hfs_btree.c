@@ -1,19 +1,21 @@
 /* HFS B-Tree Implementation */
 #include "../../include/FS/hfs_btree.h"
 #include "../../include/FS/hfs_endian.h"
+#include "../../include/FS/hfs_alloc.h"
 #include "../../include/MemoryMgr/MemoryManager.h"
 #include <string.h>
 #include "FS/FSLogging.h"
 
 /* Serial debug output */
 
-/* Read data from B-tree file using extents */
-static bool read_btree_data(HFS_BTree* bt, uint32_t offset, void* buffer, uint32_t length) {
+/* Read or write data in the B-tree file using extents */
+static bool transfer_btree_data(HFS_BTree* bt, uint32_t offset, void* buffer, uint32_t length,
+                                bool write) {
     if (!bt || !buffer) return false;
 
-    FS_LOG_DEBUG("read_btree_data: offset=%d length=%d fileSize=%d vol=%p bd.data=%p\n",
+    FS_LOG_DEBUG("transfer_btree_data: offset=%d length=%d fileSize=%d vol=%p bd.data=%p write=%d\n",
                  (int)offset, (int)length, (int)bt->fileSize,
-                 (void*)bt->vol, bt->vol->bd.data);
+                 (void*)bt->vol, bt->vol->bd.data, write);
 
     uint32_t bytesRead = 0;
     uint32_t currentOffset = offset;
@@ -21,10 +23,10 @@ static bool read_btree_data(HFS_BTree* bt, uint32_t offset, void* buffer, uint32
     /* Read from first 3 extents */
     for (int i = 0; i < 3 && bytesRead < length; i++) {
         if (bt->extents[i].blockCount == 0) {
-            /* FS_LOG_DEBUG("read_btree_data: Extent %d has 0 blocks\n", i); */
+            /* FS_LOG_DEBUG("transfer_btree_data: Extent %d has 0 blocks\n", i); */
             break;
         }
-        FS_LOG_DEBUG("read_btree_data: Extent %d - startBlock=%u, blockCount=%u\n",
+        FS_LOG_DEBUG("transfer_btree_data: Extent %d - startBlock=%u, blockCount=%u\n",
                      i, bt->extents[i].startBlock, bt->extents[i].blockCount);
 
         uint32_t extentBytes = bt->extents[i].blockCount * bt->vol->alBlkSize;
@@ -43,19 +45,14 @@ static bool read_btree_data(HFS_BTree* bt, uint32_t offset, void* buffer, uint32
             toRead = length - bytesRead;
         }
 
-        /* Read the blocks */
-        uint8_t* tempBuffer = NewPtr(bt->vol->alBlkSize * 2);
-        if (!tempBuffer) return false;
-
-        uint32_t blocksToRead = (toRead + byteOffset + bt->vol->alBlkSize - 1) / bt->vol->alBlkSize;
-        if (!HFS_ReadAllocBlocks(bt->vol, startBlock + blockOffset, blocksToRead, tempBuffer)) {
-            DisposePtr((Ptr)tempBuffer);
+        /* Move the bytes in place; the block cache keeps the nodes */
+        uint64_t devOffset = HFS_AllocBlockToByteOffset(bt->vol, startBlock + blockOffset) + byteOffset;
+        bool ok = write ? HFS_BD_Write(&bt->vol->bd, devOffset, (uint8_t*)buffer + bytesRead, toRead)
+                        : HFS_BD_Read(&bt->vol->bd, devOffset, (uint8_t*)buffer + bytesRead, toRead);
+        if (!ok) {
             return false;
         }
 
-        memcpy((uint8_t*)buffer + bytesRead, tempBuffer + byteOffset, toRead);
-        DisposePtr((Ptr)tempBuffer);
-
         bytesRead += toRead;
         currentOffset = 0;  /* Reset for next extent */
     }
@@ -100,7 +97,7 @@ bool HFS_BT_Init(HFS_BTree* bt, HFS_Volume* vol, HFS_BTreeType type) {
     /* Read header node (node 0) */
     uint8_t headerNode[512];  /* Start with minimum size */
     /* FS_LOG_DEBUG("HFS_BT_Init: About to read header node from offset 0, size %u\n", sizeof(headerNode)); */
-    if (!read_btree_data(bt, 0, headerNode, sizeof(headerNode))) {
+    if (!transfer_btree_data(bt, 0, headerNode, sizeof(headerNode), false)) {
         /* FS_LOG_DEBUG("HFS_BT_Init: Failed to read header node\n"); */
         return false;
     }
@@ -125,6 +122,8 @@ bool HFS_BT_Init(HFS_BTree* bt, HFS_Volume* vol, HFS_BTreeType type) {
     bt->lastLeaf    = be32_read(&header->lastLeafNode);
     bt->nodeSize    = be16_read(&header->nodeSize);
     bt->totalNodes  = be32_read(&header->totalNodes);
+    bt->freeNodes   = be32_read(&header->freeNodes);
+    bt->leafRecords = be32_read(&header->leafRecords);
 
     /* Validate node size - must be power of 2 between 512 and 32768 */
     if (bt->nodeSize < 512 || bt->nodeSize > 32768 ||
@@ -162,7 +161,7 @@ bool HFS_BT_ReadNode(HFS_BTree* bt, uint32_t nodeNum, void* buffer) {
     if (!bt || !buffer || nodeNum >= bt->totalNodes) return false;
 
     uint32_t offset = nodeNum * bt->nodeSize;
-    return read_btree_data(bt, offset, buffer, bt->nodeSize);
+    return transfer_btree_data(bt, offset, buffer, bt->nodeSize, false);
 }
 
 bool HFS_BT_GetRecord(void* node, uint16_t nodeSize, uint16_t recordNum,
@@ -203,6 +202,128 @@ bool HFS_BT_GetRecord(void* node, uint16_t nodeSize, uint16_t recordNum,
     return true;
 }
 
+/*
+ * Split a leaf record into its key and data. A record is the key length
+ * byte, the key, then the data, and on disks written by the Mac OS the
+ * data starts on a word boundary: an even key length is followed by a pad
+ * byte. Volumes built by HFS_CreateBlankVolume/HFS_FormatVolume pack the
+ * data right after the key instead. Catalog data always opens with a
+ * record type whose high byte is 1-4, never zero, which tells the two
+ * apart.
+ */
+bool HFS_BT_SplitRecord(const HFS_BTree* bt, void* record, uint16_t recordLen,
+                        void** data, uint16_t* dataLen) {
+    uint8_t* bytes = (uint8_t*)record;
+    uint16_t dataOffset = 1 + bytes[0];
+
+    if ((dataOffset & 1) && dataOffset < recordLen &&
+        (bt->type != kBTreeCatalog || bytes[dataOffset] == 0)) {
+        dataOffset++;
+    }
+    if (dataOffset > recordLen) return false;
+
+    *data = bytes + dataOffset;
+    *dataLen = recordLen - dataOffset;
+    return true;
+}
+
+/* HFS trees are at most eight levels deep */
+#define kBTMaxDepth 8
+
+static int compare_keys(const HFS_BTree* bt, const void* key1, const void* key2) {
+    return (bt->type == kBTreeCatalog) ? HFS_CompareCatalogKeys(key1, key2)
+                                       : HFS_CompareExtentsKeys(key1, key2);
+}
+
+/*
+ * Descend from the root to the leaf where key is or would be: in each
+ * index node, follow the last record whose key is not greater than key.
+ * One node read per level instead of a walk along every leaf.
+ *
+ * Leaves are searched record by record rather than by bisection, because
+ * the leaf HFS_CreateBlankVolume writes is not in key order; an exact
+ * match anywhere in the leaf wins. Without one, *recordIndex is the first
+ * record with a greater key, or numRecords if the keys that follow start
+ * in the next leaf. path[] gets the nodes passed through, root first and
+ * the leaf last, so the writer can walk back up to each node's parent.
+ */
+static bool seek_path(HFS_BTree* bt, const void* key, void* nodeBuffer,
+                      uint32_t* path, int* pathLen, uint16_t* recordIndex, bool* exact) {
+    if (bt->rootNode == 0) return false;    /* empty tree */
+
+    uint32_t node = bt->rootNode;
+
+    /* A well-formed tree is treeDepth levels deep; don't loop on a bad one */
+    for (int level = 0; level <= bt->treeDepth + 1 && level < kBTMaxDepth; level++) {
+        if (!HFS_BT_ReadNode(bt, node, nodeBuffer)) return false;
+        path[level] = node;
+        *pathLen = level + 1;
+
+        HFS_BTNodeDesc* nodeDesc = (HFS_BTNodeDesc*)nodeBuffer;
+        uint16_t numRecords = be16_read(&nodeDesc->numRecords);
+        void* record;
+        uint16_t recordLen;
+
+        if (nodeDesc->kind == kBTLeafNode) {
+            uint16_t greater = numRecords;
+            for (uint16_t i = 0; i < numRecords; i++) {
+                if (!HFS_BT_GetRecord(nodeBuffer, bt->nodeSize, i, &record, &recordLen)) {
+                    continue;
+                }
+                int cmp = compare_keys(bt, record, key);
+                if (cmp == 0) {
+                    *recordIndex = i;
+                    *exact = true;
+                    return true;
+                }
+                if (cmp > 0 && greater == numRecords) {
+                    greater = i;
+                }
+            }
+            *recordIndex = greater;
+            *exact = false;
+            return true;
+        }
+
+        if (nodeDesc->kind != kBTIndexNode || numRecords == 0) {
+            FS_LOG_DEBUG("HFS BTree: Seek: node %u has kind %d\n", node, nodeDesc->kind);
+            return false;
+        }
+
+        /* Index records: key padded to a word boundary, then the child's
+         * node number. Keys below the first one still go to its child. */
+        uint32_t child = 0;
+        for (uint16_t i = 0; i < numRecords; i++) {
+            if (!HFS_BT_GetRecord(nodeBuffer, bt->nodeSize, i, &record, &recordLen)) {
+                break;
+            }
+            if (i > 0 && compare_keys(bt, record, key) > 0) {
+                break;
+            }
+            uint16_t ptrOffset = (uint16_t)((1 + ((uint8_t*)record)[0] + 1) & ~1);
+            if (ptrOffset + 4 > recordLen) return false;
+            child = be32_read((uint8_t*)record + ptrOffset);
+        }
+        if (child == 0) return false;
+        node = child;
+    }
+
+    FS_LOG_DEBUG("HFS BTree: Seek: deeper than treeDepth %u\n", bt->treeDepth);
+    return false;
+}
+
+bool HFS_BT_Seek(HFS_BTree* bt, const void* key, void* nodeBuffer,
+                 uint32_t* leafNode, uint16_t* recordIndex, bool* exact) {
+    uint32_t path[kBTMaxDepth];
+    int pathLen = 0;
+
+    if (!bt || !key || !nodeBuffer || !leafNode || !recordIndex || !exact) return false;
+    if (!seek_path(bt, key, nodeBuffer, path, &pathLen, recordIndex, exact)) return false;
+
+    *leafNode = path[pathLen - 1];
+    return true;
+}
+
 bool HFS_BT_IterateLeaves(HFS_BTree* bt, HFS_BT_IteratorFunc func, void* context) {
     if (!bt || !func) return false;
 
@@ -233,10 +354,12 @@ bool HFS_BT_IterateLeaves(HFS_BTree* bt, HFS_BT_IteratorFunc func, void* context
             if (bt->type == kBTreeCatalog) {
                 HFS_CatKey* key = (HFS_CatKey*)record;
                 uint8_t keyLen = key->keyLength;
-                /* keyLength excludes the keyLength byte itself, so data starts at +1 + keyLen */
-                void* data = (uint8_t*)record + 1 + keyLen;
-                uint16_t dataLen = recordLen - 1 - keyLen;
+                void* data;
+                uint16_t dataLen;
 
+                if (!HFS_BT_SplitRecord(bt, record, recordLen, &data, &dataLen)) {
+                    continue;
+                }
                 if (!func(key, keyLen, data, dataLen, context)) {
                     DisposePtr((Ptr)nodeBuffer);
                     return true;  /* Iterator requested stop */
@@ -252,6 +375,756 @@ bool HFS_BT_IterateLeaves(HFS_BTree* bt, HFS_BT_IteratorFunc func, void* context
     return true;
 }
 
+/*
+ * Writing
+ *
+ * A node is never patched in place. A change gathers the node's records,
+ * adds or drops one, sorts them and lays them out again. When they no
+ * longer fit, they are dealt into two nodes and the new node's first key
+ * goes up into the parent, which may split in turn, up to a new root. One
+ * path for every case, at no cost that matters at these node sizes, and
+ * the leaf HFS_CreateBlankVolume wrote out of key order is put in order
+ * the first time it changes.
+ *
+ * Nodes are allocated from the map record in the header node, and from
+ * map nodes chained after it on volumes big enough to have them. When the
+ * map has nothing free, the B-tree file grows by a clump of allocation
+ * blocks - in place when the blocks after it are free, so its last extent
+ * just gets longer.
+ */
+
+/* Header node: descriptor, header record, 128-byte user record, map record */
+#define kBTHeaderRecOffset  14
+#define kBTUserRecOffset    120
+#define kBTMapRecOffset     248
+
+/* Nodes a B-tree file grows by at least, when the MDB gives no clump size
+ * (HFS_CreateBlankVolume and HFS_FormatVolume leave it zero) */
+#define kBTClumpNodes       16
+
+typedef struct {
+    const uint8_t* bytes;
+    uint16_t       length;
+} BTRecordRef;
+
+/* Buffers for one change, from one allocation */
+typedef struct {
+    BTRecordRef* refs;
+    uint16_t     maxRefs;
+    uint8_t*     node;      /* the node being changed, as it is on disk */
+    uint8_t*     left;      /* its new contents */
+    uint8_t*     right;     /* the new sibling, when it splits */
+    uint8_t*     aux;       /* header, map and neighbouring nodes */
+    uint8_t*     record;    /* the record going in */
+    uint8_t*     up;        /* the index record for the level above */
+} BTScratch;
+
+static bool scratch_open(const HFS_BTree* bt, BTScratch* sc) {
+    uint16_t maxRefs = (uint16_t)(bt->nodeSize / 4 + 2);
+    uint32_t refBytes = ((uint32_t)maxRefs * sizeof(BTRecordRef) + 7) & ~7u;
+    uint8_t* mem = (uint8_t*)NewPtr(refBytes + 6u * bt->nodeSize);
+
+    if (!mem) return false;
+    sc->refs = (BTRecordRef*)(void*)mem;
+    sc->maxRefs = maxRefs;
+    sc->node = mem + refBytes;
+    sc->left = sc->node + bt->nodeSize;
+    sc->right = sc->left + bt->nodeSize;
+    sc->aux = sc->right + bt->nodeSize;
+    sc->record = sc->aux + bt->nodeSize;
+    sc->up = sc->record + bt->nodeSize;
+    return true;
+}
+
+static void scratch_close(BTScratch* sc) {
+    DisposePtr((Ptr)sc->refs);
+}
+
+static bool write_node(HFS_BTree* bt, uint32_t nodeNum, uint8_t* buffer) {
+    if (nodeNum >= bt->totalNodes) return false;
+    return transfer_btree_data(bt, nodeNum * bt->nodeSize, buffer, bt->nodeSize, true);
+}
+
+/* Entry i of the node's offset table; entry numRecords is the free space */
+static uint16_t node_offset(const HFS_BTree* bt, const uint8_t* node, uint16_t i) {
+    return be16_read(node + bt->nodeSize - 2 * (i + 1));
+}
+
+static void set_descriptor(uint8_t* node, uint32_t fLink, uint32_t bLink,
+                           uint8_t kind, uint8_t height) {
+    HFS_BTNodeDesc* desc = (HFS_BTNodeDesc*)node;
+    be32_write(&desc->fLink, fLink);
+    be32_write(&desc->bLink, bLink);
+    desc->kind = kind;
+    desc->height = height;
+    be16_write(&desc->numRecords, 0);
+    desc->reserved = 0;
+}
+
+/* The child an index record points to */
+static uint32_t index_child(const uint8_t* record) {
+    return be32_read(record + ((1 + record[0] + 1) & ~1));
+}
+
+/* How long a record is by its contents, for a last record with nothing
+ * after it to say where it ends */
+static uint16_t natural_length(const HFS_BTree* bt, uint8_t kind, uint8_t* record,
+                               uint16_t available) {
+    uint16_t length = available;
+
+    if (kind == kBTIndexNode) {
+        length = (uint16_t)(((1 + record[0] + 1) & ~1) + 4);
+    } else if (bt->type == kBTreeExtents) {
+        length = (uint16_t)(((1 + record[0] + 1) & ~1) + 3 * sizeof(HFS_Extent));
+    } else {
+        void* data;
+        uint16_t dataLen;
+        if (HFS_BT_SplitRecord(bt, record, available, &data, &dataLen) && dataLen >= 2) {
+            uint16_t dataOffset = (uint16_t)((uint8_t*)data - record);
+            switch (be16_read(data)) {
+            case kHFS_FolderRecord:       length = dataOffset + sizeof(HFS_CatFolderRec); break;
+            case kHFS_FileRecord:         length = dataOffset + sizeof(HFS_CatFileRec); break;
+            case kHFS_FolderThreadRecord:
+            case kHFS_FileThreadRecord:   length = dataOffset + sizeof(HFS_CatThreadRec); break;
+            default: break;
+            }
+        }
+    }
+    return (length < available) ? length : available;
+}
+
+/*
+ * The node's records, each as long as the offset table says: up to the
+ * next record, and for the last one up to the free-space offset. The leaf
+ * HFS_CreateBlankVolume writes has one more record than it counts, and its
+ * free-space offset is where that record starts - which is still where the
+ * last counted record ends. With no usable free-space offset the last
+ * record is measured by its contents.
+ */
+static bool gather_records(const HFS_BTree* bt, uint8_t* node, BTRecordRef* refs,
+                           uint16_t maxRefs, uint16_t* count) {
+    HFS_BTNodeDesc* desc = (HFS_BTNodeDesc*)node;
+    uint16_t numRecords = be16_read(&desc->numRecords);
+    uint32_t tableStart = bt->nodeSize - 2u * (numRecords + 1);
+
+    if (numRecords > maxRefs || tableStart <= sizeof(HFS_BTNodeDesc)) return false;
+
+    for (uint16_t i = 0; i < numRecords; i++) {
+        uint16_t start = node_offset(bt, node, i);
+        uint16_t end = node_offset(bt, node, (uint16_t)(i + 1));
+
+        if (start < sizeof(HFS_BTNodeDesc) || start >= tableStart) return false;
+        if (end <= start || end > tableStart) {
+            if (i + 1 < numRecords) return false;
+            end = (uint16_t)(start + natural_length(bt, desc->kind, node + start,
+                                                    (uint16_t)(tableStart - start)));
+        }
+        refs[i].bytes = node + start;
+        refs[i].length = (uint16_t)(end - start);
+    }
+    *count = numRecords;
+    return true;
+}
+
+static void sort_records(const HFS_BTree* bt, BTRecordRef* refs, uint16_t count) {
+    for (uint16_t i = 1; i < count; i++) {
+        BTRecordRef ref = refs[i];
+        uint16_t j = i;
+        while (j > 0 && compare_keys(bt, refs[j - 1].bytes, ref.bytes) > 0) {
+            refs[j] = refs[j - 1];
+            j--;
+        }
+        refs[j] = ref;
+    }
+}
+
+/* Lay the records out after node's descriptor, each on a word boundary,
+ * with the offset table and free-space offset at the end */
+static bool pack_node(const HFS_BTree* bt, uint8_t* node, const BTRecordRef* refs, uint16_t count) {
+    uint32_t used = sizeof(HFS_BTNodeDesc);
+
+    for (uint16_t i = 0; i < count; i++) {
+        used += (refs[i].length + 1u) & ~1u;
+    }
+    if (used + 2u * (count + 1) > bt->nodeSize) return false;
+
+    memset(node + sizeof(HFS_BTNodeDesc), 0, bt->nodeSize - sizeof(HFS_BTNodeDesc));
+
+    uint16_t offset = sizeof(HFS_BTNodeDesc);
+    for (uint16_t i = 0; i < count; i++) {
+        be16_write(node + bt->nodeSize - 2 * (i + 1), offset);
+        memcpy(node + offset, refs[i].bytes, refs[i].length);
+        offset = (uint16_t)(offset + ((refs[i].length + 1u) & ~1u));
+    }
+    be16_write(node + bt->nodeSize - 2 * (count + 1), offset);
+    be16_write(&((HFS_BTNodeDesc*)node)->numRecords, count);
+    return true;
+}
+
+/* Where to cut refs into two nodes that both fit, as even by bytes as
+ * possible; 0 if there is no such place */
+static uint16_t choose_split(const HFS_BTree* bt, const BTRecordRef* refs, uint16_t count) {
+    uint32_t room = bt->nodeSize - sizeof(HFS_BTNodeDesc);
+    uint32_t total = 0;
+    uint32_t left = 0;
+    uint32_t bestDiff = 0xFFFFFFFF;
+    uint16_t best = 0;
+
+    for (uint16_t i = 0; i < count; i++) {
+        total += (refs[i].length + 1u) & ~1u;
+    }
+    for (uint16_t k = 1; k < count; k++) {
+        left += (refs[k - 1].length + 1u) & ~1u;
+        uint32_t right = total - left;
+        if (left + 2u * (k + 1) > room || right + 2u * (count - k + 1) > room) continue;
+
+        uint32_t diff = (left > right) ? left - right : right - left;
+        if (diff < bestDiff) {
+            bestDiff = diff;
+            best = k;
+        }
+    }
+    return best;
+}
+
+/* A leaf record: the key, a pad byte if that leaves the data on an odd
+ * offset, then the data */
+static uint16_t build_record(const uint8_t* key, const void* data, uint16_t dataLen, uint8_t* out) {
+    uint16_t keyBytes = (uint16_t)(1 + key[0]);
+
+    memcpy(out, key, keyBytes);
+    if (keyBytes & 1) {
+        out[keyBytes++] = 0;
+    }
+    if (dataLen) memcpy(out + keyBytes, data, dataLen);
+    return (uint16_t)(keyBytes + dataLen);
+}
+
+/* An index record for child, keyed by the first key in it. Catalog index
+ * keys are always the full 37 bytes, the name padded out with zeros. */
+static uint16_t build_index_record(const HFS_BTree* bt, const uint8_t* record, uint32_t child,
+                                   uint8_t* out) {
+    uint16_t keyBytes;
+
+    if (bt->type == kBTreeCatalog) {
+        uint8_t len = (record[0] < 37) ? record[0] : 37;
+        memset(out, 0, 38);
+        memcpy(out + 1, record + 1, len);
+        out[0] = 37;
+        keyBytes = 38;
+    } else {
+        keyBytes = (uint16_t)(1 + record[0]);
+        memcpy(out, record, keyBytes);
+        if (keyBytes & 1) {
+            out[keyBytes++] = 0;
+        }
+    }
+    be32_write(out + keyBytes, child);
+    return (uint16_t)(keyBytes + 4);
+}
+
+static bool write_header(HFS_BTree* bt, uint8_t* buf) {
+    if (!HFS_BT_ReadNode(bt, 0, buf)) return false;
+
+    HFS_BTHeaderRec* header = (HFS_BTHeaderRec*)(buf + kBTHeaderRecOffset);
+    be16_write(&header->depth, bt->treeDepth);
+    be32_write(&header->rootNode, bt->rootNode);
+    be32_write(&header->leafRecords, bt->leafRecords);
+    be32_write(&header->firstLeafNode, bt->firstLeaf);
+    be32_write(&header->lastLeafNode, bt->lastLeaf);
+    be32_write(&header->totalNodes, bt->totalNodes);
+    be32_write(&header->freeNodes, bt->freeNodes);
+    return write_node(bt, 0, buf);
+}
+
+/*
+ * Add a clump to the B-tree file. Its extents are the three the MDB has
+ * room for; a fourth would belong in the extents tree, and is refused.
+ */
+static bool extend_file(HFS_BTree* bt) {
+    HFS_Volume* vol = bt->vol;
+    HFS_Extent* ext = bt->extents;
+    HFS_Extent run;
+    int last = 0;
+
+    while (last < 2 && ext[last + 1].blockCount != 0) last++;
+
+    uint32_t clump = (bt->type == kBTreeCatalog) ? vol->mdb.drCTClpSiz : vol->mdb.drXTClpSiz;
+    if (clump < kBTClumpNodes * bt->nodeSize) {
+        clump = kBTClumpNodes * bt->nodeSize;
+    }
+    uint32_t want = (clump + vol->alBlkSize - 1) / vol->alBlkSize;
+    uint16_t goal = (uint16_t)(ext[last].startBlock + ext[last].blockCount);
+
+    if (!HFS_AllocBlocks(vol, goal, (uint16_t)want, &run)) {
+        FS_LOG_DEBUG("HFS BTree: no room to grow the %s file\n",
+                     bt->type == kBTreeCatalog ? "catalog" : "extents");
+        return false;
+    }
+    if (run.startBlock == goal && (uint32_t)ext[last].blockCount + run.blockCount <= 0xFFFF) {
+        ext[last].blockCount = (uint16_t)(ext[last].blockCount + run.blockCount);
+    } else if (last < 2) {
+        ext[last + 1] = run;
+    } else {
+        HFS_FreeBlocks(vol, run.startBlock, run.blockCount);
+        FS_LOG_DEBUG("HFS BTree: %s file would need a fourth extent\n",
+                     bt->type == kBTreeCatalog ? "catalog" : "extents");
+        return false;
+    }
+
+    bt->fileSize += (uint32_t)run.blockCount * vol->alBlkSize;
+    uint32_t total = bt->fileSize / bt->nodeSize;
+    if (total > bt->totalNodes) {
+        bt->freeNodes += total - bt->totalNodes;
+        bt->totalNodes = total;
+    }
+
+    if (bt->type == kBTreeCatalog) {
+        vol->catFileSize = bt->fileSize;
+        memcpy(vol->catExtents, bt->extents, sizeof(vol->catExtents));
+    } else {
+        vol->extFileSize = bt->fileSize;
+        memcpy(vol->extExtents, bt->extents, sizeof(vol->extExtents));
+    }
+    vol->mdbDirty = true;
+    return true;
+}
+
+/* Grow the file until count nodes are free */
+static bool reserve_nodes(HFS_BTree* bt, uint32_t count) {
+    for (int tries = 0; bt->freeNodes < count; tries++) {
+        if (tries == 4 || !extend_file(bt)) return false;
+    }
+    return true;
+}
+
+/* The map bits in buf, which holds the header node or a map node */
+static bool map_bits(HFS_BTree* bt, uint8_t* buf, bool header, uint8_t** bits, uint32_t* count) {
+    void* record;
+    uint16_t recordLen;
+
+    if (!HFS_BT_GetRecord(buf, bt->nodeSize, header ? 2 : 0, &record, &recordLen)) {
+        return false;
+    }
+    *bits = (uint8_t*)record;
+    *count = (uint32_t)recordLen * 8;
+    return true;
+}
+
+/* Allocate: set the first clear bit and return its node. Free: clear the
+ * bit for *node. */
+static bool map_update(HFS_BTree* bt, uint8_t* buf, bool allocate, uint32_t* node) {
+    uint32_t mapNode = 0;
+    uint32_t base = 0;
+
+    for (uint32_t hops = 0; hops <= bt->totalNodes; hops++) {
+        uint8_t* bits;
+        uint32_t count;
+
+        if (!HFS_BT_ReadNode(bt, mapNode, buf) ||
+            !map_bits(bt, buf, mapNode == 0, &bits, &count)) {
+            return false;
+        }
+
+        if (allocate) {
+            for (uint32_t i = 0; i < count && base + i < bt->totalNodes; i++) {
+                if (bits[i >> 3] == 0xFF && (i & 7) == 0) {
+                    i += 7;
+                    continue;
+                }
+                if (!(bits[i >> 3] & (0x80 >> (i & 7)))) {
+                    bits[i >> 3] |= (uint8_t)(0x80 >> (i & 7));
+                    *node = base + i;
+                    return write_node(bt, mapNode, buf);
+                }
+            }
+        } else if (*node < base + count) {
+            uint32_t i = *node - base;
+            bits[i >> 3] &= (uint8_t)~(0x80 >> (i & 7));
+            return write_node(bt, mapNode, buf);
+        }
+
+        base += count;
+        mapNode = be32_read(&((HFS_BTNodeDesc*)buf)->fLink);
+        if (mapNode == 0 || base >= bt->totalNodes) return false;
+    }
+    return false;
+}
+
+static bool alloc_node(HFS_BTree* bt, BTScratch* sc, uint32_t* node) {
+    if (!reserve_nodes(bt, 1)) return false;
+
+    if (!map_update(bt, sc->aux, true, node)) {
+        /* The header counted free nodes the map does not have */
+        bt->freeNodes = 0;
+        if (!reserve_nodes(bt, 1) || !map_update(bt, sc->aux, true, node)) return false;
+    }
+    bt->freeNodes--;
+    return true;
+}
+
+static bool free_node(HFS_BTree* bt, BTScratch* sc, uint32_t node) {
+    if (!map_update(bt, sc->aux, false, &node)) return false;
+    bt->freeNodes++;
+    return true;
+}
+
+/*
+ * Before the first change, make the header agree with the file and make
+ * sure there is a map to allocate from. HFS_CreateBlankVolume and
+ * HFS_FormatVolume write a header node that says it has three records but
+ * no offset table - so no map - and a node count that assumes 512-byte
+ * nodes. Their map is rebuilt from the nodes reachable from the root.
+ */
+static bool prepare_write(HFS_BTree* bt, BTScratch* sc) {
+    if (bt->writeReady) return true;
+    if (bt->vol->bd.readonly) return false;
+
+    uint32_t capacity = bt->fileSize / bt->nodeSize;
+    if (bt->totalNodes > capacity) {
+        uint32_t missing = bt->totalNodes - capacity;
+        bt->freeNodes = (bt->freeNodes > missing) ? bt->freeNodes - missing : 0;
+        bt->totalNodes = capacity;
+    }
+
+    uint8_t* header = sc->left;
+    if (!HFS_BT_ReadNode(bt, 0, header)) return false;
+
+    HFS_BTNodeDesc* desc = (HFS_BTNodeDesc*)header;
+    bool mapValid = be16_read(&desc->numRecords) == 3 &&
+                    node_offset(bt, header, 0) == kBTHeaderRecOffset &&
+                    node_offset(bt, header, 1) == kBTUserRecOffset &&
+                    node_offset(bt, header, 2) == kBTMapRecOffset &&
+                    node_offset(bt, header, 3) == bt->nodeSize - 8;
+
+    if (!mapValid) {
+        uint8_t* bits = header + kBTMapRecOffset;
+        uint32_t mapBits = (bt->nodeSize - 256u) * 8;
+        uint32_t used = 1;
+
+        memset(header + kBTUserRecOffset, 0, bt->nodeSize - kBTUserRecOffset);
+        be16_write(&desc->numRecords, 3);
+        be16_write(header + bt->nodeSize - 2, kBTHeaderRecOffset);
+        be16_write(header + bt->nodeSize - 4, kBTUserRecOffset);
+        be16_write(header + bt->nodeSize - 6, kBTMapRecOffset);
+        be16_write(header + bt->nodeSize - 8, (uint16_t)(bt->nodeSize - 8));
+        bits[0] = 0x80;     /* the header node */
+
+        /* Every level, left to right along its sibling links */
+        uint32_t first = bt->rootNode;
+        for (int level = 0; first != 0 && level < kBTMaxDepth; level++) {
+            uint32_t node = first;
+            first = 0;
+            for (uint32_t guard = 0; node != 0 && guard < bt->totalNodes; guard++) {
+                if (node >= mapBits || !HFS_BT_ReadNode(bt, node, sc->aux)) return false;
+                if (!(bits[node >> 3] & (0x80 >> (node & 7)))) {
+                    bits[node >> 3] |= (uint8_t)(0x80 >> (node & 7));
+                    used++;
+                }
+
+                HFS_BTNodeDesc* nodeDesc = (HFS_BTNodeDesc*)sc->aux;
+                void* record;
+                uint16_t recordLen;
+                if (first == 0 && nodeDesc->kind == kBTIndexNode &&
+                    HFS_BT_GetRecord(sc->aux, bt->nodeSize, 0, &record, &recordLen)) {
+                    first = index_child((uint8_t*)record);
+                }
+                node = be32_read(&nodeDesc->fLink);
+            }
+        }
+
+        bt->freeNodes = (bt->totalNodes > used) ? bt->totalNodes - used : 0;
+        if (!write_node(bt, 0, header)) return false;
+        FS_LOG_DEBUG("HFS BTree: rebuilt %s map: %u of %u nodes in use\n",
+                     bt->type == kBTreeCatalog ? "catalog" : "extents", used, bt->totalNodes);
+    }
+
+    if (!write_header(bt, sc->aux)) return false;
+    bt->writeReady = true;
+    return true;
+}
+
+static bool insert_record(HFS_BTree* bt, BTScratch* sc, const uint8_t* key,
+                          const void* data, uint16_t dataLen) {
+    uint32_t path[kBTMaxDepth];
+    int pathLen = 0;
+    uint16_t index;
+    bool exact;
+
+    uint8_t* record = sc->record;
+    uint16_t recordLen = build_record(key, data, dataLen, record);
+
+    /* Nodes for a split at every level and a new root, up front, so a
+     * split never stops half way for want of one */
+    if (!reserve_nodes(bt, bt->treeDepth + 1u)) return false;
+
+    if (bt->rootNode == 0) {
+        /* Empty tree: the record is the root leaf */
+        BTRecordRef ref = { record, recordLen };
+        uint32_t node;
+
+        if (!alloc_node(bt, sc, &node)) return false;
+        set_descriptor(sc->left, 0, 0, kBTLeafNode, 1);
+        if (!pack_node(bt, sc->left, &ref, 1) || !write_node(bt, node, sc->left)) return false;
+        bt->rootNode = bt->firstLeaf = bt->lastLeaf = node;
+        bt->treeDepth = 1;
+        bt->leafRecords++;
+        return true;
+    }
+
+    if (!seek_path(bt, key, sc->node, path, &pathLen, &index, &exact)) return false;
+    if (exact) return false;
+
+    for (int level = pathLen - 1; level >= 0; level--) {
+        uint32_t nodeNum = path[level];
+        HFS_BTNodeDesc* desc = (HFS_BTNodeDesc*)sc->node;
+        uint16_t count;
+
+        if (!gather_records(bt, sc->node, sc->refs, (uint16_t)(sc->maxRefs - 1), &count)) {
+            return false;
+        }
+        sc->refs[count].bytes = record;
+        sc->refs[count].length = recordLen;
+        count++;
+        sort_records(bt, sc->refs, count);
+
+        memcpy(sc->left, sc->node, sizeof(HFS_BTNodeDesc));
+        if (pack_node(bt, sc->left, sc->refs, count)) {
+            if (!write_node(bt, nodeNum, sc->left)) return false;
+            break;
+        }
+
+        /* Split: the upper half goes to a new right sibling */
+        uint16_t split = choose_split(bt, sc->refs, count);
+        uint32_t sibling;
+        uint32_t next = be32_read(&desc->fLink);
+        uint8_t height = desc->height;
+
+        if (split == 0 || !alloc_node(bt, sc, &sibling)) return false;
+
+        set_descriptor(sc->right, next, nodeNum, desc->kind, height);
+        be32_write(&((HFS_BTNodeDesc*)sc->left)->fLink, sibling);
+        if (!pack_node(bt, sc->left, sc->refs, split) ||
+            !pack_node(bt, sc->right, sc->refs + split, (uint16_t)(count - split))) {
+            return false;
+        }
+        if (next != 0) {
+            if (!HFS_BT_ReadNode(bt, next, sc->aux)) return false;
+            be32_write(&((HFS_BTNodeDesc*)sc->aux)->bLink, sibling);
+            if (!write_node(bt, next, sc->aux)) return false;
+        }
+        if (desc->kind == kBTLeafNode && bt->lastLeaf == nodeNum) {
+            bt->lastLeaf = sibling;
+        }
+        if (!write_node(bt, nodeNum, sc->left) || !write_node(bt, sibling, sc->right)) {
+            return false;
+        }
+
+        /* The sibling's first key goes up a level */
+        recordLen = build_index_record(bt, sc->right + node_offset(bt, sc->right, 0),
+                                       sibling, sc->up);
+        record = sc->up;
+
+        if (level == 0) {
+            /* The root split: a new root over the two halves */
+            BTRecordRef refs[2];
+            uint32_t root;
+
+            if (!alloc_node(bt, sc, &root)) return false;
+            refs[0].bytes = sc->record;
+            refs[0].length = build_index_record(bt, sc->left + node_offset(bt, sc->left, 0),
+                                                nodeNum, sc->record);
+            refs[1].bytes = sc->up;
+            refs[1].length = recordLen;
+            set_descriptor(sc->node, 0, 0, kBTIndexNode, (uint8_t)(height + 1));
+            if (!pack_node(bt, sc->node, refs, 2) || !write_node(bt, root, sc->node)) {
+                return false;
+            }
+            bt->rootNode = root;
+            bt->treeDepth++;
+            break;
+        }
+
+        if (!HFS_BT_ReadNode(bt, path[level - 1], sc->node)) return false;
+    }
+
+    bt->leafRecords++;
+    return true;
+}
+
+static bool delete_record(HFS_BTree* bt, BTScratch* sc, const uint8_t* key) {
+    uint32_t path[kBTMaxDepth];
+    int pathLen = 0;
+    uint16_t drop;
+    bool exact;
+
+    if (!seek_path(bt, key, sc->node, path, &pathLen, &drop, &exact) || !exact) return false;
+
+    for (int level = pathLen - 1; level >= 0; level--) {
+        uint32_t nodeNum = path[level];
+        HFS_BTNodeDesc* desc = (HFS_BTNodeDesc*)sc->node;
+        uint16_t count;
+
+        if (!gather_records(bt, sc->node, sc->refs, sc->maxRefs, &count) || drop >= count) {
+            return false;
+        }
+        memmove(&sc->refs[drop], &sc->refs[drop + 1], (count - drop - 1) * sizeof(BTRecordRef));
+        count--;
+
+        if (count > 0) {
+            sort_records(bt, sc->refs, count);
+            memcpy(sc->left, sc->node, sizeof(HFS_BTNodeDesc));
+            if (!pack_node(bt, sc->left, sc->refs, count) || !write_node(bt, nodeNum, sc->left)) {
+                return false;
+            }
+            break;
+        }
+
+        /* The node is empty: unlink it from its level */
+        uint32_t prev = be32_read(&desc->bLink);
+        uint32_t next = be32_read(&desc->fLink);
+        if (prev != 0) {
+            if (!HFS_BT_ReadNode(bt, prev, sc->aux)) return false;
+            be32_write(&((HFS_BTNodeDesc*)sc->aux)->fLink, next);
+            if (!write_node(bt, prev, sc->aux)) return false;
+        }
+        if (next != 0) {
+            if (!HFS_BT_ReadNode(bt, next, sc->aux)) return false;
+            be32_write(&((HFS_BTNodeDesc*)sc->aux)->bLink, prev);
+            if (!write_node(bt, next, sc->aux)) return false;
+        }
+        if (desc->kind == kBTLeafNode) {
+            if (bt->firstLeaf == nodeNum) bt->firstLeaf = next;
+            if (bt->lastLeaf == nodeNum) bt->lastLeaf = prev;
+        }
+        if (!free_node(bt, sc, nodeNum)) return false;
+
+        if (level == 0) {
+            /* That was the root: the tree is empty */
+            bt->rootNode = bt->firstLeaf = bt->lastLeaf = 0;
+            bt->treeDepth = 0;
+            break;
+        }
+
+        /* ...and take its record out of the parent */
+        if (!HFS_BT_ReadNode(bt, path[level - 1], sc->node) ||
+            !gather_records(bt, sc->node, sc->refs, sc->maxRefs, &count)) {
+            return false;
+        }
+        for (drop = 0; drop < count && index_child(sc->refs[drop].bytes) != nodeNum; drop++) {
+        }
+        if (drop == count) return false;
+    }
+
+    if (bt->leafRecords > 0) bt->leafRecords--;
+
+    /* An index root with one child is a level too many */
+    while (bt->treeDepth > 1) {
+        void* record;
+        uint16_t recordLen;
+
+        if (!HFS_BT_ReadNode(bt, bt->rootNode, sc->node)) return false;
+        HFS_BTNodeDesc* desc = (HFS_BTNodeDesc*)sc->node;
+        if (desc->kind != kBTIndexNode || be16_read(&desc->numRecords) != 1 ||
+            !HFS_BT_GetRecord(sc->node, bt->nodeSize, 0, &record, &recordLen)) {
+            break;
+        }
+        uint32_t child = index_child((uint8_t*)record);
+        if (!free_node(bt, sc, bt->rootNode)) return false;
+        bt->rootNode = child;
+        bt->treeDepth--;
+    }
+    return true;
+}
+
+/* Rewrite the record under key with new data; *fits is false if the node
+ * has no room for it, which leaves the tree untouched */
+static bool replace_record(HFS_BTree* bt, BTScratch* sc, const uint8_t* key,
+                           const void* data, uint16_t dataLen, bool* fits) {
+    uint32_t path[kBTMaxDepth];
+    int pathLen = 0;
+    uint16_t index;
+    bool exact;
+    uint16_t count;
+
+    *fits = true;
+    if (!seek_path(bt, key, sc->node, path, &pathLen, &index, &exact) || !exact) return false;
+    if (!gather_records(bt, sc->node, sc->refs, sc->maxRefs, &count) || index >= count) {
+        return false;
+    }
+
+    /* Filed under the caller's key, which compares equal to the one there:
+     * the record keeps its place, and a name whose case changed takes the
+     * new spelling. Index keys above it keep the old one, which the
+     * case-insensitive compare does not mind. */
+    sc->refs[index].bytes = sc->record;
+    sc->refs[index].length = build_record(key, data, dataLen, sc->record);
+    sort_records(bt, sc->refs, count);
+
+    memcpy(sc->left, sc->node, sizeof(HFS_BTNodeDesc));
+    if (!pack_node(bt, sc->left, sc->refs, count)) {
+        *fits = false;
+        return false;
+    }
+    return write_node(bt, path[pathLen - 1], sc->left);
+}
+
+/* Largest record that still leaves a split able to put two in a node */
+static bool record_fits(const HFS_BTree* bt, const uint8_t* key, uint16_t dataLen) {
+    uint32_t length = 1u + key[0] + 1u + dataLen;
+    return length <= (bt->nodeSize - sizeof(HFS_BTNodeDesc) - 6u) / 2;
+}
+
+bool HFS_BT_InsertRecord(HFS_BTree* bt, const void* key, const void* data, uint16_t dataLen) {
+    BTScratch sc;
+
+    if (!bt || !key || (!data && dataLen) || !bt->nodeBuffer) return false;
+    if (!record_fits(bt, (const uint8_t*)key, dataLen)) return false;
+    if (!scratch_open(bt, &sc)) return false;
+
+    bool ok = prepare_write(bt, &sc) && insert_record(bt, &sc, (const uint8_t*)key, data, dataLen);
+    if (bt->writeReady && !write_header(bt, sc.aux)) ok = false;
+
+    scratch_close(&sc);
+    return ok;
+}
+
+bool HFS_BT_DeleteRecord(HFS_BTree* bt, const void* key) {
+    BTScratch sc;
+
+    if (!bt || !key || !bt->nodeBuffer) return false;
+    if (!scratch_open(bt, &sc)) return false;
+
+    bool ok = prepare_write(bt, &sc) && delete_record(bt, &sc, (const uint8_t*)key);
+    if (bt->writeReady && !write_header(bt, sc.aux)) ok = false;
+
+    scratch_close(&sc);
+    return ok;
+}
+
+bool HFS_BT_ReplaceRecord(HFS_BTree* bt, const void* key, const void* data, uint16_t dataLen) {
+    BTScratch sc;
+    bool fits = true;
+
+    if (!bt || !key || (!data && dataLen) || !bt->nodeBuffer) return false;
+    if (!record_fits(bt, (const uint8_t*)key, dataLen)) return false;
+    if (!scratch_open(bt, &sc)) return false;
+
+    bool ok = prepare_write(bt, &sc) &&
+              replace_record(bt, &sc, (const uint8_t*)key, data, dataLen, &fits);
+    if (!ok && !fits) {
+        /* Grown past what its node can hold: file it again, splitting.
+         * The nodes the insert needs are found before the old record goes. */
+        ok = reserve_nodes(bt, bt->treeDepth + 1u) &&
+             delete_record(bt, &sc, (const uint8_t*)key) &&
+             insert_record(bt, &sc, (const uint8_t*)key, data, dataLen);
+    }
+    if (bt->writeReady && !write_header(bt, sc.aux)) ok = false;
+
+    scratch_close(&sc);
+    return ok;
+}
+
 int HFS_CompareCatalogKeys(const void* key1, const void* key2) {
     const HFS_CatKey* k1 = (const HFS_CatKey*)key1;
     const HFS_CatKey* k2 = (const HFS_CatKey*)key2;
@@ -287,28 +1160,33 @@ int HFS_CompareCatalogKeys(const void* key1, const void* key2) {
     return 0;  /* Identical */
 }
 
+/*
+ * Extents key: length byte (7), fork type (0x00 data, 0xFF resource), file
+ * number, and the first file allocation block the record maps. This read
+ * the file number from the length byte onward, which only went unnoticed
+ * because nothing had ever searched the extents tree.
+ */
 int HFS_CompareExtentsKeys(const void* key1, const void* key2) {
-    /* Extents key: fileID + forkType + startBlock */
     const uint8_t* k1 = (const uint8_t*)key1;
     const uint8_t* k2 = (const uint8_t*)key2;
 
-    /* Compare file ID (4 bytes) */
-    uint32_t fid1 = be32_read(k1);
-    uint32_t fid2 = be32_read(k2);
+    /* File number first */
+    uint32_t fid1 = be32_read(k1 + 2);
+    uint32_t fid2 = be32_read(k2 + 2);
 
     if (fid1 < fid2) return -1;
     if (fid1 > fid2) return 1;
 
-    /* Compare fork type (1 byte) */
-    if (k1[4] < k2[4]) return -1;
-    if (k1[4] > k2[4]) return 1;
+    /* Then fork */
+    if (k1[1] < k2[1]) return -1;
+    if (k1[1] > k2[1]) return 1;
 
-    /* Compare start block (2 bytes) */
-    uint16_t sb1 = be16_read(k1 + 5);
-    uint16_t sb2 = be16_read(k2 + 5);
+    /* Then start block */
+    uint16_t sb1 = be16_read(k1 + 6);
+    uint16_t sb2 = be16_read(k2 + 6);
 
     if (sb1 < sb2) return -1;
     if (sb1 > sb2) return 1;
 
     return 0;
-}
\ No newline at end of file
+}
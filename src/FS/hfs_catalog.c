@@ -77,7 +77,12 @@ bool HFS_ParseCatalogRecord(const HFS_CatKey* key, const void* data, uint16_t da
         const HFS_CatFileRec* file = (const HFS_CatFileRec*)data;
         entry->kind = kNodeFile;
         entry->id = be32_read(&file->fileID);
-        entry->flags = file->flags;
+        /* Finder flags are in the FInfo; records written before they were
+         * kept there have only the File Manager's flags byte */
+        entry->flags = be16_read(&file->finderInfo[8]);
+        if (entry->flags == 0) {
+            entry->flags = file->flags;
+        }
         entry->modTime = be32_read(&file->modifyDate);
         entry->createTime = be32_read(&file->createDate);
         entry->size = be32_read(&file->dataLogicalSize);
@@ -183,6 +188,69 @@ void HFS_CatalogClose(HFS_Catalog* cat) {
     memset(cat, 0, sizeof(HFS_Catalog));
 }
 
+/* Build the catalog key for (parentID, name); name is raw MacRoman */
+static void make_catalog_key(HFS_CatKey* key, DirID parentID, const uint8_t* name, size_t len) {
+    if (len > 31) len = 31;
+    memset(key, 0, sizeof(HFS_CatKey));
+    key->keyLength = 6 + len;  /* 1 + 1 + 4 + 1 + nameLen - 1 */
+    be32_write(&key->parentID, parentID);
+    key->nameLength = len;
+    if (len) memcpy(key->name, name, len);
+}
+
+/*
+ * Call func for every record filed under parentID, in key order. The
+ * catalog is sorted by parent first, so a directory's records are one run:
+ * seek to (parentID, "") - where its thread record sits - and walk leaves
+ * forward until the parent changes. Only the directory's own leaves are
+ * read, not the whole tree.
+ */
+static bool walk_directory(HFS_Catalog* cat, DirID parentID,
+                           HFS_BT_IteratorFunc func, void* context) {
+    HFS_BTree* bt = &cat->bt;
+    HFS_CatKey first;
+    uint32_t node;
+    uint16_t index;
+    bool exact;
+
+    if (!bt->nodeBuffer) return false;
+    if (bt->rootNode == 0) return true;     /* empty catalog */
+
+    make_catalog_key(&first, parentID, NULL, 0);
+    if (!HFS_BT_Seek(bt, &first, bt->nodeBuffer, &node, &index, &exact)) {
+        return false;
+    }
+
+    for (;;) {
+        HFS_BTNodeDesc* nodeDesc = (HFS_BTNodeDesc*)bt->nodeBuffer;
+        uint16_t numRecords = be16_read(&nodeDesc->numRecords);
+
+        for (; index < numRecords; index++) {
+            void* record;
+            uint16_t recordLen;
+            void* data;
+            uint16_t dataLen;
+
+            if (!HFS_BT_GetRecord(bt->nodeBuffer, bt->nodeSize, index, &record, &recordLen) ||
+                !HFS_BT_SplitRecord(bt, record, recordLen, &data, &dataLen)) {
+                continue;
+            }
+
+            HFS_CatKey* key = (HFS_CatKey*)record;
+            uint32_t entryParent = be32_read(&key->parentID);
+            if (entryParent > parentID) return true;     /* past the directory */
+            if (entryParent < parentID) continue;
+
+            if (!func(key, key->keyLength, data, dataLen, context)) return true;
+        }
+
+        node = be32_read(&nodeDesc->fLink);
+        if (node == 0) return true;
+        if (!HFS_BT_ReadNode(bt, node, bt->nodeBuffer)) return false;
+        index = 0;
+    }
+}
+
 bool HFS_CatalogEnumerate(HFS_Catalog* cat, DirID parentID,
                          CatEntry* entries, int maxEntries, int* count) {
 
@@ -200,69 +268,102 @@ bool HFS_CatalogEnumerate(HFS_Catalog* cat, DirID parentID,
         .count = 0
     };
 
-    FS_LOG_DEBUG("HFS_CatalogEnumerate: Calling HFS_BT_IterateLeaves, firstLeaf=%d\n",
-                 (int)cat->bt.firstLeaf);
+    /* Just this directory's run of leaf records */
+    bool result = walk_directory(cat, parentID, enum_callback, &ctx);
 
-    /* Iterate through all leaf nodes */
-    bool result = HFS_BT_IterateLeaves(&cat->bt, enum_callback, &ctx);
-
-    FS_LOG_DEBUG("HFS_CatalogEnumerate: IterateLeaves returned %d, found %d entries\n",
+    FS_LOG_DEBUG("HFS_CatalogEnumerate: walk returned %d, found %d entries\n",
                  result, ctx.count);
 
     *count = ctx.count;
     return result;
 }
 
+/* Name lookup context (slow path) */
+typedef struct {
+    const char* name;
+    size_t      len;
+    CatEntry*   result;
+    bool        found;
+} LookupContext;
+
+/* Compare the ASCII rendering of each name, as callers see it */
+static bool lookup_callback(void* keyPtr, uint16_t keyLen,
+                            void* dataPtr, uint16_t dataLen,
+                            void* context) {
+    LookupContext* ctx = (LookupContext*)context;
+    CatEntry entry;
+
+    if (!HFS_ParseCatalogRecord((HFS_CatKey*)keyPtr, dataPtr, dataLen, &entry)) {
+        return true;  /* Thread record */
+    }
+
+    /* Verify entry name length matches before comparing */
+    if (strlen(entry.name) != ctx->len) return true;
+
+    for (size_t j = 0; j < ctx->len; j++) {
+        char c1 = entry.name[j];
+        char c2 = ctx->name[j];
+        if (c1 >= 'a' && c1 <= 'z') c1 -= 32;
+        if (c2 >= 'a' && c2 <= 'z') c2 -= 32;
+        if (c1 != c2) return true;
+    }
+
+    *ctx->result = entry;
+    ctx->found = true;
+    return false;  /* Stop */
+}
+
+/* Exact-key fetch: the record filed under key, split into its data */
+static bool find_record(HFS_Catalog* cat, const HFS_CatKey* key,
+                        HFS_CatKey** foundKey, void** data, uint16_t* dataLen) {
+    HFS_BTree* bt = &cat->bt;
+    uint32_t node;
+    uint16_t index;
+    bool exact;
+    void* record;
+    uint16_t recordLen;
+
+    if (!bt->nodeBuffer) return false;
+    if (!HFS_BT_Seek(bt, key, bt->nodeBuffer, &node, &index, &exact) || !exact) {
+        return false;
+    }
+    if (!HFS_BT_GetRecord(bt->nodeBuffer, bt->nodeSize, index, &record, &recordLen) ||
+        !HFS_BT_SplitRecord(bt, record, recordLen, data, dataLen)) {
+        return false;
+    }
+    *foundKey = (HFS_CatKey*)record;
+    return true;
+}
+
 bool HFS_CatalogLookup(HFS_Catalog* cat, DirID parentID, const char* name,
                        CatEntry* entry) {
     if (!cat || !name || !entry) return false;
 
-    /* Convert name to MacRoman Pascal string */
-    uint8_t pname[32];
     size_t len = strlen(name);
     if (len > 31) len = 31;
-    pname[0] = len;
-    memcpy(pname + 1, name, len);
 
-    /* Build catalog key */
+    /* Fast path: descend straight to the key (parentID, name) */
     HFS_CatKey searchKey;
-    searchKey.keyLength = 6 + len;  /* 1 + 1 + 4 + 1 + nameLen - 1 */
-    searchKey.reserved = 0;
-    be32_write(&searchKey.parentID, parentID);
-    searchKey.nameLength = len;
-    memcpy(searchKey.name, pname + 1, len);
-
-    /* Linear search through leaves (simple implementation) */
-    CatEntry entries[100];
-    int count;
-    if (!HFS_CatalogEnumerate(cat, parentID, entries, 100, &count)) {
-        return false;
-    }
+    HFS_CatKey* key;
+    void* data;
+    uint16_t dataLen;
 
-    /* Find matching name (case-insensitive) */
-    for (int i = 0; i < count; i++) {
-        /* Verify entry name length matches before comparing */
-        size_t entryLen = strlen(entries[i].name);
-        if (entryLen != len) continue;
-
-        bool match = true;
-        for (size_t j = 0; j < len; j++) {
-            char c1 = entries[i].name[j];
-            char c2 = name[j];
-            if (c1 >= 'a' && c1 <= 'z') c1 -= 32;
-            if (c2 >= 'a' && c2 <= 'z') c2 -= 32;
-            if (c1 != c2) {
-                match = false;
-                break;
-            }
-        }
-        if (match) {
-            *entry = entries[i];
-            return true;
-        }
+    make_catalog_key(&searchKey, parentID, (const uint8_t*)name, len);
+    if (find_record(cat, &searchKey, &key, &data, &dataLen) &&
+        HFS_ParseCatalogRecord(key, data, dataLen, entry)) {
+        return true;
     }
 
-    return false;
+    /*
+     * Callers name entries the way HFS_CatalogEnumerate showed them, with
+     * MacRoman accents folded to plain ASCII ("Cafe" for a file whose
+     * name has an e-acute), and such a name does not sort where the real
+     * one does. So a miss is retried against the ASCII rendering of each
+     * name in the directory - its own leaves only, not the catalog.
+     */
+    LookupContext ctx = { .name = name, .len = len, .result = entry, .found = false };
+    walk_directory(cat, parentID, lookup_callback, &ctx);
+    return ctx.found;
 }
 
 /* Get by ID context */
@@ -295,17 +396,424 @@ static bool getbyid_callback(void* keyPtr, uint16_t keyLen,
     return true;  /* Continue */
 }
 
+/*
+ * Every file and folder with a thread has a thread record filed under
+ * (cnid, ""), naming its parent and its name - the key of the record
+ * itself. Two descents find anything by ID. Folders always have threads;
+ * files have them when the Finder or File Manager made one.
+ */
+static bool find_by_thread(HFS_Catalog* cat, FileID cnid,
+                           HFS_CatKey** foundKey, void** data, uint16_t* dataLen) {
+    HFS_CatKey threadKey;
+    HFS_CatKey* key;
+    void* threadData;
+    uint16_t threadLen;
+
+    make_catalog_key(&threadKey, cnid, NULL, 0);
+    if (!find_record(cat, &threadKey, &key, &threadData, &threadLen)) return false;
+    if (threadLen < sizeof(HFS_CatThreadRec) - 31) return false;
+
+    const HFS_CatThreadRec* thread = (const HFS_CatThreadRec*)threadData;
+    uint16_t recordType = be16_read(&thread->recordType);
+    if (recordType != kHFS_FolderThreadRecord && recordType != kHFS_FileThreadRecord) {
+        return false;
+    }
+
+    /* Copy out before the second descent reuses the node buffer */
+    HFS_CatKey recordKey;
+    make_catalog_key(&recordKey, be32_read(&thread->parentID), thread->name,
+                     thread->nameLength);
+    return find_record(cat, &recordKey, foundKey, data, dataLen);
+}
+
 bool HFS_CatalogGetByID(HFS_Catalog* cat, FileID cnid, CatEntry* entry) {
     if (!cat || !entry || cnid < HFS_FIRST_CNID) return false;
 
+    HFS_CatKey* key;
+    void* data;
+    uint16_t dataLen;
+
+    if (find_by_thread(cat, cnid, &key, &data, &dataLen) &&
+        HFS_ParseCatalogRecord(key, data, dataLen, entry) && entry->id == cnid) {
+        return true;
+    }
+
+    /* No thread record (HFS_CreateBlankVolume writes none): search the leaves */
     GetByIDContext ctx = {
         .targetID = cnid,
         .result = entry,
         .found = false
     };
 
-    /* Iterate through all leaf nodes looking for our ID */
     HFS_BT_IterateLeaves(&cat->bt, getbyid_callback, &ctx);
 
     return ctx.found;
-}
\ No newline at end of file
+}
+
+bool HFS_CatalogGetRecord(HFS_Catalog* cat, FileID cnid, void* record, uint16_t size) {
+    if (!cat || !record || cnid < HFS_FIRST_CNID) return false;
+
+    HFS_CatKey* key;
+    void* data;
+    uint16_t dataLen;
+
+    if (!find_by_thread(cat, cnid, &key, &data, &dataLen)) return false;
+
+    memset(record, 0, size);
+    memcpy(record, data, dataLen < size ? dataLen : size);
+    return true;
+}
+
+/*
+ * Writing
+ *
+ * Every file and folder created here gets a thread record, so
+ * HFS_CatalogGetByID finds it in two descents; the leaf scan below is for
+ * the records HFS_CreateBlankVolume wrote without one. The parent's
+ * valence and the MDB's file and folder counts are kept as the File
+ * Manager keeps them. The root has no folder record on volumes
+ * HFS_CreateBlankVolume builds, so a missing root record is not an error.
+ */
+
+/* Room for the largest catalog data record */
+#define kCatRecordMax   128
+
+static uint32_t catalog_now(void) {
+    extern void GetDateTime(uint32_t* secs);
+    uint32_t now = 0;
+    GetDateTime(&now);
+    return now;
+}
+
+/* The CNID a file or folder record describes; 0 for anything else */
+static FileID record_cnid(const void* data, uint16_t dataLen) {
+    uint16_t recordType = be16_read(data);
+
+    if (recordType == kHFS_FileRecord && dataLen >= sizeof(HFS_CatFileRec)) {
+        return be32_read(&((const HFS_CatFileRec*)data)->fileID);
+    }
+    if (recordType == kHFS_FolderRecord && dataLen >= sizeof(HFS_CatFolderRec)) {
+        return be32_read(&((const HFS_CatFolderRec*)data)->folderID);
+    }
+    return 0;
+}
+
+/* Leaf scan for a record by CNID, copying out its key and data */
+typedef struct {
+    FileID      target;
+    HFS_CatKey* key;
+    uint8_t*    record;
+    uint16_t*   recordLen;
+    bool        found;
+} FindKeyContext;
+
+static void copy_key_and_data(HFS_CatKey* key, const HFS_CatKey* foundKey,
+                              uint8_t* record, uint16_t* recordLen,
+                              const void* data, uint16_t dataLen) {
+    uint16_t keyBytes = 1 + foundKey->keyLength;
+
+    memset(key, 0, sizeof(HFS_CatKey));
+    memcpy(key, foundKey, keyBytes < sizeof(HFS_CatKey) ? keyBytes : sizeof(HFS_CatKey));
+    key->keyLength = 6 + key->nameLength;
+
+    *recordLen = (dataLen < kCatRecordMax) ? dataLen : kCatRecordMax;
+    memset(record, 0, kCatRecordMax);
+    memcpy(record, data, *recordLen);
+}
+
+static bool find_key_callback(void* keyPtr, uint16_t keyLen,
+                              void* dataPtr, uint16_t dataLen,
+                              void* context) {
+    FindKeyContext* ctx = (FindKeyContext*)context;
+    (void)keyLen;
+
+    if (record_cnid(dataPtr, dataLen) != ctx->target) return true;
+
+    copy_key_and_data(ctx->key, (HFS_CatKey*)keyPtr, ctx->record, ctx->recordLen,
+                      dataPtr, dataLen);
+    ctx->found = true;
+    return false;
+}
+
+/* The key and record of cnid, through its thread or by a leaf scan.
+ * record must hold kCatRecordMax bytes. */
+static bool find_key_by_id(HFS_Catalog* cat, FileID cnid,
+                           HFS_CatKey* key, uint8_t* record, uint16_t* recordLen) {
+    HFS_CatKey* foundKey;
+    void* data;
+    uint16_t dataLen;
+
+    if (find_by_thread(cat, cnid, &foundKey, &data, &dataLen) &&
+        record_cnid(data, dataLen) == cnid) {
+        copy_key_and_data(key, foundKey, record, recordLen, data, dataLen);
+        return true;
+    }
+
+    FindKeyContext ctx = { .target = cnid, .key = key, .record = record,
+                           .recordLen = recordLen, .found = false };
+    HFS_BT_IterateLeaves(&cat->bt, find_key_callback, &ctx);
+    return ctx.found;
+}
+
+static bool is_folder(HFS_Catalog* cat, DirID id) {
+    HFS_CatKey key;
+    uint8_t record[kCatRecordMax];
+    uint16_t recordLen;
+
+    if (find_key_by_id(cat, id, &key, record, &recordLen)) {
+        return be16_read(record) == kHFS_FolderRecord;
+    }
+    return id == cat->vol->rootDirID;
+}
+
+/* One more or one fewer item in folder */
+static bool adjust_valence(HFS_Catalog* cat, DirID folder, bool added) {
+    HFS_CatKey key;
+    uint8_t record[kCatRecordMax];
+    uint16_t recordLen;
+
+    if (!find_key_by_id(cat, folder, &key, record, &recordLen)) {
+        return folder == cat->vol->rootDirID;
+    }
+    if (be16_read(record) != kHFS_FolderRecord) return false;
+
+    HFS_CatFolderRec* rec = (HFS_CatFolderRec*)record;
+    uint16_t valence = be16_read(&rec->valence);
+    if (added) {
+        valence++;
+    } else if (valence > 0) {
+        valence--;
+    }
+    be16_write(&rec->valence, valence);
+
+    uint32_t now = catalog_now();
+    if (now != 0) be32_write(&rec->modifyDate, now);
+
+    return HFS_BT_ReplaceRecord(&cat->bt, &key, record, sizeof(HFS_CatFolderRec));
+}
+
+static void count_entry(HFS_Catalog* cat, bool folder, DirID parent, bool added) {
+    HFS_MDB* mdb = &cat->vol->mdb;
+    bool inRoot = (parent == cat->vol->rootDirID);
+
+#define COUNT(field) (mdb->field = added ? mdb->field + 1 : (mdb->field ? mdb->field - 1 : 0))
+    if (folder) {
+        COUNT(drDirCnt);
+        if (inRoot) COUNT(drNmRtDirs);
+    } else {
+        COUNT(drFilCnt);
+        if (inRoot) COUNT(drNmFls);
+    }
+#undef COUNT
+    cat->vol->mdbDirty = true;
+}
+
+/* The thread record for cnid: it names the key of the record itself */
+static bool put_thread(HFS_Catalog* cat, FileID cnid, bool folder, const HFS_CatKey* recordKey) {
+    HFS_CatKey threadKey;
+    HFS_CatThreadRec thread;
+
+    memset(&thread, 0, sizeof(thread));
+    be16_write(&thread.recordType, folder ? kHFS_FolderThreadRecord : kHFS_FileThreadRecord);
+    be32_write(&thread.parentID, be32_read(&recordKey->parentID));
+    thread.nameLength = recordKey->nameLength;
+    memcpy(thread.name, recordKey->name, recordKey->nameLength);
+
+    make_catalog_key(&threadKey, cnid, NULL, 0);
+    return HFS_BT_ReplaceRecord(&cat->bt, &threadKey, &thread, sizeof(thread)) ||
+           HFS_BT_InsertRecord(&cat->bt, &threadKey, &thread, sizeof(thread));
+}
+
+static void set_file_flags(HFS_CatFileRec* rec, uint16_t flags) {
+    /* Finder flags live in the FInfo, after type and creator; the record's
+     * own flags byte is the File Manager's (locked, and so on) */
+    be16_write(&rec->finderInfo[8], flags);
+}
+
+bool HFS_CatalogCreate(HFS_Catalog* cat, const CatEntry* entry) {
+    if (!cat || !entry || !cat->bt.nodeBuffer || entry->id < HFS_FIRST_CNID) return false;
+
+    size_t len = strlen(entry->name);
+    if (len == 0 || len > 31) return false;
+    if (!is_folder(cat, entry->parent)) return false;
+
+    bool folder = (entry->kind == kNodeDir);
+    uint8_t record[kCatRecordMax];
+    uint16_t recordLen;
+    HFS_CatKey key;
+
+    memset(record, 0, sizeof(record));
+    if (folder) {
+        HFS_CatFolderRec* rec = (HFS_CatFolderRec*)record;
+        be16_write(&rec->recordType, kHFS_FolderRecord);
+        be16_write(&rec->flags, entry->flags);
+        be32_write(&rec->folderID, entry->id);
+        be32_write(&rec->createDate, entry->createTime);
+        be32_write(&rec->modifyDate, entry->modTime);
+        recordLen = sizeof(HFS_CatFolderRec);
+    } else {
+        HFS_CatFileRec* rec = (HFS_CatFileRec*)record;
+        be16_write(&rec->recordType, kHFS_FileRecord);
+        be32_write(&rec->fileID, entry->id);
+        be32_write(&rec->createDate, entry->createTime);
+        be32_write(&rec->modifyDate, entry->modTime);
+        be32_write(&rec->finderInfo[0], entry->type);
+        be32_write(&rec->finderInfo[4], entry->creator);
+        set_file_flags(rec, entry->flags);
+        recordLen = sizeof(HFS_CatFileRec);
+    }
+
+    make_catalog_key(&key, entry->parent, (const uint8_t*)entry->name, len);
+    if (!HFS_BT_InsertRecord(&cat->bt, &key, record, recordLen)) return false;
+    if (!put_thread(cat, entry->id, folder, &key)) {
+        HFS_BT_DeleteRecord(&cat->bt, &key);
+        return false;
+    }
+
+    adjust_valence(cat, entry->parent, true);
+    count_entry(cat, folder, entry->parent, true);
+    if (entry->id >= cat->vol->nextCNID) {
+        cat->vol->nextCNID = entry->id + 1;
+    }
+    return true;
+}
+
+/* Stops at the first file or folder record */
+static bool any_child_callback(void* keyPtr, uint16_t keyLen,
+                               void* dataPtr, uint16_t dataLen,
+                               void* context) {
+    (void)keyPtr;
+    (void)keyLen;
+    if (record_cnid(dataPtr, dataLen) == 0) return true;
+    *(bool*)context = true;
+    return false;
+}
+
+bool HFS_CatalogDelete(HFS_Catalog* cat, FileID cnid) {
+    HFS_CatKey key;
+    HFS_CatKey threadKey;
+    uint8_t record[kCatRecordMax];
+    uint16_t recordLen;
+
+    if (!cat || !cat->bt.nodeBuffer || cnid < HFS_FIRST_CNID) return false;
+    if (!find_key_by_id(cat, cnid, &key, record, &recordLen)) return false;
+
+    bool folder = (be16_read(record) == kHFS_FolderRecord);
+    if (folder) {
+        bool hasChildren = false;
+        walk_directory(cat, cnid, any_child_callback, &hasChildren);
+        if (hasChildren) return false;
+    }
+
+    if (!HFS_BT_DeleteRecord(&cat->bt, &key)) return false;
+    make_catalog_key(&threadKey, cnid, NULL, 0);
+    HFS_BT_DeleteRecord(&cat->bt, &threadKey);
+
+    DirID parent = be32_read(&key.parentID);
+    adjust_valence(cat, parent, false);
+    count_entry(cat, folder, parent, false);
+    return true;
+}
+
+/* Is folder dir inside cnid, or cnid itself? Walks up through the threads. */
+static bool is_within(HFS_Catalog* cat, DirID dir, FileID cnid) {
+    for (int depth = 0; depth < 64 && dir >= HFS_FIRST_CNID; depth++) {
+        HFS_CatKey key;
+        uint8_t record[kCatRecordMax];
+        uint16_t recordLen;
+
+        if (dir == cnid) return true;
+        if (!find_key_by_id(cat, dir, &key, record, &recordLen)) return false;
+        dir = be32_read(&key.parentID);
+    }
+    return false;
+}
+
+bool HFS_CatalogMove(HFS_Catalog* cat, FileID cnid, DirID newParent, const char* newName) {
+    HFS_CatKey oldKey;
+    HFS_CatKey newKey;
+    uint8_t record[kCatRecordMax];
+    uint16_t recordLen;
+
+    if (!cat || !cat->bt.nodeBuffer || cnid < HFS_FIRST_CNID) return false;
+    if (!find_key_by_id(cat, cnid, &oldKey, record, &recordLen)) return false;
+
+    bool folder = (be16_read(record) == kHFS_FolderRecord);
+    DirID oldParent = be32_read(&oldKey.parentID);
+
+    if (newName) {
+        size_t len = strlen(newName);
+        if (len == 0 || len > 31) return false;
+        make_catalog_key(&newKey, newParent, (const uint8_t*)newName, len);
+    } else {
+        make_catalog_key(&newKey, newParent, oldKey.name, oldKey.nameLength);
+    }
+
+    if (newParent != oldParent) {
+        if (!is_folder(cat, newParent)) return false;
+        if (folder && is_within(cat, newParent, cnid)) return false;
+    }
+
+    if (HFS_CompareCatalogKeys(&oldKey, &newKey) == 0) {
+        /* Only the case of the name changes: the same key, so it cannot
+         * be filed twice - rewrite the record where it is, new spelling
+         * and all. Nothing moves, so this needs no free node. */
+        if (memcmp(oldKey.name, newKey.name, oldKey.nameLength) == 0) return true;
+        if (!HFS_BT_ReplaceRecord(&cat->bt, &newKey, record, recordLen)) return false;
+    } else {
+        /* In under the new key first: false if the name is taken */
+        if (!HFS_BT_InsertRecord(&cat->bt, &newKey, record, recordLen)) return false;
+        if (!HFS_BT_DeleteRecord(&cat->bt, &oldKey)) {
+            HFS_BT_DeleteRecord(&cat->bt, &newKey);
+            return false;
+        }
+    }
+
+    put_thread(cat, cnid, folder, &newKey);
+
+    if (newParent != oldParent) {
+        adjust_valence(cat, oldParent, false);
+        adjust_valence(cat, newParent, true);
+        count_entry(cat, folder, oldParent, false);
+        count_entry(cat, folder, newParent, true);
+    }
+    return true;
+}
+
+bool HFS_CatalogSetInfo(HFS_Catalog* cat, const CatEntry* entry) {
+    HFS_CatKey key;
+    uint8_t record[kCatRecordMax];
+    uint16_t recordLen;
+
+    if (!cat || !entry || !cat->bt.nodeBuffer) return false;
+    if (!find_key_by_id(cat, entry->id, &key, record, &recordLen)) return false;
+
+    if (be16_read(record) == kHFS_FolderRecord) {
+        HFS_CatFolderRec* rec = (HFS_CatFolderRec*)record;
+        be16_write(&rec->flags, entry->flags);
+        be32_write(&rec->createDate, entry->createTime);
+        be32_write(&rec->modifyDate, entry->modTime);
+        recordLen = sizeof(HFS_CatFolderRec);
+    } else {
+        HFS_CatFileRec* rec = (HFS_CatFileRec*)record;
+        be32_write(&rec->finderInfo[0], entry->type);
+        be32_write(&rec->finderInfo[4], entry->creator);
+        set_file_flags(rec, entry->flags);
+        be32_write(&rec->createDate, entry->createTime);
+        be32_write(&rec->modifyDate, entry->modTime);
+        recordLen = sizeof(HFS_CatFileRec);
+    }
+    return HFS_BT_ReplaceRecord(&cat->bt, &key, record, recordLen);
+}
+
+bool HFS_CatalogPutRecord(HFS_Catalog* cat, FileID cnid, const void* record, uint16_t size) {
+    HFS_CatKey key;
+    uint8_t current[kCatRecordMax];
+    uint16_t currentLen;
+
+    if (!cat || !record || !cat->bt.nodeBuffer || size > kCatRecordMax) return false;
+    if (!find_key_by_id(cat, cnid, &key, current, &currentLen)) return false;
+    if (be16_read(current) != be16_read(record)) return false;
+
+    return HFS_BT_ReplaceRecord(&cat->bt, &key, record, size);
+}
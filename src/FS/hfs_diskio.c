@@ -180,224 +180,131 @@ bool HFS_BD_InitSDHCI(HFS_BlockDev* bd, int drive_index, bool readonly) {
     #endif
 }
 
-bool HFS_BD_Read(const HFS_BlockDev* bd, uint64_t offset, void* buffer, uint32_t length) {
-    if (!bd || !buffer) return false;
-    if (offset + length > bd->size) return false;
+/*
+ * Whole-sector transfers straight to or from the device: no staging
+ * buffer and no cache. The block cache (hfs_blockcache.c) is the only
+ * caller and always hands in whole-sector buffers of its own or, for long
+ * aligned runs, the caller's buffer itself.
+ */
+
+/* Some hal_storage ports report the number of blocks moved in an OSErr,
+ * so their transfers are issued in pieces of at most this many sectors.
+ * ATA takes a whole run at once: ATA_ReadSectors48 splits it into commands
+ * as large as the drive's transfer mode allows. */
+#define kHFSMaxSectorsPerCommand 255
+
+#if defined(__arm__) || defined(__aarch64__) || defined(HFS_DISABLE_ATA)
+/* arm64 returns the block count moved (or -1), arm returns noErr or an
+ * error code: only a negative result or a short count is a failure. */
+static bool hal_result_ok(OSErr err, uint32_t count) {
+    return err == 0 || (err > 0 && (uint32_t)err == count);
+}
+#endif
+
+bool HFS_BD_ReadSectors(const HFS_BlockDev* bd, uint64_t sector, uint32_t count, void* buffer) {
+    uint8_t* dst = (uint8_t*)buffer;
+
+    if (!bd || !buffer || bd->sectorSize == 0) return false;
 
 #if !defined(__arm__) && !defined(__aarch64__) && !defined(HFS_DISABLE_ATA)
     if (bd->type == HFS_BD_TYPE_ATA) {
-        /* ATA device - read sectors */
         ATADevice* ata_dev = ATA_GetDevice(bd->device_index);
         if (!ata_dev) return false;
 
-        /* Prevent division by zero */
-        if (bd->sectorSize == 0) {
-            return false;
-        }
-
-        /* Reject offsets that would overflow 32-bit sector math */
-        if (offset + length > (uint64_t)UINT32_MAX * bd->sectorSize) {
-            return false;  /* Offset too large */
-        }
-
-        /* Calculate sector alignment using 64-bit math, then truncate */
-        uint32_t start_sector = (uint32_t)(offset / bd->sectorSize);
-        uint32_t end_sector = (uint32_t)((offset + length + bd->sectorSize - 1) / bd->sectorSize);
-        uint32_t sector_count = end_sector - start_sector;
-
-        /* Allocate temporary buffer for sector-aligned read */
-        /* Check for integer overflow in multiplication */
-        if (sector_count > UINT32_MAX / bd->sectorSize) {
-            return false;  /* Overflow would occur */
-        }
-
-        uint8_t* temp_buffer = NewPtr(sector_count * bd->sectorSize);
-        if (!temp_buffer) return false;
-
-        /* Read sectors */
-        OSErr err = ATA_ReadSectors(ata_dev, start_sector, sector_count, temp_buffer);
-        if (err != noErr) {
-            DisposePtr((Ptr)temp_buffer);
-            return false;
-        }
-
-        /* Copy requested data from temp buffer */
-        uint32_t offset_in_sector = (uint32_t)offset % bd->sectorSize;
-        memcpy(buffer, temp_buffer + offset_in_sector, length);
-
-        DisposePtr((Ptr)temp_buffer);
-        return true;
-    } else
+        return ATA_ReadSectors48(ata_dev, sector, count, dst) == noErr;
+    }
 #endif
     if (bd->type == HFS_BD_TYPE_SDHCI) {
-        /* SDHCI SD card - read blocks via HAL */
         #if defined(__arm__) || defined(__aarch64__) || defined(HFS_DISABLE_ATA)
-
-        /* Prevent division by zero */
-        if (bd->sectorSize == 0) {
-            return false;
-        }
-
-        /* Reject offsets that would overflow 32-bit block math */
-        if (offset + length > (uint64_t)UINT32_MAX * bd->sectorSize) {
-            return false;  /* Offset too large */
-        }
-
-        /* Calculate block alignment using 64-bit math, then truncate */
-        uint32_t start_block = (uint32_t)(offset / bd->sectorSize);
-        uint32_t end_block = (uint32_t)((offset + length + bd->sectorSize - 1) / bd->sectorSize);
-        uint32_t block_count = end_block - start_block;
-
-        /* Allocate temporary buffer for block-aligned read */
-        /* Check for integer overflow in multiplication */
-        if (block_count > UINT32_MAX / bd->sectorSize) {
-            return false;  /* Overflow would occur */
-        }
-
-        uint8_t* temp_buffer = NewPtr(block_count * bd->sectorSize);
-        if (!temp_buffer) return false;
-
-        /* Read blocks via HAL storage interface */
-        OSErr err = hal_storage_read_blocks(bd->device_index, start_block, block_count, temp_buffer);
-        if (err != 0) {  /* noErr should be 0 */
-            DisposePtr((Ptr)temp_buffer);
-            return false;
+        while (count > 0) {
+            uint32_t n = count > kHFSMaxSectorsPerCommand ? kHFSMaxSectorsPerCommand : count;
+            if (!hal_result_ok(hal_storage_read_blocks(bd->device_index, sector, n, dst), n)) {
+                return false;
+            }
+            sector += n;
+            count -= n;
+            dst += n * bd->sectorSize;
         }
-
-        /* Copy requested data from temp buffer */
-        uint32_t offset_in_block = (uint32_t)offset % bd->sectorSize;
-        memcpy(buffer, temp_buffer + offset_in_block, length);
-
-        DisposePtr((Ptr)temp_buffer);
         return true;
-        #else
-        return false;
         #endif
-    } else {
-        /* Memory or file-based device */
-        if (!bd->data) return false;
-        memcpy(buffer, (uint8_t*)bd->data + offset, length);
-        return true;
     }
+    return false;
 }
 
-bool HFS_BD_Write(HFS_BlockDev* bd, uint64_t offset, const void* buffer, uint32_t length) {
-    if (!bd || !buffer) return false;
-    if (bd->readonly) return false;
-    if (offset + length > bd->size) return false;
+bool HFS_BD_WriteSectors(const HFS_BlockDev* bd, uint64_t sector, uint32_t count, const void* buffer) {
+    const uint8_t* src = (const uint8_t*)buffer;
+
+    if (!bd || !buffer || bd->sectorSize == 0) return false;
 
 #if !defined(__arm__) && !defined(__aarch64__) && !defined(HFS_DISABLE_ATA)
     if (bd->type == HFS_BD_TYPE_ATA) {
-        /* ATA device - write sectors */
         ATADevice* ata_dev = ATA_GetDevice(bd->device_index);
         if (!ata_dev) return false;
 
-        /* Prevent division by zero */
-        if (bd->sectorSize == 0) {
-            return false;
-        }
-
-        /* Reject offsets that would overflow 32-bit sector math */
-        if (offset + length > (uint64_t)UINT32_MAX * bd->sectorSize) {
-            return false;  /* Offset too large */
-        }
-
-        /* Calculate sector alignment using 64-bit math, then truncate */
-        uint32_t start_sector = (uint32_t)(offset / bd->sectorSize);
-        uint32_t end_sector = (uint32_t)((offset + length + bd->sectorSize - 1) / bd->sectorSize);
-        uint32_t sector_count = end_sector - start_sector;
-        uint32_t offset_in_sector = (uint32_t)(offset % bd->sectorSize);
-
-        /* Allocate temporary buffer for sector-aligned write */
-        /* Check for integer overflow in multiplication */
-        if (sector_count > UINT32_MAX / bd->sectorSize) {
-            return false;  /* Overflow would occur */
-        }
-
-        uint8_t* temp_buffer = NewPtr(sector_count * bd->sectorSize);
-        if (!temp_buffer) return false;
-
-        /* If write doesn't start/end on sector boundary, need to read-modify-write */
-        if (offset_in_sector != 0 || ((uint32_t)offset + length) % bd->sectorSize != 0) {
-            /* Read existing sectors first */
-            OSErr err = ATA_ReadSectors(ata_dev, start_sector, sector_count, temp_buffer);
-            if (err != noErr) {
-                DisposePtr((Ptr)temp_buffer);
-                return false;
-            }
-        }
-
-        /* Copy new data into temp buffer */
-        memcpy(temp_buffer + offset_in_sector, buffer, length);
-
-        /* Write sectors */
-        OSErr err = ATA_WriteSectors(ata_dev, start_sector, sector_count, temp_buffer);
-        DisposePtr((Ptr)temp_buffer);
-
-        return (err == noErr);
-    } else
+        return ATA_WriteSectors48(ata_dev, sector, count, src) == noErr;
+    }
 #endif
     if (bd->type == HFS_BD_TYPE_SDHCI) {
-        /* SDHCI SD card - write blocks via HAL */
         #if defined(__arm__) || defined(__aarch64__) || defined(HFS_DISABLE_ATA)
-
-        /* Prevent division by zero */
-        if (bd->sectorSize == 0) {
-            return false;
-        }
-
-        /* Reject offsets that would overflow 32-bit block math */
-        if (offset + length > (uint64_t)UINT32_MAX * bd->sectorSize) {
-            return false;  /* Offset too large */
-        }
-
-        /* Calculate block alignment using 64-bit math, then truncate */
-        uint32_t start_block = (uint32_t)(offset / bd->sectorSize);
-        uint32_t end_block = (uint32_t)((offset + length + bd->sectorSize - 1) / bd->sectorSize);
-        uint32_t block_count = end_block - start_block;
-        uint32_t offset_in_block = (uint32_t)(offset % bd->sectorSize);
-
-        /* Allocate temporary buffer for block-aligned write */
-        /* Check for integer overflow in multiplication */
-        if (block_count > UINT32_MAX / bd->sectorSize) {
-            return false;  /* Overflow would occur */
-        }
-
-        uint8_t* temp_buffer = NewPtr(block_count * bd->sectorSize);
-        if (!temp_buffer) return false;
-
-        /* If write doesn't start/end on block boundary, need to read-modify-write */
-        if (offset_in_block != 0 || ((uint32_t)offset + length) % bd->sectorSize != 0) {
-            /* Read existing blocks first */
-            OSErr err = hal_storage_read_blocks(bd->device_index, start_block, block_count, temp_buffer);
-            if (err != 0) {  /* noErr should be 0 */
-                DisposePtr((Ptr)temp_buffer);
+        while (count > 0) {
+            uint32_t n = count > kHFSMaxSectorsPerCommand ? kHFSMaxSectorsPerCommand : count;
+            if (!hal_result_ok(hal_storage_write_blocks(bd->device_index, sector, n, src), n)) {
                 return false;
             }
+            sector += n;
+            count -= n;
+            src += n * bd->sectorSize;
         }
+        return true;
+        #endif
+    }
+    return false;
+}
 
-        /* Copy new data into temp buffer */
-        memcpy(temp_buffer + offset_in_block, buffer, length);
+bool HFS_BD_Read(const HFS_BlockDev* bd, uint64_t offset, void* buffer, uint32_t length) {
+    if (!bd || !buffer) return false;
+    if (offset + length > bd->size) return false;
 
-        /* Write blocks via HAL storage interface */
-        OSErr err = hal_storage_write_blocks(bd->device_index, start_block, block_count, temp_buffer);
-        DisposePtr((Ptr)temp_buffer);
+    if (bd->type == HFS_BD_TYPE_ATA || bd->type == HFS_BD_TYPE_SDHCI) {
+        /* Disks go through the block cache, which does the sector alignment */
+        return HFS_BC_Read(bd, offset, buffer, length);
+    }
 
-        return (err == 0);  /* noErr should be 0 */
-        #else
-        return false;
-        #endif
-    } else {
-        /* Memory or file-based device */
-        if (!bd->data) return false;
-        memcpy((uint8_t*)bd->data + offset, buffer, length);
-        return true;
+    /* Memory or file-based device */
+    if (!bd->data) return false;
+    memcpy(buffer, (uint8_t*)bd->data + offset, length);
+    return true;
+}
+
+bool HFS_BD_Write(HFS_BlockDev* bd, uint64_t offset, const void* buffer, uint32_t length) {
+    if (!bd || !buffer) return false;
+    if (bd->readonly) return false;
+    if (offset + length > bd->size) return false;
+
+    if (bd->type == HFS_BD_TYPE_ATA || bd->type == HFS_BD_TYPE_SDHCI) {
+        /* Write-back: the data reaches the disk on HFS_BD_Flush, on
+         * HFS_BD_Close, or when the cache needs the block for another */
+        return HFS_BC_Write(bd, offset, buffer, length);
     }
+
+    /* Memory or file-based device */
+    if (!bd->data) return false;
+    memcpy((uint8_t*)bd->data + offset, buffer, length);
+    return true;
 }
 
 void HFS_BD_Close(HFS_BlockDev* bd) {
     if (!bd) return;
 
+    if (bd->type == HFS_BD_TYPE_ATA || bd->type == HFS_BD_TYPE_SDHCI) {
+        /* Write back anything still dirty, then forget the device's blocks:
+         * the next mount may be a different disk at the same index */
+        if (!HFS_BC_Flush(bd)) {
+            FS_LOG_DEBUG("HFS: BD_Close: write-back failed on device %d\n", bd->device_index);
+        }
+        HFS_BC_Invalidate(bd);
+    }
+
 #if !defined(__arm__) && !defined(__aarch64__) && !defined(HFS_DISABLE_ATA)
     if (bd->type == HFS_BD_TYPE_ATA) {
         /* Flush ATA device cache before closing */
@@ -439,6 +346,11 @@ bool HFS_BD_WriteSector(HFS_BlockDev* bd, uint32_t sector, const void* buffer) {
 bool HFS_BD_Flush(HFS_BlockDev* bd) {
     if (!bd) return false;
 
+    /* Dirty cached blocks first, so the device flush below covers them */
+    if ((bd->type == HFS_BD_TYPE_ATA || bd->type == HFS_BD_TYPE_SDHCI) && !HFS_BC_Flush(bd)) {
+        return false;
+    }
+
 #if !defined(__arm__) && !defined(__aarch64__) && !defined(HFS_DISABLE_ATA)
     if (bd->type == HFS_BD_TYPE_ATA) {
         /* Flush ATA device cache */
@@ -2,6 +2,7 @@
 #include "../../include/FS/hfs_file.h"
 #include "../../include/FS/hfs_endian.h"
 #include "../../include/FS/hfs_btree.h"
+#include "../../include/FS/hfs_alloc.h"
 #include "../../include/MemoryMgr/MemoryManager.h"
 #include <string.h>
 #include "FS/FSLogging.h"
@@ -38,20 +39,23 @@ static bool find_file_callback(void* keyPtr, uint16_t keyLen,
 
 /* Find file record in catalog by ID */
 static bool find_file_record(HFS_Catalog* cat, FileID id, HFS_CatFileRec* fileRec) {
-    /* This is a simplified version - in reality we'd search the B-tree directly */
-
-    /* Build a thread record key to find the file */
-    /* For now, do a linear search through catalog */
+    /* Through the file's thread record: two B-tree descents */
+    if (HFS_CatalogGetRecord(cat, id, fileRec, sizeof(HFS_CatFileRec)) &&
+        be16_read(&fileRec->recordType) == kHFS_FileRecord &&
+        be32_read(&fileRec->fileID) == id) {
+        return true;
+    }
 
+    /* Files without a thread record: search the leaves */
     FindContext ctx = { .target = id, .result = fileRec, .found = false };
 
     HFS_BT_IterateLeaves(&cat->bt, find_file_callback, &ctx);
     return ctx.found;
 }
 
-/* Read data from file extents */
+/* Read data from extents that start extentsStart bytes into the fork */
 static bool read_from_extents(HFS_Volume* vol, const HFS_Extent* extents,
-                             uint32_t fileSize, uint32_t offset,
+                             uint32_t extentsStart, uint32_t fileSize, uint32_t offset,
                              void* buffer, uint32_t length,
                              uint32_t* bytesRead) {
     if (!vol || !extents || !buffer || !bytesRead) return false;
@@ -64,11 +68,15 @@ static bool read_from_extents(HFS_Volume* vol, const HFS_Extent* extents,
         length = fileSize - offset;
     }
 
-    uint32_t currentOffset = 0;
+    uint32_t currentOffset = extentsStart;
     uint32_t remaining = length;
     uint8_t* dst = (uint8_t*)buffer;
 
-    /* Read from first 3 extents */
+    /* Prevent division by zero */
+    if (vol->alBlkSize == 0 || offset < extentsStart) {
+        return false;
+    }
+
     for (int i = 0; i < 3 && remaining > 0; i++) {
         if (extents[i].blockCount == 0) break;
 
@@ -85,35 +93,16 @@ static bool read_from_extents(HFS_Volume* vol, const HFS_Extent* extents,
         uint32_t toRead = extentBytes - extentOffset;
         if (toRead > remaining) toRead = remaining;
 
-        /* Prevent division by zero */
-        if (vol->alBlkSize == 0) {
-            return false;
-        }
-
-        /* Calculate allocation block and offset within it */
+        /* Read just the bytes wanted: the block cache under HFS_BD_Read
+         * deals with sector and block alignment */
         uint32_t startAllocBlock = extents[i].startBlock + (extentOffset / vol->alBlkSize);
         uint32_t allocOffset = extentOffset % vol->alBlkSize;
-        uint32_t blocksToRead = (toRead + allocOffset + vol->alBlkSize - 1) / vol->alBlkSize;
 
-        /* Allocate temporary buffer for block-aligned read */
-        /* Check for integer overflow in multiplication */
-        if (blocksToRead > UINT32_MAX / vol->alBlkSize) {
-            return false;  /* Overflow would occur */
-        }
-
-        uint8_t* tempBuf = NewPtr(blocksToRead * vol->alBlkSize);
-        if (!tempBuf) return false;
-
-        /* Read the allocation blocks */
-        if (!HFS_ReadAllocBlocks(vol, startAllocBlock, blocksToRead, tempBuf)) {
-            DisposePtr((Ptr)tempBuf);
+        if (!HFS_BD_Read(&vol->bd, HFS_AllocBlockToByteOffset(vol, startAllocBlock) + allocOffset,
+                         dst, toRead)) {
             return false;
         }
 
-        /* Copy requested portion to destination */
-        memcpy(dst, tempBuf + allocOffset, toRead);
-        DisposePtr((Ptr)tempBuf);
-
         dst += toRead;
         offset += toRead;
         remaining -= toRead;
@@ -124,59 +113,105 @@ static bool read_from_extents(HFS_Volume* vol, const HFS_Extent* extents,
     return true;
 }
 
-/* Read data from overflow extents B-tree */
-static bool read_from_overflow_extents(HFS_Volume* vol, FileID fileID,
-                                       bool isResource, uint32_t fileSize,
-                                       uint32_t offset, void* buffer,
-                                       uint32_t length, uint32_t* bytesRead,
-                                       uint32_t firstThreeExtentsSize) {
+/* Extents overflow key: length 7, fork type, file number, first
+ * allocation block of the fork the record maps */
+static void make_extents_key(uint8_t* key, FileID fileID, bool isResource, uint16_t startBlock) {
+    key[0] = 7;
+    key[1] = isResource ? 0xFF : 0x00;
+    be32_write(key + 2, fileID);
+    be16_write(key + 6, startBlock);
+}
+
+/* The overflow record that maps the fork from allocation block
+ * startBlock on: three more extents */
+static bool find_overflow_record(HFS_BTree* bt, FileID fileID, bool isResource,
+                                 uint16_t startBlock, HFS_Extent* extents) {
+    uint8_t key[8];
+    uint32_t node;
+    uint16_t index;
+    bool exact;
+    void* record;
+    uint16_t recordLen;
+    void* data;
+    uint16_t dataLen;
+
+    make_extents_key(key, fileID, isResource, startBlock);
+    if (!HFS_BT_Seek(bt, key, bt->nodeBuffer, &node, &index, &exact) || !exact) return false;
+    if (!HFS_BT_GetRecord(bt->nodeBuffer, bt->nodeSize, index, &record, &recordLen) ||
+        !HFS_BT_SplitRecord(bt, record, recordLen, &data, &dataLen) ||
+        dataLen < 3 * sizeof(HFS_Extent)) {
+        return false;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        extents[i].startBlock = be16_read((uint8_t*)data + i * 4);
+        extents[i].blockCount = be16_read((uint8_t*)data + i * 4 + 2);
+    }
+    return true;
+}
+
+static uint32_t extent_blocks(const HFS_Extent* extents, int count) {
+    uint32_t blocks = 0;
+    for (int i = 0; i < count && extents[i].blockCount != 0; i++) {
+        blocks += extents[i].blockCount;
+    }
+    return blocks;
+}
+
+/*
+ * Read the part of a fork past its first three extents. The overflow
+ * records follow one another: each is keyed by the allocation block it
+ * starts at, which is where the ones before it leave off.
+ */
+static bool read_from_overflow_extents(HFS_Volume* vol, FileID fileID, bool isResource,
+                                       const HFS_Extent* firstExtents, uint32_t fileSize,
+                                       uint32_t offset, void* buffer, uint32_t length,
+                                       uint32_t* bytesRead) {
     if (!vol || !buffer || !bytesRead) return false;
 
     *bytesRead = 0;
 
-    /* Skip if read is within first 3 extents */
-    if (offset < firstThreeExtentsSize) return true;
+    uint32_t startBlock = extent_blocks(firstExtents, 3);
+    uint32_t extentsStart = startBlock * vol->alBlkSize;
+    if (offset < extentsStart) return false;
 
-    /* Initialize extents B-tree */
     HFS_BTree extBTree;
     if (!HFS_BT_Init(&extBTree, vol, kBTreeExtents)) {
         return false;
     }
 
-    bool foundExtents = false;
-
-    /* Search for overflow extents starting at file block 0 of overflow */
-    uint32_t searchBlock = firstThreeExtentsSize / vol->alBlkSize;
-
-    /* Build extent key: keyLen + reserved + fileID + forkType + startBlock */
-    uint8_t extKey[9];
-    extKey[0] = 7;  /* key length excluding first byte */
-    extKey[1] = 0;  /* reserved */
-    be32_write(extKey + 2, fileID);
-    extKey[6] = isResource ? 0xFF : 0x00;
-    be16_write(extKey + 7, (uint16_t)searchBlock);
-
-    /* Look up extent record */
-    uint8_t recordBuffer[32];
-    uint16_t recordLen = 0;
+    uint8_t* dst = (uint8_t*)buffer;
+    bool ok = true;
+    while (*bytesRead < length && startBlock <= 0xFFFF) {
+        HFS_Extent extents[3];
+        uint32_t got = 0;
+
+        if (!find_overflow_record(&extBTree, fileID, isResource, (uint16_t)startBlock, extents)) {
+            ok = false;
+            break;
+        }
 
-    if (HFS_BT_FindRecord(&extBTree, extKey, 9, recordBuffer, &recordLen)) {
-        /* Found overflow extent record - it contains 3 more extents */
-        if (recordLen >= 12) {  /* 3 extents * 4 bytes each */
-            HFS_Extent overflowExtents[3];
-            for (int i = 0; i < 3; i++) {
-                overflowExtents[i].startBlock = be16_read(recordBuffer + i * 4);
-                overflowExtents[i].blockCount = be16_read(recordBuffer + i * 4 + 2);
+        uint32_t blocks = extent_blocks(extents, 3);
+        if (blocks == 0) {
+            ok = false;
+            break;
+        }
+        if (offset < extentsStart + blocks * vol->alBlkSize) {
+            if (!read_from_extents(vol, extents, extentsStart, fileSize, offset,
+                                   dst, length - *bytesRead, &got)) {
+                ok = false;
+                break;
             }
-
-            /* Read from overflow extents */
-            foundExtents = read_from_extents(vol, overflowExtents, fileSize,
-                                           offset, buffer, length, bytesRead);
+            dst += got;
+            offset += got;
+            *bytesRead += got;
         }
+        startBlock += blocks;
+        extentsStart += blocks * vol->alBlkSize;
     }
 
     HFS_BT_Close(&extBTree);
-    return foundExtents;
+    return ok;
 }
 
 HFSFile* HFS_FileOpen(HFS_Catalog* cat, FileID id, bool resourceFork) {
@@ -308,34 +343,28 @@ bool HFS_FileRead(HFSFile* file, void* buffer, uint32_t length, uint32_t* bytesR
 
     const HFS_Extent* extents = file->isResource ? file->rsrcExtents : file->dataExtents;
     uint32_t fileSize = file->isResource ? file->rsrcSize : file->dataSize;
-    uint32_t initialBytesRead = 0;
 
-    /* First, try to read from the first 3 extents */
-    bool result = read_from_extents(file->vol, extents, fileSize,
-                                   file->position, buffer, length, &initialBytesRead);
-
-    *bytesRead = initialBytesRead;
-
-    /* If we didn't get all requested bytes and haven't read anything yet,
-     * try overflow extents for large files */
-    if (result && initialBytesRead < length && initialBytesRead == 0) {
-        /* Calculate size covered by first 3 extents */
-        uint32_t firstThreeSize = 0;
-        for (int i = 0; i < 3; i++) {
-            if (extents[i].blockCount == 0) break;
-            firstThreeSize += extents[i].blockCount * file->vol->alBlkSize;
-        }
-
-        /* Try reading from overflow extents */
+    /* First, the three extents in the catalog record */
+    bool result = read_from_extents(file->vol, extents, 0, fileSize,
+                                   file->position, buffer, length, bytesRead);
+
+    /* The rest of a fragmented file is mapped by the extents overflow
+     * file. This used to be tried only when nothing at all had come from
+     * the first three extents, and then read the overflow extents as if
+     * they started the fork, so a read that crossed into them came back
+     * short and one past them returned the wrong bytes. */
+    uint32_t end = (fileSize - file->position < length) ? fileSize : file->position + length;
+    if (result && file->position < fileSize && file->position + *bytesRead < end) {
         uint32_t overflowBytesRead = 0;
-        if (read_from_overflow_extents(file->vol, file->id, file->isResource,
-                                      fileSize, file->position, buffer,
-                                      length, &overflowBytesRead, firstThreeSize)) {
-            *bytesRead += overflowBytesRead;
-        }
+        result = read_from_overflow_extents(file->vol, file->id, file->isResource, extents,
+                                            fileSize, file->position + *bytesRead,
+                                            (uint8_t*)buffer + *bytesRead,
+                                            end - file->position - *bytesRead,
+                                            &overflowBytesRead);
+        *bytesRead += overflowBytesRead;
     }
 
-    if (result && *bytesRead > 0) {
+    if (*bytesRead > 0) {
         file->position += *bytesRead;
     }
 
@@ -360,4 +389,330 @@ uint32_t HFS_FileGetSize(HFSFile* file) {
 uint32_t HFS_FileTell(HFSFile* file) {
     if (!file) return 0;
     return file->position;
-}
\ No newline at end of file
+}
+/*
+ * Writing a fork
+ *
+ * A fork is written whole, into newly allocated blocks, and the old blocks
+ * are freed only after the catalog points at the new ones, so a write that
+ * fails for want of space leaves the file as it was. The data goes to the
+ * device before the catalog record and bitmap changes do. Runs are asked
+ * for starting where the previous one ended, so on a volume with room the
+ * fork is one extent.
+ */
+
+typedef struct {
+    HFS_Extent* extents;
+    uint32_t    count;
+    uint32_t    capacity;
+} ExtentList;
+
+static bool extent_list_add(ExtentList* list, HFS_Extent run) {
+    if (run.blockCount == 0) return true;
+
+    /* Contiguous with the last one: make that one longer */
+    if (list->count > 0) {
+        HFS_Extent* last = &list->extents[list->count - 1];
+        if (last->startBlock + last->blockCount == run.startBlock &&
+            (uint32_t)last->blockCount + run.blockCount <= 0xFFFF) {
+            last->blockCount = (uint16_t)(last->blockCount + run.blockCount);
+            return true;
+        }
+    }
+
+    if (list->count == list->capacity) {
+        uint32_t capacity = list->capacity ? list->capacity * 2 : 8;
+        HFS_Extent* grown = (HFS_Extent*)NewPtr(capacity * sizeof(HFS_Extent));
+        if (!grown) return false;
+        if (list->count) memcpy(grown, list->extents, list->count * sizeof(HFS_Extent));
+        if (list->extents) DisposePtr((Ptr)list->extents);
+        list->extents = grown;
+        list->capacity = capacity;
+    }
+    list->extents[list->count++] = run;
+    return true;
+}
+
+static void extent_list_free_blocks(HFS_Volume* vol, const ExtentList* list) {
+    for (uint32_t i = 0; i < list->count; i++) {
+        HFS_FreeBlocks(vol, list->extents[i].startBlock, list->extents[i].blockCount);
+    }
+}
+
+static void extent_list_dispose(ExtentList* list) {
+    if (list->extents) DisposePtr((Ptr)list->extents);
+    memset(list, 0, sizeof(*list));
+}
+
+/*
+ * Take a fork's overflow records out of the extents tree, adding the
+ * extents they held to list. The records are found the way
+ * read_from_overflow_extents finds them, from the first block after
+ * firstExtents on. A record that cannot be deleted stays out of list, so
+ * list holds exactly the extents no longer in the tree.
+ */
+static bool remove_overflow_records(HFS_BTree* extBT, FileID fileID, bool isResource,
+                                    const HFS_Extent* firstExtents, ExtentList* list) {
+    uint32_t startBlock = extent_blocks(firstExtents, 3);
+
+    if (extBT->rootNode == 0) return true;
+
+    while (startBlock <= 0xFFFF) {
+        HFS_Extent extents[3];
+        uint8_t key[8];
+
+        if (!find_overflow_record(extBT, fileID, isResource, (uint16_t)startBlock, extents)) {
+            return true;
+        }
+
+        /* Listed before the delete, so running out of memory cannot lose
+         * them; taken back off if the delete fails */
+        uint32_t count = list->count;
+        HFS_Extent last = count ? list->extents[count - 1] : extents[0];
+        bool listed = true;
+        for (int i = 0; listed && i < 3 && extents[i].blockCount != 0; i++) {
+            listed = extent_list_add(list, extents[i]);
+        }
+        make_extents_key(key, fileID, isResource, (uint16_t)startBlock);
+        if (!listed || !HFS_BT_DeleteRecord(extBT, key)) {
+            list->count = count;
+            if (count) list->extents[count - 1] = last;
+            return false;
+        }
+
+        uint32_t blocks = extent_blocks(extents, 3);
+        if (blocks == 0) return true;
+        startBlock += blocks;
+    }
+    return true;
+}
+
+/* list's extents from index first on as overflow records, three to a
+ * record, the first keyed at fork block fileBlock */
+static bool insert_overflow_records(HFS_BTree* extBT, FileID fileID, bool isResource,
+                                    uint32_t fileBlock, const ExtentList* list, uint32_t first) {
+    for (uint32_t i = first; i < list->count; i += 3) {
+        uint32_t n = (list->count - i < 3) ? list->count - i : 3;
+        uint8_t key[8];
+        uint8_t record[3 * sizeof(HFS_Extent)];
+
+        memset(record, 0, sizeof(record));
+        for (uint32_t j = 0; j < n; j++) {
+            be16_write(record + j * 4, list->extents[i + j].startBlock);
+            be16_write(record + j * 4 + 2, list->extents[i + j].blockCount);
+        }
+        make_extents_key(key, fileID, isResource, (uint16_t)fileBlock);
+        if (fileBlock > 0xFFFF || !HFS_BT_InsertRecord(extBT, key, record, sizeof(record))) {
+            return false;
+        }
+        fileBlock += extent_blocks(&list->extents[i], (int)n);
+    }
+    return true;
+}
+
+static const uint8_t gZeroSector[512];
+
+static bool write_fork_data(HFS_Volume* vol, const ExtentList* list,
+                            const uint8_t* data, uint32_t size) {
+    uint32_t done = 0;
+
+    for (uint32_t i = 0; i < list->count; i++) {
+        uint64_t offset = HFS_AllocBlockToByteOffset(vol, list->extents[i].startBlock);
+        uint32_t extentBytes = list->extents[i].blockCount * vol->alBlkSize;
+        uint32_t toWrite = (size - done < extentBytes) ? size - done : extentBytes;
+
+        if (toWrite && !HFS_BD_Write(&vol->bd, offset, data + done, toWrite)) return false;
+        done += toWrite;
+
+        /* Zero the rest of the last block rather than leave whatever a
+         * deleted file had there */
+        for (uint32_t pad = toWrite; pad < extentBytes; ) {
+            uint32_t chunk = extentBytes - pad;
+            if (chunk > sizeof(gZeroSector)) chunk = sizeof(gZeroSector);
+            if (!HFS_BD_Write(&vol->bd, offset + pad, gZeroSector, chunk)) return false;
+            pad += chunk;
+        }
+    }
+    return done == size;
+}
+
+/* Blocks for size bytes, each run asked for where the last one ended */
+static bool allocate_fork(HFS_Volume* vol, uint32_t size, ExtentList* list) {
+    uint32_t needed = (uint32_t)(((uint64_t)size + vol->alBlkSize - 1) / vol->alBlkSize);
+    uint16_t goal = kHFSAllocAnywhere;
+
+    while (needed > 0) {
+        HFS_Extent run;
+        uint16_t want = (needed > 0xFFFF) ? 0xFFFF : (uint16_t)needed;
+        if (!HFS_AllocBlocks(vol, goal, want, &run) || !extent_list_add(list, run)) {
+            return false;
+        }
+        needed -= run.blockCount;
+        goal = (uint16_t)(run.startBlock + run.blockCount);
+    }
+    return true;
+}
+
+/*
+ * The fork's overflow records, replaced by newExtents beyond the third;
+ * the extents the old records held are added to oldExtents. On failure
+ * the old records are put back and *restored says whether that worked:
+ * if it did, the tree maps the old fork exactly as before.
+ */
+static bool replace_overflow_records(HFS_Volume* vol, FileID id, bool resourceFork,
+                                     const HFS_Extent* oldFirst, const ExtentList* newExtents,
+                                     ExtentList* oldExtents, bool* restored) {
+    HFS_BTree extBT;
+
+    *restored = true;
+    if (extent_blocks(oldFirst, 3) == 0 && newExtents->count <= 3) return true;
+    if (!HFS_BT_Init(&extBT, vol, kBTreeExtents)) return newExtents->count <= 3;
+
+    int firstCount = (newExtents->count < 3) ? (int)newExtents->count : 3;
+    HFS_Extent newFirst[3] = { { 0, 0 }, { 0, 0 }, { 0, 0 } };
+    if (firstCount) memcpy(newFirst, newExtents->extents, firstCount * sizeof(HFS_Extent));
+
+    bool removed = remove_overflow_records(&extBT, id, resourceFork, oldFirst, oldExtents);
+    bool ok = removed &&
+              insert_overflow_records(&extBT, id, resourceFork, extent_blocks(newFirst, 3),
+                                      newExtents, 3);
+
+    if (!ok) {
+        /* Once the old records are all out, the tree holds only new ones
+         * for this fork; before that, the old ones left start where the
+         * removed ones end, so the removed ones go back in front of them */
+        ExtentList inserted = { 0 };
+        *restored = (!removed ||
+                     remove_overflow_records(&extBT, id, resourceFork, newFirst, &inserted)) &&
+                    insert_overflow_records(&extBT, id, resourceFork, extent_blocks(oldFirst, 3),
+                                            oldExtents, 0);
+        extent_list_dispose(&inserted);
+    }
+
+    HFS_BT_Close(&extBT);
+    return ok;
+}
+
+/* Point the file record at the new fork: first three extents and sizes */
+static bool update_file_record(HFS_Catalog* cat, FileID id, bool resourceFork,
+                               HFS_CatFileRec* fileRec, const ExtentList* newExtents,
+                               uint32_t size) {
+    HFS_Extent* firstExtents = resourceFork ? fileRec->rsrcExtents : fileRec->dataExtents;
+    uint32_t blocks = 0;
+
+    for (uint32_t i = 0; i < newExtents->count; i++) {
+        blocks += newExtents->extents[i].blockCount;
+    }
+    for (uint32_t i = 0; i < 3; i++) {
+        HFS_Extent extent = { 0, 0 };
+        if (i < newExtents->count) extent = newExtents->extents[i];
+        be16_write(&firstExtents[i].startBlock, extent.startBlock);
+        be16_write(&firstExtents[i].blockCount, extent.blockCount);
+    }
+
+    uint16_t startBlock = newExtents->count ? newExtents->extents[0].startBlock : 0;
+    uint32_t physical = blocks * cat->vol->alBlkSize;
+    if (resourceFork) {
+        be16_write(&fileRec->rsrcStartBlock, startBlock);
+        be32_write(&fileRec->rsrcLogicalSize, size);
+        be32_write(&fileRec->rsrcPhysicalSize, physical);
+    } else {
+        be16_write(&fileRec->dataStartBlock, startBlock);
+        be32_write(&fileRec->dataLogicalSize, size);
+        be32_write(&fileRec->dataPhysicalSize, physical);
+    }
+
+    extern void GetDateTime(uint32_t* secs);
+    uint32_t now = 0;
+    GetDateTime(&now);
+    if (now != 0) be32_write(&fileRec->modifyDate, now);
+
+    return HFS_CatalogPutRecord(cat, id, fileRec, sizeof(*fileRec));
+}
+
+bool HFS_FileWriteData(HFS_Catalog* cat, FileID id, bool resourceFork,
+                       const void* data, uint32_t size) {
+    if (!cat || !cat->vol || (!data && size) || id < HFS_FIRST_CNID) return false;
+
+    HFS_Volume* vol = cat->vol;
+    HFS_CatFileRec fileRec;
+    if (vol->bd.readonly || vol->alBlkSize == 0) return false;
+    if (!find_file_record(cat, id, &fileRec)) return false;
+
+    HFS_Extent* recExtents = resourceFork ? fileRec.rsrcExtents : fileRec.dataExtents;
+    HFS_Extent oldFirst[3];
+    for (int i = 0; i < 3; i++) {
+        oldFirst[i].startBlock = be16_read(&recExtents[i].startBlock);
+        oldFirst[i].blockCount = be16_read(&recExtents[i].blockCount);
+    }
+
+    ExtentList newExtents = { 0 };
+    ExtentList oldExtents = { 0 };
+    HFS_CatFileRec oldRec = fileRec;
+    bool restored = true;
+
+    /* Data first, then the catalog record, then the overflow records; a
+     * failure after the catalog changed puts the old record back */
+    bool cataloged = allocate_fork(vol, size, &newExtents) &&
+                     write_fork_data(vol, &newExtents, (const uint8_t*)data, size) &&
+                     HFS_BD_Flush(&vol->bd) &&
+                     update_file_record(cat, id, resourceFork, &fileRec, &newExtents, size);
+    bool ok = cataloged &&
+              replace_overflow_records(vol, id, resourceFork, oldFirst, &newExtents,
+                                       &oldExtents, &restored);
+    if (cataloged && !ok && restored) {
+        restored = HFS_CatalogPutRecord(cat, id, &oldRec, sizeof(oldRec));
+    }
+
+    if (ok) {
+        for (int i = 0; i < 3; i++) {
+            extent_list_add(&oldExtents, oldFirst[i]);
+        }
+        extent_list_free_blocks(vol, &oldExtents);
+    } else if (restored) {
+        FS_LOG_DEBUG("HFS File: writing %u bytes to file %u failed\n", size, id);
+        extent_list_free_blocks(vol, &newExtents);
+    } else {
+        /* Neither fork is certainly unreferenced: leave both allocated */
+        FS_LOG_ERROR("HFS File: file %u fork left inconsistent after failed write\n", id);
+    }
+
+    extent_list_dispose(&newExtents);
+    extent_list_dispose(&oldExtents);
+    return ok;
+}
+
+bool HFS_FileDelete(HFS_Catalog* cat, FileID id) {
+    if (!cat || !cat->vol || id < HFS_FIRST_CNID) return false;
+
+    HFS_Volume* vol = cat->vol;
+    HFS_CatFileRec fileRec;
+    if (!find_file_record(cat, id, &fileRec)) return false;
+
+    /* Out of the catalog first; the blocks are only free once nothing
+     * points at them */
+    if (!HFS_CatalogDelete(cat, id)) return false;
+
+    ExtentList extents = { 0 };
+    HFS_BTree extBT;
+    bool extOpen = HFS_BT_Init(&extBT, vol, kBTreeExtents);
+
+    for (int fork = 0; fork < 2; fork++) {
+        HFS_Extent* recExtents = fork ? fileRec.rsrcExtents : fileRec.dataExtents;
+        HFS_Extent first[3];
+
+        for (int i = 0; i < 3; i++) {
+            first[i].startBlock = be16_read(&recExtents[i].startBlock);
+            first[i].blockCount = be16_read(&recExtents[i].blockCount);
+            extent_list_add(&extents, first[i]);
+        }
+        if (extOpen) {
+            remove_overflow_records(&extBT, id, fork != 0, first, &extents);
+        }
+    }
+
+    extent_list_free_blocks(vol, &extents);
+    if (extOpen) HFS_BT_Close(&extBT);
+    extent_list_dispose(&extents);
+    return true;
+}
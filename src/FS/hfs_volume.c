@@ -25,78 +25,63 @@ static void cstr_to_pstr(uint8_t* dst, const char* src, size_t maxlen) {
     memcpy(dst + 1, src, len);
 }
 
-bool HFS_VolumeMount(HFS_Volume* vol, const char* imagePath, VRefNum vRefNum) {
-    if (!vol) return false;
-
-    memset(vol, 0, sizeof(HFS_Volume));
-
-    /* Initialize block device */
-    if (!HFS_BD_InitFile(&vol->bd, imagePath, false)) {
-        return false;
-    }
-
-    /* Read MDB from sector 2 */
-    uint8_t mdbBuffer[512];
-    if (!HFS_BD_ReadSector(&vol->bd, HFS_MDB_SECTOR, mdbBuffer)) {
-        HFS_BD_Close(&vol->bd);
-        return false;
-    }
-
-    /* Verify HFS signature */
-    uint16_t sig = be16_read(&mdbBuffer[0]);
-    if (sig != HFS_SIGNATURE) {
-        /* FS_LOG_DEBUG("HFS: Invalid signature 0x%04x (expected 0x4244)\n", sig); */
-        HFS_BD_Close(&vol->bd);
-        return false;
-    }
-
-    /* Parse MDB fields */
+/*
+ * Everything the MDB says, in host byte order, plus the values the rest of
+ * the code reads from HFS_Volume directly. HFS_VolumeMountMemory used to
+ * pick out only the fields needed to find the catalog, which left the free
+ * block count, the file and folder counts and the dates at zero - harmless
+ * while nothing wrote to the volume, wrong as soon as something does.
+ */
+void HFS_VolumeParseMDB(HFS_Volume* vol, const uint8_t* mdbSector) {
     HFS_MDB* mdb = &vol->mdb;
-    mdb->drSigWord    = sig;
-    mdb->drCrDate     = be32_read(&mdbBuffer[4]);
-    mdb->drLsMod      = be32_read(&mdbBuffer[8]);
-    mdb->drAtrb       = be16_read(&mdbBuffer[12]);
-    mdb->drNmFls      = be16_read(&mdbBuffer[14]);
-    mdb->drVBMSt      = be16_read(&mdbBuffer[16]);
-    mdb->drAllocPtr   = be16_read(&mdbBuffer[18]);
-    mdb->drNmAlBlks   = be16_read(&mdbBuffer[20]);
-    mdb->drAlBlkSiz   = be32_read(&mdbBuffer[22]);
-    mdb->drClpSiz     = be32_read(&mdbBuffer[26]);
-    mdb->drAlBlSt     = be16_read(&mdbBuffer[30]);
-    mdb->drNxtCNID    = be32_read(&mdbBuffer[32]);
-    mdb->drFreeBks    = be16_read(&mdbBuffer[36]);
+    mdb->drSigWord    = be16_read(&mdbSector[0]);
+    mdb->drCrDate     = be32_read(&mdbSector[4]);
+    mdb->drLsMod      = be32_read(&mdbSector[8]);
+    mdb->drAtrb       = be16_read(&mdbSector[12]);
+    mdb->drNmFls      = be16_read(&mdbSector[14]);
+    mdb->drVBMSt      = be16_read(&mdbSector[16]);
+    mdb->drAllocPtr   = be16_read(&mdbSector[18]);
+    mdb->drNmAlBlks   = be16_read(&mdbSector[20]);
+    mdb->drAlBlkSiz   = be32_read(&mdbSector[22]);
+    mdb->drClpSiz     = be32_read(&mdbSector[26]);
+    mdb->drAlBlSt     = be16_read(&mdbSector[30]);
+    mdb->drNxtCNID    = be32_read(&mdbSector[32]);
+    mdb->drFreeBks    = be16_read(&mdbSector[36]);
 
     /* Volume name */
-    memcpy(mdb->drVN, &mdbBuffer[38], 28);
+    memcpy(mdb->drVN, &mdbSector[38], 28);
+    if (mdb->drVN[0] > 27) {
+        mdb->drVN[0] = 27;
+    }
     pstr_to_cstr(vol->volName, mdb->drVN, sizeof(vol->volName));
 
     /* More MDB fields */
-    mdb->drVolBkUp    = be32_read(&mdbBuffer[66]);
-    mdb->drVSeqNum    = be16_read(&mdbBuffer[70]);
-    mdb->drWrCnt      = be32_read(&mdbBuffer[72]);
-    mdb->drXTClpSiz   = be32_read(&mdbBuffer[76]);
-    mdb->drCTClpSiz   = be32_read(&mdbBuffer[80]);
-    mdb->drNmRtDirs   = be16_read(&mdbBuffer[84]);
-    mdb->drFilCnt     = be32_read(&mdbBuffer[86]);
-    mdb->drDirCnt     = be32_read(&mdbBuffer[90]);
+    mdb->drVolBkUp    = be32_read(&mdbSector[66]);
+    mdb->drVSeqNum    = be16_read(&mdbSector[70]);
+    mdb->drWrCnt      = be32_read(&mdbSector[72]);
+    mdb->drXTClpSiz   = be32_read(&mdbSector[76]);
+    mdb->drCTClpSiz   = be32_read(&mdbSector[80]);
+    mdb->drNmRtDirs   = be16_read(&mdbSector[84]);
+    mdb->drFilCnt     = be32_read(&mdbSector[86]);
+    mdb->drDirCnt     = be32_read(&mdbSector[90]);
 
     /* Finder info */
     for (int i = 0; i < 8; i++) {
-        mdb->drFndrInfo[i] = be32_read(&mdbBuffer[94 + i * 4]);
+        mdb->drFndrInfo[i] = be32_read(&mdbSector[94 + i * 4]);
     }
 
     /* Extents overflow file */
-    mdb->drXTFlSize = be32_read(&mdbBuffer[126]);
+    mdb->drXTFlSize = be32_read(&mdbSector[126]);
     for (int i = 0; i < 3; i++) {
-        mdb->drXTExtRec[i].startBlock = be16_read(&mdbBuffer[130 + i * 4]);
-        mdb->drXTExtRec[i].blockCount = be16_read(&mdbBuffer[132 + i * 4]);
+        mdb->drXTExtRec[i].startBlock = be16_read(&mdbSector[130 + i * 4]);
+        mdb->drXTExtRec[i].blockCount = be16_read(&mdbSector[132 + i * 4]);
     }
 
     /* Catalog file */
-    mdb->drCTFlSize = be32_read(&mdbBuffer[142]);
+    mdb->drCTFlSize = be32_read(&mdbSector[142]);
     for (int i = 0; i < 3; i++) {
-        mdb->drCTExtRec[i].startBlock = be16_read(&mdbBuffer[146 + i * 4]);
-        mdb->drCTExtRec[i].blockCount = be16_read(&mdbBuffer[148 + i * 4]);
+        mdb->drCTExtRec[i].startBlock = be16_read(&mdbSector[146 + i * 4]);
+        mdb->drCTExtRec[i].blockCount = be16_read(&mdbSector[148 + i * 4]);
     }
 
     /* Cache frequently used values */
@@ -110,6 +95,34 @@ bool HFS_VolumeMount(HFS_Volume* vol, const char* imagePath, VRefNum vRefNum) {
     memcpy(vol->extExtents, mdb->drXTExtRec, sizeof(vol->extExtents));
     vol->rootDirID   = 2;  /* Standard HFS root CNID */
     vol->nextCNID    = mdb->drNxtCNID;
+}
+
+bool HFS_VolumeMount(HFS_Volume* vol, const char* imagePath, VRefNum vRefNum) {
+    if (!vol) return false;
+
+    memset(vol, 0, sizeof(HFS_Volume));
+
+    /* Initialize block device */
+    if (!HFS_BD_InitFile(&vol->bd, imagePath, false)) {
+        return false;
+    }
+
+    /* Read MDB from sector 2 */
+    uint8_t mdbBuffer[512];
+    if (!HFS_BD_ReadSector(&vol->bd, HFS_MDB_SECTOR, mdbBuffer)) {
+        HFS_BD_Close(&vol->bd);
+        return false;
+    }
+
+    /* Verify HFS signature */
+    uint16_t sig = be16_read(&mdbBuffer[0]);
+    if (sig != HFS_SIGNATURE) {
+        /* FS_LOG_DEBUG("HFS: Invalid signature 0x%04x (expected 0x4244)\n", sig); */
+        HFS_BD_Close(&vol->bd);
+        return false;
+    }
+
+    HFS_VolumeParseMDB(vol, mdbBuffer);
     vol->mounted     = true;
     vol->vRefNum     = vRefNum;
 
@@ -152,35 +165,10 @@ bool HFS_VolumeMountMemory(HFS_Volume* vol, void* buffer, uint64_t size, VRefNum
             /* Valid HFS volume - mount it properly */
             /* FS_LOG_DEBUG("HFS: Found valid HFS signature, mounting...\n"); */
 
-            /* Parse MDB directly here instead of calling HFS_VolumeMount */
-            vol->mdb.drSigWord = sig;
-            vol->alBlkSize = be32_read(&mdbBuffer[22]);
-            vol->alBlSt = be16_read(&mdbBuffer[30]);
-            vol->numAlBlks = be16_read(&mdbBuffer[20]);
-            vol->vbmStart = be16_read(&mdbBuffer[16]);
-            vol->catFileSize = be32_read(&mdbBuffer[142]);
-            vol->extFileSize = be32_read(&mdbBuffer[126]);
-
-            /* Copy catalog extents */
-            for (int i = 0; i < 3; i++) {
-                vol->catExtents[i].startBlock = be16_read(&mdbBuffer[146 + i*4]);
-                vol->catExtents[i].blockCount = be16_read(&mdbBuffer[148 + i*4]);
-            }
-
-            /* Copy extents extents */
-            for (int i = 0; i < 3; i++) {
-                vol->extExtents[i].startBlock = be16_read(&mdbBuffer[130 + i*4]);
-                vol->extExtents[i].blockCount = be16_read(&mdbBuffer[132 + i*4]);
-            }
-
-            vol->rootDirID = 2;
-            vol->nextCNID = be32_read(&mdbBuffer[32]);
+            HFS_VolumeParseMDB(vol, mdbBuffer);
             vol->vRefNum = vRefNum;
             vol->mounted = true;
 
-            /* Get volume name */
-            pstr_to_cstr(vol->volName, &mdbBuffer[38], sizeof(vol->volName));
-
             /* FS_LOG_DEBUG("HFS: Mounted volume from memory\n"); */
             return true;
         } else {
@@ -199,6 +187,9 @@ void HFS_VolumeUnmount(HFS_Volume* vol) {
 
     if (vol->mounted) {
         /* FS_LOG_DEBUG("HFS: Unmounting volume\n"); */
+        if (vol->mdbDirty) {
+            HFS_VolumeWriteMDB(vol);
+        }
     }
 
     HFS_BD_Close(&vol->bd);
@@ -237,6 +228,63 @@ bool HFS_GetVolumeInfo(const HFS_Volume* vol, VolumeControlBlock* vcb) {
     return true;
 }
 
+/*
+ * Only the fields the write path changes are written; the rest of the
+ * sector is read back and left as it was, so whatever this code does not
+ * understand about a volume survives it.
+ */
+bool HFS_VolumeWriteMDB(HFS_Volume* vol) {
+    if (!vol || !vol->mounted) return false;
+
+    uint8_t mdb[512];
+    if (!HFS_BD_ReadSector(&vol->bd, HFS_MDB_SECTOR, mdb)) return false;
+    if (be16_read(&mdb[0]) != HFS_SIGNATURE) return false;
+
+    extern void GetDateTime(uint32_t* secs);
+    uint32_t now = 0;
+    GetDateTime(&now);
+    if (now != 0) {
+        vol->mdb.drLsMod = now;
+    }
+    vol->mdb.drWrCnt++;
+    vol->mdb.drNxtCNID = vol->nextCNID;
+
+    be32_write(&mdb[8], vol->mdb.drLsMod);
+    be16_write(&mdb[14], vol->mdb.drNmFls);
+    be16_write(&mdb[18], vol->mdb.drAllocPtr);
+    be32_write(&mdb[32], vol->mdb.drNxtCNID);
+    be16_write(&mdb[36], vol->mdb.drFreeBks);
+    be32_write(&mdb[72], vol->mdb.drWrCnt);
+    be16_write(&mdb[84], vol->mdb.drNmRtDirs);
+    be32_write(&mdb[86], vol->mdb.drFilCnt);
+    be32_write(&mdb[90], vol->mdb.drDirCnt);
+
+    /* The B-tree files grow as records are added */
+    be32_write(&mdb[126], vol->extFileSize);
+    be32_write(&mdb[142], vol->catFileSize);
+    for (int i = 0; i < 3; i++) {
+        be16_write(&mdb[130 + i * 4], vol->extExtents[i].startBlock);
+        be16_write(&mdb[132 + i * 4], vol->extExtents[i].blockCount);
+        be16_write(&mdb[146 + i * 4], vol->catExtents[i].startBlock);
+        be16_write(&mdb[148 + i * 4], vol->catExtents[i].blockCount);
+    }
+    vol->mdb.drXTFlSize = vol->extFileSize;
+    vol->mdb.drCTFlSize = vol->catFileSize;
+    memcpy(vol->mdb.drXTExtRec, vol->extExtents, sizeof(vol->mdb.drXTExtRec));
+    memcpy(vol->mdb.drCTExtRec, vol->catExtents, sizeof(vol->mdb.drCTExtRec));
+
+    if (!HFS_BD_WriteSector(&vol->bd, HFS_MDB_SECTOR, mdb)) return false;
+    vol->mdbDirty = false;
+    return true;
+}
+
+bool HFS_VolumeFlush(HFS_Volume* vol) {
+    if (!vol || !vol->mounted) return false;
+
+    if (vol->mdbDirty && !HFS_VolumeWriteMDB(vol)) return false;
+    return HFS_BD_Flush(&vol->bd);
+}
+
 bool HFS_CreateBlankVolume(void* buffer, uint64_t size, const char* volName) {
     if (!buffer || size < 1024 * 1024) return false;  /* Minimum 1MB */
 
@@ -4,6 +4,7 @@
 #include "../../include/FS/hfs_catalog.h"
 #include "../../include/FS/hfs_file.h"
 #include "../../include/FS/hfs_endian.h"
+#include "../../include/FS/vfs_namecache.h"
 #include "../../include/MemoryMgr/MemoryManager.h"
 #include <string.h>
 #include "FS/FSLogging.h"
@@ -30,6 +31,7 @@ typedef struct {
     /* File data storage for overlay-created files */
     uint8_t* fileData;      /* Persisted file content */
     uint32_t fileDataSize;  /* Size of file content */
+    uint8_t  syncFailures;  /* VFS_Sync attempts that left it unwritten */
 } VFSOverlayEntry;
 
 /* Mounted volume entry */
@@ -52,11 +54,16 @@ static struct {
     VRefNum             nextVRef;
     VFS_MountCallback  mountCallback;
     VFS_ChangeCallback changeCallback;
+    VFSFile*           openFiles;      /* Catalog-backed files open now */
 } g_vfs = { 0 };
 
 /* Announce that a directory listing has changed; defined with the mutations. */
 static void VFS_DirectoryChanged(VRefNum vref, DirID dir);
 
+/* Write a volume's overlay to disk; defined at the end, with VFS_Sync. */
+static bool VFS_SyncVolume(VFSVolume* vol, bool retryFailed, bool closing);
+static void VFS_DiscardOverlay(VFSVolume* vol);
+
 /* VFS file wrapper — supports both HFS-backed and overlay-backed files */
 struct VFSFile {
     HFSFile* hfsFile;      /* HFS backing (NULL for overlay files) */
@@ -67,6 +74,7 @@ struct VFSFile {
     uint32_t memSize;       /* Current data size */
     uint32_t memCapacity;   /* Buffer capacity */
     uint32_t memPosition;   /* Read/write position */
+    VFSFile* next;          /* On g_vfs.openFiles, if HFS-backed */
 };
 
 /* Helper: Find volume by vref */
@@ -116,6 +124,25 @@ static bool VFS_ApplyOverlay(VFSVolume* vol, DirID dir,
     return true;
 }
 
+/*
+ * Helpers: catalog questions, answered from the name cache when it knows.
+ * Everything the catalog says is remembered; the overlay is still asked
+ * first by the callers, so these never see an edited entry.
+ */
+static bool VFS_CatalogLookup(VFSVolume* vol, DirID dir, const char* name, CatEntry* entry) {
+    if (VFS_NameCacheLookup(vol->vref, dir, name, entry)) return true;
+    if (!HFS_CatalogLookup(&vol->catalog, dir, name, entry)) return false;
+    VFS_NameCacheInsert(vol->vref, name, entry);
+    return true;
+}
+
+static bool VFS_CatalogGetByID(VFSVolume* vol, FileID id, CatEntry* entry) {
+    if (VFS_NameCacheGetByID(vol->vref, id, entry)) return true;
+    if (!HFS_CatalogGetByID(&vol->catalog, id, entry)) return false;
+    VFS_NameCacheInsert(vol->vref, NULL, entry);
+    return true;
+}
+
 /* Helper: Allocate overlay entry */
 static VFSOverlayEntry* VFS_AllocOverlay(VFSVolume* vol) {
     for (int i = 0; i < VFS_MAX_OVERLAY; i++) {
@@ -142,6 +169,9 @@ static VFSOverlayEntry* VFS_AllocOverlay(VFSVolume* vol) {
  */
 static void VFS_FinishMount(VFSVolume* vol)
 {
+    /* Nothing remembered under this vRefNum is about this disk */
+    VFS_NameCacheForgetVolume(vol->vref);
+
     extern void FM_RegisterVFSVolume(SInt16 vref, const char* name);
     FM_RegisterVFSVolume((SInt16)vol->vref, vol->name);
 }
@@ -166,6 +196,9 @@ bool VFS_Init(void) {
     memset(&g_vfs, 0, sizeof(g_vfs));
     g_vfs.nextVRef = 1;  /* Start VRefs at 1 */
 
+    /* Nothing is mounted yet, so the name cache can be tried out empty */
+    VFS_NameCacheSelfTest();
+
     /* FS_LOG_DEBUG("VFS: Initialized\n"); */
     g_vfs.initialized = true;
     return true;
@@ -181,6 +214,8 @@ void VFS_Shutdown(void) {
     /* Unmount all volumes */
     for (int i = 0; i < VFS_MAX_VOLUMES; i++) {
         if (g_vfs.volumes[i].mounted) {
+            VFS_SyncVolume(&g_vfs.volumes[i], true, true);
+            VFS_DiscardOverlay(&g_vfs.volumes[i]);
             HFS_CatalogClose(&g_vfs.volumes[i].catalog);
             HFS_VolumeUnmount(&g_vfs.volumes[i].volume);
             g_vfs.volumes[i].mounted = false;
@@ -258,6 +293,9 @@ bool VFS_MountBootVolume(const char* volName) {
     memset(vol->overlay, 0, sizeof(vol->overlay));
     vol->overlayCount = 0;
     vol->nextCNID = 5000;  /* Start above typical HFS CNIDs */
+    if (vol->volume.nextCNID > vol->nextCNID) {
+        vol->nextCNID = vol->volume.nextCNID;
+    }
     strncpy(vol->name, volName, sizeof(vol->name) - 1);
     vol->name[sizeof(vol->name) - 1] = '\0';
     VFS_FinishMount(vol);
@@ -349,29 +387,11 @@ bool VFS_MountATA(int ata_device_index, const char* volName, VRefNum* vref) {
     /* Disk is formatted, proceed with mounting */
     FS_LOG_DEBUG("VFS: Found valid HFS signature, mounting...\n");
 
-    /* Parse MDB into volume structure */
+    /* Parse MDB into volume structure: the counts, free blocks and
+     * next CNID along with the geometry, since the volume can be written */
+    HFS_VolumeParseMDB(&vol->volume, mdbSector);
     HFS_MDB* mdb = &vol->volume.mdb;
 
-    mdb->drSigWord    = be16_read(&mdbSector[0]);
-    mdb->drCrDate     = be32_read(&mdbSector[4]);
-    mdb->drLsMod      = be32_read(&mdbSector[8]);
-    mdb->drAtrb       = be16_read(&mdbSector[12]);
-    mdb->drNmFls      = be16_read(&mdbSector[14]);
-    mdb->drVBMSt      = be16_read(&mdbSector[16]);
-    mdb->drAllocPtr   = be16_read(&mdbSector[18]);
-    mdb->drNmAlBlks   = be16_read(&mdbSector[20]);
-    mdb->drAlBlkSiz   = be32_read(&mdbSector[22]);
-    mdb->drClpSiz     = be32_read(&mdbSector[26]);
-    mdb->drAlBlSt     = be16_read(&mdbSector[30]);
-    mdb->drNxtCNID    = be32_read(&mdbSector[32]);
-    mdb->drFreeBks    = be16_read(&mdbSector[36]);
-
-    /* Volume name - Pascal string: first byte is length */
-    memcpy(mdb->drVN, &mdbSector[38], 28);
-    if ((unsigned char)mdb->drVN[0] > 27) {
-        mdb->drVN[0] = 27;
-    }
-
     /* Validate allocation block size - must be non-zero and power of 2 */
     if (mdb->drAlBlkSiz == 0 || mdb->drAlBlkSiz > 65536 ||
         (mdb->drAlBlkSiz & (mdb->drAlBlkSiz - 1)) != 0) {
@@ -379,32 +399,6 @@ bool VFS_MountATA(int ata_device_index, const char* volName, VRefNum* vref) {
         return false;
     }
 
-    /* Catalog file */
-    mdb->drCTFlSize = be32_read(&mdbSector[142]);
-    for (int i = 0; i < 3; i++) {
-        mdb->drCTExtRec[i].startBlock = be16_read(&mdbSector[146 + i * 4]);
-        mdb->drCTExtRec[i].blockCount = be16_read(&mdbSector[148 + i * 4]);
-    }
-
-    /* Extents file */
-    mdb->drXTFlSize = be32_read(&mdbSector[126]);
-    for (int i = 0; i < 3; i++) {
-        mdb->drXTExtRec[i].startBlock = be16_read(&mdbSector[130 + i * 4]);
-        mdb->drXTExtRec[i].blockCount = be16_read(&mdbSector[132 + i * 4]);
-    }
-
-    /* Cache volume parameters */
-    vol->volume.alBlkSize = mdb->drAlBlkSiz;
-    vol->volume.alBlSt = mdb->drAlBlSt;
-    vol->volume.numAlBlks = mdb->drNmAlBlks;
-    vol->volume.vbmStart = mdb->drVBMSt;
-    vol->volume.catFileSize = mdb->drCTFlSize;
-    memcpy(vol->volume.catExtents, mdb->drCTExtRec, sizeof(vol->volume.catExtents));
-    vol->volume.extFileSize = mdb->drXTFlSize;
-    memcpy(vol->volume.extExtents, mdb->drXTExtRec, sizeof(vol->volume.extExtents));
-    vol->volume.nextCNID = mdb->drNxtCNID;
-    vol->volume.rootDirID = 2;  /* HFS root is always 2 */
-
     /* Mark volume as mounted */
     vol->volume.vRefNum = vol->vref;
     vol->volume.mounted = true;
@@ -419,7 +413,8 @@ bool VFS_MountATA(int ata_device_index, const char* volName, VRefNum* vref) {
     vol->mounted = true;
     memset(vol->overlay, 0, sizeof(vol->overlay));
     vol->overlayCount = 0;
-    vol->nextCNID = 5000;
+    /* Above anything created by an earlier session and written back */
+    vol->nextCNID = (vol->volume.nextCNID > 5000) ? vol->volume.nextCNID : 5000;
     strncpy(vol->name, volName, sizeof(vol->name) - 1);
     vol->name[sizeof(vol->name) - 1] = '\0';
     VFS_FinishMount(vol);
@@ -521,29 +516,11 @@ bool VFS_MountSDHCI(int drive_index, const char* volName, VRefNum* vref) {
     /* Disk is formatted, proceed with mounting */
     FS_LOG_DEBUG("VFS: Found valid HFS signature on SDHCI, mounting...\n");
 
-    /* Parse MDB into volume structure */
+    /* Parse MDB into volume structure: the counts, free blocks and
+     * next CNID along with the geometry, since the volume can be written */
+    HFS_VolumeParseMDB(&vol->volume, mdbSector);
     HFS_MDB* mdb = &vol->volume.mdb;
 
-    mdb->drSigWord    = be16_read(&mdbSector[0]);
-    mdb->drCrDate     = be32_read(&mdbSector[4]);
-    mdb->drLsMod      = be32_read(&mdbSector[8]);
-    mdb->drAtrb       = be16_read(&mdbSector[12]);
-    mdb->drNmFls      = be16_read(&mdbSector[14]);
-    mdb->drVBMSt      = be16_read(&mdbSector[16]);
-    mdb->drAllocPtr   = be16_read(&mdbSector[18]);
-    mdb->drNmAlBlks   = be16_read(&mdbSector[20]);
-    mdb->drAlBlkSiz   = be32_read(&mdbSector[22]);
-    mdb->drClpSiz     = be32_read(&mdbSector[26]);
-    mdb->drAlBlSt     = be16_read(&mdbSector[30]);
-    mdb->drNxtCNID    = be32_read(&mdbSector[32]);
-    mdb->drFreeBks    = be16_read(&mdbSector[36]);
-
-    /* Volume name - Pascal string: first byte is length */
-    memcpy(mdb->drVN, &mdbSector[38], 28);
-    if ((unsigned char)mdb->drVN[0] > 27) {
-        mdb->drVN[0] = 27;
-    }
-
     /* Validate allocation block size - must be non-zero and power of 2 */
     if (mdb->drAlBlkSiz == 0 || mdb->drAlBlkSiz > 65536 ||
         (mdb->drAlBlkSiz & (mdb->drAlBlkSiz - 1)) != 0) {
@@ -551,32 +528,6 @@ bool VFS_MountSDHCI(int drive_index, const char* volName, VRefNum* vref) {
         return false;
     }
 
-    /* Catalog file */
-    mdb->drCTFlSize = be32_read(&mdbSector[142]);
-    for (int i = 0; i < 3; i++) {
-        mdb->drCTExtRec[i].startBlock = be16_read(&mdbSector[146 + i * 4]);
-        mdb->drCTExtRec[i].blockCount = be16_read(&mdbSector[148 + i * 4]);
-    }
-
-    /* Extents file */
-    mdb->drXTFlSize = be32_read(&mdbSector[126]);
-    for (int i = 0; i < 3; i++) {
-        mdb->drXTExtRec[i].startBlock = be16_read(&mdbSector[130 + i * 4]);
-        mdb->drXTExtRec[i].blockCount = be16_read(&mdbSector[132 + i * 4]);
-    }
-
-    /* Cache volume parameters */
-    vol->volume.alBlkSize = mdb->drAlBlkSiz;
-    vol->volume.alBlSt = mdb->drAlBlSt;
-    vol->volume.numAlBlks = mdb->drNmAlBlks;
-    vol->volume.vbmStart = mdb->drVBMSt;
-    vol->volume.catFileSize = mdb->drCTFlSize;
-    memcpy(vol->volume.catExtents, mdb->drCTExtRec, sizeof(vol->volume.catExtents));
-    vol->volume.extFileSize = mdb->drXTFlSize;
-    memcpy(vol->volume.extExtents, mdb->drXTExtRec, sizeof(vol->volume.extExtents));
-    vol->volume.nextCNID = mdb->drNxtCNID;
-    vol->volume.rootDirID = 2;  /* HFS root is always 2 */
-
     /* Mark volume as mounted */
     vol->volume.vRefNum = vol->vref;
     vol->volume.mounted = true;
@@ -591,7 +542,8 @@ bool VFS_MountSDHCI(int drive_index, const char* volName, VRefNum* vref) {
     vol->mounted = true;
     memset(vol->overlay, 0, sizeof(vol->overlay));
     vol->overlayCount = 0;
-    vol->nextCNID = 5000;
+    /* Above anything created by an earlier session and written back */
+    vol->nextCNID = (vol->volume.nextCNID > 5000) ? vol->volume.nextCNID : 5000;
     strncpy(vol->name, volName, sizeof(vol->name) - 1);
     vol->name[sizeof(vol->name) - 1] = '\0';
     VFS_FinishMount(vol);
@@ -621,8 +573,13 @@ bool VFS_Unmount(VRefNum vref) {
         return false;
     }
 
+    /* Whatever the overlay holds goes to disk before the disk goes */
+    VFS_SyncVolume(vol, true, true);
+    VFS_DiscardOverlay(vol);
+
     /* Close catalog */
     HFS_CatalogClose(&vol->catalog);
+    VFS_NameCacheForgetVolume(vref);
 
     /* Unmount volume */
     HFS_VolumeUnmount(&vol->volume);
@@ -849,6 +806,12 @@ bool VFS_Enumerate(VRefNum vref, DirID dir, CatEntry* entries, int maxEntries, i
         int catCount = 0;
         HFS_CatalogEnumerate(&vol->catalog, dir, entries, maxEntries, &catCount);
 
+        /* A listed folder's items are about to be asked for by ID (icons,
+         * Get Info, the window title path): remember them by CNID */
+        for (int i = 0; i < catCount; i++) {
+            VFS_NameCacheInsert(vref, NULL, &entries[i]);
+        }
+
         /* Answer from the overlay wherever it has something to say. */
         for (int i = 0; i < catCount && n < maxEntries; i++) {
             CatEntry current;
@@ -907,7 +870,7 @@ bool VFS_Lookup(VRefNum vref, DirID dir, const char* name, CatEntry* entry) {
     }
 
     /* Fall through to catalog */
-    if (!HFS_CatalogLookup(&vol->catalog, dir, name, entry)) return false;
+    if (!VFS_CatalogLookup(vol, dir, name, entry)) return false;
 
     /* Check if catalog result was deleted or moved away */
     VFSOverlayEntry* oe = VFS_FindOverlay(vol, entry->id);
@@ -937,7 +900,7 @@ bool VFS_GetByID(VRefNum vref, FileID id, CatEntry* entry) {
         return true;
     }
 
-    if (!HFS_CatalogGetByID(&vol->catalog, id, &catalogEntry)) return false;
+    if (!VFS_CatalogGetByID(vol, id, &catalogEntry)) return false;
     *entry = catalogEntry;
     return true;
 }
@@ -999,9 +962,20 @@ VFSFile* VFS_OpenFile(VRefNum vref, FileID id, bool resourceFork) {
      * buffered, and thrown away on close. */
     vfsFile->fileID = id;
 
+    /* Known to VFS_Sync, which must not move the blocks it reads */
+    vfsFile->next = g_vfs.openFiles;
+    g_vfs.openFiles = vfsFile;
+
     return vfsFile;
 }
 
+/*
+ * Resolve a '/'-separated path from the root one component at a time with
+ * VFS_Lookup, then open by ID. This went through HFS_FileOpenByPath, which
+ * passed the catalog's volume pointer where a vRefNum belongs and opened
+ * the catalog's copy of the file, missing any contents saved in the
+ * overlay. Each component is now a name cache probe on the usual path.
+ */
 VFSFile* VFS_OpenByPath(VRefNum vref, const char* path, bool resourceFork) {
     if (!g_vfs.initialized || !path) return NULL;
 
@@ -1010,25 +984,56 @@ VFSFile* VFS_OpenByPath(VRefNum vref, const char* path, bool resourceFork) {
         return NULL;
     }
 
-    HFSFile* hfsFile = HFS_FileOpenByPath(&vol->catalog, path, resourceFork);
-    if (!hfsFile) return NULL;
+    DirID dir = 2;   /* root */
+    FileID target = 0;
+    const char* cursor = path;
 
-    VFSFile* vfsFile = (VFSFile*)NewPtr(sizeof(VFSFile));
-    if (!vfsFile) {
-        HFS_FileClose(hfsFile);
-        return NULL;
-    }
+    while (*cursor != '\0') {
+        while (*cursor == '/') cursor++;
+        if (*cursor == '\0') break;
 
-    vfsFile->hfsFile = hfsFile;
-    vfsFile->vref = vref;
+        const char* end = cursor;
+        while (*end != '\0' && *end != '/') end++;
 
-    return vfsFile;
+        size_t len = (size_t)(end - cursor);
+        if (len > 31) return NULL;
+
+        char component[32];
+        memcpy(component, cursor, len);
+        component[len] = '\0';
+
+        CatEntry entry;
+        if (!VFS_Lookup(vref, dir, component, &entry)) {
+            FS_LOG_DEBUG("VFS_OpenByPath: '%s' not found in '%s'\n", component, path);
+            return NULL;
+        }
+
+        /* Directories along the way, a file at the end */
+        while (*end == '/') end++;
+        if (*end == '\0') {
+            if (entry.kind != kNodeFile) return NULL;
+            target = entry.id;
+        } else {
+            if (entry.kind != kNodeDir) return NULL;
+            dir = entry.id;
+        }
+        cursor = end;
+    }
+
+    if (target == 0) return NULL;
+    return VFS_OpenFile(vref, target, resourceFork);
 }
 
 void VFS_CloseFile(VFSFile* file) {
     if (!file) return;
 
     if (file->hfsFile) {
+        for (VFSFile** link = &g_vfs.openFiles; *link; link = &(*link)->next) {
+            if (*link == file) {
+                *link = file->next;
+                break;
+            }
+        }
         HFS_FileClose(file->hfsFile);
     }
 
@@ -1171,6 +1176,10 @@ bool VFS_MoveOverlay(VRefNum vref, FileID id, DirID newParent,
     VFSVolume* vol = VFS_FindVolume(vref);
     if (!vol || !vol->mounted || !current) return false;
 
+    /* The overlay answers for this item from here on; the name cache
+     * must not hold on to the catalog's version of it */
+    VFS_NameCacheForgetID(vref, id);
+
     /* Check if already in overlay */
     VFSOverlayEntry* oe = VFS_FindOverlay(vol, id);
     if (oe) {
@@ -1220,6 +1229,9 @@ void VFS_SetChangeCallback(VFS_ChangeCallback callback) {
  * to do about it.
  */
 static void VFS_DirectoryChanged(VRefNum vref, DirID dir) {
+    /* Whatever the name cache holds from this directory may be out of date */
+    VFS_NameCacheForgetDir(vref, dir);
+
     if (g_vfs.changeCallback) {
         g_vfs.changeCallback(vref, dir);
     }
@@ -1304,6 +1316,8 @@ bool VFS_Rename(VRefNum vref, FileID id, const char* newName) {
     VFSVolume* vol = VFS_FindVolume(vref);
     if (!vol || !vol->mounted) return false;
 
+    VFS_NameCacheForgetID(vref, id);
+
     /* Check if already in overlay */
     VFSOverlayEntry* oe = VFS_FindOverlay(vol, id);
     if (oe) {
@@ -1322,7 +1336,7 @@ bool VFS_Rename(VRefNum vref, FileID id, const char* newName) {
 
     /* Create new overlay entry from catalog data */
     CatEntry catEntry;
-    if (!HFS_CatalogGetByID(&vol->catalog, id, &catEntry)) {
+    if (!VFS_CatalogGetByID(vol, id, &catEntry)) {
         return false;
     }
 
@@ -1354,6 +1368,8 @@ bool VFS_Delete(VRefNum vref, FileID id) {
     VFSVolume* vol = VFS_FindVolume(vref);
     if (!vol || !vol->mounted) return false;
 
+    VFS_NameCacheForgetID(vref, id);
+
     /* Check if it's an overlay-created entry */
     VFSOverlayEntry* oe = VFS_FindOverlay(vol, id);
     if (oe) {
@@ -1400,6 +1416,8 @@ bool VFS_SetCatEntryInfo(VRefNum vref, FileID id,
     VFSVolume* vol = VFS_FindVolume(vref);
     if (!vol || !vol->mounted) return false;
 
+    VFS_NameCacheForgetID(vref, id);
+
     /* Check if already in overlay */
     VFSOverlayEntry* oe = VFS_FindOverlay(vol, id);
     if (oe) {
@@ -1411,7 +1429,7 @@ bool VFS_SetCatEntryInfo(VRefNum vref, FileID id,
 
     /* Create overlay entry from catalog */
     CatEntry catEntry;
-    if (!HFS_CatalogGetByID(&vol->catalog, id, &catEntry)) return false;
+    if (!VFS_CatalogGetByID(vol, id, &catEntry)) return false;
 
     oe = VFS_AllocOverlay(vol);
     if (!oe) return false;
@@ -1422,4 +1440,279 @@ bool VFS_SetCatEntryInfo(VRefNum vref, FileID id,
     oe->entry.creator = creator;
     oe->entry.flags = flags;
     return true;
-}
\ No newline at end of file
+}
+
+/*
+ * Writing the overlay back
+ *
+ * Everything above changes the overlay, not the disk, so until now a
+ * folder made, a file saved or a document renamed lasted exactly as long
+ * as the machine stayed up. VFS_Sync applies each overlay entry to the
+ * catalog, the file's blocks and the bitmap, then lets the entry go: from
+ * then on the catalog answers for it, as it does for everything that was
+ * never changed. VFS_Idle does this in the background every couple of
+ * seconds, and unmounting does it one last time.
+ *
+ * The order matters. Moves and renames of existing items go first, so an
+ * item moved out of a folder is out of it before the folder is deleted;
+ * a folder being deleted with anything still in it that the overlay has
+ * somewhere else to put waits for that. Creates wait for a created parent.
+ * Entries whose turn has not come, or whose write failed (a name taken by
+ * something that is about to be deleted, say), are tried again in another
+ * pass while passes make progress. What is left stays in the overlay,
+ * working exactly as before. An entry that has failed
+ * VFS_SYNC_MAX_FAILURES times is left alone by VFS_Idle, so a disk that
+ * is full is not rewritten every two seconds; VFS_Sync and unmount still
+ * try.
+ *
+ * Writing a file's contents moves it to new blocks and frees the old ones,
+ * and deleting it frees them all, but a file already open from the catalog
+ * keeps reading the extents it was opened with. So an entry that would do
+ * either to an open file - or delete a folder with an open file somewhere
+ * inside - waits until the file is closed, without counting as a failure.
+ * Unmounting does not wait: nothing reads the volume after that.
+ */
+
+#define VFS_SYNC_MAX_FAILURES   3
+#define VFS_SYNC_MAX_PASSES     8
+#define VFS_IDLE_TICKS          120     /* two seconds */
+#define VFS_DELETE_MAX_DEPTH    16
+
+/* Would syncing oe free blocks that an open file is reading? */
+static bool VFS_SyncBusy(VFSVolume* vol, const VFSOverlayEntry* oe) {
+    if (!oe->deleted && !oe->fileData) return false;
+
+    for (VFSFile* f = g_vfs.openFiles; f; f = f->next) {
+        if (f->vref != vol->vref) continue;
+        if (f->fileID == oe->id) return true;
+        if (!oe->deleted || oe->entry.kind != kNodeDir) continue;
+
+        /* Inside the folder being deleted, however deep */
+        CatEntry entry;
+        FileID id = f->fileID;
+        for (int depth = 0; depth < VFS_DELETE_MAX_DEPTH; depth++) {
+            if (!HFS_CatalogGetByID(&vol->catalog, id, &entry)) break;
+            if (entry.parent == oe->id) return true;
+            if (entry.parent == vol->volume.rootDirID) break;
+            id = entry.parent;
+        }
+    }
+    return false;
+}
+
+/* The overlay is done with this entry: the catalog has it now */
+static void VFS_ReleaseOverlay(VFSVolume* vol, VFSOverlayEntry* oe) {
+    if (oe->fileData) {
+        DisposePtr((Ptr)oe->fileData);
+        oe->fileData = NULL;
+        oe->fileDataSize = 0;
+    }
+    oe->active = false;
+    vol->overlayCount--;
+    VFS_NameCacheForgetID(vol->vref, oe->id);
+}
+
+/* The catalog has rewritten id's record, and its folder's valence with it:
+ * the name cache's copies of both are out of date */
+static void VFS_SyncRewrote(VFSVolume* vol, FileID id, DirID parent) {
+    VFS_NameCacheForgetID(vol->vref, id);
+    VFS_NameCacheForgetID(vol->vref, parent);
+}
+
+static bool VFS_SyncIsFolder(VFSVolume* vol, DirID dir) {
+    CatEntry entry;
+    if (dir == vol->volume.rootDirID) return true;
+    return HFS_CatalogGetByID(&vol->catalog, dir, &entry) && entry.kind == kNodeDir;
+}
+
+/* A created entry: its record, then its data */
+static bool VFS_SyncCreate(VFSVolume* vol, VFSOverlayEntry* oe) {
+    CatEntry entry = oe->entry;
+    entry.id = oe->id;
+    entry.parent = oe->moved ? oe->newParent : oe->entry.parent;
+
+    if (!HFS_CatalogCreate(&vol->catalog, &entry)) return false;
+    VFS_SyncRewrote(vol, oe->id, entry.parent);
+
+    /* On disk now, whatever happens to the data: if that write fails the
+     * entry is retried as an existing file with contents to write */
+    oe->created = false;
+    oe->moved = false;
+    oe->renamed = false;
+
+    if (entry.kind == kNodeFile && oe->fileData) {
+        if (!HFS_FileWriteData(&vol->catalog, oe->id, false, oe->fileData, oe->fileDataSize)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* An entry from the catalog: where it lives, its contents, its info */
+static bool VFS_SyncExisting(VFSVolume* vol, VFSOverlayEntry* oe) {
+    CatEntry disk;
+
+    /* Deleted along with a folder, or never written: nothing to change */
+    if (!HFS_CatalogGetByID(&vol->catalog, oe->id, &disk)) return true;
+
+    if (oe->moved || oe->renamed) {
+        DirID parent = oe->moved ? oe->newParent : disk.parent;
+        const char* name = oe->renamed ? oe->entry.name : NULL;
+        if (!HFS_CatalogMove(&vol->catalog, oe->id, parent, name)) return false;
+        VFS_SyncRewrote(vol, oe->id, disk.parent);
+        VFS_NameCacheForgetID(vol->vref, parent);
+        oe->moved = false;
+        oe->renamed = false;
+    }
+
+    if (oe->fileData && disk.kind == kNodeFile) {
+        if (!HFS_FileWriteData(&vol->catalog, oe->id, false, oe->fileData, oe->fileDataSize)) {
+            return false;
+        }
+        DisposePtr((Ptr)oe->fileData);
+        oe->fileData = NULL;
+        oe->fileDataSize = 0;
+    }
+
+    /* Type, creator, flags and dates, as the overlay last had them */
+    CatEntry info = oe->entry;
+    info.id = oe->id;
+    return HFS_CatalogSetInfo(&vol->catalog, &info);
+}
+
+/* Delete id from the disk; a folder goes with everything in it */
+static bool VFS_SyncDelete(VFSVolume* vol, FileID id, int depth) {
+    CatEntry disk;
+
+    if (!HFS_CatalogGetByID(&vol->catalog, id, &disk)) return true;   /* already gone */
+    if (disk.kind == kNodeFile) {
+        if (!HFS_FileDelete(&vol->catalog, id)) return false;
+        VFS_SyncRewrote(vol, id, disk.parent);
+        return true;
+    }
+    if (depth >= VFS_DELETE_MAX_DEPTH) return false;
+
+    /* A few children at a time: this recurses, and each level holds a batch */
+    for (int batches = 0; batches < 1024; batches++) {
+        CatEntry children[8];
+        int count = 0;
+
+        if (!HFS_CatalogEnumerate(&vol->catalog, id, children, 8, &count)) return false;
+        if (count == 0) {
+            if (!HFS_CatalogDelete(&vol->catalog, id)) return false;
+            VFS_SyncRewrote(vol, id, disk.parent);
+            return true;
+        }
+
+        for (int i = 0; i < count; i++) {
+            VFSOverlayEntry* child = VFS_FindOverlay(vol, children[i].id);
+            if (child && !child->deleted) return false;   /* still going somewhere */
+            if (!VFS_SyncDelete(vol, children[i].id, depth + 1)) return false;
+        }
+    }
+    return false;
+}
+
+static bool VFS_SyncVolume(VFSVolume* vol, bool retryFailed, bool closing) {
+    if (!vol->mounted || !vol->catalog.bt.nodeBuffer || vol->volume.bd.readonly) return false;
+    if (vol->overlayCount == 0) return true;
+
+    bool attempted[VFS_MAX_OVERLAY];
+    memset(attempted, 0, sizeof(attempted));
+
+    for (int pass = 0; pass < VFS_SYNC_MAX_PASSES; pass++) {
+        bool progress = false;
+
+        /* Existing entries, then deletes, then creates */
+        for (int phase = 0; phase < 3; phase++) {
+            for (int i = 0; i < VFS_MAX_OVERLAY; i++) {
+                VFSOverlayEntry* oe = &vol->overlay[i];
+                bool done;
+
+                if (!oe->active) continue;
+                if (!retryFailed && oe->syncFailures >= VFS_SYNC_MAX_FAILURES) continue;
+                if (!closing && VFS_SyncBusy(vol, oe)) continue;
+
+                if (oe->deleted) {
+                    if (phase != 1) continue;
+                    done = VFS_SyncDelete(vol, oe->id, 0);
+                } else if (oe->created) {
+                    if (phase != 2) continue;
+                    DirID parent = oe->moved ? oe->newParent : oe->entry.parent;
+                    VFSOverlayEntry* po = VFS_FindOverlay(vol, parent);
+                    if (po && po->created && !po->deleted) continue;    /* parent first */
+                    if (!VFS_SyncIsFolder(vol, parent)) {
+                        /* Its folder was deleted before it was ever written */
+                        VFS_ReleaseOverlay(vol, oe);
+                        progress = true;
+                        continue;
+                    }
+                    done = VFS_SyncCreate(vol, oe);
+                } else {
+                    if (phase != 0) continue;
+                    done = VFS_SyncExisting(vol, oe);
+                }
+
+                attempted[i] = true;
+                if (done) {
+                    VFS_ReleaseOverlay(vol, oe);
+                    progress = true;
+                }
+            }
+        }
+        if (!progress) break;
+    }
+
+    bool complete = true;
+    for (int i = 0; i < VFS_MAX_OVERLAY; i++) {
+        VFSOverlayEntry* oe = &vol->overlay[i];
+        if (!oe->active) continue;
+        complete = false;
+        if (attempted[i] && oe->syncFailures < 255) {
+            oe->syncFailures++;
+        }
+    }
+
+    if (!HFS_VolumeFlush(&vol->volume)) return false;
+
+    if (!complete) {
+        FS_LOG_DEBUG("VFS: %d overlay entries on vRef %d not yet written\n",
+                     vol->overlayCount, vol->vref);
+    }
+    return complete;
+}
+
+/* What could not be written dies with the mount */
+static void VFS_DiscardOverlay(VFSVolume* vol) {
+    for (int i = 0; i < VFS_MAX_OVERLAY; i++) {
+        if (vol->overlay[i].active) {
+            VFS_ReleaseOverlay(vol, &vol->overlay[i]);
+        }
+    }
+}
+
+bool VFS_Sync(VRefNum vref) {
+    if (!g_vfs.initialized) return false;
+
+    VFSVolume* vol = VFS_FindVolume(vref);
+    if (!vol) return false;
+    return VFS_SyncVolume(vol, true, false);
+}
+
+void VFS_Idle(void) {
+    static UInt32 lastSync = 0;
+    extern UInt32 TickCount(void);
+
+    if (!g_vfs.initialized) return;
+
+    UInt32 now = TickCount();
+    if (now - lastSync < VFS_IDLE_TICKS) return;
+    lastSync = now;
+
+    for (int i = 0; i < VFS_MAX_VOLUMES; i++) {
+        VFSVolume* vol = &g_vfs.volumes[i];
+        if (vol->mounted && vol->overlayCount > 0) {
+            VFS_SyncVolume(vol, false, false);
+        }
+    }
+}
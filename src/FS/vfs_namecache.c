@@ -0,0 +1,414 @@
+/*
+ * vfs_namecache.c - Catalog name and CNID cache for the VFS
+ *
+ * Path resolution asks the catalog the same questions over and over: every
+ * Open dialog, every Finder window and every alias resolves "System
+ * Folder", then "Preferences", and so on, one component at a time, and the
+ * Finder calls VFS_GetNameByID for the same handful of folders on every
+ * redraw. Each answer was a B-tree descent from the catalog root.
+ *
+ * This remembers the answers. An entry is a catalog record as the catalog
+ * returned it (CatEntry), reachable by CNID and, if it was looked up by
+ * name, by (parent, case-folded name) - the name it was asked for by, not
+ * necessarily the one it has, since the catalog matches names the way
+ * HFS_CatalogLookup does. The overlay is consulted before the cache, as it
+ * was before the catalog, so edits in the overlay are never hidden by it.
+ *
+ * Invalidation is precise rather than wholesale: VFS_DirectoryChanged
+ * drops what is filed under that directory, an overlay mutation drops that
+ * one item, and a volume is forgotten on mount and unmount so a reused
+ * vRefNum never answers from the previous disk. Entries live in a fixed
+ * table (kNameCacheEntries) under LRU replacement.
+ *
+ * Copyright (c) 2025 - System 7.1 Portable Project
+ */
+
+#include "FS/vfs_namecache.h"
+#include "FS/FSLogging.h"
+#include <string.h>
+
+#define kNameCacheEntries   512
+#define kNameCacheBuckets   256            /* power of two, per index */
+#define kNameCacheNone      (-1)
+
+typedef struct NameCacheEntry {
+    CatEntry  entry;
+    VRefNum   vref;
+    bool      used;
+    uint8_t   keyLength;    /* 0: not filed by name */
+    char      key[31];      /* folded lookup name */
+    int16_t   nameNext;
+    int16_t   idNext;
+    int16_t   lruPrev;      /* towards most recently used */
+    int16_t   lruNext;
+} NameCacheEntry;
+
+static NameCacheEntry gNames[kNameCacheEntries];
+static int16_t gNameBuckets[kNameCacheBuckets];
+static int16_t gIDBuckets[kNameCacheBuckets];
+static int16_t gLruHead = kNameCacheNone;  /* most recently used */
+static int16_t gLruTail = kNameCacheNone;
+static int16_t gFreeHead = kNameCacheNone; /* chained through lruNext */
+static bool    gNameCacheReady = false;
+static VFSNameCacheStats gNameStats;
+
+static void NameCacheInit(void) {
+    for (int b = 0; b < kNameCacheBuckets; b++) {
+        gNameBuckets[b] = kNameCacheNone;
+        gIDBuckets[b] = kNameCacheNone;
+    }
+    for (int i = 0; i < kNameCacheEntries; i++) {
+        gNames[i].used = false;
+        gNames[i].lruNext = (i + 1 < kNameCacheEntries) ? (int16_t)(i + 1) : kNameCacheNone;
+    }
+    gFreeHead = 0;
+    gLruHead = kNameCacheNone;
+    gLruTail = kNameCacheNone;
+    memset(&gNameStats, 0, sizeof(gNameStats));
+    gNameStats.capacity = kNameCacheEntries;
+    gNameCacheReady = true;
+}
+
+/* Case-fold the way HFS_CompareCatalogKeys does; returns the length */
+static uint8_t FoldName(const char* name, char* key) {
+    uint8_t n = 0;
+    while (name[n] && n < 31) {
+        char c = name[n];
+        key[n++] = (c >= 'a' && c <= 'z') ? (char)(c - 32) : c;
+    }
+    return n;
+}
+
+static uint32_t NameHash(VRefNum vref, DirID parent, const char* key, uint8_t len) {
+    uint32_t h = 2166136261u ^ (uint32_t)(uint16_t)vref ^ (parent * 31u);
+    for (uint8_t i = 0; i < len; i++) {
+        h = (h ^ (uint8_t)key[i]) * 16777619u;
+    }
+    return h & (kNameCacheBuckets - 1);
+}
+
+static uint32_t IDHash(VRefNum vref, FileID id) {
+    return (id ^ ((uint32_t)(uint16_t)vref << 7)) & (kNameCacheBuckets - 1);
+}
+
+static void LruUnlink(int16_t i) {
+    NameCacheEntry* e = &gNames[i];
+    if (e->lruPrev != kNameCacheNone) gNames[e->lruPrev].lruNext = e->lruNext;
+    else gLruHead = e->lruNext;
+    if (e->lruNext != kNameCacheNone) gNames[e->lruNext].lruPrev = e->lruPrev;
+    else gLruTail = e->lruPrev;
+}
+
+static void LruPushFront(int16_t i) {
+    NameCacheEntry* e = &gNames[i];
+    e->lruPrev = kNameCacheNone;
+    e->lruNext = gLruHead;
+    if (gLruHead != kNameCacheNone) gNames[gLruHead].lruPrev = i;
+    gLruHead = i;
+    if (gLruTail == kNameCacheNone) gLruTail = i;
+}
+
+static void LruTouch(int16_t i) {
+    if (gLruHead != i) {
+        LruUnlink(i);
+        LruPushFront(i);
+    }
+}
+
+static void UnlinkName(int16_t i) {
+    NameCacheEntry* e = &gNames[i];
+    if (e->keyLength == 0) return;
+
+    int16_t* link = &gNameBuckets[NameHash(e->vref, e->entry.parent, e->key, e->keyLength)];
+    while (*link != kNameCacheNone && *link != i) {
+        link = &gNames[*link].nameNext;
+    }
+    if (*link == i) *link = e->nameNext;
+    e->keyLength = 0;
+}
+
+/* Drop entry i from both indexes and the LRU list */
+static void NameCacheRemove(int16_t i) {
+    NameCacheEntry* e = &gNames[i];
+
+    UnlinkName(i);
+
+    int16_t* link = &gIDBuckets[IDHash(e->vref, e->entry.id)];
+    while (*link != kNameCacheNone && *link != i) {
+        link = &gNames[*link].idNext;
+    }
+    if (*link == i) *link = e->idNext;
+
+    LruUnlink(i);
+    e->used = false;
+    e->lruNext = gFreeHead;
+    gFreeHead = i;
+    gNameStats.entries--;
+}
+
+static int16_t FindID(VRefNum vref, FileID id) {
+    for (int16_t i = gIDBuckets[IDHash(vref, id)]; i != kNameCacheNone; i = gNames[i].idNext) {
+        if (gNames[i].entry.id == id && gNames[i].vref == vref) return i;
+    }
+    return kNameCacheNone;
+}
+
+static int16_t FindName(VRefNum vref, DirID parent, const char* key, uint8_t len) {
+    for (int16_t i = gNameBuckets[NameHash(vref, parent, key, len)];
+         i != kNameCacheNone; i = gNames[i].nameNext) {
+        NameCacheEntry* e = &gNames[i];
+        if (e->keyLength == len && e->entry.parent == parent && e->vref == vref &&
+            memcmp(e->key, key, len) == 0) {
+            return i;
+        }
+    }
+    return kNameCacheNone;
+}
+
+bool VFS_NameCacheLookup(VRefNum vref, DirID parent, const char* name, CatEntry* entry) {
+    char key[31];
+    uint8_t len;
+
+    if (!name || !entry) return false;
+    if (!gNameCacheReady) NameCacheInit();
+
+    len = FoldName(name, key);
+    int16_t i = (len > 0) ? FindName(vref, parent, key, len) : kNameCacheNone;
+    if (i == kNameCacheNone) {
+        gNameStats.nameMisses++;
+        return false;
+    }
+    LruTouch(i);
+    *entry = gNames[i].entry;
+    gNameStats.nameHits++;
+    return true;
+}
+
+bool VFS_NameCacheGetByID(VRefNum vref, FileID id, CatEntry* entry) {
+    if (!entry) return false;
+    if (!gNameCacheReady) NameCacheInit();
+
+    int16_t i = FindID(vref, id);
+    if (i == kNameCacheNone) {
+        gNameStats.idMisses++;
+        return false;
+    }
+    LruTouch(i);
+    *entry = gNames[i].entry;
+    gNameStats.idHits++;
+    return true;
+}
+
+void VFS_NameCacheInsert(VRefNum vref, const char* name, const CatEntry* entry) {
+    char key[31];
+    uint8_t len = 0;
+
+    if (!entry) return;
+    if (!gNameCacheReady) NameCacheInit();
+
+    if (name) {
+        len = FoldName(name, key);
+    }
+
+    int16_t i = FindID(vref, entry->id);
+    if (i != kNameCacheNone) {
+        NameCacheEntry* e = &gNames[i];
+        /* Known by ID already: refresh it, and file it under this name
+         * unless it is filed under one already */
+        if (e->entry.parent != entry->parent) {
+            UnlinkName(i);
+        }
+        e->entry = *entry;
+        LruTouch(i);
+        if (len == 0 || e->keyLength != 0) return;
+    } else {
+        if (gFreeHead == kNameCacheNone) {
+            NameCacheRemove(gLruTail);
+            gNameStats.evictions++;
+        }
+        i = gFreeHead;
+        NameCacheEntry* e = &gNames[i];
+        gFreeHead = e->lruNext;
+        e->entry = *entry;
+        e->vref = vref;
+        e->used = true;
+        e->keyLength = 0;
+
+        uint32_t b = IDHash(vref, entry->id);
+        e->idNext = gIDBuckets[b];
+        gIDBuckets[b] = i;
+        LruPushFront(i);
+        gNameStats.entries++;
+        gNameStats.inserts++;
+    }
+
+    /* Two names answering for one key would be ambiguous; the newer wins */
+    if (len > 0) {
+        int16_t other = FindName(vref, entry->parent, key, len);
+        if (other != kNameCacheNone) {
+            UnlinkName(other);
+        }
+        NameCacheEntry* e = &gNames[i];
+        memcpy(e->key, key, len);
+        e->keyLength = len;
+        uint32_t b = NameHash(vref, entry->parent, key, len);
+        e->nameNext = gNameBuckets[b];
+        gNameBuckets[b] = i;
+    }
+}
+
+void VFS_NameCacheForgetDir(VRefNum vref, DirID parent) {
+    if (!gNameCacheReady) return;
+
+    for (int16_t i = gLruHead; i != kNameCacheNone; ) {
+        int16_t next = gNames[i].lruNext;
+        if (gNames[i].vref == vref && gNames[i].entry.parent == parent) {
+            NameCacheRemove(i);
+            gNameStats.invalidations++;
+        }
+        i = next;
+    }
+}
+
+void VFS_NameCacheForgetID(VRefNum vref, FileID id) {
+    if (!gNameCacheReady) return;
+
+    int16_t i = FindID(vref, id);
+    if (i != kNameCacheNone) {
+        NameCacheRemove(i);
+        gNameStats.invalidations++;
+    }
+}
+
+void VFS_NameCacheForgetVolume(VRefNum vref) {
+    if (!gNameCacheReady) return;
+
+    for (int16_t i = gLruHead; i != kNameCacheNone; ) {
+        int16_t next = gNames[i].lruNext;
+        if (gNames[i].vref == vref) {
+            NameCacheRemove(i);
+            gNameStats.invalidations++;
+        }
+        i = next;
+    }
+}
+
+void VFS_GetNameCacheStats(VFSNameCacheStats* stats) {
+    if (!stats) return;
+    if (!gNameCacheReady) NameCacheInit();
+    memcpy(stats, &gNameStats, sizeof(*stats));
+}
+
+/*
+ * VFS_NameCacheSelfTest - insert, look up, move and forget entries filed
+ * under a vRefNum no volume is given. Run from VFS_Init, before anything is
+ * mounted, so the table starts and ends empty; silent unless it fails.
+ */
+#define kNameCacheTestVRef  0
+
+static bool gNameTestFailed;
+
+static void NameTestCheck(bool ok, const char* what) {
+    if (!ok && !gNameTestFailed) {
+        FS_LOG_ERROR("NAME CACHE SELFTEST FAILED: %s\n", what);
+        gNameTestFailed = true;
+    }
+}
+
+static void NameTestEntry(CatEntry* entry, FileID id, DirID parent, const char* name) {
+    memset(entry, 0, sizeof(*entry));
+    strncpy(entry->name, name, sizeof(entry->name) - 1);
+    entry->kind = kNodeDir;
+    entry->parent = parent;
+    entry->id = id;
+}
+
+/* Found by that name under that parent, and by ID, as that entry */
+static bool NameTestFinds(DirID parent, const char* name, FileID id) {
+    CatEntry byName, byID;
+    return VFS_NameCacheLookup(kNameCacheTestVRef, parent, name, &byName) &&
+           byName.id == id && byName.parent == parent &&
+           VFS_NameCacheGetByID(kNameCacheTestVRef, id, &byID) &&
+           byID.id == id && byID.parent == parent;
+}
+
+static bool NameTestMisses(DirID parent, const char* name) {
+    CatEntry entry;
+    return !VFS_NameCacheLookup(kNameCacheTestVRef, parent, name, &entry);
+}
+
+void VFS_NameCacheSelfTest(void) {
+    VFSNameCacheStats saved;
+    CatEntry entry;
+    char name[16];
+
+    if (!gNameCacheReady) NameCacheInit();
+    saved = gNameStats;
+    gNameTestFailed = false;
+
+    /* Insert, and look up under another case */
+    NameTestEntry(&entry, 100, 2, "System Folder");
+    VFS_NameCacheInsert(kNameCacheTestVRef, entry.name, &entry);
+    NameTestCheck(NameTestFinds(2, "SYSTEM folder", 100), "lookup after insert");
+    NameTestCheck(NameTestMisses(2, "System"), "prefix of a name");
+    NameTestCheck(NameTestMisses(3, "System Folder"), "same name, other parent");
+    NameTestCheck(!VFS_NameCacheGetByID(kNameCacheTestVRef + 1, 100, &entry), "other volume");
+
+    /* Known by ID first, then by name */
+    NameTestEntry(&entry, 101, 100, "Preferences");
+    VFS_NameCacheInsert(kNameCacheTestVRef, NULL, &entry);
+    NameTestCheck(NameTestMisses(100, "Preferences"), "filed by ID only");
+    VFS_NameCacheInsert(kNameCacheTestVRef, entry.name, &entry);
+    NameTestCheck(NameTestFinds(100, "preferences", 101), "name added to an ID entry");
+
+    /* Moved and renamed, as the VFS does it: forget the item, then the
+     * catalog's new answer comes back in */
+    VFS_NameCacheForgetID(kNameCacheTestVRef, 101);
+    NameTestCheck(NameTestMisses(100, "Preferences"), "stale after forgetting the item");
+    NameTestEntry(&entry, 101, 2, "Old Preferences");
+    VFS_NameCacheInsert(kNameCacheTestVRef, entry.name, &entry);
+    NameTestCheck(NameTestFinds(2, "Old Preferences", 101), "lookup after move");
+    NameTestCheck(NameTestMisses(100, "Preferences"), "old name after move");
+
+    /* Moved without being forgotten: refiled under the new parent */
+    NameTestEntry(&entry, 101, 100, "Old Preferences");
+    VFS_NameCacheInsert(kNameCacheTestVRef, entry.name, &entry);
+    NameTestCheck(NameTestFinds(100, "Old Preferences", 101), "refresh under a new parent");
+    NameTestCheck(NameTestMisses(2, "Old Preferences"), "old parent after refresh");
+
+    /* A second item under a name already taken: the newer one answers */
+    NameTestEntry(&entry, 102, 100, "OLD PREFERENCES");
+    VFS_NameCacheInsert(kNameCacheTestVRef, entry.name, &entry);
+    NameTestCheck(NameTestFinds(100, "Old Preferences", 102), "newer of two names");
+    NameTestCheck(VFS_NameCacheGetByID(kNameCacheTestVRef, 101, &entry), "older kept by ID");
+
+    /* A directory changed: what is filed under it goes, nothing else */
+    VFS_NameCacheForgetDir(kNameCacheTestVRef, 100);
+    NameTestCheck(NameTestMisses(100, "Old Preferences"), "stale after directory change");
+    NameTestCheck(!VFS_NameCacheGetByID(kNameCacheTestVRef, 102, &entry), "stale ID after directory change");
+    NameTestCheck(NameTestFinds(2, "System Folder", 100), "other directory kept");
+
+    /* Full: the least recently used goes, one touched on the way survives */
+    for (int i = 0; i < kNameCacheEntries + 8 && !gNameTestFailed; i++) {
+        if (i == kNameCacheEntries / 2) {
+            NameTestCheck(NameTestFinds(2, "System Folder", 100), "lookup while filling");
+        }
+        snprintf(name, sizeof(name), "Item %d", i);
+        NameTestEntry(&entry, (FileID)(1000 + i), 200, name);
+        VFS_NameCacheInsert(kNameCacheTestVRef, name, &entry);
+    }
+    NameTestCheck(gNameStats.entries == kNameCacheEntries, "entries at capacity");
+    NameTestCheck(NameTestFinds(2, "System Folder", 100), "recently used survives");
+    NameTestCheck(NameTestMisses(200, "Item 0"), "least recently used evicted");
+    snprintf(name, sizeof(name), "Item %d", kNameCacheEntries + 7);
+    NameTestCheck(NameTestFinds(200, name, (FileID)(1000 + kNameCacheEntries + 7)), "newest kept");
+
+    /* Unmounted: nothing of the volume answers */
+    VFS_NameCacheForgetVolume(kNameCacheTestVRef);
+    NameTestCheck(NameTestMisses(2, "System Folder"), "stale after forgetting the volume");
+    NameTestCheck(!VFS_NameCacheGetByID(kNameCacheTestVRef, 100, &entry), "stale ID after forgetting the volume");
+
+    /* The counters are for real lookups; entries is whatever the table holds */
+    saved.entries = gNameStats.entries;
+    gNameStats = saved;
+}
@@ -55,6 +55,7 @@ extern void DisposeWindow(WindowPtr window);
 extern WindowPtr FrontWindow(void);
 extern void DragWindow(WindowPtr window, Point startPt, const Rect* boundsRect);
 extern Boolean TrackGoAway(WindowPtr window, Point pt);
+extern void QDPresent_MarkPixels(const void* firstPixel, SInt32 width, SInt32 height);
 
 /* External Event Manager */
 #include "EventManager/EventManager.h"
@@ -719,6 +720,10 @@ Boolean AboutWindow_HandleUpdate(WindowPtr w)
     DrawString((ConstStr255Param)cpy);
     FINDER_LOG_DEBUG("Footer drawn\n");
 
+    /* baseAddr points into the framebuffer itself, so everything above went
+     * straight to the screen; mark the content area once for all of it */
+    QDPresent_MarkPixels(w->port.portBits.baseAddr, contentRect.right, contentRect.bottom);
+
     EndUpdate(w);
 
     /* Restore previous port */
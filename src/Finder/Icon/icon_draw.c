@@ -116,6 +116,7 @@ void Icon_Draw32(const IconHandle* h, int x, int y, bool selected) {
     } else if (b->img1b && b->mask1b) {
         DrawICN32(b, x, y, selected);
     }
+    IconPort_MarkRect(x, y, x + 32, y + 32);
 }
 
 /* Draw 1-bit SICN 16x16 icon */
@@ -192,4 +193,5 @@ void Icon_Draw16(const IconHandle* h, int x, int y) {
             }
         }
     }
+    IconPort_MarkRect(x, y, x + 16, y + 16);
 }
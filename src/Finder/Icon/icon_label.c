@@ -283,6 +283,10 @@ static void DrawLabelLine(const char* s, int len, int cx, int topY, bool selecte
             if (ch == ' ') currentX += 3;  /* Extra space between words */
         }
     }
+
+    /* Background and glyphs, including an italic label's lean */
+    IconPort_MarkRect(textX - padding, topY - textHeight + 3,
+                      textX + textWidth + 1 + kIconLabelItalicLean, topY + 3);
 }
 
 /*
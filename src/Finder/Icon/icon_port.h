@@ -11,6 +11,11 @@ extern uint32_t fb_height;
 extern uint32_t fb_pitch;
 extern GrafPtr g_currentPort;
 
+/* ScreenPresent.c; QuickDrawPlatform.h is not included here because the menu
+ * code that uses this header has macros of its own that collide with it. */
+extern void QDPresent_MarkDirty(SInt32 left, SInt32 top, SInt32 right, SInt32 bottom);
+extern void QDPresent_MarkPixels(const void* firstPixel, SInt32 width, SInt32 height);
+
 /* Write a single pixel at local (x, y) coordinates into the active QuickDraw port.
  * Falls back to the global framebuffer if no port is active. */
 static inline void IconPort_WritePixel(int x, int y, uint32_t color) {
@@ -69,3 +74,40 @@ static inline void IconPort_WritePixel(int x, int y, uint32_t color) {
     size_t offset = (size_t)y * (size_t)fb_pitch + (size_t)x * sizeof(uint32_t);
     *(uint32_t*)(fbBase + offset) = color;
 }
+
+/* Mark what a run of IconPort_WritePixel calls covered, given as the same local
+ * rectangle, so it reaches the screen. Pixels go straight into the buffer a
+ * pixel at a time, so the callers mark once per icon or label instead. A port
+ * whose buffer is not the screen marks nothing. */
+static inline void IconPort_MarkRect(int left, int top, int right, int bottom) {
+    if (g_currentPort && g_currentPort->portBits.baseAddr) {
+        Rect portRect = g_currentPort->portRect;
+
+        if (left < portRect.left) left = portRect.left;
+        if (top < portRect.top) top = portRect.top;
+        if (right > portRect.right) right = portRect.right;
+        if (bottom > portRect.bottom) bottom = portRect.bottom;
+        if (left >= right || top >= bottom) {
+            return;
+        }
+
+        uint8_t* baseAddr = (uint8_t*)g_currentPort->portBits.baseAddr;
+        SInt16 rowBytes = g_currentPort->portBits.rowBytes & 0x3FFF;
+        int relX = left - portRect.left;
+        int relY = top - portRect.top;
+
+        if (baseAddr == (uint8_t*)framebuffer) {
+            int globalX = g_currentPort->portBits.bounds.left + relX;
+            int globalY = g_currentPort->portBits.bounds.top + relY;
+            QDPresent_MarkDirty(globalX, globalY,
+                                globalX + (right - left), globalY + (bottom - top));
+        } else {
+            QDPresent_MarkPixels(baseAddr + (size_t)relY * (size_t)rowBytes +
+                                     (size_t)relX * sizeof(uint32_t),
+                                 right - left, bottom - top);
+        }
+        return;
+    }
+
+    QDPresent_MarkDirty(left, top, right, bottom);
+}
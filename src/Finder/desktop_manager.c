@@ -1190,9 +1190,16 @@ static void GhostXOR(const Rect* r)
         }
     }
 
-    /* Force immediate display update */
-    extern void QDPlatform_UpdateScreen(SInt32 left, SInt32 top, SInt32 right, SInt32 bottom);
-    QDPlatform_UpdateScreen(left, top, right, bottom);
+    /* Mark the four edges rather than the whole rectangle - a drag outline
+     * can span most of the screen and only its frame changed - and present
+     * them straight away */
+    extern void QDPresent_MarkDirty(SInt32 left, SInt32 top, SInt32 right, SInt32 bottom);
+    extern Boolean QDPresent_Frame(Boolean wait);
+    QDPresent_MarkDirty(left, top, right, top + 3);
+    QDPresent_MarkDirty(left, bottom - 3, right, bottom);
+    QDPresent_MarkDirty(left, top, left + 3, bottom);
+    QDPresent_MarkDirty(right - 3, top, right, bottom);
+    QDPresent_Frame(false);
 
     FINDER_LOG_DEBUG("GhostXOR: Drew XOR rect (%d,%d,%d,%d)\n", left, top, right, bottom);
 }
@@ -1024,11 +1024,11 @@ void HandleKeyDown(EventRecord* event) {
             extern void SysBeep(short duration);
             extern void InvertRect(const Rect* r);
             extern QDGlobals qd;
-            extern void hal_framebuffer_present(void);
+            extern void QDPlatform_FlushScreen(void);
 
             /* Flash the screen white (visual feedback for screenshot) */
             InvertRect(&qd.screenBits.bounds);
-            hal_framebuffer_present();
+            QDPlatform_FlushScreen();
 
             /* Brief pause for visual effect */
             extern OSErr MicrosecondDelay(UInt32 microseconds);
@@ -1036,7 +1036,7 @@ void HandleKeyDown(EventRecord* event) {
 
             /* Restore screen */
             InvertRect(&qd.screenBits.bounds);
-            hal_framebuffer_present();
+            QDPlatform_FlushScreen();
 
             /* Camera shutter sound */
             SysBeep(1);
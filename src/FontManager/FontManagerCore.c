@@ -9,8 +9,10 @@
 #include "FontManager/FontManager.h"
 #include "FontManager/FontTypes.h"
 #include "FontManager/FontResources.h"
+#include "FontManager/FontCache.h"        /* FM_GetOutlineGlyph */
 #include "QuickDraw/ColorQuickDraw.h"
 #include "QuickDraw/QuickDraw.h"
+#include "QuickDraw/QuickDrawPlatform.h"  /* QDGlyphRun, QDPresent_MarkPixels */
 #include "SystemTypes.h"
 #include "chicago_font.h"
 #include "chicago_font_extended.h"
@@ -59,6 +61,9 @@ typedef struct FontStackEntry {
 static FontStackEntry g_fontStack[MAX_FONT_STACK];
 static SInt16 g_fontStackDepth = 0;
 
+/* Outlines the current font and size draw from; NULL for a strike */
+static const FMOutlineFont* g_currentOutline = NULL;
+
 /* ============================================================================
  * Internal Low-Level Character Drawing
  * ============================================================================ */
@@ -221,9 +226,20 @@ static void FM_BlitGlyph(short x, short y, const ChicagoCharInfo* info,
     }
 
     /* Debug removed - serial_printf can hang on ARM64 */
-    (void)pixels_drawn;
     (void)first_pixel_x;
     (void)first_pixel_y;
+
+    /* The clipped glyph box; only does anything when the buffer is the screen,
+     * which covers the About window's baseAddr pointing into it as well. */
+    if (pixels_drawn > 0) {
+        SInt32 markLeft = x < clipLeft ? clipLeft : x;
+        SInt32 markTop = y < clipTop ? clipTop : y;
+        SInt32 markRight = x + info->bit_width > clipRight ? clipRight : x + info->bit_width;
+        SInt32 markBottom = y + CHICAGO_HEIGHT > clipBottom ? clipBottom : y + CHICAGO_HEIGHT;
+        QDPresent_MarkPixels((uint8_t*)destBase + (markTop - destYOrigin) * destRowBytes +
+                                 (markLeft - destXOrigin) * 4,
+                             markRight - markLeft, markBottom - markTop);
+    }
 }
 
 /* Built-in Chicago font strike (from chicago_font.h) */
@@ -334,12 +350,16 @@ void InitFonts(void) {
 
     g_fmState.initialized = TRUE;
     FM_LOG("InitFonts: Font Manager initialized with %d families\n", 3);
+
+    FM_OutlineSelfTest();
 }
 
 OSErr FlushFonts(void) {
     FM_LOG("FlushFonts: Flushing font caches\n");
     /* For now, just reset to Chicago 12 */
     g_fmState.currentStrike = &g_chicagoStrike12;
+    g_currentOutline = NULL;
+    FM_FlushOutlineGlyphs(NULL);
     return noErr;
 }
 
@@ -564,6 +584,122 @@ static FontStrike* FM_FindStrikeInCache(short fontNum, short size, Style face) {
     return NULL;
 }
 
+/* ============================================================================
+ * Outline Fonts
+ * ============================================================================ */
+
+/*
+ * A family with a TrueType 'sfnt' draws from its outlines at every size it
+ * has no bitmap strike for, rather than falling back to Chicago. The 'sfnt'
+ * is the one the family's FOND lists at size 0, else the one numbered like
+ * the family. Once found it stays loaded and locked: the outline record
+ * reads it in place, and the outline glyph cache is keyed by that record.
+ * Each family is looked for once, found or not.
+ */
+#define kFMOutlineFamilies 16
+
+typedef struct FMOutlineFamily {
+    short           familyID;
+    Handle          sfnt;           /* NULL: the family has no outlines */
+    FMOutlineFont   font;
+} FMOutlineFamily;
+
+static FMOutlineFamily g_outlineFamilies[kFMOutlineFamilies];
+static short g_outlineFamilyCount = 0;
+
+/* The 'sfnt' ID a family's FOND associates with size 0 */
+static short FM_FindOutlineID(short fontNum) {
+    extern Handle GetResource(ResType theType, short theID);
+    extern void ReleaseResource(Handle theResource);
+    extern Size GetHandleSize(Handle h);
+    extern void HLock(Handle h);
+    extern void HUnlock(Handle h);
+
+    short sfntID = fontNum;
+    Handle fondHandle = GetResource('FOND', fontNum);
+    if (!fondHandle) {
+        return sfntID;
+    }
+
+    /* The association table follows the header in the resource itself;
+     * FM_LoadFONDResource copies only the header */
+    Size size = GetHandleSize(fondHandle);
+    if (size >= (Size)sizeof(FONDResource)) {
+        HLock(fondHandle);
+        const FONDResource* fond = (const FONDResource*)*fondHandle;
+        const FontAssocEntry* entries =
+            (const FontAssocEntry*)((const UInt8*)fond + sizeof(FONDResource));
+        SInt16 count = fond->ffNumEntries;
+        for (SInt16 i = 0; i < count; i++) {
+            if (sizeof(FONDResource) + (Size)(i + 1) * sizeof(FontAssocEntry) > (Size)size) {
+                break;
+            }
+            if (entries[i].fontSize == 0 && entries[i].fontStyle == normal) {
+                sfntID = entries[i].fontID;
+                break;
+            }
+        }
+        HUnlock(fondHandle);
+    }
+    ReleaseResource(fondHandle);
+    return sfntID;
+}
+
+/* The family's outlines, opened on first use; NULL if it has none */
+static const FMOutlineFont* FM_GetOutlineFont(short fontNum) {
+    extern Handle GetResource(ResType theType, short theID);
+    extern void ReleaseResource(Handle theResource);
+    extern Size GetHandleSize(Handle h);
+    extern void HLock(Handle h);
+    extern void HNoPurge(Handle h);
+
+    for (short i = 0; i < g_outlineFamilyCount; i++) {
+        if (g_outlineFamilies[i].familyID == fontNum) {
+            return g_outlineFamilies[i].sfnt ? &g_outlineFamilies[i].font : NULL;
+        }
+    }
+    if (g_outlineFamilyCount == kFMOutlineFamilies) {
+        return NULL;
+    }
+
+    FMOutlineFamily* family = &g_outlineFamilies[g_outlineFamilyCount++];
+    family->familyID = fontNum;
+    family->sfnt = GetResource('sfnt', FM_FindOutlineID(fontNum));
+    if (family->sfnt) {
+        HNoPurge(family->sfnt);
+        HLock(family->sfnt);
+        OSErr err = FM_OpenOutlineFont(*family->sfnt, (UInt32)GetHandleSize(family->sfnt),
+                                       &family->font);
+        if (err != noErr) {
+            FM_LOG("FM_GetOutlineFont: 'sfnt' for family %d unusable: %d\n", fontNum, err);
+            ReleaseResource(family->sfnt);
+            family->sfnt = NULL;
+        }
+    }
+    return family->sfnt ? &family->font : NULL;
+}
+
+/* Draw from outlines when the family has them and the size is one the
+ * rasterizer takes; TextFont and TextSize ask once they find no strike */
+static Boolean FM_SelectOutline(short fontNum, short size) {
+    if (size <= 0 || size > kFMOutlineMaxSize) {
+        return FALSE;
+    }
+    g_currentOutline = FM_GetOutlineFont(fontNum);
+    if (!g_currentOutline) {
+        return FALSE;
+    }
+    g_fmState.currentStrike = &g_chicagoStrike12;
+    FM_LOG("Drawing font %d size %d from outlines\n", fontNum, size);
+    return TRUE;
+}
+
+/* The current outline font's glyph for a character, from the glyph cache */
+static const FMGlyphBitmap* FM_OutlineGlyph(UInt8 ch) {
+    return FM_GetOutlineGlyph(g_currentOutline, g_currentPort->txSize,
+                              FM_OutlineCharGlyph(g_currentOutline, ch));
+}
+
 Boolean RealFont(short fontNum, short size) {
     /* Built-in Chicago 12 is always real */
     if (fontNum == chicagoFont && size == 12) {
@@ -598,6 +734,7 @@ void TextFont(short font) {
     if (!g_currentPort) return;
 
     g_currentPort->txFont = font;
+    g_currentOutline = NULL;
     FM_LOG("TextFont: Set to %d\n", font);
 
     /* Try to find appropriate strike for new font */
@@ -627,6 +764,10 @@ void TextFont(short font) {
         return;
     }
 
+    if (FM_SelectOutline(font, size)) {
+        return;
+    }
+
     /*
      * Fall back to Chicago 12, and say so the first time.
      *
@@ -644,7 +785,7 @@ void TextFont(short font) {
         static Boolean toldAboutFontFallback = false;
         if (!toldAboutFontFallback && font != chicagoFont) {
             toldAboutFontFallback = true;
-            serial_puts("[FONT] no strike for the requested font; drawing Chicago\n");
+            serial_puts("[FONT] no strike or outlines for the requested font; drawing Chicago\n");
             serial_puts("[FONT] instead. Only Chicago has strike data in this build.\n");
         }
     }
@@ -666,6 +807,7 @@ void TextSize(short size) {
     if (!g_currentPort) return;
 
     g_currentPort->txSize = size;
+    g_currentOutline = NULL;
     FM_LOG("TextSize: Set to %d\n", size);
 
     /* Try to find appropriate strike for new size */
@@ -695,6 +837,10 @@ void TextSize(short size) {
         return;
     }
 
+    if (FM_SelectOutline(font, size)) {
+        return;
+    }
+
     /* Fall back to Chicago 12 (will use scaling if needed) */
     g_fmState.currentStrike = &g_chicagoStrike12;
     FM_LOG("TextSize: Falling back to Chicago 12 (will scale from 12 to %d)\n", size);
@@ -714,6 +860,18 @@ void TextMode(short mode) {
 void GetFontMetrics(FMetricRec *theMetrics) {
     if (!theMetrics) return;
 
+    /* Outlines: hhea's ascender and descender at the current size */
+    if (g_currentOutline && g_currentPort) {
+        SInt32 size = g_currentPort->txSize;
+        SInt32 unitsPerEm = g_currentOutline->unitsPerEm;
+        theMetrics->ascent = (g_currentOutline->ascender * size + unitsPerEm - 1) / unitsPerEm;
+        theMetrics->descent = (-g_currentOutline->descender * size + unitsPerEm - 1) / unitsPerEm;
+        theMetrics->widMax = size;
+        theMetrics->leading = 0;
+        theMetrics->wTabHandle = NULL;
+        return;
+    }
+
     /* Use current strike if available, otherwise load it */
     FontStrike* strike = g_fmState.currentStrike;
 
@@ -769,6 +927,13 @@ void GetFontMetrics(FMetricRec *theMetrics) {
  * neither has to call the other.
  */
 short FM_GetPlainCharWidth(short ch) {
+    if (g_currentOutline) {
+        const FMGlyphBitmap* glyph = FM_OutlineGlyph((UInt8)ch);
+        if (glyph) {
+            return glyph->advance;
+        }
+    }
+
     if (g_fmState.currentStrike == &g_chicagoStrike12) {
         /* Non-12pt sizes are synthesised by scaling the 12pt strike */
         if (g_currentPort && g_currentPort->txSize != 12) {
@@ -900,6 +1065,38 @@ void QD_LocalToPixel(short localX, short localY, short* pixelX, short* pixelY) {
  * QuickDraw Text Drawing Functions
  * ============================================================================ */
 
+/*
+ * FM_DrawOutlineChars - Draw characters from the current outline font
+ *
+ * One glyph run, like a strike's, with each glyph's coverage bitmap from
+ * the outline glyph cache blended into the destination. Bold is the same
+ * second pass one pixel over; italic is not synthesized, as for strikes.
+ */
+static void FM_DrawOutlineChars(const unsigned char* text, short count) {
+    Boolean hasBold = (g_currentPort->txFace & bold) != 0;
+    QDGlyphRun run;
+    QDPlatform_BeginGlyphRun(&run, g_currentPort, QDPlatform_MapQDColor(g_currentPort->fgColor));
+
+    for (short i = 0; i < count; i++) {
+        short penX = g_currentPort->pnLoc.h;
+        short penY = g_currentPort->pnLoc.v;
+
+        /* The bitmap is good until the next cache miss: draw it before
+         * asking for another */
+        const FMGlyphBitmap* glyph = FM_OutlineGlyph(text[i]);
+        SInt16 advance = QDPlatform_DrawCoverageRun(&run, glyph, penX, penY);
+        if (hasBold) {
+            QDPlatform_DrawCoverageRun(&run, glyph, penX + 1, penY);
+        }
+        if (!glyph) {
+            advance = CharWidth(text[i]);
+        }
+        g_currentPort->pnLoc.h += advance + (hasBold ? 1 : 0);
+    }
+
+    QDPlatform_EndGlyphRun(&run);
+}
+
 /*
  * DrawChar - Draw a single character at the current pen location
  * NOTE: This shadows the QuickDraw/Text.c version to ensure menu title text
@@ -909,6 +1106,12 @@ void DrawChar(short ch) {
     /* Debug output removed - was causing severe slowdown on ARM64 */
     if (!g_currentPort) return;
 
+    if (g_currentOutline) {
+        unsigned char c = (unsigned char)ch;
+        FM_DrawOutlineChars(&c, 1);
+        return;
+    }
+
     Style face = g_currentPort->txFace;
     Boolean hasBold = (face & bold) != 0;
     Boolean hasItalic = (face & italic) != 0;
@@ -986,6 +1189,54 @@ void DrawChar(short ch) {
     }
 }
 
+/*
+ * FM_DrawChars - Draw characters at the current pen location
+ *
+ * With a real strike the whole string is one glyph run: the destination is
+ * worked out once, each glyph comes from the glyph cache, and the screen is
+ * marked once at the end. Menus, list views and TextEdit draw their text a
+ * line at a time through here. Outline fonts are a run too, through
+ * FM_DrawOutlineChars. The built-in Chicago fallback has no strike bitmap
+ * and goes a character at a time through DrawChar as before.
+ */
+static void FM_DrawChars(const unsigned char* text, short count) {
+    if (g_currentOutline) {
+        FM_DrawOutlineChars(text, count);
+        return;
+    }
+
+    FontStrike *strike = FM_GetCurrentStrike();
+    if (!strike || !strike->locTable || !strike->bitmapData) {
+        for (short i = 0; i < count; i++) {
+            DrawChar(text[i]);
+        }
+        return;
+    }
+
+    Boolean hasBold = (g_currentPort->txFace & bold) != 0;
+    QDGlyphRun run;
+    QDPlatform_BeginGlyphRun(&run, g_currentPort, QDPlatform_MapQDColor(g_currentPort->fgColor));
+
+    for (short i = 0; i < count; i++) {
+        UInt8 ch = text[i];
+        short glyphX = g_currentPort->pnLoc.h;
+        short glyphY = g_currentPort->pnLoc.v - strike->ascent;
+
+        /* Same drawing and pen advance as DrawChar */
+        SInt16 advance = QDPlatform_DrawGlyphRun(&run, strike, ch, glyphX, glyphY);
+        if (hasBold) {
+            /* Bold: draw twice with 1 pixel offset */
+            QDPlatform_DrawGlyphRun(&run, strike, ch, glyphX + 1, glyphY);
+        }
+        if (advance <= 0) {
+            advance = CharWidth(ch);
+        }
+        g_currentPort->pnLoc.h += advance + (hasBold ? 1 : 0);
+    }
+
+    QDPlatform_EndGlyphRun(&run);
+}
+
 /*
  * DrawString - Draw a Pascal string at the current pen location
  */
@@ -999,10 +1250,8 @@ void DrawString(ConstStr255Param s) {
     Style face = g_currentPort->txFace;
     short startX = g_currentPort->pnLoc.h;  /* Save start for underline */
 
-    /* Draw each character using DrawChar (bold/italic handled there) */
-    for (int i = 1; i <= len; i++) {
-        DrawChar(s[i]);
-    }
+    /* Draw the characters as one run (bold/italic handled there) */
+    FM_DrawChars(&s[1], len);
 
     /* Draw underline if needed */
     if (face & underline) {
@@ -1028,10 +1277,8 @@ void DrawText(const void* textBuf, short firstByte, short byteCount) {
 
     const unsigned char* text = (const unsigned char*)textBuf;
 
-    /* Draw each character using DrawChar */
-    for (short i = 0; i < byteCount; i++) {
-        DrawChar(text[firstByte + i]);
-    }
+    /* Draw the characters as one run */
+    FM_DrawChars(text + firstByte, byteCount);
 }
 
 /* ============================================================================
@@ -1246,8 +1493,8 @@ void FMSetFontSize(SInt16 size) {
  * ============================================================================ */
 
 Boolean IsOutline(Point numer, Point denom) {
-    /* No outline fonts yet */
-    return FALSE;
+    /* Scaling is not taken into account: the outlines are drawn unscaled */
+    return g_currentOutline != NULL;
 }
 
 OSErr OutlineMetrics(short byteCount, const void *textPtr, Point numer,
@@ -0,0 +1,644 @@
+/*
+ * OutlineGlyphCache.c - Coverage bitmaps for TrueType glyphs
+ *
+ * Rasterizing an outline costs far more than drawing its bitmap, and
+ * text draws the same few dozen glyphs at the same one or two sizes over
+ * and over. Each (font, size, glyph) is rasterized by TrueTypeRaster.c
+ * once, on first use, and the bitmap is kept here: a fixed table of
+ * entries, hashed by key, on an LRU list whose bitmaps are held to a byte
+ * budget (kOutlineCacheBudget) in the system heap.
+ *
+ * This is the outline counterpart of the strike cache FontCache.h
+ * describes; it is keyed by the FMOutlineFont record, so a font has to be
+ * flushed (FM_CloseOutlineFont does it) before its record is reused.
+ *
+ * Copyright (c) 2025 - System 7.1 Portable Project
+ */
+
+#include "SystemTypes.h"
+#include "FontManager/FontCache.h"
+#include "FontManager/TrueTypeRaster.h"
+#include "MemoryMgr/MemoryManager.h"
+#include "System71StdLib.h"
+#include <string.h>
+#include <stddef.h>
+
+#define kOutlineCacheEntries  512
+#define kOutlineCacheBuckets  128           /* power of two */
+#define kOutlineCacheBudget   (128 * 1024)  /* bytes of bitmaps */
+#define kOutlineNone          (-1)
+
+typedef struct OutlineCacheEntry {
+    const FMOutlineFont* font;
+    FMGlyphBitmap*  bitmap;     /* NULL: entry is free */
+    UInt32          bytes;
+    UInt16          glyph;
+    SInt16          size;
+    SInt16          hashNext;
+    SInt16          lruPrev;    /* towards most recently used */
+    SInt16          lruNext;
+} OutlineCacheEntry;
+
+static OutlineCacheEntry gEntries[kOutlineCacheEntries];
+static SInt16  gBuckets[kOutlineCacheBuckets];
+static SInt16  gLruHead = kOutlineNone;     /* most recently used */
+static SInt16  gLruTail = kOutlineNone;
+static SInt16  gFreeHead = kOutlineNone;    /* chained through lruNext */
+static Boolean gCacheReady = false;
+static OutlineCacheStats gOutlineStats;
+
+static void OutlineCacheInit(void) {
+    for (int b = 0; b < kOutlineCacheBuckets; b++) {
+        gBuckets[b] = kOutlineNone;
+    }
+    for (int i = 0; i < kOutlineCacheEntries; i++) {
+        gEntries[i].bitmap = NULL;
+        gEntries[i].lruNext = (i + 1 < kOutlineCacheEntries) ? (SInt16)(i + 1) : kOutlineNone;
+    }
+    gFreeHead = 0;
+    gLruHead = kOutlineNone;
+    gLruTail = kOutlineNone;
+    memset(&gOutlineStats, 0, sizeof(gOutlineStats));
+    gOutlineStats.budget = kOutlineCacheBudget;
+    gCacheReady = true;
+}
+
+static UInt32 OutlineHash(const FMOutlineFont* font, short size, UInt16 glyph) {
+    uintptr_t key = (uintptr_t)font;
+    return (UInt32)((key >> 4) ^ ((UInt32)size * 97u) ^ ((UInt32)glyph * 31u)) &
+           (kOutlineCacheBuckets - 1);
+}
+
+static void LruUnlink(SInt16 i) {
+    OutlineCacheEntry* e = &gEntries[i];
+    if (e->lruPrev != kOutlineNone) gEntries[e->lruPrev].lruNext = e->lruNext;
+    else gLruHead = e->lruNext;
+    if (e->lruNext != kOutlineNone) gEntries[e->lruNext].lruPrev = e->lruPrev;
+    else gLruTail = e->lruPrev;
+}
+
+static void LruPushFront(SInt16 i) {
+    OutlineCacheEntry* e = &gEntries[i];
+    e->lruPrev = kOutlineNone;
+    e->lruNext = gLruHead;
+    if (gLruHead != kOutlineNone) gEntries[gLruHead].lruPrev = i;
+    gLruHead = i;
+    if (gLruTail == kOutlineNone) gLruTail = i;
+}
+
+/* Drop entry i: out of its bucket and the LRU list, bitmap freed */
+static void OutlineCacheRemove(SInt16 i) {
+    OutlineCacheEntry* e = &gEntries[i];
+    UInt32 b = OutlineHash(e->font, e->size, e->glyph);
+
+    SInt16* link = &gBuckets[b];
+    while (*link != kOutlineNone && *link != i) {
+        link = &gEntries[*link].hashNext;
+    }
+    if (*link == i) *link = e->hashNext;
+
+    LruUnlink(i);
+    gOutlineStats.bytes -= e->bytes;
+    gOutlineStats.glyphs--;
+    DisposePtr((Ptr)e->bitmap);
+    e->bitmap = NULL;
+    e->lruNext = gFreeHead;
+    gFreeHead = i;
+}
+
+const FMGlyphBitmap* FM_GetOutlineGlyph(const FMOutlineFont* font, short size, UInt16 glyph) {
+    if (!font || !font->data || size <= 0 || size > kFMOutlineMaxSize) {
+        return NULL;
+    }
+    if (!gCacheReady) {
+        OutlineCacheInit();
+    }
+
+    UInt32 b = OutlineHash(font, size, glyph);
+    for (SInt16 i = gBuckets[b]; i != kOutlineNone; i = gEntries[i].hashNext) {
+        OutlineCacheEntry* e = &gEntries[i];
+        if (e->font != font || e->size != size || e->glyph != glyph) continue;
+        if (gLruHead != i) {
+            LruUnlink(i);
+            LruPushFront(i);
+        }
+        gOutlineStats.hits++;
+        return e->bitmap;
+    }
+    gOutlineStats.misses++;
+
+    FMGlyphBitmap* bitmap;
+    if (FM_RasterizeOutlineGlyph(font, glyph, size, &bitmap) != noErr) {
+        gOutlineStats.uncached++;
+        return NULL;
+    }
+    UInt32 bytes = offsetof(FMGlyphBitmap, coverage) +
+                   (UInt32)bitmap->width * (UInt32)bitmap->height;
+    if (bytes > kOutlineCacheBudget) {
+        DisposePtr((Ptr)bitmap);
+        gOutlineStats.uncached++;
+        return NULL;
+    }
+
+    while (gLruTail != kOutlineNone &&
+           (gFreeHead == kOutlineNone || gOutlineStats.bytes + bytes > kOutlineCacheBudget)) {
+        OutlineCacheRemove(gLruTail);
+        gOutlineStats.evictions++;
+    }
+
+    SInt16 i = gFreeHead;
+    OutlineCacheEntry* e = &gEntries[i];
+    gFreeHead = e->lruNext;
+    e->font = font;
+    e->bitmap = bitmap;
+    e->bytes = bytes;
+    e->glyph = glyph;
+    e->size = size;
+    e->hashNext = gBuckets[b];
+    gBuckets[b] = i;
+    LruPushFront(i);
+
+    gOutlineStats.glyphs++;
+    gOutlineStats.bytes += bytes;
+    return bitmap;
+}
+
+void FM_FlushOutlineGlyphs(const FMOutlineFont* font) {
+    if (!gCacheReady) return;
+
+    SInt16 i = gLruHead;
+    while (i != kOutlineNone) {
+        SInt16 next = gEntries[i].lruNext;
+        if (!font || gEntries[i].font == font) {
+            OutlineCacheRemove(i);
+        }
+        i = next;
+    }
+}
+
+void FM_GetOutlineCacheStats(OutlineCacheStats* stats) {
+    if (!stats) return;
+    if (!gCacheReady) {
+        OutlineCacheInit();
+    }
+    memcpy(stats, &gOutlineStats, sizeof(*stats));
+}
+
+/* ================================================================
+ * SYNTHETIC FONTS
+ * ================================================================ */
+
+/* No 'sfnt' ships in the image, so the self-test and the benchmark build
+ * their own, big-endian, into a NewPtr block */
+typedef struct SfntWriter {
+    UInt8*  base;
+    UInt32  at;
+} SfntWriter;
+
+static void SfntPut16(SfntWriter* w, UInt32 v) {
+    w->base[w->at++] = (UInt8)(v >> 8);
+    w->base[w->at++] = (UInt8)v;
+}
+
+static void SfntPut32(SfntWriter* w, UInt32 v) {
+    SfntPut16(w, v >> 16);
+    SfntPut16(w, v & 0xFFFF);
+}
+
+static void SfntAlign(SfntWriter* w) {
+    while (w->at & 3) w->base[w->at++] = 0;
+}
+
+/* Offset table; the directory after it is left for SfntDirectory */
+static void SfntBegin(SfntWriter* w, UInt16 tables) {
+    UInt16 selector = 0;
+    while ((2u << selector) <= tables) selector++;
+    SfntPut32(w, 0x00010000);
+    SfntPut16(w, tables);
+    SfntPut16(w, (UInt16)(16u << selector));
+    SfntPut16(w, selector);
+    SfntPut16(w, (UInt16)(tables * 16u - (16u << selector)));
+    w->at += tables * 16u;
+}
+
+/* Table directory: tags in order, offsets[tables] is the end of the last */
+static void SfntDirectory(SfntWriter* w, const UInt32* tags, const UInt32* offsets,
+                          UInt16 tables) {
+    UInt32 end = w->at;
+    for (UInt16 t = 0; t < tables; t++) {
+        w->at = 12 + t * 16u;
+        SfntPut32(w, tags[t]);
+        SfntPut32(w, 0);
+        SfntPut32(w, offsets[t]);
+        SfntPut32(w, offsets[t + 1] - offsets[t]);
+    }
+    w->at = end;
+}
+
+static void SfntHead(SfntWriter* w, UInt16 unitsPerEm, SInt16 xMin, SInt16 yMin,
+                     SInt16 xMax, SInt16 yMax) {
+    SfntPut32(w, 0x00010000);
+    SfntPut32(w, 0x00010000);
+    SfntPut32(w, 0);
+    SfntPut32(w, 0x5F0F3CF5);
+    SfntPut16(w, 0);
+    SfntPut16(w, unitsPerEm);
+    w->at += 16;                                        /* created, modified */
+    SfntPut16(w, (UInt16)xMin);
+    SfntPut16(w, (UInt16)yMin);
+    SfntPut16(w, (UInt16)xMax);
+    SfntPut16(w, (UInt16)yMax);
+    w->at += 6;                                         /* macStyle .. fontDirectionHint */
+    SfntPut16(w, 0);                                    /* short loca */
+    SfntPut16(w, 0);
+    SfntAlign(w);
+}
+
+static void SfntHhea(SfntWriter* w, SInt16 ascender, SInt16 descender, UInt16 advanceMax,
+                     UInt16 metrics) {
+    SfntPut32(w, 0x00010000);
+    SfntPut16(w, (UInt16)ascender);
+    SfntPut16(w, (UInt16)descender);
+    SfntPut16(w, 0);
+    SfntPut16(w, advanceMax);
+    w->at += 22;
+    SfntPut16(w, metrics);
+    SfntAlign(w);
+}
+
+static void SfntMaxp(SfntWriter* w, UInt16 glyphs) {
+    SfntPut32(w, 0x00005000);
+    SfntPut16(w, glyphs);
+    SfntAlign(w);
+}
+
+/* A simple glyph, coordinates chosen short, repeated or long as each
+ * delta allows so every encoding is exercised */
+static void SfntSimpleGlyph(SfntWriter* w, const SInt16* xy, const UInt8* on,
+                            const UInt16* ends, UInt16 contours) {
+    UInt16 points = (UInt16)(ends[contours - 1] + 1);
+    SInt16 xMin = xy[0], xMax = xy[0], yMin = xy[1], yMax = xy[1];
+
+    for (UInt16 i = 1; i < points; i++) {
+        if (xy[2 * i] < xMin) xMin = xy[2 * i];
+        if (xy[2 * i] > xMax) xMax = xy[2 * i];
+        if (xy[2 * i + 1] < yMin) yMin = xy[2 * i + 1];
+        if (xy[2 * i + 1] > yMax) yMax = xy[2 * i + 1];
+    }
+    SfntPut16(w, contours);
+    SfntPut16(w, (UInt16)xMin);
+    SfntPut16(w, (UInt16)yMin);
+    SfntPut16(w, (UInt16)xMax);
+    SfntPut16(w, (UInt16)yMax);
+    for (UInt16 c = 0; c < contours; c++) SfntPut16(w, ends[c]);
+    SfntPut16(w, 0);                                    /* no instructions */
+
+    UInt8 flags[64];
+    for (UInt16 i = 0; i < points; i++) {
+        SInt16 dx = (SInt16)(xy[2 * i] - (i ? xy[2 * i - 2] : 0));
+        SInt16 dy = (SInt16)(xy[2 * i + 1] - (i ? xy[2 * i - 1] : 0));
+        UInt8 f = on[i] ? 0x01 : 0x00;
+        if (dx == 0) f |= 0x10;
+        else if (dx > -256 && dx < 256) f |= 0x02 | (dx > 0 ? 0x10 : 0);
+        if (dy == 0) f |= 0x20;
+        else if (dy > -256 && dy < 256) f |= 0x04 | (dy > 0 ? 0x20 : 0);
+        flags[i] = f;
+    }
+    for (UInt16 i = 0; i < points; ) {
+        UInt16 run = 1;
+        while (i + run < points && flags[i + run] == flags[i] && run < 255) run++;
+        if (run > 1) {
+            w->base[w->at++] = flags[i] | 0x08;
+            w->base[w->at++] = (UInt8)(run - 1);
+        } else {
+            w->base[w->at++] = flags[i];
+        }
+        i = (UInt16)(i + run);
+    }
+    for (int axis = 0; axis < 2; axis++) {
+        UInt8 shortBit = axis ? 0x04 : 0x02, sameBit = axis ? 0x20 : 0x10;
+        for (UInt16 i = 0; i < points; i++) {
+            SInt16 d = (SInt16)(xy[2 * i + axis] - (i ? xy[2 * i - 2 + axis] : 0));
+            if (flags[i] & shortBit) w->base[w->at++] = (UInt8)(d < 0 ? -d : d);
+            else if (!(flags[i] & sameBit)) SfntPut16(w, (UInt16)d);
+        }
+    }
+}
+
+/* ================================================================
+ * SELF-TEST
+ * ================================================================ */
+
+/*
+ * FM_OutlineSelfTest - rasterize a square whose left and right edges fall
+ * on pixel centres and whose top and bottom fall on pixel edges, and read
+ * the coverage back: solid inside, half on the two edge columns, nothing
+ * outside the box. Run from InitFonts; silent unless it fails.
+ */
+enum { kTestUnitsPerEm = 1024, kTestSize = 16 };    /* 64 units a pixel */
+
+static Boolean gOutlineTestFailed;
+
+static void OutlineTestCheck(Boolean ok, const char* what) {
+    if (!ok && !gOutlineTestFailed) {
+        serial_printf("[FONT] OUTLINE SELFTEST FAILED: %s\n", what);
+        gOutlineTestFailed = true;
+    }
+}
+
+/* .notdef blank, then the square: x 1.5 to 5.5 pixels, y 0 to 4, and
+ * 'A' mapped to it */
+static UInt8* OutlineTestFont(UInt32* length) {
+    static const SInt16 square[8] = { 96, 0, 96, 256, 352, 256, 352, 0 };
+    static const UInt8 on[4] = { 1, 1, 1, 1 };
+    static const UInt16 ends[1] = { 3 };
+    static const UInt32 tags[7] = { 'cmap', 'glyf', 'head', 'hhea', 'hmtx', 'loca', 'maxp' };
+    UInt32 offsets[8];
+    SfntWriter w;
+
+    w.base = (UInt8*)NewPtrClear(1024);
+    w.at = 0;
+    if (!w.base) return NULL;
+    SfntBegin(&w, 7);
+
+    offsets[0] = w.at;                                  /* cmap: 'A' -> 1 */
+    SfntPut16(&w, 0);
+    SfntPut16(&w, 1);
+    SfntPut16(&w, 3);
+    SfntPut16(&w, 1);
+    SfntPut32(&w, 12);
+    SfntPut16(&w, 4);
+    SfntPut16(&w, 16 + 2 * 8);
+    SfntPut16(&w, 0);
+    SfntPut16(&w, 4);                                   /* two segments */
+    SfntPut16(&w, 4);
+    SfntPut16(&w, 1);
+    SfntPut16(&w, 0);
+    SfntPut16(&w, 'A');                                 /* end codes */
+    SfntPut16(&w, 0xFFFF);
+    SfntPut16(&w, 0);
+    SfntPut16(&w, 'A');                                 /* start codes */
+    SfntPut16(&w, 0xFFFF);
+    SfntPut16(&w, (UInt16)(1 - 'A'));                   /* deltas */
+    SfntPut16(&w, 1);
+    SfntPut16(&w, 0);                                   /* range offsets */
+    SfntPut16(&w, 0);
+    SfntAlign(&w);
+
+    offsets[1] = w.at;                                  /* glyf */
+    SfntSimpleGlyph(&w, square, on, ends, 1);
+    SfntAlign(&w);
+    UInt32 glyfEnd = w.at - offsets[1];
+
+    offsets[2] = w.at;
+    SfntHead(&w, kTestUnitsPerEm, 96, 0, 352, 256);
+    offsets[3] = w.at;
+    SfntHhea(&w, 800, -200, 512, 2);
+    offsets[4] = w.at;                                  /* hmtx */
+    SfntPut32(&w, (256u << 16));
+    SfntPut32(&w, (512u << 16) | 96);
+    offsets[5] = w.at;                                  /* loca */
+    SfntPut16(&w, 0);
+    SfntPut16(&w, 0);
+    SfntPut16(&w, glyfEnd / 2);
+    SfntAlign(&w);
+    offsets[6] = w.at;
+    SfntMaxp(&w, 2);
+    offsets[7] = w.at;
+
+    SfntDirectory(&w, tags, offsets, 7);
+    *length = w.at;
+    return w.base;
+}
+
+void FM_OutlineSelfTest(void) {
+    FMOutlineFont font;
+    UInt32 length = 0;
+    UInt8* sfnt = OutlineTestFont(&length);
+
+    gOutlineTestFailed = false;
+    if (!sfnt) {
+        OutlineTestCheck(false, "no memory for the test font");
+        return;
+    }
+    OutlineTestCheck(FM_OpenOutlineFont(sfnt, length, &font) == noErr, "open");
+    if (gOutlineTestFailed) {
+        DisposePtr((Ptr)sfnt);
+        return;
+    }
+    OutlineTestCheck(FM_OutlineCharGlyph(&font, 'A') == 1, "cmap");
+    OutlineTestCheck(FM_OutlineCharGlyph(&font, 'B') == 0, "unmapped character");
+
+    OutlineCacheStats before, after;
+    FM_GetOutlineCacheStats(&before);
+    const FMGlyphBitmap* bm = FM_GetOutlineGlyph(&font, kTestSize, 1);
+    OutlineTestCheck(bm != NULL, "rasterize");
+    if (bm) {
+        OutlineTestCheck(bm->left == 1 && bm->top == 4 && bm->width == 5 && bm->height == 4,
+                         "bitmap box");
+        OutlineTestCheck(bm->advance == 8, "advance");
+        for (SInt16 y = 0; y < bm->height && bm->width == 5; y++) {
+            const UInt8* row = bm->coverage + y * bm->width;
+            OutlineTestCheck(row[0] >= 126 && row[0] <= 130, "left edge half covered");
+            OutlineTestCheck(row[1] == 255 && row[2] == 255 && row[3] == 255, "inside solid");
+            OutlineTestCheck(row[4] >= 126 && row[4] <= 130, "right edge half covered");
+        }
+        OutlineTestCheck(FM_GetOutlineGlyph(&font, kTestSize, 1) == bm, "cached");
+    }
+    FM_GetOutlineCacheStats(&after);
+    OutlineTestCheck(after.misses == before.misses + 1 && after.hits == before.hits + 1,
+                     "one miss then a hit");
+
+    const FMGlyphBitmap* blank = FM_GetOutlineGlyph(&font, kTestSize, 0);
+    OutlineTestCheck(blank && blank->width == 0 && blank->advance == 4, "blank glyph");
+
+    FM_CloseOutlineFont(&font);
+    FM_GetOutlineCacheStats(&after);
+    OutlineTestCheck(after.glyphs == before.glyphs, "flushed on close");
+    DisposePtr((Ptr)sfnt);
+}
+
+/* ================================================================
+ * OUTLINE BENCHMARK (FONT_BENCHMARK=1)
+ * ================================================================ */
+
+#ifdef FONT_BENCHMARK
+#include "TimeManager/TimeBase.h"
+
+enum { kBenchPasses = 32, kBenchLines = 200, kBenchUnitsPerEm = 2048 };
+
+/* An O of two all-off-curve contours, a straight-sided H, and a composite
+ * of the O and a half-size H, mapped from 'O', 'H' and 'Q' */
+static UInt8* OutlineBenchFont(UInt32* length) {
+    static const SInt16 c8[8] = { 1000, 707, 0, -707, -1000, -707, 0, 707 };
+    SInt16 oPoints[32], hPoints[24];
+    static const UInt8 oOn[16] = { 0 };
+    static const UInt8 hOn[12] = { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 };
+    static const UInt16 oEnds[2] = { 7, 15 }, hEnds[1] = { 11 };
+    static const SInt16 h[24] = { 100, 0, 100, 1400, 340, 1400, 340, 820, 900, 820,
+                                  900, 1400, 1140, 1400, 1140, 0, 900, 0, 900, 580,
+                                  340, 580, 340, 0 };
+    static const UInt16 advance[4] = { 600, 1200, 1240, 1800 };
+    UInt32 loca[5];
+    SfntWriter w;
+
+    /* Outer contour clockwise, inner counter-clockwise */
+    for (int k = 0; k < 8; k++) {
+        int outer = (8 - k) & 7;
+        oPoints[2 * k] = (SInt16)(600 + 520 * c8[outer] / 1000);
+        oPoints[2 * k + 1] = (SInt16)(700 + 720 * c8[(outer + 6) & 7] / 1000);
+        oPoints[16 + 2 * k] = (SInt16)(600 + 330 * c8[k] / 1000);
+        oPoints[16 + 2 * k + 1] = (SInt16)(700 + 520 * c8[(k + 6) & 7] / 1000);
+    }
+    memcpy(hPoints, h, sizeof(hPoints));
+
+    w.base = (UInt8*)NewPtrClear(2048);
+    w.at = 0;
+    if (!w.base) return NULL;
+
+    /* Offset table, then the tables in tag order, each 4-byte aligned */
+    static const UInt32 tags[7] = { 'cmap', 'glyf', 'head', 'hhea', 'hmtx', 'loca', 'maxp' };
+    UInt32 offsets[8];
+    SfntBegin(&w, 7);
+
+    offsets[0] = w.at;                                  /* cmap */
+    SfntPut16(&w, 0);
+    SfntPut16(&w, 1);
+    SfntPut16(&w, 3);
+    SfntPut16(&w, 1);
+    SfntPut32(&w, 12);
+    {
+        static const UInt16 codes[4] = { 'H', 'O', 'Q', 0xFFFF };
+        static const UInt16 glyphs[4] = { 2, 1, 3, 0 };
+        SfntPut16(&w, 4);
+        SfntPut16(&w, 16 + 4 * 8);
+        SfntPut16(&w, 0);
+        SfntPut16(&w, 8);
+        SfntPut16(&w, 8);
+        SfntPut16(&w, 2);
+        SfntPut16(&w, 0);
+        for (int s = 0; s < 4; s++) SfntPut16(&w, codes[s]);
+        SfntPut16(&w, 0);
+        for (int s = 0; s < 4; s++) SfntPut16(&w, codes[s]);
+        for (int s = 0; s < 4; s++) SfntPut16(&w, (UInt16)(glyphs[s] - codes[s]));
+        for (int s = 0; s < 4; s++) SfntPut16(&w, 0);
+    }
+    SfntAlign(&w);
+
+    offsets[1] = w.at;                                  /* glyf */
+    loca[0] = 0;                                        /* .notdef: blank */
+    loca[1] = w.at - offsets[1];
+    SfntSimpleGlyph(&w, oPoints, oOn, oEnds, 2);
+    SfntAlign(&w);
+    loca[2] = w.at - offsets[1];
+    SfntSimpleGlyph(&w, hPoints, hOn, hEnds, 1);
+    SfntAlign(&w);
+    loca[3] = w.at - offsets[1];
+    SfntPut16(&w, 0xFFFF);                              /* composite */
+    SfntPut16(&w, 80);
+    SfntPut16(&w, (UInt16)-20);
+    SfntPut16(&w, 1670);
+    SfntPut16(&w, 1420);
+    SfntPut16(&w, 0x0023);                              /* words, xy, more */
+    SfntPut16(&w, 1);
+    SfntPut16(&w, 0);
+    SfntPut16(&w, 0);
+    SfntPut16(&w, 0x000B);                              /* words, xy, scale */
+    SfntPut16(&w, 2);
+    SfntPut16(&w, 1100);
+    SfntPut16(&w, 0);
+    SfntPut16(&w, 0x2000);                              /* 0.5 */
+    SfntAlign(&w);
+    loca[4] = w.at - offsets[1];
+
+    offsets[2] = w.at;
+    SfntHead(&w, kBenchUnitsPerEm, 80, -20, 1670, 1420);
+    offsets[3] = w.at;
+    SfntHhea(&w, 1600, -400, 1800, 4);
+
+    offsets[4] = w.at;                                  /* hmtx */
+    for (int g = 0; g < 4; g++) {
+        SfntPut16(&w, advance[g]);
+        SfntPut16(&w, 0);
+    }
+
+    offsets[5] = w.at;                                  /* loca */
+    for (int g = 0; g < 5; g++) SfntPut16(&w, loca[g] / 2);
+    SfntAlign(&w);
+
+    offsets[6] = w.at;
+    SfntMaxp(&w, 4);
+    offsets[7] = w.at;
+
+    SfntDirectory(&w, tags, offsets, 7);
+    *length = w.at;
+    return w.base;
+}
+
+static UInt32 OutlineBenchRate(UInt32 count, uint64_t ticks, uint64_t frequency) {
+    if (ticks == 0) return 0;
+    return (UInt32)udiv64((uint64_t)count * frequency, ticks);
+}
+
+void FontManager_OutlineBenchmark(void) {
+    static const short sizes[] = { 9, 12, 18, 24, 48, 96 };
+    static const char text[] = "OHQ HOQ QQOH OOHH HQOQ ";
+    TimeBaseInfo tb;
+    FMOutlineFont font;
+    UInt32 length = 0;
+    UInt8* sfnt = OutlineBenchFont(&length);
+
+    if (!sfnt || GetTimeBaseInfo(&tb) != noErr || tb.counterFrequency == 0 ||
+        FM_OpenOutlineFont(sfnt, length, &font) != noErr) {
+        serial_printf("[FONTBENCH] no font\n");
+        if (sfnt) DisposePtr((Ptr)sfnt);
+        return;
+    }
+
+    /* Straight from the outline, every time */
+    for (UInt32 s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        UInt32 glyphs = 0;
+        uint64_t t0 = PlatformCounterNow();
+        for (int pass = 0; pass < kBenchPasses; pass++) {
+            for (UInt16 g = 1; g <= 3; g++) {
+                FMGlyphBitmap* bitmap;
+                if (FM_RasterizeOutlineGlyph(&font, g, sizes[s], &bitmap) == noErr) {
+                    DisposePtr((Ptr)bitmap);
+                    glyphs++;
+                }
+            }
+        }
+        uint64_t ticks = PlatformCounterNow() - t0;
+        serial_printf("[FONTBENCH] rasterize %3dpx: %u glyphs/s\n", sizes[s],
+                      OutlineBenchRate(glyphs, ticks, tb.counterFrequency));
+    }
+
+    /* Through the cache: lines of text, mostly 12 point with some 9 and
+     * 18, the way a document mixes body text and headings */
+    OutlineCacheStats before, after;
+    UInt32 glyphs = 0;
+    FM_FlushOutlineGlyphs(NULL);
+    FM_GetOutlineCacheStats(&before);
+    uint64_t t0 = PlatformCounterNow();
+    for (int line = 0; line < kBenchLines; line++) {
+        short size = (line % 8 == 7) ? 18 : (line % 4 == 3) ? 9 : 12;
+        for (const char* c = text; *c; c++) {
+            if (FM_GetOutlineGlyph(&font, size, FM_OutlineGlyphIndex(&font, (UInt8)*c))) {
+                glyphs++;
+            }
+        }
+    }
+    uint64_t ticks = PlatformCounterNow() - t0;
+    FM_GetOutlineCacheStats(&after);
+
+    UInt32 hits = after.hits - before.hits;
+    UInt32 misses = after.misses - before.misses;
+    UInt32 permille = (hits + misses) ? (hits * 1000u) / (hits + misses) : 0;
+    serial_printf("[FONTBENCH] cached text: %u glyphs/s, %u hits %u misses, hit ratio %u.%u%%\n",
+                  OutlineBenchRate(glyphs, ticks, tb.counterFrequency), hits, misses,
+                  permille / 10, permille % 10);
+
+    FM_CloseOutlineFont(&font);
+    DisposePtr((Ptr)sfnt);
+}
+#endif /* FONT_BENCHMARK */
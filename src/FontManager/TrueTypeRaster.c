@@ -0,0 +1,721 @@
+/*
+ * TrueTypeRaster.c - Anti-aliased rasterizer for TrueType outlines
+ *
+ * TrueTypeFonts.c was written against a TTFont record that never landed
+ * and is not built, and its glyph extraction stops at a placeholder, so
+ * nothing turned a 'glyf' outline into pixels: text at a size with no
+ * strike is the nearest bitmap strike blown up by
+ * FM_ScaleCharNearestNeighbor. This is the outline path, self-contained:
+ * tables are read in place from the 'sfnt' bytes, big-endian.
+ *
+ * Rasterization is by signed-area accumulation. Each edge of the
+ * flattened outline adds, to the cells of every row it crosses, the area
+ * of that cell to the right of it, scaled by the edge's height within the
+ * row and signed by its direction. One running sum through the buffer
+ * then gives every pixel's coverage. There is no edge list to sort and no
+ * per-scanline crossing table; an edge costs the cells it touches. The
+ * absolute value of the sum is the coverage, which is nonzero winding for
+ * glyphs whose contours do not overlap and saturates where they do.
+ *
+ * Arithmetic is fixed point: 16.16 pixel coordinates and coverage with
+ * 1.0 = 65536. An edge's contributions to a row add up exactly to its
+ * signed height in that row, so rounding never carries into the next row
+ * through the running sum.
+ *
+ * Copyright (c) 2025 - System 7.1 Portable Project
+ */
+
+#include "SystemTypes.h"
+#include "FontManager/TrueTypeRaster.h"
+#include "FontManager/FontTypes.h"
+#include "FontManager/FontCache.h"
+#include "MemoryMgr/MemoryManager.h"
+#include <string.h>
+#include <stddef.h>
+
+#define kTTOne          65536
+#define kTTHalf         32768
+#define kTTMaxPoints    1024        /* points in one simple glyph */
+#define kTTMaxContours  256
+#define kTTMaxDepth     6           /* composite glyph nesting */
+#define kTTMaxSteps     32          /* lines per quadratic, power of two */
+#define kTTMaxBitmap    1024        /* pixels either way */
+
+/* Simple glyph point flags */
+enum {
+    kTTOnCurve  = 0x01,
+    kTTXShort   = 0x02,
+    kTTYShort   = 0x04,
+    kTTRepeat   = 0x08,
+    kTTXSame    = 0x10,             /* short: positive */
+    kTTYSame    = 0x20
+};
+
+/* Composite glyph component flags */
+enum {
+    kTTArgsAreWords   = 0x0001,
+    kTTArgsAreXY      = 0x0002,
+    kTTHaveScale      = 0x0008,
+    kTTMoreComponents = 0x0020,
+    kTTHaveXYScale    = 0x0040,
+    kTTHaveTwoByTwo   = 0x0080
+};
+
+/* Component placement, font units to font units:
+ * x' = a x + c y + e, y' = b x + d y + f, all 16.16 */
+typedef struct TTTransform {
+    SInt32  a, b, c, d;
+    SInt32  e, f;
+} TTTransform;
+
+typedef struct TTRaster {
+    const FMOutlineFont* font;
+    SInt32* acc;                /* width * height + 2 cells */
+    SInt32  width;
+    SInt32  height;
+    UInt32  scale;              /* pixels per font unit, 8.24 */
+    SInt32  originX;            /* bitmap left edge, 16.16 pixels */
+    SInt32  originY;            /* bitmap top */
+} TTRaster;
+
+/* One simple glyph's points, in bitmap pixels once transformed */
+static SInt32 gPointX[kTTMaxPoints];
+static SInt32 gPointY[kTTMaxPoints];
+static UInt8  gPointFlags[kTTMaxPoints];
+static UInt16 gEndPoints[kTTMaxContours];
+
+static UInt16 TTGet16(const UInt8* p) {
+    return (UInt16)((p[0] << 8) | p[1]);
+}
+
+static UInt32 TTGet32(const UInt8* p) {
+    return ((UInt32)p[0] << 24) | ((UInt32)p[1] << 16) | ((UInt32)p[2] << 8) | p[3];
+}
+
+static SInt32 TTMul(SInt32 a, SInt32 b) {
+    return (SInt32)(((SInt64)a * b) >> 16);
+}
+
+static UInt32 TTSqrt(UInt32 v) {
+    UInt32 root = 0;
+    UInt32 bit = 1u << 30;
+
+    while (bit > v) bit >>= 2;
+    while (bit) {
+        if (v >= root + bit) {
+            v -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+/* ================================================================
+ * 'sfnt' TABLES
+ * ================================================================ */
+
+OSErr FM_OpenOutlineFont(const void* sfnt, UInt32 length, FMOutlineFont* font) {
+    const UInt8* data = (const UInt8*)sfnt;
+    UInt32 head = 0, headLength = 0;
+    UInt32 maxp = 0, maxpLength = 0;
+    UInt32 hhea = 0, hheaLength = 0;
+    UInt32 cmap = 0, cmapLength = 0;
+
+    if (!sfnt || !font) return paramErr;
+    memset(font, 0, sizeof(*font));
+    if (length < 12) return fontCorruptErr;
+
+    UInt32 version = TTGet32(data);
+    if (version != 0x00010000 && version != 'true') return fontCorruptErr;
+    UInt16 numTables = TTGet16(data + 4);
+    if (12 + (UInt32)numTables * 16 > length) return fontCorruptErr;
+
+    for (UInt16 i = 0; i < numTables; i++) {
+        const UInt8* entry = data + 12 + i * 16;
+        UInt32 offset = TTGet32(entry + 8);
+        UInt32 size = TTGet32(entry + 12);
+
+        if (offset > length || size > length - offset) return fontCorruptErr;
+        switch (TTGet32(entry)) {
+            case 'head': head = offset; headLength = size; break;
+            case 'maxp': maxp = offset; maxpLength = size; break;
+            case 'hhea': hhea = offset; hheaLength = size; break;
+            case 'cmap': cmap = offset; cmapLength = size; break;
+            case 'loca': font->loca = offset; font->locaLength = size; break;
+            case 'glyf': font->glyf = offset; font->glyfLength = size; break;
+            case 'hmtx': font->hmtx = offset; font->hmtxLength = size; break;
+            default: break;
+        }
+    }
+
+    if (!head || headLength < 54 || !maxp || maxpLength < 6 || !font->loca || !font->glyf) {
+        return fontCorruptErr;
+    }
+    font->unitsPerEm = TTGet16(data + head + 18);
+    font->locaLong = (SInt16)TTGet16(data + head + 50);
+    font->numGlyphs = TTGet16(data + maxp + 4);
+    if (font->unitsPerEm < 16 || font->unitsPerEm > 16384 ||
+        (UInt32)(font->numGlyphs + 1) * (font->locaLong ? 4 : 2) > font->locaLength) {
+        return fontCorruptErr;
+    }
+
+    if (hhea && hheaLength >= 36) {
+        font->ascender = (SInt16)TTGet16(data + hhea + 4);
+        font->descender = (SInt16)TTGet16(data + hhea + 6);
+        font->numHMetrics = TTGet16(data + hhea + 34);
+    }
+    if ((UInt32)font->numHMetrics * 4 > font->hmtxLength) {
+        font->numHMetrics = (UInt16)(font->hmtxLength / 4);
+    }
+
+    /* Unicode mapping: the first (3,1) or (0,x) subtable in format 4 */
+    if (cmap && cmapLength >= 4) {
+        UInt16 records = TTGet16(data + cmap + 2);
+        for (UInt16 i = 0; i < records && 4 + (UInt32)(i + 1) * 8 <= cmapLength; i++) {
+            const UInt8* rec = data + cmap + 4 + i * 8;
+            UInt16 platform = TTGet16(rec);
+            UInt16 encoding = TTGet16(rec + 2);
+            UInt32 offset = TTGet32(rec + 4);
+
+            if (!(platform == 3 && encoding == 1) && platform != 0) continue;
+            if (offset + 4 > cmapLength || TTGet16(data + cmap + offset) != 4) continue;
+            UInt32 size = TTGet16(data + cmap + offset + 2);
+            if (size > cmapLength - offset) continue;
+            font->cmap4 = cmap + offset;
+            font->cmap4Length = size;
+            break;
+        }
+    }
+
+    font->data = data;
+    font->length = length;
+    return noErr;
+}
+
+void FM_CloseOutlineFont(FMOutlineFont* font) {
+    if (!font) return;
+    FM_FlushOutlineGlyphs(font);
+    memset(font, 0, sizeof(*font));
+}
+
+UInt16 FM_OutlineGlyphIndex(const FMOutlineFont* font, UInt16 unicode) {
+    if (!font || !font->cmap4 || font->cmap4Length < 16) return 0;
+
+    const UInt8* table = font->data + font->cmap4;
+    UInt16 segX2 = TTGet16(table + 6);
+    if (segX2 == 0 || 16 + 4u * segX2 > font->cmap4Length) return 0;
+
+    const UInt8* ends = table + 14;
+    const UInt8* starts = ends + segX2 + 2;
+    const UInt8* deltas = starts + segX2;
+    const UInt8* ranges = deltas + segX2;
+
+    /* End codes are ascending: the first segment ending at or after it */
+    UInt16 lo = 0, hi = segX2 / 2;
+    while (lo < hi) {
+        UInt16 mid = (UInt16)((lo + hi) / 2);
+        if (TTGet16(ends + 2 * mid) < unicode) lo = (UInt16)(mid + 1);
+        else hi = mid;
+    }
+    if (lo == segX2 / 2 || unicode < TTGet16(starts + 2 * lo)) return 0;
+
+    UInt16 delta = TTGet16(deltas + 2 * lo);
+    UInt16 rangeOffset = TTGet16(ranges + 2 * lo);
+    UInt16 glyph;
+    if (rangeOffset == 0) {
+        glyph = (UInt16)(unicode + delta);
+    } else {
+        /* idRangeOffset counts from its own slot into glyphIdArray */
+        UInt32 at = (UInt32)(ranges + 2 * lo - table) + rangeOffset +
+                    2u * (UInt32)(unicode - TTGet16(starts + 2 * lo));
+        if (at + 2 > font->cmap4Length) return 0;
+        glyph = TTGet16(table + at);
+        if (glyph != 0) glyph = (UInt16)(glyph + delta);
+    }
+    return glyph < font->numGlyphs ? glyph : 0;
+}
+
+/* Mac Roman 0x80-0xFF in Unicode, as System 7 had it (0xDB is the
+ * currency sign, not the euro) */
+static const UInt16 kMacRomanHigh[128] = {
+    0x00C4, 0x00C5, 0x00C7, 0x00C9, 0x00D1, 0x00D6, 0x00DC, 0x00E1,
+    0x00E0, 0x00E2, 0x00E4, 0x00E3, 0x00E5, 0x00E7, 0x00E9, 0x00E8,
+    0x00EA, 0x00EB, 0x00ED, 0x00EC, 0x00EE, 0x00EF, 0x00F1, 0x00F3,
+    0x00F2, 0x00F4, 0x00F6, 0x00F5, 0x00FA, 0x00F9, 0x00FB, 0x00FC,
+    0x2020, 0x00B0, 0x00A2, 0x00A3, 0x00A7, 0x2022, 0x00B6, 0x00DF,
+    0x00AE, 0x00A9, 0x2122, 0x00B4, 0x00A8, 0x2260, 0x00C6, 0x00D8,
+    0x221E, 0x00B1, 0x2264, 0x2265, 0x00A5, 0x00B5, 0x2202, 0x2211,
+    0x220F, 0x03C0, 0x222B, 0x00AA, 0x00BA, 0x03A9, 0x00E6, 0x00F8,
+    0x00BF, 0x00A1, 0x00AC, 0x221A, 0x0192, 0x2248, 0x2206, 0x00AB,
+    0x00BB, 0x2026, 0x00A0, 0x00C0, 0x00C3, 0x00D5, 0x0152, 0x0153,
+    0x2013, 0x2014, 0x201C, 0x201D, 0x2018, 0x2019, 0x00F7, 0x25CA,
+    0x00FF, 0x0178, 0x2044, 0x00A4, 0x2039, 0x203A, 0xFB01, 0xFB02,
+    0x2021, 0x00B7, 0x201A, 0x201E, 0x2030, 0x00C2, 0x00CA, 0x00C1,
+    0x00CB, 0x00C8, 0x00CD, 0x00CE, 0x00CF, 0x00CC, 0x00D3, 0x00D4,
+    0xF8FF, 0x00D2, 0x00DA, 0x00DB, 0x00D9, 0x0131, 0x02C6, 0x02DC,
+    0x00AF, 0x02D8, 0x02D9, 0x02DA, 0x00B8, 0x02DD, 0x02DB, 0x02C7
+};
+
+UInt16 FM_OutlineCharGlyph(const FMOutlineFont* font, UInt8 ch) {
+    return FM_OutlineGlyphIndex(font, ch < 0x80 ? ch : kMacRomanHigh[ch - 0x80]);
+}
+
+static Boolean TTGlyphData(const FMOutlineFont* font, UInt16 glyph,
+                           const UInt8** data, UInt32* length) {
+    const UInt8* loca = font->data + font->loca;
+    UInt32 start, end;
+
+    if (glyph >= font->numGlyphs) return false;
+    if (font->locaLong) {
+        start = TTGet32(loca + 4 * glyph);
+        end = TTGet32(loca + 4 * glyph + 4);
+    } else {
+        start = 2u * TTGet16(loca + 2 * glyph);
+        end = 2u * TTGet16(loca + 2 * glyph + 2);
+    }
+    if (start > end || end > font->glyfLength) return false;
+    *data = font->data + font->glyf + start;
+    *length = end - start;
+    return true;
+}
+
+static SInt16 TTAdvance(const FMOutlineFont* font, UInt16 glyph, UInt32 scale) {
+    if (font->numHMetrics == 0) return 0;
+    UInt16 metric = glyph < font->numHMetrics ? glyph : (UInt16)(font->numHMetrics - 1);
+    UInt32 advance = TTGet16(font->data + font->hmtx + 4 * metric);
+    return (SInt16)(((UInt64)advance * scale + (1u << 23)) >> 24);
+}
+
+/* Font units to 16.16 pixels, at the em scale alone */
+static SInt32 TTScaleUnits(const TTRaster* r, SInt32 units) {
+    return (SInt32)(((SInt64)units * 256 * r->scale) >> 16);
+}
+
+static void TTMapPoint(const TTRaster* r, const TTTransform* m, SInt32 x, SInt32 y,
+                       SInt32* px, SInt32* py) {
+    /* 24.8 font units, so the em scale multiply stays inside 64 bits */
+    SInt64 fx = ((SInt64)m->a * x + (SInt64)m->c * y + m->e) >> 8;
+    SInt64 fy = ((SInt64)m->b * x + (SInt64)m->d * y + m->f) >> 8;
+
+    *px = (SInt32)((fx * (SInt64)r->scale) >> 16) - r->originX;
+    *py = r->originY - (SInt32)((fy * (SInt64)r->scale) >> 16);
+}
+
+/* ================================================================
+ * ACCUMULATION
+ * ================================================================ */
+
+/*
+ * One row's piece of an edge, from xa to xb across the row, d its signed
+ * height there. Each cell gets d times the part of it lying right of the
+ * edge, less what the cells before it already got - so the cell after
+ * the edge's last carries the remainder and the row's total is d.
+ */
+static void TTCells(SInt32* cells, SInt32 maxX, SInt32 xa, SInt32 xb, SInt32 d) {
+    if (xa > xb) {
+        SInt32 t = xa;
+        xa = xb;
+        xb = t;
+    }
+    if (xa < 0) xa = 0;
+    if (xb > maxX) xb = maxX;
+    if (xa > xb) xa = xb;
+
+    SInt32 i0 = xa >> 16;
+    SInt32 i1 = (xb + 0xFFFF) >> 16;        /* cell after the last touched */
+    SInt32 dx8 = (xb - xa) >> 8;
+
+    if (i1 <= i0 + 1 || dx8 == 0) {
+        /* Within one column, or near enough: split at the mean x */
+        SInt32 right = (SInt32)(((SInt64)d * (((xa + xb) >> 1) - i0 * kTTOne)) >> 16);
+        cells[i0] += d - right;
+        cells[i0 + 1] += right;
+        return;
+    }
+
+    /* The triangles cut off in the first and last cells; .8 widths keep
+     * these divides in 32 bits */
+    SInt32 u = (kTTOne - (xa & 0xFFFF)) >> 8;
+    SInt32 v = (xb - (i1 - 1) * kTTOne) >> 8;
+    SInt32 a0 = (u * u << 7) / dx8;
+    SInt32 am = (v * v << 7) / dx8;
+    SInt32 c = (SInt32)(((SInt64)d * a0) >> 16);
+    SInt32 sum = c;
+
+    cells[i0] += c;
+    if (i1 == i0 + 2) {
+        c = (SInt32)(((SInt64)d * (kTTOne - a0 - am)) >> 16);
+        cells[i0 + 1] += c;
+        sum += c;
+    } else {
+        SInt32 step = (kTTOne << 8) / dx8;          /* area per whole cell */
+        SInt32 a1 = ((u + 128) << 16) / dx8;
+        SInt32 a2 = a1 + (i1 - i0 - 3) * step;
+        SInt32 middle = (SInt32)(((SInt64)d * step) >> 16);
+
+        c = (SInt32)(((SInt64)d * (a1 - a0)) >> 16);
+        cells[i0 + 1] += c;
+        sum += c;
+        for (SInt32 i = i0 + 2; i < i1 - 1; i++) {
+            cells[i] += middle;
+            sum += middle;
+        }
+        c = (SInt32)(((SInt64)d * (kTTOne - a2 - am)) >> 16);
+        cells[i1 - 1] += c;
+        sum += c;
+    }
+    cells[i1] += d - sum;
+}
+
+static void TTLine(TTRaster* r, SInt32 x0, SInt32 y0, SInt32 x1, SInt32 y1) {
+    SInt32 dir = 1;
+
+    if (y0 == y1) return;
+    if (y0 > y1) {
+        SInt32 t = x0; x0 = x1; x1 = t;
+        t = y0; y0 = y1; y1 = t;
+        dir = -1;
+    }
+    if (y1 <= 0 || y0 >= r->height * kTTOne) return;
+
+    SInt64 dxdy = (SInt64)(x1 - x0) * kTTOne / (y1 - y0);
+    SInt32 row = y0 > 0 ? (y0 >> 16) : 0;
+    SInt32 rowEnd = (y1 + 0xFFFF) >> 16;
+    SInt32 maxX = r->width * kTTOne;
+    SInt32 segTop = y0 > 0 ? y0 : 0;
+    SInt32 xTop = x0 + (SInt32)((dxdy * (segTop - y0)) >> 16);
+
+    if (rowEnd > r->height) rowEnd = r->height;
+    for (; row < rowEnd; row++) {
+        SInt32 rowBottom = (row + 1) * kTTOne;
+        SInt32 segBottom = rowBottom < y1 ? rowBottom : y1;
+        SInt32 xBottom = segBottom == y1 ? x1 : x0 + (SInt32)((dxdy * (segBottom - y0)) >> 16);
+
+        TTCells(r->acc + row * r->width, maxX, xTop, xBottom, (segBottom - segTop) * dir);
+        segTop = segBottom;
+        xTop = xBottom;
+    }
+}
+
+/*
+ * Quadratic Bezier as n lines, n a power of two. A curve whose second
+ * difference is dev strays at most |dev| / 4n^2 from its n chords, so
+ * n^4 >= 16 |dev|^2 holds that to 1/16 pixel.
+ */
+static void TTQuad(TTRaster* r, SInt32 x0, SInt32 y0, SInt32 cx, SInt32 cy,
+                   SInt32 x1, SInt32 y1) {
+    SInt64 ddx = (SInt64)x0 - 2 * (SInt64)cx + x1;
+    SInt64 ddy = (SInt64)y0 - 2 * (SInt64)cy + y1;
+    UInt32 deviation = (UInt32)((ddx * ddx + ddy * ddy) >> 28);    /* 16 |dev|^2 */
+    UInt32 wanted = TTSqrt(TTSqrt(deviation)) + 1;
+    SInt32 steps = 1, shift = 0;
+
+    while ((UInt32)steps < wanted && steps < kTTMaxSteps) {
+        steps <<= 1;
+        shift++;
+    }
+
+    SInt32 px = x0, py = y0;
+    for (SInt32 i = 1; i <= steps; i++) {
+        SInt64 t = i, s = steps - i;
+        SInt32 nx = (SInt32)((s * s * x0 + 2 * s * t * cx + t * t * x1) >> (2 * shift));
+        SInt32 ny = (SInt32)((s * s * y0 + 2 * s * t * cy + t * t * y1) >> (2 * shift));
+        TTLine(r, px, py, nx, ny);
+        px = nx;
+        py = ny;
+    }
+}
+
+/* ================================================================
+ * GLYPH OUTLINES
+ * ================================================================ */
+
+/* Contour first..last of the points in gPointX/Y: off-curve points are
+ * quadratic controls, with an on-curve point implied between two of them */
+static void TTContour(TTRaster* r, UInt16 first, UInt16 last) {
+    SInt32 startX, startY;
+    UInt16 i, n;
+
+    if (last <= first) return;
+    if (gPointFlags[first] & kTTOnCurve) {
+        startX = gPointX[first];
+        startY = gPointY[first];
+        i = (UInt16)(first + 1);
+        n = (UInt16)(last - first);
+    } else if (gPointFlags[last] & kTTOnCurve) {
+        startX = gPointX[last];
+        startY = gPointY[last];
+        i = first;
+        n = (UInt16)(last - first);
+    } else {
+        startX = (gPointX[first] + gPointX[last]) >> 1;
+        startY = (gPointY[first] + gPointY[last]) >> 1;
+        i = first;
+        n = (UInt16)(last - first + 1);
+    }
+
+    SInt32 penX = startX, penY = startY;
+    SInt32 ctrlX = 0, ctrlY = 0;
+    Boolean haveCtrl = false;
+
+    for (; n > 0; n--, i++) {
+        SInt32 x = gPointX[i], y = gPointY[i];
+
+        if (gPointFlags[i] & kTTOnCurve) {
+            if (haveCtrl) TTQuad(r, penX, penY, ctrlX, ctrlY, x, y);
+            else TTLine(r, penX, penY, x, y);
+            penX = x;
+            penY = y;
+            haveCtrl = false;
+        } else {
+            if (haveCtrl) {
+                SInt32 midX = (ctrlX + x) >> 1, midY = (ctrlY + y) >> 1;
+                TTQuad(r, penX, penY, ctrlX, ctrlY, midX, midY);
+                penX = midX;
+                penY = midY;
+            }
+            ctrlX = x;
+            ctrlY = y;
+            haveCtrl = true;
+        }
+    }
+    if (haveCtrl) TTQuad(r, penX, penY, ctrlX, ctrlY, startX, startY);
+    else TTLine(r, penX, penY, startX, startY);
+}
+
+static OSErr TTSimpleGlyph(TTRaster* r, const TTTransform* m, const UInt8* p,
+                           UInt32 length, SInt16 contours) {
+    const UInt8* end = p + length;
+    const UInt8* q = p + 10;
+    UInt16 points = 0;
+
+    if (contours > kTTMaxContours || length < 12 + 2u * contours) return fontCorruptErr;
+    for (SInt16 c = 0; c < contours; c++, q += 2) {
+        gEndPoints[c] = TTGet16(q);
+        if (gEndPoints[c] < points || gEndPoints[c] >= kTTMaxPoints) return fontCorruptErr;
+        points = (UInt16)(gEndPoints[c] + 1);
+    }
+    q += 2 + TTGet16(q);                    /* hinting instructions: unused */
+    if (q > end) return fontCorruptErr;
+
+    for (UInt16 i = 0; i < points; ) {
+        if (q >= end) return fontCorruptErr;
+        UInt8 flag = *q++;
+        UInt16 repeat = 1;
+        if (flag & kTTRepeat) {
+            if (q >= end) return fontCorruptErr;
+            repeat += *q++;
+        }
+        while (repeat-- > 0 && i < points) gPointFlags[i++] = flag;
+    }
+
+    SInt32 x = 0;
+    for (UInt16 i = 0; i < points; i++) {
+        UInt8 flag = gPointFlags[i];
+        if (flag & kTTXShort) {
+            if (q >= end) return fontCorruptErr;
+            x += (flag & kTTXSame) ? *q : -*q;
+            q++;
+        } else if (!(flag & kTTXSame)) {
+            if (q + 2 > end) return fontCorruptErr;
+            x += (SInt16)TTGet16(q);
+            q += 2;
+        }
+        gPointX[i] = x;
+    }
+    SInt32 y = 0;
+    for (UInt16 i = 0; i < points; i++) {
+        UInt8 flag = gPointFlags[i];
+        if (flag & kTTYShort) {
+            if (q >= end) return fontCorruptErr;
+            y += (flag & kTTYSame) ? *q : -*q;
+            q++;
+        } else if (!(flag & kTTYSame)) {
+            if (q + 2 > end) return fontCorruptErr;
+            y += (SInt16)TTGet16(q);
+            q += 2;
+        }
+        gPointY[i] = y;
+    }
+
+    for (UInt16 i = 0; i < points; i++) {
+        TTMapPoint(r, m, gPointX[i], gPointY[i], &gPointX[i], &gPointY[i]);
+    }
+    UInt16 first = 0;
+    for (SInt16 c = 0; c < contours; c++) {
+        TTContour(r, first, gEndPoints[c]);
+        first = (UInt16)(gEndPoints[c] + 1);
+    }
+    return noErr;
+}
+
+static OSErr TTGlyphOutline(TTRaster* r, const TTTransform* m, UInt16 glyph, SInt16 depth);
+
+static SInt32 TTF2Dot14(const UInt8* p) {
+    return (SInt32)(SInt16)TTGet16(p) * 4;
+}
+
+static OSErr TTCompositeGlyph(TTRaster* r, const TTTransform* m, const UInt8* p,
+                              UInt32 length, SInt16 depth) {
+    const UInt8* end = p + length;
+    const UInt8* q = p + 10;
+    UInt16 flags;
+
+    do {
+        TTTransform c, t;
+        SInt32 dx, dy;
+
+        if (q + 4 > end) return fontCorruptErr;
+        flags = TTGet16(q);
+        UInt16 component = TTGet16(q + 2);
+        q += 4;
+
+        if (flags & kTTArgsAreWords) {
+            if (q + 4 > end) return fontCorruptErr;
+            dx = (SInt16)TTGet16(q);
+            dy = (SInt16)TTGet16(q + 2);
+            q += 4;
+        } else {
+            if (q + 2 > end) return fontCorruptErr;
+            dx = (SInt8)q[0];
+            dy = (SInt8)q[1];
+            q += 2;
+        }
+        if (!(flags & kTTArgsAreXY)) {
+            dx = dy = 0;                    /* anchored by point number: not done */
+        }
+
+        c.a = kTTOne; c.b = 0; c.c = 0; c.d = kTTOne;
+        c.e = dx * kTTOne;
+        c.f = dy * kTTOne;
+        if (flags & kTTHaveScale) {
+            if (q + 2 > end) return fontCorruptErr;
+            c.a = c.d = TTF2Dot14(q);
+            q += 2;
+        } else if (flags & kTTHaveXYScale) {
+            if (q + 4 > end) return fontCorruptErr;
+            c.a = TTF2Dot14(q);
+            c.d = TTF2Dot14(q + 2);
+            q += 4;
+        } else if (flags & kTTHaveTwoByTwo) {
+            if (q + 8 > end) return fontCorruptErr;
+            c.a = TTF2Dot14(q);
+            c.b = TTF2Dot14(q + 2);
+            c.c = TTF2Dot14(q + 4);
+            c.d = TTF2Dot14(q + 6);
+            q += 8;
+        }
+
+        t.a = TTMul(m->a, c.a) + TTMul(m->c, c.b);
+        t.b = TTMul(m->b, c.a) + TTMul(m->d, c.b);
+        t.c = TTMul(m->a, c.c) + TTMul(m->c, c.d);
+        t.d = TTMul(m->b, c.c) + TTMul(m->d, c.d);
+        t.e = TTMul(m->a, c.e) + TTMul(m->c, c.f) + m->e;
+        t.f = TTMul(m->b, c.e) + TTMul(m->d, c.f) + m->f;
+
+        OSErr err = TTGlyphOutline(r, &t, component, (SInt16)(depth + 1));
+        if (err != noErr) return err;
+    } while (flags & kTTMoreComponents);
+
+    return noErr;
+}
+
+static OSErr TTGlyphOutline(TTRaster* r, const TTTransform* m, UInt16 glyph, SInt16 depth) {
+    const UInt8* p;
+    UInt32 length;
+
+    if (depth > kTTMaxDepth || !TTGlyphData(r->font, glyph, &p, &length)) {
+        return fontCorruptErr;
+    }
+    if (length == 0) return noErr;
+    if (length < 10) return fontCorruptErr;
+
+    SInt16 contours = (SInt16)TTGet16(p);
+    if (contours == 0) return noErr;
+    if (contours > 0) return TTSimpleGlyph(r, m, p, length, contours);
+    return TTCompositeGlyph(r, m, p, length, depth);
+}
+
+/* Running sum of the accumulated areas: coverage, as bytes */
+static void TTResolve(const SInt32* acc, UInt8* coverage, UInt32 count) {
+    SInt32 sum = 0;
+
+    for (UInt32 i = 0; i < count; i++) {
+        sum += acc[i];
+        SInt32 v = sum < 0 ? -sum : sum;
+        if (v > kTTOne) v = kTTOne;
+        coverage[i] = (UInt8)((v * 255 + kTTHalf) >> 16);
+    }
+}
+
+OSErr FM_RasterizeOutlineGlyph(const FMOutlineFont* font, UInt16 glyph, short size,
+                               FMGlyphBitmap** bitmap) {
+    TTRaster r;
+    TTTransform identity;
+    const UInt8* p;
+    UInt32 length;
+    SInt32 left = 0, top = 0, width = 0, height = 0;
+
+    if (!bitmap) return paramErr;
+    *bitmap = NULL;
+    if (!font || !font->data || size <= 0 || size > kFMOutlineMaxSize) return paramErr;
+    if (!TTGlyphData(font, glyph, &p, &length)) return fontNotFoundErr;
+
+    memset(&r, 0, sizeof(r));
+    r.font = font;
+    r.scale = ((UInt32)size << 24) / font->unitsPerEm;
+
+    if (length >= 10) {
+        /* The header's bounding box, rounded out to whole pixels */
+        left = TTScaleUnits(&r, (SInt16)TTGet16(p + 2)) >> 16;
+        SInt32 bottom = TTScaleUnits(&r, (SInt16)TTGet16(p + 4)) >> 16;
+        SInt32 right = (TTScaleUnits(&r, (SInt16)TTGet16(p + 6)) + 0xFFFF) >> 16;
+        top = (TTScaleUnits(&r, (SInt16)TTGet16(p + 8)) + 0xFFFF) >> 16;
+        width = right - left;
+        height = top - bottom;
+        if (width < 0 || height < 0 || width > kTTMaxBitmap || height > kTTMaxBitmap) {
+            return fontCorruptErr;
+        }
+        if (width == 0 || height == 0) width = height = 0;
+    }
+
+    FMGlyphBitmap* bm = (FMGlyphBitmap*)(void*)NewPtr(
+        (Size)(offsetof(FMGlyphBitmap, coverage) + (UInt32)(width * height)));
+    if (!bm) return memFullErr;
+    bm->width = (SInt16)width;
+    bm->height = (SInt16)height;
+    bm->left = (SInt16)left;
+    bm->top = (SInt16)top;
+    bm->advance = TTAdvance(font, glyph, r.scale);
+    if (width == 0) {
+        *bitmap = bm;
+        return noErr;
+    }
+
+    r.acc = (SInt32*)(void*)NewPtrClear((Size)((UInt32)(width * height + 2) * sizeof(SInt32)));
+    if (!r.acc) {
+        DisposePtr((Ptr)bm);
+        return memFullErr;
+    }
+    r.width = width;
+    r.height = height;
+    r.originX = left * kTTOne;
+    r.originY = top * kTTOne;
+    identity.a = kTTOne; identity.b = 0; identity.c = 0; identity.d = kTTOne;
+    identity.e = 0; identity.f = 0;
+
+    OSErr err = TTGlyphOutline(&r, &identity, glyph, 0);
+    if (err == noErr) {
+        TTResolve(r.acc, bm->coverage, (UInt32)(width * height));
+    }
+    DisposePtr((Ptr)r.acc);
+    if (err != noErr) {
+        DisposePtr((Ptr)bm);
+        return err;
+    }
+    *bitmap = bm;
+    return noErr;
+}
@@ -7,6 +7,7 @@
 #include "SystemTypes.h"
 #include "Gestalt/Gestalt.h"
 #include "Gestalt/GestaltPriv.h"
+#include "MemoryMgr/MemoryManager.h"
 
 #if defined(__powerpc__) || defined(__powerpc64__)
 #include "Platform/include/boot.h"
@@ -36,6 +37,7 @@ static const OSType kSel_fpu_ = FOURCC('f','p','u',' ');
 static const OSType kSel_init = FOURCC('i','n','i','t');
 static const OSType kSel_evnt = FOURCC('e','v','n','t');
 static const OSType kSel_pcop = FOURCC('p','c','o','p');  /* Process coop */
+static const OSType kSel_hprf = FOURCC('h','p','r','f');  /* Heap telemetry */
 #if defined(__powerpc__) || defined(__powerpc64__)
 static const OSType kSel_mmap = FOURCC('m','m','a','p');
 #endif
@@ -283,6 +285,23 @@ static OSErr gestalt_pcop(long *response) {
     return noErr;
 }
 
+/* Built-in selector: heap telemetry snapshot
+ *
+ * Like 'mmap', the response is a pointer - here to a fresh
+ * MemoryManager_Snapshot, whose length is in its header. Each call
+ * overwrites the last. scripts/heapsnap.py decodes it. */
+static OSErr gestalt_hprf(long *response) {
+    static UInt8 snapshot[MM_SNAPSHOT_MAX];
+
+    if (!response) return paramErr;
+
+    if (MemoryManager_Snapshot(snapshot, sizeof(snapshot)) > sizeof(snapshot)) {
+        return gestaltUnknownErr;
+    }
+    *response = (long)(uintptr_t)snapshot;
+    return noErr;
+}
+
 /* Register all built-in selectors */
 void Gestalt_Register_Builtins(void) {
     OSErr err;
@@ -323,6 +342,9 @@ void Gestalt_Register_Builtins(void) {
     /* Process Manager cooperative features */
     err = NewGestalt(kSel_pcop, gestalt_pcop);
 
+    /* Memory Manager telemetry */
+    err = NewGestalt(kSel_hprf, gestalt_hprf);
+
     /* Unused variable warning suppression */
     (void)err;
 }
@@ -411,6 +411,16 @@ static void freelist_remove(ZoneInfo* z, BlockHeader* b) {
 
 /* ======================== Coalescing ======================== */
 
+/* A block is being merged into another. If idle compaction was to resume
+ * at it, it resumes at what it became part of: the cursor is a byte offset
+ * and has to stay on a block boundary. Splits only add boundaries, and
+ * merges are the one place outside compaction that takes them away. */
+static inline void compact_cursor_merged(ZoneInfo* z, BlockHeader* gone, BlockHeader* into) {
+    if ((u8*)gone == z->base + z->compactCursor) {
+        z->compactCursor = (u32)((u8*)into - z->base);
+    }
+}
+
 static BlockHeader* coalesce_forward(ZoneInfo* z, BlockHeader* b) {
     if (!b || !z) return b;  /* Defensive: NULL checks */
 
@@ -445,6 +455,7 @@ static BlockHeader* coalesce_forward(ZoneInfo* z, BlockHeader* b) {
         }
 
         freelist_remove(z, next);
+        compact_cursor_merged(z, next, b);
         b->size += next->size;
 
         /* CRITICAL: Ensure coalesced size is aligned */
@@ -507,6 +518,7 @@ static BlockHeader* coalesce_backward(ZoneInfo* z, BlockHeader* b) {
         }
 
         freelist_remove(z, prev);
+        compact_cursor_merged(z, b, prev);
         prev->size += b->size;
 
         /* CRITICAL: Ensure coalesced size is aligned */
@@ -617,19 +629,19 @@ u32 HeapUsed(void) {
     return gCurrentZone ? gCurrentZone->bytesUsed : 0;
 }
 
-u32 MaxMem(void) {
-    if (!gCurrentZone) return 0;
+/* The largest free block in z, header included */
+static u32 largest_free_block(ZoneInfo* z) {
 
     u32 maxBlock = 0;
 
     /* Search all size classes for largest block */
     for (u32 sc = 0; sc < NUM_SIZE_CLASSES; sc++) {
-        FreeNode* head = gCurrentZone->freelists[sc];
+        FreeNode* head = z->freelists[sc];
         if (!head) continue;
 
         /* Validate head pointer before use */
-        if (!is_valid_freenode(gCurrentZone, head)) {
-            gCurrentZone->freelists[sc] = NULL;
+        if (!is_valid_freenode(z, head)) {
+            z->freelists[sc] = NULL;
             continue;
         }
 
@@ -639,9 +651,9 @@ u32 MaxMem(void) {
 
         do {
             /* Defensive: validate pointer */
-            if (!is_valid_freenode(gCurrentZone, it) ||
-                !is_valid_freenode(gCurrentZone, it->next)) {
-                gCurrentZone->freelists[sc] = NULL;
+            if (!is_valid_freenode(z, it) ||
+                !is_valid_freenode(z, it->next)) {
+                z->freelists[sc] = NULL;
                 break;
             }
 
@@ -654,12 +666,19 @@ u32 MaxMem(void) {
             /* Safety limit */
             loop_safety++;
             if (loop_safety > 10000) {
-                gCurrentZone->freelists[sc] = NULL;
+                z->freelists[sc] = NULL;
                 break;
             }
         } while (it != start);
     }
 
+    return maxBlock;
+}
+
+u32 MaxMem(void) {
+    if (!gCurrentZone) return 0;
+
+    u32 maxBlock = largest_free_block(gCurrentZone);
     return maxBlock > BLKHDR_SZ ? maxBlock - BLKHDR_SZ : 0;
 }
 
@@ -840,9 +859,345 @@ static void split_block(ZoneInfo* z, BlockHeader* b, u32 need) {
     }
 }
 
+/* ======================== Heap Statistics ======================== */
+
+/*
+ * Every zone counts its allocations and frees by size class, and what
+ * compaction and purging cost it. They are increments, cheap enough to keep
+ * on always; before them the only way to see what was churning a heap was
+ * to add serial_puts calls and rebuild.
+ *
+ * MEMORY_PROFILE=1 also counts allocations by call site - the return
+ * address of NewPtr, NewHandle or whichever wrapper the caller used - in an
+ * open-addressed table. Once it is full, new sites share one overflow entry.
+ */
+#ifndef MEMORY_PROFILE
+#define MEMORY_PROFILE 0
+#endif
+
+#define CALLER_PC() __builtin_return_address(0)
+
+#if MEMORY_PROFILE
+#define PROFILE_MAX_PROBES 16u
+
+typedef struct AllocSite {
+    uintptr_t pc;
+    u32       allocs;
+    u32       bytes;
+} AllocSite;
+
+static AllocSite gAllocSites[MM_PROFILE_SITES];
+static AllocSite gAllocSiteOverflow;     /* pc 0 */
+
+static void profile_site(void* site, u32 bytes) {
+    uintptr_t pc = (uintptr_t)site;
+    u32 i = (u32)(pc >> 2) * 2654435761u % MM_PROFILE_SITES;
+
+    for (u32 probe = 0; probe < PROFILE_MAX_PROBES; probe++) {
+        AllocSite* e = &gAllocSites[i];
+        if (e->pc == 0) {
+            e->pc = pc;
+        }
+        if (e->pc == pc) {
+            e->allocs++;
+            e->bytes += bytes;
+            return;
+        }
+        i = (i + 1) % MM_PROFILE_SITES;
+    }
+    gAllocSiteOverflow.allocs++;
+    gAllocSiteOverflow.bytes += bytes;
+}
+#endif
+
+static inline void stats_alloc(ZoneInfo* z, BlockHeader* b, void* site) {
+    z->stats.allocs[get_size_class(b->size)]++;
+#if MEMORY_PROFILE
+    profile_site(site, b->size);
+#else
+    (void)site;
+#endif
+}
+
+static inline void stats_free(ZoneInfo* z, BlockHeader* b) {
+    z->stats.frees[get_size_class(b->size)]++;
+}
+
+/* ======================== Slab Caches ======================== */
+
+/*
+ * Small blocks come from slabs: 4KB blocks of the zone, each cut into equal
+ * objects of one size class with a bitmap saying which are in use. Taking
+ * or returning one is a bit operation, where find_fit walks the freelists
+ * validating every node it passes and DisposePtr validates all of them
+ * twice - a cost regions, event records and the Toolbox's small handles
+ * were paying on every call.
+ *
+ * Every object still starts with a BlockHeader, so whatever looks at a block
+ * through its header - GetPtrSize, GetHandleSize, RecoverHandle, HLock, the
+ * canary check - works unchanged. Its size is what the freelist path would
+ * have made it rather than the slab's stride, so sizes read back the same
+ * either way. prevSize, which only coalescing uses, holds the object's
+ * offset from the slab's header instead.
+ *
+ * To the rest of the zone a slab is one non-relocatable block: heap walks
+ * step over it and CompactMem works around it as it does any Ptr. So a
+ * handle in a slab does not move when the zone is compacted, and PurgeMem
+ * cannot reach it. A fresh handle is not purgeable, so it may start in a
+ * slab. HPurge moves it out to an ordinary block, where PurgeMem finds it.
+ * A locked handle cannot move, so it is moved when HUnlock unlocks it.
+ * Only a zone with no room for 192 bytes keeps a purgeable handle in a
+ * slab. A slab that empties is kept as its class's spare; a second is given
+ * back at once, and CompactMem gives back the spares before it moves
+ * anything.
+ */
+#define SLAB_BYTES      4096u
+#define SLAB_MAGIC      0x51AB51ABu
+#define SLAB_MAP_WORDS  4       /* 128 objects, more than the smallest stride fits */
+
+/* Object strides, header included. Multiples of ALIGN. */
+static const u16 kSlabStrides[NUM_SLAB_CLASSES] = { 32, 48, 64, 96, 128, 192 };
+
+typedef struct Slab {
+    u32          magic;
+    ZoneInfo*    zone;
+    struct Slab* next;          /* in its class's partial list */
+    struct Slab* prev;
+    u16          stride;
+    u16          count;         /* objects */
+    u16          nfree;
+    u8           cls;
+    u8           listed;        /* on the partial list */
+    u32          first;         /* offset of object 0 from the slab's header */
+    u32          map[SLAB_MAP_WORDS];   /* set = in use; bits past count stay set */
+} Slab;
+
+/* Off only while the benchmark measures the freelists alone */
+static bool gSlabsEnabled = true;
+
+static inline Slab* slab_of_block(BlockHeader* blk) {
+    return (Slab*)((u8*)blk + BLKHDR_SZ);
+}
+
+static inline BlockHeader* slab_block(Slab* s) {
+    return (BlockHeader*)((u8*)s - BLKHDR_SZ);
+}
+
+static void slab_list_push(SlabCache* c, Slab* s) {
+    s->prev = NULL;
+    s->next = c->partial;
+    if (c->partial) c->partial->prev = s;
+    c->partial = s;
+    s->listed = 1;
+}
+
+static void slab_list_unlink(SlabCache* c, Slab* s) {
+    if (!s->listed) return;
+    if (s->prev) s->prev->next = s->next;
+    else c->partial = s->next;
+    if (s->next) s->next->prev = s->prev;
+    s->next = s->prev = NULL;
+    s->listed = 0;
+}
+
+/* A new slab from the freelists. No compaction for it: if the zone is that
+ * tight, the request goes down the ordinary path, which does compact. */
+static Slab* slab_new(ZoneInfo* z, u32 cls) {
+    BlockHeader* blk = find_fit(z, SLAB_BYTES);
+    if (!blk) return NULL;
+
+    split_block(z, blk, SLAB_BYTES);
+    blk->flags |= BF_PTR | BF_SLAB;
+    blk->lockCount = 0;
+    blk->masterPtr = NULL;
+    z->bytesUsed += blk->size;
+    z->bytesFree -= blk->size;
+
+    Slab* s = slab_of_block(blk);
+    memset(s, 0, sizeof(*s));
+    s->magic = SLAB_MAGIC;
+    s->zone = z;
+    s->stride = kSlabStrides[cls];
+    s->cls = (u8)cls;
+    s->first = align_up(BLKHDR_SZ + (u32)sizeof(Slab));
+    s->count = (u16)((blk->size - s->first) / s->stride);
+    if (s->count > SLAB_MAP_WORDS * 32) {
+        s->count = SLAB_MAP_WORDS * 32;
+    }
+    s->nfree = s->count;
+    for (u32 i = s->count; i < SLAB_MAP_WORDS * 32; i++) {
+        s->map[i >> 5] |= 1u << (i & 31);
+    }
+    z->slabs[cls].slabs++;
+    return s;
+}
+
+/* Give an empty slab back to the freelists */
+static void slab_destroy(Slab* s) {
+    ZoneInfo* z = s->zone;
+    BlockHeader* blk = slab_block(s);
+
+    z->slabs[s->cls].slabs--;
+    s->magic = 0;
+    blk->flags &= ~(BF_PTR | BF_SLAB);
+    z->bytesUsed -= blk->size;
+    z->bytesFree += blk->size;
+
+    blk = coalesce_forward(z, blk);
+    blk = coalesce_backward(z, blk);
+    freelist_insert(z, blk);
+}
+
+/* An object for a block of need bytes, header included, or NULL if need is
+ * not small or no slab can be had. Flags are BF_SLAB alone; the caller adds
+ * BF_PTR or BF_HANDLE. */
+static BlockHeader* slab_alloc(ZoneInfo* z, u32 need) {
+    u32 cls = 0;
+
+    if (!gSlabsEnabled || need > kSlabStrides[NUM_SLAB_CLASSES - 1]) {
+        return NULL;
+    }
+    while (kSlabStrides[cls] < need) {
+        cls++;
+    }
+
+    SlabCache* c = &z->slabs[cls];
+    Slab* s = c->partial;
+    if (!s) {
+        s = c->spare;
+        c->spare = NULL;
+        if (!s) {
+            s = slab_new(z, cls);
+            if (!s) return NULL;
+        }
+        slab_list_push(c, s);
+    }
+
+    /* nfree > 0, so some word has a clear bit */
+    u32 w = 0;
+    while (s->map[w] == 0xFFFFFFFFu) {
+        w++;
+    }
+    u32 bit = (u32)__builtin_ctz(~s->map[w]);
+    s->map[w] |= 1u << bit;
+    if (--s->nfree == 0) {
+        slab_list_unlink(c, s);
+    }
+
+    u32 off = s->first + (w * 32 + bit) * s->stride;
+    BlockHeader* b = (BlockHeader*)((u8*)slab_block(s) + off);
+    b->size = need;
+    b->flags = BF_SLAB;
+    b->lockCount = 0;
+    b->prevSize = off;
+    b->masterPtr = NULL;
+    return b;
+}
+
+/* Return an object to its slab. False if b is not a slab object, in which
+ * case the caller frees it the ordinary way. */
+static bool slab_free(BlockHeader* b) {
+    if (!(b->flags & BF_SLAB)) return false;
+
+    BlockHeader* blk = (BlockHeader*)((u8*)b - b->prevSize);
+    if (!MemoryManager_IsHeapPointer(blk)) return false;
+    Slab* s = slab_of_block(blk);
+    if (s->magic != SLAB_MAGIC) return false;
+
+    u32 off = b->prevSize;
+    u32 idx = (off - s->first) / s->stride;
+    if (off < s->first || (off - s->first) % s->stride != 0 || idx >= s->count ||
+        !(s->map[idx >> 5] & (1u << (idx & 31)))) {
+        serial_puts("[SLAB] ERROR: freeing an object that is not in use\n");
+        return true;
+    }
+
+    stats_free(s->zone, b);
+    s->map[idx >> 5] &= ~(1u << (idx & 31));
+    b->flags = BF_SLAB;
+    b->lockCount = 0;
+    b->masterPtr = NULL;
+
+    SlabCache* c = &s->zone->slabs[s->cls];
+    if (s->nfree++ == 0) {
+        slab_list_push(c, s);
+    }
+    if (s->nfree == s->count) {
+        slab_list_unlink(c, s);
+        if (!c->spare) {
+            c->spare = s;
+        } else {
+            slab_destroy(s);
+        }
+    }
+    return true;
+}
+
+/* Move an unlocked purgeable handle out of its slab into an ordinary
+ * block, so PurgeMem can reach it. The contents and master pointer follow.
+ * Left where it is if the zone has no block for it. */
+static void slab_move_out(Handle h) {
+    BlockHeader* sb = (BlockHeader*)((u8*)*h - BLKHDR_SZ);
+    if ((sb->flags & (BF_SLAB | BF_PURGEABLE | BF_LOCKED)) != (BF_SLAB | BF_PURGEABLE)) {
+        return;
+    }
+
+    Slab* s = slab_of_block((BlockHeader*)((u8*)sb - sb->prevSize));
+    if (s->magic != SLAB_MAGIC) return;
+    ZoneInfo* z = s->zone;
+
+    BlockHeader* b = find_fit(z, sb->size);
+    if (!b && z == gCurrentZone && CompactMem(sb->size) >= sb->size) {
+        b = find_fit(z, sb->size);
+    }
+    if (!b) return;
+
+    split_block(z, b, sb->size);
+    z->bytesUsed += b->size;
+    z->bytesFree -= b->size;
+    memcpy((u8*)b + BLKHDR_SZ, *h, sb->size - BLKHDR_SZ);
+    b->flags = sb->flags & ~BF_SLAB;
+    b->lockCount = 0;
+    b->masterPtr = h;
+    stats_alloc(z, b, CALLER_PC());
+
+    *h = (u8*)b + BLKHDR_SZ;
+    slab_free(sb);
+}
+
+/* Give back every spare slab, for CompactMem */
+static void slab_release_spares(ZoneInfo* z) {
+    for (u32 cls = 0; cls < NUM_SLAB_CLASSES; cls++) {
+        if (z->slabs[cls].spare) {
+            slab_destroy(z->slabs[cls].spare);
+            z->slabs[cls].spare = NULL;
+        }
+    }
+}
+
+#if MEM_DEBUG_CANARY
+/* Check the tail canary NewPtr wrote, if it wrote one */
+static void check_tail_canary(BlockHeader* b, void* p) {
+    if (b->lockCount) {
+        u32 total = b->size - BLKHDR_SZ;
+        if (b->lockCount <= total) {
+            u32 userSize = total - (u32)b->lockCount;
+            u8* user = (u8*)p;
+            bool ok = true;
+            for (u32 i = 0; i < (u32)b->lockCount; i++) {
+                if (user[userSize + i] != (u8)CANARY_BYTE) { ok = false; break; }
+            }
+            if (!ok) {
+                serial_puts("[DISPOSE] ERROR: Tail canary corrupted\n");
+            }
+        }
+    }
+}
+#endif
+
 /* ======================== Ptr Operations ======================== */
 
-void* NewPtr(u32 byteCount) {
+static void* new_ptr(u32 byteCount, void* site) {
     /* NO LOGGING AT ALL - serial_puts corrupts registers in bare-metal! */
 
     ZoneInfo* z = gCurrentZone;
@@ -856,25 +1211,35 @@ void* NewPtr(u32 byteCount) {
     if (need < MIN_BLOCK_SIZE) {
         need = MIN_BLOCK_SIZE;
     }
-    BlockHeader* b = find_fit(z, need);
-
-    if (!b) {
-        u32 compact_result = CompactMem(need);
-        if (compact_result < need) {
-            return NULL;
-        }
+    /* Small blocks from a slab; the rest, and any the slabs cannot take,
+     * from the freelists */
+    BlockHeader* b = slab_alloc(z, need);
+    if (b) {
+        b->flags |= BF_PTR;
+    } else {
         b = find_fit(z, need);
+
         if (!b) {
-            return NULL;
+            u32 compact_result = CompactMem(need);
+            if (compact_result < need) {
+                z->stats.allocFailures++;
+                return NULL;
+            }
+            b = find_fit(z, need);
+            if (!b) {
+                z->stats.allocFailures++;
+                return NULL;
+            }
         }
-    }
 
-    split_block(z, b, need);
+        split_block(z, b, need);
 
-    b->flags |= BF_PTR;
-    b->masterPtr = NULL;
-    z->bytesUsed += b->size;
-    z->bytesFree -= b->size;
+        b->flags |= BF_PTR;
+        b->masterPtr = NULL;
+        z->bytesUsed += b->size;
+        z->bytesFree -= b->size;
+    }
+    stats_alloc(z, b, site);
 
     void* result = (u8*)b + BLKHDR_SZ;
 
@@ -915,9 +1280,13 @@ void* NewPtr(u32 byteCount) {
     return result;
 }
 
+void* NewPtr(u32 byteCount) {
+    return new_ptr(byteCount, CALLER_PC());
+}
+
 void* NewPtrClear(u32 byteCount) {
     /* NewPtr already zeros memory, so no additional memset needed */
-    return NewPtr(byteCount);
+    return new_ptr(byteCount, CALLER_PC());
 }
 
 void DisposePtr(void* p) {
@@ -932,6 +1301,18 @@ void DisposePtr(void* p) {
         return;
     }
 
+    /* A slab object goes back to its slab, which knows its own zone; none
+     * of the freelist checks below concern it */
+    BlockHeader* sb = (BlockHeader*)((u8*)p - BLKHDR_SZ);
+    if (sb->flags & BF_SLAB) {
+#if MEM_DEBUG_CANARY
+        check_tail_canary(sb, p);
+#endif
+        if (slab_free(sb)) {
+            return;
+        }
+    }
+
     ZoneInfo* z = gCurrentZone;
     DISPOSE_LOG("[DISPOSE] gCurrentZone read\n");
 
@@ -990,23 +1371,11 @@ void DisposePtr(void* p) {
 
 #if MEM_DEBUG_CANARY
     /* Verify tail canary if present */
-    if (b->lockCount) {
-        u32 total = b->size - BLKHDR_SZ;
-        if (b->lockCount <= total) {
-            u32 userSize = total - (u32)b->lockCount;
-            u8* user = (u8*)p;
-            bool ok = true;
-            for (u32 i = 0; i < (u32)b->lockCount; i++) {
-                if (user[userSize + i] != (u8)CANARY_BYTE) { ok = false; break; }
-            }
-            if (!ok) {
-                serial_puts("[DISPOSE] ERROR: Tail canary corrupted\n");
-            }
-        }
-    }
+    check_tail_canary(b, p);
 #endif
 
     b->flags &= ~(BF_PTR);
+    stats_free(z, b);
     z->bytesUsed -= b->size;
     z->bytesFree += b->size;
 
@@ -1092,12 +1461,15 @@ static void MP_Free(ZoneInfo* z, void** mp) {
     }
 }
 
-Handle NewHandle(u32 byteCount) {
+static Handle new_handle(u32 byteCount, void* site) {
     ZoneInfo* z = gCurrentZone;
     if (!z) return NULL;
 
     void** mp = MP_Alloc(z);
-    if (!mp) return NULL;
+    if (!mp) {
+        z->stats.allocFailures++;
+        return NULL;
+    }
 
     u32 need = align_up(byteCount + BLKHDR_SZ);
 
@@ -1105,27 +1477,33 @@ Handle NewHandle(u32 byteCount) {
     if (need < MIN_BLOCK_SIZE) {
         need = MIN_BLOCK_SIZE;
     }
-    BlockHeader* b = find_fit(z, need);
-
+    BlockHeader* b = slab_alloc(z, need);
     if (!b) {
-        /* Try compaction */
-        if (CompactMem(need) < need) {
-            MP_Free(z, mp);
-            return NULL;
-        }
         b = find_fit(z, need);
+
         if (!b) {
-            MP_Free(z, mp);
-            return NULL;
+            /* Try compaction */
+            if (CompactMem(need) < need) {
+                MP_Free(z, mp);
+                z->stats.allocFailures++;
+                return NULL;
+            }
+            b = find_fit(z, need);
+            if (!b) {
+                MP_Free(z, mp);
+                z->stats.allocFailures++;
+                return NULL;
+            }
         }
-    }
 
-    split_block(z, b, need);
+        split_block(z, b, need);
+        z->bytesUsed += b->size;
+        z->bytesFree -= b->size;
+    }
     b->flags |= BF_HANDLE;
     b->masterPtr = (Handle)mp;  /* Store backpointer */
     *mp = (u8*)b + BLKHDR_SZ;    /* Master pointer points to data */
-    z->bytesUsed += b->size;
-    z->bytesFree -= b->size;
+    stats_alloc(z, b, site);
 
     /* CRITICAL FIX: Zero allocated memory to prevent garbage data corruption
      * Without this, old data (like format strings) appears in window titles and corrupts desktop icons */
@@ -1134,8 +1512,12 @@ Handle NewHandle(u32 byteCount) {
     return (Handle)mp;
 }
 
+Handle NewHandle(u32 byteCount) {
+    return new_handle(byteCount, CALLER_PC());
+}
+
 Handle NewHandleClear(u32 byteCount) {
-    Handle h = NewHandle(byteCount);
+    Handle h = new_handle(byteCount, CALLER_PC());
     if (h && *h) memset(*h, 0, byteCount);
     return h;
 }
@@ -1146,6 +1528,13 @@ void DisposeHandle(Handle h) {
         return;
     }
 
+    /* Slab object: straight back to its slab */
+    BlockHeader* sb = (BlockHeader*)((u8*)*h - BLKHDR_SZ);
+    if ((sb->flags & BF_SLAB) && slab_free(sb)) {
+        *h = NULL;
+        return;
+    }
+
     ZoneInfo* z = gCurrentZone;
     if (!z) return;
 
@@ -1171,6 +1560,7 @@ void DisposeHandle(Handle h) {
     b->flags &= ~(BF_HANDLE | BF_LOCKED | BF_PURGEABLE);
     b->lockCount = 0;
     b->masterPtr = NULL;
+    stats_free(z, b);
     z->bytesUsed -= b->size;
     z->bytesFree += b->size;
 
@@ -1210,6 +1600,7 @@ void HUnlock(Handle h) {
         }
         if (b->lockCount == 0) {
             b->flags &= ~BF_LOCKED;
+            slab_move_out(h);
         }
     }
 }
@@ -1218,6 +1609,7 @@ void HPurge(Handle h) {
     if (!h || !*h) return;
     BlockHeader* b = (BlockHeader*)((u8*)*h - BLKHDR_SZ);
     b->flags |= BF_PURGEABLE;
+    slab_move_out(h);
 }
 
 void HNoPurge(Handle h) {
@@ -1253,9 +1645,14 @@ void EmptyHandle(Handle h) {
     if (!z) return;
 
     BlockHeader* b = (BlockHeader*)((u8*)*h - BLKHDR_SZ);
+    if ((b->flags & BF_SLAB) && slab_free(b)) {
+        *h = NULL;
+        return;
+    }
     b->flags &= ~(BF_HANDLE | BF_LOCKED | BF_PURGEABLE);
     b->lockCount = 0;
     b->masterPtr = NULL;
+    stats_free(z, b);
     z->bytesUsed -= b->size;
     freelist_insert(z, b);
     *h = NULL;
@@ -1354,20 +1751,23 @@ bool SetHandleSize_MemMgr(Handle h, u32 newSize) {
     Handle masterPtr = b->masterPtr;
     *masterPtr = *newHandle;
 
-    /* Copy flags from old block to new block */
-    newBlock->flags = b->flags;
+    /* Copy flags from old block to new block - all but where each lives */
+    newBlock->flags = (b->flags & ~BF_SLAB) | (newBlock->flags & BF_SLAB);
     newBlock->masterPtr = masterPtr;
 
     /* Free old block (but don't touch master pointer) */
-    b->flags &= ~(BF_HANDLE | BF_LOCKED | BF_PURGEABLE);
-    b->lockCount = 0;
-    b->masterPtr = NULL;
-    z->bytesUsed -= b->size;
-    z->bytesFree += b->size;
+    if (!((b->flags & BF_SLAB) && slab_free(b))) {
+        b->flags &= ~(BF_HANDLE | BF_LOCKED | BF_PURGEABLE);
+        b->lockCount = 0;
+        b->masterPtr = NULL;
+        stats_free(z, b);
+        z->bytesUsed -= b->size;
+        z->bytesFree += b->size;
 
-    b = coalesce_forward(z, b);
-    b = coalesce_backward(z, b);
-    freelist_insert(z, b);
+        b = coalesce_forward(z, b);
+        b = coalesce_backward(z, b);
+        freelist_insert(z, b);
+    }
 
     /* Free the temporary master pointer from NewHandle */
     MP_Free(z, (void**)newHandle);
@@ -1377,149 +1777,310 @@ bool SetHandleSize_MemMgr(Handle h, u32 newSize) {
 
 /* ======================== Compaction ======================== */
 
-u32 CompactMem(u32 cbNeeded) {
-    /* LOGGING DISABLED - CAUSES FREEZE */
-    // MEMORY_LOG_DEBUG("[CompactMem] ENTER: cbNeeded=%u\n", cbNeeded);
+/*
+ * CompactMem used to slide every unlocked handle in the zone to the bottom
+ * in one pass, whatever it had been asked for - so a NewHandle a few hundred
+ * bytes short moved megabytes, and the UI stood still while it did. Now it
+ * looks for the cheapest window that would do: a run of free and movable
+ * blocks whose free space, once the handles in it are slid together, comes
+ * to cbNeeded, cost being the bytes that would move. Only that run is slid.
+ * The whole-zone pass is left for when no window is big enough - which is
+ * also what CompactMem(maxSize) asks for.
+ *
+ * A zone that has needed compacting is then tidied at idle time:
+ * MemoryManager_IdleCompact, called from the event loop when there is no
+ * event, moves handles down a bounded number of bytes a call so the next
+ * large request finds the space already there. Zones that have never run
+ * short are left alone, so handles nobody needs moved stay put under code
+ * that has dereferenced them.
+ */
 
-    ZoneInfo* z = gCurrentZone;
-    if (!z) {
-        // MEMORY_LOG_DEBUG("[CompactMem] FAIL: no current zone\n");
-        return 0;
-    }
+/* The most blocks one idle slice looks at, moves or not */
+#define IDLE_COMPACT_VISITS 256u
 
-    // MEMORY_LOG_DEBUG("[CompactMem] Zone state before: bytesUsed=%u bytesFree=%u\n", z->bytesUsed, z->bytesFree);
+/* An unlocked handle block - the only kind compaction moves. Slab objects
+ * sit inside a slab, which is a Ptr, so heap walks never meet them. */
+static inline bool block_movable(const BlockHeader* b) {
+    return (b->flags & (BF_FREE | BF_HANDLE | BF_LOCKED)) == BF_HANDLE;
+}
 
-    /* First, try purging */
-    // MEMORY_LOG_DEBUG("[CompactMem] Calling PurgeMem...\n");
-    PurgeMem(cbNeeded);
-    // MEMORY_LOG_DEBUG("[CompactMem] PurgeMem complete\n");
+/* A size a heap walk can step by. The walks stop at anything else, as the
+ * old CompactMem and PurgeMem always have; past it the heap is of unknown
+ * shape and none of it may be claimed as free. */
+static inline bool block_size_sane(ZoneInfo* z, const u8* scan, const BlockHeader* b) {
+    return b->size != 0 && b->size <= (u32)(z->limit - scan);
+}
 
-    /* Then compact: move unlocked handles together */
-    u8* scan = z->base;
-    u8* dest = z->base;
-    /* Track size of the last block that ends at 'dest' to maintain prevSize */
-    u32 last_block_size = 0;
+/* Move a handle block down to dst (the two may overlap) and point its
+ * master pointer at the new copy. The caller sets prevSize. */
+static void move_handle_block(u8* dst, u8* src, u32 size) {
+    memmove(dst, src, size);
+    BlockHeader* d = (BlockHeader*)dst;
+    if (d->masterPtr && *(d->masterPtr)) {
+        *(d->masterPtr) = dst + BLKHDR_SZ;
+    }
+}
 
-    // MEMORY_LOG_DEBUG("[CompactMem] Starting heap walk from %p to %p\n", scan, z->limit);
-    int block_count = 0;
+/*
+ * Slide the handles in [from, to) down to from and make the space left at
+ * the top one free block. Everything in the range must be free or movable.
+ */
+static void slide_range(ZoneInfo* z, u8* from, u8* to) {
+    u8* scan = from;
+    u8* dest = from;
+    u32 prevSize = ((BlockHeader*)from)->prevSize;
 
-    /* Set when the walk gives up partway. Everything from that point to the
-     * zone limit is then of unknown shape, and in particular is not known to
-     * be free - see the trailing block below. */
-    bool walk_aborted = false;
+    /* Boundaries inside the range are about to move */
+    u8* cursor = z->base + z->compactCursor;
+    if (cursor > from && cursor < to) {
+        z->compactCursor = (u32)(from - z->base);
+    }
 
-    while (scan < z->limit) {
+    while (scan < to) {
         BlockHeader* b = (BlockHeader*)scan;
-        block_count++;
+        u32 size = b->size;
 
-        if (block_count % 100 == 0) {
-            // MEMORY_LOG_DEBUG("[CompactMem] Processed %d blocks, scan=%p\n", block_count, scan);
+        if (b->flags & BF_FREE) {
+            freelist_remove(z, b);
+        } else {
+            if (scan != dest) {
+                move_handle_block(dest, scan, size);
+                z->stats.compactBytesMoved += size;
+            }
+            ((BlockHeader*)dest)->prevSize = prevSize;
+            prevSize = size;
+            dest += size;
         }
+        scan += size;
+    }
 
-        /* Safety check: detect corrupted block size */
-        if (b->size == 0 || b->size > (u32)(z->limit - scan)) {
-            // MEMORY_LOG_DEBUG("[CompactMem] ERROR: corrupted block at %p: size=%u (remaining=%u)\n",
-            //              b, b->size, (u32)(z->limit - scan));
-            walk_aborted = true;
+    if (dest == to) {
+        return;
+    }
+
+    BlockHeader* fb = (BlockHeader*)dest;
+    fb->size = (u32)(to - dest);
+    fb->flags = BF_FREE;
+    fb->lockCount = 0;
+    fb->prevSize = prevSize;
+    fb->masterPtr = NULL;
+    if (to < z->limit) {
+        ((BlockHeader*)to)->prevSize = fb->size;
+    }
+    fb = coalesce_forward(z, fb);
+    fb = coalesce_backward(z, fb);
+    freelist_insert(z, fb);
+}
+
+/*
+ * The cheapest window holding need bytes of free space. Two pointers over
+ * the zone in one walk: the right edge takes in blocks, the left gives them
+ * up for as long as what is left still holds need, and a pinned block
+ * starts the window over beyond it. False if no run between pinned blocks
+ * has that much free space.
+ */
+static bool find_compact_window(ZoneInfo* z, u32 need, u8** outFrom, u8** outTo) {
+    u8* left = z->base;
+    u8* right = z->base;
+    u32 freeBytes = 0;
+    u32 moveBytes = 0;
+    u32 bestCost = UINT32_MAX;
+
+    while (right < z->limit) {
+        BlockHeader* b = (BlockHeader*)right;
+        if (!block_size_sane(z, right, b)) {
             break;
         }
 
+        right += b->size;
         if (b->flags & BF_FREE) {
-            scan += b->size;
+            freeBytes += b->size;
+        } else if (block_movable(b)) {
+            moveBytes += b->size;
+        } else {
+            left = right;
+            freeBytes = moveBytes = 0;
             continue;
         }
 
-        /* Can we move this block? */
-        if ((b->flags & BF_HANDLE) && !(b->flags & BF_LOCKED)) {
-            if (scan != dest) {
-                /* Move the block */
-                BlockHeader* d = (BlockHeader*)dest;
-                /* dataSize not needed; full header+data copied above */
+        while (freeBytes >= need) {
+            if (moveBytes < bestCost) {
+                bestCost = moveBytes;
+                *outFrom = left;
+                *outTo = right;
+            }
+            BlockHeader* l = (BlockHeader*)left;
+            if (l->flags & BF_FREE) {
+                freeBytes -= l->size;
+            } else {
+                moveBytes -= l->size;
+            }
+            left += l->size;
+        }
+    }
 
-                /* Copy block header and data */
-                memcpy(d, b, b->size);
+    return bestCost != UINT32_MAX;
+}
 
-                /* Update master pointer */
-                if (d->masterPtr && *(d->masterPtr)) {
-                    *(d->masterPtr) = (u8*)d + BLKHDR_SZ;
-                }
+/* Slide every run between pinned blocks down: the old CompactMem */
+static void compact_zone(ZoneInfo* z) {
+    u8* scan = z->base;
+    u8* runStart = NULL;
 
-                /* Update prevSize of following block */
-                u8* after = dest + d->size;
-                if (after < z->limit) {
-                    BlockHeader* nxt = (BlockHeader*)after;
-                    nxt->prevSize = d->size;
-                }
+    while (scan < z->limit) {
+        BlockHeader* b = (BlockHeader*)scan;
+        if (!block_size_sane(z, scan, b)) {
+            break;
+        }
 
-                dest += d->size;
-                last_block_size = d->size;
-                scan += b->size;
-                continue;
-            }
+        bool mobile = (b->flags & BF_FREE) || block_movable(b);
+        if (mobile && !runStart) {
+            runStart = scan;
+        } else if (!mobile && runStart) {
+            slide_range(z, runStart, scan);
+            runStart = NULL;
         }
+        scan += b->size;
+    }
+
+    if (runStart) {
+        slide_range(z, runStart, scan);
+    }
+}
+
+u32 CompactMem(u32 cbNeeded) {
+    ZoneInfo* z = gCurrentZone;
+    if (!z) {
+        return 0;
+    }
+
+    /* Spare slabs are free memory in all but name */
+    slab_release_spares(z);
+
+    u32 maxFree = MaxMem();
+    if (maxFree >= cbNeeded) {
+        return maxFree;
+    }
+    z->compactPending = true;
+    z->stats.compactions++;
+
+    /* A free block of need bytes holds cbNeeded of data. Asking for more
+     * than the zone holds means compact all of it. */
+    u32 need = 0;
+    if (cbNeeded < (u32)(z->limit - z->base)) {
+        need = align_up(cbNeeded + BLKHDR_SZ);
+    }
+
+    u8* from = NULL;
+    u8* to = NULL;
+    if (need && find_compact_window(z, need, &from, &to)) {
+        slide_range(z, from, to);
+        return MaxMem();
+    }
 
-        /* Non-movable or locked - skip any gap and continue */
-        /* CRITICAL FIX: Use MIN_BLOCK_SIZE instead of BLKHDR_SZ + ALIGN */
-        u32 gap = scan - dest;
-        if (scan != dest && gap >= MIN_BLOCK_SIZE) {
-            /* CRITICAL: Align gap DOWN to avoid overflow! */
-            u32 aligned_gap = gap & ~(ALIGN - 1);
-            if (aligned_gap >= MIN_BLOCK_SIZE) {
-                /* Create free block in the gap */
-                BlockHeader* fb = (BlockHeader*)dest;
-                fb->size = aligned_gap;
-                fb->flags = BF_FREE;
-                /* Set prevSize to size of block that ends at 'dest' */
-                fb->prevSize = (dest > z->base) ? last_block_size : 0;
-                fb->masterPtr = NULL;
-                freelist_insert(z, fb);
-
-                /* The next block at 'scan' now follows 'fb'; fix its prevSize */
-                BlockHeader* next_block = (BlockHeader*)scan;
-                next_block->prevSize = fb->size;
-
-                /* Note: do not advance 'dest' here; we leave a gap and keep 'scan' at b */
+    /* Not by moving alone: purge, and look again */
+    PurgeMem(cbNeeded);
+    maxFree = MaxMem();
+    if (maxFree >= cbNeeded) {
+        return maxFree;
+    }
+    if (need && find_compact_window(z, need, &from, &to)) {
+        slide_range(z, from, to);
+        return MaxMem();
+    }
+
+    compact_zone(z);
+    return MaxMem();
+}
+
+/*
+ * One slice of idle compaction: from where the last slice stopped, each
+ * handle sitting just above a free block moves down into it, and the free
+ * space - now above the handle - merges with whatever is free beyond. It
+ * stops when the next move would take it past maxBytes or after
+ * IDLE_COMPACT_VISITS blocks. A pass over the whole zone that moves nothing
+ * means the zone is as compact as it can get, and clears compactPending.
+ */
+static u32 compact_slice(ZoneInfo* z, u32 maxBytes) {
+    u8* scan = z->base + z->compactCursor;
+    u32 moved = 0;
+
+    for (u32 visits = 0; visits < IDLE_COMPACT_VISITS; visits++) {
+        if (scan >= z->limit) {
+            scan = z->base;
+            if (!z->compactMovedThisPass) {
+                z->compactPending = false;
+                break;
             }
+            z->compactMovedThisPass = false;
+            continue;
+        }
+
+        BlockHeader* b = (BlockHeader*)scan;
+        if (!block_size_sane(z, scan, b)) {
+            /* Nothing past here can be trusted; leave it to CompactMem */
+            scan = z->base;
+            z->compactPending = false;
+            break;
+        }
+
+        u8* next = scan + b->size;
+        if (!(b->flags & BF_FREE) || next >= z->limit) {
+            scan = next;
+            continue;
+        }
+
+        /* A hole. Is there a handle just above it that fits this slice? */
+        BlockHeader* m = (BlockHeader*)next;
+        if (!block_size_sane(z, next, m) || !block_movable(m) || m->size > maxBytes) {
+            scan = next;
+            continue;
+        }
+        if (moved + m->size > maxBytes) {
+            break;
+        }
+
+        u32 holeSize = b->size;
+        u32 handleSize = m->size;
+        u32 prevSize = b->prevSize;
+
+        freelist_remove(z, b);
+        move_handle_block(scan, next, handleSize);
+        ((BlockHeader*)scan)->prevSize = prevSize;
+
+        BlockHeader* fb = (BlockHeader*)(scan + handleSize);
+        fb->size = holeSize;
+        fb->flags = BF_FREE;
+        fb->lockCount = 0;
+        fb->prevSize = handleSize;
+        fb->masterPtr = NULL;
+        u8* after = (u8*)fb + holeSize;
+        if (after < z->limit) {
+            ((BlockHeader*)after)->prevSize = holeSize;
         }
+        fb = coalesce_forward(z, fb);
+        freelist_insert(z, fb);
 
-        dest = scan + b->size;
-        last_block_size = b->size;
-        scan = dest;
-    }
-
-    /*
-     * Create trailing free block if needed.
-     *
-     * Only as far as the walk actually got. When the walk aborts on a
-     * corrupted header, everything from that point up is unexamined - and it
-     * is mostly live. Claiming it to z->limit anyway declared whole megabytes
-     * free with allocations sitting inside them: one boot freed
-     * [0x8413D8,0x964D00) as a single 1.19MB block, a later request was
-     * carved out of it, and the caller was handed memory another live object
-     * was already using. That is the "allocator hands out memory that is
-     * already in use" fault, and this is where it came from. Between dest and
-     * scan is genuine compaction slack and is still safe to reclaim.
-     */
-    u8* tail_limit = walk_aborted ? scan : z->limit;
-    if (dest < tail_limit) {
-        u32 remaining = tail_limit - dest;
-        /* CRITICAL: Align remaining DOWN to avoid exceeding zone limit! */
-        u32 aligned_remaining = remaining & ~(ALIGN - 1);
-        if (aligned_remaining >= MIN_BLOCK_SIZE) {
-            BlockHeader* tail = (BlockHeader*)dest;
-            tail->flags = BF_FREE;
-            tail->size = aligned_remaining;
-            /* Set prevSize based on the last committed block size */
-            tail->prevSize = (dest > z->base) ? last_block_size : 0;
-            tail->masterPtr = NULL;
-            freelist_insert(z, tail);
-        }
-    }
-
-    // MEMORY_LOG_DEBUG("[CompactMem] Heap walk complete: processed %d blocks\n", block_count);
-    u32 max_free = MaxMem();
-    // MEMORY_LOG_DEBUG("[CompactMem] SUCCESS: MaxMem=%u\n", max_free);
-    return max_free;
+        moved += handleSize;
+        z->stats.idleBytesMoved += handleSize;
+        z->compactMovedThisPass = true;
+        scan = (u8*)fb;
+    }
+
+    z->compactCursor = (u32)(scan - z->base);
+    return moved;
+}
+
+u32 MemoryManager_IdleCompact(u32 maxBytes) {
+    u32 moved = 0;
+
+    if (gAppZone.compactPending) {
+        moved += compact_slice(&gAppZone, maxBytes);
+    }
+    if (gSystemZone.compactPending && moved < maxBytes) {
+        moved += compact_slice(&gSystemZone, maxBytes - moved);
+    }
+    return moved;
 }
 
 void PurgeMem(u32 cbNeeded) {
@@ -1554,6 +2115,8 @@ void PurgeMem(u32 cbNeeded) {
 
             /* Free the block */
             b->flags = BF_FREE;
+            z->stats.purges++;
+            z->stats.purgedBytes += b->size;
             z->bytesUsed -= b->size;
             z->bytesFree += b->size;
 
@@ -1582,7 +2145,7 @@ void PurgeMem(u32 cbNeeded) {
 
 void* malloc(size_t size) {
     /* NO LOGGING - serial_puts corrupts registers! */
-    return NewPtr((u32)size);
+    return new_ptr((u32)size, CALLER_PC());
 }
 
 void free(void* ptr) {
@@ -1607,7 +2170,7 @@ void* calloc(size_t nmemb, size_t size) {
     }
 
     size_t total = nmemb * size;
-    void* p = malloc(total);
+    void* p = new_ptr((u32)total, CALLER_PC());
     if (p) {
         memset(p, 0, total);
     }
@@ -1615,7 +2178,7 @@ void* calloc(size_t nmemb, size_t size) {
 }
 
 void* realloc(void* ptr, size_t size) {
-    if (!ptr) return malloc(size);
+    if (!ptr) return new_ptr((u32)size, CALLER_PC());
     if (size == 0) {
         free(ptr);
         return NULL;
@@ -1625,7 +2188,7 @@ void* realloc(void* ptr, size_t size) {
     u32 oldSize = GetPtrSize(ptr);
 
     /* Allocate new block */
-    void* newPtr = malloc(size);
+    void* newPtr = new_ptr((u32)size, CALLER_PC());
     if (!newPtr) return NULL;
 
     /* Copy data */
@@ -1663,6 +2226,9 @@ void InitMemoryManager(void) {
 
     serial_puts("MM: Current zone set to App Zone\n");
 
+    /* Before anything else uses the zone, so it can check it gets it all back */
+    MemoryManager_SelfTest();
+
     /* Report detected memory (comes from multiboot2) */
     extern uint32_t g_total_memory_kb;
     MEMORY_LOG_DEBUG("MM: Total memory: %u KB (%u MB)\n",
@@ -1708,6 +2274,11 @@ OSErr MemoryManager_MapToM68K(struct M68KAddressSpace* as)
         as->pageTable[page] = gAppZone.base + offset;
     }
 
+    /* Whatever was decoded from, or translated to, the pages just replaced is
+     * gone. */
+    M68K_InvalidateCode(as, 0, M68K_MAX_ADDR);
+    M68K_FlushTLB(as);
+
     gSystemZone.m68kBase = kSysBase;
     gSystemZone.m68kLimit = kSysBase + (UInt32)sysSize;
     gAppZone.m68kBase = kAppBase;
@@ -1802,6 +2373,7 @@ void DumpHeap(ZoneInfo* zone) {
 
         char* type = "????";
         if (b->flags & BF_FREE) type = "FREE";
+        else if (b->flags & BF_SLAB) type = "SLAB";
         else if (b->flags & BF_PTR) type = "PTR ";
         else if (b->flags & BF_HANDLE) {
             if (b->flags & BF_LOCKED) {
@@ -1831,3 +2403,455 @@ void DumpHeap(ZoneInfo* zone) {
 
     MEMORY_LOG_DEBUG("=== End Heap Dump ===\n");
 }
+
+/* ======================== Heap Snapshot ======================== */
+
+/*
+ * The snapshot, all fields little-endian:
+ *
+ *   header   'HPRF', u16 version, u8 zones, u8 size classes, u16 sites,
+ *            u16 reserved, u32 total length                      (16 bytes)
+ *   zone     char name[4], u32 zone size, bytes used, bytes free, largest
+ *            free block, fragmentation (per mille: how much of the free
+ *            space is not in the largest block), slabs; u32 allocs[classes],
+ *            frees[classes]; u32 alloc failures, compactions, compaction
+ *            bytes moved, idle bytes moved, purges, purged bytes
+ *   site     u64 return address (0: sites the table had no room for),
+ *            u32 allocations, u32 bytes
+ *
+ * System zone first, then application. Version 1.
+ */
+#define SNAPSHOT_VERSION 1
+
+static u8* put_u16(u8* p, u32 v) {
+    p[0] = (u8)v;
+    p[1] = (u8)(v >> 8);
+    return p + 2;
+}
+
+static u8* put_u32(u8* p, u32 v) {
+    p = put_u16(p, v & 0xFFFF);
+    return put_u16(p, v >> 16);
+}
+
+static u8* put_u64(u8* p, uint64_t v) {
+    p = put_u32(p, (u32)v);
+    return put_u32(p, (u32)(v >> 32));
+}
+
+static u8* put_zone(u8* p, ZoneInfo* z) {
+    u32 largest = largest_free_block(z);
+    u32 frag = 0;
+    if (z->bytesFree) {
+        frag = 1000 - (u32)((uint64_t)largest * 1000 / z->bytesFree);
+    }
+
+    u32 slabs = 0;
+    for (u32 cls = 0; cls < NUM_SLAB_CLASSES; cls++) {
+        slabs += z->slabs[cls].slabs;
+    }
+
+    for (u32 i = 0; i < 4; i++) {
+        *p++ = (u8)z->name[i];
+    }
+    p = put_u32(p, (u32)(z->limit - z->base));
+    p = put_u32(p, z->bytesUsed);
+    p = put_u32(p, z->bytesFree);
+    p = put_u32(p, largest);
+    p = put_u32(p, frag);
+    p = put_u32(p, slabs);
+    for (u32 sc = 0; sc < NUM_SIZE_CLASSES; sc++) {
+        p = put_u32(p, z->stats.allocs[sc]);
+    }
+    for (u32 sc = 0; sc < NUM_SIZE_CLASSES; sc++) {
+        p = put_u32(p, z->stats.frees[sc]);
+    }
+    p = put_u32(p, z->stats.allocFailures);
+    p = put_u32(p, z->stats.compactions);
+    p = put_u32(p, z->stats.compactBytesMoved);
+    p = put_u32(p, z->stats.idleBytesMoved);
+    p = put_u32(p, z->stats.purges);
+    p = put_u32(p, z->stats.purgedBytes);
+    return p;
+}
+
+u32 MemoryManager_Snapshot(u8* buf, u32 cap) {
+    u32 sites = 0;
+#if MEMORY_PROFILE
+    for (u32 i = 0; i < MM_PROFILE_SITES; i++) {
+        if (gAllocSites[i].pc) sites++;
+    }
+    if (gAllocSiteOverflow.allocs) sites++;
+#endif
+
+    u32 len = MM_SNAPSHOT_HEADER + 2 * MM_SNAPSHOT_ZONE + sites * MM_SNAPSHOT_SITE;
+    if (!buf || cap < len) {
+        return len;
+    }
+
+    u8* p = buf;
+    *p++ = 'H'; *p++ = 'P'; *p++ = 'R'; *p++ = 'F';
+    p = put_u16(p, SNAPSHOT_VERSION);
+    *p++ = 2;
+    *p++ = NUM_SIZE_CLASSES;
+    p = put_u16(p, sites);
+    p = put_u16(p, 0);
+    p = put_u32(p, len);
+
+    p = put_zone(p, &gSystemZone);
+    p = put_zone(p, &gAppZone);
+
+#if MEMORY_PROFILE
+    for (u32 i = 0; i < MM_PROFILE_SITES; i++) {
+        if (!gAllocSites[i].pc) continue;
+        p = put_u64(p, (uint64_t)gAllocSites[i].pc);
+        p = put_u32(p, gAllocSites[i].allocs);
+        p = put_u32(p, gAllocSites[i].bytes);
+    }
+    if (gAllocSiteOverflow.allocs) {
+        p = put_u64(p, 0);
+        p = put_u32(p, gAllocSiteOverflow.allocs);
+        p = put_u32(p, gAllocSiteOverflow.bytes);
+    }
+#else
+    (void)put_u64;
+#endif
+
+    return len;
+}
+
+/* Between "[HEAPSNAP] begin" and "[HEAPSNAP] end" lines, 32 bytes a line,
+ * for scripts/heapsnap.py to pick out of a serial log */
+void MemoryManager_DumpSnapshot(void) {
+    static u8 snap[MM_SNAPSHOT_MAX];
+    static const char hex[] = "0123456789abcdef";
+    char line[12 + 64 + 2];
+
+    u32 len = MemoryManager_Snapshot(snap, sizeof(snap));
+    if (len > sizeof(snap)) {
+        return;
+    }
+
+    serial_puts("[HEAPSNAP] begin\n");
+    for (u32 off = 0; off < len; off += 32) {
+        u32 n = 0;
+        const char* tag = "[HEAPSNAP] ";
+        while (*tag) line[n++] = *tag++;
+        for (u32 i = off; i < len && i < off + 32; i++) {
+            line[n++] = hex[snap[i] >> 4];
+            line[n++] = hex[snap[i] & 15];
+        }
+        line[n++] = '\n';
+        line[n] = 0;
+        serial_puts(line);
+    }
+    serial_puts("[HEAPSNAP] end\n");
+}
+
+/* ======================== Self-Test ======================== */
+
+static bool gMemTestFailed;
+
+static void mm_test_check(bool ok, const char* what) {
+    if (!ok) {
+        serial_puts("[MM] SELFTEST FAILED: ");
+        serial_puts(what);
+        serial_puts("\n");
+        gMemTestFailed = true;
+    }
+}
+
+static u32 slab_count(ZoneInfo* z) {
+    u32 n = 0;
+    for (u32 cls = 0; cls < NUM_SLAB_CLASSES; cls++) {
+        n += z->slabs[cls].slabs;
+    }
+    return n;
+}
+
+/*
+ * Compaction, in a small zone of its own so every block's place is known:
+ * a row of handles with every other one disposed, one of them locked, and a
+ * Ptr taking what is left above them.
+ */
+static u8 gTestHeap[32 * 1024] __attribute__((aligned(8)));
+static void* gTestMasters[64];
+
+static bool test_handle_intact(Handle h, u8 fill, u32 size) {
+    if (!h || !*h) return false;
+    for (u32 i = 0; i < size; i++) {
+        if (((u8*)*h)[i] != fill) return false;
+    }
+    Handle back = NULL;
+    return RecoverHandle(*h, &back) && back == h;
+}
+
+static void selftest_compaction(void) {
+    enum { kHandles = 24, kSize = 1000, kLocked = 12, kSlice = 2048 };
+    static ZoneInfo tz;
+    Handle h[kHandles];
+    ZoneInfo* saved = gCurrentZone;
+
+    InitZone(&tz, gTestHeap, sizeof(gTestHeap), gTestMasters, 64);
+    SetZone(&tz);
+
+    for (u32 i = 0; i < kHandles; i++) {
+        h[i] = NewHandle(kSize);
+        mm_test_check(h[i] != NULL, "NewHandle in the test zone");
+        if (!h[i]) {
+            SetZone(saved);
+            return;
+        }
+        memset(*h[i], (int)(i * 7 + 1), kSize);
+    }
+    void* top = NewPtr(MaxMem() - 64);
+    mm_test_check(top != NULL, "NewPtr for the rest of the test zone");
+    u32 blockSize = ((BlockHeader*)((u8*)*h[0] - BLKHDR_SZ))->size;
+
+    HLock(h[kLocked]);
+    void* lockedData = *h[kLocked];
+    for (u32 i = 1; i < kHandles; i += 2) {
+        DisposeHandle(h[i]);
+        h[i] = NULL;
+    }
+    mm_test_check(MaxMem() < 2 * kSize, "test zone not fragmented");
+
+    /* Three holes with two handles between them will do; nothing else moves */
+    mm_test_check(CompactMem(2 * kSize + kSize / 2) >= 2 * kSize + kSize / 2,
+                  "CompactMem did not make the space");
+    mm_test_check(tz.stats.compactions == 1, "compaction not counted");
+    mm_test_check(tz.stats.compactBytesMoved <= 2 * blockSize, "CompactMem moved more than its window");
+    mm_test_check(tz.compactPending, "CompactMem did not ask for idle compaction");
+
+    /* Idle slices: each within its budget, until nothing is left to move */
+    u32 slices = 0;
+    while (tz.compactPending && slices < 100) {
+        u32 before = tz.stats.idleBytesMoved;
+        u32 moved = compact_slice(&tz, kSlice);
+        mm_test_check(moved <= kSlice && tz.stats.idleBytesMoved - before == moved,
+                      "idle slice over its budget");
+        slices++;
+    }
+    mm_test_check(!tz.compactPending, "idle compaction never finished");
+
+    /* Free space is now above every handle that could move */
+    for (u8* scan = tz.base; scan < tz.limit; ) {
+        BlockHeader* b = (BlockHeader*)scan;
+        if (!block_size_sane(&tz, scan, b)) {
+            mm_test_check(false, "test zone walk");
+            break;
+        }
+        u8* next = scan + b->size;
+        if ((b->flags & BF_FREE) && next < tz.limit) {
+            mm_test_check(!block_movable((BlockHeader*)next), "hole left below a handle");
+        }
+        scan = next;
+    }
+
+    mm_test_check(*h[kLocked] == lockedData, "locked handle moved");
+    for (u32 i = 0; i < kHandles; i += 2) {
+        mm_test_check(test_handle_intact(h[i], (u8)(i * 7 + 1), kSize), "handle damaged by compaction");
+    }
+
+    HUnlock(h[kLocked]);
+    for (u32 i = 0; i < kHandles; i += 2) {
+        DisposeHandle(h[i]);
+    }
+    DisposePtr(top);
+    mm_test_check(MaxMem() + BLKHDR_SZ == (u32)sizeof(gTestHeap), "test zone not whole again");
+
+    u32 allocs = 0, frees = 0;
+    for (u32 sc = 0; sc < NUM_SIZE_CLASSES; sc++) {
+        allocs += tz.stats.allocs[sc];
+        frees += tz.stats.frees[sc];
+    }
+    mm_test_check(allocs == kHandles + 1 && frees == kHandles + 1, "allocs and frees miscounted");
+    SetZone(saved);
+}
+
+/*
+ * Run against the current zone while it is still empty, so it can check
+ * that everything it took was given back. Reports only a failure.
+ */
+void MemoryManager_SelfTest(void) {
+    enum { kObjs = 600 };
+    static void* objs[kObjs];
+    ZoneInfo* z = gCurrentZone;
+    if (!z) return;
+
+    u32 usedBefore = z->bytesUsed;
+    u32 slabsBefore = slab_count(z);
+    gMemTestFailed = false;
+
+    /* A small Ptr comes from a slab and reads back its own size */
+    u8* p = (u8*)NewPtr(20);
+    mm_test_check(p != NULL, "NewPtr(20)");
+    if (!p) return;
+    BlockHeader* b = (BlockHeader*)(p - BLKHDR_SZ);
+    mm_test_check((b->flags & (BF_SLAB | BF_PTR)) == (BF_SLAB | BF_PTR), "small Ptr not in a slab");
+    mm_test_check(GetPtrSize(p) >= 20 && GetPtrSize(p) < 20 + ALIGN, "GetPtrSize of a slab Ptr");
+    for (u32 i = 0; i < 20; i++) {
+        mm_test_check(p[i] == 0, "slab Ptr not cleared");
+        p[i] = (u8)i;
+    }
+
+    /* A small Handle likewise, and RecoverHandle finds it */
+    Handle h = NewHandle(40);
+    mm_test_check(h != NULL && *h != NULL, "NewHandle(40)");
+    if (!h || !*h) return;
+    Handle back = NULL;
+    mm_test_check(RecoverHandle(*h, &back) && back == h, "RecoverHandle of a slab Handle");
+    mm_test_check(GetHandleSize(h) >= 40, "GetHandleSize of a slab Handle");
+    for (u32 i = 0; i < 40; i++) {
+        ((u8*)*h)[i] = (u8)(0x40 + i);
+    }
+
+    /* Growing it moves it out to the freelists, contents and all */
+    mm_test_check(SetHandleSize_MemMgr(h, 1000), "SetHandleSize out of a slab");
+    b = (BlockHeader*)((u8*)*h - BLKHDR_SZ);
+    mm_test_check(!(b->flags & BF_SLAB) && (b->flags & BF_HANDLE), "grown Handle flags");
+    for (u32 i = 0; i < 40; i++) {
+        if (((u8*)*h)[i] != (u8)(0x40 + i)) {
+            mm_test_check(false, "grown Handle lost its contents");
+            break;
+        }
+    }
+    mm_test_check(RecoverHandle(*h, &back) && back == h, "RecoverHandle after growing");
+    DisposeHandle(h);
+
+    /* Made purgeable, a slab Handle moves out where PurgeMem can reach it;
+     * locked, not until it is unlocked */
+    h = NewHandle(40);
+    mm_test_check(h != NULL && *h != NULL, "NewHandle(40) to purge");
+    if (!h || !*h) return;
+    for (u32 i = 0; i < 40; i++) {
+        ((u8*)*h)[i] = (u8)(0x80 + i);
+    }
+    HLock(h);
+    HPurge(h);
+    b = (BlockHeader*)((u8*)*h - BLKHDR_SZ);
+    mm_test_check((b->flags & BF_SLAB) != 0, "locked Handle moved out of its slab");
+    HUnlock(h);
+    b = (BlockHeader*)((u8*)*h - BLKHDR_SZ);
+    mm_test_check(!(b->flags & BF_SLAB) && (b->flags & BF_PURGEABLE), "purgeable Handle left in a slab");
+    mm_test_check(RecoverHandle(*h, &back) && back == h, "RecoverHandle after leaving the slab");
+    for (u32 i = 0; i < 40; i++) {
+        if (((u8*)*h)[i] != (u8)(0x80 + i)) {
+            mm_test_check(false, "purgeable Handle lost its contents");
+            break;
+        }
+    }
+    PurgeMem(0x7FFFFFFF);
+    mm_test_check(*h == NULL, "PurgeMem kept a purgeable Handle");
+    MP_Free(z, (void**)h);      /* DisposeHandle keeps an empty handle's master pointer */
+
+    /* Enough objects to need several slabs of each class, freed out of order */
+    for (u32 i = 0; i < kObjs; i++) {
+        objs[i] = NewPtr(8 + (i % 3) * 24);
+        mm_test_check(objs[i] != NULL, "NewPtr in a run");
+    }
+    mm_test_check(slab_count(z) > slabsBefore + 2, "run did not use slabs");
+    for (u32 i = 0; i < kObjs; i += 2) DisposePtr(objs[i]);
+    for (u32 i = 1; i < kObjs; i += 2) DisposePtr(objs[i]);
+    DisposePtr(p);
+
+    /* Each class keeps one spare at most, and CompactMem gives those back */
+    for (u32 cls = 0; cls < NUM_SLAB_CLASSES; cls++) {
+        mm_test_check(z->slabs[cls].slabs <= 1 && z->slabs[cls].partial == NULL,
+                        "empty slabs not given back");
+    }
+    CompactMem(0);
+    mm_test_check(slab_count(z) == 0, "CompactMem kept a spare slab");
+    mm_test_check(z->bytesUsed == usedBefore, "bytesUsed not restored");
+
+    selftest_compaction();
+
+    /* The snapshot is the size it says, and says so in its header */
+    static u8 snap[MM_SNAPSHOT_MAX];
+    u32 len = MemoryManager_Snapshot(NULL, 0);
+    mm_test_check(len >= MM_SNAPSHOT_HEADER + 2 * MM_SNAPSHOT_ZONE && len <= sizeof(snap),
+                  "snapshot size");
+    if (MemoryManager_Snapshot(snap, sizeof(snap)) == len) {
+        mm_test_check(snap[0] == 'H' && snap[3] == 'F' && snap[6] == 2 &&
+                      (u32)(snap[12] | snap[13] << 8 | snap[14] << 16 | (u32)snap[15] << 24) == len,
+                      "snapshot header");
+    }
+
+    /* The counters are for what the system does, not for this */
+    memset(&z->stats, 0, sizeof(z->stats));
+#if MEMORY_PROFILE
+    memset(gAllocSites, 0, sizeof(gAllocSites));
+    memset(&gAllocSiteOverflow, 0, sizeof(gAllocSiteOverflow));
+#endif
+}
+
+/* ======================== Slab Benchmark ======================== */
+
+#ifdef MEMORY_BENCHMARK
+#include "TimeManager/TimeBase.h"
+
+enum { kBenchLive = 512, kBenchSamples = 2048 };
+
+static void bench_sort(uint64_t* a, u32 n) {
+    /* Shell sort: no qsort in the kernel, and this runs once */
+    for (u32 gap = n / 2; gap > 0; gap /= 2) {
+        for (u32 i = gap; i < n; i++) {
+            uint64_t v = a[i];
+            u32 j = i;
+            while (j >= gap && a[j - gap] > v) {
+                a[j] = a[j - gap];
+                j -= gap;
+            }
+            a[j] = v;
+        }
+    }
+}
+
+/* The same mix of small NewPtr and NewHandle calls, with frees between
+ * them so the zone is in use rather than fresh, timing each allocation */
+static void bench_run(const char* label) {
+    static void* live[kBenchLive];
+    static bool isHandle[kBenchLive];
+    static uint64_t samples[kBenchSamples];
+    u32 seed = 12345;
+
+    memset(live, 0, sizeof(live));
+    for (u32 i = 0; i < kBenchSamples; i++) {
+        seed = seed * 1103515245u + 12345u;
+        u32 slot = (seed >> 16) % kBenchLive;
+        u32 size = 8 + ((seed >> 8) & 0x77);
+
+        if (live[slot]) {
+            if (isHandle[slot]) DisposeHandle((Handle)live[slot]);
+            else DisposePtr(live[slot]);
+        }
+
+        isHandle[slot] = (seed & 1) != 0;
+        uint64_t t0 = PlatformCounterNow();
+        live[slot] = isHandle[slot] ? (void*)NewHandle(size) : NewPtr(size);
+        samples[i] = PlatformCounterNow() - t0;
+    }
+    for (u32 i = 0; i < kBenchLive; i++) {
+        if (!live[i]) continue;
+        if (isHandle[i]) DisposeHandle((Handle)live[i]);
+        else DisposePtr(live[i]);
+    }
+
+    bench_sort(samples, kBenchSamples);
+    serial_printf("[MEMBENCH] %s: p50=%u p90=%u p99=%u max=%u ticks\n", label,
+                  (u32)samples[kBenchSamples / 2],
+                  (u32)samples[kBenchSamples * 9 / 10],
+                  (u32)samples[kBenchSamples * 99 / 100],
+                  (u32)samples[kBenchSamples - 1]);
+}
+
+void MemoryManager_Benchmark(void) {
+    bool was = gSlabsEnabled;
+
+    gSlabsEnabled = false;
+    bench_run("freelists");
+    gSlabsEnabled = true;
+    bench_run("slabs    ");
+    gSlabsEnabled = was;
+}
+#endif /* MEMORY_BENCHMARK */
@@ -936,7 +936,7 @@ static void HandleSpecialMenu(short item)
 
             /* Display restart message before rebooting */
             {
-                extern void hal_framebuffer_present(void);
+                extern void QDPlatform_FlushScreen(void);
                 extern QDGlobals qd;
 
                 Pattern grayPat;
@@ -955,7 +955,7 @@ static void HandleSpecialMenu(short item)
                 MoveTo(textX, textY);
                 DrawText(msg, 0, msgLen);
 
-                hal_framebuffer_present();
+                QDPlatform_FlushScreen();
             }
 
             perform_restart();
@@ -973,7 +973,7 @@ static void HandleSpecialMenu(short item)
             /* Display the classic "It is now safe to turn off your Macintosh"
              * shutdown screen before halting. */
             {
-                extern void hal_framebuffer_present(void);
+                extern void QDPlatform_FlushScreen(void);
                 extern QDGlobals qd;
 
                 /* Fill entire screen with gray pattern */
@@ -998,7 +998,7 @@ static void HandleSpecialMenu(short item)
                 DrawText(msg, 0, msgLen);
 
                 /* Present framebuffer so user sees the message */
-                hal_framebuffer_present();
+                QDPlatform_FlushScreen();
             }
 
             perform_power_off();
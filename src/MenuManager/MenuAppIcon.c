@@ -141,6 +141,8 @@ short MenuAppIcon_Draw(GrafPtr port, short left, short top, Boolean highlighted)
             }
         }
 
+        IconPort_MarkRect(iconLeft, iconTop, iconLeft + 16, iconTop + 16);
+
         /* NOTE: Do NOT call DrawFinderGlyph16 here - that would overwrite the color icon
          * with a monochrome version. The icon has already been rendered above. */
 
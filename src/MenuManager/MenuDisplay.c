@@ -426,36 +426,21 @@ void HideMenu(void)
         return;
     }
 
-    /* Restore screen bits OR manually erase if restore fails */
+    /* Restore screen bits, or have them repainted if none were saved */
     if (gCurrentSavedBits != NULL) {
         RestoreMenuBits_Display(gCurrentSavedBits, &gCurrentMenuRect);
         DisposeMenuBits(gCurrentSavedBits);
         gCurrentSavedBits = NULL;
     } else {
-        /* CRITICAL: Manually erase menu rect if SaveBits failed
-         * This happens when memory is low and SaveBits couldn't allocate */
-        extern void* framebuffer;
-        extern uint32_t fb_pitch;
-
-        if (framebuffer) {
-            uint32_t bytes_per_pixel = 4;
-            SInt16 width = gCurrentMenuRect.right - gCurrentMenuRect.left;
-            SInt16 height = gCurrentMenuRect.bottom - gCurrentMenuRect.top;
-
-            /* Fill menu rect with white (desktop color) */
-            for (SInt16 y = 0; y < height; y++) {
-                SInt16 screenY = gCurrentMenuRect.top + y;
-                if (screenY >= 0 && screenY < 600) {
-                    for (SInt16 x = 0; x < width; x++) {
-                        SInt16 screenX = gCurrentMenuRect.left + x;
-                        if (screenX >= 0 && screenX < 800) {
-                            uint32_t offset = screenY * (fb_pitch / bytes_per_pixel) + screenX;
-                            ((uint32_t*)framebuffer)[offset] = 0xFFFFFFFF;
-                        }
-                    }
-                }
-            }
-        }
+        /* SaveBits failed (low memory), so there is nothing to put back.
+         * This used to fill the menu rect white, leaving a white hole over
+         * the desktop and windows until something else repainted it. Record
+         * it as screen damage instead and let the Window Manager repaint
+         * what belongs there. */
+        extern void WM_DamageScreenRect(const Rect* r);
+        extern void WM_RepaintDamage(void);
+        WM_DamageScreenRect(&gCurrentMenuRect);
+        WM_RepaintDamage();
     }
 
     /* MENU_LOG_TRACE("Hiding menu ID %d\n", (*(MenuInfo**)gCurrentlyShownMenu)->menuID); */
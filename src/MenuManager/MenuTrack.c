@@ -9,6 +9,7 @@
 #include "MenuManager/MenuLogging.h"
 #include "MenuManager/MenuTypes.h"
 #include "QuickDraw/QuickDraw.h"
+#include "QuickDraw/QuickDrawPlatform.h"  /* QDPresent_* */
 #include "FontManager/FontManager.h"
 #include "EventManager/EventTypes.h"  /* For mouse masks */
 
@@ -89,6 +90,7 @@ static void DrawMenuRect(short left, short top, short right, short bottom, uint3
             fb[y * pitch + x] = color;
         }
     }
+    QDPresent_MarkDirty(left, top, right, bottom);
 }
 
 /*
@@ -116,6 +118,7 @@ static void DimMenuRow(short left, short top, short right, short bottom,
             fb[y * pitch + x] = background;
         }
     }
+    QDPresent_MarkDirty(left, top, right, bottom);
 }
 
 
@@ -527,6 +530,7 @@ static void DrawInvertedText(const char* text, short x, short y, Boolean inverte
         }
         len++;
     }
+    QDPresent_MarkDirty(x, y - 12, currentX, y - 12 + CHICAGO_HEIGHT);
 }
 
 /* Draw rectangle with specified color */
@@ -549,6 +553,7 @@ static void DrawHighlightRect(short left, short top, short right, short bottom,
             fb[y * (fb_pitch / 4) + x] = color;
         }
     }
+    QDPresent_MarkDirty(left, top, right, bottom);
 }
 
 /* Handle mouse movement while tracking menu */
@@ -878,6 +883,11 @@ long TrackMenu(short menuID, Point *startPt) {
         /* Update menu highlighting based on mouse position */
         UpdateMenuTrackingNew(mousePt);
 
+        /* This loop stands in for the main event loop while the menu is
+         * down, so it presents too; double-buffered, nothing drawn above
+         * reaches the screen otherwise */
+        QDPresent_Frame(false);
+
         /* Check button state.
          *
          * This used to declare `extern volatile uint8_t g_mouseState` and test
@@ -1057,6 +1067,12 @@ long TrackMenu(short menuID, Point *startPt) {
         RestoreMenuBits(savedBits);
         DiscardMenuBits(savedBits);
         serial_puts("TrackMenu: Background restored\n");
+    } else {
+        /* Nothing was saved; have the Window Manager repaint under the menu */
+        extern void WM_DamageScreenRect(const Rect* r);
+        extern void WM_RepaintDamage(void);
+        WM_DamageScreenRect(&menuRect);
+        WM_RepaintDamage();
     }
 
     /* Clear tracking state */
@@ -1117,6 +1133,7 @@ static void DrawInvertedAppleIcon(short x, short y) {
             }
         }
     }
+    QDPresent_MarkDirty(x, y, x + 11, y + 13);
 }
 
 /* Draw menu bar with a specific menu title highlighted */
@@ -45,6 +45,9 @@ extern uint32_t fb_width;
 extern uint32_t fb_height;
 extern uint32_t fb_pitch;
 
+/* QuickDraw/QuickDrawPlatform.h; its QuickDraw.h and MenuDisplay.h collide */
+extern void QDPresent_MarkDirty(SInt32 left, SInt32 top, SInt32 right, SInt32 bottom);
+
 /*
  * SaveBits - Save screen bits for menu display
  *
@@ -277,6 +280,10 @@ OSErr RestoreBits(Handle bitsHandle) {
         }
     }
 
+    /* Straight into the framebuffer, so say which part changed */
+    QDPresent_MarkDirty(savedBits->bounds.left, savedBits->bounds.top,
+                        savedBits->bounds.right, savedBits->bounds.bottom);
+
     /* Unlock handle after use */
     HUnlock(bitsHandle);
 
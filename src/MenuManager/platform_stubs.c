@@ -9,6 +9,7 @@
 #include "MenuManager/MenuManager.h"
 #include "MenuManager/menu_private.h"
 #include "MemoryMgr/MemoryManager.h"
+#include "QuickDraw/QuickDrawPlatform.h"  /* QDPresent_MarkDirty */
 #include <stdlib.h>
 #include <string.h>
 
@@ -109,6 +110,7 @@ void Platform_RestoreScreenBits(Handle bits, const Rect* rect)
         src += fb_pitch;
         dst += fb_pitch;
     }
+    QDPresent_MarkDirty(rect->left, rect->top, rect->right, rect->bottom);
 }
 
 /*
@@ -16,6 +16,7 @@ extern void QD_SetScreenPort(void);
 #include "WindowManager/WindowManagerInternal.h"
 #include "WindowManager/WindowPlatform.h"
 #include "QuickDraw/QuickDraw.h"
+#include "QuickDraw/QuickDrawPlatform.h"  /* QDPresent_MarkDirty */
 #include "System71StdLib.h"
 #include "Platform/PlatformLogging.h"
 
@@ -997,4 +998,5 @@ void PlatformDrawRGBABitmap(const UInt8* rgba_data, int width, int height, int d
             }
         }
     }
+    QDPresent_MarkDirty(dest_x, dest_y, dest_x + width, dest_y + height);
 }
@@ -158,3 +158,9 @@ void hal_platform_shutdown(void) {
 int hal_framebuffer_present(void) {
     return arm_framebuffer_present();
 }
+
+int hal_framebuffer_present_rects(const hal_damage_rect_t *rects, uint32_t count) {
+    (void)rects;
+    (void)count;
+    return hal_framebuffer_present();
+}
@@ -371,3 +371,19 @@ int hal_framebuffer_present(void) {
     /* Pi framebuffer doesn't need explicit flush - writes go directly to VideoCore */
     return g_fb_present;
 }
+
+/*
+ * Present only the rectangles that changed. virtio-gpu transfers just
+ * those; the Pi framebuffer is scanned out directly and needs nothing.
+ */
+int hal_framebuffer_present_rects(const hal_damage_rect_t *rects, uint32_t count) {
+#ifdef QEMU_BUILD
+    if (g_fb_present) {
+        virtio_gpu_flush_rects(rects, count);
+    }
+#else
+    (void)rects;
+    (void)count;
+#endif
+    return g_fb_present;
+}
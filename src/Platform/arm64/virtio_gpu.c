@@ -45,6 +45,8 @@
 #define VIRTIO_GPU_CMD_RESOURCE_ATTACH_BACKING  0x0106
 #define VIRTIO_GPU_CMD_RESOURCE_DETACH_BACKING  0x0107
 
+#define VIRTIO_GPU_FLAG_FENCE                   (1 << 0)
+
 #define VIRTIO_GPU_RESP_OK_NODATA               0x1100
 #define VIRTIO_GPU_RESP_OK_DISPLAY_INFO         0x1101
 
@@ -56,6 +58,10 @@
 #define FB_HEIGHT   480
 #define QUEUE_SIZE  32
 
+/* Transfers per flush batch: every command takes two descriptors, and the
+ * batch also carries the RESOURCE_FLUSH */
+#define GPU_MAX_DAMAGE  (QUEUE_SIZE / 2 - 1)
+
 /* VirtIO GPU structures */
 struct virtio_gpu_ctrl_hdr {
     uint32_t type;
@@ -150,6 +156,21 @@ static uint16_t used_idx = 0;
 /* Static response buffer to avoid stack cache issues */
 static struct virtio_gpu_ctrl_hdr gpu_resp_buffer __attribute__((aligned(64)));
 
+/* The flush batch in flight (see virtio_gpu_flush_rects). Each response
+ * gets a cache line of its own so invalidating one never discards another. */
+struct gpu_resp_slot {
+    struct virtio_gpu_ctrl_hdr hdr;
+} __attribute__((aligned(64)));
+
+static struct virtio_gpu_transfer_to_host_2d batch_xfer[GPU_MAX_DAMAGE] __attribute__((aligned(64)));
+static struct virtio_gpu_resource_flush batch_flush __attribute__((aligned(64)));
+static struct gpu_resp_slot batch_resp[GPU_MAX_DAMAGE + 1];
+static uint16_t batch_cmds = 0;         /* commands in flight, 0 = idle */
+static uint64_t fence_next = 1;
+static uint64_t fence_completed = 0;
+static struct virtio_gpu_rect pending_damage;   /* damage not yet queued */
+static uint32_t dcache_line = 0;
+
 /* Helper to print hex value */
 static void print_hex(uint32_t value) {
     static const char hex[] = "0123456789ABCDEF";
@@ -176,9 +197,13 @@ static void notify_queue(uint16_t queue_idx) {
     }
 }
 
-/* Send GPU command and wait for response
- * Uses static buffer for DMA to avoid stack cache coherency issues */
-static bool virtio_gpu_send_cmd(void *cmd, size_t cmd_len, void *resp, size_t resp_len) {
+static inline uint16_t gpu_device_used_idx(void) {
+    return *(volatile uint16_t *)((uintptr_t)&controlq.used + offsetof(struct gpu_virtq_used, idx));
+}
+
+/* Put one command and its response buffer on the control queue. The
+ * device is not notified; callers queue everything they have first. */
+static void gpu_queue_cmd(void *cmd, size_t cmd_len, void *resp, size_t resp_len) {
     uint16_t desc_idx = (avail_idx * 2) % QUEUE_SIZE;
 
     /* Clean command buffer to ensure GPU sees the data */
@@ -190,13 +215,12 @@ static bool virtio_gpu_send_cmd(void *cmd, size_t cmd_len, void *resp, size_t re
     controlq.desc[desc_idx].flags = VIRTQ_DESC_F_NEXT;
     controlq.desc[desc_idx].next = (desc_idx + 1) % QUEUE_SIZE;
 
-    /* Use static response buffer for DMA (avoids stack cache issues) */
-    controlq.desc[(desc_idx + 1) % QUEUE_SIZE].addr = (uint64_t)(uintptr_t)&gpu_resp_buffer;
-    controlq.desc[(desc_idx + 1) % QUEUE_SIZE].len = sizeof(gpu_resp_buffer);
+    controlq.desc[(desc_idx + 1) % QUEUE_SIZE].addr = (uint64_t)(uintptr_t)resp;
+    controlq.desc[(desc_idx + 1) % QUEUE_SIZE].len = resp_len;
     controlq.desc[(desc_idx + 1) % QUEUE_SIZE].flags = VIRTQ_DESC_F_WRITE;
     controlq.desc[(desc_idx + 1) % QUEUE_SIZE].next = 0;
 
-    /* Ensure descriptors are visible before notifying */
+    /* Ensure descriptors are visible before publishing them */
     __sync_synchronize();
 
     /* Add to available ring */
@@ -204,13 +228,61 @@ static bool virtio_gpu_send_cmd(void *cmd, size_t cmd_len, void *resp, size_t re
     __sync_synchronize();
     controlq.avail.idx = ++avail_idx;
     __sync_synchronize();
+}
+
+static bool gpu_resp_ok(const struct virtio_gpu_ctrl_hdr *hdr) {
+    /* Accept any OK response type (0x1100-0x12FF range covers all success codes) */
+    uint32_t respClass = hdr->type & 0xFF00;
+    return respClass == 0x1100 || respClass == 0x1200;
+}
+
+/* Retire the flush batch in flight. With wait, spin (bounded, like
+ * virtio_gpu_send_cmd) until the device has used every command of it;
+ * returns false if it is still running. */
+static bool gpu_reap_batch(bool wait) {
+    if (batch_cmds == 0) return true;
+
+    int timeout = wait ? 100000 : 1;
+    while (gpu_device_used_idx() != avail_idx && --timeout > 0) {
+        __asm__ volatile("dsb sy" ::: "memory");
+    }
+    if (gpu_device_used_idx() != avail_idx) {
+        return false;
+    }
+
+    /* Invalidate cache to see the DMA-written responses */
+    dcache_invalidate_range(batch_resp, sizeof(batch_resp[0]) * batch_cmds);
+    dsb();
+
+    /* The RESOURCE_FLUSH is last and fenced; the device completes it after
+     * the transfers ahead of it, so its fence stands for the whole batch */
+    const struct virtio_gpu_ctrl_hdr *last = &batch_resp[batch_cmds - 1].hdr;
+    if (gpu_resp_ok(last) && (last->flags & VIRTIO_GPU_FLAG_FENCE)) {
+        fence_completed = last->fence_id;
+    }
+
+    used_idx = avail_idx;
+    batch_cmds = 0;
+    return true;
+}
+
+/* Send GPU command and wait for response
+ * Uses static buffer for DMA to avoid stack cache coherency issues */
+static bool virtio_gpu_send_cmd(void *cmd, size_t cmd_len, void *resp, size_t resp_len) {
+    /* Descriptors are reused in order; a flush batch must be off the ring */
+    if (!gpu_reap_batch(true)) {
+        return false;
+    }
+
+    /* Use static response buffer for DMA (avoids stack cache issues) */
+    gpu_queue_cmd(cmd, cmd_len, &gpu_resp_buffer, sizeof(gpu_resp_buffer));
 
     /* Notify device */
     notify_queue(0);
 
     /* Wait for completion - read used.idx with volatile semantics */
     int timeout = 100000;
-    while (*(volatile uint16_t *)((uintptr_t)&controlq.used + offsetof(struct gpu_virtq_used, idx)) == used_idx && --timeout > 0) {
+    while (gpu_device_used_idx() == used_idx && --timeout > 0) {
         __asm__ volatile("dsb sy" ::: "memory");
     }
 
@@ -235,9 +307,7 @@ static bool virtio_gpu_send_cmd(void *cmd, size_t cmd_len, void *resp, size_t re
 
     /* Check response */
     used_idx++;
-    /* Accept any OK response type (0x1100-0x12FF range covers all success codes) */
-    uint32_t respClass = gpu_resp_buffer.type & 0xFF00;
-    if (respClass != 0x1100 && respClass != 0x1200) {
+    if (!gpu_resp_ok(&gpu_resp_buffer)) {
         /* Only non-OK responses are errors - don't log to reduce noise */
         return false;
     }
@@ -472,48 +542,190 @@ bool virtio_gpu_init(void) {
     return true;
 }
 
-void virtio_gpu_flush(void) {
+/* Grow box to take in x,y,w,h (an empty box is 0 wide) */
+static void damage_union(struct virtio_gpu_rect *box, uint32_t x, uint32_t y, uint32_t w, uint32_t h) {
+    if (box->width == 0 || box->height == 0) {
+        box->x = x;
+        box->y = y;
+        box->width = w;
+        box->height = h;
+        return;
+    }
+    uint32_t right = box->x + box->width;
+    uint32_t bottom = box->y + box->height;
+    if (x + w > right) right = x + w;
+    if (y + h > bottom) bottom = y + h;
+    if (x < box->x) box->x = x;
+    if (y < box->y) box->y = y;
+    box->width = right - box->x;
+    box->height = bottom - box->y;
+}
+
+/* Write one rectangle of the framebuffer back from the data cache. Rows
+ * that span the full width are one contiguous range; otherwise each row
+ * is cleaned on its own, with a single barrier at the end. */
+static void gpu_clean_rect(const struct virtio_gpu_rect *r) {
+    if (r->x == 0 && r->width == FB_WIDTH) {
+        dcache_clean_range(&framebuffer[r->y * FB_WIDTH], r->height * FB_WIDTH * 4);
+        return;
+    }
+
+    if (dcache_line == 0) {
+        dcache_line = dcache_get_line_size();
+    }
+    for (uint32_t y = r->y; y < r->y + r->height; y++) {
+        uintptr_t addr = (uintptr_t)&framebuffer[y * FB_WIDTH + r->x];
+        uintptr_t end = addr + r->width * 4;
+        addr &= ~(uintptr_t)(dcache_line - 1);
+        while (addr < end) {
+            __asm__ volatile("dc cvac, %0" :: "r"(addr) : "memory");
+            addr += dcache_line;
+        }
+    }
+    __asm__ volatile("dsb sy" ::: "memory");
+}
+
+/*
+ * Present the changed rectangles.
+ *
+ * The flush used to clean all 1.2MB of the framebuffer from the data cache
+ * and send a full-screen TRANSFER_TO_HOST_2D and RESOURCE_FLUSH, waiting
+ * for each - most of a frame on the QEMU virt target even when only the
+ * cursor had moved. QuickDraw now passes what changed
+ * (QDPresent_Frame -> hal_framebuffer_present_rects):
+ *
+ *   - only the cache lines of those rectangles are cleaned;
+ *   - each rectangle gets its own TRANSFER_TO_HOST_2D and one
+ *     RESOURCE_FLUSH covers their bounding box, all queued behind a
+ *     single notify;
+ *   - the flush is fenced and nobody waits for it. The batch is reaped at
+ *     the start of the next flush (or synchronous command), by which time
+ *     the host has normally finished it, so one flush runs while the next
+ *     frame is drawn.
+ *
+ * More rectangles than a batch holds go out as their bounding box. If the
+ * previous batch is somehow still running after the wait, this frame's
+ * damage is kept in pending_damage and sent with the next one.
+ */
+void virtio_gpu_flush_rects(const hal_damage_rect_t *rects, uint32_t count) {
+    struct virtio_gpu_rect damage[GPU_MAX_DAMAGE];
+    struct virtio_gpu_rect box;
+    uint32_t n = 0;
+    bool overflow = false;
+
     if (!initialized) return;
 
-    /* Flush framebuffer from cache to memory so GPU can see it */
-    dcache_clean_range(framebuffer, FB_WIDTH * FB_HEIGHT * 4);
+    box.x = 0;
+    box.y = 0;
+    box.width = 0;
+    box.height = 0;
 
-    struct virtio_gpu_ctrl_hdr resp_hdr;
+    if (rects == NULL || count == 0) {
+        damage_union(&box, 0, 0, FB_WIDTH, FB_HEIGHT);
+        overflow = true;
+    } else {
+        /* Damage left over from a deferred flush goes first */
+        if (pending_damage.width != 0) {
+            damage[n].x = pending_damage.x;
+            damage[n].y = pending_damage.y;
+            damage[n].width = pending_damage.width;
+            damage[n].height = pending_damage.height;
+            damage_union(&box, pending_damage.x, pending_damage.y,
+                         pending_damage.width, pending_damage.height);
+            n++;
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t x = rects[i].x;
+            uint32_t y = rects[i].y;
+            uint32_t w = rects[i].width;
+            uint32_t h = rects[i].height;
+            if (x >= FB_WIDTH || y >= FB_HEIGHT) continue;
+            if (w > FB_WIDTH - x) w = FB_WIDTH - x;
+            if (h > FB_HEIGHT - y) h = FB_HEIGHT - y;
+            if (w == 0 || h == 0) continue;
+
+            if (n < GPU_MAX_DAMAGE) {
+                damage[n].x = x;
+                damage[n].y = y;
+                damage[n].width = w;
+                damage[n].height = h;
+                n++;
+            } else {
+                overflow = true;
+            }
+            damage_union(&box, x, y, w, h);
+        }
+    }
 
-    /* Transfer to host - use explicit assignment to avoid ARM64 compound literal issues */
-    struct virtio_gpu_transfer_to_host_2d transfer_cmd;
-    transfer_cmd.hdr.type = VIRTIO_GPU_CMD_TRANSFER_TO_HOST_2D;
-    transfer_cmd.hdr.flags = 0;
-    transfer_cmd.hdr.fence_id = 0;
-    transfer_cmd.hdr.ctx_id = 0;
-    transfer_cmd.hdr.padding = 0;
-    transfer_cmd.r.x = 0;
-    transfer_cmd.r.y = 0;
-    transfer_cmd.r.width = FB_WIDTH;
-    transfer_cmd.r.height = FB_HEIGHT;
-    transfer_cmd.offset = 0;
-    transfer_cmd.resource_id = 1;
-    transfer_cmd.padding = 0;
+    if (box.width == 0) return;
+    if (overflow) {
+        damage[0].x = box.x;
+        damage[0].y = box.y;
+        damage[0].width = box.width;
+        damage[0].height = box.height;
+        n = 1;
+    }
 
-    if (!virtio_gpu_send_cmd(&transfer_cmd, sizeof(transfer_cmd), &resp_hdr, sizeof(resp_hdr))) {
+    if (!gpu_reap_batch(true)) {
+        damage_union(&pending_damage, box.x, box.y, box.width, box.height);
         return;
     }
+    pending_damage.width = 0;
+    pending_damage.height = 0;
+
+    /* Transfer each rectangle - use explicit assignment to avoid ARM64
+     * compound literal issues. offset is where the rectangle starts in the
+     * backing store; the host steps rows by the resource stride. */
+    for (uint32_t i = 0; i < n; i++) {
+        gpu_clean_rect(&damage[i]);
+
+        struct virtio_gpu_transfer_to_host_2d *xfer = &batch_xfer[i];
+        xfer->hdr.type = VIRTIO_GPU_CMD_TRANSFER_TO_HOST_2D;
+        xfer->hdr.flags = 0;
+        xfer->hdr.fence_id = 0;
+        xfer->hdr.ctx_id = 0;
+        xfer->hdr.padding = 0;
+        xfer->r.x = damage[i].x;
+        xfer->r.y = damage[i].y;
+        xfer->r.width = damage[i].width;
+        xfer->r.height = damage[i].height;
+        xfer->offset = ((uint64_t)damage[i].y * FB_WIDTH + damage[i].x) * 4;
+        xfer->resource_id = 1;
+        xfer->padding = 0;
+
+        gpu_queue_cmd(xfer, sizeof(*xfer), &batch_resp[i], sizeof(batch_resp[i].hdr));
+    }
 
-    /* Flush - use explicit assignment */
-    struct virtio_gpu_resource_flush flush_cmd;
-    flush_cmd.hdr.type = VIRTIO_GPU_CMD_RESOURCE_FLUSH;
-    flush_cmd.hdr.flags = 0;
-    flush_cmd.hdr.fence_id = 0;
-    flush_cmd.hdr.ctx_id = 0;
-    flush_cmd.hdr.padding = 0;
-    flush_cmd.r.x = 0;
-    flush_cmd.r.y = 0;
-    flush_cmd.r.width = FB_WIDTH;
-    flush_cmd.r.height = FB_HEIGHT;
-    flush_cmd.resource_id = 1;
-    flush_cmd.padding = 0;
+    /* One fenced flush for the lot */
+    batch_flush.hdr.type = VIRTIO_GPU_CMD_RESOURCE_FLUSH;
+    batch_flush.hdr.flags = VIRTIO_GPU_FLAG_FENCE;
+    batch_flush.hdr.fence_id = fence_next++;
+    batch_flush.hdr.ctx_id = 0;
+    batch_flush.hdr.padding = 0;
+    batch_flush.r.x = box.x;
+    batch_flush.r.y = box.y;
+    batch_flush.r.width = box.width;
+    batch_flush.r.height = box.height;
+    batch_flush.resource_id = 1;
+    batch_flush.padding = 0;
+
+    gpu_queue_cmd(&batch_flush, sizeof(batch_flush), &batch_resp[n], sizeof(batch_resp[n].hdr));
+    batch_cmds = (uint16_t)(n + 1);
+
+    notify_queue(0);
+}
+
+/* Whole-screen flush that returns once the host has it - for the boot
+ * path and display_flush, which expect the picture to be up */
+void virtio_gpu_flush(void) {
+    virtio_gpu_flush_rects(NULL, 0);
+    gpu_reap_batch(true);
+}
 
-    virtio_gpu_send_cmd(&flush_cmd, sizeof(flush_cmd), &resp_hdr, sizeof(resp_hdr));
+/* Fence of the newest flush the host has finished, without waiting */
+uint64_t virtio_gpu_fence_completed(void) {
+    gpu_reap_batch(false);
+    return fence_completed;
 }
 
 void virtio_gpu_clear(uint32_t color) {
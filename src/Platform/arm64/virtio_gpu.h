@@ -7,9 +7,12 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include "Platform/include/boot.h"   /* hal_damage_rect_t */
 
 bool virtio_gpu_init(void);
 void virtio_gpu_flush(void);
+void virtio_gpu_flush_rects(const hal_damage_rect_t *rects, uint32_t count);
+uint64_t virtio_gpu_fence_completed(void);
 void virtio_gpu_clear(uint32_t color);
 void virtio_gpu_draw_rect(uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t color);
 uint32_t* virtio_gpu_get_buffer(void);
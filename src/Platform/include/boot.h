@@ -17,6 +17,14 @@ typedef struct {
     uint8_t blue_size;
 } hal_framebuffer_info_t;
 
+/* A changed area of the framebuffer, in pixels */
+typedef struct {
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+} hal_damage_rect_t;
+
 void hal_boot_init(void *boot_arg);
 int hal_get_framebuffer_info(hal_framebuffer_info_t *info);
 uint32_t hal_get_memory_size(void);
@@ -24,6 +32,10 @@ uint32_t hal_get_irq0_ticks(void);
 int hal_platform_init(void);
 void hal_platform_shutdown(void);
 int hal_framebuffer_present(void);
+/* Present only the given rectangles; rects == NULL or count == 0 means the
+ * whole screen. Displays without an explicit flush treat it like
+ * hal_framebuffer_present. */
+int hal_framebuffer_present_rects(const hal_damage_rect_t *rects, uint32_t count);
 
 #if defined(__powerpc__) || defined(__powerpc64__)
 #include "Platform/PowerPC/OpenFirmware.h"
@@ -92,6 +92,12 @@ int hal_framebuffer_present(void) {
     return g_fb_present;
 }
 
+int hal_framebuffer_present_rects(const hal_damage_rect_t *rects, uint32_t count) {
+    (void)rects;
+    (void)count;
+    return hal_framebuffer_present();
+}
+
 size_t hal_ppc_get_memory_ranges(ofw_memory_range_t *out_ranges, size_t max_ranges) {
     if (!out_ranges || max_ranges == 0) {
         return 0;
@@ -1,8 +1,8 @@
 /*
  * ATA_Driver.c - ATA/IDE disk driver implementation
  *
- * Bare-metal ATA/IDE driver using PIO mode for System 7.1.
- * Supports LBA28 addressing for drives up to 128GB.
+ * Bare-metal ATA/IDE driver for System 7.1: bus-master DMA on PCI IDE
+ * controllers that have it, PIO otherwise, LBA28 or LBA48 as the LBA needs.
  */
 
 #include "ATA_Driver.h"
@@ -10,6 +10,10 @@
 #include "Platform/include/io.h"
 #include "FileManagerTypes.h"
 #include "xhci.h"
+#include "pci.h"
+#include "pic.h"
+#include "idt.h"
+#include "Platform/include/boot.h"
 #include <stddef.h>
 #include "Platform/PlatformLogging.h"
 
@@ -32,6 +36,8 @@ static inline int ascii_upper(int c) {
 }
 
 static OSErr ATA_ReadATAPISectors(ATADevice* device, uint32_t lba, uint16_t count, void* buffer);
+static void ata_dma_init(void);
+static void ata_dma_shutdown(void);
 
 static int iso_name_match(const uint8_t *name, uint8_t name_len, const char *target) {
     int i = 0;
@@ -522,6 +528,8 @@ OSErr hal_storage_init(void) {
         ATA_TestATAPI(&g_ata_devices[i]);
     }
 
+    ata_dma_init();
+
     g_ata_initialized = true;
     return noErr;
 }
@@ -541,6 +549,8 @@ OSErr hal_storage_shutdown(void) {
         }
     }
 
+    ata_dma_shutdown();
+
     g_ata_initialized = false;
     g_device_count = 0;
     return noErr;
@@ -597,128 +607,548 @@ ATADevice* ATA_GetDevice(int index) {
 }
 
 /*
- * ATA_ReadSectors - Read sectors using PIO mode (LBA28)
+ * Data transfers
+ *
+ * ATA_ReadSectors used to be the only way in: 28-bit READ SECTORS, whose
+ * count register stops at 255, with every word of every sector fetched by
+ * hal_inw after a DRQ poll. Sequential reads were bound by the CPU doing
+ * port I/O, not by the disk.
+ *
+ * Where the IDE controller is a PCI bus master (PIIX and its relatives,
+ * QEMU's included) the drive now moves the data itself. A table of
+ * Physical Region Descriptors describes the caller's buffer, the
+ * controller walks it, and the channel's IRQ says when it is done - the
+ * CPU waits in hlt rather than in a loop of port reads. READ/WRITE DMA EXT
+ * let one command cover ATA_DMA_MAX_SECTORS sectors and reach past 128GB;
+ * PIO uses the EXT commands too when the LBA needs them.
+ *
+ * DMA is only used on a channel the controller runs in legacy mode - the
+ * ports and IRQs this driver has always used - and only for a drive that
+ * reads back its first sector the same by DMA as by PIO when the driver
+ * starts. The controller timings and the drive's DMA mode are whatever the
+ * firmware set up; the read test is what catches firmware that left them
+ * unusable. A DMA command that fails turns DMA off for the channel and the
+ * rest of the transfer goes by PIO. With interrupts off (or an IRQ that
+ * never arrives) completion is found by polling the bus-master status.
  */
-OSErr ATA_ReadSectors(ATADevice* device, uint32_t lba, uint8_t count, void* buffer) {
-    if (!device || !device->present) {
-        return paramErr;
-    }
 
-    if (count == 0) {
-        return noErr;
+#define ATA_PCI_CLASS_STORAGE           0x01
+#define ATA_PCI_SUBCLASS_IDE            0x01
+#define ATA_PCI_PROGIF_PRIMARY_NATIVE   0x01
+#define ATA_PCI_PROGIF_SECONDARY_NATIVE 0x04
+#define ATA_PCI_PROGIF_BUS_MASTER       0x80
+
+#define ATA_LBA28_LIMIT         0x10000000ull   /* first LBA READ SECTORS cannot reach */
+#define ATA_LBA48_LIMIT         (1ull << 48)
+#define ATA_PIO_MAX_SECTORS     255
+#define ATA_DMA_MAX_SECTORS_28  256     /* READ/WRITE DMA: a count of 0 means 256 */
+#define ATA_DMA_MAX_SECTORS     2048    /* per EXT command: 1MB, at most 17 PRD entries */
+#define ATA_PRD_ENTRIES         32
+#define ATA_DMA_TIMEOUT_TICKS   5000    /* IRQ0 runs at 1kHz */
+#define ATA_DMA_POLL_SPINS      10000000u
+
+typedef struct {
+    uint16_t base_io;
+    uint16_t control_io;
+    uint16_t bm_io;                 /* 0: no bus master on this channel */
+    uint8_t irq;
+    bool irq_registered;
+    ATAPRDEntry* prdt;
+    volatile bool done;             /* set when the DMA command completes */
+    volatile uint8_t bm_status;     /* bus-master and ATA status at completion */
+    volatile uint8_t status;
+} ATAChannel;
+
+/* 256 bytes each and 256-aligned, so neither table crosses a 64KB boundary */
+static ATAPRDEntry __attribute__((aligned(256))) g_ata_prdt[2][ATA_PRD_ENTRIES];
+static ATAChannel g_ata_channels[2];
+
+static ATAChannel* ata_channel(const ATADevice* device) {
+    return &g_ata_channels[device->base_io == ATA_PRIMARY_IO ? 0 : 1];
+}
+
+static inline bool ata_interrupts_enabled(void) {
+    uint32_t flags;
+    __asm__ volatile("pushf; pop %0" : "=r"(flags));
+    return (flags & 0x200) != 0;
+}
+
+/* Select the drive and load the sector count and LBA for a transfer */
+static void ata_load_taskfile(ATADevice* device, uint64_t lba, uint32_t count, bool lba48) {
+    uint16_t base_io = device->base_io;
+    uint8_t drive = device->is_slave ? ATA_DRIVE_SLAVE : ATA_DRIVE_MASTER;
+
+    if (lba48) {
+        hal_outb(base_io + ATA_REG_DRIVE_HEAD, drive | ATA_DRIVE_LBA);
+        ata_io_delay(device->control_io);
+
+        /* High-order bytes first: each register holds the last two written */
+        hal_outb(base_io + ATA_REG_SECCOUNT, (uint8_t)(count >> 8));
+        hal_outb(base_io + ATA_REG_LBA_LOW, (uint8_t)(lba >> 24));
+        hal_outb(base_io + ATA_REG_LBA_MID, (uint8_t)(lba >> 32));
+        hal_outb(base_io + ATA_REG_LBA_HIGH, (uint8_t)(lba >> 40));
+    } else {
+        hal_outb(base_io + ATA_REG_DRIVE_HEAD,
+                 (uint8_t)(drive | ATA_DRIVE_LBA | ((lba >> 24) & 0x0F)));
+        ata_io_delay(device->control_io);
     }
 
+    /* A count of 256 (65536 for EXT commands) goes out as 0 */
+    hal_outb(base_io + ATA_REG_SECCOUNT, (uint8_t)count);
+    hal_outb(base_io + ATA_REG_LBA_LOW, (uint8_t)lba);
+    hal_outb(base_io + ATA_REG_LBA_MID, (uint8_t)(lba >> 8));
+    hal_outb(base_io + ATA_REG_LBA_HIGH, (uint8_t)(lba >> 16));
+}
+
+/*
+ * ata_pio_transfer - Move count sectors (at most 256) through the data
+ * register. Reads fill in, writes come from out.
+ */
+static OSErr ata_pio_transfer(ATADevice* device, uint64_t lba, uint32_t count,
+                              uint8_t* in, const uint8_t* out) {
     uint16_t base_io = device->base_io;
-    uint16_t control_io = device->control_io;
-    uint16_t* buf16 = (uint16_t*)buffer;
+    bool lba48 = (lba + count > ATA_LBA28_LIMIT);
+    uint8_t command;
 
-    /* Select drive and set LBA mode */
-    uint8_t drive_head = (device->is_slave ? ATA_DRIVE_SLAVE : ATA_DRIVE_MASTER) |
-                         ATA_DRIVE_LBA | ((lba >> 24) & 0x0F);
-    hal_outb(base_io + ATA_REG_DRIVE_HEAD, drive_head);
-    ata_io_delay(control_io);
+    if (out) {
+        command = lba48 ? ATA_CMD_WRITE_SECTORS_EXT : ATA_CMD_WRITE_SECTORS;
+    } else {
+        command = lba48 ? ATA_CMD_READ_SECTORS_EXT : ATA_CMD_READ_SECTORS;
+    }
 
-    /* Set sector count and LBA (all three LBA registers required for 28-bit LBA) */
-    hal_outb(base_io + ATA_REG_SECCOUNT, count);
-    hal_outb(base_io + ATA_REG_LBA_LOW, lba & 0xFF);
-    hal_outb(base_io + ATA_REG_LBA_MID, (lba >> 8) & 0xFF);
-    hal_outb(base_io + ATA_REG_LBA_HIGH, (lba >> 16) & 0xFF);
-    hal_outb(base_io + ATA_REG_COMMAND, ATA_CMD_READ_SECTORS);
-    ata_io_delay(control_io);
+    ATA_WaitBusy(base_io);
+    ata_load_taskfile(device, lba, count, lba48);
+    hal_outb(base_io + ATA_REG_COMMAND, command);
+    ata_io_delay(device->control_io);
 
-    /* Read each sector */
-    for (int sector = 0; sector < count; sector++) {
+    for (uint32_t sector = 0; sector < count; sector++) {
         /* Wait for DRQ */
         if (!ATA_WaitDRQ(base_io)) {
-            PLATFORM_LOG_DEBUG("ATA: Read failed at sector %d\n", sector);
+            PLATFORM_LOG_DEBUG("ATA: %s failed at sector %u\n", out ? "Write" : "Read", sector);
             return ioErr;
         }
 
-        /* Read 256 words (512 bytes) */
-        for (int i = 0; i < 256; i++) {
-            buf16[sector * 256 + i] = hal_inw(base_io + ATA_REG_DATA);
+        /* 256 words (512 bytes) */
+        if (out) {
+            const uint16_t* words = (const uint16_t*)(out + sector * 512);
+            for (int i = 0; i < 256; i++) {
+                hal_outw(base_io + ATA_REG_DATA, words[i]);
+            }
+            ATA_WaitBusy(base_io);
+        } else {
+            uint16_t* words = (uint16_t*)(in + sector * 512);
+            for (int i = 0; i < 256; i++) {
+                words[i] = hal_inw(base_io + ATA_REG_DATA);
+            }
         }
 
         /* Check for errors */
         uint8_t status = ATA_ReadStatus(base_io);
         if (status & ATA_STATUS_ERR) {
             uint8_t error = hal_inb(base_io + ATA_REG_ERROR);
-            PLATFORM_LOG_DEBUG("ATA: Read error (status=0x%02x, error=0x%02x)\n", status, error);
+            PLATFORM_LOG_DEBUG("ATA: %s error (status=0x%02x, error=0x%02x)\n",
+                               out ? "Write" : "Read", status, error);
             return ioErr;
         }
     }
 
-    PLATFORM_LOG_DEBUG("ATA: Read complete\n");
     return noErr;
 }
 
+/* Describe bytes at phys in the channel's PRD table, split at 64KB lines */
+static bool ata_dma_build_prdt(ATAChannel* ch, uint32_t phys, uint32_t bytes) {
+    int n = 0;
+
+    if ((phys & 1) || bytes == 0 || (uint64_t)phys + bytes > 0x100000000ull) {
+        return false;
+    }
+
+    while (bytes > 0) {
+        if (n == ATA_PRD_ENTRIES) {
+            return false;
+        }
+        uint32_t room = 0x10000 - (phys & 0xFFFF);
+        uint32_t len = (bytes < room) ? bytes : room;
+
+        ch->prdt[n].base = phys;
+        ch->prdt[n].bytes = (uint16_t)len;     /* 64KB goes in as 0 */
+        ch->prdt[n].flags = 0;
+        phys += len;
+        bytes -= len;
+        n++;
+    }
+    ch->prdt[n - 1].flags = ATA_PRD_EOT;
+    return true;
+}
+
 /*
- * ATA_WriteSectors - Write sectors using PIO mode (LBA28)
+ * ata_irq_handler - IRQ14/15 on a channel with DMA enabled. Reading the
+ * ATA status acknowledges the drive; a PIO command's interrupt, with no
+ * bus-master interrupt behind it, stops there.
  */
-OSErr ATA_WriteSectors(ATADevice* device, uint32_t lba, uint8_t count, const void* buffer) {
-    if (!device || !device->present) {
+static void ata_irq_handler(uint8_t irq) {
+    ATAChannel* ch = &g_ata_channels[irq == ATA_SECONDARY_IRQ ? 1 : 0];
+    uint8_t bm_status = hal_inb(ch->bm_io + ATA_BM_REG_STATUS);
+    uint8_t status = hal_inb(ch->base_io + ATA_REG_STATUS);
+
+    if (!(bm_status & ATA_BM_STATUS_IRQ)) {
+        return;
+    }
+
+    /* Writing the status back clears IRQ and ERR, keeps the drive bits */
+    hal_outb(ch->bm_io + ATA_BM_REG_STATUS, bm_status);
+    ch->bm_status = bm_status;
+    ch->status = status;
+    ch->done = true;
+}
+
+/*
+ * ata_dma_wait - Sleep until the channel's IRQ reports the command done.
+ * cli before the test so the IRQ cannot land between it and the hlt; sti
+ * only takes effect after the hlt has begun.
+ */
+static bool ata_dma_wait(ATAChannel* ch) {
+    if (ch->irq_registered && ata_interrupts_enabled()) {
+        uint32_t start = hal_get_irq0_ticks();
+
+        while (!ch->done && hal_get_irq0_ticks() - start < ATA_DMA_TIMEOUT_TICKS) {
+            __asm__ volatile("cli");
+            if (ch->done) {
+                __asm__ volatile("sti");
+                break;
+            }
+            __asm__ volatile("sti; hlt" ::: "memory");
+        }
+        if (ch->done) {
+            return true;
+        }
+    }
+
+    /* No interrupt to wait for: watch the bus-master status */
+    for (uint32_t spins = 0; spins < ATA_DMA_POLL_SPINS; spins++) {
+        uint8_t bm_status = hal_inb(ch->bm_io + ATA_BM_REG_STATUS);
+
+        if (bm_status & (ATA_BM_STATUS_IRQ | ATA_BM_STATUS_ERR)) {
+            ch->status = hal_inb(ch->base_io + ATA_REG_STATUS);
+            hal_outb(ch->bm_io + ATA_BM_REG_STATUS, bm_status);
+            ch->bm_status = bm_status;
+            return true;
+        }
+        if (ch->done) {
+            return true;    /* the IRQ came after all */
+        }
+        __asm__ volatile("pause");
+    }
+    return false;
+}
+
+/*
+ * ata_dma_transfer - One READ/WRITE DMA command straight to or from the
+ * caller's buffer (identity-mapped, so its address is its physical one)
+ */
+static OSErr ata_dma_transfer(ATADevice* device, uint64_t lba, uint32_t count,
+                              uint8_t* in, const uint8_t* out) {
+    ATAChannel* ch = ata_channel(device);
+    uint32_t phys = (uint32_t)(uintptr_t)(out ? (const void*)out : (const void*)in);
+    bool lba48 = (lba + count > ATA_LBA28_LIMIT) || count > ATA_DMA_MAX_SECTORS_28;
+    uint8_t direction = out ? 0 : ATA_BM_CMD_READ;
+    uint8_t command;
+
+    if (out) {
+        command = lba48 ? ATA_CMD_WRITE_DMA_EXT : ATA_CMD_WRITE_DMA;
+    } else {
+        command = lba48 ? ATA_CMD_READ_DMA_EXT : ATA_CMD_READ_DMA;
+    }
+
+    if (!ata_dma_build_prdt(ch, phys, count * 512)) {
         return paramErr;
     }
 
+    /* Stopped, pointed at the table, old completion cleared */
+    hal_outb(ch->bm_io + ATA_BM_REG_COMMAND, 0);
+    hal_outl(ch->bm_io + ATA_BM_REG_PRDT, (uint32_t)(uintptr_t)ch->prdt);
+    hal_outb(ch->bm_io + ATA_BM_REG_STATUS,
+             hal_inb(ch->bm_io + ATA_BM_REG_STATUS) | ATA_BM_STATUS_IRQ | ATA_BM_STATUS_ERR);
+    hal_outb(ch->bm_io + ATA_BM_REG_COMMAND, direction);
+
+    ATA_WaitBusy(device->base_io);
+    ata_load_taskfile(device, lba, count, lba48);
+
+    ch->done = false;
+    ch->bm_status = 0;
+    ch->status = 0;
+    hal_outb(device->base_io + ATA_REG_COMMAND, command);
+    hal_outb(ch->bm_io + ATA_BM_REG_COMMAND, direction | ATA_BM_CMD_START);
+
+    bool finished = ata_dma_wait(ch);
+    hal_outb(ch->bm_io + ATA_BM_REG_COMMAND, direction);
+
+    if (!finished) {
+        PLATFORM_LOG_DEBUG("ATA: DMA timeout (LBA %u, %u sectors)\n", (uint32_t)lba, count);
+        return ioErr;
+    }
+    if ((ch->bm_status & ATA_BM_STATUS_ERR) || (ch->status & (ATA_STATUS_ERR | ATA_STATUS_DF))) {
+        PLATFORM_LOG_DEBUG("ATA: DMA error (bm=0x%02x, status=0x%02x, error=0x%02x)\n",
+                           ch->bm_status, ch->status, hal_inb(device->base_io + ATA_REG_ERROR));
+        return ioErr;
+    }
+    return noErr;
+}
+
+/* Back to PIO for every drive on the channel, after a DMA command failed */
+static void ata_dma_disable(ATAChannel* ch) {
+    PLATFORM_LOG_DEBUG("ATA: DMA off for channel 0x%03x, using PIO\n", ch->base_io);
+
+    hal_outb(ch->bm_io + ATA_BM_REG_COMMAND, 0);
+    for (int i = 0; i < g_device_count; i++) {
+        if (g_ata_devices[i].base_io == ch->base_io) {
+            g_ata_devices[i].dma_enabled = false;
+        }
+    }
+
+    /* Abandon whatever the drive was still doing; leaves nIEN set again */
+    ATA_SoftReset(ch->control_io);
+}
+
+static OSErr ata_transfer(ATADevice* device, uint64_t lba, uint32_t count,
+                          uint8_t* in, const uint8_t* out) {
+    if (!device || !device->present) {
+        return paramErr;
+    }
     if (count == 0) {
         return noErr;
     }
+    if (lba + count > (device->lba48_supported ? ATA_LBA48_LIMIT : ATA_LBA28_LIMIT)) {
+        return paramErr;
+    }
 
-    uint16_t base_io = device->base_io;
-    uint16_t control_io = device->control_io;
-    const uint16_t* buf16 = (const uint16_t*)buffer;
+    ATAChannel* ch = ata_channel(device);
 
-    PLATFORM_LOG_DEBUG("ATA: Writing %u sector(s) to LBA %u\n", count, lba);
+    while (count > 0) {
+        uintptr_t address = out ? (uintptr_t)out : (uintptr_t)in;
+        bool dma = device->dma_enabled && ch->bm_io != 0 && (address & 1) == 0;
+        uint32_t limit = ATA_PIO_MAX_SECTORS;
+        OSErr err;
 
-    /* Wait for drive to be ready */
-    ATA_WaitReady(base_io);
+        if (dma) {
+            limit = device->lba48_supported ? ATA_DMA_MAX_SECTORS : ATA_DMA_MAX_SECTORS_28;
+        }
+        uint32_t n = (count < limit) ? count : limit;
 
-    /* Select drive and set LBA mode */
-    uint8_t drive_head = (device->is_slave ? ATA_DRIVE_SLAVE : ATA_DRIVE_MASTER) |
-                         ATA_DRIVE_LBA | ((lba >> 24) & 0x0F);
-    hal_outb(base_io + ATA_REG_DRIVE_HEAD, drive_head);
-    ata_io_delay(control_io);
+        if (dma) {
+            err = ata_dma_transfer(device, lba, n, in, out);
+            if (err != noErr) {
+                ata_dma_disable(ch);
+                continue;       /* the same sectors again, by PIO */
+            }
+        } else {
+            err = ata_pio_transfer(device, lba, n, in, out);
+            if (err != noErr) {
+                return err;
+            }
+        }
 
-    /* Set sector count and LBA */
-    hal_outb(base_io + ATA_REG_SECCOUNT, count);
-    hal_outb(base_io + ATA_REG_LBA_LOW, lba & 0xFF);
-    hal_outb(base_io + ATA_REG_LBA_MID, (lba >> 8) & 0xFF);
-    hal_outb(base_io + ATA_REG_LBA_HIGH, (lba >> 16) & 0xFF);
+        lba += n;
+        count -= n;
+        if (out) {
+            out += n * 512;
+        } else {
+            in += n * 512;
+        }
+    }
 
-    /* Send WRITE SECTORS command */
-    hal_outb(base_io + ATA_REG_COMMAND, ATA_CMD_WRITE_SECTORS);
-    ata_io_delay(control_io);
+    return noErr;
+}
 
-    /* Write each sector */
-    for (int sector = 0; sector < count; sector++) {
-        /* Wait for DRQ */
-        if (!ATA_WaitDRQ(base_io)) {
-            PLATFORM_LOG_DEBUG("ATA: Write failed at sector %d\n", sector);
-            return ioErr;
+/*
+ * ata_dma_self_test - Read sector 0 by PIO and by DMA and compare. The DMA
+ * buffer starts out as the complement of the PIO one, so a transfer that
+ * moves nothing cannot pass.
+ */
+static bool ata_dma_self_test(ATADevice* device) {
+    uint16_t pio[256];
+    uint16_t dma[256];
+
+    if (ata_pio_transfer(device, 0, 1, (uint8_t*)pio, NULL) != noErr) {
+        return false;
+    }
+    for (int i = 0; i < 256; i++) {
+        dma[i] = (uint16_t)~pio[i];
+    }
+    if (ata_dma_transfer(device, 0, 1, (uint8_t*)dma, NULL) != noErr) {
+        return false;
+    }
+    for (int i = 0; i < 256; i++) {
+        if (dma[i] != pio[i]) {
+            return false;
         }
+    }
+    return true;
+}
+
+static void ata_dma_release_channel(ATAChannel* ch) {
+    if (ch->irq_registered) {
+        hal_outb(ch->control_io + ATA_REG_DEV_CONTROL, ATA_CTRL_NIEN);
+        pic_mask_irq(ch->irq);
+        irq_unregister_handler(ch->irq);
+        ch->irq_registered = false;
+    }
+    ch->bm_io = 0;
+}
+
+/* Turn DMA on for the hard disks on one channel that pass the read test */
+static void ata_dma_setup_channel(int index, uint16_t bm_io) {
+    ATAChannel* ch = &g_ata_channels[index];
+    bool candidates = false;
+    bool enabled = false;
+
+    ch->base_io = index ? ATA_SECONDARY_IO : ATA_PRIMARY_IO;
+    ch->control_io = index ? ATA_SECONDARY_CONTROL : ATA_PRIMARY_CONTROL;
+    ch->irq = index ? ATA_SECONDARY_IRQ : ATA_PRIMARY_IRQ;
+    ch->bm_io = bm_io;
+    ch->prdt = g_ata_prdt[index];
 
-        /* Write 256 words (512 bytes) */
-        for (int i = 0; i < 256; i++) {
-            hal_outw(base_io + ATA_REG_DATA, buf16[sector * 256 + i]);
+    for (int i = 0; i < g_device_count; i++) {
+        ATADevice* device = &g_ata_devices[i];
+        if (device->base_io == ch->base_io && device->type == ATA_DEVICE_PATA &&
+            device->dma_supported) {
+            candidates = true;
         }
+    }
+    if (!candidates) {
+        ch->bm_io = 0;
+        return;
+    }
 
-        /* Wait for completion */
-        ATA_WaitBusy(base_io);
+    /* IRQ14/15 come through the slave PIC, so the cascade line too */
+    irq_register_handler(ch->irq, ata_irq_handler);
+    pic_unmask_irq(2);
+    pic_unmask_irq(ch->irq);
+    ch->irq_registered = true;
+    hal_outb(ch->control_io + ATA_REG_DEV_CONTROL, 0);
 
-        /* Check for errors */
-        uint8_t status = ATA_ReadStatus(base_io);
-        if (status & ATA_STATUS_ERR) {
-            uint8_t error = hal_inb(base_io + ATA_REG_ERROR);
-            PLATFORM_LOG_DEBUG("ATA: Write error (status=0x%02x, error=0x%02x)\n", status, error);
-            return ioErr;
+    for (int i = 0; i < g_device_count; i++) {
+        ATADevice* device = &g_ata_devices[i];
+        if (device->base_io != ch->base_io || device->type != ATA_DEVICE_PATA ||
+            !device->dma_supported) {
+            continue;
+        }
+        if (ata_dma_self_test(device)) {
+            device->dma_enabled = true;
+            enabled = true;
+
+            /* Tell anyone reading the controller which drives use DMA */
+            uint8_t drive_bit = device->is_slave ? ATA_BM_STATUS_DRV1_DMA : ATA_BM_STATUS_DRV0_DMA;
+            uint8_t bm_status = hal_inb(bm_io + ATA_BM_REG_STATUS);
+            hal_outb(bm_io + ATA_BM_REG_STATUS,
+                     (uint8_t)((bm_status | drive_bit) & ~(ATA_BM_STATUS_IRQ | ATA_BM_STATUS_ERR)));
+        } else {
+            PLATFORM_LOG_DEBUG("ATA: %s failed the DMA read test, using PIO\n", device->model);
+
+            /* The command may still be outstanding: reset the channel, and
+             * turn its interrupts back on for the other drive's test */
+            ATA_SoftReset(ch->control_io);
+            hal_outb(ch->control_io + ATA_REG_DEV_CONTROL, 0);
         }
     }
 
-    /* Flush write cache */
-    ATA_FlushCache(device);
+    if (!enabled) {
+        ata_dma_release_channel(ch);
+    }
+    PLATFORM_LOG_DEBUG("ATA: Channel 0x%03x: %s\n", ch->base_io,
+                       enabled ? "bus-master DMA" : "PIO");
+}
 
-    PLATFORM_LOG_DEBUG("ATA: Write complete\n");
-    return noErr;
+/*
+ * ata_dma_init - Find the IDE controller and set up bus-master DMA on its
+ * legacy-mode channels
+ */
+static void ata_dma_init(void) {
+    pci_device_t devices[64];
+    int found = pci_scan(devices, 64);
+    if (found > 64) {
+        found = 64;
+    }
+
+    for (int i = 0; i < found; i++) {
+        pci_device_t* pci = &devices[i];
+
+        if (pci->class_code != ATA_PCI_CLASS_STORAGE || pci->subclass != ATA_PCI_SUBCLASS_IDE) {
+            continue;
+        }
+        if (!(pci->prog_if & ATA_PCI_PROGIF_BUS_MASTER) || !pci->bar_is_io[4] ||
+            pci->bar_addrs[4] == 0) {
+            PLATFORM_LOG_DEBUG("ATA: IDE controller has no bus master; PIO only\n");
+            return;
+        }
+
+        uint32_t cmd = pci_read_config_dword(pci->bus, pci->slot, pci->func, 0x04);
+        cmd |= (1 << 0); /* I/O Space */
+        cmd |= (1 << 2); /* Bus Master */
+        pci_write_config_dword(pci->bus, pci->slot, pci->func, 0x04, cmd);
+
+        uint16_t bm_io = (uint16_t)(pci->bar_addrs[4] & 0xFFFF);
+        PLATFORM_LOG_DEBUG("ATA: Bus-master IDE at 0x%04x\n", bm_io);
+
+        for (int channel = 0; channel < 2; channel++) {
+            /* A native-mode channel has ports and an IRQ of its own, not
+             * the legacy ones this driver talks to */
+            uint8_t native = channel ? ATA_PCI_PROGIF_SECONDARY_NATIVE : ATA_PCI_PROGIF_PRIMARY_NATIVE;
+            if (pci->prog_if & native) {
+                continue;
+            }
+            ata_dma_setup_channel(channel, (uint16_t)(bm_io + channel * ATA_BM_SECONDARY));
+        }
+        return;
+    }
+
+    PLATFORM_LOG_DEBUG("ATA: No PCI IDE controller; PIO only\n");
+}
+
+/* Interrupts back off and the handlers gone, for hal_storage_shutdown */
+static void ata_dma_shutdown(void) {
+    ata_dma_release_channel(&g_ata_channels[0]);
+    ata_dma_release_channel(&g_ata_channels[1]);
+}
+
+/*
+ * ATA_ReadSectors48 - Read sectors, by DMA where enabled
+ */
+OSErr ATA_ReadSectors48(ATADevice* device, uint64_t lba, uint32_t count, void* buffer) {
+    if (!buffer) {
+        return paramErr;
+    }
+    return ata_transfer(device, lba, count, (uint8_t*)buffer, NULL);
+}
+
+/*
+ * ATA_WriteSectors48 - Write sectors, by DMA where enabled
+ *
+ * Left in the drive's write cache: whoever needs them on the medium calls
+ * ATA_FlushCache, once for however many writes came before.
+ */
+OSErr ATA_WriteSectors48(ATADevice* device, uint64_t lba, uint32_t count, const void* buffer) {
+    if (!buffer) {
+        return paramErr;
+    }
+
+    PLATFORM_LOG_DEBUG("ATA: Writing %u sector(s) to LBA %u\n", count, (uint32_t)lba);
+
+    return ata_transfer(device, lba, count, NULL, (const uint8_t*)buffer);
+}
+
+/*
+ * ATA_ReadSectors - Read up to 255 sectors (LBA28)
+ */
+OSErr ATA_ReadSectors(ATADevice* device, uint32_t lba, uint8_t count, void* buffer) {
+    return ATA_ReadSectors48(device, lba, count, buffer);
+}
+
+/*
+ * ATA_WriteSectors - Write up to 255 sectors (LBA28)
+ */
+OSErr ATA_WriteSectors(ATADevice* device, uint32_t lba, uint8_t count, const void* buffer) {
+    return ATA_WriteSectors48(device, lba, count, buffer);
 }
 
 /*
@@ -925,29 +1355,9 @@ OSErr hal_storage_read_blocks(int drive_index, uint64_t start_block, uint32_t bl
         return noErr;
     }
 
-    /* ATA uses LBA28, so we can only address 28 bits */
-    if (start_block > 0x0FFFFFFF) {
-        return paramErr;
-    }
-
-    /* Read in chunks of 255 sectors (max for LBA28) */
-    uint8_t* buf = (uint8_t*)buffer;
-    uint32_t remaining = block_count;
-    uint32_t current_lba = (uint32_t)start_block;
-
-    while (remaining > 0) {
-        uint8_t count = (remaining > 255) ? 255 : (uint8_t)remaining;
-        OSErr err = ATA_ReadSectors(device, current_lba, count, buf);
-        if (err != noErr) {
-            return err;
-        }
-
-        remaining -= count;
-        current_lba += count;
-        buf += (count * 512);
-    }
-
-    return noErr;
+    /* One call: ATA_ReadSectors48 issues commands as large as the drive
+     * and transfer mode take, and LBA48 ones where the LBA needs them */
+    return ATA_ReadSectors48(device, start_block, block_count, buffer);
 }
 
 OSErr hal_storage_write_blocks(int drive_index, uint64_t start_block, uint32_t block_count, const void* buffer) {
@@ -966,28 +1376,11 @@ OSErr hal_storage_write_blocks(int drive_index, uint64_t start_block, uint32_t b
         return wPrErr;
     }
 
-    /* ATA uses LBA28, so we can only address 28 bits */
-    if (start_block > 0x0FFFFFFF) {
-        return paramErr;
-    }
-
-    /* Write in chunks of 255 sectors (max for LBA28) */
-    const uint8_t* buf = (const uint8_t*)buffer;
-    uint32_t remaining = block_count;
-    uint32_t current_lba = (uint32_t)start_block;
-
-    while (remaining > 0) {
-        uint8_t count = (remaining > 255) ? 255 : (uint8_t)remaining;
-        OSErr err = ATA_WriteSectors(device, current_lba, count, buf);
-        if (err != noErr) {
-            return err;
-        }
-
-        remaining -= count;
-        current_lba += count;
-        buf += (count * 512);
+    /* The HAL has no flush of its own, so a write here is on the medium
+     * when it returns: one FLUSH CACHE after the whole run */
+    OSErr err = ATA_WriteSectors48(device, start_block, block_count, buffer);
+    if (err != noErr || block_count == 0) {
+        return err;
     }
-
-    /* Flush cache after write */
     return ATA_FlushCache(device);
 }
@@ -134,3 +134,9 @@ void hal_platform_shutdown(void) {
 int hal_framebuffer_present(void) {
     return framebuffer != NULL;
 }
+
+int hal_framebuffer_present_rects(const hal_damage_rect_t *rects, uint32_t count) {
+    (void)rects;
+    (void)count;
+    return hal_framebuffer_present();
+}
@@ -65,6 +65,9 @@ OSErr ProcessManager_Initialize(void)
     /* Initialize CPU backends */
     err = M68KBackend_Initialize();
     if (err == noErr) {
+        /* After the interpreter, so the interpreter stays the default. */
+        M68KThreadedBackend_Initialize();
+
         /* Nothing runs 68K code yet, so this is what notices if the
          * interpreter stops working. Silent unless it fails. */
         extern void M68K_SelfTest(void);
@@ -74,6 +77,16 @@ OSErr ProcessManager_Initialize(void)
         return err;
     }
 
+    /* The PowerPC interpreter was never registered, so nothing could reach
+     * it. Not fatal if it fails: 68K applications do not need it. The Code
+     * Fragment Manager's test runs a small PEF application on it - silent
+     * unless it fails. */
+    extern OSErr PPCBackend_Initialize(void);
+    if (PPCBackend_Initialize() == noErr) {
+        extern void CFM_SelfTest(void);
+        CFM_SelfTest();
+    }
+
     /* Initialize process queue */
     gProcessQueue = (ProcessQueue*)NewPtr(sizeof(ProcessQueue));
     if (!gProcessQueue) {
@@ -0,0 +1,235 @@
+/*
+ * GlyphCache.c - Run-length glyph masks for QDPlatform_DrawGlyph
+ *
+ * Strike bitmaps are packed one bit per pixel, all glyphs side by side in
+ * each row, and QDPlatform_DrawGlyph used to pull every glyph out of that
+ * bit by bit on every draw - a shift, mask and bounds check per pixel of
+ * the glyph box, set or not. Menus, Finder list views and TextEdit redraw
+ * the same few dozen glyphs over and over, so the work is now done once:
+ * the first draw of a glyph turns it into a run-length mask, and later
+ * draws just fill the runs.
+ *
+ * Masks are keyed by strike and character, and by the strike's bitmap
+ * handle so a strike whose bitmap is replaced is never drawn from a stale
+ * mask. The mask bytes come from NewPtr and are bounded by an LRU budget
+ * (kGlyphCacheBudget); a glyph that will not fit the scratch buffer, or
+ * that the heap will not take, is drawn the old way.
+ *
+ * Copyright (c) 2025 - System 7.1 Portable Project
+ */
+
+#include "SystemTypes.h"
+#include "QuickDraw/QuickDrawPlatform.h"
+#include "FontManager/FontTypes.h"
+#include "MemoryMgr/MemoryManager.h"
+#include <string.h>
+#include <stddef.h>
+
+#define kGlyphCacheEntries  1024
+#define kGlyphCacheBuckets  256            /* power of two */
+#define kGlyphCacheBudget   (64 * 1024)    /* bytes of masks */
+#define kGlyphScratchBytes  4096           /* largest mask built */
+#define kGlyphNone          (-1)
+
+typedef struct GlyphCacheEntry {
+    struct FontStrike*  strike;
+    Handle              bitmap;     /* strike->bitmapData when built */
+    UInt8               ch;
+    QDGlyphMask*        mask;       /* NULL: entry is free */
+    SInt16              hashNext;
+    SInt16              lruPrev;    /* towards most recently used */
+    SInt16              lruNext;
+} GlyphCacheEntry;
+
+static GlyphCacheEntry gEntries[kGlyphCacheEntries];
+static SInt16  gBuckets[kGlyphCacheBuckets];
+static SInt16  gLruHead = kGlyphNone;      /* most recently used */
+static SInt16  gLruTail = kGlyphNone;
+static SInt16  gFreeHead = kGlyphNone;     /* chained through lruNext */
+static Boolean gCacheReady = false;
+static UInt8   gScratch[kGlyphScratchBytes];
+static QDGlyphCacheStats gGlyphStats;
+
+static void GlyphCacheInit(void) {
+    for (int b = 0; b < kGlyphCacheBuckets; b++) {
+        gBuckets[b] = kGlyphNone;
+    }
+    for (int i = 0; i < kGlyphCacheEntries; i++) {
+        gEntries[i].mask = NULL;
+        gEntries[i].lruNext = (i + 1 < kGlyphCacheEntries) ? (SInt16)(i + 1) : kGlyphNone;
+    }
+    gFreeHead = 0;
+    gLruHead = kGlyphNone;
+    gLruTail = kGlyphNone;
+    memset(&gGlyphStats, 0, sizeof(gGlyphStats));
+    gGlyphStats.budget = kGlyphCacheBudget;
+    gCacheReady = true;
+}
+
+static UInt32 GlyphHash(const struct FontStrike* strike, UInt8 ch) {
+    uintptr_t key = (uintptr_t)strike;
+    return (UInt32)((key >> 4) ^ (key >> 12) ^ ((UInt32)ch * 31u)) & (kGlyphCacheBuckets - 1);
+}
+
+static void LruUnlink(SInt16 i) {
+    GlyphCacheEntry* e = &gEntries[i];
+    if (e->lruPrev != kGlyphNone) gEntries[e->lruPrev].lruNext = e->lruNext;
+    else gLruHead = e->lruNext;
+    if (e->lruNext != kGlyphNone) gEntries[e->lruNext].lruPrev = e->lruPrev;
+    else gLruTail = e->lruPrev;
+}
+
+static void LruPushFront(SInt16 i) {
+    GlyphCacheEntry* e = &gEntries[i];
+    e->lruPrev = kGlyphNone;
+    e->lruNext = gLruHead;
+    if (gLruHead != kGlyphNone) gEntries[gLruHead].lruPrev = i;
+    gLruHead = i;
+    if (gLruTail == kGlyphNone) gLruTail = i;
+}
+
+/* Drop entry i: out of its bucket and the LRU list, mask freed */
+static void GlyphCacheRemove(SInt16 i) {
+    GlyphCacheEntry* e = &gEntries[i];
+    UInt32 b = GlyphHash(e->strike, e->ch);
+
+    SInt16* link = &gBuckets[b];
+    while (*link != kGlyphNone && *link != i) {
+        link = &gEntries[*link].hashNext;
+    }
+    if (*link == i) *link = e->hashNext;
+
+    LruUnlink(i);
+    gGlyphStats.bytes -= offsetof(QDGlyphMask, runs) + e->mask->bytes;
+    gGlyphStats.glyphs--;
+    DisposePtr((Ptr)e->mask);
+    e->mask = NULL;
+    e->lruNext = gFreeHead;
+    gFreeHead = i;
+}
+
+/*
+ * Run-length encode one glyph of the strike into gScratch. Returns the
+ * byte count, or 0 if the glyph does not fit a byte-sized column or the
+ * scratch buffer.
+ */
+static UInt32 GlyphEncode(const struct FontStrike* strike, const UInt8* bitmap,
+                          SInt16 locStart, SInt16 charWidth) {
+    SInt32 rowBits = (SInt32)strike->rowWords * 16;
+    UInt32 n = 0;
+
+    if (charWidth > 255) return 0;
+
+    for (SInt16 row = 0; row < strike->fRectHeight; row++) {
+        SInt32 bitRowStart = row * rowBits + locStart;
+        UInt32 countAt = n++;
+        UInt8 runs = 0;
+        SInt16 col = 0;
+
+        if (n > kGlyphScratchBytes) return 0;
+        while (col < charWidth) {
+            SInt32 bit = bitRowStart + col;
+            if (!((bitmap[bit >> 3] >> (7 - (bit & 7))) & 1)) {
+                col++;
+                continue;
+            }
+            SInt16 start = col;
+            do {
+                col++;
+                bit++;
+            } while (col < charWidth && ((bitmap[bit >> 3] >> (7 - (bit & 7))) & 1));
+
+            if (n + 2 > kGlyphScratchBytes) return 0;
+            gScratch[n++] = (UInt8)start;
+            gScratch[n++] = (UInt8)(col - start);
+            runs++;
+        }
+        gScratch[countAt] = runs;
+    }
+    return n;
+}
+
+const QDGlyphMask* QDGlyphCache_Lookup(struct FontStrike* strike, UInt8 ch) {
+    if (!strike || !strike->locTable || !strike->bitmapData || !*strike->bitmapData) {
+        return NULL;
+    }
+    if (ch < strike->firstChar || ch > strike->lastChar) {
+        return NULL;
+    }
+    if (!gCacheReady) {
+        GlyphCacheInit();
+    }
+
+    UInt32 b = GlyphHash(strike, ch);
+    for (SInt16 i = gBuckets[b]; i != kGlyphNone; i = gEntries[i].hashNext) {
+        GlyphCacheEntry* e = &gEntries[i];
+        if (e->strike != strike || e->ch != ch) continue;
+        if (e->bitmap == strike->bitmapData) {
+            if (gLruHead != i) {
+                LruUnlink(i);
+                LruPushFront(i);
+            }
+            gGlyphStats.hits++;
+            return e->mask;
+        }
+        GlyphCacheRemove(i);   /* the strike has a new bitmap */
+        break;
+    }
+    gGlyphStats.misses++;
+
+    SInt16 charIndex = ch - strike->firstChar;
+    SInt16 locStart = strike->locTable[charIndex];
+    SInt16 charWidth = strike->locTable[charIndex + 1] - locStart;
+    if (charWidth <= 0 || strike->fRectHeight <= 0) {
+        gGlyphStats.uncached++;
+        return NULL;
+    }
+
+    /* Encode before allocating: NewPtr may move the bitmap handle's block */
+    UInt32 bytes = GlyphEncode(strike, (const UInt8*)*strike->bitmapData, locStart, charWidth);
+    if (bytes == 0) {
+        gGlyphStats.uncached++;
+        return NULL;
+    }
+
+    UInt32 size = offsetof(QDGlyphMask, runs) + bytes;
+    while (gLruTail != kGlyphNone &&
+           (gFreeHead == kGlyphNone || gGlyphStats.bytes + size > kGlyphCacheBudget)) {
+        GlyphCacheRemove(gLruTail);
+        gGlyphStats.evictions++;
+    }
+
+    QDGlyphMask* mask = (QDGlyphMask*)NewPtr((Size)size);
+    if (!mask || gFreeHead == kGlyphNone) {
+        if (mask) DisposePtr((Ptr)mask);
+        gGlyphStats.uncached++;
+        return NULL;
+    }
+    mask->width = charWidth;
+    mask->height = strike->fRectHeight;
+    mask->bytes = (UInt16)bytes;
+    memcpy(mask->runs, gScratch, bytes);
+
+    SInt16 i = gFreeHead;
+    GlyphCacheEntry* e = &gEntries[i];
+    gFreeHead = e->lruNext;
+    e->strike = strike;
+    e->bitmap = strike->bitmapData;
+    e->ch = ch;
+    e->mask = mask;
+    e->hashNext = gBuckets[b];
+    gBuckets[b] = i;
+    LruPushFront(i);
+
+    gGlyphStats.glyphs++;
+    gGlyphStats.bytes += size;
+    return mask;
+}
+
+void QDGlyphCache_GetStats(QDGlyphCacheStats* stats) {
+    if (!stats) return;
+    if (!gCacheReady) {
+        GlyphCacheInit();
+    }
+    memcpy(stats, &gGlyphStats, sizeof(*stats));
+}
@@ -224,6 +224,9 @@ void InitGraf(void *globalPtr) {
     qd.thePort = &screenPort;
     SetPort(&screenPort);
 
+    QuickDraw_BlitSelfTest();
+    QuickDraw_RegionSelfTest();
+
     serial_puts("[QD] InitGraf complete\n");
 }
 
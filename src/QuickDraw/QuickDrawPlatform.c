@@ -7,8 +7,10 @@
 #include "MacTypes.h"
 #include "QuickDraw/QuickDraw.h"
 #include "QuickDraw/QuickDrawPlatform.h"
+#include "QuickDraw/QuickDrawInternal.h"  /* For RgnSpanIter */
 #include "QuickDrawConstants.h"  /* For paint, frame, erase, patCopy */
 #include "FontManager/FontTypes.h"  /* For FontStrike */
+#include "FontManager/TrueTypeRaster.h"  /* For FMGlyphBitmap */
 #include <stdlib.h>  /* For abs() */
 #include <math.h>
 #include "QuickDraw/QDLogging.h"
@@ -133,14 +135,9 @@ static inline Boolean QDPointInRoundRect(SInt32 x, SInt32 y, const Rect* rect,
     return (dx * dx + dy * dy) <= 1.0;
 }
 
-/* Check if a point is inside an arc */
-static inline Boolean QDPointInArc(SInt32 x, SInt32 y, const Rect* rect,
-                                   SInt16 startAngle, SInt16 arcAngle) {
-    /* First check if point is in the ellipse */
-    if (!QDPointInEllipse(x, y, rect)) {
-        return false;
-    }
-
+/* Check if a point of the arc's oval lies within its angles */
+static Boolean QDAngleInArc(SInt32 x, SInt32 y, const Rect* rect,
+                            SInt16 startAngle, SInt16 arcAngle) {
     /* Calculate center of ellipse */
     double cx = (rect->left + rect->right) / 2.0;
     double cy = (rect->top + rect->bottom) / 2.0;
@@ -183,8 +180,365 @@ static inline Boolean QDPointInArc(SInt32 x, SInt32 y, const Rect* rect,
     }
 }
 
+/* Check if a point is inside an arc */
+static inline Boolean QDPointInArc(SInt32 x, SInt32 y, const Rect* rect,
+                                   SInt16 startAngle, SInt16 arcAngle) {
+    return QDPointInEllipse(x, y, rect) && QDAngleInArc(x, y, rect, startAngle, arcAngle);
+}
+
+/*
+ * Span fill kernels.
+ *
+ * Filled shapes used to be drawn a pixel at a time through
+ * QDPlatform_SetPixel, which works out the port type, clips, and recomputes
+ * the pixel address on every call - an EraseRect of a full window was
+ * several hundred thousand of those, and ovals ran a floating-point
+ * ellipse test per pixel on top. Shapes are now filled a row span at a
+ * time: QDResolveTarget does SetPixel's port analysis once per shape, and
+ * the kernels below write whole spans.
+ *
+ * A pattern is expanded once per shape into eight rows of eight colours
+ * (QDPatternStrips). A row whose strip is one colour - black, white, any
+ * solid pattern - is a plain fill with 64-bit stores; other rows repeat the
+ * strip; invert and patXor XOR the strip into what is there.
+ */
+
+/* Where the current port's pixels are, as SetPixel would find them */
+typedef struct {
+    UInt8*  base;          /* the pixel at (originX, originY) */
+    SInt32  rowBytes;
+    SInt32  originX;
+    SInt32  originY;
+    SInt32  left, top, right, bottom;   /* writable area, drawing coordinates */
+} QDPixelTarget;
+
+typedef struct {
+    UInt32  color[8][8];   /* [y & 7][x & 7] */
+    Boolean solid[8];      /* the row is one colour */
+} QDPatternStrips;
+
+/* Two pixels at once; may alias the UInt32 view of the same memory */
+typedef UInt64 __attribute__((may_alias)) QDPixelPair;
+
+static Boolean QDResolveTarget(QDPixelTarget* t) {
+    extern GrafPtr g_currentPort;
+    extern CGrafPtr g_currentCPort;  /* from ColorQuickDraw.c */
+
+    Boolean isColorPort = (g_currentPort != NULL && g_currentCPort != NULL &&
+                           (GrafPtr)g_currentCPort == g_currentPort);
+
+    t->originX = 0;
+    t->originY = 0;
+    t->left = 0;
+    t->top = 0;
+
+    if (isColorPort) {
+        /* GWorld PixMap - local coordinates */
+        CGrafPtr cport = (CGrafPtr)g_currentPort;
+        if (!cport->portPixMap || !*cport->portPixMap) return false;
+        PixMapPtr pm = *cport->portPixMap;
+        if (!pm->baseAddr) return false;
+        t->base = (UInt8*)pm->baseAddr;
+        t->rowBytes = pm->rowBytes & 0x3FFF;
+        t->right = pm->bounds.right - pm->bounds.left;
+        t->bottom = pm->bounds.bottom - pm->bounds.top;
+    } else if (!g_currentPort || g_currentPort->portBits.baseAddr == (Ptr)framebuffer) {
+        /* The screen - global coordinates */
+        if (!framebuffer) return false;
+        t->base = (UInt8*)framebuffer;
+        t->rowBytes = (SInt32)fb_pitch;
+        t->right = (SInt32)fb_width;
+        t->bottom = (SInt32)fb_height;
+    } else {
+        /* Offscreen basic bitmap or Direct Framebuffer - global coordinates
+         * mapped through portBits.bounds, clipped to the portRect's size */
+        if (!g_currentPort->portBits.baseAddr) return false;
+        t->base = (UInt8*)g_currentPort->portBits.baseAddr;
+        t->rowBytes = g_currentPort->portBits.rowBytes & 0x3FFF;
+        t->originX = g_currentPort->portBits.bounds.left;
+        t->originY = g_currentPort->portBits.bounds.top;
+        t->left = t->originX;
+        t->top = t->originY;
+        t->right = t->originX + (g_currentPort->portRect.right - g_currentPort->portRect.left);
+        t->bottom = t->originY + (g_currentPort->portRect.bottom - g_currentPort->portRect.top);
+    }
+    return t->rowBytes > 0;
+}
+
+static void QDSolidStrips(QDPatternStrips* ps, UInt32 color) {
+    for (int row = 0; row < 8; row++) {
+        for (int col = 0; col < 8; col++) {
+            ps->color[row][col] = color;
+        }
+        ps->solid[row] = true;
+    }
+}
+
+/* The colours QDPlatform_SelectPatternColor would pick, for all 64 cells */
+static void QDBuildPatternStrips(QDPatternStrips* ps, GrafPtr port, const Pattern* pat,
+                                 UInt32 fallback) {
+    if (!pat) {
+        QDSolidStrips(ps, fallback);
+        return;
+    }
+
+    UInt32 fg = fallback;
+    UInt32 bg = pack_color(255, 255, 255);
+    if (port) {
+        fg = QDPlatform_MapQDColor(port->fgColor);
+        bg = QDPlatform_MapQDColor(port->bkColor);
+    }
+
+    for (int row = 0; row < 8; row++) {
+        UInt8 bits = pat->pat[row];
+        for (int col = 0; col < 8; col++) {
+            ps->color[row][col] = ((bits >> (7 - col)) & 1) ? fg : bg;
+        }
+        ps->solid[row] = (bits == 0x00 || bits == 0xFF || fg == bg);
+    }
+}
+
+static void QDStoreSolid(UInt32* dst, SInt32 count, UInt32 color) {
+    if (count > 0 && ((uintptr_t)dst & 4)) {
+        *dst++ = color;
+        count--;
+    }
+    QDPixelPair pair = ((UInt64)color << 32) | color;
+    QDPixelPair* d = (QDPixelPair*)(void*)dst;
+    while (count >= 8) {
+        d[0] = pair;
+        d[1] = pair;
+        d[2] = pair;
+        d[3] = pair;
+        d += 4;
+        count -= 8;
+    }
+    while (count >= 2) {
+        *d++ = pair;
+        count -= 2;
+    }
+    if (count) {
+        *(UInt32*)(void*)d = color;
+    }
+}
+
+static void QDStoreXor(UInt32* dst, SInt32 count, UInt32 mask) {
+    if (count > 0 && ((uintptr_t)dst & 4)) {
+        *dst++ ^= mask;
+        count--;
+    }
+    QDPixelPair pair = ((UInt64)mask << 32) | mask;
+    QDPixelPair* d = (QDPixelPair*)(void*)dst;
+    while (count >= 2) {
+        *d++ ^= pair;
+        count -= 2;
+    }
+    if (count) {
+        *(UInt32*)(void*)d ^= mask;
+    }
+}
+
+/* A patterned row: the strip rotated to the span's first column, then
+ * repeated eight pixels at a time */
+static void QDStoreStrip(UInt32* dst, SInt32 count, const UInt32* strip, SInt32 x,
+                         Boolean xorMode) {
+    UInt32 rot[8];
+    for (int k = 0; k < 8; k++) {
+        rot[k] = strip[(x + k) & 7];
+    }
+
+    SInt32 i = 0;
+    if (xorMode) {
+        for (; i + 8 <= count; i += 8) {
+            for (int k = 0; k < 8; k++) dst[i + k] ^= rot[k];
+        }
+        for (int k = 0; i < count; i++, k++) dst[i] ^= rot[k];
+    } else {
+        for (; i + 8 <= count; i += 8) {
+            for (int k = 0; k < 8; k++) dst[i + k] = rot[k];
+        }
+        for (int k = 0; i < count; i++, k++) dst[i] = rot[k];
+    }
+}
+
+/* Fill (or XOR) a rectangle of the target, in drawing coordinates */
+static void QDFillTargetRect(const QDPixelTarget* t, SInt32 left, SInt32 top,
+                             SInt32 right, SInt32 bottom,
+                             const QDPatternStrips* ps, Boolean xorMode) {
+    if (left < t->left) left = t->left;
+    if (top < t->top) top = t->top;
+    if (right > t->right) right = t->right;
+    if (bottom > t->bottom) bottom = t->bottom;
+    if (left >= right || top >= bottom) return;
+
+    SInt32 count = right - left;
+    UInt8* first = t->base + (top - t->originY) * t->rowBytes + (left - t->originX) * 4;
+    UInt8* row = first;
+
+    for (SInt32 y = top; y < bottom; y++, row += t->rowBytes) {
+        UInt32* dst = (UInt32*)(void*)row;
+        SInt32 py = y & 7;
+        if (ps->solid[py]) {
+            if (xorMode) {
+                QDStoreXor(dst, count, ps->color[py][0]);
+            } else {
+                QDStoreSolid(dst, count, ps->color[py][0]);
+            }
+        } else {
+            QDStoreStrip(dst, count, ps->color[py], left, xorMode);
+        }
+    }
+    QDPresent_MarkPixels(first, count, bottom - top);
+}
+
+/* An oval or a round rect: convex, so each row of it is one span */
+typedef struct {
+    const Rect* rect;
+    SInt16      radiusH;
+    SInt16      radiusV;
+    Boolean     round;
+} QDConvexShape;
+
+static Boolean QDConvexContains(const QDConvexShape* shape, SInt32 x, SInt32 y) {
+    return shape->round ? QDPointInRoundRect(x, y, shape->rect, shape->radiusH, shape->radiusV)
+                        : QDPointInEllipse(x, y, shape->rect);
+}
+
+/*
+ * The pixels of row y inside the shape, as [*outLeft, *outRight). The
+ * column nearest the centre is inside whenever any of the row is, and
+ * membership only changes once on each side of it, so two binary searches
+ * with the per-pixel test give exactly the pixels it would accept.
+ */
+static Boolean QDConvexRowSpan(const QDConvexShape* shape, SInt32 y,
+                               SInt32* outLeft, SInt32* outRight) {
+    SInt32 left = shape->rect->left;
+    SInt32 right = shape->rect->right;
+    if (right <= left) return false;
+
+    SInt32 mid = left + (right - left - 1) / 2;
+    if (!QDConvexContains(shape, mid, y)) return false;
+
+    SInt32 lo = left, hi = mid;
+    while (lo < hi) {
+        SInt32 m = lo + (hi - lo) / 2;
+        if (QDConvexContains(shape, m, y)) hi = m; else lo = m + 1;
+    }
+    *outLeft = lo;
+
+    lo = mid;
+    hi = right - 1;
+    while (lo < hi) {
+        SInt32 m = lo + (hi - lo + 1) / 2;
+        if (QDConvexContains(shape, m, y)) lo = m; else hi = m - 1;
+    }
+    *outRight = lo + 1;
+    return true;
+}
+
+/*
+ * cos and sin of a whole number of degrees. The freestanding cos/sin are
+ * Taylor series about 0 and are off by a few percent near 180 degrees;
+ * folding into the first octant first keeps them good to a small fraction
+ * of a pixel at any radius a screen can hold.
+ */
+static void QDDegreeDirection(SInt32 deg, double* outCos, double* outSin) {
+    deg %= 360;
+    if (deg < 0) deg += 360;
+
+    SInt32 quadrant = deg / 90;
+    SInt32 rest = deg % 90;
+    double c, s;
+    if (rest <= 45) {
+        double a = rest * M_PI / 180.0;
+        c = cos(a);
+        s = sin(a);
+    } else {
+        double a = (90 - rest) * M_PI / 180.0;
+        c = sin(a);
+        s = cos(a);
+    }
+    while (quadrant-- > 0) {
+        double t = c;   /* rotate a quarter turn counter-clockwise */
+        c = -s;
+        s = t;
+    }
+    *outCos = c;
+    *outSin = s;
+}
+
+/*
+ * Fill the part of oval row span [left, right) that lies in the arc's
+ * wedge. Along a row the angle from the centre changes monotonically, so
+ * membership changes only where the row crosses one of the two edge rays.
+ * Those columns are computed directly and the few pixels around each are
+ * tested one by one with QDAngleInArc; every stretch in between takes one
+ * test for all its pixels.
+ */
+static void QDFillArcRow(const QDPixelTarget* t, const Rect* rect,
+                         SInt16 startAngle, SInt16 arcAngle,
+                         SInt32 y, SInt32 left, SInt32 right,
+                         const QDPatternStrips* ps, Boolean xorMode) {
+    double cx = (rect->left + rect->right) / 2.0;
+    double cy = (rect->top + rect->bottom) / 2.0;
+    double dy = cy - (y + 0.5);
+    SInt32 winLeft[2], winRight[2];
+    int windows = 0;
+
+    for (int edge = 0; edge < 2; edge++) {
+        double c, s;
+        QDDegreeDirection(edge ? (SInt32)startAngle + arcAngle : startAngle, &c, &s);
+        if (fabs(s) < 1e-9) continue;   /* horizontal edge: no row crosses it */
+        double xs = cx - 0.5 + dy * c / s;
+        if (xs < left - 4 || xs > right + 4) continue;
+        SInt32 a = (SInt32)floor(xs) - 2;
+        SInt32 b = a + 5;
+        if (windows == 1 && a < winLeft[0]) {
+            winLeft[1] = winLeft[0];
+            winRight[1] = winRight[0];
+            winLeft[0] = a;
+            winRight[0] = b;
+        } else {
+            winLeft[windows] = a;
+            winRight[windows] = b;
+        }
+        windows++;
+    }
+
+    SInt32 runStart = -1;
+    SInt32 x = left;
+    int w = 0;
+    while (x < right) {
+        while (w < windows && winRight[w] <= x) w++;
+
+        SInt32 next;
+        Boolean in;
+        if (w < windows && x >= winLeft[w]) {
+            next = x + 1;
+            in = QDAngleInArc(x, y, rect, startAngle, arcAngle);
+        } else {
+            next = (w < windows && winLeft[w] < right) ? winLeft[w] : right;
+            in = QDAngleInArc(x + (next - x) / 2, y, rect, startAngle, arcAngle);
+        }
+
+        if (in) {
+            if (runStart < 0) runStart = x;
+        } else if (runStart >= 0) {
+            QDFillTargetRect(t, runStart, y, x, y + 1, ps, xorMode);
+            runStart = -1;
+        }
+        x = next;
+    }
+    if (runStart >= 0) {
+        QDFillTargetRect(t, runStart, y, right, y + 1, ps, xorMode);
+    }
+}
+
 /* Initialize platform layer */
 Boolean QDPlatform_Initialize(void) {
+    /* First: double-buffered, this moves "framebuffer" to the back buffer */
+    QDPresent_Init();
+
     g_platformFB.baseAddr = framebuffer;
     g_platformFB.width = fb_width;
     g_platformFB.height = fb_height;
@@ -212,34 +566,22 @@ void QDPlatform_UnlockFramebuffer(PlatformFramebuffer* fb) {
     /* No locking needed in our simple implementation */
 }
 
-/* VGA status register port for vsync detection */
-#define VGA_INPUT_STATUS_1 0x3DA
-#define VGA_VRETRACE_BIT 0x08
-
-#include "Platform/include/io.h"
-
-/* Inline assembly helpers for VGA I/O */
-#define inb_vga(port) hal_inb(port)
-
-/* Wait for VGA vertical retrace (vsync) to ensure screen update */
-/* Update screen region */
+/*
+ * Screen update.
+ *
+ * Both of these used to spin on fifty reads of the VGA input status
+ * register and do nothing else. They now go through the presentation layer
+ * (ScreenPresent.c): UpdateScreen marks the rectangle and presents if a
+ * frame is due; FlushScreen waits for the next frame slot on the timer and
+ * presents everything marked.
+ */
 void QDPlatform_UpdateScreen(SInt32 left, SInt32 top, SInt32 right, SInt32 bottom) {
-    /* Minimal delay to allow QEMU display refresh - faster than full vsync */
-    volatile int delay;
-    for (delay = 0; delay < 50; delay++) {
-        /* Read VGA status register to yield CPU time to QEMU */
-        (void)inb_vga(VGA_INPUT_STATUS_1);
-    }
+    QDPresent_MarkDirty(left, top, right, bottom);
+    QDPresent_Frame(false);
 }
 
-/* Flush entire screen */
 void QDPlatform_FlushScreen(void) {
-    /* Minimal delay to allow QEMU display refresh - faster than full vsync */
-    volatile int delay;
-    for (delay = 0; delay < 50; delay++) {
-        /* Read VGA status register to yield CPU time to QEMU */
-        (void)inb_vga(VGA_INPUT_STATUS_1);
-    }
+    QDPresent_Frame(true);
 }
 
 /* Set a pixel */
@@ -253,6 +595,7 @@ void QDPlatform_SetPixel(SInt32 x, SInt32 y, UInt32 color) {
         if (x < 0 || x >= fb_width || y < 0 || y >= fb_height) return;
         uint32_t* pixel = (uint32_t*)((uint8_t*)framebuffer + y * fb_pitch + x * 4);
         *pixel = color;
+        QDPresent_MarkDirty(x, y, x + 1, y + 1);
         return;
     }
 
@@ -283,6 +626,7 @@ void QDPlatform_SetPixel(SInt32 x, SInt32 y, UInt32 color) {
             if (x < 0 || x >= fb_width || y < 0 || y >= fb_height) return;
             uint32_t* pixel = (uint32_t*)((uint8_t*)framebuffer + y * fb_pitch + x * 4);
             *pixel = color;
+            QDPresent_MarkDirty(x, y, x + 1, y + 1);
         } else {
             /* Drawing to offscreen basic bitmap (e.g., window GWorld backing or Direct Framebuffer) */
             Ptr baseAddr = g_currentPort->portBits.baseAddr;
@@ -316,6 +660,7 @@ void QDPlatform_SetPixel(SInt32 x, SInt32 y, UInt32 color) {
 
             uint32_t* pixel = (uint32_t*)((uint8_t*)baseAddr + localY * rowBytes + localX * 4);
             *pixel = color;
+            QDPresent_MarkPixels(pixel, 1, 1);   /* a Direct Framebuffer port is on screen */
             /* Do not fall back to framebuffer when drawing to offscreen port */
             return;
         }
@@ -407,11 +752,10 @@ Boolean QDPlatform_FillRectAccelerated(SInt32 left, SInt32 top, SInt32 right, SI
     if (bottom > fb_height) bottom = fb_height;
 
     for (SInt32 y = top; y < bottom; y++) {
-        for (SInt32 x = left; x < right; x++) {
-            uint32_t* pixel = (uint32_t*)((uint8_t*)framebuffer + y * fb_pitch + x * 4);
-            *pixel = color;
-        }
+        QDStoreSolid((UInt32*)(void*)((uint8_t*)framebuffer + y * fb_pitch + left * 4),
+                     right - left, color);
     }
+    QDPresent_MarkDirty(left, top, right, bottom);
 
     return true;
 }
@@ -514,6 +858,38 @@ void QDPlatform_DrawLine(GrafPtr port, Point startPt, Point endPt,
 /* For Pattern Manager color patterns */
 extern bool PM_GetColorPattern(uint32_t** patternData);
 
+/* Paint, fill, erase or invert one rectangle of a rect shape, global coordinates */
+static void QDFillRectShape(GrafPtr port, GrafVerb verb, const Rect* rect, const Pattern* pat) {
+    QDPixelTarget target;
+    QDPatternStrips strips;
+    Boolean xorMode = false;
+
+    if (verb == paint) {
+        /* Fill rectangle with pattern or black */
+        QDBuildPatternStrips(&strips, port, pat, pack_color(0, 0, 0));
+    } else if (verb == fill) {
+        /* Fill with pattern using port foreground/background colors */
+        if (!pat) return;
+        QDBuildPatternStrips(&strips, port, pat, pack_color(0, 0, 0));
+    } else if (verb == erase) {
+        /* Erase should use port's background pattern, NOT desktop pattern;
+         * no pattern - fill with white */
+        QDBuildPatternStrips(&strips, port, pat, pack_color(255, 255, 255));
+    } else if (verb == invert) {
+        /* XOR pixels with white for authentic Mac OS invert/XOR feedback */
+        QD_LOG_TRACE("QDPlatform_DrawShape: Inverting rect (%d,%d,%d,%d)\n",
+                      rect->left, rect->top, rect->right, rect->bottom);
+        QDSolidStrips(&strips, 0x00FFFFFF);
+        xorMode = true;
+    } else {
+        return;
+    }
+
+    if (!QDResolveTarget(&target)) return;
+    QDFillTargetRect(&target, rect->left, rect->top, rect->right, rect->bottom,
+                     &strips, xorMode);
+}
+
 /* Draw a shape using platform capabilities - called from QuickDrawCore */
 void QDPlatform_DrawShape(GrafPtr port, GrafVerb verb, const Rect* rect,
                          SInt16 shapeType, const Pattern* pat,
@@ -531,38 +907,7 @@ void QDPlatform_DrawShape(GrafPtr port, GrafVerb verb, const Rect* rect,
 
     /* For now, just draw rectangles */
     if (shapeType == 0) {  /* Rectangle */
-        if (verb == paint) {
-            /* Fill rectangle with pattern or black */
-            if (pat) {
-                /* Draw with pattern */
-                for (SInt32 y = rect->top; y < rect->bottom; y++) {
-                    for (SInt32 x = rect->left; x < rect->right; x++) {
-                        UInt32 color = QDPlatform_SelectPatternColor(port, pat, x, y,
-                                                                      pack_color(0, 0, 0));
-                        QDPlatform_SetPixel(x + offsetX, y + offsetY, color);
-                    }
-                }
-            } else {
-                /* No pattern - fill with black */
-                UInt32 color = pack_color(0, 0, 0);
-                for (SInt32 y = rect->top; y < rect->bottom; y++) {
-                    for (SInt32 x = rect->left; x < rect->right; x++) {
-                        QDPlatform_SetPixel(x + offsetX, y + offsetY, color);
-                    }
-                }
-            }
-        } else if (verb == fill) {
-            /* Fill with pattern using port foreground/background colors */
-            if (pat) {
-                for (SInt32 y = rect->top; y < rect->bottom; y++) {
-                    for (SInt32 x = rect->left; x < rect->right; x++) {
-                        UInt32 color = QDPlatform_SelectPatternColor(port, pat, x, y,
-                                                                      pack_color(0, 0, 0));
-                        QDPlatform_SetPixel(x + offsetX, y + offsetY, color);
-                    }
-                }
-            }
-        } else if (verb == frame) {
+        if (verb == frame) {
             /* Draw rectangle outline using port's pen mode */
             /* CRITICAL: Point is {v, h} not {h, v}! */
             Point tl = {rect->top, rect->left};
@@ -575,100 +920,82 @@ void QDPlatform_DrawShape(GrafPtr port, GrafVerb verb, const Rect* rect,
             QDPlatform_DrawLine(port, tr, br, pat, mode);
             QDPlatform_DrawLine(port, br, bl, pat, mode);
             QDPlatform_DrawLine(port, bl, tl, pat, mode);
-        } else if (verb == erase) {
-            /* Erase should use port's background pattern, NOT desktop pattern */
-            if (pat) {
-                /* Use 1-bit pattern with port background color */
-                for (SInt32 y = rect->top; y < rect->bottom; y++) {
-                    for (SInt32 x = rect->left; x < rect->right; x++) {
-                        UInt32 color = QDPlatform_SelectPatternColor(port, pat, x, y,
-                                                                      pack_color(255, 255, 255));
-                        QDPlatform_SetPixel(x + offsetX, y + offsetY, color);
-                    }
-                }
-            } else {
-                /* No pattern - fill with white */
-                UInt32 color = pack_color(255, 255, 255);
-                for (SInt32 y = rect->top; y < rect->bottom; y++) {
-                    for (SInt32 x = rect->left; x < rect->right; x++) {
-                        QDPlatform_SetPixel(x + offsetX, y + offsetY, color);
-                    }
-                }
-            }
-        } else if (verb == invert) {
-            /* XOR pixels with white for authentic Mac OS invert/XOR feedback */
-            QD_LOG_TRACE("QDPlatform_DrawShape: Inverting rect (%d,%d,%d,%d)\n",
-                          rect->left, rect->top, rect->right, rect->bottom);
-            for (SInt32 y = rect->top; y < rect->bottom; y++) {
-                for (SInt32 x = rect->left; x < rect->right; x++) {
-                    /* Get current pixel color */
-                    UInt32 current = QDPlatform_GetPixel(x + offsetX, y + offsetY);
-                    /* XOR with white to invert */
-                    UInt32 inverted = current ^ 0x00FFFFFF;
-                    QDPlatform_SetPixel(x + offsetX, y + offsetY, inverted);
+        } else {
+            /* The rect arrives clipped to the clipRgn's bounding box only. For
+             * a basic port both are global, so the fill goes a span at a time
+             * through the region itself and leaves what it excludes alone.
+             * GWorld rects are local to the pixmap; those keep the bbox clip. */
+            extern CGrafPtr g_currentCPort;
+            Boolean isColorPort = (g_currentCPort != NULL && (GrafPtr)g_currentCPort == port);
+            RgnHandle clip = (port && !isColorPort) ? port->clipRgn : NULL;
+
+            RgnSpanIter it;
+            RgnSpanBegin(&it, rect, clip, NULL, NULL, false);
+            while (RgnSpanNext(&it)) {
+                for (SInt16 k = 0; k < it.count; k++) {
+                    Rect span;
+                    SetRect(&span, it.spans[k].left, it.top, it.spans[k].right, it.bottom);
+                    QDFillRectShape(port, verb, &span, pat);
                 }
             }
         }
     } else if (shapeType == 1) {  /* Oval */
+        QDConvexShape oval = { rect, 0, 0, false };
+        QDPixelTarget target;
+        QDPatternStrips strips;
+        SInt32 l, r;
+
+        if (!QDResolveTarget(&target)) return;
+
         if (verb == paint || verb == fill || verb == erase) {
             UInt32 fallbackColor = (verb == erase) ? pack_color(255, 255, 255)
                                                    : pack_color(0, 0, 0);
+            QDBuildPatternStrips(&strips, port, pat, fallbackColor);
             for (SInt32 y = rect->top; y < rect->bottom; y++) {
-                if (y < 0 || y >= (SInt32)fb_height) continue;
-                for (SInt32 x = rect->left; x < rect->right; x++) {
-                    if (x < 0 || x >= (SInt32)fb_width) continue;
-                    if (!QDPointInEllipse(x, y, rect)) continue;
-
-                    UInt32 color = fallbackColor;
-                    if (pat) {
-                        color = QDPlatform_SelectPatternColor(port, pat, x, y, fallbackColor);
-                    }
-
-                    QDPlatform_SetPixel(x + offsetX, y + offsetY, color);
+                if (QDConvexRowSpan(&oval, y, &l, &r)) {
+                    QDFillTargetRect(&target, l, y, r, y + 1, &strips, false);
                 }
             }
         } else if (verb == frame) {
+            /* The outline is the pixels of each row's span that have a
+             * neighbour outside: everything but the part of the row that is
+             * also inside the rows above and below. Each outline run is
+             * stamped pen-size, the pattern tiling from the pixel written as
+             * it does for every other shape. */
+            SInt16 penW = port ? (port->pnSize.h > 1 ? port->pnSize.h : 1) : 1;
+            SInt16 penH = port ? (port->pnSize.v > 1 ? port->pnSize.v : 1) : 1;
+            QDBuildPatternStrips(&strips, port, pat, pack_color(0, 0, 0));
+
             for (SInt32 y = rect->top; y < rect->bottom; y++) {
-                if (y < 0 || y >= (SInt32)fb_height) continue;
-                for (SInt32 x = rect->left; x < rect->right; x++) {
-                    if (x < 0 || x >= (SInt32)fb_width) continue;
-                    if (!QDPointInEllipse(x, y, rect)) continue;
-
-                    Boolean neighborOutside =
-                        !QDPointInEllipse(x - 1, y, rect) ||
-                        !QDPointInEllipse(x + 1, y, rect) ||
-                        !QDPointInEllipse(x, y - 1, rect) ||
-                        !QDPointInEllipse(x, y + 1, rect);
-
-                    if (neighborOutside) {
-                        UInt32 color = QDPlatform_SelectPatternColor(port, pat, x, y,
-                                                                      pack_color(0, 0, 0));
-                        /* Apply pen size: also fill nearby pixels for thick outlines */
-                        SInt16 penW = port ? (port->pnSize.h > 1 ? port->pnSize.h : 1) : 1;
-                        SInt16 penH = port ? (port->pnSize.v > 1 ? port->pnSize.v : 1) : 1;
-                        for (SInt16 py = 0; py < penH; py++) {
-                            for (SInt16 px = 0; px < penW; px++) {
-                                SInt32 dx = x + px + offsetX;
-                                SInt32 dy = y + py + offsetY;
-                                if (dx >= 0 && dx < (SInt32)fb_width &&
-                                    dy >= 0 && dy < (SInt32)fb_height) {
-                                    QDPlatform_SetPixel(dx, dy, color);
-                                }
-                            }
-                        }
-                    }
+                if (!QDConvexRowSpan(&oval, y, &l, &r)) continue;
+
+                SInt32 innerL = l + 1, innerR = r - 1;
+                SInt32 nl, nr;
+                if (QDConvexRowSpan(&oval, y - 1, &nl, &nr)) {
+                    if (nl > innerL) innerL = nl;
+                    if (nr < innerR) innerR = nr;
+                } else {
+                    innerR = innerL;
+                }
+                if (QDConvexRowSpan(&oval, y + 1, &nl, &nr)) {
+                    if (nl > innerL) innerL = nl;
+                    if (nr < innerR) innerR = nr;
+                } else {
+                    innerR = innerL;
+                }
+
+                if (innerL >= innerR) {
+                    QDFillTargetRect(&target, l, y, r + penW - 1, y + penH, &strips, false);
+                } else {
+                    QDFillTargetRect(&target, l, y, innerL + penW - 1, y + penH, &strips, false);
+                    QDFillTargetRect(&target, innerR, y, r + penW - 1, y + penH, &strips, false);
                 }
             }
         } else if (verb == invert) {
+            QDSolidStrips(&strips, 0x00FFFFFF);
             for (SInt32 y = rect->top; y < rect->bottom; y++) {
-                if (y < 0 || y >= (SInt32)fb_height) continue;
-                for (SInt32 x = rect->left; x < rect->right; x++) {
-                    if (x < 0 || x >= (SInt32)fb_width) continue;
-                    if (!QDPointInEllipse(x, y, rect)) continue;
-
-                    UInt32 current = QDPlatform_GetPixel(x + offsetX, y + offsetY);
-                    UInt32 inverted = current ^ 0x00FFFFFF;
-                    QDPlatform_SetPixel(x + offsetX, y + offsetY, inverted);
+                if (QDConvexRowSpan(&oval, y, &l, &r)) {
+                    QDFillTargetRect(&target, l, y, r, y + 1, &strips, true);
                 }
             }
         }
@@ -687,31 +1014,22 @@ void QDPlatform_DrawShape(GrafPtr port, GrafVerb verb, const Rect* rect,
         if (radiusV > height / 2) radiusV = height / 2;
 
         SInt16 mode = port ? port->pnMode : patCopy;
+        QDConvexShape outer = { rect, radiusH, radiusV, true };
+        QDPixelTarget target;
+        QDPatternStrips strips;
+        SInt32 l, r;
+
+        if (!QDResolveTarget(&target)) return;
 
         if (verb == paint || verb == fill || verb == erase) {
             UInt32 fallbackColor = (verb == erase) ? pack_color(255, 255, 255)
                                                    : pack_color(0, 0, 0);
-            for (SInt32 y = rect->top; y < rect->bottom; y++) {
-                if (y < 0 || y >= (SInt32)fb_height) continue;
-                for (SInt32 x = rect->left; x < rect->right; x++) {
-                    if (x < 0 || x >= (SInt32)fb_width) continue;
-                    if (!QDPointInRoundRect(x, y, rect, radiusH, radiusV)) {
-                        continue;
-                    }
-
-                    UInt32 color = pat ? QDPlatform_SelectPatternColor(port, pat, x, y, fallbackColor)
-                                       : fallbackColor;
+            QDBuildPatternStrips(&strips, port, pat, fallbackColor);
+            Boolean xorMode = (mode == patXor && verb == paint);
 
-                    if (verb == erase && pat == NULL) {
-                        color = pack_color(255, 255, 255);
-                    }
-
-                    if (mode == patXor && verb == paint) {
-                        UInt32 current = QDPlatform_GetPixel(x + offsetX, y + offsetY);
-                        color = current ^ color;
-                    }
-
-                    QDPlatform_SetPixel(x + offsetX, y + offsetY, color);
+            for (SInt32 y = rect->top; y < rect->bottom; y++) {
+                if (QDConvexRowSpan(&outer, y, &l, &r)) {
+                    QDFillTargetRect(&target, l, y, r, y + 1, &strips, xorMode);
                 }
             }
         } else if (verb == frame) {
@@ -737,42 +1055,27 @@ void QDPlatform_DrawShape(GrafPtr port, GrafVerb verb, const Rect* rect,
 
             Boolean hasInterior = (innerRect.right > innerRect.left &&
                                    innerRect.bottom > innerRect.top);
+            QDConvexShape inner = { &innerRect, innerRadiusH, innerRadiusV, true };
 
-            for (SInt32 y = rect->top; y < rect->bottom; y++) {
-                if (y < 0 || y >= (SInt32)fb_height) continue;
-                for (SInt32 x = rect->left; x < rect->right; x++) {
-                    if (x < 0 || x >= (SInt32)fb_width) continue;
-                    if (!QDPointInRoundRect(x, y, rect, radiusH, radiusV)) {
-                        continue;
-                    }
-                    if (hasInterior &&
-                        QDPointInRoundRect(x, y, &innerRect, innerRadiusH, innerRadiusV)) {
-                        continue;
-                    }
+            QDBuildPatternStrips(&strips, port, pat, pack_color(0, 0, 0));
+            Boolean xorMode = (mode == patXor);
 
-                    UInt32 color = QDPlatform_SelectPatternColor(port, pat, x, y,
-                                                                  pack_color(0, 0, 0));
-
-                    if (mode == patXor) {
-                        UInt32 current = QDPlatform_GetPixel(x + offsetX, y + offsetY);
-                        color = current ^ color;
-                    }
+            for (SInt32 y = rect->top; y < rect->bottom; y++) {
+                if (!QDConvexRowSpan(&outer, y, &l, &r)) continue;
 
-                    QDPlatform_SetPixel(x + offsetX, y + offsetY, color);
+                SInt32 il, ir;
+                if (hasInterior && QDConvexRowSpan(&inner, y, &il, &ir)) {
+                    QDFillTargetRect(&target, l, y, il, y + 1, &strips, xorMode);
+                    QDFillTargetRect(&target, ir, y, r, y + 1, &strips, xorMode);
+                } else {
+                    QDFillTargetRect(&target, l, y, r, y + 1, &strips, xorMode);
                 }
             }
         } else if (verb == invert) {
+            QDSolidStrips(&strips, 0x00FFFFFF);
             for (SInt32 y = rect->top; y < rect->bottom; y++) {
-                if (y < 0 || y >= (SInt32)fb_height) continue;
-                for (SInt32 x = rect->left; x < rect->right; x++) {
-                    if (x < 0 || x >= (SInt32)fb_width) continue;
-                    if (!QDPointInRoundRect(x, y, rect, radiusH, radiusV)) {
-                        continue;
-                    }
-
-                    UInt32 current = QDPlatform_GetPixel(x + offsetX, y + offsetY);
-                    UInt32 inverted = current ^ 0x00FFFFFF;
-                    QDPlatform_SetPixel(x + offsetX, y + offsetY, inverted);
+                if (QDConvexRowSpan(&outer, y, &l, &r)) {
+                    QDFillTargetRect(&target, l, y, r, y + 1, &strips, true);
                 }
             }
         }
@@ -782,40 +1085,39 @@ void QDPlatform_DrawShape(GrafPtr port, GrafVerb verb, const Rect* rect,
         SInt16 arcAngle = ovalHeight;
 
         SInt16 mode = port ? port->pnMode : patCopy;
+        QDConvexShape oval = { rect, 0, 0, false };
+        QDPixelTarget target;
+        QDPatternStrips strips;
+        SInt32 l, r;
+
+        if (verb == paint || verb == fill || verb == erase || verb == invert) {
+            Boolean xorMode;
+            if (verb == invert) {
+                QDSolidStrips(&strips, 0x00FFFFFF);
+                xorMode = true;
+            } else {
+                UInt32 fallbackColor = (verb == erase) ? pack_color(255, 255, 255)
+                                                       : pack_color(0, 0, 0);
+                QDBuildPatternStrips(&strips, port, pat, fallbackColor);
+                xorMode = (mode == patXor && verb == paint);
+            }
 
-        if (verb == paint || verb == fill || verb == erase) {
-            UInt32 fallbackColor = (verb == erase) ? pack_color(255, 255, 255)
-                                                   : pack_color(0, 0, 0);
+            if (!QDResolveTarget(&target)) return;
             for (SInt32 y = rect->top; y < rect->bottom; y++) {
-                if (y < 0 || y >= (SInt32)fb_height) continue;
-                for (SInt32 x = rect->left; x < rect->right; x++) {
-                    if (x < 0 || x >= (SInt32)fb_width) continue;
-                    if (!QDPointInArc(x, y, rect, startAngle, arcAngle)) {
-                        continue;
-                    }
-
-                    UInt32 color = pat ? QDPlatform_SelectPatternColor(port, pat, x, y, fallbackColor)
-                                       : fallbackColor;
-
-                    if (verb == erase && pat == NULL) {
-                        color = pack_color(255, 255, 255);
-                    }
-
-                    if (mode == patXor && verb == paint) {
-                        UInt32 current = QDPlatform_GetPixel(x + offsetX, y + offsetY);
-                        color = current ^ color;
-                    }
-
-                    QDPlatform_SetPixel(x + offsetX, y + offsetY, color);
+                if (QDConvexRowSpan(&oval, y, &l, &r)) {
+                    QDFillArcRow(&target, rect, startAngle, arcAngle, y, l, r,
+                                 &strips, xorMode);
                 }
             }
         } else if (verb == frame) {
-            /* Frame the arc - draw outline only */
+            /* Frame the arc - draw outline only. FrameArc is rare enough to
+             * keep the per-pixel edge test, but only across the oval's span. */
             for (SInt32 y = rect->top; y < rect->bottom; y++) {
                 if (y < 0 || y >= (SInt32)fb_height) continue;
-                for (SInt32 x = rect->left; x < rect->right; x++) {
+                if (!QDConvexRowSpan(&oval, y, &l, &r)) continue;
+                for (SInt32 x = l; x < r; x++) {
                     if (x < 0 || x >= (SInt32)fb_width) continue;
-                    if (!QDPointInArc(x, y, rect, startAngle, arcAngle)) {
+                    if (!QDAngleInArc(x, y, rect, startAngle, arcAngle)) {
                         continue;
                     }
 
@@ -843,20 +1145,6 @@ void QDPlatform_DrawShape(GrafPtr port, GrafVerb verb, const Rect* rect,
                     QDPlatform_SetPixel(x + offsetX, y + offsetY, color);
                 }
             }
-        } else if (verb == invert) {
-            for (SInt32 y = rect->top; y < rect->bottom; y++) {
-                if (y < 0 || y >= (SInt32)fb_height) continue;
-                for (SInt32 x = rect->left; x < rect->right; x++) {
-                    if (x < 0 || x >= (SInt32)fb_width) continue;
-                    if (!QDPointInArc(x, y, rect, startAngle, arcAngle)) {
-                        continue;
-                    }
-
-                    UInt32 current = QDPlatform_GetPixel(x + offsetX, y + offsetY);
-                    UInt32 inverted = current ^ 0x00FFFFFF;
-                    QDPlatform_SetPixel(x + offsetX, y + offsetY, inverted);
-                }
-            }
         }
     }
 }
@@ -982,6 +1270,99 @@ void QDPlatform_NativeToRGB(UInt32 native, UInt16* red, UInt16* green, UInt16* b
     if (green) *green = ((native >> 8) & 0xFF) * 257;
     if (blue) *blue = (native & 0xFF) * 257;
 }
+
+/* One rectangle of QDPlatform_DrawRegion, already in the coordinates drawn in */
+static void QDDrawRegionPiece(GrafPtr port, short mode, const Pattern* pat, const Rect* piece,
+                              int isDirectFB, uint32_t* colorPattern) {
+    /* Handle erase mode with Pattern Manager color patterns */
+    if (mode == erase) {
+        if (colorPattern) {
+            /* Use color pattern - tile 8x8 across region bounds */
+            int left = (piece->left < 0) ? 0 : piece->left;
+            int top = (piece->top < 0) ? 0 : piece->top;
+            int right = (piece->right > fb_width) ? fb_width : piece->right;
+            int bottom = (piece->bottom > fb_height) ? fb_height : piece->bottom;
+
+            /* The 8x8 tile, ARGB to native, keyed on absolute screen position */
+            QDPatternStrips strips;
+            for (int row = 0; row < 8; row++) {
+                Boolean solid = true;
+                for (int col = 0; col < 8; col++) {
+                    uint32_t patColor = colorPattern[row * 8 + col];
+                    strips.color[row][col] = pack_color((patColor >> 16) & 0xFF,
+                                                        (patColor >> 8) & 0xFF,
+                                                        patColor & 0xFF);
+                    if (strips.color[row][col] != strips.color[row][0]) solid = false;
+                }
+                strips.solid[row] = solid;
+            }
+
+            QDPixelTarget screen;
+            screen.base = (UInt8*)framebuffer;
+            screen.rowBytes = (SInt32)fb_pitch;
+            screen.originX = 0;
+            screen.originY = 0;
+            screen.left = 0;
+            screen.top = 0;
+            screen.right = (SInt32)fb_width;
+            screen.bottom = (SInt32)fb_height;
+            QDFillTargetRect(&screen, left, top, right, bottom, &strips, false);
+            return;
+        }
+    }
+
+    /* For other modes or if pattern not available, use simple rect operations */
+    if (mode == erase) {
+        extern void EraseRect(const Rect* r);
+        EraseRect(piece);
+    } else if (mode == paint && pat) {
+        /* Simple paint with pattern using port colors */
+        QDFillRectShape(port, paint, piece, pat);
+    } else if (mode == fill && pat) {
+        /* Fill region with pattern */
+        /* Clamp to local bounds */
+        int left = (piece->left < 0) ? 0 : piece->left;
+        int top = (piece->top < 0) ? 0 : piece->top;
+
+        /* Check if using Direct Framebuffer (baseAddr offset from framebuffer) */
+        int right, bottom;
+        if (port && port->portBits.baseAddr != (Ptr)framebuffer) {
+            /* LOCAL coordinates - clamp to window size */
+            int localWidth = port->portBits.bounds.right - port->portBits.bounds.left;
+            int localHeight = port->portBits.bounds.bottom - port->portBits.bounds.top;
+            right = (piece->right > localWidth) ? localWidth : piece->right;
+            bottom = (piece->bottom > localHeight) ? localHeight : piece->bottom;
+        } else {
+            /* GLOBAL coordinates - clamp to screen */
+            right = (piece->right > fb_width) ? fb_width : piece->right;
+            bottom = (piece->bottom > fb_height) ? fb_height : piece->bottom;
+        }
+
+        for (int y = top; y < bottom; y++) {
+            for (int x = left; x < right; x++) {
+                /* Use position for pattern tiling (8x8 repeat) */
+                uint32_t color = QDPlatform_SelectPatternColor(port, pat, x, y,
+                                                              pack_color(0, 0, 0));
+
+                /* Write to appropriate location */
+                if (isDirectFB) {
+                    /* Direct Framebuffer: use window's baseAddr + local offset */
+                    uint32_t* pixel = (uint32_t*)((uint8_t*)port->portBits.baseAddr + y * fb_pitch + x * 4);
+                    *pixel = color;
+                } else {
+                    /* Regular framebuffer: calculate global position */
+                    uint32_t* pixel = (uint32_t*)((uint8_t*)framebuffer + y * fb_pitch + x * 4);
+                    *pixel = color;
+                }
+            }
+        }
+        if (left < right && top < bottom) {
+            uint8_t* first = isDirectFB ? (uint8_t*)port->portBits.baseAddr : (uint8_t*)framebuffer;
+            QDPresent_MarkPixels(first + top * fb_pitch + left * 4, right - left, bottom - top);
+        }
+    }
+}
+
 /* QuickDraw Platform region drawing implementation */
 /* Renders region outline/fill based on mode */
 void QDPlatform_DrawRegion(RgnHandle rgn, short mode, const Pattern* pat) {
@@ -1009,6 +1390,7 @@ void QDPlatform_DrawRegion(RgnHandle rgn, short mode, const Pattern* pat) {
     extern QDGlobals qd;
     GrafPtr port = qd.thePort;
     int isDirectFB = 0;
+    int originX = 0, originY = 0;
     if (port && port->portBits.baseAddr != (Ptr)framebuffer) {
         /* This port has a baseAddr offset from framebuffer (Direct Framebuffer approach)
          * Convert GLOBAL region coordinates to LOCAL coordinates */
@@ -1027,6 +1409,8 @@ void QDPlatform_DrawRegion(RgnHandle rgn, short mode, const Pattern* pat) {
         extern uint32_t fb_pitch;
         int globalY = byteOffset / fb_pitch;
         int globalX = (byteOffset % fb_pitch) / 4;  /* 4 bytes per pixel */
+        originX = globalX;
+        originY = globalY;
 
         extern void serial_puts(const char *str);
         extern int snprintf(char* buf, size_t size, const char* fmt, ...);
@@ -1074,88 +1458,32 @@ void QDPlatform_DrawRegion(RgnHandle rgn, short mode, const Pattern* pat) {
         }
     }
 
+    /* Fill what is inside the region - and inside the port's clipRgn, for a
+     * port drawn in global coordinates - a band of spans at a time, not its
+     * bounding box. The spans are found in global coordinates and moved to
+     * local ones for a Direct Framebuffer port. */
+    Rect bounds;
+    SetRect(&bounds, r.left + originX, r.top + originY,
+            r.right + originX, r.bottom + originY);
+    RgnHandle clip = (port && !isDirectFB) ? port->clipRgn : NULL;
+
     /* Handle erase mode with Pattern Manager color patterns */
+    uint32_t* colorPattern = NULL;
     if (mode == erase) {
         extern bool PM_GetColorPattern(uint32_t** patternData);
-        uint32_t* colorPattern = NULL;
-
-        if (PM_GetColorPattern(&colorPattern)) {
-            /* Use color pattern - tile 8x8 across region bounds */
-            int left = (r.left < 0) ? 0 : r.left;
-            int top = (r.top < 0) ? 0 : r.top;
-            int right = (r.right > fb_width) ? fb_width : r.right;
-            int bottom = (r.bottom > fb_height) ? fb_height : r.bottom;
-
-            for (int y = top; y < bottom; y++) {
-                for (int x = left; x < right; x++) {
-                    /* Get pattern pixel (8x8 tile) using absolute screen position */
-                    int patRow = y & 7;
-                    int patCol = x & 7;
-                    uint32_t patColor = colorPattern[patRow * 8 + patCol];
-
-                    /* Extract RGB from ARGB */
-                    uint8_t red = (patColor >> 16) & 0xFF;
-                    uint8_t green = (patColor >> 8) & 0xFF;
-                    uint8_t blue = patColor & 0xFF;
-
-                    uint32_t* pixel = (uint32_t*)((uint8_t*)framebuffer + y * fb_pitch + x * 4);
-                    *pixel = pack_color(red, green, blue);
-                }
-            }
-            return;
+        if (!PM_GetColorPattern(&colorPattern)) {
+            colorPattern = NULL;
         }
     }
 
-    /* For other modes or if pattern not available, use simple rect operations */
-    if (mode == erase) {
-        extern void EraseRect(const Rect* r);
-        EraseRect(&r);
-    } else if (mode == paint && pat) {
-        /* Simple paint with pattern using port colors */
-        for (int y = r.top; y < r.bottom; y++) {
-            for (int x = r.left; x < r.right; x++) {
-                uint32_t color = QDPlatform_SelectPatternColor(port, pat, x, y,
-                                                                pack_color(0, 0, 0));
-                QDPlatform_SetPixel(x, y, color);
-            }
-        }
-    } else if (mode == fill && pat) {
-        /* Fill region with pattern */
-        /* Clamp to local bounds */
-        int left = (r.left < 0) ? 0 : r.left;
-        int top = (r.top < 0) ? 0 : r.top;
-
-        /* Check if using Direct Framebuffer (baseAddr offset from framebuffer) */
-        int right, bottom;
-        if (port && port->portBits.baseAddr != (Ptr)framebuffer) {
-            /* LOCAL coordinates - clamp to window size */
-            int localWidth = port->portBits.bounds.right - port->portBits.bounds.left;
-            int localHeight = port->portBits.bounds.bottom - port->portBits.bounds.top;
-            right = (r.right > localWidth) ? localWidth : r.right;
-            bottom = (r.bottom > localHeight) ? localHeight : r.bottom;
-        } else {
-            /* GLOBAL coordinates - clamp to screen */
-            right = (r.right > fb_width) ? fb_width : r.right;
-            bottom = (r.bottom > fb_height) ? fb_height : r.bottom;
-        }
-
-        for (int y = top; y < bottom; y++) {
-            for (int x = left; x < right; x++) {
-                /* Use position for pattern tiling (8x8 repeat) */
-                uint32_t color = QDPlatform_SelectPatternColor(port, pat, x, y,
-                                                              pack_color(0, 0, 0));
-
-                /* Write to appropriate location */
-                if (isDirectFB) {
-                    /* Direct Framebuffer: use window's baseAddr + local offset */
-                    uint32_t* pixel = (uint32_t*)((uint8_t*)port->portBits.baseAddr + y * fb_pitch + x * 4);
-                    *pixel = color;
-                } else {
-                    /* Regular framebuffer: calculate global position */
-                    uint32_t* pixel = (uint32_t*)((uint8_t*)framebuffer + y * fb_pitch + x * 4);
-                    *pixel = color;
-                }
-            }
+    RgnSpanIter it;
+    RgnSpanBegin(&it, &bounds, rgn, clip, NULL, false);
+    while (RgnSpanNext(&it)) {
+        for (SInt16 k = 0; k < it.count; k++) {
+            Rect piece;
+            SetRect(&piece, it.spans[k].left - originX, it.top - originY,
+                    it.spans[k].right - originX, it.bottom - originY);
+            QDDrawRegionPiece(port, mode, pat, &piece, isDirectFB, colorPattern);
         }
     }
     /* frame, invert modes not yet implemented */
@@ -1171,20 +1499,75 @@ static inline UInt8 GetBitmapBit(const UInt8 *bitmap, SInt32 bitOffset) {
 }
 
 /*
- * QDPlatform_DrawGlyph - Draw a character glyph from a FontStrike
+ * QDPlatform_BeginGlyphRun - Resolve where a string's glyphs will be drawn
  *
- * Renders a character from a bitmap font strike to the framebuffer or offscreen GWorld.
+ * The render buffer is the current color port's PixMap (GWorld) or, for a
+ * basic GrafPort, the screen framebuffer. Working that out used to happen
+ * for every character; a run does it once for the whole string.
+ *
+ * @param run       Run state to fill in
+ * @param port      Current graphics port (for coordinate conversion)
+ * @param color     Pixel color to use
+ */
+void QDPlatform_BeginGlyphRun(QDGlyphRun* run, GrafPtr port, UInt32 color) {
+    run->base = NULL;
+    run->rowBytes = 0;
+    run->width = 0;
+    run->height = 0;
+    run->offsetX = 0;
+    run->offsetY = 0;
+    run->color = color;
+    run->markLeft = run->markTop = 0x7FFFFFFF;
+    run->markRight = run->markBottom = -0x7FFFFFFF;
+
+    /* Check if this is a color port (CGrafPtr) by checking current color port global */
+    extern CGrafPtr g_currentCPort;  /* from ColorQuickDraw.c */
+    Boolean isColorPort = (g_currentCPort != NULL && (GrafPtr)g_currentCPort == port);
+
+    if (isColorPort && ((CGrafPtr)port)->portPixMap && *((CGrafPtr)port)->portPixMap) {
+        /* Drawing to color port (possibly offscreen GWorld) */
+        CGrafPtr cport = (CGrafPtr)port;
+        PixMapPtr pm = *cport->portPixMap;
+        run->base = (UInt8*)pm->baseAddr;
+        run->rowBytes = pm->rowBytes & 0x3FFF;  /* Mask off high bit */
+        run->width = pm->bounds.right - pm->bounds.left;
+        run->height = pm->bounds.bottom - pm->bounds.top;
+
+        /* Convert local coordinates to PixMap buffer coordinates */
+        run->offsetX = -cport->portRect.left;
+        run->offsetY = -cport->portRect.top;
+        return;
+    }
+
+    /* Drawing to basic GrafPort (screen framebuffer); a color port without
+     * a PixMap shouldn't happen, and falls back to the framebuffer too */
+    if (!framebuffer) return;
+    run->base = (UInt8*)framebuffer;
+    run->rowBytes = (SInt32)fb_pitch;
+    run->width = (SInt32)fb_width;
+    run->height = (SInt32)fb_height;
+
+    if (port && !isColorPort) {
+        run->offsetX = port->portBits.bounds.left - port->portRect.left;
+        run->offsetY = port->portBits.bounds.top - port->portRect.top;
+    }
+}
+
+/*
+ * QDPlatform_DrawGlyphRun - Draw one character of a glyph run
  *
+ * The glyph comes from the glyph cache as a run-length mask (GlyphCache.c);
+ * only a glyph the cache will not hold is read bit by bit from the strike.
+ *
+ * @param run       Run from QDPlatform_BeginGlyphRun
  * @param strike    Font strike containing bitmap data
  * @param ch        Character code to render
  * @param x         X position in local coordinates (top-left of glyph)
  * @param y         Y position in local coordinates (top-left of glyph)
- * @param port      Current graphics port (for coordinate conversion)
- * @param color     Pixel color to use
  * @return          Character advance width in pixels
  */
-SInt16 QDPlatform_DrawGlyph(struct FontStrike *strike, UInt8 ch, SInt16 x, SInt16 y,
-                            GrafPtr port, UInt32 color) {
+SInt16 QDPlatform_DrawGlyphRun(QDGlyphRun* run, struct FontStrike* strike, UInt8 ch,
+                               SInt16 x, SInt16 y) {
     if (!strike) {
         return 0;
     }
@@ -1210,94 +1593,174 @@ SInt16 QDPlatform_DrawGlyph(struct FontStrike *strike, UInt8 ch, SInt16 x, SInt1
     if (!strike->bitmapData || !(*strike->bitmapData)) {
         return charWidth;
     }
+    if (!run->base) {
+        return charWidth;
+    }
 
-    UInt8 *bitmap = (UInt8 *)(*strike->bitmapData);
+    SInt32 pixelX = x + run->offsetX;
+    SInt32 pixelY = y + run->offsetY;
+    const QDGlyphMask* mask = QDGlyphCache_Lookup(strike, ch);
+
+    if (mask) {
+        const UInt8* p = mask->runs;
+        for (SInt16 row = 0; row < mask->height; row++) {
+            UInt8 runs = *p++;
+            SInt32 py = pixelY + row;
+            if (py < 0 || py >= run->height) {
+                p += runs * 2;
+                continue;
+            }
 
-    /* Determine rendering destination - GWorld or screen framebuffer */
-    Ptr renderBuffer = NULL;
-    UInt32 renderPitch = 0;
-    UInt32 renderWidth = 0;
-    UInt32 renderHeight = 0;
-    SInt16 pixelX = x;
-    SInt16 pixelY = y;
+            UInt32* line = (UInt32*)(void*)(run->base + py * run->rowBytes);
+            for (UInt8 k = 0; k < runs; k++, p += 2) {
+                SInt32 left = pixelX + p[0];
+                SInt32 right = left + p[1];
+                if (left < 0) left = 0;
+                if (right > run->width) right = run->width;
+                for (SInt32 px = left; px < right; px++) {
+                    line[px] = run->color;
+                }
+            }
+        }
+    } else {
+        /* Draw the glyph straight from the strike */
+        UInt8 *bitmap = (UInt8 *)(*strike->bitmapData);
+        SInt16 rowWords = strike->rowWords;
 
-    /* Check if this is a color port (CGrafPtr) by checking current color port global */
-    extern CGrafPtr g_currentCPort;  /* from ColorQuickDraw.c */
-    Boolean isColorPort = (g_currentCPort != NULL && (GrafPtr)g_currentCPort == port);
+        for (SInt16 row = 0; row < strike->fRectHeight; row++) {
+            if (pixelY + row < 0 || pixelY + row >= run->height) {
+                continue;
+            }
 
-    if (isColorPort) {
-        /* Drawing to color port (possibly offscreen GWorld) */
-        CGrafPtr cport = (CGrafPtr)port;
+            /* Calculate bit position in the strike's bitmap */
+            SInt32 bitRowStart = row * rowWords * 16;  /* 16 bits per word */
+            UInt32* line = (UInt32*)(void*)(run->base + (pixelY + row) * run->rowBytes);
 
-        if (cport->portPixMap && *cport->portPixMap) {
-            PixMapPtr pm = *cport->portPixMap;
-            renderBuffer = pm->baseAddr;
-            renderPitch = pm->rowBytes & 0x3FFF;  /* Mask off high bit */
-            renderWidth = pm->bounds.right - pm->bounds.left;
-            renderHeight = pm->bounds.bottom - pm->bounds.top;
-
-            /* Convert local coordinates to PixMap buffer coordinates */
-            pixelX = x - cport->portRect.left;
-            pixelY = y - cport->portRect.top;
-        } else {
-            /* Color port without PixMap - shouldn't happen, fall back to framebuffer */
-            if (!framebuffer) return charWidth;
-            renderBuffer = (Ptr)framebuffer;
-            renderPitch = fb_pitch;
-            renderWidth = fb_width;
-            renderHeight = fb_height;
-            pixelX = x;
-            pixelY = y;
+            for (SInt16 col = 0; col < charWidth; col++) {
+                if (pixelX + col < 0 || pixelX + col >= run->width) {
+                    continue;
+                }
+
+                if (GetBitmapBit(bitmap, bitRowStart + locStart + col)) {
+                    line[pixelX + col] = run->color;
+                }
+            }
         }
-    } else {
-        /* Drawing to basic GrafPort (screen framebuffer) */
-        if (!framebuffer) return charWidth;
+    }
 
-        renderBuffer = (Ptr)framebuffer;
-        renderPitch = fb_pitch;
-        renderWidth = fb_width;
-        renderHeight = fb_height;
+    if (pixelX < run->markLeft) run->markLeft = pixelX;
+    if (pixelY < run->markTop) run->markTop = pixelY;
+    if (pixelX + charWidth > run->markRight) run->markRight = pixelX + charWidth;
+    if (pixelY + strike->fRectHeight > run->markBottom) {
+        run->markBottom = pixelY + strike->fRectHeight;
+    }
 
-        if (port) {
-            pixelX = x - port->portRect.left + port->portBits.bounds.left;
-            pixelY = y - port->portRect.top + port->portBits.bounds.top;
-        }
+    /* Return character width for pen advancement */
+    if (strike->widthTable) {
+        return strike->widthTable[charIndex];
     }
 
-    if (!renderBuffer) return charWidth;
+    return charWidth;
+}
 
-    /* Draw the glyph */
-    UInt32 *pixels = (UInt32 *)renderBuffer;
-    SInt16 rowWords = strike->rowWords;
+/*
+ * QDPlatform_DrawCoverageRun - Draw one outline glyph of a glyph run
+ *
+ * The glyph is a coverage bitmap from the outline glyph cache
+ * (OutlineGlyphCache.c). Each pixel moves towards the run's color by its
+ * coverage, every channel alike, so the edges are anti-aliased against
+ * whatever is underneath.
+ *
+ * @param run       Run from QDPlatform_BeginGlyphRun
+ * @param glyph     Coverage bitmap
+ * @param x         Pen position in local coordinates
+ * @param y         Baseline in local coordinates
+ * @return          Advance width in pixels
+ */
+SInt16 QDPlatform_DrawCoverageRun(QDGlyphRun* run, const struct FMGlyphBitmap* glyph,
+                                  SInt16 x, SInt16 y) {
+    if (!glyph) {
+        return 0;
+    }
+    if (!run->base || glyph->width == 0) {
+        return glyph->advance;
+    }
+
+    SInt32 pixelX = x + run->offsetX + glyph->left;
+    SInt32 pixelY = y + run->offsetY - glyph->top;
+    UInt32 color = run->color;
 
-    for (SInt16 row = 0; row < strike->fRectHeight; row++) {
-        if (pixelY + row < 0 || pixelY + row >= renderHeight) {
+    for (SInt16 row = 0; row < glyph->height; row++) {
+        SInt32 py = pixelY + row;
+        if (py < 0 || py >= run->height) {
             continue;
         }
 
-        /* Calculate bit position in the strike's bitmap */
-        SInt32 bitRowStart = row * rowWords * 16;  /* 16 bits per word */
-
-        for (SInt16 col = 0; col < charWidth; col++) {
-            if (pixelX + col < 0 || pixelX + col >= renderWidth) {
+        const UInt8* coverage = glyph->coverage + row * glyph->width;
+        UInt32* line = (UInt32*)(void*)(run->base + py * run->rowBytes);
+        for (SInt16 col = 0; col < glyph->width; col++) {
+            SInt32 px = pixelX + col;
+            UInt32 a = coverage[col];
+            if (a == 0 || px < 0 || px >= run->width) {
                 continue;
             }
-
-            SInt32 bitPos = bitRowStart + locStart + col;
-
-            if (GetBitmapBit(bitmap, bitPos)) {
-                SInt32 pixelOffset = (pixelY + row) * (renderPitch / 4) + (pixelX + col);
-                pixels[pixelOffset] = color;
+            if (a == 255) {
+                line[px] = color;
+                continue;
             }
+
+            /* Two channels per multiply; 255 maps to 256 so solid is exact */
+            UInt32 w = a + (a >> 7);
+            UInt32 d = line[px];
+            UInt32 rb = (((color & 0x00FF00FF) * w + (d & 0x00FF00FF) * (256 - w)) >> 8) & 0x00FF00FF;
+            UInt32 ag = ((((color >> 8) & 0x00FF00FF) * w +
+                          ((d >> 8) & 0x00FF00FF) * (256 - w)) >> 8) & 0x00FF00FF;
+            line[px] = rb | (ag << 8);
         }
     }
 
-    /* Return character width for pen advancement */
-    if (strike->widthTable) {
-        return strike->widthTable[charIndex];
+    if (pixelX < run->markLeft) run->markLeft = pixelX;
+    if (pixelY < run->markTop) run->markTop = pixelY;
+    if (pixelX + glyph->width > run->markRight) run->markRight = pixelX + glyph->width;
+    if (pixelY + glyph->height > run->markBottom) run->markBottom = pixelY + glyph->height;
+
+    return glyph->advance;
+}
+
+/* QDPlatform_EndGlyphRun - Mark what the run drew, if it drew on screen.
+ * By address, so a PixMap whose baseAddr points into the framebuffer counts. */
+void QDPlatform_EndGlyphRun(QDGlyphRun* run) {
+    SInt32 left = run->markLeft < 0 ? 0 : run->markLeft;
+    SInt32 top = run->markTop < 0 ? 0 : run->markTop;
+    SInt32 right = run->markRight > run->width ? run->width : run->markRight;
+    SInt32 bottom = run->markBottom > run->height ? run->height : run->markBottom;
+
+    if (run->base && left < right && top < bottom) {
+        QDPresent_MarkPixels(run->base + top * run->rowBytes + left * 4,
+                             right - left, bottom - top);
     }
+}
 
-    return charWidth;
+/*
+ * QDPlatform_DrawGlyph - Draw a character glyph from a FontStrike
+ *
+ * Renders a character from a bitmap font strike to the framebuffer or offscreen GWorld.
+ *
+ * @param strike    Font strike containing bitmap data
+ * @param ch        Character code to render
+ * @param x         X position in local coordinates (top-left of glyph)
+ * @param y         Y position in local coordinates (top-left of glyph)
+ * @param port      Current graphics port (for coordinate conversion)
+ * @param color     Pixel color to use
+ * @return          Character advance width in pixels
+ */
+SInt16 QDPlatform_DrawGlyph(struct FontStrike *strike, UInt8 ch, SInt16 x, SInt16 y,
+                            GrafPtr port, UInt32 color) {
+    QDGlyphRun run;
+    QDPlatform_BeginGlyphRun(&run, port, color);
+    SInt16 advance = QDPlatform_DrawGlyphRun(&run, strike, ch, x, y);
+    QDPlatform_EndGlyphRun(&run);
+    return advance;
 }
 
 /**
@@ -1410,4 +1873,14 @@ void QDPlatform_DrawGlyphBitmap(GrafPtr port, Point pen,
             }
         }
     }
+
+    /* Only does anything when the destination is the screen */
+    SInt32 markLeft = destX < 0 ? 0 : destX;
+    SInt32 markTop = destY < 0 ? 0 : destY;
+    SInt32 markRight = destX + width > destWidth ? destWidth : destX + width;
+    SInt32 markBottom = destY + height > destHeight ? destHeight : destY + height;
+    if (markLeft < markRight && markTop < markBottom) {
+        QDPresent_MarkPixels(pixels + markTop * pixelPitch + markLeft,
+                             markRight - markLeft, markBottom - markTop);
+    }
 }
@@ -412,7 +412,7 @@ void InsetRgn(RgnHandle rgn, SInt16 dh, SInt16 dv) {
  * REGION SET OPERATIONS
  *
  * A region is a bounding box plus, when it is not a plain rectangle,
- * a list of disjoint rectangles that cover exactly the region's area:
+ * a list of rectangles that cover exactly the region's area:
  *
  *   offset 0   SInt16 rgnSize     total bytes
  *   offset 2   Rect   rgnBBox
@@ -422,20 +422,25 @@ void InsetRgn(RgnHandle rgn, SInt16 dh, SInt16 dv) {
  * A rectangular region keeps rgnSize == kMinRegionSize and no list, so
  * nothing that only reads rgnBBox behaves differently than before.
  *
- * Every operation below is built from one primitive - subtracting a
- * rectangle from a rectangle, which leaves at most four pieces - because
- * that is the only geometry involved once regions are rectangle lists.
- * These used to be stubs that returned a bounding box: DiffRgn returned
- * its first argument unchanged, so a window's visible region could never
- * have the window in front of it taken out, and a window behind repainted
- * straight over the one in front (REGION-001).
+ * The list is banded, the way X11 keeps its regions and in the spirit of
+ * the original inversion-point format: rectangles sorted by top and then
+ * left; those with the same top share a bottom and form a band; bands do
+ * not overlap; within a band rectangles neither overlap nor touch; and two
+ * bands that meet with the same x-spans are one band. Every shape has one
+ * such list, so EqualRgn can still compare bytes.
+ *
+ * The set operations sweep down both operands a band at a time and merge
+ * the x-spans of the two current bands, which is linear in their sizes.
+ * They used to subtract rectangles pairwise - O(n*m), with the working
+ * lists on the stack - and collapse to the bounding box past 128
+ * rectangles, which a busy desktop's visible regions went past routinely
+ * and then repainted windows that were covered. What limits a region now
+ * is the 16-bit rgnSize, about 4000 rectangles; past that it is the
+ * bounding box and rgnOverflowErr, which is what QuickDraw always did.
  * ================================================================ */
 
-/* A region that would need more rectangles than this collapses to its
- * bounding box. Overstating a visible region repaints too much, which is
- * what the old stubs did in every case; the cap keeps the failure mode the
- * same as before rather than introducing a new one. */
-#define kMaxRegionRects 128
+#define kMaxRegionRects ((kMaxRegionSize - kMinRegionSize - (SInt32)sizeof(SInt16)) / \
+                         (SInt32)sizeof(Rect))
 
 static SInt16 RgnRectCount(Region *region) {
     if (!region) return 0;
@@ -457,49 +462,132 @@ static void RgnGetRect(Region *region, SInt16 i, Rect *out) {
     }
 }
 
-/* Read a region's rectangles into a caller-supplied array.
- * Returns the count, or -1 if the array is too small. */
-static SInt16 RgnCopyRects(RgnHandle rgn, Rect *out, SInt16 max) {
-    Region *region = *rgn;
-    SInt16 n = RgnRectCount(region);
-    if (n > max) return -1;
-    for (SInt16 i = 0; i < n; i++) {
-        RgnGetRect(region, i, &out[i]);
+/* The rectangles of a region in place: the bbox itself for a rectangle */
+static const Rect *RgnRects(Region *region, SInt16 *count) {
+    *count = RgnRectCount(region);
+    if (region->rgnSize <= kMinRegionSize) {
+        return &region->rgnBBox;
     }
-    return n;
+    return RgnRectList(region);
 }
 
-/* Replace a region's contents with a list of disjoint rectangles. */
-static void SetRgnRects(RgnHandle rgn, Rect *rects, SInt16 count) {
-    Rect bbox;
-    SInt16 kept = 0;
-
-    /* Drop empties and compute the bounding box in one pass. */
-    SetRect(&bbox, 0, 0, 0, 0);
-    for (SInt16 i = 0; i < count; i++) {
-        if (EmptyRect(&rects[i])) continue;
-        if (kept == 0) {
-            bbox = rects[i];
-        } else {
-            UnionRect(&bbox, &rects[i], &bbox);
+/* First rectangle at or after 'from' whose bottom is below y. Bands do not
+ * overlap, so bottoms never decrease along the list, and the rectangle found
+ * starts the band containing y - if that band's top is not below y. */
+static SInt16 RgnBandAt(const Rect *rects, SInt16 from, SInt16 n, SInt16 y) {
+    SInt16 lo = from, hi = n;
+    while (lo < hi) {
+        SInt16 mid = (SInt16)(lo + (hi - lo) / 2);
+        if (rects[mid].bottom > y) hi = mid;
+        else lo = mid + 1;
+    }
+    return lo;
+}
+
+/* One past the last rectangle of the band starting at 'band' */
+static SInt16 RgnBandEnd(const Rect *rects, SInt16 band, SInt16 n) {
+    return RgnBandAt(rects, band, n, rects[band].bottom);
+}
+
+/* First rectangle of a band whose right edge is past x */
+static SInt16 RgnSpanAt(const Rect *rects, SInt16 lo, SInt16 hi, SInt16 x) {
+    while (lo < hi) {
+        SInt16 mid = (SInt16)(lo + (hi - lo) / 2);
+        if (rects[mid].right > x) hi = mid;
+        else lo = mid + 1;
+    }
+    return lo;
+}
+
+/* The list a set operation is building, grown as it goes */
+typedef struct {
+    Rect   *rects;
+    SInt32  count;
+    SInt32  capacity;
+    SInt32  lastBand;       /* Where the band before the one being added starts */
+    Boolean failed;
+} RgnBuilder;
+
+static Boolean RgnBuilderReserve(RgnBuilder *b, SInt32 more) {
+    if (b->failed) return false;
+    if (b->count + more <= b->capacity) return true;
+    if (b->count + more > kMaxRegionRects) {
+        b->failed = true;
+        return false;
+    }
+
+    SInt32 capacity = b->capacity ? b->capacity * 2 : 32;
+    while (capacity < b->count + more) capacity *= 2;
+    if (capacity > kMaxRegionRects) capacity = kMaxRegionRects;
+
+    /* NewPtr and copy: realloc is not to be trusted here (see SetRectRgn) */
+    Rect *grown = (Rect *)NewPtr((u32)(capacity * (SInt32)sizeof(Rect)));
+    if (!grown) {
+        b->failed = true;
+        return false;
+    }
+    if (b->rects) {
+        memcpy(grown, b->rects, (size_t)b->count * sizeof(Rect));
+        DisposePtr((Ptr)b->rects);
+    }
+    b->rects = grown;
+    b->capacity = capacity;
+    return true;
+}
+
+/*
+ * Add the band [top, bottom) with the spans between successive pairs of
+ * edges. If the band before ends at top with the same spans, that band is
+ * made taller instead, which is what keeps the list in its one form.
+ */
+static void RgnBuilderAddBand(RgnBuilder *b, SInt16 top, SInt16 bottom,
+                              const SInt16 *edges, SInt16 edgeCount) {
+    SInt16 spans = edgeCount / 2;
+    if (spans == 0 || b->failed) return;
+
+    SInt32 prev = b->lastBand;
+    SInt32 prevCount = b->count - prev;
+    if (prevCount == spans && b->rects[prev].bottom == top) {
+        Boolean same = true;
+        for (SInt16 i = 0; i < spans && same; i++) {
+            same = (b->rects[prev + i].left == edges[2 * i] &&
+                    b->rects[prev + i].right == edges[2 * i + 1]);
+        }
+        if (same) {
+            for (SInt32 i = prev; i < b->count; i++) {
+                b->rects[i].bottom = bottom;
+            }
+            return;
         }
-        kept++;
     }
 
-    if (kept == 0) {
+    if (!RgnBuilderReserve(b, spans)) return;
+    b->lastBand = b->count;
+    for (SInt16 i = 0; i < spans; i++) {
+        SetRect(&b->rects[b->count++], edges[2 * i], top, edges[2 * i + 1], bottom);
+    }
+}
+
+/* Replace a region's contents with a banded list; the bounding box is the
+ * first band's top, the last band's bottom, and the extremes between. */
+static void RgnStoreRects(RgnHandle rgn, const Rect *rects, SInt32 count) {
+    if (count == 0) {
         SetEmptyRgn(rgn);
         return;
     }
 
-    /* One rectangle, or too many to store: a plain rectangular region.
-     * The bounding box is the only honest answer in the first case and a
-     * deliberate over-estimate in the second. */
-    if (kept == 1 || kept > kMaxRegionRects) {
+    Rect bbox;
+    SetRect(&bbox, rects[0].left, rects[0].top, rects[0].right, rects[count - 1].bottom);
+    for (SInt32 i = 1; i < count; i++) {
+        if (rects[i].left < bbox.left) bbox.left = rects[i].left;
+        if (rects[i].right > bbox.right) bbox.right = rects[i].right;
+    }
+    if (count == 1) {
         RectRgn(rgn, &bbox);
         return;
     }
 
-    SInt16 needed = (SInt16)(kMinRegionSize + sizeof(SInt16) + kept * sizeof(Rect));
+    SInt16 needed = (SInt16)(kMinRegionSize + sizeof(SInt16) + (size_t)count * sizeof(Rect));
     Region *region = *rgn;
 
     if (region->rgnSize < needed) {
@@ -517,75 +605,115 @@ static void SetRgnRects(RgnHandle rgn, Rect *rects, SInt16 count) {
 
     region->rgnSize = needed;
     region->rgnBBox = bbox;
-    *(SInt16 *)((UInt8 *)region + kMinRegionSize) = kept;
-
-    Rect *dst = (Rect *)((UInt8 *)region + kMinRegionSize + sizeof(SInt16));
-    for (SInt16 i = 0; i < count; i++) {
-        if (EmptyRect(&rects[i])) continue;
-        *dst++ = rects[i];
-    }
+    *(SInt16 *)((UInt8 *)region + kMinRegionSize) = (SInt16)count;
+    memcpy(RgnRectList(region), rects, (size_t)count * sizeof(Rect));
 
     g_lastRegionError = 0;
 }
 
-/*
- * Subtract one rectangle from another, appending what is left to out[].
- *
- * The result is the parts of "from" not covered by "cut" - up to four
- * rectangles: the bands above and below the cut, and the strips left and
- * right of it within the overlapping band. They are disjoint by
- * construction, which is what keeps a region's rectangle list disjoint.
- */
-static SInt16 SubtractRect(Rect *from, Rect *cut, Rect *out, SInt16 max) {
-    Rect overlap;
-    SInt16 n = 0;
+enum { kRgnOpSect, kRgnOpUnion, kRgnOpDiff, kRgnOpXor };
 
-    if (!SectRect(from, cut, &overlap)) {
-        if (n < max) out[n++] = *from;
-        return n;
+static Boolean RgnOpInside(int op, Boolean inA, Boolean inB) {
+    switch (op) {
+        case kRgnOpSect:  return inA && inB;
+        case kRgnOpUnion: return inA || inB;
+        case kRgnOpDiff:  return inA && !inB;
+        default:          return inA != inB;
     }
+}
 
-    if (overlap.top > from->top && n < max) {           /* band above */
-        SetRect(&out[n++], from->left, from->top, from->right, overlap.top);
-    }
-    if (overlap.bottom < from->bottom && n < max) {     /* band below */
-        SetRect(&out[n++], from->left, overlap.bottom, from->right, from->bottom);
-    }
-    if (overlap.left > from->left && n < max) {         /* strip left */
-        SetRect(&out[n++], from->left, overlap.top, overlap.left, overlap.bottom);
-    }
-    if (overlap.right < from->right && n < max) {       /* strip right */
-        SetRect(&out[n++], overlap.right, overlap.top, from->right, overlap.bottom);
+/*
+ * Combine one band's spans of each operand: walk the edges of both in x
+ * order and note where the result starts and stops being inside. Spans of
+ * one operand that touch come out joined.
+ */
+static SInt16 RgnOpSpans(int op, const Rect *a, SInt16 na, const Rect *b, SInt16 nb,
+                         SInt16 *edges) {
+    SInt16 ka = 0, kb = 0, count = 0;
+    Boolean inside = false;
+
+    while (ka < 2 * na || kb < 2 * nb) {
+        SInt16 xa = (ka < 2 * na) ? ((ka & 1) ? a[ka / 2].right : a[ka / 2].left) : 32767;
+        SInt16 xb = (kb < 2 * nb) ? ((kb & 1) ? b[kb / 2].right : b[kb / 2].left) : 32767;
+        SInt16 x = (xa < xb) ? xa : xb;
+
+        while (ka < 2 * na && ((ka & 1) ? a[ka / 2].right : a[ka / 2].left) == x) ka++;
+        while (kb < 2 * nb && ((kb & 1) ? b[kb / 2].right : b[kb / 2].left) == x) kb++;
+
+        Boolean now = RgnOpInside(op, (ka & 1) != 0, (kb & 1) != 0);
+        if (now != inside) {
+            edges[count++] = x;
+            inside = now;
+        }
     }
-    return n;
+    return count;
 }
 
-/* Subtract every rectangle of "cuts" from every rectangle of "pieces". */
-static SInt16 SubtractRectList(Rect *pieces, SInt16 pieceCount,
-                               Rect *cuts, SInt16 cutCount,
-                               Rect *out, SInt16 max) {
-    Rect work[kMaxRegionRects * 2];
-    Rect next[kMaxRegionRects * 2];
-    SInt16 workCount = 0;
-
-    if (pieceCount > (SInt16)(sizeof(work) / sizeof(work[0]))) return -1;
-    for (SInt16 i = 0; i < pieceCount; i++) work[workCount++] = pieces[i];
+/*
+ * The sweep: from the top of whichever operand starts higher, each step
+ * covers the rows until the next band edge of either, with the spans each
+ * has there (none, between its bands) merged by RgnOpSpans.
+ */
+static void RgnOp(int op, RgnHandle srcRgnA, RgnHandle srcRgnB, RgnHandle dstRgn) {
+    SInt16 na, nb;
+    const Rect *a = RgnRects(*srcRgnA, &na);
+    const Rect *b = RgnRects(*srcRgnB, &nb);
+    RgnBuilder out = { NULL, 0, 0, 0, false };
+    SInt16 *edges = (SInt16 *)NewPtr((u32)((na + nb) * 2 * (SInt32)sizeof(SInt16)));
+    SInt16 ia = 0, ib = 0;
+    SInt16 y = -32768;
+
+    if (!edges) out.failed = true;
+
+    while (!out.failed && (ia < na || ib < nb)) {
+        /* Past the end of A nothing more can be in A - B or A & B */
+        if ((op == kRgnOpSect && (ia >= na || ib >= nb)) || (op == kRgnOpDiff && ia >= na)) {
+            break;
+        }
+        SInt16 ea = (ia < na) ? RgnBandEnd(a, ia, na) : ia;
+        SInt16 eb = (ib < nb) ? RgnBandEnd(b, ib, nb) : ib;
+        Boolean inA = (ia < na && a[ia].top <= y);
+        Boolean inB = (ib < nb && b[ib].top <= y);
+
+        if (!inA && !inB) {
+            /* Between bands of both: on to whichever starts next */
+            SInt16 ta = (ia < na) ? a[ia].top : 32767;
+            SInt16 tb = (ib < nb) ? b[ib].top : 32767;
+            y = (ta < tb) ? ta : tb;
+            continue;
+        }
 
-    for (SInt16 c = 0; c < cutCount; c++) {
-        SInt16 nextCount = 0;
-        for (SInt16 p = 0; p < workCount; p++) {
-            SInt16 room = (SInt16)(sizeof(next) / sizeof(next[0])) - nextCount;
-            if (room < 4) return -1;   /* too fragmented to describe exactly */
-            nextCount += SubtractRect(&work[p], &cuts[c], &next[nextCount], room);
+        SInt16 next = 32767;
+        if (ia < na) next = inA ? a[ia].bottom : a[ia].top;
+        if (ib < nb) {
+            SInt16 nextB = inB ? b[ib].bottom : b[ib].top;
+            if (nextB < next) next = nextB;
         }
-        for (SInt16 i = 0; i < nextCount; i++) work[i] = next[i];
-        workCount = nextCount;
-        if (workCount == 0) break;
+
+        SInt16 count = RgnOpSpans(op, a + ia, inA ? (SInt16)(ea - ia) : 0,
+                                  b + ib, inB ? (SInt16)(eb - ib) : 0, edges);
+        RgnBuilderAddBand(&out, y, next, edges, count);
+
+        y = next;
+        if (inA && a[ia].bottom == y) ia = ea;
+        if (inB && b[ib].bottom == y) ib = eb;
     }
 
-    if (workCount > max) return -1;
-    for (SInt16 i = 0; i < workCount; i++) out[i] = work[i];
-    return workCount;
+    if (out.failed) {
+        /* Too many rectangles for rgnSize, or no memory: the box around both
+         * operands still covers the answer */
+        Rect bounds;
+        UnionRect(&(*srcRgnA)->rgnBBox, &(*srcRgnB)->rgnBBox, &bounds);
+        if (op == kRgnOpSect) SectRect(&(*srcRgnA)->rgnBBox, &(*srcRgnB)->rgnBBox, &bounds);
+        if (op == kRgnOpDiff) bounds = (*srcRgnA)->rgnBBox;
+        RectRgn(dstRgn, &bounds);
+        g_lastRegionError = rgnOverflowErr;
+    } else {
+        RgnStoreRects(dstRgn, out.rects, out.count);
+    }
+
+    if (out.rects) DisposePtr((Ptr)out.rects);
+    if (edges) DisposePtr((Ptr)edges);
 }
 
 void SectRgn(RgnHandle srcRgnA, RgnHandle srcRgnB, RgnHandle dstRgn) {
@@ -593,7 +721,6 @@ void SectRgn(RgnHandle srcRgnA, RgnHandle srcRgnB, RgnHandle dstRgn) {
     assert(srcRgnB != NULL && *srcRgnB != NULL);
     assert(dstRgn != NULL && *dstRgn != NULL);
 
-    Rect a[kMaxRegionRects], b[kMaxRegionRects], result[kMaxRegionRects];
     Rect bounds;
 
     /* Nothing can be in both if their bounding boxes are disjoint. */
@@ -601,23 +728,11 @@ void SectRgn(RgnHandle srcRgnA, RgnHandle srcRgnB, RgnHandle dstRgn) {
         SetEmptyRgn(dstRgn);
         return;
     }
-
-    SInt16 na = RgnCopyRects(srcRgnA, a, kMaxRegionRects);
-    SInt16 nb = RgnCopyRects(srcRgnB, b, kMaxRegionRects);
-    if (na < 0 || nb < 0) { RectRgn(dstRgn, &bounds); return; }
-
-    /* Pairwise intersections. Both lists are disjoint, so the results are. */
-    SInt16 n = 0;
-    for (SInt16 i = 0; i < na; i++) {
-        for (SInt16 j = 0; j < nb; j++) {
-            Rect piece;
-            if (SectRect(&a[i], &b[j], &piece)) {
-                if (n >= kMaxRegionRects) { RectRgn(dstRgn, &bounds); return; }
-                result[n++] = piece;
-            }
-        }
+    if (IsRectRegion(srcRgnA) && IsRectRegion(srcRgnB)) {
+        RectRgn(dstRgn, &bounds);
+        return;
     }
-    SetRgnRects(dstRgn, result, n);
+    RgnOp(kRgnOpSect, srcRgnA, srcRgnB, dstRgn);
 }
 
 void DiffRgn(RgnHandle srcRgnA, RgnHandle srcRgnB, RgnHandle dstRgn) {
@@ -625,7 +740,6 @@ void DiffRgn(RgnHandle srcRgnA, RgnHandle srcRgnB, RgnHandle dstRgn) {
     assert(srcRgnB != NULL && *srcRgnB != NULL);
     assert(dstRgn != NULL && *dstRgn != NULL);
 
-    Rect a[kMaxRegionRects], b[kMaxRegionRects], result[kMaxRegionRects];
     Rect ignored;
 
     if (EmptyRgn(srcRgnA)) { SetEmptyRgn(dstRgn); return; }
@@ -636,14 +750,7 @@ void DiffRgn(RgnHandle srcRgnA, RgnHandle srcRgnB, RgnHandle dstRgn) {
         CopyRgn(srcRgnA, dstRgn);
         return;
     }
-
-    SInt16 na = RgnCopyRects(srcRgnA, a, kMaxRegionRects);
-    SInt16 nb = RgnCopyRects(srcRgnB, b, kMaxRegionRects);
-    if (na < 0 || nb < 0) { CopyRgn(srcRgnA, dstRgn); return; }
-
-    SInt16 n = SubtractRectList(a, na, b, nb, result, kMaxRegionRects);
-    if (n < 0) { CopyRgn(srcRgnA, dstRgn); return; }  /* over-estimate, as before */
-    SetRgnRects(dstRgn, result, n);
+    RgnOp(kRgnOpDiff, srcRgnA, srcRgnB, dstRgn);
 }
 
 void UnionRgn(RgnHandle srcRgnA, RgnHandle srcRgnB, RgnHandle dstRgn) {
@@ -651,29 +758,9 @@ void UnionRgn(RgnHandle srcRgnA, RgnHandle srcRgnB, RgnHandle dstRgn) {
     assert(srcRgnB != NULL && *srcRgnB != NULL);
     assert(dstRgn != NULL && *dstRgn != NULL);
 
-    Rect a[kMaxRegionRects], b[kMaxRegionRects], result[kMaxRegionRects * 2];
-
     if (EmptyRgn(srcRgnA)) { CopyRgn(srcRgnB, dstRgn); return; }
     if (EmptyRgn(srcRgnB)) { CopyRgn(srcRgnA, dstRgn); return; }
-
-    SInt16 na = RgnCopyRects(srcRgnA, a, kMaxRegionRects);
-    SInt16 nb = RgnCopyRects(srcRgnB, b, kMaxRegionRects);
-
-    Rect bounds;
-    UnionRect(&(*srcRgnA)->rgnBBox, &(*srcRgnB)->rgnBBox, &bounds);
-    if (na < 0 || nb < 0) { RectRgn(dstRgn, &bounds); return; }
-
-    /* All of A, plus the parts of B that A does not already cover, so the
-     * result stays a list of disjoint rectangles. */
-    SInt16 n = 0;
-    for (SInt16 i = 0; i < na; i++) result[n++] = a[i];
-
-    SInt16 extra = SubtractRectList(b, nb, a, na, &result[n],
-                                    (SInt16)(kMaxRegionRects * 2 - n));
-    if (extra < 0) { RectRgn(dstRgn, &bounds); return; }
-    n += extra;
-
-    SetRgnRects(dstRgn, result, n);
+    RgnOp(kRgnOpUnion, srcRgnA, srcRgnB, dstRgn);
 }
 
 void XorRgn(RgnHandle srcRgnA, RgnHandle srcRgnB, RgnHandle dstRgn) {
@@ -681,27 +768,9 @@ void XorRgn(RgnHandle srcRgnA, RgnHandle srcRgnB, RgnHandle dstRgn) {
     assert(srcRgnB != NULL && *srcRgnB != NULL);
     assert(dstRgn != NULL && *dstRgn != NULL);
 
-    Rect a[kMaxRegionRects], b[kMaxRegionRects], result[kMaxRegionRects * 2];
-
     if (EmptyRgn(srcRgnA)) { CopyRgn(srcRgnB, dstRgn); return; }
     if (EmptyRgn(srcRgnB)) { CopyRgn(srcRgnA, dstRgn); return; }
-
-    SInt16 na = RgnCopyRects(srcRgnA, a, kMaxRegionRects);
-    SInt16 nb = RgnCopyRects(srcRgnB, b, kMaxRegionRects);
-
-    Rect bounds;
-    UnionRect(&(*srcRgnA)->rgnBBox, &(*srcRgnB)->rgnBBox, &bounds);
-    if (na < 0 || nb < 0) { RectRgn(dstRgn, &bounds); return; }
-
-    /* In one or the other but not both: (A - B) and (B - A) are disjoint. */
-    SInt16 n = SubtractRectList(a, na, b, nb, result, kMaxRegionRects * 2);
-    if (n < 0) { RectRgn(dstRgn, &bounds); return; }
-
-    SInt16 extra = SubtractRectList(b, nb, a, na, &result[n],
-                                    (SInt16)(kMaxRegionRects * 2 - n));
-    if (extra < 0) { RectRgn(dstRgn, &bounds); return; }
-
-    SetRgnRects(dstRgn, result, (SInt16)(n + extra));
+    RgnOp(kRgnOpXor, srcRgnA, srcRgnB, dstRgn);
 }
 
 /* ================================================================
@@ -760,17 +829,19 @@ Boolean RectInRgn(const Rect *r, RgnHandle rgn) {
     Boolean result = SectRect(&probe, &region->rgnBBox, &intersection);
 
     /* Meeting the bounding box is not the same as meeting the region: a
-     * rectangle can sit squarely in the notch of an L and touch nothing. */
+     * rectangle can sit squarely in the notch of an L and touch nothing.
+     * Find the first band below the probe's top, then in each band it
+     * crosses the first rectangle ending right of its left edge. */
     if (result && region->rgnSize > kMinRegionSize) {
-        SInt16 n = RgnRectCount(region);
+        SInt16 n;
+        const Rect *rects = RgnRects(region, &n);
+        SInt16 band = RgnBandAt(rects, 0, n, probe.top);
         result = false;
-        for (SInt16 i = 0; i < n; i++) {
-            Rect piece;
-            RgnGetRect(region, i, &piece);
-            if (SectRect(&probe, &piece, &intersection)) {
-                result = true;
-                break;
-            }
+        while (band < n && rects[band].top < probe.bottom && !result) {
+            SInt16 end = RgnBandEnd(rects, band, n);
+            SInt16 i = RgnSpanAt(rects, band, end, probe.left);
+            result = (i < end && rects[i].left < probe.right);
+            band = end;
         }
     }
 
@@ -798,19 +869,20 @@ Boolean PtInRgn(Point pt, RgnHandle rgn) {
     }
 
     /* Otherwise the point has to be in one of the region's rectangles. The
-     * bounding box of an L-shape contains points the region does not. */
-    SInt16 n = RgnRectCount(region);
-    for (SInt16 i = 0; i < n; i++) {
-        Rect piece;
-        RgnGetRect(region, i, &piece);
-        if (PtInRect(pt, &piece)) {
-            HUnlock((Handle)rgn);
-            return true;
-        }
+     * bounding box of an L-shape contains points the region does not. Two
+     * binary searches find the only one it can be: the band, then the span. */
+    SInt16 n;
+    const Rect *rects = RgnRects(region, &n);
+    SInt16 band = RgnBandAt(rects, 0, n, pt.v);
+    Boolean result = false;
+    if (band < n && rects[band].top <= pt.v) {
+        SInt16 end = RgnBandEnd(rects, band, n);
+        SInt16 i = RgnSpanAt(rects, band, end, pt.h);
+        result = (i < end && rects[i].left <= pt.h);
     }
 
     HUnlock((Handle)rgn);
-    return false;
+    return result;
 }
 
 /* ================================================================
@@ -842,6 +914,125 @@ void FillRgn(RgnHandle rgn, ConstPatternParam pat) {
     QDPlatform_DrawRegion(rgn, fill, pat);
 }
 
+/* ================================================================
+ * REGION SPAN ITERATION
+ *
+ * Clipped drawing used to ask PtInRgn about every pixel. What drawing wants
+ * is the other way round:
+ * for each row, the x-intervals inside the clip, so it can fill or copy them
+ * whole. Rows come in bands - runs where no rectangle starts or ends - and
+ * the intervals are worked out once per band, for each region, and
+ * intersected with the others as they go.
+ * ================================================================ */
+
+/*
+ * The spans of one region on row y, clipped to [left, right). Narrows *top
+ * and *bottom to the rows around y whose spans are the same: the band y is
+ * in, or the gap between bands. A band is already sorted and disjoint, so
+ * this is a binary search and a copy. A band with more than max spans has
+ * the rest joined into its last one - more than the region, never less.
+ */
+static SInt16 RgnRowSpans(RgnHandle rgn, SInt16 y, SInt16 left, SInt16 right,
+                          SInt16 *top, SInt16 *bottom, RgnSpan *out, SInt16 max) {
+    SInt16 n;
+    const Rect *rects = RgnRects(*rgn, &n);
+    SInt16 band = RgnBandAt(rects, 0, n, y);
+    SInt16 count = 0;
+
+    if (band > 0 && rects[band - 1].bottom > *top) *top = rects[band - 1].bottom;
+    if (band >= n || rects[band].top > y) {
+        if (band < n && rects[band].top < *bottom) *bottom = rects[band].top;
+        return 0;
+    }
+    if (rects[band].top > *top) *top = rects[band].top;
+    if (rects[band].bottom < *bottom) *bottom = rects[band].bottom;
+
+    SInt16 end = RgnBandEnd(rects, band, n);
+    for (SInt16 i = RgnSpanAt(rects, band, end, left); i < end && rects[i].left < right; i++) {
+        SInt16 l = (rects[i].left > left) ? rects[i].left : left;
+        SInt16 r = (rects[i].right < right) ? rects[i].right : right;
+        if (count == max) {
+            out[count - 1].right = r;
+            continue;
+        }
+        out[count].left = l;
+        out[count].right = r;
+        count++;
+    }
+    return count;
+}
+
+/* Intersection of two sorted lists of disjoint spans */
+static SInt16 IntersectSpans(const RgnSpan *a, SInt16 na, const RgnSpan *b, SInt16 nb,
+                             RgnSpan *out, SInt16 max) {
+    SInt16 i = 0, j = 0, n = 0;
+
+    while (i < na && j < nb && n < max) {
+        SInt16 l = (a[i].left > b[j].left) ? a[i].left : b[j].left;
+        SInt16 r = (a[i].right < b[j].right) ? a[i].right : b[j].right;
+        if (l < r) {
+            out[n].left = l;
+            out[n].right = r;
+            n++;
+        }
+        if (a[i].right < b[j].right) i++;
+        else j++;
+    }
+    return n;
+}
+
+void RgnSpanBegin(RgnSpanIter *it, const Rect *bounds, RgnHandle a, RgnHandle b,
+                  RgnHandle c, Boolean bottomUp) {
+    RgnHandle rgns[3] = { a, b, c };
+
+    it->rgnCount = 0;
+    for (int i = 0; i < 3; i++) {
+        if (rgns[i] && *rgns[i]) {
+            it->rgns[it->rgnCount++] = rgns[i];
+        }
+    }
+    it->bounds = *bounds;
+    it->bottomUp = bottomUp;
+    it->y = bottomUp ? bounds->bottom : bounds->top;
+    it->top = it->bottom = it->y;
+    it->count = 0;
+    if (EmptyRect(bounds)) {
+        it->y = bottomUp ? bounds->top : bounds->bottom;
+    }
+}
+
+Boolean RgnSpanNext(RgnSpanIter *it) {
+    while (it->bottomUp ? it->y > it->bounds.top : it->y < it->bounds.bottom) {
+        SInt16 row = it->bottomUp ? (SInt16)(it->y - 1) : it->y;
+        SInt16 top = it->bounds.top;
+        SInt16 bottom = it->bounds.bottom;
+
+        it->spans[0].left = it->bounds.left;
+        it->spans[0].right = it->bounds.right;
+        it->count = 1;
+
+        for (SInt16 i = 0; i < it->rgnCount && it->count > 0; i++) {
+            SInt16 n = RgnRowSpans(it->rgns[i], row, it->bounds.left, it->bounds.right,
+                                   &top, &bottom, it->rowSpans, kRgnSpanMax);
+            n = IntersectSpans(it->spans, it->count, it->rowSpans, n,
+                               it->scratch, kRgnSpanMax);
+            memcpy(it->spans, it->scratch, (size_t)n * sizeof(RgnSpan));
+            it->count = n;
+        }
+
+        /* Once nothing is left the other regions need not be asked: over
+         * the band found so far, the ones already asked leave nothing */
+        it->top = top;
+        it->bottom = bottom;
+        it->y = it->bottomUp ? top : bottom;
+        if (it->count > 0) {
+            return true;
+        }
+    }
+    it->count = 0;
+    return false;
+}
+
 /* ================================================================
  * ADVANCED REGION OPERATIONS
  * ================================================================ */
@@ -916,34 +1107,13 @@ SInt16 GetRegionComplexity(RgnHandle rgn) {
         return 1;
     }
 
-    /* Count scan lines for complex regions */
+    /* Count the bands of a complex region. This used to walk scan-line
+     * data that no region here has ever held. */
+    SInt16 n;
+    const Rect *rects = RgnRects(region, &n);
     SInt16 complexity = 0;
-    UInt8 *dataPtr = (UInt8 *)region + kMinRegionSize;
-    UInt8 *endPtr = (UInt8 *)region + region->rgnSize;
-
-    while (dataPtr < endPtr) {
-        /* Bounds check: ensure we can read y value */
-        if (dataPtr + sizeof(SInt16) > endPtr) break;
-
-        SInt16 y = *(SInt16 *)dataPtr;
-        if (y == 0x7FFF) break;
-
+    for (SInt16 band = 0; band < n; band = RgnBandEnd(rects, band, n)) {
         complexity++;
-        dataPtr += sizeof(SInt16);
-
-        /* Bounds check: ensure we can read count value */
-        if (dataPtr + sizeof(SInt16) > endPtr) break;
-
-        SInt16 count = *(SInt16 *)dataPtr;
-
-        /* Reject negative counts to prevent signed-to-unsigned overflow */
-        if (count < 0) break;
-
-        /* Bounds check: ensure count won't cause buffer overflow */
-        UInt32 advance = sizeof(SInt16) + (UInt32)count * sizeof(SInt16);
-        if (dataPtr + advance > endPtr) break;
-
-        dataPtr += advance;
     }
 
     HUnlock((Handle)rgn);
@@ -1244,3 +1414,211 @@ void WM_RegionGetRect(RgnHandle rgn, SInt16 index, Rect *out) {
     }
     RgnGetRect(*rgn, index, out);
 }
+
+/* ================================================================
+ * BANDED REGION SELF-TEST
+ *
+ * Random regions built out of rectangles, with a bitmap of each alongside;
+ * every set operation is checked pixel by pixel against the bitmaps, and
+ * every result for being in the one banded form. Run by InitGraf, silent
+ * unless something is wrong.
+ * ================================================================ */
+
+enum { kRgnTestWidth = 48, kRgnTestHeight = 32, kRgnTestLeft = -7, kRgnTestTop = 3 };
+
+static Boolean g_rgnTestFailed;
+static UInt32 g_rgnTestSeed;
+
+static void RgnTestCheck(Boolean ok, const char *what) {
+    if (!ok && !g_rgnTestFailed) {
+        serial_printf("[QD] REGION SELFTEST FAILED: %s\n", what);
+        g_rgnTestFailed = true;
+    }
+}
+
+static SInt16 RgnTestRandom(SInt16 range) {
+    g_rgnTestSeed = g_rgnTestSeed * 1103515245u + 12345u;
+    return (SInt16)((g_rgnTestSeed >> 16) % (UInt32)range);
+}
+
+/* The list is sorted, banded, coalesced and within a bounding box that fits */
+static Boolean RgnTestBanded(RgnHandle rgn) {
+    Region *region = *rgn;
+    if (region->rgnSize == kMinRegionSize) return true;
+
+    SInt16 n;
+    const Rect *rects = RgnRects(region, &n);
+    Rect bbox;
+    if (n < 2 || region->rgnSize != (SInt16)(kMinRegionSize + sizeof(SInt16) + n * sizeof(Rect))) {
+        return false;
+    }
+    SetRect(&bbox, 32767, rects[0].top, -32768, rects[n - 1].bottom);
+
+    SInt16 prev = -1;
+    for (SInt16 band = 0; band < n; ) {
+        SInt16 end = band + 1;
+        while (end < n && rects[end].top == rects[band].top) end++;
+
+        for (SInt16 i = band; i < end; i++) {
+            if (EmptyRect(&rects[i]) || rects[i].bottom != rects[band].bottom) return false;
+            if (i > band && rects[i].left <= rects[i - 1].right) return false;
+            if (rects[i].left < bbox.left) bbox.left = rects[i].left;
+            if (rects[i].right > bbox.right) bbox.right = rects[i].right;
+        }
+        if (prev >= 0) {
+            if (rects[band].top < rects[prev].bottom) return false;
+            Boolean same = (rects[band].top == rects[prev].bottom && end - band == band - prev);
+            for (SInt16 i = 0; same && i < end - band; i++) {
+                same = (rects[band + i].left == rects[prev + i].left &&
+                        rects[band + i].right == rects[prev + i].right);
+            }
+            if (same) return false;
+        }
+        prev = band;
+        band = end;
+    }
+    return memcmp(&bbox, &region->rgnBBox, sizeof(Rect)) == 0;
+}
+
+/* Does the region hold exactly the pixels set in the bitmap? */
+static Boolean RgnTestMatches(RgnHandle rgn, UInt8 bits[kRgnTestHeight][kRgnTestWidth]) {
+    for (SInt16 y = -1; y <= kRgnTestHeight; y++) {
+        for (SInt16 x = -1; x <= kRgnTestWidth; x++) {
+            Boolean want = (y >= 0 && y < kRgnTestHeight && x >= 0 && x < kRgnTestWidth &&
+                            bits[y][x]);
+            Point pt;
+            pt.v = kRgnTestTop + y;
+            pt.h = kRgnTestLeft + x;
+            if (PtInRgn(pt, rgn) != want) return false;
+        }
+    }
+    return RgnTestBanded(rgn);
+}
+
+static void RgnTestBuild(RgnHandle rgn, RgnHandle scratch, UInt8 bits[kRgnTestHeight][kRgnTestWidth]) {
+    SInt16 pieces = 1 + RgnTestRandom(24);
+
+    SetEmptyRgn(rgn);
+    memset(bits, 0, kRgnTestHeight * kRgnTestWidth);
+    for (SInt16 i = 0; i < pieces; i++) {
+        SInt16 l = RgnTestRandom(kRgnTestWidth), t = RgnTestRandom(kRgnTestHeight);
+        SInt16 r = l + 1 + RgnTestRandom(12), b = t + 1 + RgnTestRandom(10);
+        if (r > kRgnTestWidth) r = kRgnTestWidth;
+        if (b > kRgnTestHeight) b = kRgnTestHeight;
+
+        SetRectRgn(scratch, kRgnTestLeft + l, kRgnTestTop + t, kRgnTestLeft + r, kRgnTestTop + b);
+        Boolean cut = (i > 0 && RgnTestRandom(4) == 0);
+        if (cut) DiffRgn(rgn, scratch, rgn);
+        else UnionRgn(rgn, scratch, rgn);
+        for (SInt16 y = t; y < b; y++) {
+            for (SInt16 x = l; x < r; x++) bits[y][x] = !cut;
+        }
+    }
+}
+
+void QuickDraw_RegionSelfTest(void) {
+    static UInt8 bits[3][kRgnTestHeight][kRgnTestWidth];
+    RgnHandle a = NewRgn(), b = NewRgn(), c = NewRgn(), d = NewRgn();
+
+    g_rgnTestFailed = false;
+    g_rgnTestSeed = 7;
+    if (!a || !b || !c || !d) {
+        RgnTestCheck(false, "no memory");
+    }
+
+    for (int trial = 0; trial < 24 && !g_rgnTestFailed; trial++) {
+        RgnTestBuild(a, c, bits[0]);
+        RgnTestCheck(RgnTestMatches(a, bits[0]), "built region");
+        RgnTestBuild(b, c, bits[1]);
+
+        for (int op = kRgnOpSect; op <= kRgnOpXor; op++) {
+            for (SInt16 y = 0; y < kRgnTestHeight; y++) {
+                for (SInt16 x = 0; x < kRgnTestWidth; x++) {
+                    bits[2][y][x] = RgnOpInside(op, bits[0][y][x], bits[1][y][x]);
+                }
+            }
+            switch (op) {
+                case kRgnOpSect:  SectRgn(a, b, c);  break;
+                case kRgnOpUnion: UnionRgn(a, b, c); break;
+                case kRgnOpDiff:  DiffRgn(a, b, c);  break;
+                default:          XorRgn(a, b, c);   break;
+            }
+            RgnTestCheck(RgnTestMatches(c, bits[2]), "set operation");
+
+            /* The same answer in place, and compared byte for byte */
+            CopyRgn(a, d);
+            switch (op) {
+                case kRgnOpSect:  SectRgn(d, b, d);  break;
+                case kRgnOpUnion: UnionRgn(d, b, d); break;
+                case kRgnOpDiff:  DiffRgn(d, b, d);  break;
+                default:          XorRgn(d, b, d);   break;
+            }
+            RgnTestCheck(EqualRgn(c, d), "in place");
+        }
+
+        /* RectInRgn and the span iterator against the bitmap of A */
+        for (int probe = 0; probe < 16; probe++) {
+            SInt16 l = RgnTestRandom(kRgnTestWidth), t = RgnTestRandom(kRgnTestHeight);
+            SInt16 r = l + 1 + RgnTestRandom(8), bt = t + 1 + RgnTestRandom(8);
+            if (r > kRgnTestWidth) r = kRgnTestWidth;
+            if (bt > kRgnTestHeight) bt = kRgnTestHeight;
+
+            Boolean any = false;
+            for (SInt16 y = t; y < bt; y++) {
+                for (SInt16 x = l; x < r; x++) any = any || bits[0][y][x];
+            }
+            Rect box;
+            SetRect(&box, kRgnTestLeft + l, kRgnTestTop + t, kRgnTestLeft + r, kRgnTestTop + bt);
+            RgnTestCheck(RectInRgn(&box, a) == any, "RectInRgn");
+        }
+
+        Rect all;
+        SetRect(&all, kRgnTestLeft, kRgnTestTop,
+                kRgnTestLeft + kRgnTestWidth, kRgnTestTop + kRgnTestHeight);
+        memcpy(bits[2], bits[0], sizeof(bits[2]));
+        RgnSpanIter *it = (RgnSpanIter *)NewPtr(sizeof(RgnSpanIter));
+        if (it) {
+            RgnSpanBegin(it, &all, a, b, NULL, (trial & 1) != 0);
+            while (RgnSpanNext(it)) {
+                for (SInt16 y = it->top; y < it->bottom; y++) {
+                    for (SInt16 k = 0; k < it->count; k++) {
+                        for (SInt16 x = it->spans[k].left; x < it->spans[k].right; x++) {
+                            UInt8 *px = &bits[2][y - kRgnTestTop][x - kRgnTestLeft];
+                            RgnTestCheck(*px && bits[1][y - kRgnTestTop][x - kRgnTestLeft],
+                                         "span outside both regions");
+                            *px = 0;
+                        }
+                    }
+                }
+            }
+            for (SInt16 y = 0; y < kRgnTestHeight; y++) {
+                for (SInt16 x = 0; x < kRgnTestWidth; x++) {
+                    RgnTestCheck(!(bits[2][y][x] && bits[1][y][x]), "span missed");
+                }
+            }
+            DisposePtr((Ptr)it);
+        }
+    }
+
+    /* A 64x64 checkerboard is 2048 rectangles - sixteen times the old cap,
+     * which would have made it its bounding box */
+    if (!g_rgnTestFailed) {
+        SetEmptyRgn(a);
+        SetEmptyRgn(b);
+        for (SInt16 i = 0; i < 64; i += 2) {
+            SetRectRgn(c, 0, i, 64, i + 1);
+            UnionRgn(a, c, a);
+            SetRectRgn(c, i, 0, i + 1, 64);
+            UnionRgn(b, c, b);
+        }
+        XorRgn(a, b, c);
+        Point on = { 2, 1 }, off = { 63, 63 };
+        RgnTestCheck(WM_RegionRectCount(c) == 2048 && RgnTestBanded(c) &&
+                     PtInRgn(on, c) && !PtInRgn(off, c), "checkerboard");
+    }
+
+    if (a) DisposeRgn(a);
+    if (b) DisposeRgn(b);
+    if (c) DisposeRgn(c);
+    if (d) DisposeRgn(d);
+}
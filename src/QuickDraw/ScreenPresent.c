@@ -0,0 +1,377 @@
+/*
+ * ScreenPresent.c - Frame presentation for QuickDraw
+ *
+ * QDPlatform_UpdateScreen and QDPlatform_FlushScreen used to be a delay
+ * loop: fifty reads of the VGA input status register, each one an I/O exit
+ * under QEMU, and nothing else. Drawing went straight into the live
+ * framebuffer, so the display showed every intermediate state - the white
+ * backfill before a window's content, the desktop before the window dragged
+ * over it - and tore wherever the scanout caught a half-drawn frame.
+ *
+ * This module gives QuickDraw a presentation step:
+ *
+ *   - drawing marks the screen pixels it changed (QDPresent_MarkDirty and
+ *     QDPresent_MarkPixels) in a grid of 32x32-pixel tiles. Marking is a
+ *     few shifts and byte stores, cheap enough for QDPlatform_SetPixel;
+ *   - QDPresent_Frame presents at most once per frame (60 Hz, timed with
+ *     Microseconds() - the PIT/TSC on x86, the generic timer on ARM - not
+ *     with port reads). Runs of dirty tiles become rectangles, and only
+ *     those are copied;
+ *   - with QD_DOUBLE_BUFFER=1 QuickDraw draws into a back buffer. The
+ *     "framebuffer" global points at it from InitGraf on, so every drawing
+ *     path follows without change, and the scanout buffer only ever
+ *     receives whole presented rectangles.
+ *
+ * Not every writer in the tree goes through QuickDraw; the menu code, the
+ * save-under behind menus, the bezel corners, the Chicago glyph blitter,
+ * the Finder's icons and drag outline and the startup logo write the
+ * framebuffer directly, and each marks what it wrote itself. Anything that
+ * writes without marking is in neither the back buffer copy nor the
+ * rectangles handed to the display, and stays stale on screen until
+ * something else covers it - that is a bug in the writer, and shows as one.
+ * QD_PRESENT_SWEEP=1 (a debugging aid, off by default) adds a whole-screen
+ * present once a second (kPresentSweepUs), to tell a missing mark from a
+ * drawing bug; it costs about 2MB of memcpy a second at 800x600 when
+ * double-buffered.
+ *
+ * Single-buffered (the default) there is nothing to copy. Either way a
+ * frame ends in hal_framebuffer_present_rects with the rectangles it
+ * covered, which is where a display that needs an explicit flush
+ * (virtio-gpu) transfers just those.
+ *
+ * Statistics: QDPresent_GetStats, and the 'p' serial debug command prints
+ * them (QDPresent_DumpStats).
+ *
+ * Copyright (c) 2025 - System 7.1 Portable Project
+ */
+
+#include "SystemTypes.h"
+#include "System71StdLib.h"
+#include "QuickDraw/QuickDrawPlatform.h"
+#include "TimeManager/TimeBase.h"
+#include "MemoryMgr/MemoryManager.h"
+#include "Platform/include/boot.h"
+#include <string.h>
+
+extern void* framebuffer;
+extern uint32_t fb_width;
+extern uint32_t fb_height;
+extern uint32_t fb_pitch;
+
+#ifdef WM_COMPOSITOR
+extern GrafPtr g_currentPort;
+extern void WM_CompositorNoteScreenDraw(GrafPtr port);   /* WindowCompositor.c */
+#endif
+
+#define kPresentFrameUs     16667u     /* 60 Hz */
+#ifdef QD_PRESENT_SWEEP
+#define kPresentSweepUs     1000000u   /* full present once a second */
+#endif
+#define kPresentIdleUs      1000000u   /* longer gaps are idle, not frame time */
+#define kPresentTileShift   5          /* 32x32-pixel dirty tiles */
+#define kPresentMaxTilesH   128        /* screens up to 4096 pixels wide... */
+#define kPresentMaxTilesV   128        /* ...and high */
+#define kPresentMaxRects    16         /* more go to the HAL as one box */
+
+static UInt8   gDirty[kPresentMaxTilesV][kPresentMaxTilesH];
+static SInt32  gDirtyTop = -1;         /* tile rows holding dirty tiles, or -1 */
+static SInt32  gDirtyBottom = -1;
+static Boolean gDirtyAll = false;
+static UInt32  gTilesH, gTilesV;
+
+static hal_damage_rect_t gRects[kPresentMaxRects];   /* this frame's, for the HAL */
+static UInt32  gRectCount;
+static Boolean gRectOverflow;
+
+static UInt8*  gScanout = NULL;        /* what the display reads */
+static UInt8*  gBackBuffer = NULL;     /* where QuickDraw draws, double-buffered */
+static Boolean gReady = false;
+
+static UInt32  gLastFrameUs = 0;
+static UInt32  gLastSweepUs = 0;
+static QDPresentStats gStats;
+
+static UInt32 PresentNowUs(void) {
+    UnsignedWide now;
+    Microseconds(&now);
+    return now.lo;   /* differences wrap correctly for 71 minutes */
+}
+
+void QDPresent_Init(void) {
+    if (gReady || !framebuffer || fb_width == 0 || fb_height == 0) return;
+
+    gTilesH = (fb_width + (1u << kPresentTileShift) - 1) >> kPresentTileShift;
+    gTilesV = (fb_height + (1u << kPresentTileShift) - 1) >> kPresentTileShift;
+    if (gTilesH > kPresentMaxTilesH || gTilesV > kPresentMaxTilesV) {
+        /* Too big for the grid: keep presenting, always as a whole screen */
+        gTilesH = 0;
+        gTilesV = 0;
+    }
+
+    gScanout = (UInt8*)framebuffer;
+    memset(&gStats, 0, sizeof(gStats));
+
+#ifdef QD_DOUBLE_BUFFER
+    {
+        Size bytes = (Size)fb_pitch * (Size)fb_height;
+        gBackBuffer = (UInt8*)NewPtr(bytes);
+        if (gBackBuffer) {
+            /* Start from what the boot path already put on screen */
+            memcpy(gBackBuffer, gScanout, (size_t)bytes);
+            framebuffer = gBackBuffer;
+            gStats.doubleBuffered = true;
+        } else {
+            serial_puts("[PRESENT] No memory for a back buffer; drawing to the screen\n");
+        }
+    }
+#endif
+
+    gLastSweepUs = PresentNowUs();
+    gReady = true;
+}
+
+Boolean QDPresent_IsDoubleBuffered(void) {
+    return gBackBuffer != NULL;
+}
+
+void QDPresent_MarkAll(void) {
+    gDirtyAll = true;
+}
+
+void QDPresent_MarkDirty(SInt32 left, SInt32 top, SInt32 right, SInt32 bottom) {
+    if (!gReady) return;
+#ifdef WM_COMPOSITOR
+    /* A window's backing store has to hear of drawing outside its updates */
+    WM_CompositorNoteScreenDraw(g_currentPort);
+#endif
+    if (gDirtyAll) return;
+
+    if (left < 0) left = 0;
+    if (top < 0) top = 0;
+    if (right > (SInt32)fb_width) right = (SInt32)fb_width;
+    if (bottom > (SInt32)fb_height) bottom = (SInt32)fb_height;
+    if (left >= right || top >= bottom) return;
+
+    if (gTilesH == 0) {
+        gDirtyAll = true;
+        return;
+    }
+
+    SInt32 c0 = left >> kPresentTileShift;
+    SInt32 c1 = (right - 1) >> kPresentTileShift;
+    SInt32 r0 = top >> kPresentTileShift;
+    SInt32 r1 = (bottom - 1) >> kPresentTileShift;
+
+    for (SInt32 r = r0; r <= r1; r++) {
+        memset(&gDirty[r][c0], 1, (size_t)(c1 - c0 + 1));
+    }
+    if (gDirtyTop < 0 || r0 < gDirtyTop) gDirtyTop = r0;
+    if (r1 > gDirtyBottom) gDirtyBottom = r1;
+}
+
+/* For writers that hold a pixel address rather than coordinates. Anything
+ * outside the screen - a GWorld, a window's offscreen buffer - is ignored. */
+void QDPresent_MarkPixels(const void* firstPixel, SInt32 width, SInt32 height) {
+    uintptr_t base = (uintptr_t)framebuffer;
+    uintptr_t p = (uintptr_t)firstPixel;
+
+    if (!gReady || !framebuffer || p < base) return;
+    uintptr_t offset = p - base;
+    if (offset >= (uintptr_t)fb_pitch * fb_height) return;
+
+    SInt32 y = (SInt32)(offset / fb_pitch);
+    SInt32 x = (SInt32)((offset % fb_pitch) / 4u);
+    QDPresent_MarkDirty(x, y, x + width, y + height);
+}
+
+/* Copy one rectangle of the back buffer to the scanout buffer */
+static void PresentCopyRect(SInt32 left, SInt32 top, SInt32 right, SInt32 bottom) {
+    size_t bytes = (size_t)(right - left) * 4u;
+    size_t offset = (size_t)top * fb_pitch + (size_t)left * 4u;
+
+    for (SInt32 y = top; y < bottom; y++) {
+        memcpy(gScanout + offset, gBackBuffer + offset, bytes);
+        offset += fb_pitch;
+    }
+    gStats.kbCopied += (UInt32)((bytes * (size_t)(bottom - top)) >> 10);
+}
+
+/* Record a presented rectangle for hal_framebuffer_present_rects. A run
+ * of tiles directly under one from the row above extends it, so a window
+ * becomes one rectangle rather than one per tile row. */
+static void PresentAddRect(SInt32 left, SInt32 top, SInt32 right, SInt32 bottom) {
+    gStats.rects++;
+    if (gRectOverflow) return;
+
+    for (UInt32 i = 0; i < gRectCount; i++) {
+        hal_damage_rect_t* r = &gRects[i];
+        if ((SInt32)r->x == left && (SInt32)(r->x + r->width) == right &&
+            (SInt32)(r->y + r->height) == top) {
+            r->height += (uint32_t)(bottom - top);
+            return;
+        }
+    }
+    if (gRectCount == kPresentMaxRects) {
+        gRectOverflow = true;   /* the HAL gets the whole screen */
+        return;
+    }
+    gRects[gRectCount].x = (uint32_t)left;
+    gRects[gRectCount].y = (uint32_t)top;
+    gRects[gRectCount].width = (uint32_t)(right - left);
+    gRects[gRectCount].height = (uint32_t)(bottom - top);
+    gRectCount++;
+}
+
+/* Turn the dirty tiles into rectangles - one per run of tiles in a tile
+ * row - present them, and clear the grid. */
+static void PresentDirtyTiles(Boolean copy) {
+    const SInt32 tile = 1 << kPresentTileShift;
+
+    for (SInt32 r = gDirtyTop; r >= 0 && r <= gDirtyBottom; r++) {
+        SInt32 c = 0;
+        while (c < (SInt32)gTilesH) {
+            if (!gDirty[r][c]) {
+                c++;
+                continue;
+            }
+            SInt32 run = c;
+            while (run < (SInt32)gTilesH && gDirty[r][run]) {
+                gDirty[r][run] = 0;
+                run++;
+            }
+            SInt32 right = run * tile;
+            SInt32 bottom = (r + 1) * tile;
+            if (right > (SInt32)fb_width) right = (SInt32)fb_width;
+            if (bottom > (SInt32)fb_height) bottom = (SInt32)fb_height;
+            if (copy) {
+                PresentCopyRect(c * tile, r * tile, right, bottom);
+            }
+            PresentAddRect(c * tile, r * tile, right, bottom);
+            c = run;
+        }
+    }
+    gDirtyTop = -1;
+    gDirtyBottom = -1;
+}
+
+static void PresentClearTiles(void) {
+    if (gDirtyTop >= 0) {
+        for (SInt32 r = gDirtyTop; r <= gDirtyBottom; r++) {
+            memset(gDirty[r], 0, gTilesH);
+        }
+    }
+    gDirtyTop = -1;
+    gDirtyBottom = -1;
+}
+
+/*
+ * Present a frame if one is due.
+ *
+ * wait=false is the main loop's once-per-iteration call: it presents only
+ * when a frame period has passed since the last one. wait=true is for
+ * callers that need the screen current before they go on (drag and grow
+ * loops, a screen flash); it waits out the rest of the frame period on the
+ * timer, which paces those loops at the display rate, then presents.
+ */
+Boolean QDPresent_Frame(Boolean wait) {
+    if (!gReady) {
+        QDPresent_Init();
+        if (!gReady) return false;
+    }
+
+    Boolean dirty = gDirtyAll || gDirtyTop >= 0;
+    UInt32 now = PresentNowUs();
+
+    /* A clock that is not running (Time Manager not up yet) reads 0; never
+     * wait on it. */
+    if (now != 0 && gLastFrameUs != 0 &&
+        (UInt32)(now - gLastFrameUs) < kPresentFrameUs) {
+        if (!wait || !dirty) {
+            if (dirty) gStats.coalesced++;
+            return false;
+        }
+        UInt32 start = now;
+        while ((UInt32)(now - gLastFrameUs) < kPresentFrameUs &&
+               (UInt32)(now - start) < kPresentFrameUs) {
+            now = PresentNowUs();
+        }
+        gStats.waitUs += now - start;
+    }
+
+#ifdef QD_PRESENT_SWEEP
+    Boolean sweep = (UInt32)(now - gLastSweepUs) >= kPresentSweepUs;
+#else
+    Boolean sweep = false;
+#endif
+    if (!dirty && !sweep) {
+        return false;   /* nothing new to show */
+    }
+
+    if (gLastFrameUs != 0 && now != 0) {
+        UInt32 frameUs = now - gLastFrameUs;
+        if (frameUs < kPresentIdleUs) {
+            gStats.lastFrameUs = frameUs;
+            if (gStats.minFrameUs == 0 || frameUs < gStats.minFrameUs) gStats.minFrameUs = frameUs;
+            if (frameUs > gStats.maxFrameUs) gStats.maxFrameUs = frameUs;
+            gStats.avgFrameUs = gStats.avgFrameUs ?
+                                gStats.avgFrameUs - (gStats.avgFrameUs >> 4) + (frameUs >> 4) :
+                                frameUs;
+        }
+    }
+    gLastFrameUs = now;
+
+    gRectCount = 0;
+    gRectOverflow = false;
+    if (gBackBuffer) {
+        if (gDirtyAll || sweep) {
+            PresentClearTiles();
+            PresentCopyRect(0, 0, (SInt32)fb_width, (SInt32)fb_height);
+            gStats.rects++;
+            gRectOverflow = true;
+            if (sweep && !gDirtyAll) gStats.sweeps++;
+            gLastSweepUs = now;
+        } else {
+            PresentDirtyTiles(true);
+        }
+    } else if (gDirtyAll || sweep) {
+        PresentClearTiles();
+        gStats.rects++;
+        gRectOverflow = true;
+        if (sweep && !gDirtyAll) gStats.sweeps++;
+        gLastSweepUs = now;
+    } else {
+        PresentDirtyTiles(false);
+    }
+    gDirtyAll = false;
+
+    if (gRectOverflow) {
+        hal_framebuffer_present_rects(NULL, 0);
+    } else {
+        hal_framebuffer_present_rects(gRects, gRectCount);
+    }
+
+    UInt32 took = PresentNowUs() - now;
+    gStats.lastPresentUs = took;
+    if (took > gStats.maxPresentUs) gStats.maxPresentUs = took;
+    gStats.frames++;
+    return true;
+}
+
+void QDPresent_GetStats(QDPresentStats* stats) {
+    if (!stats) return;
+    memcpy(stats, &gStats, sizeof(*stats));
+}
+
+void QDPresent_DumpStats(void) {
+    serial_printf("[PRESENT] %s, %lu frames, %lu coalesced, %lu sweeps\n",
+                  gStats.doubleBuffered ? "double-buffered" : "single-buffered",
+                  (unsigned long)gStats.frames, (unsigned long)gStats.coalesced,
+                  (unsigned long)gStats.sweeps);
+    serial_printf("[PRESENT] frame us: last %lu min %lu avg %lu max %lu; waited %lu us\n",
+                  (unsigned long)gStats.lastFrameUs, (unsigned long)gStats.minFrameUs,
+                  (unsigned long)gStats.avgFrameUs, (unsigned long)gStats.maxFrameUs,
+                  (unsigned long)gStats.waitUs);
+    serial_printf("[PRESENT] present us: last %lu max %lu; %lu rects, %lu KB copied\n",
+                  (unsigned long)gStats.lastPresentUs, (unsigned long)gStats.maxPresentUs,
+                  (unsigned long)gStats.rects, (unsigned long)gStats.kbCopied);
+}
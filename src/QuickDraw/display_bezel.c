@@ -1,6 +1,7 @@
 #include <stdint.h>
 
 #include "QuickDraw/DisplayBezel.h"
+#include "QuickDraw/QuickDrawPlatform.h"  /* QDPresent_MarkDirty */
 #ifdef ENABLE_GESTALT
 #include "Gestalt/Gestalt.h"
 #endif
@@ -109,4 +110,10 @@ void QD_DrawCRTBezel(void) {
             }
         }
     }
+    /* Written directly, so name the four corners for presentation */
+    QDPresent_MarkDirty(0, 0, cornerRadius, cornerRadius);
+    QDPresent_MarkDirty((SInt32)fb_width - cornerRadius, 0, (SInt32)fb_width, cornerRadius);
+    QDPresent_MarkDirty(0, (SInt32)fb_height - cornerRadius, cornerRadius, (SInt32)fb_height);
+    QDPresent_MarkDirty((SInt32)fb_width - cornerRadius, (SInt32)fb_height - cornerRadius,
+                        (SInt32)fb_width, (SInt32)fb_height);
 }
@@ -189,9 +189,14 @@ static void InstallTestResources(void)
  */
 #define SEG_TEST_FAILED(what) do { \
     extern void serial_puts(const char* s); \
-    serial_puts("[SegmentLoader] smoke test FAILED: " what "\n"); \
+    serial_puts("[SegmentLoader] smoke test FAILED ("); \
+    serial_puts(gSegTestBackend); \
+    serial_puts("): " what "\n"); \
 } while (0)
 
+/* The CPU backend the test is running on; it runs once on each. */
+static const char* gSegTestBackend = "m68k_interp";
+
 
 /*
  * Smoke Checks - Validate A5 World Invariants
@@ -370,12 +375,10 @@ OSErr Trace_TrapHandler(void* context, CPUAddr* pc, CPUAddr* registers)
 /*
  * Test Boot Entry Point
  */
+static void SegmentLoader_TestBackend(const char* backendName);
+
 void SegmentLoader_TestBoot(void)
 {
-    OSErr err;
-    SegmentLoaderContext* ctx;
-    ProcessControlBlock testPCB;
-    CPUAddr entry;
 
     SEG_LOG_INFO("");
     SEG_LOG_INFO("========================================");
@@ -399,6 +402,33 @@ void SegmentLoader_TestBoot(void)
 
     SEG_LOG_INFO("Verified test resources via RM: CODE 0=%p, CODE 1=%p, CODE 2=%p", h0, h1, h2);
 
+    /* The same program on each backend that can run it: they share the
+     * loader, traps and address space, and differ only in how code runs. */
+    SegmentLoader_TestBackend("m68k_interp");
+    if (CPUBackend_Get("m68k_threaded")) {
+        SegmentLoader_TestBackend("m68k_threaded");
+    }
+
+#ifdef M68K_BENCHMARK
+    /* The program above is five instructions and two traps - too short to
+     * time - so the rate comes from the interpreter's own test programs. */
+    M68K_Benchmark();
+#endif
+}
+
+/*
+ * Load and run the test program on one backend.
+ */
+static void SegmentLoader_TestBackend(const char* backendName)
+{
+    OSErr err;
+    SegmentLoaderContext* ctx;
+    ProcessControlBlock testPCB;
+    CPUAddr entry;
+
+    gSegTestBackend = backendName;
+    gTraceSegmentRan = false;
+
     /* Create minimal PCB for test */
     memset(&testPCB, 0, sizeof(testPCB));
     testPCB.processID.lowLongOfPSN = 9999;  // Test PSN
@@ -408,7 +438,7 @@ void SegmentLoader_TestBoot(void)
 
     /* Initialize segment loader */
     SEG_LOG_INFO("Initializing segment loader...");
-    err = SegmentLoader_Initialize(&testPCB, "m68k_interp", &ctx);
+    err = SegmentLoader_Initialize(&testPCB, backendName, &ctx);
     if (err != noErr) {
         SEG_TEST_FAILED("SegmentLoader_Initialize returned");
         SEG_LOG_ERROR("FAIL: SegmentLoader_Initialize returned %d", err);
@@ -514,8 +544,9 @@ void SegmentLoader_TestBoot(void)
                 if (got != 0x00000904) {
                     char rb[150];
                     snprintf(rb, sizeof(rb),
-                             "[SegmentLoader] smoke test FAILED: low memory reference "
-                             "rewritten to 0x%08X, was 0x00000904\n", (unsigned)got);
+                             "[SegmentLoader] smoke test FAILED (%s): low memory reference "
+                             "rewritten to 0x%08X, was 0x00000904\n", gSegTestBackend,
+                             (unsigned)got);
                     serial_puts(rb);
                 }
             }
@@ -527,8 +558,9 @@ void SegmentLoader_TestBoot(void)
                 if (got != 0x00020000) {
                     char rb[150];
                     snprintf(rb, sizeof(rb),
-                             "[SegmentLoader] smoke test FAILED: absolute operand "
-                             "rewritten to 0x%08X, was 0x00020000\n", (unsigned)got);
+                             "[SegmentLoader] smoke test FAILED (%s): absolute operand "
+                             "rewritten to 0x%08X, was 0x00020000\n", gSegTestBackend,
+                             (unsigned)got);
                     serial_puts(rb);
                 }
             }
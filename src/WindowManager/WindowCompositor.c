@@ -0,0 +1,488 @@
+/*
+ * WindowCompositor.c - Per-window backing stores for the Window Manager
+ *
+ * Without a compositor the screen is the only copy of a window's pixels.
+ * Anything that uncovers part of a window - moving the window in front,
+ * bringing the window forward, hiding a dialog over it - has to ask the
+ * application to draw that part again through an update event. For a Finder
+ * window that means re-walking the catalog and redrawing every icon, just
+ * because something was dragged across it.
+ *
+ * With the compositor each window keeps a retained GWorld the size of its
+ * structure region - frame, title bar and content - and a region recording
+ * which of those pixels are known to be right. The damage pass
+ * (WM_RepaintDamage) copies uncovered pixels back from the store, and only
+ * what the store does not hold falls through to PaintOne and an update event.
+ * Moving, bringing forward and showing a window become memcpy work
+ * proportional to the area uncovered, without the application taking part.
+ *
+ * The store is filled from two places:
+ *
+ *   - the screen. Whatever a window shows on screen is by definition its
+ *     current image, so just before anything changes geometry or stacking
+ *     (WM_CompositorCapture) the visible pixels in the affected area are
+ *     copied in. This picks up chrome and anything drawn straight to the
+ *     framebuffer outside an update;
+ *   - EndUpdate. The offscreen buffer holds the freshly drawn update region
+ *     in full, including parts covered by other windows, so it goes into the
+ *     store before the buffer is reused (WM_CompositorContentDrawn).
+ *
+ * and emptied where it may have gone stale: chrome repainted for a highlight
+ * change (WM_CompositorInvalidateChrome), any update still pending, which
+ * is never copied from the store at all, and the covered part of a window
+ * that drew outside an update (WM_CompositorNoteScreenDraw). Such drawing
+ * goes straight to the screen clipped to what is visible, so the store keeps
+ * the old pixels wherever another window was in front; that part gets an
+ * ordinary update instead once it is uncovered.
+ *
+ * Build with WM_COMPOSITOR=1 to include it; WM_SetCompositing switches it at
+ * run time, and WM_CompositorStoreBytes reports what the stores cost.
+ *
+ * Copyright (c) 2025 - System 7.1 Portable Project
+ */
+
+#include "SystemTypes.h"
+#include "WindowManager/WindowManager.h"
+#include "WindowManager/WindowManagerInternal.h"
+#include "WindowManager/WindowRegions.h"
+#include "QuickDraw/QuickDraw.h"
+#include "QuickDraw/ColorQuickDraw.h"
+#include "QuickDraw/QuickDrawPlatform.h"
+#include "MemoryMgr/MemoryManager.h"
+#include <string.h>
+
+#ifdef WM_COMPOSITOR
+
+extern void* framebuffer;
+extern uint32_t fb_width, fb_height, fb_pitch;
+
+/* One retained store per window. The store's (0,0) is the top-left of the
+ * window's structure region, so it moves with the window for free. */
+typedef struct WMBackingStore {
+    WindowPtr  window;
+    GWorldPtr  gworld;
+    RgnHandle  valid;     /* store coordinates: pixels known to be right */
+    SInt16     width;
+    SInt16     height;
+    Boolean    drewOutside;   /* drew on screen outside an update since the
+                               * covered part was last dropped */
+} WMBackingStore;
+
+#define kWMMaxBackingStores 32
+
+static WMBackingStore gStores[kWMMaxBackingStores];
+static Boolean gCompositing = true;
+static GrafPtr gNotedPort = NULL;      /* last port WM_CompositorNoteScreenDraw saw */
+static Boolean gRestoring = false;     /* WM_StoreCopy writing to the screen */
+
+static void WM_StoreRelease(WMBackingStore* s) {
+    if (s->gworld) DisposeGWorld(s->gworld);
+    if (s->valid) DisposeRgn(s->valid);
+    memset(s, 0, sizeof(*s));
+}
+
+static Boolean WM_StrucOrigin(WindowPtr window, Rect* bounds) {
+    if (!window->strucRgn || !*window->strucRgn) return false;
+    Rect* src = &(*window->strucRgn)->rgnBBox;   /* field copy for ARM64 */
+    bounds->top = src->top;
+    bounds->left = src->left;
+    bounds->bottom = src->bottom;
+    bounds->right = src->right;
+    return bounds->right > bounds->left && bounds->bottom > bounds->top;
+}
+
+/* Find a window's store. A store whose size no longer matches the window
+ * (SizeWindow, ZoomWindow) holds nothing useful and is dropped. */
+static WMBackingStore* WM_StoreFor(WindowPtr window, Boolean create) {
+    Rect bounds;
+    WMBackingStore* freeSlot = NULL;
+
+    if (!WM_StrucOrigin(window, &bounds)) return NULL;
+    SInt16 width = bounds.right - bounds.left;
+    SInt16 height = bounds.bottom - bounds.top;
+
+    for (int i = 0; i < kWMMaxBackingStores; i++) {
+        WMBackingStore* s = &gStores[i];
+        if (s->window == window) {
+            if (s->width == width && s->height == height) return s;
+            WM_StoreRelease(s);
+            freeSlot = s;
+            break;
+        }
+        if (!s->window && !freeSlot) freeSlot = s;
+    }
+    if (!create || !freeSlot) return NULL;
+
+    Rect storeRect;
+    SetRect(&storeRect, 0, 0, width, height);
+    if (NewGWorld(&freeSlot->gworld, 32, &storeRect, NULL, NULL, 0) != noErr) {
+        freeSlot->gworld = NULL;
+        return NULL;   /* out of memory: this window simply repaints */
+    }
+    freeSlot->valid = NewRgn();
+    if (!freeSlot->valid) {
+        WM_StoreRelease(freeSlot);
+        return NULL;
+    }
+    freeSlot->window = window;
+    freeSlot->width = width;
+    freeSlot->height = height;
+    return freeSlot;
+}
+
+/* Copy the pixels of rgn (global coordinates) between the screen and a store
+ * whose top-left sits at (originH, originV) on screen. */
+static void WM_StoreCopy(WMBackingStore* s, SInt16 originH, SInt16 originV,
+                         RgnHandle rgn, Boolean toScreen) {
+    PixMapHandle pmh = GetGWorldPixMap(s->gworld);
+    if (!pmh || !*pmh || !(*pmh)->baseAddr || !framebuffer) return;
+
+    UInt8* store = (UInt8*)(*pmh)->baseAddr;
+    size_t storeRowBytes = (size_t)((*pmh)->rowBytes & 0x3FFF);
+    UInt8* screen = (UInt8*)framebuffer;
+
+    SInt16 count = EmptyRgn(rgn) ? 0 : WM_RegionRectCount(rgn);
+    for (SInt16 i = 0; i < count; i++) {
+        Rect r;
+        WM_RegionGetRect(rgn, i, &r);
+
+        /* Clamp to both the screen and the store */
+        if (r.left < 0) r.left = 0;
+        if (r.top < 0) r.top = 0;
+        if (r.right > (SInt16)fb_width) r.right = (SInt16)fb_width;
+        if (r.bottom > (SInt16)fb_height) r.bottom = (SInt16)fb_height;
+        if (r.left < originH) r.left = originH;
+        if (r.top < originV) r.top = originV;
+        if (r.right > originH + s->width) r.right = originH + s->width;
+        if (r.bottom > originV + s->height) r.bottom = originV + s->height;
+        if (r.left >= r.right || r.top >= r.bottom) continue;
+
+        size_t bytes = (size_t)(r.right - r.left) * 4u;
+        if (toScreen) {
+            gRestoring = true;   /* not the current port drawing */
+            QDPresent_MarkDirty(r.left, r.top, r.right, r.bottom);
+            gRestoring = false;
+        }
+        for (SInt16 y = r.top; y < r.bottom; y++) {
+            UInt8* fbRow = screen + (size_t)y * fb_pitch + (size_t)r.left * 4u;
+            UInt8* stRow = store + (size_t)(y - originV) * storeRowBytes +
+                           (size_t)(r.left - originH) * 4u;
+            if (toScreen) {
+                memcpy(fbRow, stRow, bytes);
+            } else {
+                memcpy(stRow, fbRow, bytes);
+            }
+        }
+    }
+}
+
+/* valid (store coordinates) op= rgn (global coordinates) */
+static void WM_StoreMarkValid(WMBackingStore* s, SInt16 originH, SInt16 originV,
+                              RgnHandle rgn, Boolean valid) {
+    AutoRgnHandle local = WM_NewAutoRgn();
+    if (!local.rgn) {
+        SetEmptyRgn(s->valid);   /* cannot say which part - trust none of it */
+        return;
+    }
+    CopyRgn(rgn, local.rgn);
+    OffsetRgn(local.rgn, -originH, -originV);
+    if (valid) {
+        UnionRgn(s->valid, local.rgn, s->valid);
+    } else {
+        DiffRgn(s->valid, local.rgn, s->valid);
+    }
+    WM_DisposeAutoRgn(&local);
+}
+
+/* For each window that drew outside an update since the last call, stop
+ * trusting the part of its content other windows cover. The stacking is the
+ * one the drawing saw: anything that changes it captures first, and
+ * WM_CompositorCapture starts here. */
+static void WM_StoreDropDrawnOutside(void) {
+    WindowManagerState* wmState = GetWindowManagerState();
+
+    gNotedPort = NULL;
+    if (!wmState) return;
+
+    for (int i = 0; i < kWMMaxBackingStores; i++) {
+        WMBackingStore* s = &gStores[i];
+        Rect origin;
+        if (!s->window || !s->drewOutside) continue;
+        s->drewOutside = false;
+        if (!s->window->contRgn || !*s->window->contRgn ||
+            !WM_StrucOrigin(s->window, &origin)) {
+            SetEmptyRgn(s->valid);
+            continue;
+        }
+
+        AutoRgnHandle covered = WM_NewAutoRgn();
+        if (!covered.rgn) {
+            SetEmptyRgn(s->valid);
+            continue;
+        }
+        WindowPtr front = wmState->windowList;
+        int guard = 0;
+        while (front && front != s->window && guard++ < 64) {
+            if (front->visible && front->strucRgn && *front->strucRgn) {
+                UnionRgn(covered.rgn, front->strucRgn, covered.rgn);
+            }
+            front = front->nextWindow;
+        }
+        SectRgn(covered.rgn, s->window->contRgn, covered.rgn);
+        WM_StoreMarkValid(s, origin.left, origin.top, covered.rgn, false);
+        WM_DisposeAutoRgn(&covered);
+    }
+}
+
+Boolean WM_CompositorActive(void) {
+    return gCompositing && framebuffer != NULL;
+}
+
+void WM_SetCompositing(Boolean enable) {
+    if (!enable) {
+        for (int i = 0; i < kWMMaxBackingStores; i++) {
+            if (gStores[i].window) WM_StoreRelease(&gStores[i]);
+        }
+    }
+    gCompositing = enable;
+}
+
+Boolean WM_IsCompositing(void) {
+    return gCompositing;
+}
+
+UInt32 WM_CompositorStoreBytes(void) {
+    UInt32 bytes = 0;
+    for (int i = 0; i < kWMMaxBackingStores; i++) {
+        WMBackingStore* s = &gStores[i];
+        if (!s->gworld) continue;
+        PixMapHandle pmh = GetGWorldPixMap(s->gworld);
+        if (pmh && *pmh) {
+            bytes += (UInt32)((*pmh)->rowBytes & 0x3FFF) * (UInt32)s->height;
+        }
+    }
+    return bytes;
+}
+
+void WM_CompositorCapture(RgnHandle area) {
+    extern Boolean AppSwitcher_IsActive(void);
+    extern void HideCursor(void);
+    extern void ShowCursor(void);
+    extern void UpdateCursorDisplay(void);
+
+    if (!WM_CompositorActive() || !area || !*area || EmptyRgn(area)) return;
+
+    WM_StoreDropDrawnOutside();
+
+    WindowManagerState* wmState = GetWindowManagerState();
+    if (!wmState) return;
+
+    /* The application switcher is drawn over the windows; what is on screen
+     * in the area is not theirs. Forget it rather than capture the overlay. */
+    Boolean overlay = AppSwitcher_IsActive();
+
+    AutoRgnHandle covered = WM_NewAutoRgn();
+    AutoRgnHandle own = WM_NewAutoRgn();
+    if (!covered.rgn || !own.rgn) {
+        WM_DisposeAutoRgn(&covered);
+        WM_DisposeAutoRgn(&own);
+        return;
+    }
+
+    /* Take the software cursor off the screen so it is not captured */
+    HideCursor();
+    UpdateCursorDisplay();
+
+    WindowPtr window = wmState->windowList;
+    int guard = 0;
+    while (window && guard++ < 64) {
+        Rect origin;
+        if (window->visible && WM_StrucOrigin(window, &origin)) {
+            SectRgn(window->strucRgn, area, own.rgn);
+            DiffRgn(own.rgn, covered.rgn, own.rgn);
+
+            WMBackingStore* s = EmptyRgn(own.rgn) ? NULL : WM_StoreFor(window, !overlay);
+            if (s) {
+                if (!overlay) {
+                    WM_StoreCopy(s, origin.left, origin.top, own.rgn, false);
+                }
+                WM_StoreMarkValid(s, origin.left, origin.top, own.rgn, !overlay);
+            }
+            UnionRgn(covered.rgn, window->strucRgn, covered.rgn);
+        }
+        window = window->nextWindow;
+    }
+
+    ShowCursor();
+
+    WM_DisposeAutoRgn(&covered);
+    WM_DisposeAutoRgn(&own);
+}
+
+void WM_CompositorBlit(WindowPtr window, RgnHandle piece, RgnHandle leftover) {
+    extern void HideCursor(void);
+    extern void ShowCursor(void);
+    extern void UpdateCursorDisplay(void);
+
+    CopyRgn(piece, leftover);
+    if (!WM_CompositorActive()) return;
+
+    WM_StoreDropDrawnOutside();
+
+    Rect origin;
+    WMBackingStore* s = WM_StoreFor(window, false);
+    if (!s || !WM_StrucOrigin(window, &origin) || EmptyRgn(s->valid)) return;
+
+    AutoRgnHandle usable = WM_NewAutoRgn();
+    if (!usable.rgn) return;
+
+    CopyRgn(s->valid, usable.rgn);
+    OffsetRgn(usable.rgn, origin.left, origin.top);
+    SectRgn(usable.rgn, piece, usable.rgn);
+
+    /* An update still pending is content the application has not drawn yet;
+     * the store cannot have it either. */
+    if (window->updateRgn && *window->updateRgn) {
+        DiffRgn(usable.rgn, window->updateRgn, usable.rgn);
+    }
+
+    if (!EmptyRgn(usable.rgn)) {
+        HideCursor();
+        UpdateCursorDisplay();
+        WM_StoreCopy(s, origin.left, origin.top, usable.rgn, true);
+        ShowCursor();
+        DiffRgn(piece, usable.rgn, leftover);
+    }
+    WM_DisposeAutoRgn(&usable);
+}
+
+void WM_CompositorContentDrawn(WindowPtr window) {
+    if (!WM_CompositorActive() || !window) return;
+    if (!window->updateRgn || !*window->updateRgn || EmptyRgn(window->updateRgn)) return;
+    if (!window->contRgn || !*window->contRgn) return;
+
+    Rect origin;
+    WMBackingStore* s = WM_StoreFor(window, false);
+    if (!s || !WM_StrucOrigin(window, &origin)) return;
+
+    AutoRgnHandle drawn = WM_NewAutoRgn();
+    if (!drawn.rgn) {
+        SetEmptyRgn(s->valid);
+        return;
+    }
+    SectRgn(window->contRgn, window->updateRgn, drawn.rgn);
+
+    PixMapHandle src = window->offscreenGWorld ?
+                       GetGWorldPixMap(window->offscreenGWorld) : NULL;
+    PixMapHandle dst = GetGWorldPixMap(s->gworld);
+
+    if (!src || !*src || !(*src)->baseAddr || (*src)->pixelSize != 32 ||
+        !dst || !*dst || !(*dst)->baseAddr) {
+        /* Drawn straight to the screen: the covered part never reached any
+         * buffer. Forget the area; capture picks the visible part back up. */
+        WM_StoreMarkValid(s, origin.left, origin.top, drawn.rgn, false);
+        WM_DisposeAutoRgn(&drawn);
+        return;
+    }
+
+    /* The offscreen buffer's (0,0) is the content's top-left on screen */
+    SInt16 bufH = window->port.portBits.bounds.left;
+    SInt16 bufV = window->port.portBits.bounds.top;
+    SInt16 bufWidth = (*src)->bounds.right - (*src)->bounds.left;
+    SInt16 bufHeight = (*src)->bounds.bottom - (*src)->bounds.top;
+    size_t srcRowBytes = (size_t)((*src)->rowBytes & 0x3FFF);
+    size_t dstRowBytes = (size_t)((*dst)->rowBytes & 0x3FFF);
+
+    SInt16 count = EmptyRgn(drawn.rgn) ? 0 : WM_RegionRectCount(drawn.rgn);
+    for (SInt16 i = 0; i < count; i++) {
+        Rect r;
+        WM_RegionGetRect(drawn.rgn, i, &r);
+
+        if (r.left < bufH) r.left = bufH;
+        if (r.top < bufV) r.top = bufV;
+        if (r.right > bufH + bufWidth) r.right = bufH + bufWidth;
+        if (r.bottom > bufV + bufHeight) r.bottom = bufV + bufHeight;
+        if (r.left < origin.left) r.left = origin.left;
+        if (r.top < origin.top) r.top = origin.top;
+        if (r.right > origin.left + s->width) r.right = origin.left + s->width;
+        if (r.bottom > origin.top + s->height) r.bottom = origin.top + s->height;
+        if (r.left >= r.right || r.top >= r.bottom) continue;
+
+        size_t bytes = (size_t)(r.right - r.left) * 4u;
+        for (SInt16 y = r.top; y < r.bottom; y++) {
+            memcpy((UInt8*)(*dst)->baseAddr + (size_t)(y - origin.top) * dstRowBytes +
+                       (size_t)(r.left - origin.left) * 4u,
+                   (UInt8*)(*src)->baseAddr + (size_t)(y - bufV) * srcRowBytes +
+                       (size_t)(r.left - bufH) * 4u,
+                   bytes);
+        }
+    }
+
+    WM_StoreMarkValid(s, origin.left, origin.top, drawn.rgn, true);
+    WM_DisposeAutoRgn(&drawn);
+}
+
+void WM_CompositorInvalidateChrome(WindowPtr window) {
+    Rect origin;
+    if (!window || !window->contRgn || !*window->contRgn) return;
+
+    WMBackingStore* s = WM_StoreFor(window, false);
+    if (!s || !WM_StrucOrigin(window, &origin)) return;
+
+    AutoRgnHandle chrome = WM_NewAutoRgn();
+    if (!chrome.rgn) {
+        SetEmptyRgn(s->valid);
+        return;
+    }
+    DiffRgn(window->strucRgn, window->contRgn, chrome.rgn);
+    WM_StoreMarkValid(s, origin.left, origin.top, chrome.rgn, false);
+    WM_DisposeAutoRgn(&chrome);
+}
+
+void WM_CompositorForget(WindowPtr window) {
+    for (int i = 0; i < kWMMaxBackingStores; i++) {
+        if (gStores[i].window == window) {
+            WM_StoreRelease(&gStores[i]);
+        }
+    }
+    if (gNotedPort == (GrafPtr)window) gNotedPort = NULL;
+}
+
+void WM_CompositorNoteScreenDraw(GrafPtr port) {
+    /* Called for every screen mark, a pixel at a time for some drawing; a
+     * port already looked up costs one compare until the next drop */
+    if (port == gNotedPort || gRestoring || !port) return;
+
+    /* Inside an update the port draws into the offscreen buffer, and
+     * WM_CompositorContentDrawn takes care of it. Not remembered: the same
+     * port draws to the screen again after EndUpdate. */
+    if (port->portBits.baseAddr != (Ptr)framebuffer) return;
+    gNotedPort = port;
+
+    for (int i = 0; i < kWMMaxBackingStores; i++) {
+        if (gStores[i].window && (GrafPtr)gStores[i].window == port) {
+            gStores[i].drewOutside = true;
+            return;
+        }
+    }
+}
+
+#else  /* !WM_COMPOSITOR */
+
+/* Built without the compositor: every uncovered pixel is repainted. */
+
+Boolean WM_CompositorActive(void) { return false; }
+void WM_SetCompositing(Boolean enable) { (void)enable; }
+Boolean WM_IsCompositing(void) { return false; }
+UInt32 WM_CompositorStoreBytes(void) { return 0; }
+void WM_CompositorCapture(RgnHandle area) { (void)area; }
+void WM_CompositorBlit(WindowPtr window, RgnHandle piece, RgnHandle leftover) {
+    (void)window;
+    CopyRgn(piece, leftover);
+}
+void WM_CompositorContentDrawn(WindowPtr window) { (void)window; }
+void WM_CompositorInvalidateChrome(WindowPtr window) { (void)window; }
+void WM_CompositorForget(WindowPtr window) { (void)window; }
+void WM_CompositorNoteScreenDraw(GrafPtr port) { (void)port; }
+
+#endif /* WM_COMPOSITOR */
@@ -212,6 +212,19 @@ void MoveWindow(WindowPtr theWindow, short hGlobal, short vGlobal, Boolean front
         Platform_CopyRgn(theWindow->strucRgn, oldStrucRgn);
     }
 
+    /* With the compositor the move is a copy: keep what the window shows
+     * and what the windows under its new position show, and the damage pass
+     * below puts both back from the backing stores instead of repainting. */
+    if (theWindow->visible && oldStrucRgn && WM_CompositorActive()) {
+        RgnHandle captureRgn = Platform_NewRgn();
+        if (captureRgn) {
+            RectRgn(captureRgn, &newBounds);
+            UnionRgn(captureRgn, oldStrucRgn, captureRgn);
+            WM_CompositorCapture(captureRgn);
+            Platform_DisposeRgn(captureRgn);
+        }
+    }
+
     /* CRITICAL: Do NOT modify portRect - it must stay in LOCAL coordinates!
      * Only update the window regions which are in GLOBAL coordinates */
 
@@ -273,9 +286,13 @@ void MoveWindow(WindowPtr theWindow, short hGlobal, short vGlobal, Boolean front
         }
     }
     if (theWindow->updateRgn) {
-        /* Update region should be recalculated, not offset */
-        /* For now, just recalculate it to match content region */
-        if (theWindow->contRgn) {
+        if (WM_CompositorActive()) {
+            /* The content comes along in the backing store; only what was
+             * already waiting to be drawn still is, at its new place. */
+            OffsetRgn(theWindow->updateRgn, deltaH, deltaV);
+        } else if (theWindow->contRgn) {
+            /* Update region should be recalculated, not offset */
+            /* For now, just recalculate it to match content region */
             extern void CopyRgn(RgnHandle srcRgn, RgnHandle dstRgn);
             CopyRgn(theWindow->contRgn, theWindow->updateRgn);
         }
@@ -334,6 +351,7 @@ void MoveWindow(WindowPtr theWindow, short hGlobal, short vGlobal, Boolean front
         if (theWindow->strucRgn) {
             Local_InvalidateScreenRegion(theWindow->strucRgn);
         }
+        WM_RepaintDamage();
     }
 
     /* Clean up */
@@ -418,7 +436,6 @@ void DragWindow(WindowPtr theWindow, Point startPt, const Rect* boundsRect) {
     Point ptG;
     Point lastPos = startPt;
     Boolean moved = false;
-    Rect oldBounds = frameG;
 
     /* XOR outline state */
     Rect dragOutline = frameG;
@@ -620,108 +637,29 @@ void DragWindow(WindowPtr theWindow, Point startPt, const Rect* boundsRect) {
     if (moved) {
         WM_LOG_DEBUG("DragWindow: Final MoveWindow to (%d,%d)\n", dragOutline.left, dragOutline.top);
 
-        /* Create a region for the old window position to invalidate */
-        extern RgnHandle NewRgn(void);
-        extern void RectRgn(RgnHandle rgn, const Rect* r);
-        extern void DisposeRgn(RgnHandle rgn);
-        extern void PaintBehind(WindowPtr startWindow, RgnHandle clobberedRgn);
         extern void PaintOne(WindowPtr window, RgnHandle clobberedRgn);
         extern void CalcVis(WindowPtr window);
 
-        WM_LOG_DEBUG("DragWindow: About to call NewRgn()\n");
-        serial_puts("[MEM] DragWindow before NewRgn(oldRgn)\n");
-        MemoryManager_CheckSuspectBlock("pre_NewRgn_old");
-        RgnHandle oldRgn = NewRgn();
-        MemoryManager_CheckSuspectBlock("post_NewRgn_old");
-        WM_LOG_DEBUG("DragWindow: NewRgn() returned %p\n", oldRgn);
-        if (!oldRgn) {
-            WM_LOG_WARN("DragWindow: Failed to allocate oldRgn\n");
-            return;
-        }
-        RectRgn(oldRgn, &oldBounds);
-
-        WM_LOG_TRACE("DragWindow: Created oldRgn for bounds (%d,%d,%d,%d)\n",
-                     oldBounds.left, oldBounds.top, oldBounds.right, oldBounds.bottom);
-
         /* Move the window to new position */
         MoveWindow(theWindow, dragOutline.left, dragOutline.top, false);
 
         /* Recalculate window visibility */
         CalcVis(theWindow);
 
-        /* Calculate the uncovered desktop region: old position minus new position */
-        extern void DiffRgn(RgnHandle srcRgnA, RgnHandle srcRgnB, RgnHandle dstRgn);
-        RgnHandle uncoveredRgn = NewRgn();
-        MemoryManager_CheckSuspectBlock("post_NewRgn_uncovered");
-        RgnHandle newRgn = NewRgn();
-        MemoryManager_CheckSuspectBlock("post_NewRgn_new");
-
-        if (!uncoveredRgn || !newRgn) {
-            WM_LOG_WARN("DragWindow: Failed to allocate regions for uncovered area\n");
-            if (uncoveredRgn) DisposeRgn(uncoveredRgn);
-            if (newRgn) DisposeRgn(newRgn);
-            if (oldRgn) DisposeRgn(oldRgn);
-            return;
-        }
-
-        if (theWindow->strucRgn && *theWindow->strucRgn) {
-            CopyRgn(theWindow->strucRgn, newRgn);
-        }
-
-        /* Compute: oldRgn - newRgn = region that was uncovered */
-        DiffRgn(oldRgn, newRgn, uncoveredRgn);
-
-        WM_LOG_TRACE("DragWindow: Computed uncovered region\n");
-
-        /* Paint the desktop pattern in the uncovered region FIRST */
-        extern void GetWMgrPort(GrafPtr* port);
-        extern void SetClip(RgnHandle rgn);
-        typedef void (*DeskHookProc)(RgnHandle rgn);
-        extern DeskHookProc g_deskHook;  /* From sys71_stubs.c */
-
-        GrafPtr savePort;
-        GetPort(&savePort);
-        GrafPtr wmgrPort;
-        GetWMgrPort(&wmgrPort);
-        SetPort(wmgrPort);
-
-        /* Set clip to only the uncovered region */
-        SetClip(uncoveredRgn);
-
-
-        /* Call the desk hook to paint the desktop pattern in the uncovered region */
-        if (g_deskHook) {
-            WM_LOG_TRACE("DragWindow: Calling DeskHook for uncovered region\n");
-            g_deskHook(uncoveredRgn);
-        }
-
-        /* Reset clip */
-        extern void SetRectRgn(RgnHandle rgn, short left, short top, short right, short bottom);
-        RgnHandle fullClip = NewRgn();
-        if (fullClip) {
-            SetRectRgn(fullClip, -32768, -32768, 32767, 32767);
-            SetClip(fullClip);
-            DisposeRgn(fullClip);
-        }
-
-        SetPort(savePort);
-        WM_LOG_TRACE("DragWindow: Desktop repainted in uncovered region\n");
-
-        /* Repaint windows behind in the uncovered region */
-        PaintBehind(theWindow->nextWindow, uncoveredRgn);
-        WM_LOG_TRACE("DragWindow: PaintBehind called for uncovered region\n");
-
         /* Restore window visibility if it was visible before drag */
         if (wasVisible) {
             theWindow->visible = true;
         }
 
-        /* Repaint the window itself at new position */
-        PaintOne(theWindow, NULL);
-        WM_LOG_TRACE("DragWindow: PaintOne called for window at new position\n");
+        /* MoveWindow has already damaged the old and new positions and run
+         * the damage pass - the uncovered strip and the window at its new
+         * place are the only pixels that changed. Damaging them again here
+         * repainted the same area twice. */
 
-        /* Invalidate window content to trigger updateEvt for content redraw */
-        if (theWindow->contRgn) {
+        /* Invalidate window content to trigger updateEvt for content redraw.
+         * With the compositor the content moved with the window, and the
+         * damage pass posted an update for anything the store lacked. */
+        if (theWindow->contRgn && !WM_CompositorActive()) {
             extern void InvalRgn(RgnHandle badRgn);
             GrafPtr oldPort;
             GetPort(&oldPort);
@@ -740,15 +678,6 @@ void DragWindow(WindowPtr theWindow, Point startPt, const Rect* boundsRect) {
          * having several of them do it is what made repaint bugs so hard to
          * attribute. See ARCH-001 in docs/KNOWN_ISSUES.md. */
 
-        /* Clean up new regions */
-        DisposeRgn(uncoveredRgn);
-        DisposeRgn(newRgn);
-
-        /* Clean up */
-        WM_LOG_TRACE("DragWindow: About to DisposeRgn\n");
-        DisposeRgn(oldRgn);
-        WM_LOG_TRACE("DragWindow: DisposeRgn completed\n");
-
         /* Force screen update */
         extern void QDPlatform_FlushScreen(void);
         QDPlatform_FlushScreen();
@@ -1254,17 +1183,10 @@ static void Local_InvalidateScreenRegion(RgnHandle rgn) {
 
     WM_DEBUG("Local_InvalidateScreenRegion: Invalidating screen region");
 
-    /* Repaint windows behind this region to erase the old window chrome/content
-     * This is critical after a drag operation to remove the ghost image at the old position */
-    extern void PaintBehind(WindowPtr startWindow, RgnHandle clobberedRgn);
-    extern WindowManagerState* GetWindowManagerState(void);
-
-    WindowManagerState* wmState = GetWindowManagerState();
-    if (wmState && wmState->windowList) {
-        /* PaintBehind will redraw all windows from the start of the list
-         * The region parameter tells PaintBehind what area was affected */
-        PaintBehind(wmState->windowList, rgn);
-    }
+    /* Record the region as screen damage; MoveWindow repaints it once both
+     * the old and new positions are in. This used to PaintBehind the whole
+     * window list for each of them. */
+    WM_DamageScreenRgn(rgn);
 }
 
 /**
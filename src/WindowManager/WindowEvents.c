@@ -19,6 +19,7 @@
 #include "SystemTypes.h"
 #include "QuickDraw/QuickDraw.h"
 #include "QuickDraw/ColorQuickDraw.h"
+#include "QuickDraw/QuickDrawPlatform.h"
 #include "QuickDrawConstants.h"
 #include "WindowManager/WindowManager.h"
 #include "WindowManager/WindowManagerInternal.h"
@@ -316,6 +317,26 @@ void InvalWindowRect(WindowPtr window, const Rect* badRect)
     SetPort(savePort);
 }
 
+/*
+ * InvalRect and InvalRgn used to assume the current port was a window and
+ * union into its updateRgn. With the screen or Window Manager port current
+ * that wrote a region handle into whatever followed the GrafPort, and the
+ * area was never repainted. A port that is not in the window list has no
+ * update region; what it invalidates is screen damage, repainted by the next
+ * WM_Update pass.
+ */
+static Boolean WM_PortIsWindow(GrafPtr port) {
+    WindowManagerState* wmState = GetWindowManagerState();
+    WindowPtr window = wmState ? wmState->windowList : NULL;
+    int guard = 0;
+
+    while (window && guard++ < 64) {
+        if ((GrafPtr)window == port) return true;
+        window = window->nextWindow;
+    }
+    return false;
+}
+
 void InvalRect(const Rect* badRect) {
     if (badRect == NULL) return;
 
@@ -326,7 +347,18 @@ void InvalRect(const Rect* badRect) {
     GrafPtr currentPort = WM_GetCurrentPort();
     if (currentPort == NULL) return;
 
-    /* Assume current port is a window */
+    if (!WM_PortIsWindow(currentPort)) {
+        /* Local to global, as LocalToGlobal does */
+        Rect globalRect;
+        SetRect(&globalRect,
+                badRect->left + currentPort->portBits.bounds.left,
+                badRect->top + currentPort->portBits.bounds.top,
+                badRect->right + currentPort->portBits.bounds.left,
+                badRect->bottom + currentPort->portBits.bounds.top);
+        WM_DamageScreenRect(&globalRect);
+        return;
+    }
+
     WindowPtr window = (WindowPtr)currentPort;
 
     /* Add rectangle to window's update region */
@@ -375,7 +407,20 @@ void InvalRgn(RgnHandle badRgn) {
         return;
     }
 
-    /* Assume current port is a window */
+    if (!WM_PortIsWindow(currentPort)) {
+        RgnHandle globalRgn = Platform_NewRgn();
+        if (globalRgn) {
+            Platform_CopyRgn(badRgn, globalRgn);
+            Platform_OffsetRgn(globalRgn, currentPort->portBits.bounds.left,
+                               currentPort->portBits.bounds.top);
+            WM_DamageScreenRgn(globalRgn);
+            Platform_DisposeRgn(globalRgn);
+        } else {
+            WM_InvalidateDisplay_Public();
+        }
+        return;
+    }
+
     WindowPtr window = (WindowPtr)currentPort;
 
     /* Add region to window's update region */
@@ -408,9 +453,8 @@ void ValidRect(const Rect* goodRect) {
 
     /* Get current graphics port */
     GrafPtr currentPort = WM_GetCurrentPort();
-    if (currentPort == NULL) return;
+    if (currentPort == NULL || !WM_PortIsWindow(currentPort)) return;
 
-    /* Assume current port is a window */
     WindowPtr window = (WindowPtr)currentPort;
 
     /* Remove rectangle from window's update region */
@@ -433,9 +477,8 @@ void ValidRgn(RgnHandle goodRgn) {
 
     /* Get current graphics port */
     GrafPtr currentPort = WM_GetCurrentPort();
-    if (currentPort == NULL) return;
+    if (currentPort == NULL || !WM_PortIsWindow(currentPort)) return;
 
-    /* Assume current port is a window */
     WindowPtr window = (WindowPtr)currentPort;
 
     /* Remove region from window's update region */
@@ -554,7 +597,46 @@ void BeginUpdate(WindowPtr theWindow) {
             /* CRITICAL: Manually fill GWorld buffer with white ARGB pixels
              * (EraseRect doesn't properly handle 32-bit ARGB) */
             PixMapPtr pm = *pmHandle;
-            if (pm->pixelSize == 32 && pm->baseAddr) {
+            RgnHandle eraseRgn = NULL;
+            if (theWindow->updateRgn && *theWindow->updateRgn &&
+                theWindow->contRgn && *theWindow->contRgn) {
+                eraseRgn = Platform_NewRgn();
+            }
+            if (pm->pixelSize == 32 && pm->baseAddr && eraseRgn) {
+                /* Erase only what the application is about to redraw.
+                 * EndUpdate copies back only the update region, and update
+                 * regions are no longer always the whole content: the damage
+                 * pass invalidates just the part of a window it exposed.
+                 * Wiping the whole buffer here, with the whole buffer copied
+                 * back afterwards, blanked every pixel outside that part. */
+                UInt8* base = (UInt8*)pm->baseAddr;
+                SInt16 rowBytes = pm->rowBytes & 0x3FFF;
+                SInt16 width = gwBounds.right - gwBounds.left;
+                SInt16 height = gwBounds.bottom - gwBounds.top;
+                SInt16 originH = theWindow->port.portBits.bounds.left;
+                SInt16 originV = theWindow->port.portBits.bounds.top;
+
+                Platform_IntersectRgn(theWindow->contRgn, theWindow->updateRgn, eraseRgn);
+                SInt16 rectCount = EmptyRgn(eraseRgn) ? 0 : WM_RegionRectCount(eraseRgn);
+                for (SInt16 i = 0; i < rectCount; i++) {
+                    Rect r;
+                    WM_RegionGetRect(eraseRgn, i, &r);
+
+                    /* Global to buffer coordinates, clamped to the buffer */
+                    SInt16 left = r.left - originH, right = r.right - originH;
+                    SInt16 top = r.top - originV, bottom = r.bottom - originV;
+                    if (left < 0) left = 0;
+                    if (top < 0) top = 0;
+                    if (right > width) right = width;
+                    if (bottom > height) bottom = height;
+                    if (left >= right) continue;
+
+                    for (SInt16 y = top; y < bottom; y++) {
+                        memset(base + (size_t)y * (size_t)rowBytes + (size_t)left * 4u,
+                               0xFF, (size_t)(right - left) * 4u);
+                    }
+                }
+            } else if (pm->pixelSize == 32 && pm->baseAddr) {
                 UInt32* pixels = (UInt32*)pm->baseAddr;
                 SInt16 height = gwBounds.bottom - gwBounds.top;
                 SInt16 rowBytes = pm->rowBytes & 0x3FFF;
@@ -567,6 +649,9 @@ void BeginUpdate(WindowPtr theWindow) {
                 /* Fall back to EraseRect for non-32-bit modes */
                 EraseRect(&gwBounds);
             }
+            if (eraseRgn) {
+                Platform_DisposeRgn(eraseRgn);
+            }
         }
     } else {
 
@@ -616,6 +701,11 @@ void BeginUpdate(WindowPtr theWindow) {
                     pixels[screenY * pixelsPerRow + screenX] = 0xFFFFFFFF;
                 }
             }
+            if (updateBounds.left < updateBounds.right && updateBounds.top < updateBounds.bottom) {
+                QDPresent_MarkPixels(pixels + updateBounds.top * pixelsPerRow + updateBounds.left,
+                                     updateBounds.right - updateBounds.left,
+                                     updateBounds.bottom - updateBounds.top);
+            }
         } else if (theWindow->port.portBits.baseAddr) {
             /* No updateRgn - erase entire window content area as fallback */
             extern uint32_t fb_pitch;
@@ -644,6 +734,10 @@ void BeginUpdate(WindowPtr theWindow) {
                     pixels[screenY * pixelsPerRow + screenX] = 0xFFFFFFFF;
                 }
             }
+            if (windowLeft < windowRight && windowTop < windowBottom) {
+                QDPresent_MarkPixels(pixels + windowTop * pixelsPerRow + windowLeft,
+                                     windowRight - windowLeft, windowBottom - windowTop);
+            }
         }
     }
 
@@ -753,8 +847,21 @@ void EndUpdate(WindowPtr theWindow) {
                      * as the Macintosh HD window and the one underneath drew
                      * straight over it. */
                     RgnHandle visible = theWindow->visRgn;
+                    RgnHandle repainted = NULL;
                     SInt16 bandCount;
 
+                    /* Only the update region was erased and redrawn; the rest
+                     * of the buffer is whatever an earlier update left there,
+                     * which need not match the screen any more. */
+                    if (visible && *visible && theWindow->updateRgn &&
+                        *theWindow->updateRgn) {
+                        repainted = Platform_NewRgn();
+                        if (repainted) {
+                            Platform_IntersectRgn(visible, theWindow->updateRgn, repainted);
+                            visible = repainted;
+                        }
+                    }
+
                     if (!visible || !*visible) {
                         visible = NULL;   /* nothing known - copy the lot */
                         bandCount = 1;
@@ -826,6 +933,9 @@ void EndUpdate(WindowPtr theWindow) {
                                 &bandSrc, &bandDst, srcCopy, NULL);
                     }
 
+                    if (repainted) {
+                        Platform_DisposeRgn(repainted);
+                    }
                     serial_logf(kLogModuleWindow, kLogLevelDebug, "[COPYBITS] Done\n");
                 }
 
@@ -843,6 +953,10 @@ void EndUpdate(WindowPtr theWindow) {
         }
     }
 
+    /* The backing store takes the freshly drawn content before the update
+     * region that says which part that is goes away */
+    WM_CompositorContentDrawn(theWindow);
+
     /* Clear the update region */
     if (theWindow->updateRgn) {
         Platform_SetEmptyRgn(theWindow->updateRgn);
@@ -467,6 +467,9 @@ void CloseWindow(WindowPtr theWindow) {
         WM_LOG_DEBUG("CloseWindow: DisposeGWorld completed\n");
     }
 
+    /* And of its compositor backing store */
+    WM_CompositorForget(theWindow);
+
     /* Destroy native platform window */
     WM_LOG_DEBUG("CloseWindow: About to destroy native window\n");
     Platform_DestroyNativeWindow(theWindow);
@@ -160,6 +160,12 @@ void SizeWindow(WindowPtr theWindow, short w, short h, Boolean fUpdate) {
         Platform_CopyRgn(theWindow->strucRgn, oldStrucRgn);
     }
 
+    /* What the windows show there now goes into their backing stores before
+     * the frame moves; a shrink hands the windows behind theirs back. */
+    if (theWindow->visible && theWindow->strucRgn) {
+        WM_CompositorCapture(theWindow->strucRgn);
+    }
+
     /* Update window's port rectangle */
     (theWindow)->port.portRect.right = (theWindow)->port.portRect.left + w;
     (theWindow)->port.portRect.bottom = (theWindow)->port.portRect.top + h;
@@ -271,69 +277,36 @@ void SizeWindow(WindowPtr theWindow, short w, short h, Boolean fUpdate) {
         Local_GenerateResizeUpdateEvents(theWindow, currentWidth, currentHeight, w, h);
     }
 
-    /* Invalidate old and new window areas, and explicitly erase exposed desktop */
-    if (theWindow->visible) {
-        /* If window shrank, we need to erase and repaint the newly exposed desktop area */
-        /* This is the area that was covered by the window before but isn't covered now */
-        if (oldStrucRgn && theWindow->strucRgn) {
-            /* Create a region for areas that were covered before but aren't now */
-            RgnHandle exposedDesktop = Platform_NewRgn();
-            if (exposedDesktop) {
-                /* Exposed area = old region minus new region */
-                DiffRgn(oldStrucRgn, theWindow->strucRgn, exposedDesktop);
-
-                /* CRITICAL: Erase the exposed desktop area with desktop pattern BEFORE repainting */
-                /* This is the same approach used in HideWindow */
-                extern void EraseRgn(RgnHandle rgn);
-                extern void GetWMgrPort(GrafPtr* port);
-                extern void SetPort(GrafPtr port);
-                extern void GetPort(GrafPtr* port);
-
-                GrafPtr savePort, wmPort;
-                GetPort(&savePort);
-                GetWMgrPort(&wmPort);
-                SetPort(wmPort);
-
-                EraseRgn(exposedDesktop);
-
-                SetPort(savePort);
-
-                WM_DEBUG("SizeWindow: Erased exposed desktop area");
-
-                Platform_DisposeRgn(exposedDesktop);
-            }
-        }
+    /* Update window visibility */
+    WM_UpdateWindowVisibility(theWindow);
+
+    /* Update window state if this was user-initiated */
+    WM_UpdateWindowUserState(theWindow);
 
+    /*
+     * Repaint through the damage pass, like ShowWindow, HideWindow and
+     * BringToFront: everything the frame covered before or covers now,
+     * less what windows in front hide. The window itself gets its frame
+     * drawn at the new size and its content erased and posted as an update
+     * (its backing store no longer fits and is dropped); the windows behind
+     * a shrink come back from their stores or are painted, and the desktop
+     * is drawn where nothing claims it.
+     *
+     * This used to erase the exposed desktop, add old and new frame to every
+     * window's updateRgn and PaintOne the frame - and GrowWindow then ran
+     * PaintOne and PaintBehind again - so nothing went through the damage
+     * region or the backing stores.
+     */
+    if (theWindow->visible) {
         if (oldStrucRgn) {
-            WM_InvalidateScreenRegion(oldStrucRgn);
+            WM_DamageWindowRgn(theWindow, oldStrucRgn);
         }
         if (theWindow->strucRgn) {
-            WM_InvalidateScreenRegion(theWindow->strucRgn);
+            WM_DamageWindowRgn(theWindow, theWindow->strucRgn);
         }
-
-        /*
-         * Redraw the frame at its new size.
-         *
-         * WM_InvalidateScreenRegion above adds to each window's updateRgn,
-         * which is what update events redraw - and an update event redraws
-         * content. The frame is the Window Manager's to draw, so nothing
-         * above puts it back: a resized window kept its old content and lost
-         * its title bar, its border and its grow box, with whatever had been
-         * behind it still showing through where the frame used to be.
-         *
-         * PaintOne draws the frame and erases the content area under it; the
-         * update events just queued then fill the content back in.
-         */
-        extern void PaintOne(WindowPtr window, RgnHandle clobberedRgn);
-        PaintOne(theWindow, theWindow->strucRgn);
+        WM_RepaintDamage();
     }
 
-    /* Update window visibility */
-    WM_UpdateWindowVisibility(theWindow);
-
-    /* Update window state if this was user-initiated */
-    WM_UpdateWindowUserState(theWindow);
-
     /* Clean up */
     if (oldStrucRgn) {
         Platform_DisposeRgn(oldStrucRgn);
@@ -537,27 +510,8 @@ long GrowWindow(WindowPtr theWindow, Point startPt, const Rect* bBox) {
         SizeWindow(theWindow, finalWidth, finalHeight, true);
         serial_puts("[GW] SizeWindow called\n");
 
-        /* Force complete window redraw - MUST redraw frame/chrome AND content */
-        /* PaintBehind is designed to repaint windows after structural changes */
-        extern void PaintBehind(WindowPtr startWindow, RgnHandle clobberedRgn);
-        extern void FolderWindow_Draw(WindowPtr w);
-        extern void BeginUpdate(WindowPtr window);
-        extern void EndUpdate(WindowPtr window);
-
-        serial_puts("[GW] Starting window redraw\n");
-
-        /* CRITICAL: Explicitly redraw window chrome (frame and title bar)
-         * PaintBehind doesn't necessarily repaint the chrome of the resized window itself */
-        extern void PaintOne(WindowPtr window, RgnHandle clobberedRgn);
-        serial_puts("[GW] Calling PaintOne to redraw window chrome\n");
-        PaintOne(theWindow, NULL);
-        serial_puts("[GW] PaintOne completed - chrome redrawn\n");
-
-        /* Use PaintBehind to repaint windows behind the resized window */
-        /* This ensures desktop/windows behind are redrawn for exposed areas */
-        serial_puts("[GW] Calling PaintBehind to repaint exposed areas behind window\n");
-        PaintBehind(theWindow->nextWindow, NULL);  /* Start with window BEHIND this one */
-        serial_puts("[GW] PaintBehind completed\n");
+        /* SizeWindow repaints the frame and whatever the old one uncovered
+         * through the damage pass, and posts the content as an update */
 
         /* Also redraw folder content if applicable */
         serial_puts("[GW] Checking for folder window content\n");
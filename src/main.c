@@ -13,6 +13,7 @@
 /* Include actual System 7.1 headers */
 #include "../include/MacTypes.h"
 #include "../include/QuickDraw/QuickDraw.h"
+#include "../include/QuickDraw/QuickDrawPlatform.h"  /* QDPresent_* */
 #include "../include/ResourceManager.h"
 #include "../include/EventManager/EventTypes.h"  /* Include EventTypes first to define activeFlag */
 #include "../include/EventManager/EventManager.h"
@@ -161,6 +162,16 @@ static void process_serial_command(void) {
             break;
 #endif
 
+        case 'y':  /* Heap telemetry snapshot, for scripts/heapsnap.py */
+        case 'Y':
+            MemoryManager_DumpSnapshot();
+            break;
+
+        case 'p':  /* Frame presentation statistics */
+        case 'P':
+            QDPresent_DumpStats();
+            break;
+
         case 'f':  /* File menu */
         case 'F':
             {
@@ -207,6 +218,8 @@ static void process_serial_command(void) {
             serial_puts("a/A - Simulate click on Apple menu\n");
             serial_puts("f/F - Simulate click on File menu\n");
             serial_puts("k/K - Test MenuKey (prompts for key)\n");
+            serial_puts("y/Y - Heap telemetry snapshot (scripts/heapsnap.py)\n");
+            serial_puts("p/P - Frame presentation statistics\n");
             serial_puts("h/H/? - Show this help\n");
             serial_puts("================================\n\n");
             break;
@@ -1008,6 +1021,35 @@ static void init_system71(void) {
         SegmentLoader_TestBoot();
     }
 
+#ifdef PPC_BENCHMARK
+    /* Nothing runs PowerPC code at boot, so this is opt-in. */
+    {
+        extern void PPC_Benchmark(void);
+        PPC_Benchmark();
+    }
+#endif
+
+#ifdef MEMORY_BENCHMARK
+    {
+        extern void MemoryManager_Benchmark(void);
+        MemoryManager_Benchmark();
+    }
+#endif
+
+#ifdef QUICKDRAW_BENCHMARK
+    {
+        extern void QuickDraw_BlitBenchmark(void);
+        QuickDraw_BlitBenchmark();
+    }
+#endif
+
+#ifdef FONT_BENCHMARK
+    {
+        extern void FontManager_OutlineBenchmark(void);
+        FontManager_OutlineBenchmark();
+    }
+#endif
+
 #ifdef INTEGRATION_TESTS
     /* Phase 1 Integration Test Suite */
     extern OSErr IntegrationTests_Initialize(void);
@@ -1396,6 +1438,7 @@ void UpdateCursorDisplay(void) {
                     }
                 }
             }
+            QDPresent_MarkDirty(cursor_old_x, cursor_old_y, cursor_old_x + 16, cursor_old_y + 16);
             cursor_saved = false;
         }
         return;  /* Don't draw cursor */
@@ -1427,6 +1470,7 @@ void UpdateCursorDisplay(void) {
                 }
             }
         }
+        QDPresent_MarkDirty(cursor_old_x, cursor_old_y, cursor_old_x + 16, cursor_old_y + 16);
     }
 
     /* Save and draw new cursor */
@@ -1461,6 +1505,8 @@ void UpdateCursorDisplay(void) {
         }
     }
 
+    QDPresent_MarkDirty(drawX, drawY, drawX + 16, drawY + 16);
+
     cursor_old_x = drawX;
     cursor_old_y = drawY;
     cursor_saved = true;
@@ -1566,7 +1612,7 @@ void kernel_main(uint32_t magic, uint32_t* mb2_info) {
         }
 
         DrawDesktop();
-        hal_framebuffer_present();
+        QDPlatform_FlushScreen();
     }
 
     /* Create windows and menus using real System 7.1 APIs */
@@ -1747,6 +1793,7 @@ void kernel_main(uint32_t magic, uint32_t* mb2_info) {
             }
         }
 
+        QDPresent_MarkDirty(x, y, x + 16, y + 16);
         cursor_old_x = x;
         cursor_old_y = y;
         cursor_saved = true;
@@ -1813,7 +1860,8 @@ void kernel_main(uint32_t magic, uint32_t* mb2_info) {
 
             MemoryManager_CheckSuspectBlock("after_dispatch(coop)");
         } else {
-            /* No events - yield to other processes */
+            /* No events - tidy the heap a little, then yield to other processes */
+            MemoryManager_IdleCompact(16 * 1024);
             Proc_Yield();
         }
 #endif /* ENABLE_PROCESS_COOP */
@@ -1863,6 +1911,7 @@ void kernel_main(uint32_t magic, uint32_t* mb2_info) {
                         }
                     }
                 }
+                QDPresent_MarkDirty(cursor_old_x, cursor_old_y, cursor_old_x + 16, cursor_old_y + 16);
             }
 
             /* Save and draw new cursor */
@@ -1893,6 +1942,8 @@ void kernel_main(uint32_t magic, uint32_t* mb2_info) {
                 }
             }
 
+            QDPresent_MarkDirty(x, y, x + 16, y + 16);
+
             cursor_old_x = x;
             cursor_old_y = y;
             cursor_saved = true;
@@ -1924,8 +1975,9 @@ void kernel_main(uint32_t magic, uint32_t* mb2_info) {
 skip_cursor_drawing:
         /* Re-enable SystemTask and GetNextEvent for event processing */
 #if 1
+        /* Present what changed, at most once per frame */
         if (framebuffer) {
-            hal_framebuffer_present();
+            QDPresent_Frame(false);
         }
         /* System 7.1 cooperative multitasking */
         SystemTask();
@@ -1951,6 +2003,9 @@ skip_cursor_drawing:
             /* Let DispatchEvent handle all events */
             DispatchEvent(&event);
             MemoryManager_CheckSuspectBlock("after_dispatch(main)");
+        } else {
+            /* Nothing to do: tidy a heap that has needed compacting, 16KB at a time */
+            MemoryManager_IdleCompact(16 * 1024);
         }
 #endif
 